@@ -0,0 +1,327 @@
+#include "i8080_basic_fp.h"
+
+#ifdef ALTAIR_BASIC_FP
+
+#include "op_codes.h"
+
+// The floating point accumulator: mantissa low to high, the sign in bit 7 of the high byte where
+// the normalized mantissa has its leading 1, exponent offset by 0x80 and 0 for zero
+#define FAC_LO 0x0253
+#define FAC_MID 0x0254
+#define FAC_HI 0x0255
+#define FAC_EXP 0x0256
+#define FAC_SIGN 0x0257 // Scratch, bit 7 set for a positive result
+
+// Operands FMULT and FDIV patch into their inner loops
+#define FMULT_ADDEND 0x138d    // LXI D: multiplicand middle and low byte
+#define FMULT_ADDEND_HI 0x1392 // ACI: multiplicand high byte
+#define FDIV_DIVISOR_LO 0x13e0 // SUI
+#define FDIV_DIVISOR_MID 0x13e4 // SBI
+#define FDIV_DIVISOR_HI 0x13e8 // SBI
+#define FDIV_REMAINDER_HI 0x13eb // MVI A: top byte of the remainder
+
+// Bytes compared with the image at each entry point
+#define SIGNATURE_LENGTH 16
+
+// Loop bound for FDIV, which takes 25 or 26 steps from normalized operands
+#define FDIV_MAX_STEPS 64
+
+static bool matches(const memory_space_t* mem, uint16_t address, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (fetch8(mem, (uint16_t)(address + i)) != basic_8k_rom[address + i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool i8080_basic_fp_present(const memory_space_t* mem)
+{
+    return matches(mem, I8080_BASIC_FP_FADD, 4) && matches(mem, I8080_BASIC_FP_FMULT, 4) &&
+           matches(mem, I8080_BASIC_FP_FDIV, 4);
+}
+
+// The ROM's UNPACK, on the accumulator's high byte fac_hi and the operand's hi. Returns what it
+// leaves in A: bit 7 set when the signs are the same
+static uint8_t unpack(uint8_t fac_hi, uint8_t hi, uint8_t* sign)
+{
+    *sign = (uint8_t)(((fac_hi & 0x80) ^ 0x80) | 0x40 | ((fac_hi & 0x7f) >> 1));
+    return (uint8_t)((((hi ^ fac_hi) & 0x80) ^ 0x80) | (((hi & 0x7f) >> 1) ^ ((fac_hi & 0x7f) >> 1)));
+}
+
+static uint32_t mantissa(uint8_t hi, uint8_t mid, uint8_t lo)
+{
+    return (uint32_t)(hi | 0x80) << 16 | (uint32_t)mid << 8 | lo;
+}
+
+// The ROM's NORMAL: shift the 32-bit mantissa C:D:E:B up to its leading 1, taking the places off
+// the exponent. False where it gives zero
+static bool normalize(uint32_t* m, int* exp)
+{
+    if (*m == 0)
+    {
+        return false;
+    }
+    int shift = __builtin_clz(*m);
+    if (shift != 0)
+    {
+        *m <<= shift;
+        *exp -= shift;
+    }
+    return *exp > 0;
+}
+
+// The ROM's ROUND on a normalized mantissa, to 24 bits with the extension byte's top bit.
+// False on overflow
+static bool round_mantissa(uint32_t* m, int* exp)
+{
+    bool up = (*m & 0x80) != 0;
+    *m >>= 8;
+    if (up && ++*m == 1u << 24)
+    {
+        *m = 0x800000;
+        ++*exp;
+    }
+    return *exp <= 0xff;
+}
+
+// The ROM's tail from ROUND: store the result in the accumulator through MOVFR, with A and the
+// flags from its XRA C (base has the other flag bits), and return to the caller
+static uint8_t finish(intel8080_t* cpu, uint32_t m, int exp, uint8_t sign, uint8_t base)
+{
+    memory_space_t* mem = cpu->memory;
+    uint8_t hi = (uint8_t)(((m >> 16) & 0x7f) | (~sign & 0x80));
+    write8(mem, FAC_LO, (uint8_t)m);
+    write8(mem, FAC_MID, (uint8_t)(m >> 8));
+    write8(mem, FAC_HI, hi);
+    write8(mem, FAC_EXP, (uint8_t)exp);
+    write8(mem, FAC_SIGN, sign);
+
+    uint8_t flags = base & (uint8_t)~(FLAGS_CARRY | FLAGS_PARITY | FLAGS_H | FLAGS_ZERO | FLAGS_SIGN);
+    flags |= (uint8_t)(hi & FLAGS_SIGN);
+    if (hi == 0)
+    {
+        flags |= FLAGS_ZERO;
+    }
+    if (!__builtin_parity(hi))
+    {
+        flags |= FLAGS_PARITY;
+    }
+    cpu->registers.a = hi;
+    cpu->registers.flags = flags;
+    cpu->registers.b = (uint8_t)exp;
+    cpu->registers.c = hi;
+    cpu->registers.d = (uint8_t)exp;
+    cpu->registers.e = hi;
+    cpu->registers.hl = FAC_SIGN;
+    cpu->registers.pc = read16(mem, cpu->registers.sp);
+    cpu->registers.sp += 2;
+    return CYCLES_RET;
+}
+
+// FAC = BCDE + FAC
+static uint8_t fadd(intel8080_t* cpu)
+{
+    const memory_space_t* mem = cpu->memory;
+    int exp = read8(mem, FAC_EXP);
+    uint8_t fac_hi = read8(mem, FAC_HI);
+    uint32_t big = mantissa(fac_hi, read8(mem, FAC_MID), read8(mem, FAC_LO));
+    int arg_exp = cpu->registers.b;
+    uint8_t hi = cpu->registers.c;
+    uint32_t small = mantissa(hi, cpu->registers.d, cpu->registers.e);
+    if (arg_exp == 0 || exp == 0)
+    {
+        return 0; // The ROM returns or copies BCDE straight away
+    }
+    if (exp < arg_exp)
+    {
+        // The accumulator takes the larger exponent
+        int t = exp;
+        exp = arg_exp;
+        arg_exp = t;
+        uint8_t h = fac_hi;
+        fac_hi = hi;
+        hi = h;
+        uint32_t m = big;
+        big = small;
+        small = m;
+    }
+    int places = exp - arg_exp;
+    if (places >= 25)
+    {
+        return 0; // Too small to count, the ROM leaves the larger operand
+    }
+
+    uint8_t sign;
+    bool same_signs = (unpack(fac_hi, hi, &sign) & 0x80) != 0;
+    uint32_t m = (small << 8) >> places; // With the extension byte
+    if (same_signs)
+    {
+        uint64_t sum = ((uint64_t)big << 8) + m;
+        m = (uint32_t)sum;
+        if (sum >> 32)
+        {
+            m = (uint32_t)(sum >> 1);
+            if (++exp > 0xff)
+            {
+                return 0;
+            }
+        }
+    }
+    else
+    {
+        uint32_t difference = (big << 8) - m;
+        if (m > big << 8)
+        {
+            difference = -difference;
+            sign = (uint8_t)~sign;
+        }
+        m = difference;
+        if (!normalize(&m, &exp))
+        {
+            return 0;
+        }
+    }
+    if (!round_mantissa(&m, &exp))
+    {
+        return 0;
+    }
+    return finish(cpu, m, exp, sign, cpu->registers.flags);
+}
+
+// FAC = BCDE * FAC, the shift and add loop keeping the top 32 bits of the product
+static uint8_t fmult(intel8080_t* cpu)
+{
+    memory_space_t* mem = cpu->memory;
+    int fac_exp = read8(mem, FAC_EXP);
+    int arg_exp = cpu->registers.b;
+    int exp = fac_exp + arg_exp - 0x80;
+    if (fac_exp == 0 || arg_exp == 0 || exp <= 0 || exp > 0xff)
+    {
+        return 0; // Zero, underflow or overflow
+    }
+
+    uint8_t fac_hi = read8(mem, FAC_HI);
+    uint8_t hi = cpu->registers.c;
+    uint8_t fac_sign;
+    uint8_t sign = unpack(fac_hi, hi, &fac_sign); // MULDIV keeps A in FAC_SIGN
+    uint32_t multiplier = mantissa(fac_hi, read8(mem, FAC_MID), read8(mem, FAC_LO));
+    uint32_t multiplicand = mantissa(hi, cpu->registers.d, cpu->registers.e);
+    uint32_t m = (uint32_t)(((uint64_t)multiplier * multiplicand) >> 16);
+    if (!normalize(&m, &exp) || !round_mantissa(&m, &exp))
+    {
+        return 0;
+    }
+
+    write8(mem, FMULT_ADDEND, cpu->registers.e);
+    write8(mem, FMULT_ADDEND + 1, cpu->registers.d);
+    write8(mem, FMULT_ADDEND_HI, hi | 0x80);
+    return finish(cpu, m, exp, sign, cpu->registers.flags);
+}
+
+// FAC = BCDE / FAC, the ROM's restoring division one quotient bit at a time
+static uint8_t fdiv(intel8080_t* cpu)
+{
+    memory_space_t* mem = cpu->memory;
+    int fac_exp = read8(mem, FAC_EXP);
+    int arg_exp = cpu->registers.b;
+    int exp = arg_exp - fac_exp + 0x7f;
+    if (fac_exp == 0 || arg_exp == 0 || exp <= 0 || exp + 2 > 0xff)
+    {
+        return 0; // Division by zero, zero, underflow or overflow
+    }
+    exp += 2;
+
+    uint8_t fac_hi = read8(mem, FAC_HI);
+    uint8_t hi = cpu->registers.c;
+    uint8_t fac_sign;
+    uint8_t sign = unpack(fac_hi, hi, &fac_sign); // MULDIV keeps A in FAC_SIGN
+    uint32_t divisor = mantissa(fac_hi, read8(mem, FAC_MID), read8(mem, FAC_LO));
+    uint32_t remainder = mantissa(hi, cpu->registers.d, cpu->registers.e); // B:H:L
+    uint8_t remainder_hi = 0;
+    uint32_t quotient = 0; // C:D:E
+    uint8_t base = cpu->registers.flags;
+    bool bit;
+    for (int step = 0;; step++)
+    {
+        if (step == FDIV_MAX_STEPS)
+        {
+            return 0;
+        }
+        // Subtract, keeping the difference when it does not borrow. The POP PSW that drops the
+        // saved remainder leaves its low byte in the flags
+        uint32_t difference = remainder - divisor;
+        bool borrow = remainder < divisor;
+        uint8_t top = (uint8_t)(remainder_hi - borrow);
+        bit = !(borrow && remainder_hi == 0);
+        if (bit)
+        {
+            base = (uint8_t)remainder;
+            remainder = difference & 0xffffff;
+            remainder_hi = top;
+        }
+        if (quotient & 0x800000)
+        {
+            break;
+        }
+        quotient = (quotient << 1 | bit) & 0xffffff;
+        remainder <<= 1;
+        remainder_hi = (uint8_t)(remainder_hi << 1 | (remainder >> 24));
+        remainder &= 0xffffff;
+        if (quotient == 0 && --exp == 0)
+        {
+            return 0;
+        }
+    }
+
+    uint32_t m = quotient << 8 | (bit ? 0x80 : 0);
+    if (!round_mantissa(&m, &exp))
+    {
+        return 0;
+    }
+
+    write8(mem, FDIV_DIVISOR_LO, (uint8_t)divisor);
+    write8(mem, FDIV_DIVISOR_MID, (uint8_t)(divisor >> 8));
+    write8(mem, FDIV_DIVISOR_HI, (uint8_t)(divisor >> 16));
+    write8(mem, FDIV_REMAINDER_HI, remainder_hi);
+    return finish(cpu, m, exp, sign, base);
+}
+
+uint8_t i8080_basic_fp_trap(intel8080_t* cpu)
+{
+    uint16_t pc = cpu->registers.pc;
+    if (!matches(cpu->memory, pc, SIGNATURE_LENGTH))
+    {
+        return 0;
+    }
+    switch (pc)
+    {
+        case I8080_BASIC_FP_FADD:
+            return fadd(cpu);
+        case I8080_BASIC_FP_FMULT:
+            return fmult(cpu);
+        case I8080_BASIC_FP_FDIV:
+            return fdiv(cpu);
+        default:
+            return 0;
+    }
+}
+
+#else
+
+bool i8080_basic_fp_present(const memory_space_t* mem)
+{
+    (void)mem;
+    return false;
+}
+
+uint8_t i8080_basic_fp_trap(intel8080_t* cpu)
+{
+    (void)cpu;
+    return 0;
+}
+
+#endif
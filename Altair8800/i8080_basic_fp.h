@@ -0,0 +1,37 @@
+#ifndef _I8080_BASIC_FP_H_
+#define _I8080_BASIC_FP_H_
+
+#include "intel8080.h"
+#include "memory.h"
+
+// Native floating point for the Altair 8K BASIC that load8kRom loads, only built with
+// ALTAIR_BASIC_FP. When i8080_run reaches the ROM's FADD, FMULT or FDIV, the operation is done in
+// C on the floating point accumulator and BCDE, and the CPU returns to the caller as from the
+// routine: the accumulator, the registers, the flags, the sign scratch byte and the operands
+// the routines patch into their own code come out as the ROM leaves them, so results are bit
+// for bit those of the emulated routines. SQR, SIN, EXP, LOG and the rest are built from these
+// three and speed up with them. Zero operands, underflow, overflow and division by zero run the
+// ROM's code, which reports the errors. Memory below the stack pointer, where the routines
+// leave return addresses, is not written.
+#define I8080_BASIC_FP_FADD 0x1221
+#define I8080_BASIC_FP_FMULT 0x135b
+#define I8080_BASIC_FP_FDIV 0x13b9
+
+#define I8080_BASIC_FP_ENTRY(pc) \
+    ((pc) == I8080_BASIC_FP_FADD || (pc) == I8080_BASIC_FP_FMULT || (pc) == I8080_BASIC_FP_FDIV)
+
+/**
+ * Whether mem holds the 8K BASIC at 0x0000, so that i8080_run checks for the routines
+ * Called from i8080_run once per batch
+ */
+bool i8080_basic_fp_present(const memory_space_t* mem);
+
+/**
+ * Run the floating point routine at PC natively
+ * Called from i8080_run, with the registers in cpu
+ *
+ * @return T-states taken, 0 when the ROM's code is to run instead
+ */
+uint8_t i8080_basic_fp_trap(intel8080_t* cpu);
+
+#endif
@@ -0,0 +1,312 @@
+#include "i8080_bdos.h"
+
+#ifdef ALTAIR_BDOS_TRAP
+
+#include "memory.h"
+#include "op_codes.h"
+
+#define BDOS_CONSOLE_OUTPUT 2
+#define BDOS_PRINT_STRING 9
+#define BDOS_READ_BUFFER 10
+
+#define CTRL(c) ((c) & 0x1f)
+#define RUBOUT 0x7f
+
+typedef struct
+{
+    uint16_t entry;       // Where the JMP at I8080_BDOS_VECTOR went at boot, 0 until then
+    uint8_t column;       // Console column, counted as the BDOS does
+    bool reading;         // A read console buffer waits for the end of its line
+    uint16_t buffer;      // Its buffer: length, count, then the characters
+    uint8_t count;        // Characters in the line so far
+    uint8_t start_column; // Column the line started at
+    bool paused;          // Output stopped by ^S until the next key
+} i8080_bdos_t;
+
+static i8080_bdos_t bdos;
+
+// Console output as the BDOS counts it: tabs to the next multiple of 8, LF back to 0, backspace
+// one back, the other control characters and DEL not at all
+static void tab_out(intel8080_t* cpu, uint8_t ch)
+{
+    if (ch == '\t')
+    {
+        do
+        {
+            cpu->term_out(' ');
+        } while (++bdos.column & 7);
+        return;
+    }
+    cpu->term_out(ch);
+    if (ch == '\n')
+    {
+        bdos.column = 0;
+    }
+    else if (ch == '\b')
+    {
+        if (bdos.column > 0)
+        {
+            bdos.column--;
+        }
+    }
+    else if (ch >= ' ' && ch != RUBOUT)
+    {
+        bdos.column++;
+    }
+}
+
+// Echo of a line character, control characters other than CR, LF, tab and backspace as ^X
+static void ctl_out(intel8080_t* cpu, uint8_t ch)
+{
+    if (ch < ' ' && ch != '\r' && ch != '\n' && ch != '\t' && ch != '\b')
+    {
+        tab_out(cpu, '^');
+        ch |= 0x40;
+    }
+    tab_out(cpu, ch);
+}
+
+// Back up to column, erasing what was there
+static void back_up(intel8080_t* cpu, uint8_t column)
+{
+    while (bdos.column > column)
+    {
+        tab_out(cpu, '\b');
+        tab_out(cpu, ' ');
+        tab_out(cpu, '\b');
+    }
+}
+
+// '#', a new line and spaces up to the start column, where ^U and ^R carry on
+static void new_line(intel8080_t* cpu)
+{
+    tab_out(cpu, '#');
+    tab_out(cpu, '\r');
+    tab_out(cpu, '\n');
+    while (bdos.column < bdos.start_column)
+    {
+        tab_out(cpu, ' ');
+    }
+}
+
+// Column the first count characters of the line end at
+static uint8_t line_column(const memory_space_t* mem, uint8_t count)
+{
+    uint8_t column = bdos.start_column;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t ch = read8(mem, (uint16_t)(bdos.buffer + 2 + i));
+        if (ch == '\t')
+        {
+            column = (uint8_t)((column | 7) + 1);
+        }
+        else
+        {
+            column += (ch < ' ' && ch != '\r' && ch != '\n' && ch != '\b') ? 2 : 1;
+        }
+    }
+    return column;
+}
+
+typedef enum
+{
+    BDOS_WAITING = 0, // For console input, PC stays on the BDOS vector
+    BDOS_DONE,
+    BDOS_REBOOT       // ^C, off to the warm boot
+} bdos_result_t;
+
+// Before output, as the BDOS's console break check: ^S stops it until the next key (^C then
+// reboots), any other key stays in the receive FIFO for the next read
+static bdos_result_t console_break(intel8080_t* cpu)
+{
+    uint8_t ch = i8080_console_read(cpu) & 0x7f;
+    if (bdos.paused)
+    {
+        if (ch == 0)
+        {
+            return BDOS_WAITING;
+        }
+        bdos.paused = false;
+        return ch == CTRL('C') ? BDOS_REBOOT : BDOS_DONE;
+    }
+    if (ch == CTRL('S'))
+    {
+        bdos.paused = true;
+        return BDOS_WAITING;
+    }
+    if (ch != 0)
+    {
+        i8080_console_unread(cpu, ch);
+    }
+    return BDOS_DONE;
+}
+
+// Take the console input there is into the buffer at DE
+static bdos_result_t read_line(intel8080_t* cpu)
+{
+    memory_space_t* mem = cpu->memory;
+    if (!bdos.reading || bdos.buffer != cpu->registers.de)
+    {
+        bdos.reading = true;
+        bdos.buffer = cpu->registers.de;
+        bdos.count = 0;
+        bdos.start_column = bdos.column;
+    }
+    uint8_t max = read8(mem, bdos.buffer);
+
+    while (bdos.count < max)
+    {
+        uint8_t ch = i8080_console_read(cpu) & 0x7f; // As the BIOS reads it
+        if (ch == 0)
+        {
+            return BDOS_WAITING;
+        }
+        cpu->idle_polls = 0;
+
+        switch (ch)
+        {
+            case '\r':
+            case '\n':
+                max = bdos.count; // Ends the line
+                break;
+            case CTRL('C'):
+                if (bdos.count == 0)
+                {
+                    bdos.reading = false;
+                    return BDOS_REBOOT;
+                }
+                goto store;
+            case CTRL('E'): // Physical end of line, the typing goes on from column 0
+                tab_out(cpu, '\r');
+                tab_out(cpu, '\n');
+                bdos.start_column = 0;
+                break;
+            case CTRL('H'):
+                if (bdos.count > 0)
+                {
+                    back_up(cpu, line_column(mem, --bdos.count));
+                }
+                break;
+            case RUBOUT: // Echoes the character it removes
+                if (bdos.count > 0)
+                {
+                    ctl_out(cpu, read8(mem, (uint16_t)(bdos.buffer + 2 + --bdos.count)));
+                }
+                break;
+            case CTRL('P'): // Printer echo is not kept up
+                break;
+            case CTRL('R'):
+                new_line(cpu);
+                for (uint8_t i = 0; i < bdos.count; i++)
+                {
+                    ctl_out(cpu, read8(mem, (uint16_t)(bdos.buffer + 2 + i)));
+                }
+                break;
+            case CTRL('U'):
+                new_line(cpu);
+                bdos.count = 0;
+                break;
+            case CTRL('X'):
+                back_up(cpu, bdos.start_column);
+                bdos.count = 0;
+                break;
+            default:
+            store:
+                write8(mem, (uint16_t)(bdos.buffer + 2 + bdos.count++), ch);
+                ctl_out(cpu, ch);
+                break;
+        }
+    }
+
+    write8(mem, (uint16_t)(bdos.buffer + 1), bdos.count);
+    bdos.reading = false;
+    return BDOS_DONE;
+}
+
+uint8_t i8080_bdos_trap(intel8080_t* cpu)
+{
+    memory_space_t* mem = cpu->memory;
+    uint16_t target = fetch16(mem, I8080_BDOS_VECTOR + 1);
+    if (bdos.entry == 0)
+    {
+        // CP/M 2.2 jumps 6 bytes into the page the BDOS starts at, past its serial number, onto a JMP
+        if ((target & MEMORY_PAGE_MASK) != 0x06 || fetch8(mem, target) != 0xc3)
+        {
+            return 0;
+        }
+        bdos.entry = target;
+    }
+    // A changed jump is a program in front of the BDOS, a line rate wants the console timed
+    if (target != bdos.entry || cpu->sio.char_t_states != 0)
+    {
+        return 0;
+    }
+
+    bdos_result_t result = BDOS_DONE;
+    switch (cpu->registers.c)
+    {
+        case BDOS_CONSOLE_OUTPUT:
+            if ((result = console_break(cpu)) == BDOS_DONE)
+            {
+                tab_out(cpu, cpu->registers.e);
+            }
+            break;
+        case BDOS_PRINT_STRING:
+            if ((result = console_break(cpu)) != BDOS_DONE)
+            {
+                break;
+            }
+            for (uint32_t i = 0; i < 0x10000; i++)
+            {
+                uint8_t ch = read8(mem, (uint16_t)(cpu->registers.de + i));
+                if (ch == '$')
+                {
+                    break;
+                }
+                tab_out(cpu, ch);
+            }
+            break;
+        case BDOS_READ_BUFFER:
+            result = read_line(cpu);
+            break;
+        default:
+            return 0;
+    }
+    if (result == BDOS_WAITING)
+    {
+        return CYCLES_JMP;
+    }
+    if (result == BDOS_REBOOT)
+    {
+        cpu->registers.pc = 0x0000;
+        return CYCLES_JMP;
+    }
+    cpu->idle_polls = 0;
+
+    // Back to the caller with the BDOS's result, A = L and B = H, which is 0 for these
+    cpu->registers.hl = 0;
+    cpu->registers.a = 0;
+    cpu->registers.b = 0;
+    cpu->registers.pc = read16(mem, cpu->registers.sp);
+    cpu->registers.sp += 2;
+    return CYCLES_JMP + CYCLES_RET;
+}
+
+void i8080_bdos_reset(void)
+{
+    bdos = (i8080_bdos_t){0};
+}
+
+#else
+
+uint8_t i8080_bdos_trap(intel8080_t* cpu)
+{
+    (void)cpu;
+    return 0;
+}
+
+void i8080_bdos_reset(void)
+{
+}
+
+#endif
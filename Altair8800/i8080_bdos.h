@@ -0,0 +1,27 @@
+#ifndef _I8080_BDOS_H_
+#define _I8080_BDOS_H_
+
+#include "intel8080.h"
+
+// Native CP/M BDOS console functions, only built with ALTAIR_BDOS_TRAP. When the 8080 runs the
+// JMP at I8080_BDOS_VECTOR into the BDOS of the CP/M 2.2 that booted, console output (2), print
+// string (9) and read console buffer (10) are done in C against memory and the console, and the
+// CPU returns to the caller as from the BDOS. Other functions, and every call while a program
+// such as DDT has put itself in front of the BDOS, run the guest's code. Line editing follows
+// the BDOS (^H, DEL, ^E, ^R, ^U, ^X and ^C at the start of the line); the column tabs expand
+// to is the trap's own, so it can differ after output through the BIOS or function 1.
+#define I8080_BDOS_VECTOR 0x0005
+
+/**
+ * Run the BDOS function the guest called, from the JMP at I8080_BDOS_VECTOR
+ * Called from i8080_run and i8080_cycle, with the registers in cpu
+ *
+ * @return T-states taken, 0 when the guest's BDOS is to run instead. A read console buffer
+ *         still waiting for its line leaves PC at I8080_BDOS_VECTOR, to come back on.
+ */
+uint8_t i8080_bdos_trap(intel8080_t* cpu);
+
+// Forget the BDOS and any line being read, for a machine reset
+void i8080_bdos_reset(void);
+
+#endif
@@ -0,0 +1,82 @@
+#include "i8080_break.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ALTAIR_BREAKPOINTS
+i8080_break_t i8080_break = {0};
+
+static void update_armed(void)
+{
+    i8080_break.armed = i8080_break.pc_count != 0 || i8080_break.write_count != 0;
+}
+
+static bool set_bit(uint32_t* map, uint32_t* count, uint16_t address, bool set)
+{
+    uint32_t bit = 1u << (address & 31);
+    if (((map[address >> 5] & bit) != 0) == set)
+    {
+        return false;
+    }
+    map[address >> 5] ^= bit;
+    *count = set ? *count + 1 : *count - 1;
+    return true;
+}
+#endif
+
+const i8080_break_t* i8080_break_get(void)
+{
+#ifdef ALTAIR_BREAKPOINTS
+    return &i8080_break;
+#else
+    return NULL;
+#endif
+}
+
+bool i8080_break_set_pc(uint16_t address, bool set)
+{
+#ifdef ALTAIR_BREAKPOINTS
+    bool changed = set_bit(i8080_break.pc, &i8080_break.pc_count, address, set);
+    update_armed();
+    return changed;
+#else
+    (void)address;
+    (void)set;
+    return false;
+#endif
+}
+
+uint32_t i8080_break_set_write(uint16_t address, uint32_t length, bool set)
+{
+    uint32_t changed = 0;
+#ifdef ALTAIR_BREAKPOINTS
+    for (uint32_t i = 0; i < length && address + i <= 0xFFFF; i++)
+    {
+        changed += set_bit(i8080_break.write, &i8080_break.write_count, (uint16_t)(address + i), set);
+    }
+    update_armed();
+#else
+    (void)address;
+    (void)length;
+    (void)set;
+#endif
+    return changed;
+}
+
+void i8080_break_clear(I8080_BREAK_KIND kind)
+{
+#ifdef ALTAIR_BREAKPOINTS
+    if (kind == I8080_BREAK_PC)
+    {
+        memset(i8080_break.pc, 0, sizeof(i8080_break.pc));
+        i8080_break.pc_count = 0;
+    }
+    else if (kind == I8080_BREAK_WRITE)
+    {
+        memset(i8080_break.write, 0, sizeof(i8080_break.write));
+        i8080_break.write_count = 0;
+    }
+    update_armed();
+#else
+    (void)kind;
+#endif
+}
@@ -0,0 +1,56 @@
+#ifndef _I8080_BREAK_H_
+#define _I8080_BREAK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// PC breakpoints and memory write watchpoints, only built with ALTAIR_BREAKPOINTS. One bit per
+// address in two 8 KB bitmaps. i8080_run checks them only
+// while at least one is set: it then runs a separately built copy of its loop, so the normal
+// loop has no checks at all. A breakpoint stops the CPU before the instruction at its address,
+// a watchpoint after the instruction that wrote to its address. Writes by i8080_cycle (single
+// step, low power mode) and by I/O devices are not checked.
+#define I8080_BREAK_WORDS (64 * 1024 / 32)
+
+typedef enum
+{
+    I8080_BREAK_NONE = 0,
+    I8080_BREAK_PC,
+    I8080_BREAK_WRITE
+} I8080_BREAK_KIND;
+
+typedef struct
+{
+    uint32_t pc[I8080_BREAK_WORDS];    // Breakpoint bitmap
+    uint32_t write[I8080_BREAK_WORDS]; // Watchpoint bitmap
+    uint32_t pc_count;
+    uint32_t write_count;
+    bool armed;                        // Any breakpoint or watchpoint set
+    bool resume;                       // Stopped at a breakpoint, continuing runs its instruction
+    uint8_t hit;                       // I8080_BREAK_KIND that ended the last batch
+    uint16_t hit_address;              // Breakpoint or written address
+    uint16_t hit_pc;                   // Instruction that hit it
+} i8080_break_t;
+
+static inline bool i8080_break_test(const uint32_t* map, uint16_t address)
+{
+    return (map[address >> 5] >> (address & 31)) & 1;
+}
+
+#ifdef ALTAIR_BREAKPOINTS
+extern i8080_break_t i8080_break;
+#endif
+
+// Current breakpoints, or NULL when they are not compiled in
+const i8080_break_t* i8080_break_get(void);
+
+// Set or clear a breakpoint, false if nothing changed
+bool i8080_break_set_pc(uint16_t address, bool set);
+
+// Set or clear the watchpoints on [address, address + length), returns how many changed
+uint32_t i8080_break_set_write(uint16_t address, uint32_t length, bool set);
+
+// Remove every breakpoint (I8080_BREAK_PC) or every watchpoint (I8080_BREAK_WRITE)
+void i8080_break_clear(I8080_BREAK_KIND kind);
+
+#endif
@@ -0,0 +1,15 @@
+#include "i8080_duty.h"
+#include <stddef.h>
+
+#ifdef ALTAIR_PANEL_DUTY
+i8080_duty_t i8080_duty = {0};
+#endif
+
+const i8080_duty_t* i8080_duty_get(void)
+{
+#ifdef ALTAIR_PANEL_DUTY
+    return &i8080_duty;
+#else
+    return NULL;
+#endif
+}
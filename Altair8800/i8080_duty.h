@@ -0,0 +1,45 @@
+#ifndef _I8080_DUTY_H_
+#define _I8080_DUTY_H_
+
+#include <stdint.h>
+
+// Front panel duty cycle, only collected when built with ALTAIR_PANEL_DUTY. i8080_run samples
+// the opcode fetch on the bus every I8080_DUTY_CYCLES T-states and counts how often each address
+// and data line was high, so a count is that line's share of bus time. The counters only grow
+// and wrap: a panel takes the difference of two reads as each LED's brightness over that time,
+// without a lock.
+#ifndef I8080_DUTY_CYCLES
+#define I8080_DUTY_CYCLES 1024
+#endif
+
+typedef struct
+{
+    volatile uint32_t samples;     // Raised after the line counters of each sample
+    volatile uint32_t address[16]; // Samples with A0-A15 high
+    volatile uint32_t data[8];     // Samples with D0-D7 high
+    uint32_t countdown;            // Core 0: T-states to the next sample
+} i8080_duty_t;
+
+#ifdef ALTAIR_PANEL_DUTY
+
+extern i8080_duty_t i8080_duty;
+
+static inline void i8080_duty_sample(uint16_t address, uint8_t data)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        i8080_duty.address[i] += (address >> i) & 1;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        i8080_duty.data[i] += (data >> i) & 1;
+    }
+    i8080_duty.samples++;
+}
+
+#endif
+
+// Current counters, or NULL when duty sampling is not compiled in
+const i8080_duty_t* i8080_duty_get(void);
+
+#endif
@@ -0,0 +1,49 @@
+#include "i8080_heatmap.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ALTAIR_HEATMAP
+i8080_heatmap_t i8080_heatmap = {0};
+
+// Counters at the last i8080_heatmap_levels call
+static i8080_heatmap_t levels_seen = {0};
+#endif
+
+void i8080_heatmap_reset(void)
+{
+#ifdef ALTAIR_HEATMAP
+    memset(&i8080_heatmap, 0, sizeof(i8080_heatmap));
+#endif
+}
+
+const i8080_heatmap_t* i8080_heatmap_get(void)
+{
+#ifdef ALTAIR_HEATMAP
+    return &i8080_heatmap;
+#else
+    return NULL;
+#endif
+}
+
+bool i8080_heatmap_levels(uint8_t* levels)
+{
+#ifdef ALTAIR_HEATMAP
+    // Core 0 keeps counting while this runs, so each counter is read once. A counter below the
+    // last one was cleared by i8080_heatmap_reset in between
+    for (int kind = 0; kind < I8080_HEATMAP_KINDS; kind++)
+    {
+        for (int page = 0; page < 256; page++)
+        {
+            uint32_t count = ((volatile const uint32_t*)i8080_heatmap.count[kind])[page];
+            uint32_t seen = levels_seen.count[kind][page];
+            uint32_t increase = count >= seen ? count - seen : count;
+            levels_seen.count[kind][page] = count;
+            *levels++ = increase ? (uint8_t)(32 - __builtin_clz(increase)) : 0;
+        }
+    }
+    return true;
+#else
+    (void)levels;
+    return false;
+#endif
+}
@@ -0,0 +1,66 @@
+#ifndef _I8080_HEATMAP_H_
+#define _I8080_HEATMAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Guest memory access heatmap, only collected when built with ALTAIR_HEATMAP: read8 and write8
+// count the reads and writes of each 256-byte page, the cores the instructions that start in it.
+// Opcode and operand fetches go through fetch8 and are not reads. Only memory_main is counted.
+typedef enum
+{
+    I8080_HEATMAP_READ = 0,
+    I8080_HEATMAP_WRITE,
+    I8080_HEATMAP_EXECUTE,
+    I8080_HEATMAP_KINDS
+} I8080_HEATMAP_KIND;
+
+typedef struct
+{
+    uint32_t count[I8080_HEATMAP_KINDS][256]; // Accesses per kind and page (address >> 8)
+} i8080_heatmap_t;
+
+#ifdef ALTAIR_HEATMAP
+
+extern i8080_heatmap_t i8080_heatmap;
+
+#ifdef ALTAIR_SECOND_MACHINE
+struct memory_space;
+extern struct memory_space memory_main;
+#define I8080_HEATMAP_COUNT(mem, kind, address)                                                                        \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ((const struct memory_space*)(mem) == &memory_main)                                                         \
+        {                                                                                                              \
+            i8080_heatmap.count[kind][(uint16_t)(address) >> 8]++;                                                     \
+        }                                                                                                              \
+    } while (0)
+#else
+#define I8080_HEATMAP_COUNT(mem, kind, address) i8080_heatmap.count[kind][(uint16_t)(address) >> 8]++
+#endif
+
+#else
+
+#define I8080_HEATMAP_COUNT(mem, kind, address) ((void)0)
+
+#endif
+
+// Clear all counters
+void i8080_heatmap_reset(void);
+
+// Current counters, or NULL when the heatmap is not compiled in
+const i8080_heatmap_t* i8080_heatmap_get(void);
+
+// Size of the live map i8080_heatmap_levels fills, a byte per kind and page
+#define I8080_HEATMAP_LEVELS_SIZE (I8080_HEATMAP_KINDS * 256)
+
+/**
+ * Activity since the last call, for the browser's live map: per kind and page, in the order of
+ * i8080_heatmap_t, the bit length of the count's increase (0 for none, up to 32)
+ * Core 1 only
+ *
+ * @return false when the heatmap is not compiled in
+ */
+bool i8080_heatmap_levels(uint8_t* levels);
+
+#endif
@@ -0,0 +1,23 @@
+#include "i8080_profile.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ALTAIR_PROFILE
+i8080_profile_t i8080_profile = {0};
+#endif
+
+void i8080_profile_reset(void)
+{
+#ifdef ALTAIR_PROFILE
+    memset(&i8080_profile, 0, sizeof(i8080_profile));
+#endif
+}
+
+const i8080_profile_t* i8080_profile_get(void)
+{
+#ifdef ALTAIR_PROFILE
+    return &i8080_profile;
+#else
+    return NULL;
+#endif
+}
@@ -0,0 +1,47 @@
+#ifndef _I8080_PROFILE_H_
+#define _I8080_PROFILE_H_
+
+#include <stdint.h>
+
+// Guest execution profile, only collected when built with ALTAIR_PROFILE
+typedef struct
+{
+    uint64_t instructions;
+    uint64_t t_states;
+    uint32_t opcode[256];   // Executions per opcode
+    uint32_t page[256];     // Instruction fetches per 256-byte address bucket (PC >> 8)
+    uint32_t port_in[256];  // IN instructions per port
+    uint32_t port_out[256]; // OUT instructions per port
+} i8080_profile_t;
+
+#ifdef ALTAIR_PROFILE
+
+extern i8080_profile_t i8080_profile;
+
+#define I8080_PROFILE_OPCODE(pc, op)                                                                                   \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        i8080_profile.instructions++;                                                                                  \
+        i8080_profile.opcode[(uint8_t)(op)]++;                                                                         \
+        i8080_profile.page[(uint16_t)(pc) >> 8]++;                                                                     \
+    } while (0)
+#define I8080_PROFILE_T_STATES(t) i8080_profile.t_states += (t)
+#define I8080_PROFILE_PORT_IN(port) i8080_profile.port_in[(uint8_t)(port)]++
+#define I8080_PROFILE_PORT_OUT(port) i8080_profile.port_out[(uint8_t)(port)]++
+
+#else
+
+#define I8080_PROFILE_OPCODE(pc, op) ((void)0)
+#define I8080_PROFILE_T_STATES(t) ((void)0)
+#define I8080_PROFILE_PORT_IN(port) ((void)0)
+#define I8080_PROFILE_PORT_OUT(port) ((void)0)
+
+#endif
+
+// Clear all counters
+void i8080_profile_reset(void);
+
+// Current counters, or NULL when profiling is not compiled in
+const i8080_profile_t* i8080_profile_get(void);
+
+#endif
@@ -0,0 +1,31 @@
+#include "i8080_trace.h"
+#include <stddef.h>
+
+#ifdef ALTAIR_TRACE
+i8080_trace_t i8080_trace = {.enabled = true};
+#endif
+
+void i8080_trace_enable(bool enabled)
+{
+#ifdef ALTAIR_TRACE
+    i8080_trace.enabled = enabled;
+#else
+    (void)enabled;
+#endif
+}
+
+void i8080_trace_clear(void)
+{
+#ifdef ALTAIR_TRACE
+    i8080_trace.head = 0;
+#endif
+}
+
+const i8080_trace_t* i8080_trace_get(void)
+{
+#ifdef ALTAIR_TRACE
+    return &i8080_trace;
+#else
+    return NULL;
+#endif
+}
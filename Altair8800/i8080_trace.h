@@ -0,0 +1,59 @@
+#ifndef _I8080_TRACE_H_
+#define _I8080_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Execution history, only recorded when built with ALTAIR_TRACE. Every instruction the 8080
+// starts, in i8080_run and i8080_cycle alike, writes one entry with the state it began with.
+// Entries stay binary in a ring of the last I8080_TRACE_ENTRIES, the HISTORY monitor command
+// decodes them once the CPU is stopped.
+#ifndef I8080_TRACE_ENTRIES
+#define I8080_TRACE_ENTRIES 2048 // Power of two
+#endif
+
+typedef struct
+{
+    uint16_t pc;
+    uint16_t sp;
+    uint8_t opcode;
+    uint8_t operand; // Byte after the opcode
+    uint8_t a;
+    uint8_t flags;
+} i8080_trace_entry_t;
+
+typedef struct
+{
+    bool enabled;  // Runtime switch, read once per i8080_run batch
+    uint32_t head; // Entries recorded since the last clear, wraps at 2^32
+    i8080_trace_entry_t entries[I8080_TRACE_ENTRIES];
+} i8080_trace_t;
+
+#ifdef ALTAIR_TRACE
+
+extern i8080_trace_t i8080_trace;
+
+static inline void i8080_trace_record(uint16_t pc, uint8_t opcode, uint8_t operand, uint8_t a, uint8_t flags,
+                                      uint16_t sp)
+{
+    i8080_trace_entry_t* entry = &i8080_trace.entries[i8080_trace.head++ & (I8080_TRACE_ENTRIES - 1)];
+    entry->pc = pc;
+    entry->sp = sp;
+    entry->opcode = opcode;
+    entry->operand = operand;
+    entry->a = a;
+    entry->flags = flags;
+}
+
+#endif
+
+// Start or stop recording, the history recorded so far is kept
+void i8080_trace_enable(bool enabled);
+
+// Forget the recorded history
+void i8080_trace_clear(void);
+
+// Current ring, or NULL when the trace is not compiled in
+const i8080_trace_t* i8080_trace_get(void);
+
+#endif
@@ -13,6 +13,12 @@
 #endif
 
 #include "memory.h"
+#include "i8080_basic_fp.h"
+#include "i8080_bdos.h"
+#include "i8080_break.h"
+#include "i8080_duty.h"
+#include "i8080_profile.h"
+#include "i8080_trace.h"
 
 // Performance optimization macros
 #define LIKELY(x)   __builtin_expect(!!(x), 1)
@@ -20,6 +26,41 @@
 #define CHECK_CARRY(a, b) ((a + b) > 0xff)
 #define CHECK_HALF_CARRY(a, b) (((a & 0xf) + (b & 0xf)) > 0xf)
 
+// The profile, duty cycle, trace and breakpoint hooks belong to the monitor and front panel of
+// the machine in memory_main, a second machine runs without them
+#ifdef ALTAIR_SECOND_MACHINE
+#define I8080_PRIMARY(cpu) ((cpu)->memory == &memory_main)
+#else
+#define I8080_PRIMARY(cpu) true
+#endif
+
+// With ALTAIR_SRAM_PLACEMENT the batch loop, i8080_cycle, the opcode handlers and the tables they
+// read every instruction are copied to SRAM at boot, so the interpreter never waits on the XIP cache.
+// The tables lose their const for that, as const data stays in flash.
+#ifdef ALTAIR_INTERP
+#include "hardware/interp.h"
+#endif
+
+#ifdef ALTAIR_SRAM_PLACEMENT
+#include "pico.h"
+#define I8080_IN_RAM __not_in_flash("i8080")
+#define I8080_TABLE
+#else
+#define I8080_IN_RAM
+#define I8080_TABLE const
+#endif
+
+// Opcode handlers receive the opcode so the threaded core can pass it as a constant.
+// In the threaded core every handler is force-inlined into its own dispatch slot, which
+// folds the DESTINATION()/SOURCE()/RP() decoding and the register switch statements away.
+// Handlers that never read op_code mark it I8080_UNUSED.
+#ifdef ALTAIR_THREADED_CORE
+#define I8080_HANDLER static inline __attribute__((always_inline))
+#else
+#define I8080_HANDLER static I8080_IN_RAM
+#endif
+#define I8080_UNUSED __attribute__((unused))
+
 // define CPU stats LEDs
 #define STATUS_MEMORY_READ		0x80
 #define STATUS_PORT_INPUT		0x40
@@ -31,7 +72,7 @@
 #define STATUS_INTERRUPT		0x01
 
 // Fast parity lookup table
-static const uint8_t parity_table[256] = {
+static I8080_TABLE uint8_t parity_table[256] = {
 	1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
 	0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
 	0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
@@ -61,65 +102,133 @@ uint8_t get_parity(uint8_t val)
 }
 
 // Forward declarations for jump table
-static uint8_t i8080_nop(intel8080_t *cpu);
-static uint8_t i8080_lxi(intel8080_t *cpu);
-static uint8_t i8080_stax(intel8080_t *cpu);
-static uint8_t i8080_inx(intel8080_t *cpu);
-static uint8_t i8080_inr(intel8080_t *cpu);
-static uint8_t i8080_dcr(intel8080_t *cpu);
-static uint8_t i8080_mvi(intel8080_t *cpu);
-static uint8_t i8080_rlc(intel8080_t *cpu);
-static uint8_t i8080_dad(intel8080_t *cpu);
-static uint8_t i8080_ldax(intel8080_t *cpu);
-static uint8_t i8080_dcx(intel8080_t *cpu);
-static uint8_t i8080_rrc(intel8080_t *cpu);
-static uint8_t i8080_ral(intel8080_t *cpu);
-static uint8_t i8080_rar(intel8080_t *cpu);
-static uint8_t i8080_shld(intel8080_t *cpu);
-static uint8_t i8080_daa(intel8080_t *cpu);
-static uint8_t i8080_lhld(intel8080_t *cpu);
-static uint8_t i8080_cma(intel8080_t *cpu);
-static uint8_t i8080_lda(intel8080_t *cpu);
-static uint8_t i8080_sta(intel8080_t *cpu);
-static uint8_t i8080_stc(intel8080_t *cpu);
-static uint8_t i8080_cmc(intel8080_t *cpu);
-static uint8_t i8080_mov(intel8080_t *cpu);
-static uint8_t i8080_add(intel8080_t *cpu);
-static uint8_t i8080_adc(intel8080_t *cpu);
-static uint8_t i8080_sub(intel8080_t *cpu);
-static uint8_t i8080_sbb(intel8080_t *cpu);
-static uint8_t i8080_ana(intel8080_t *cpu);
-static uint8_t i8080_xra(intel8080_t *cpu);
-static uint8_t i8080_ora(intel8080_t *cpu);
-static uint8_t i8080_cmp(intel8080_t *cpu);
-static uint8_t i8080_rccc(intel8080_t *cpu);
-static uint8_t i8080_pop(intel8080_t *cpu);
-static uint8_t i8080_jccc(intel8080_t *cpu);
-static uint8_t i8080_jmp(intel8080_t *cpu);
-static uint8_t i8080_cccc(intel8080_t *cpu);
-static uint8_t i8080_push(intel8080_t *cpu);
-static uint8_t i8080_adi(intel8080_t *cpu);
-static uint8_t i8080_rst(intel8080_t *cpu);
-static uint8_t i8080_ret(intel8080_t *cpu);
-static uint8_t i8080_call(intel8080_t *cpu);
-static uint8_t i8080_aci(intel8080_t *cpu);
-static uint8_t i8080_out(intel8080_t *cpu);
-static uint8_t i8080_sui(intel8080_t *cpu);
-static uint8_t i8080_in(intel8080_t *cpu);
-static uint8_t i8080_sbi(intel8080_t *cpu);
-static uint8_t i8080_xthl(intel8080_t *cpu);
-static uint8_t i8080_ani(intel8080_t *cpu);
-static uint8_t i8080_pchl(intel8080_t *cpu);
-static uint8_t i8080_xchg(intel8080_t *cpu);
-static uint8_t i8080_xri(intel8080_t *cpu);
-static uint8_t i8080_di(intel8080_t *cpu);
-static uint8_t i8080_ori(intel8080_t *cpu);
-static uint8_t i8080_sphl(intel8080_t *cpu);
-static uint8_t i8080_ei(intel8080_t *cpu);
-static uint8_t i8080_cpi(intel8080_t *cpu);
-
+I8080_HANDLER uint8_t i8080_nop(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_lxi(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_stax(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_inx(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_inr(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_dcr(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_mvi(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_rlc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_dad(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ldax(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_dcx(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_rrc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ral(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_rar(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_shld(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_daa(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_lhld(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_cma(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_lda(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_sta(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_stc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_cmc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_mov(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_add(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_adc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_sub(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_sbb(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ana(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_xra(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ora(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_cmp(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_rccc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_pop(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_jccc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_jmp(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_cccc(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_push(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_adi(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_rst(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ret(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_call(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_aci(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_out(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_sui(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_in(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_sbi(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_xthl(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ani(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_pchl(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_xchg(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_xri(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_di(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ori(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_sphl(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_ei(intel8080_t *cpu, uint8_t op_code);
+I8080_HANDLER uint8_t i8080_cpi(intel8080_t *cpu, uint8_t op_code);
+
+#ifdef ALTAIR_THREADED_CORE
+// Opcode -> handler map for the threaded core (undefined opcodes and HLT behave as NOP)
+#define I8080_OPCODE_LIST(X) \
+	X(0x00, nop) X(0x01, lxi) X(0x02, stax) X(0x03, inx) \
+	X(0x04, inr) X(0x05, dcr) X(0x06, mvi) X(0x07, rlc) \
+	X(0x08, nop) X(0x09, dad) X(0x0a, ldax) X(0x0b, dcx) \
+	X(0x0c, inr) X(0x0d, dcr) X(0x0e, mvi) X(0x0f, rrc) \
+	X(0x10, nop) X(0x11, lxi) X(0x12, stax) X(0x13, inx) \
+	X(0x14, inr) X(0x15, dcr) X(0x16, mvi) X(0x17, ral) \
+	X(0x18, nop) X(0x19, dad) X(0x1a, ldax) X(0x1b, dcx) \
+	X(0x1c, inr) X(0x1d, dcr) X(0x1e, mvi) X(0x1f, rar) \
+	X(0x20, nop) X(0x21, lxi) X(0x22, shld) X(0x23, inx) \
+	X(0x24, inr) X(0x25, dcr) X(0x26, mvi) X(0x27, daa) \
+	X(0x28, nop) X(0x29, dad) X(0x2a, lhld) X(0x2b, dcx) \
+	X(0x2c, inr) X(0x2d, dcr) X(0x2e, mvi) X(0x2f, cma) \
+	X(0x30, nop) X(0x31, lxi) X(0x32, sta) X(0x33, inx) \
+	X(0x34, inr) X(0x35, dcr) X(0x36, mvi) X(0x37, stc) \
+	X(0x38, nop) X(0x39, dad) X(0x3a, lda) X(0x3b, dcx) \
+	X(0x3c, inr) X(0x3d, dcr) X(0x3e, mvi) X(0x3f, cmc) \
+	X(0x40, mov) X(0x41, mov) X(0x42, mov) X(0x43, mov) \
+	X(0x44, mov) X(0x45, mov) X(0x46, mov) X(0x47, mov) \
+	X(0x48, mov) X(0x49, mov) X(0x4a, mov) X(0x4b, mov) \
+	X(0x4c, mov) X(0x4d, mov) X(0x4e, mov) X(0x4f, mov) \
+	X(0x50, mov) X(0x51, mov) X(0x52, mov) X(0x53, mov) \
+	X(0x54, mov) X(0x55, mov) X(0x56, mov) X(0x57, mov) \
+	X(0x58, mov) X(0x59, mov) X(0x5a, mov) X(0x5b, mov) \
+	X(0x5c, mov) X(0x5d, mov) X(0x5e, mov) X(0x5f, mov) \
+	X(0x60, mov) X(0x61, mov) X(0x62, mov) X(0x63, mov) \
+	X(0x64, mov) X(0x65, mov) X(0x66, mov) X(0x67, mov) \
+	X(0x68, mov) X(0x69, mov) X(0x6a, mov) X(0x6b, mov) \
+	X(0x6c, mov) X(0x6d, mov) X(0x6e, mov) X(0x6f, mov) \
+	X(0x70, mov) X(0x71, mov) X(0x72, mov) X(0x73, mov) \
+	X(0x74, mov) X(0x75, mov) X(0x76, nop) X(0x77, mov) \
+	X(0x78, mov) X(0x79, mov) X(0x7a, mov) X(0x7b, mov) \
+	X(0x7c, mov) X(0x7d, mov) X(0x7e, mov) X(0x7f, mov) \
+	X(0x80, add) X(0x81, add) X(0x82, add) X(0x83, add) \
+	X(0x84, add) X(0x85, add) X(0x86, add) X(0x87, add) \
+	X(0x88, adc) X(0x89, adc) X(0x8a, adc) X(0x8b, adc) \
+	X(0x8c, adc) X(0x8d, adc) X(0x8e, adc) X(0x8f, adc) \
+	X(0x90, sub) X(0x91, sub) X(0x92, sub) X(0x93, sub) \
+	X(0x94, sub) X(0x95, sub) X(0x96, sub) X(0x97, sub) \
+	X(0x98, sbb) X(0x99, sbb) X(0x9a, sbb) X(0x9b, sbb) \
+	X(0x9c, sbb) X(0x9d, sbb) X(0x9e, sbb) X(0x9f, sbb) \
+	X(0xa0, ana) X(0xa1, ana) X(0xa2, ana) X(0xa3, ana) \
+	X(0xa4, ana) X(0xa5, ana) X(0xa6, ana) X(0xa7, ana) \
+	X(0xa8, xra) X(0xa9, xra) X(0xaa, xra) X(0xab, xra) \
+	X(0xac, xra) X(0xad, xra) X(0xae, xra) X(0xaf, xra) \
+	X(0xb0, ora) X(0xb1, ora) X(0xb2, ora) X(0xb3, ora) \
+	X(0xb4, ora) X(0xb5, ora) X(0xb6, ora) X(0xb7, ora) \
+	X(0xb8, cmp) X(0xb9, cmp) X(0xba, cmp) X(0xbb, cmp) \
+	X(0xbc, cmp) X(0xbd, cmp) X(0xbe, cmp) X(0xbf, cmp) \
+	X(0xc0, rccc) X(0xc1, pop) X(0xc2, jccc) X(0xc3, jmp) \
+	X(0xc4, cccc) X(0xc5, push) X(0xc6, adi) X(0xc7, rst) \
+	X(0xc8, rccc) X(0xc9, ret) X(0xca, jccc) X(0xcb, nop) \
+	X(0xcc, cccc) X(0xcd, call) X(0xce, aci) X(0xcf, rst) \
+	X(0xd0, rccc) X(0xd1, pop) X(0xd2, jccc) X(0xd3, out) \
+	X(0xd4, cccc) X(0xd5, push) X(0xd6, sui) X(0xd7, rst) \
+	X(0xd8, rccc) X(0xd9, nop) X(0xda, jccc) X(0xdb, in) \
+	X(0xdc, cccc) X(0xdd, nop) X(0xde, sbi) X(0xdf, rst) \
+	X(0xe0, rccc) X(0xe1, pop) X(0xe2, jccc) X(0xe3, xthl) \
+	X(0xe4, cccc) X(0xe5, push) X(0xe6, ani) X(0xe7, rst) \
+	X(0xe8, rccc) X(0xe9, pchl) X(0xea, jccc) X(0xeb, xchg) \
+	X(0xec, cccc) X(0xed, nop) X(0xee, xri) X(0xef, rst) \
+	X(0xf0, rccc) X(0xf1, pop) X(0xf2, jccc) X(0xf3, di) \
+	X(0xf4, cccc) X(0xf5, push) X(0xf6, ori) X(0xf7, rst) \
+	X(0xf8, rccc) X(0xf9, sphl) X(0xfa, jccc) X(0xfb, ei) \
+	X(0xfc, cccc) X(0xfd, nop) X(0xfe, cpi) X(0xff, rst)
+#else
 // Jump table for fast opcode dispatch
-static uint8_t (*const opcode_handlers[256])(intel8080_t *cpu) = {
+static uint8_t (*I8080_TABLE opcode_handlers[256])(intel8080_t *cpu, uint8_t op_code) = {
 	[0x00] = i8080_nop,    [0x01] = i8080_lxi,    [0x02] = i8080_stax,   [0x03] = i8080_inx,
 	[0x04] = i8080_inr,    [0x05] = i8080_dcr,    [0x06] = i8080_mvi,    [0x07] = i8080_rlc,
 	[0x08] = NULL,         [0x09] = i8080_dad,    [0x0a] = i8080_ldax,   [0x0b] = i8080_dcx,
@@ -185,11 +294,13 @@ static uint8_t (*const opcode_handlers[256])(intel8080_t *cpu) = {
 	[0xf8] = i8080_rccc,   [0xf9] = i8080_sphl,   [0xfa] = i8080_jccc,   [0xfb] = i8080_ei,
 	[0xfc] = i8080_cccc,   [0xfd] = NULL,         [0xfe] = i8080_cpi,    [0xff] = i8080_rst
 };
+#endif
 
-void i8080_reset(intel8080_t *cpu, port_in in, port_out out, read_sense_switches sense,
+void i8080_reset(intel8080_t *cpu, memory_space_t *memory, port_in in, port_out out, read_sense_switches sense,
 			 disk_controller_t *disk_controller, io_port_in_fn io_in, io_port_out_fn io_out)
 {
 	memset(cpu, 0, sizeof(intel8080_t));
+	cpu->memory = memory;
 	cpu->term_in = in;
 	cpu->term_out = out;
 	cpu->io_port_in_handler = io_in;
@@ -198,6 +309,9 @@ void i8080_reset(intel8080_t *cpu, port_in in, port_out out, read_sense_switches
 	cpu->registers.flags = 0x2;
 	cpu->sense = sense;
 	cpu->cpuStatus = 0x00;
+	i8080_sio_set_baud(cpu, I8080_SIO_BAUD);
+	if (I8080_PRIMARY(cpu))
+		i8080_bdos_reset();
 }
 
 static inline void i8080_update_flag_bit(intel8080_t *cpu, uint8_t flag, int condition)
@@ -222,13 +336,13 @@ static inline void i8080_clear_flag(intel8080_t *cpu, uint8_t flag)
 static inline void i8080_mwrite(intel8080_t *cpu)
 {
 	cpu->cpuStatus &= ~(STATUS_MEMORY_READ);
-	write8(cpu->address_bus, cpu->data_bus);
+	write8(cpu->memory, cpu->address_bus, cpu->data_bus);
 }
 
 static inline void i8080_mread(intel8080_t *cpu)
 {
 	cpu->cpuStatus |= STATUS_MEMORY_READ;
-	cpu->data_bus = read8(cpu->address_bus);
+	cpu->data_bus = read8(cpu->memory, cpu->address_bus);
 }
 
 static inline void i8080_pairwrite(intel8080_t *cpu, uint8_t pair, uint16_t val)
@@ -329,7 +443,7 @@ static inline uint8_t i8080_regread(intel8080_t *cpu, uint8_t reg)
 	}
 }
 
-uint8_t i8080_check_condition(intel8080_t *cpu, uint8_t condition)
+I8080_IN_RAM uint8_t i8080_check_condition(intel8080_t *cpu, uint8_t condition)
 {
 	switch(condition)
 	{
@@ -357,13 +471,13 @@ void i8080_examine(intel8080_t *cpu, uint16_t address)
 {
 	// Jump to the supplied address
 	cpu->registers.pc = cpu->address_bus = address;
-	cpu->data_bus = read8(cpu->address_bus);
+	cpu->data_bus = read8(cpu->memory, cpu->address_bus);
 }
 
 void i8080_examine_next(intel8080_t *cpu)
 {
 	cpu->address_bus++;
-	cpu->data_bus = read8(cpu->address_bus);
+	cpu->data_bus = read8(cpu->memory, cpu->address_bus);
 }
 
 void i8080_deposit(intel8080_t *cpu, uint8_t data)
@@ -379,7 +493,7 @@ void i8080_deposit_next(intel8080_t *cpu, uint8_t data)
 	i8080_mwrite(cpu);
 }
 
-void i8080_update_flags(intel8080_t *cpu, uint8_t reg, uint8_t mask)
+I8080_IN_RAM void i8080_update_flags(intel8080_t *cpu, uint8_t reg, uint8_t mask)
 {
 	uint8_t val = i8080_regread(cpu, reg);
 	
@@ -394,7 +508,7 @@ void i8080_update_flags(intel8080_t *cpu, uint8_t reg, uint8_t mask)
 	}
 }
 
-void i8080_gensub(intel8080_t *cpu, uint16_t val)
+I8080_IN_RAM void i8080_gensub(intel8080_t *cpu, uint16_t val)
 {
 	uint16_t a, b;
 	// Subtract by adding with two-complement of val. Carry-flag meaning becomes inverted since we add.
@@ -410,17 +524,17 @@ void i8080_gensub(intel8080_t *cpu, uint16_t val)
 	i8080_update_flags(cpu, REGISTER_A, FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY | FLAGS_CARRY | FLAGS_H);
 }
 
-void i8080_compare(intel8080_t *cpu, uint8_t val)
+I8080_IN_RAM void i8080_compare(intel8080_t *cpu, uint8_t val)
 {
 	uint8_t tmp_a = cpu->registers.a;
 	i8080_gensub(cpu, val);
 	cpu->registers.a = tmp_a;
 }
 
-static uint8_t i8080_mov(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_mov(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t dest = DESTINATION(cpu->current_op_code);
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t dest = DESTINATION(op_code);
+	uint8_t source = SOURCE(op_code);
 	uint8_t val;
 	uint8_t cycles;
 
@@ -436,9 +550,9 @@ static uint8_t i8080_mov(intel8080_t *cpu)
 	return cycles;
 }
 
-static uint8_t i8080_mvi(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_mvi(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t dest = DESTINATION(cpu->current_op_code);
+	uint8_t dest = DESTINATION(op_code);
 	uint8_t cycles;
 
 	if(dest == MEMORY_ACCESS)
@@ -446,26 +560,26 @@ static uint8_t i8080_mvi(intel8080_t *cpu)
 	else
 		cycles = CYCLES_MVI_REG;
 
-	i8080_regwrite(cpu, dest, read8(cpu->registers.pc+1));
+	i8080_regwrite(cpu, dest, read8(cpu->memory, cpu->registers.pc+1));
 
 	cpu->registers.pc+=2;
 
 	return cycles;
 }
 
-static uint8_t i8080_lxi(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_lxi(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t pair = RP(cpu->current_op_code);
+	uint8_t pair = RP(op_code);
 
-	i8080_pairwrite(cpu, pair, read16(cpu->registers.pc+1));
+	i8080_pairwrite(cpu, pair, read16(cpu->memory, cpu->registers.pc+1));
 	cpu->registers.pc+=3;
 
 	return CYCLES_LXI;
 }
 
-uint8_t i8080_lda(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_lda(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	cpu->address_bus = read16(cpu->registers.pc+1);
+	cpu->address_bus = read16(cpu->memory, cpu->registers.pc+1);
 	i8080_mread(cpu);
 	cpu->registers.a = cpu->data_bus;
 
@@ -473,9 +587,9 @@ uint8_t i8080_lda(intel8080_t *cpu)
 	return CYCLES_LDA;
 }
 
-uint8_t i8080_sta(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_sta(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	cpu->address_bus = read16(cpu->registers.pc+1);
+	cpu->address_bus = read16(cpu->memory, cpu->registers.pc+1);
 	cpu->data_bus = cpu->registers.a;
 	i8080_mwrite(cpu);
 
@@ -483,40 +597,40 @@ uint8_t i8080_sta(intel8080_t *cpu)
 	return CYCLES_STA;
 }
 
-uint8_t i8080_lhld(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_lhld(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	cpu->registers.hl = read16(read16(cpu->registers.pc+1));
+	cpu->registers.hl = read16(cpu->memory, read16(cpu->memory, cpu->registers.pc+1));
 	cpu->registers.pc+=3;
 	return CYCLES_LHLD;
 }
 
-uint8_t i8080_shld(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_shld(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	write16(read16(cpu->registers.pc+1), cpu->registers.hl);
+	write16(cpu->memory, read16(cpu->memory, cpu->registers.pc+1), cpu->registers.hl);
 	cpu->registers.pc+=3;
 	return CYCLES_SHLD;
 }
 
 // TODO: only BC and DE allowed for indirect
-uint8_t i8080_ldax(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ldax(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t pair = RP(cpu->current_op_code);
+	uint8_t pair = RP(op_code);
 
-	cpu->registers.a = read8(i8080_pairread(cpu, pair));
+	cpu->registers.a = read8(cpu->memory, i8080_pairread(cpu, pair));
 	cpu->registers.pc++;
 	return CYCLES_LDAX;
 }
 
 // TODO: only BC and DE allowed for indirect
-uint8_t i8080_stax(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_stax(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t pair = RP(cpu->current_op_code);
-	write8(i8080_pairread(cpu, pair), cpu->registers.a);
+	uint8_t pair = RP(op_code);
+	write8(cpu->memory, i8080_pairread(cpu, pair), cpu->registers.a);
 	cpu->registers.pc++;
 	return CYCLES_STAX;
 }
 
-uint8_t i8080_xchg(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_xchg(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint16_t tmp = cpu->registers.hl;
 	cpu->registers.hl = cpu->registers.de;
@@ -526,7 +640,7 @@ uint8_t i8080_xchg(intel8080_t *cpu)
 	return CYCLES_XCHG;
 }
 
-void i8080_genadd(intel8080_t *cpu, uint16_t val)
+I8080_IN_RAM void i8080_genadd(intel8080_t *cpu, uint16_t val)
 {
 	uint8_t a = cpu->registers.a;
 
@@ -539,38 +653,38 @@ void i8080_genadd(intel8080_t *cpu, uint16_t val)
 }
 
 
-uint8_t i8080_add(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_add(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t source = SOURCE(op_code);
 	uint8_t val = i8080_regread(cpu, source);
 	i8080_genadd(cpu, val);
 	cpu->registers.pc++;
-	return CYCLES_ADD;
+	return source == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_ADD;
 }
 
-uint8_t i8080_adi(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_adi(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	i8080_genadd(cpu, read8(cpu->registers.pc+1));
+	i8080_genadd(cpu, read8(cpu->memory, cpu->registers.pc+1));
 	cpu->registers.pc+=2;
 	return CYCLES_ADI;
 }
 
-uint8_t i8080_adc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_adc(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t source = SOURCE(op_code);
 	uint16_t val = i8080_regread(cpu, source);
 
 	if(cpu->registers.flags & FLAGS_CARRY)
 		val++;
 	i8080_genadd(cpu, val);
 	cpu->registers.pc++;
-	return CYCLES_ADC;
+	return source == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_ADC;
 }
 
-uint8_t i8080_aci(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_aci(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint16_t val;
-	val = read8(cpu->registers.pc+1);
+	val = read8(cpu->memory, cpu->registers.pc+1);
 	if(cpu->registers.flags & FLAGS_CARRY)
 		val++;
 	i8080_genadd(cpu, val);
@@ -578,25 +692,25 @@ uint8_t i8080_aci(intel8080_t *cpu)
 	return CYCLES_ACI;
 }
 
-uint8_t i8080_sub(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_sub(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t source = SOURCE(op_code);
 	uint8_t val = i8080_regread(cpu, source);
 	i8080_gensub(cpu, val);
 	cpu->registers.pc++;
-	return CYCLES_SUB;
+	return source == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_SUB;
 }
 
-uint8_t i8080_sui(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_sui(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	i8080_gensub(cpu, read8(cpu->registers.pc+1));
+	i8080_gensub(cpu, read8(cpu->memory, cpu->registers.pc+1));
 	cpu->registers.pc+=2;
 	return CYCLES_SUI;
 }
 
-uint8_t i8080_sbb(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_sbb(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t source = SOURCE(op_code);
 	uint16_t val = i8080_regread(cpu, source);
 
 	if(cpu->registers.flags & FLAGS_CARRY)
@@ -604,13 +718,13 @@ uint8_t i8080_sbb(intel8080_t *cpu)
 
 	i8080_gensub(cpu, val);
 	cpu->registers.pc++;
-	return CYCLES_SBB;
+	return source == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_SBB;
 }
 
-uint8_t i8080_sbi(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_sbi(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint16_t val;
-	val = read8(cpu->registers.pc+1);
+	val = read8(cpu->memory, cpu->registers.pc+1);
 	if(cpu->registers.flags & FLAGS_CARRY)
 		val++;
 	i8080_gensub(cpu, val);
@@ -618,9 +732,9 @@ uint8_t i8080_sbi(intel8080_t *cpu)
 	return CYCLES_SBI;
 }
 
-uint8_t i8080_inr(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_inr(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t dest = DESTINATION(cpu->current_op_code);
+	uint8_t dest = DESTINATION(op_code);
 	uint8_t val = i8080_regread(cpu, dest);
 
 	i8080_update_flag_bit(cpu, FLAGS_H, CHECK_HALF_CARRY(val, 1));
@@ -629,12 +743,12 @@ uint8_t i8080_inr(intel8080_t *cpu)
 
 	i8080_update_flags(cpu, dest, FLAGS_ZERO | FLAGS_PARITY | FLAGS_SIGN | FLAGS_H);
 	cpu->registers.pc++;
-	return CYCLES_INR;
+	return dest == MEMORY_ACCESS ? CYCLES_INR_MEM : CYCLES_INR;
 }
 
-uint8_t i8080_dcr(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_dcr(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t dest = DESTINATION(cpu->current_op_code);
+	uint8_t dest = DESTINATION(op_code);
 	uint8_t val = i8080_regread(cpu, dest);
 
 	i8080_update_flag_bit(cpu, FLAGS_H, CHECK_HALF_CARRY(val, 0xff));
@@ -642,28 +756,28 @@ uint8_t i8080_dcr(intel8080_t *cpu)
 	i8080_regwrite(cpu, dest, val + 0xff);
 	i8080_update_flags(cpu, dest, FLAGS_ZERO | FLAGS_PARITY | FLAGS_SIGN | FLAGS_H);
 	cpu->registers.pc++;
-	return CYCLES_DCR;
+	return dest == MEMORY_ACCESS ? CYCLES_DCR_MEM : CYCLES_DCR;
 }
 
-uint8_t i8080_inx(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_inx(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t rp = RP(cpu->current_op_code);
+	uint8_t rp = RP(op_code);
 	i8080_pairwrite(cpu, rp, i8080_pairread(cpu, rp) + 1);
 	cpu->registers.pc++;
 	return CYCLES_INX;
 }
 
-uint8_t i8080_dcx(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_dcx(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t rp = RP(cpu->current_op_code);
+	uint8_t rp = RP(op_code);
 	cpu->registers.pc++;
 	i8080_pairwrite(cpu, rp, i8080_pairread(cpu, rp) - 1);
 	return CYCLES_DCX;
 }
 
-uint8_t i8080_dad(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_dad(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t rp = RP(cpu->current_op_code);
+	uint8_t rp = RP(op_code);
 	uint32_t val = i8080_pairread(cpu, rp);
 	val += i8080_pairread(cpu, PAIR_HL);
 
@@ -679,21 +793,21 @@ uint8_t i8080_dad(intel8080_t *cpu)
 	return CYCLES_DAD;
 }
 
-uint8_t i8080_ana(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ana(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t source = SOURCE(op_code);
 
 	cpu->registers.a &= i8080_regread(cpu, source);
 	i8080_clear_flag(cpu, FLAGS_CARRY);
 	i8080_update_flags(cpu, REGISTER_A, FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY | FLAGS_CARRY | FLAGS_H);
 
 	cpu->registers.pc++;
-	return CYCLES_ANA;
+	return source == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_ANA;
 }
 
-uint8_t i8080_ani(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ani(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	cpu->registers.a &= read8(cpu->registers.pc+1);
+	cpu->registers.a &= read8(cpu->memory, cpu->registers.pc+1);
 	i8080_clear_flag(cpu, FLAGS_CARRY);
 	i8080_clear_flag(cpu, FLAGS_H);
 	i8080_update_flags(cpu, REGISTER_A, FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY | FLAGS_CARRY | FLAGS_H);
@@ -702,9 +816,9 @@ uint8_t i8080_ani(intel8080_t *cpu)
 	return CYCLES_ANI;
 }
 
-uint8_t i8080_ora(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ora(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t source = SOURCE(op_code);
 
 	cpu->registers.a |= i8080_regread(cpu, source);
 	i8080_clear_flag(cpu, FLAGS_CARRY);
@@ -712,12 +826,12 @@ uint8_t i8080_ora(intel8080_t *cpu)
 	i8080_update_flags(cpu, REGISTER_A, FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY | FLAGS_CARRY | FLAGS_H);
 
 	cpu->registers.pc++;
-	return CYCLES_ORA;
+	return source == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_ORA;
 }
 
-uint8_t i8080_ori(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ori(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	cpu->registers.a |= read8(cpu->registers.pc+1);
+	cpu->registers.a |= read8(cpu->memory, cpu->registers.pc+1);
 	i8080_clear_flag(cpu, FLAGS_CARRY);
 	i8080_clear_flag(cpu, FLAGS_H);
 	i8080_update_flags(cpu, REGISTER_A, FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY | FLAGS_CARRY | FLAGS_H);
@@ -726,9 +840,9 @@ uint8_t i8080_ori(intel8080_t *cpu)
 	return CYCLES_ORI;
 }
 
-uint8_t i8080_xra(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_xra(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t source = SOURCE(cpu->current_op_code);
+	uint8_t source = SOURCE(op_code);
 
 	cpu->registers.a ^= i8080_regread(cpu, source);
 	i8080_clear_flag(cpu, FLAGS_CARRY);
@@ -736,12 +850,12 @@ uint8_t i8080_xra(intel8080_t *cpu)
 	i8080_update_flags(cpu, REGISTER_A, FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY | FLAGS_CARRY | FLAGS_H);
 
 	cpu->registers.pc++;
-	return CYCLES_XRA;
+	return source == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_XRA;
 }
 
-uint8_t i8080_xri(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_xri(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	cpu->registers.a ^= read8(cpu->registers.pc+1);
+	cpu->registers.a ^= read8(cpu->memory, cpu->registers.pc+1);
 	i8080_clear_flag(cpu, FLAGS_CARRY);
 	i8080_clear_flag(cpu, FLAGS_H);
 	i8080_update_flags(cpu, REGISTER_A, FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY | FLAGS_CARRY | FLAGS_H);
@@ -750,50 +864,142 @@ uint8_t i8080_xri(intel8080_t *cpu)
 	return CYCLES_XRI;
 }
 
-uint8_t i8080_ei(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ei(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->registers.pc++;
 	i8080_set_flag(cpu, FLAGS_IF);
+	cpu->ei_pending = true;
 	return CYCLES_EI;
 }
 
-uint8_t i8080_di(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_di(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->registers.pc++;
 	i8080_clear_flag(cpu, FLAGS_IF);
 	return CYCLES_DI;
 }
 
-uint8_t i8080_xthl(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_xthl(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	uint16_t temp = read16(cpu->registers.sp);
+	uint16_t temp = read16(cpu->memory, cpu->registers.sp);
 
-	write16(cpu->registers.sp, cpu->registers.hl);
+	write16(cpu->memory, cpu->registers.sp, cpu->registers.hl);
 	cpu->registers.hl = temp;
 	cpu->registers.pc++;
 	return CYCLES_XTHL;
 }
 
-uint8_t i8080_sphl(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_sphl(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->registers.sp = cpu->registers.hl;
 	cpu->registers.pc++;
 	return CYCLES_SPHL;
 }
 
-uint8_t i8080_in(intel8080_t *cpu)
+#if I8080_SIO_FIFO_SIZE & (I8080_SIO_FIFO_SIZE - 1) || I8080_SIO_FIFO_SIZE > 128
+#error "I8080_SIO_FIFO_SIZE must be a power of two up to 128"
+#endif
+
+void i8080_sio_set_baud(intel8080_t *cpu, uint32_t baud)
+{
+	cpu->sio.baud = baud;
+	cpu->sio.char_t_states = baud ? I8080_SIO_CLOCK_HZ * 10u / baud : 0;
+	cpu->sio.rx_poll_at = cpu->t_states;
+	cpu->sio.tx_free_at = cpu->t_states;
+}
+
+// Move console input into the 2SIO receive FIFO: all that is waiting once it has run empty, or
+// one character per character time at a set line rate
+static inline void i8080_sio_receive(intel8080_t *cpu)
 {
-	static uint8_t character = 0;
-	uint8_t port = read8(cpu->registers.pc + 1);
+	i8080_sio_t *sio = &cpu->sio;
+	if ((int32_t)(cpu->t_states - sio->rx_poll_at) < 0 || (!sio->char_t_states && sio->rx_count))
+		return;
+
+	while (sio->rx_count < I8080_SIO_FIFO_SIZE)
+	{
+		uint8_t ch = cpu->term_in();
+		if (!ch)
+		{
+			sio->rx_poll_at = cpu->t_states + I8080_SIO_POLL_T_STATES;
+			return;
+		}
+		sio->rx[(sio->rx_head + sio->rx_count++) & (I8080_SIO_FIFO_SIZE - 1)] = ch;
+		if (sio->char_t_states)
+		{
+			sio->rx_poll_at = cpu->t_states + sio->char_t_states;
+			return;
+		}
+	}
+}
+
+static inline uint8_t i8080_sio_rx_pop(intel8080_t *cpu)
+{
+	i8080_sio_t *sio = &cpu->sio;
+	uint8_t ch = sio->rx[sio->rx_head];
+	sio->rx_head = (sio->rx_head + 1) & (I8080_SIO_FIFO_SIZE - 1);
+	sio->rx_count--;
+	return ch;
+}
+
+// Room for another byte in the transmit FIFO
+static inline bool i8080_sio_tx_ready(const intel8080_t *cpu)
+{
+	const i8080_sio_t *sio = &cpu->sio;
+	return !sio->char_t_states ||
+		(int32_t)(sio->tx_free_at - cpu->t_states) <= (int32_t)((I8080_SIO_FIFO_SIZE - 1) * sio->char_t_states);
+}
+
+static inline void i8080_sio_transmit(intel8080_t *cpu, uint8_t ch)
+{
+	i8080_sio_t *sio = &cpu->sio;
+	if (sio->char_t_states)
+	{
+		if ((int32_t)(sio->tx_free_at - cpu->t_states) < 0)
+			sio->tx_free_at = cpu->t_states;
+		sio->tx_free_at += sio->char_t_states;
+	}
+	cpu->term_out(ch);
+}
+
+uint8_t i8080_console_read(intel8080_t *cpu)
+{
+	if (cpu->sio.rx_count)
+		return i8080_sio_rx_pop(cpu);
+	uint8_t ch = cpu->term_in();
+	cpu->idle_polls = ch ? 0 : cpu->idle_polls + 1;
+	return ch;
+}
+
+void i8080_console_unread(intel8080_t *cpu, uint8_t ch)
+{
+	i8080_sio_t *sio = &cpu->sio;
+	if (sio->rx_count < I8080_SIO_FIFO_SIZE)
+	{
+		sio->rx_head = (sio->rx_head - 1) & (I8080_SIO_FIFO_SIZE - 1);
+		sio->rx[sio->rx_head] = ch;
+		sio->rx_count++;
+	}
+}
+
+I8080_HANDLER uint8_t i8080_in(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
+{
+	uint8_t port = read8(cpu->memory, cpu->registers.pc + 1);
+	if (I8080_PRIMARY(cpu))
+		I8080_PROFILE_PORT_IN(port);
 
 	switch(port)
 	{
 	case 0x00:
 		cpu->registers.a = 0x00;
 		break;
+	case DISK_DMA_PORT_HIGH:
+		cpu->registers.a = (uint8_t)(cpu->disk_dma >> 8);
+		break;
 	case 0x1:
 		cpu->cpuStatus |= STATUS_PORT_INPUT;
 		cpu->registers.a = cpu->term_in();
+		cpu->idle_polls = cpu->registers.a ? 0 : cpu->idle_polls + 1;
 		// cpu->term_out(cpu->registers.a);
 		break;
 	case 0x8:
@@ -805,27 +1011,34 @@ uint8_t i8080_in(intel8080_t *cpu)
 	case 0xa:
 		cpu->registers.a = cpu->disk_controller.read();
 		break;
-	case 0x10: // 2SIO port 1, status
-		cpu->registers.a = 0x2; // bit 1 == transmit buffer empty
-		if(!character)
+	case DISK_DMA_PORT_LOW: // Whole sector into memory, through write8 so ROM stays protected
+		for (int i = 0; i < DISK_DMA_SECTOR_SIZE; i++)
 		{
-			character = cpu->term_in();
+			write8(cpu->memory, cpu->disk_dma++, cpu->disk_controller.read());
 		}
-		if(character)
+		cpu->registers.a = 0x00;
+		break;
+	case 0x10: // 2SIO port 1, status
+		i8080_sio_receive(cpu);
+		cpu->registers.a = i8080_sio_tx_ready(cpu) ? 0x2 : 0x0; // bit 1 == transmit buffer empty
+		if(cpu->sio.rx_count)
 		{
 			cpu->registers.a |= 0x1;
+			if (cpu->sio_control & I8080_SIO_RX_INTERRUPT)
+				cpu->registers.a |= 0x80; // IRQ
+			cpu->idle_polls = 0;
 		}
-		break;
-	case 0x11: // 2SIO port 1, read
-		if(character)
+		else
 		{
-			cpu->registers.a = character;
-			character = 0;
+			cpu->idle_polls++;
 		}
-		else
+		break;
+	case 0x11: // 2SIO port 1, read
+		if(!cpu->sio.rx_count)
 		{
-			cpu->registers.a = cpu->term_in();
+			i8080_sio_receive(cpu);
 		}
+		cpu->registers.a = cpu->sio.rx_count ? i8080_sio_rx_pop(cpu) : 0x00;
 		break;
 	case 0xff: // Front panel switches
 		cpu->registers.a = cpu->sense();
@@ -841,14 +1054,17 @@ uint8_t i8080_in(intel8080_t *cpu)
 	return CYCLES_IN;
 }
 
-uint8_t i8080_out(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_out(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	uint8_t port = read8(cpu->registers.pc + 1);
+	uint8_t port = read8(cpu->memory, cpu->registers.pc + 1);
+	if (I8080_PRIMARY(cpu))
+		I8080_PROFILE_PORT_OUT(port);
 	switch(port)
 	{
 	case 0x1:
 		cpu->cpuStatus |= STATUS_PORT_OUTPUT;
 		cpu->term_out(cpu->registers.a);
+		cpu->idle_polls = 0;
 		break;
 	case 0x8:
 		cpu->disk_controller.disk_select(cpu->registers.a);
@@ -859,24 +1075,32 @@ uint8_t i8080_out(intel8080_t *cpu)
 	case 0xa:
 		cpu->disk_controller.write(cpu->registers.a);
 		break;
-	case 0x10:  // 2SIO port 1 control
+	case DISK_DMA_PORT_LOW:
+		cpu->disk_dma = (cpu->disk_dma & 0xff00) | cpu->registers.a;
+		break;
+	case DISK_DMA_PORT_HIGH:
+		cpu->disk_dma = (cpu->disk_dma & 0x00ff) | ((uint16_t)cpu->registers.a << 8);
+		break;
+	case 0x10:  // 2SIO port 1 control, master reset (bits 0-1 set) clears it
+		cpu->sio_control = (cpu->registers.a & 0x03) == 0x03 ? 0 : cpu->registers.a;
 		break;
 	case 0x11: // 2sio port 1 write
-		cpu->term_out(cpu->registers.a);
+		i8080_sio_transmit(cpu, cpu->registers.a);
+		cpu->idle_polls = 0;
 		break;
 	default:
 		cpu->io_port_out_handler(port, cpu->registers.a);
-		// printf("OUT PORT %x, DATA: %x\n", read8(cpu->registers.pc + 1), cpu->registers.a);
+		// printf("OUT PORT %x, DATA: %x\n", read8(cpu->memory, cpu->registers.pc + 1), cpu->registers.a);
 		break;
 	}
 	cpu->registers.pc+=2;
 	return CYCLES_OUT;
 }
 
-uint8_t i8080_push(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_push(intel8080_t *cpu, uint8_t op_code)
 {
 	cpu->cpuStatus |= STATUS_STACK;
-	uint8_t pair = RP(cpu->current_op_code);
+	uint8_t pair = RP(op_code);
 	uint16_t val;
 
 	if(pair == PAIR_SP)
@@ -885,17 +1109,17 @@ uint8_t i8080_push(intel8080_t *cpu)
 		val = i8080_pairread(cpu, pair);
 
 	cpu->registers.sp-=2;
-	write16(cpu->registers.sp, val);
+	write16(cpu->memory, cpu->registers.sp, val);
 
 	cpu->registers.pc++;
 	return CYCLES_PUSH;
 }
 
-uint8_t i8080_pop(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_pop(intel8080_t *cpu, uint8_t op_code)
 {
 	cpu->cpuStatus |= STATUS_STACK;
-	uint8_t pair = RP(cpu->current_op_code);
-	uint16_t val = read16(cpu->registers.sp);
+	uint8_t pair = RP(op_code);
+	uint16_t val = read16(cpu->memory, cpu->registers.sp);
 	cpu->registers.sp+=2;
 	if(pair == PAIR_SP)
 		cpu->registers.af = val;
@@ -906,21 +1130,21 @@ uint8_t i8080_pop(intel8080_t *cpu)
 	return CYCLES_POP;
 }
 
-uint8_t i8080_stc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_stc(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	i8080_set_flag(cpu, FLAGS_CARRY);
 	cpu->registers.pc++;
 	return CYCLES_STC;
 }
 
-uint8_t i8080_cmc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_cmc(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->registers.flags ^= FLAGS_CARRY;
 	cpu->registers.pc++;
 	return CYCLES_CMC;
 }
 
-uint8_t i8080_rlc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_rlc(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint8_t high_bit = cpu->registers.a & 0x80;
 
@@ -940,7 +1164,7 @@ uint8_t i8080_rlc(intel8080_t *cpu)
 	return CYCLES_RAL;
 }
 
-uint8_t i8080_rrc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_rrc(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint8_t low_bit = cpu->registers.a & 1;
 
@@ -961,7 +1185,7 @@ uint8_t i8080_rrc(intel8080_t *cpu)
 	return CYCLES_RAR;
 }
 
-uint8_t i8080_ral(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ral(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint8_t high_bit = cpu->registers.a & 0x80;
 	cpu->registers.a <<= 1;
@@ -980,7 +1204,7 @@ uint8_t i8080_ral(intel8080_t *cpu)
 	return CYCLES_RLC;
 }
 
-uint8_t i8080_rar(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_rar(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint8_t low_bit = cpu->registers.a & 1;
 
@@ -1000,19 +1224,27 @@ uint8_t i8080_rar(intel8080_t *cpu)
 	return CYCLES_RRC;
 }
 
-uint8_t i8080_jmp(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_jmp(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	cpu->registers.pc = read16(cpu->registers.pc+1);
+#ifdef ALTAIR_BDOS_TRAP
+	if (UNLIKELY(cpu->registers.pc == I8080_BDOS_VECTOR) && op_code == 0xc3 && I8080_PRIMARY(cpu))
+	{
+		uint8_t t_states = i8080_bdos_trap(cpu);
+		if (t_states)
+			return t_states;
+	}
+#endif
+	cpu->registers.pc = read16(cpu->memory, cpu->registers.pc+1);
 	return CYCLES_JMP;
 }
 
-uint8_t i8080_jccc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_jccc(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t condition = CONDITION(cpu->current_op_code);
+	uint8_t condition = CONDITION(op_code);
 
 	if(i8080_check_condition(cpu, condition))
 	{
-		i8080_jmp(cpu);
+		i8080_jmp(cpu, op_code);
 	}
 	else
 	{
@@ -1022,82 +1254,78 @@ uint8_t i8080_jccc(intel8080_t *cpu)
 	return CYCLES_JMP;
 }
 
-uint8_t i8080_ret(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_ret(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->cpuStatus |= STATUS_STACK;
-	cpu->registers.pc = read16(cpu->registers.sp);
+	cpu->registers.pc = read16(cpu->memory, cpu->registers.sp);
 	cpu->registers.sp+=2;
 	return CYCLES_RET;
 }
 
-uint8_t i8080_rccc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_rccc(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t condition = CONDITION(cpu->current_op_code);
+	uint8_t condition = CONDITION(op_code);
 
 	if(i8080_check_condition(cpu, condition))
 	{
-		i8080_ret(cpu);
+		i8080_ret(cpu, op_code);
+		return CYCLES_RET_COND;
 	}
-	else
-	{
-		cpu->registers.pc++;
-	}
-	return CYCLES_RET;
+
+	cpu->registers.pc++;
+	return CYCLES_RET_SKIP;
 }
 
-uint8_t i8080_rst(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_rst(intel8080_t *cpu, uint8_t op_code)
 {
 	cpu->cpuStatus |= STATUS_STACK;
-	uint8_t vec = DESTINATION(cpu->current_op_code);
+	uint8_t vec = DESTINATION(op_code);
 
 	cpu->registers.sp-=2;
-	write16(cpu->registers.sp, cpu->registers.pc + 1);
+	write16(cpu->memory, cpu->registers.sp, cpu->registers.pc + 1);
 
 	cpu->registers.pc = vec*8;
 
-	return CYCLES_RET;
+	return CYCLES_RST;
 }
 
-uint8_t i8080_call(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_call(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->cpuStatus |= STATUS_STACK;
 	cpu->registers.sp-=2;
-	write16(cpu->registers.sp, cpu->registers.pc + 3);
+	write16(cpu->memory, cpu->registers.sp, cpu->registers.pc + 3);
 
-	cpu->registers.pc = read16(cpu->registers.pc + 1);
-	return CYCLES_JMP;
+	cpu->registers.pc = read16(cpu->memory, cpu->registers.pc + 1);
+	return CYCLES_CALL;
 }
 
-uint8_t i8080_cccc(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_cccc(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t condition = CONDITION(cpu->current_op_code);
+	uint8_t condition = CONDITION(op_code);
 
 	if(i8080_check_condition(cpu, condition))
 	{
-		i8080_call(cpu);
-	}
-	else
-	{
-		cpu->registers.pc+=3;
+		return i8080_call(cpu, op_code);
 	}
 
-	return CYCLES_CALL;
+	cpu->registers.pc+=3;
+	return CYCLES_CALL_SKIP;
 }
 
-uint8_t i8080_pchl(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_pchl(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->registers.pc = cpu->registers.hl;
 	return CYCLES_PCHL;
 }
 
-uint8_t i8080_nop(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_nop(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->registers.pc++;
 
 	return CYCLES_NOP;
 }
 
-uint8_t i8080_cma(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_cma(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	cpu->registers.a = ~cpu->registers.a;
 	cpu->registers.pc++;
@@ -1105,30 +1333,31 @@ uint8_t i8080_cma(intel8080_t *cpu)
 	return CYCLES_CMA;
 }
 
-uint8_t i8080_cmp(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_cmp(intel8080_t *cpu, uint8_t op_code)
 {
-	uint8_t reg = SOURCE(cpu->current_op_code);
+	uint8_t reg = SOURCE(op_code);
 
 	i8080_compare(cpu, i8080_regread(cpu, reg));
 
 	cpu->registers.pc++;
-	return CYCLES_CMP;
+	return reg == MEMORY_ACCESS ? CYCLES_ALU_MEM : CYCLES_CMP;
 }
 
-uint8_t i8080_cpi(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_cpi(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
-	i8080_compare(cpu, read8(cpu->registers.pc+1));
+	i8080_compare(cpu, read8(cpu->memory, cpu->registers.pc+1));
 	cpu->registers.pc+=2;
 	return CYCLES_CPI;
 }
 
-void i8080_fetch_next_op(intel8080_t *cpu)
+I8080_IN_RAM void i8080_fetch_next_op(intel8080_t *cpu)
 {
 	cpu->address_bus = cpu->registers.pc;
-	i8080_mread(cpu);
+	cpu->cpuStatus |= STATUS_MEMORY_READ;
+	cpu->data_bus = fetch8(cpu->memory, cpu->address_bus);
 }
 
-uint8_t i8080_daa(intel8080_t *cpu)
+I8080_HANDLER uint8_t i8080_daa(intel8080_t *cpu, I8080_UNUSED uint8_t op_code)
 {
 	uint8_t val, add = 0;
 	val = i8080_regread(cpu, REGISTER_A);
@@ -1147,18 +1376,866 @@ uint8_t i8080_daa(intel8080_t *cpu)
 	return CYCLES_DAA;
 }
 
-void i8080_cycle(intel8080_t *cpu)
+// Adds the T-states of the instruction just executed to the profile
+static inline uint8_t i8080_profile_cycle(intel8080_t *cpu, uint8_t t_states)
+{
+	cpu->t_states += t_states;
+	I8080_PROFILE_T_STATES(t_states);
+	return t_states;
+}
+
+// Records the instruction just fetched in the execution history
+#ifdef ALTAIR_TRACE
+#define I8080_TRACE_CYCLE(cpu, op) do { \
+	if (i8080_trace.enabled) \
+		i8080_trace_record((cpu)->address_bus, op, fetch8((cpu)->memory, (uint16_t)((cpu)->address_bus + 1)), \
+			(cpu)->registers.a, (cpu)->registers.flags, (cpu)->registers.sp); } while (0)
+#else
+#define I8080_TRACE_CYCLE(cpu, op) ((void)0)
+#endif
+
+void i8080_interrupt(intel8080_t *cpu, uint8_t rst)
+{
+	cpu->interrupt_request |= (uint8_t)(1u << (rst & 7));
+	cpu->exit_requested = true;
+}
+
+// A request raised, or the 2SIO receive interrupt enabled and maybe raising one
+#define I8080_INTERRUPT_WAITING(cpu) ((cpu)->interrupt_request || ((cpu)->sio_control & I8080_SIO_RX_INTERRUPT))
+// ... and interrupts enabled, so i8080_service_interrupts may take it
+#define I8080_INTERRUPT_PENDING(cpu) (I8080_INTERRUPT_WAITING(cpu) && ((cpu)->registers.flags & FLAGS_IF))
+
+// Raises the console receive interrupt and accepts the highest priority request if interrupts
+// are enabled: as the RST the interrupting device puts on the bus. Returns its T-states, 0 if
+// none was taken.
+I8080_IN_RAM static uint8_t i8080_service_interrupts(intel8080_t *cpu)
+{
+	if (cpu->sio_control & I8080_SIO_RX_INTERRUPT)
+	{
+		i8080_sio_receive(cpu);
+		if (cpu->sio.rx_count)
+			cpu->interrupt_request |= 1u << I8080_SIO_RX_RST;
+	}
+
+	if (!cpu->interrupt_request || !(cpu->registers.flags & FLAGS_IF))
+		return 0;
+
+	uint8_t rst = (uint8_t)__builtin_ctz(cpu->interrupt_request);
+	cpu->interrupt_request &= (uint8_t)~(1u << rst);
+	cpu->registers.flags &= (uint8_t)~FLAGS_IF;
+	cpu->registers.sp -= 2;
+	write16(cpu->memory, cpu->registers.sp, cpu->registers.pc);
+	cpu->registers.pc = (uint16_t)(rst * 8);
+	cpu->halted = false;
+	cpu->cpuStatus |= STATUS_INTERRUPT;
+	cpu->instruction_count++;
+	return CYCLES_RST;
+}
+
+#ifdef ALTAIR_THREADED_CORE
+I8080_IN_RAM uint8_t i8080_cycle(intel8080_t *cpu)
+{
+	cpu->cpuStatus = 0;
+	if (UNLIKELY(cpu->ei_pending))
+		cpu->ei_pending = false; // The instruction after EI runs before any interrupt
+	else if (UNLIKELY(I8080_INTERRUPT_PENDING(cpu)))
+	{
+		uint8_t t_states = i8080_service_interrupts(cpu);
+		if (t_states)
+			return i8080_profile_cycle(cpu, t_states);
+	}
+	i8080_fetch_next_op(cpu);
+
+	uint8_t op_code = cpu->current_op_code = cpu->data_bus;
+	I8080_PROFILE_OPCODE(cpu->address_bus, op_code);
+	I8080_HEATMAP_COUNT(cpu->memory, I8080_HEATMAP_EXECUTE, cpu->address_bus);
+	I8080_TRACE_CYCLE(cpu, op_code);
+	cpu->instruction_count++;
+
+#if defined(__GNUC__)
+	// Computed goto: one indirect branch straight into the specialized opcode body
+#define I8080_LABEL(n, name) [n] = &&op_##n,
+	static const void *I8080_TABLE dispatch[256] = { I8080_OPCODE_LIST(I8080_LABEL) };
+#undef I8080_LABEL
+
+	goto *dispatch[op_code];
+
+#define I8080_BODY(n, name) op_##n: return i8080_profile_cycle(cpu, i8080_##name(cpu, n));
+	I8080_OPCODE_LIST(I8080_BODY)
+#undef I8080_BODY
+#else
+	switch(op_code)
+	{
+#define I8080_CASE(n, name) case n: return i8080_profile_cycle(cpu, i8080_##name(cpu, n));
+	I8080_OPCODE_LIST(I8080_CASE)
+#undef I8080_CASE
+	}
+	return CYCLES_NOP;
+#endif
+}
+#else
+I8080_IN_RAM uint8_t i8080_cycle(intel8080_t *cpu)
 {
 	cpu->cpuStatus = 0;
+	if (UNLIKELY(cpu->ei_pending))
+		cpu->ei_pending = false; // The instruction after EI runs before any interrupt
+	else if (UNLIKELY(I8080_INTERRUPT_PENDING(cpu)))
+	{
+		uint8_t t_states = i8080_service_interrupts(cpu);
+		if (t_states)
+			return i8080_profile_cycle(cpu, t_states);
+	}
 	i8080_fetch_next_op(cpu);
 
 	uint8_t op_code = cpu->current_op_code = cpu->data_bus;
-	uint8_t (*handler)(intel8080_t *) = opcode_handlers[op_code];
+	I8080_PROFILE_OPCODE(cpu->address_bus, op_code);
+	I8080_HEATMAP_COUNT(cpu->memory, I8080_HEATMAP_EXECUTE, cpu->address_bus);
+	I8080_TRACE_CYCLE(cpu, op_code);
+	cpu->instruction_count++;
+	uint8_t (*handler)(intel8080_t *, uint8_t) = opcode_handlers[op_code];
 	
 	if (LIKELY(handler != NULL)) {
-		handler(cpu);
-	} else {
-		// Handle undefined opcodes (NOP behavior)
-		cpu->registers.pc++;
+		return i8080_profile_cycle(cpu, handler(cpu, op_code));
+	}
+
+	// Handle undefined opcodes (NOP behavior)
+	cpu->registers.pc++;
+	return i8080_profile_cycle(cpu, CYCLES_NOP);
+}
+#endif
+
+// ----------------------------------------------------------------------------
+// Batch execution: i8080_run keeps the register file in locals and only writes
+// it back to intel8080_t when the batch exits. Opcode semantics (including the
+// flag quirks of the handlers above) are identical to i8080_cycle, but the
+// per-instruction bus/status bookkeeping is skipped; the bus is left showing the
+// next opcode fetch on exit.
+// ----------------------------------------------------------------------------
+
+// Ports decoded by i8080_in/i8080_out themselves; anything else goes to the slow
+// io_port_in_handler/io_port_out_handler path and ends the batch.
+static inline bool i8080_is_builtin_port(uint8_t port)
+{
+	switch(port)
+	{
+	case 0x00: case 0x01: case 0x08: case 0x09: case 0x0a: case DISK_DMA_PORT_LOW: case DISK_DMA_PORT_HIGH:
+	case 0x10: case 0x11: case 0xff:
+		return true;
+	default:
+		return false;
 	}
 }
+
+static inline uint8_t run_zsp(uint8_t f, uint8_t val)
+{
+	f &= (uint8_t)~(FLAGS_ZERO | FLAGS_SIGN | FLAGS_PARITY);
+	f |= val & FLAGS_SIGN;
+	if (val == 0)
+		f |= FLAGS_ZERO;
+	if (parity_table[val])
+		f |= FLAGS_PARITY;
+	return f;
+}
+
+// Flag bookkeeping for i8080_run. With ALTAIR_LAZY_FLAGS the ALU ops only record
+// the last result (Z/S/P) and the last half-carry operands (H) in locals; CY and
+// IF stay eager in f since they are cheap and read by ADC/SBB/RAL/RAR. The
+// deferred bits are folded into f by RUN_FLAGS() before anything reads the flag
+// byte as a whole: PUSH PSW, DAA, I/O handlers and batch exit (so the monitor
+// always sees materialized flags in cpu->registers.flags).
+#ifdef ALTAIR_LAZY_FLAGS
+#define RUN_LAZY_ZSP 0x01
+#define RUN_LAZY_H   0x02
+
+#define RUN_LAZY_LOCALS uint8_t lazy, zsp_val = 0, h_a = 0, h_b = 0
+#define RUN_LAZY_RESET() lazy = 0
+#define RUN_SET_ZSP(v) do { zsp_val = (v); lazy |= RUN_LAZY_ZSP; } while (0)
+#define RUN_SET_H(x, y) do { h_a = (x); h_b = (y); lazy |= RUN_LAZY_H; } while (0)
+#define RUN_CLR_H() do { f &= (uint8_t)~FLAGS_H; lazy &= (uint8_t)~RUN_LAZY_H; } while (0)
+#define RUN_FLAGS() do { \
+	if (lazy) { \
+		if (lazy & RUN_LAZY_ZSP) f = run_zsp(f, zsp_val); \
+		if (lazy & RUN_LAZY_H) f = CHECK_HALF_CARRY(h_a, h_b) ? (f | FLAGS_H) : (f & (uint8_t)~FLAGS_H); \
+		lazy = 0; } } while (0)
+#define RUN_ZERO()   ((lazy & RUN_LAZY_ZSP) ? (zsp_val == 0) : (f & FLAGS_ZERO) != 0)
+#define RUN_SIGN()   ((lazy & RUN_LAZY_ZSP) ? (zsp_val & 0x80) != 0 : (f & FLAGS_SIGN) != 0)
+#define RUN_PARITY() ((lazy & RUN_LAZY_ZSP) ? parity_table[zsp_val] != 0 : (f & FLAGS_PARITY) != 0)
+#else
+#define RUN_LAZY_LOCALS
+#define RUN_LAZY_RESET() do { } while (0)
+#define RUN_SET_ZSP(v) f = run_zsp(f, v)
+#define RUN_SET_H(x, y) f = CHECK_HALF_CARRY(x, y) ? (f | FLAGS_H) : (f & (uint8_t)~FLAGS_H)
+#define RUN_CLR_H() f &= (uint8_t)~FLAGS_H
+#define RUN_FLAGS() do { } while (0)
+#define RUN_ZERO()   ((f & FLAGS_ZERO) != 0)
+#define RUN_SIGN()   ((f & FLAGS_SIGN) != 0)
+#define RUN_PARITY() ((f & FLAGS_PARITY) != 0)
+#endif
+
+#define RUN_SET_CY(cond) f = (cond) ? (f | FLAGS_CARRY) : (f & (uint8_t)~FLAGS_CARRY)
+
+// Same arithmetic as i8080_genadd
+#define RUN_ALU_ADD(val) do { \
+	uint16_t _v = (val); \
+	RUN_SET_H(a, _v); RUN_SET_CY(CHECK_CARRY(a, _v)); \
+	a += _v; RUN_SET_ZSP(a); } while (0)
+
+// Same arithmetic as i8080_gensub; CMP discards the result but keeps its flags
+#define RUN_ALU_SUB(val, store) do { \
+	uint16_t _b = 0x100 - (val); \
+	uint8_t _r = (uint8_t)(a + _b); \
+	RUN_SET_H(a, _b); RUN_SET_CY(!CHECK_CARRY(a, _b)); \
+	RUN_SET_ZSP(_r); if (store) a = _r; } while (0)
+
+#define RUN_ALU_ANA(val) do { a &= (val); f &= (uint8_t)~FLAGS_CARRY; RUN_SET_ZSP(a); } while (0)
+#define RUN_ALU_XRA(val) do { a ^= (val); f &= (uint8_t)~FLAGS_CARRY; RUN_CLR_H(); RUN_SET_ZSP(a); } while (0)
+#define RUN_ALU_ORA(val) do { a |= (val); f &= (uint8_t)~FLAGS_CARRY; RUN_CLR_H(); RUN_SET_ZSP(a); } while (0)
+#define RUN_ALU_INR(r) do { RUN_SET_H(r, 1); r++; RUN_SET_ZSP(r); } while (0)
+#define RUN_ALU_DCR(r) do { RUN_SET_H(r, 0xff); r--; RUN_SET_ZSP(r); } while (0)
+
+#define RUN_CARRY_IN ((f & FLAGS_CARRY) ? 1 : 0)
+
+#define RUN_CONDITION(op) \
+	(CONDITION(op) == CONDITION_NZ ? !RUN_ZERO() : \
+	 CONDITION(op) == CONDITION_Z  ? RUN_ZERO() : \
+	 CONDITION(op) == CONDITION_NC ? !(f & FLAGS_CARRY) : \
+	 CONDITION(op) == CONDITION_C  ? (f & FLAGS_CARRY) != 0 : \
+	 CONDITION(op) == CONDITION_PO ? !RUN_PARITY() : \
+	 CONDITION(op) == CONDITION_PE ? RUN_PARITY() : \
+	 CONDITION(op) == CONDITION_P  ? !RUN_SIGN() : RUN_SIGN())
+
+void i8080_request_exit(intel8080_t *cpu)
+{
+	cpu->exit_requested = true;
+}
+
+// Memory reads of the batch loop. With ALTAIR_INTERP those of memory_main find their page through
+// interpolator 0 of core 0: lane 0 turns an address written to its accumulator into the address
+// of the page's read_map entry, so the lookup is a store and a load where the Cortex-M0+ shifts,
+// scales and adds. The batch saves the interpolator's state and points lane 0 at the map when it
+// starts, and restores the state when it ends, so other code on the core may use the interpolator
+// between batches. Interrupt handlers on core 0 that use interp0 must save and restore it
+// themselves, as the SDK asks of them anyway.
+#ifdef ALTAIR_INTERP
+_Static_assert(sizeof(uint8_t *) == 4, "lane 0 scales pages to 32-bit read_map entries");
+
+static void run_interp_setup(const memory_space_t *mem)
+{
+	interp_config config = interp_default_config();
+	interp_config_set_shift(&config, MEMORY_PAGE_SHIFT - 2);
+	interp_config_set_mask(&config, 2, 1 + __builtin_ctz(MEMORY_PAGES));
+	interp_set_config(interp0, 0, &config);
+	interp0->base[0] = (uintptr_t)mem->read_map;
+}
+
+static inline __attribute__((always_inline)) uint8_t run_fetch8(const memory_space_t *mem, bool primary,
+	uint16_t address)
+{
+	if (!primary)
+		return fetch8(mem, address);
+	interp0->accum[0] = address;
+	return (*(uint8_t *const *)(uintptr_t)interp0->peek[0])[address & MEMORY_PAGE_MASK];
+}
+
+static inline __attribute__((always_inline)) uint16_t run_fetch16(const memory_space_t *mem, bool primary,
+	uint16_t address)
+{
+	return (uint16_t)(run_fetch8(mem, primary, address) | run_fetch8(mem, primary, (uint16_t)(address + 1)) << 8);
+}
+
+static inline __attribute__((always_inline)) uint8_t run_read8(const memory_space_t *mem, bool primary,
+	uint16_t address)
+{
+	I8080_HEATMAP_COUNT(mem, I8080_HEATMAP_READ, address);
+	return run_fetch8(mem, primary, address);
+}
+
+static inline __attribute__((always_inline)) uint16_t run_read16(const memory_space_t *mem, bool primary,
+	uint16_t address)
+{
+	return (uint16_t)(run_read8(mem, primary, address) | run_read8(mem, primary, (uint16_t)(address + 1)) << 8);
+}
+
+#define RUN_FETCH8(address) run_fetch8(mem, primary, (address))
+#define RUN_FETCH16(address) run_fetch16(mem, primary, (address))
+#define RUN_READ8(address) run_read8(mem, primary, (address))
+#define RUN_READ16(address) run_read16(mem, primary, (address))
+#else
+#define RUN_FETCH8(address) fetch8(mem, (address))
+#define RUN_FETCH16(address) fetch16(mem, (address))
+#define RUN_READ8(address) read8(mem, (address))
+#define RUN_READ16(address) read16(mem, (address))
+#endif
+
+#define RUN_HL ((uint16_t)((h << 8) | l))
+#define RUN_PAIR(hi, lo) ((uint16_t)((hi << 8) | lo))
+#define RUN_SET_PAIR(hi, lo, v) do { uint16_t _v = (v); hi = (uint8_t)(_v >> 8); lo = (uint8_t)_v; } while (0)
+#define RUN_NEXT(len, t) pc += len; cycles += t; break
+
+// Operand bytes of the current instruction
+#define RUN_IMM8 RUN_FETCH8(pc + 1)
+#define RUN_IMM16 RUN_FETCH16(pc + 1)
+
+#define RUN_LOAD() do { \
+	RUN_LAZY_RESET(); \
+	a = cpu->registers.a; f = cpu->registers.flags; b = cpu->registers.b; c = cpu->registers.c; \
+	d = cpu->registers.d; e = cpu->registers.e; h = cpu->registers.h; l = cpu->registers.l; \
+	sp = cpu->registers.sp; pc = cpu->registers.pc; } while (0)
+
+#define RUN_SAVE() do { \
+	RUN_FLAGS(); \
+	cpu->registers.a = a; cpu->registers.flags = f; cpu->registers.b = b; cpu->registers.c = c; \
+	cpu->registers.d = d; cpu->registers.e = e; cpu->registers.h = h; cpu->registers.l = l; \
+	cpu->registers.sp = sp; cpu->registers.pc = pc; } while (0)
+
+// Guest memory writes. In the copy of the loop that checks breakpoints a write to a watched
+// address ends the batch once the instruction is done.
+#ifdef ALTAIR_BREAKPOINTS
+#define RUN_WRITE8(address, val) do { \
+	uint16_t _w = (address); \
+	if (checking && UNLIKELY(i8080_break_test(i8080_break.write, _w))) run_watch_hit(cpu, _w, pc); \
+	write8(mem, _w, val); } while (0)
+#else
+#define RUN_WRITE8(address, val) write8(mem, address, val)
+#endif
+#define RUN_WRITE16(address, val) do { \
+	uint16_t _a16 = (address), _v16 = (val); \
+	RUN_WRITE8(_a16, (uint8_t)_v16); RUN_WRITE8((uint16_t)(_a16 + 1), (uint8_t)(_v16 >> 8)); } while (0)
+
+#ifdef ALTAIR_BREAKPOINTS
+static void run_watch_hit(intel8080_t *cpu, uint16_t address, uint16_t pc)
+{
+	if (i8080_break.hit == I8080_BREAK_NONE)
+	{
+		i8080_break.hit = I8080_BREAK_WRITE;
+		i8080_break.hit_address = address;
+		i8080_break.hit_pc = pc;
+	}
+	cpu->exit_requested = true;
+}
+#endif
+
+#define RUN_MOV(op, dst, src) case op: dst = src; RUN_NEXT(1, CYCLES_MOV_REG);
+#define RUN_MOV_R_M(op, dst) case op: dst = RUN_READ8(RUN_HL); RUN_NEXT(1, CYCLES_MOV_MEM);
+#define RUN_MOV_M_R(op, src) case op: RUN_WRITE8(RUN_HL, src); RUN_NEXT(1, CYCLES_MOV_MEM);
+
+#define RUN_ADD(op, r) case op: RUN_ALU_ADD(r); RUN_NEXT(1, CYCLES_ADD);
+#define RUN_ADC(op, r) case op: RUN_ALU_ADD((uint16_t)r + RUN_CARRY_IN); RUN_NEXT(1, CYCLES_ADC);
+#define RUN_SUB(op, r) case op: RUN_ALU_SUB(r, true); RUN_NEXT(1, CYCLES_SUB);
+#define RUN_SBB(op, r) case op: RUN_ALU_SUB((uint16_t)r + RUN_CARRY_IN, true); RUN_NEXT(1, CYCLES_SBB);
+#define RUN_ANA(op, r) case op: RUN_ALU_ANA(r); RUN_NEXT(1, CYCLES_ANA);
+#define RUN_XRA(op, r) case op: RUN_ALU_XRA(r); RUN_NEXT(1, CYCLES_XRA);
+#define RUN_ORA(op, r) case op: RUN_ALU_ORA(r); RUN_NEXT(1, CYCLES_ORA);
+#define RUN_CMP(op, r) case op: RUN_ALU_SUB(r, false); RUN_NEXT(1, CYCLES_CMP);
+
+#define RUN_ADD_M(op) case op: RUN_ALU_ADD(RUN_READ8(RUN_HL)); RUN_NEXT(1, CYCLES_ALU_MEM);
+#define RUN_ADC_M(op) case op: RUN_ALU_ADD((uint16_t)RUN_READ8(RUN_HL) + RUN_CARRY_IN); RUN_NEXT(1, CYCLES_ALU_MEM);
+#define RUN_SUB_M(op) case op: RUN_ALU_SUB(RUN_READ8(RUN_HL), true); RUN_NEXT(1, CYCLES_ALU_MEM);
+#define RUN_SBB_M(op) case op: RUN_ALU_SUB((uint16_t)RUN_READ8(RUN_HL) + RUN_CARRY_IN, true); RUN_NEXT(1, CYCLES_ALU_MEM);
+#define RUN_ANA_M(op) case op: RUN_ALU_ANA(RUN_READ8(RUN_HL)); RUN_NEXT(1, CYCLES_ALU_MEM);
+#define RUN_XRA_M(op) case op: RUN_ALU_XRA(RUN_READ8(RUN_HL)); RUN_NEXT(1, CYCLES_ALU_MEM);
+#define RUN_ORA_M(op) case op: RUN_ALU_ORA(RUN_READ8(RUN_HL)); RUN_NEXT(1, CYCLES_ALU_MEM);
+#define RUN_CMP_M(op) case op: RUN_ALU_SUB(RUN_READ8(RUN_HL), false); RUN_NEXT(1, CYCLES_ALU_MEM);
+
+#define RUN_INR(op, r) case op: RUN_ALU_INR(r); RUN_NEXT(1, CYCLES_INR);
+#define RUN_DCR(op, r) case op: RUN_ALU_DCR(r); RUN_NEXT(1, CYCLES_DCR);
+#define RUN_MVI(op, r) case op: r = RUN_IMM8; RUN_NEXT(2, CYCLES_MVI_REG);
+
+#define RUN_LXI(op, hi, lo) case op: RUN_SET_PAIR(hi, lo, RUN_IMM16); RUN_NEXT(3, CYCLES_LXI);
+#define RUN_INX(op, hi, lo) case op: RUN_SET_PAIR(hi, lo, RUN_PAIR(hi, lo) + 1); RUN_NEXT(1, CYCLES_INX);
+#define RUN_DCX(op, hi, lo) case op: RUN_SET_PAIR(hi, lo, RUN_PAIR(hi, lo) - 1); RUN_NEXT(1, CYCLES_DCX);
+#define RUN_DAD(op, val) case op: { \
+	uint32_t sum = (uint32_t)(val) + RUN_HL; \
+	f = (sum > 0xffff) ? (f | FLAGS_CARRY) : (f & (uint8_t)~FLAGS_CARRY); \
+	RUN_SET_PAIR(h, l, sum); RUN_NEXT(1, CYCLES_DAD); }
+#define RUN_PUSH(op, val) case op: sp -= 2; RUN_WRITE16(sp, val); RUN_NEXT(1, CYCLES_PUSH);
+#define RUN_POP(op, hi, lo) case op: RUN_SET_PAIR(hi, lo, RUN_READ16(sp)); sp += 2; RUN_NEXT(1, CYCLES_POP);
+
+#define RUN_JCC(op) case op: \
+	if (RUN_CONDITION(op)) { pc = RUN_IMM16; cycles += CYCLES_JMP; break; } \
+	RUN_NEXT(3, CYCLES_JMP);
+#define RUN_CCC(op) case op: \
+	if (RUN_CONDITION(op)) { sp -= 2; RUN_WRITE16(sp, pc + 3); pc = RUN_IMM16; cycles += CYCLES_CALL; break; } \
+	RUN_NEXT(3, CYCLES_CALL_SKIP);
+#define RUN_RCC(op) case op: \
+	if (RUN_CONDITION(op)) { pc = RUN_READ16(sp); sp += 2; cycles += CYCLES_RET_COND; break; } \
+	RUN_NEXT(1, CYCLES_RET_SKIP);
+#define RUN_RST(op) case op: sp -= 2; RUN_WRITE16(sp, pc + 1); pc = VECTOR(op) * 8; cycles += CYCLES_RST; break;
+
+// With ALTAIR_TRACE or ALTAIR_BREAKPOINTS the batch loop is built once per combination of
+// recording and breakpoint checks, so a stopped trace or an unarmed debugger costs one branch
+// per batch rather than one per instruction. With ALTAIR_SECOND_MACHINE there is a copy for
+// each address space as well, so memory is reached through a constant address as with one. With
+// ALTAIR_BASIC_FP the copies that check for the 8K BASIC's floating point routines only run while
+// it is loaded.
+#if defined(ALTAIR_TRACE) || defined(ALTAIR_BREAKPOINTS) || defined(ALTAIR_SECOND_MACHINE) || \
+	defined(ALTAIR_BASIC_FP)
+#define RUN_VARIANTS
+#endif
+
+#ifdef RUN_VARIANTS
+static inline __attribute__((always_inline)) uint32_t run_batch(intel8080_t *cpu, uint32_t n_cycles,
+	memory_space_t *mem, bool primary, bool tracing, bool checking, bool basic)
+#else
+I8080_IN_RAM uint32_t i8080_run(intel8080_t *cpu, uint32_t n_cycles)
+#endif
+{
+	uint8_t a, f, b, c, d, e, h, l;
+	uint16_t sp, pc;
+	uint32_t cycles = 0;
+	uint32_t instructions = 0;
+	RUN_LAZY_LOCALS;
+	uint32_t limit = n_cycles; // End of the batch, or the next duty sample if that comes first
+	const uint32_t t_start = cpu->t_states;
+#ifdef ALTAIR_INTERP
+	interp_hw_save_t interp_saved;
+#endif
+#ifdef RUN_VARIANTS
+	(void)primary;
+	(void)tracing;
+	(void)checking;
+	(void)basic;
+#else
+	memory_space_t *const mem = &memory_main;
+	const bool primary = true;
+	(void)primary;
+#endif
+#ifdef ALTAIR_PANEL_DUTY
+	uint32_t duty_point = primary ? i8080_duty.countdown : UINT32_MAX;
+	if (duty_point < limit)
+		limit = duty_point;
+#endif
+
+	cpu->exit_requested = false;
+	cpu->halted = false;
+#ifdef ALTAIR_INTERP
+	if (primary)
+	{
+		interp_save(interp0, &interp_saved);
+		run_interp_setup(mem);
+	}
+#endif
+	if (UNLIKELY(cpu->ei_pending))
+	{
+		// A batch that ended on EI: the instruction after it runs before any interrupt, on its
+		// own while it is another EI
+		cycles = i8080_cycle(cpu);
+		if (cpu->ei_pending)
+		{
+			RUN_LOAD();
+			goto run_exit;
+		}
+	}
+	if (UNLIKELY(I8080_INTERRUPT_PENDING(cpu)))
+		cycles += i8080_service_interrupts(cpu);
+	RUN_LOAD();
+
+#ifdef ALTAIR_PANEL_DUTY
+run_loop:
+#endif
+	while (LIKELY(cycles < limit && !cpu->exit_requested))
+	{
+#ifdef ALTAIR_BREAKPOINTS
+		if (checking)
+		{
+			// Continuing from a breakpoint runs the instruction it stopped at
+			if (UNLIKELY(i8080_break_test(i8080_break.pc, pc)) &&
+				!(i8080_break.resume && pc == i8080_break.hit_pc))
+			{
+				i8080_break.hit = I8080_BREAK_PC;
+				i8080_break.hit_address = pc;
+				i8080_break.hit_pc = pc;
+				i8080_break.resume = true;
+				goto run_exit;
+			}
+			i8080_break.resume = false;
+		}
+#endif
+#ifdef ALTAIR_BASIC_FP
+		if (basic && UNLIKELY(I8080_BASIC_FP_ENTRY(pc)))
+		{
+			RUN_SAVE();
+			uint8_t t_states = i8080_basic_fp_trap(cpu);
+			RUN_LOAD();
+			if (t_states)
+			{
+				cycles += t_states;
+				continue;
+			}
+		}
+#endif
+		uint8_t op_code = RUN_FETCH8(pc);
+		if (primary)
+		{
+			I8080_PROFILE_OPCODE(pc, op_code);
+			I8080_HEATMAP_COUNT(mem, I8080_HEATMAP_EXECUTE, pc);
+		}
+#ifdef ALTAIR_TRACE
+		if (UNLIKELY(tracing))
+		{
+			RUN_FLAGS();
+			i8080_trace_record(pc, op_code, RUN_FETCH8(pc + 1), a, f, sp);
+		}
+#endif
+		instructions++;
+
+		switch(op_code)
+		{
+		RUN_MOV(0x40, b, b) RUN_MOV(0x41, b, c) RUN_MOV(0x42, b, d) RUN_MOV(0x43, b, e)
+		RUN_MOV(0x44, b, h) RUN_MOV(0x45, b, l) RUN_MOV_R_M(0x46, b) RUN_MOV(0x47, b, a)
+		RUN_MOV(0x48, c, b) RUN_MOV(0x49, c, c) RUN_MOV(0x4a, c, d) RUN_MOV(0x4b, c, e)
+		RUN_MOV(0x4c, c, h) RUN_MOV(0x4d, c, l) RUN_MOV_R_M(0x4e, c) RUN_MOV(0x4f, c, a)
+		RUN_MOV(0x50, d, b) RUN_MOV(0x51, d, c) RUN_MOV(0x52, d, d) RUN_MOV(0x53, d, e)
+		RUN_MOV(0x54, d, h) RUN_MOV(0x55, d, l) RUN_MOV_R_M(0x56, d) RUN_MOV(0x57, d, a)
+		RUN_MOV(0x58, e, b) RUN_MOV(0x59, e, c) RUN_MOV(0x5a, e, d) RUN_MOV(0x5b, e, e)
+		RUN_MOV(0x5c, e, h) RUN_MOV(0x5d, e, l) RUN_MOV_R_M(0x5e, e) RUN_MOV(0x5f, e, a)
+		RUN_MOV(0x60, h, b) RUN_MOV(0x61, h, c) RUN_MOV(0x62, h, d) RUN_MOV(0x63, h, e)
+		RUN_MOV(0x64, h, h) RUN_MOV(0x65, h, l) RUN_MOV_R_M(0x66, h) RUN_MOV(0x67, h, a)
+		RUN_MOV(0x68, l, b) RUN_MOV(0x69, l, c) RUN_MOV(0x6a, l, d) RUN_MOV(0x6b, l, e)
+		RUN_MOV(0x6c, l, h) RUN_MOV(0x6d, l, l) RUN_MOV_R_M(0x6e, l) RUN_MOV(0x6f, l, a)
+		RUN_MOV_M_R(0x70, b) RUN_MOV_M_R(0x71, c) RUN_MOV_M_R(0x72, d) RUN_MOV_M_R(0x73, e)
+		RUN_MOV_M_R(0x74, h) RUN_MOV_M_R(0x75, l) RUN_MOV_M_R(0x77, a) RUN_MOV(0x78, a, b)
+		RUN_MOV(0x79, a, c) RUN_MOV(0x7a, a, d) RUN_MOV(0x7b, a, e) RUN_MOV(0x7c, a, h)
+		RUN_MOV(0x7d, a, l) RUN_MOV_R_M(0x7e, a) RUN_MOV(0x7f, a, a)
+
+		RUN_ADD(0x80, b) RUN_ADD(0x81, c) RUN_ADD(0x82, d) RUN_ADD(0x83, e)
+		RUN_ADD(0x84, h) RUN_ADD(0x85, l) RUN_ADD_M(0x86) RUN_ADD(0x87, a)
+		RUN_ADC(0x88, b) RUN_ADC(0x89, c) RUN_ADC(0x8a, d) RUN_ADC(0x8b, e)
+		RUN_ADC(0x8c, h) RUN_ADC(0x8d, l) RUN_ADC_M(0x8e) RUN_ADC(0x8f, a)
+		RUN_SUB(0x90, b) RUN_SUB(0x91, c) RUN_SUB(0x92, d) RUN_SUB(0x93, e)
+		RUN_SUB(0x94, h) RUN_SUB(0x95, l) RUN_SUB_M(0x96) RUN_SUB(0x97, a)
+		RUN_SBB(0x98, b) RUN_SBB(0x99, c) RUN_SBB(0x9a, d) RUN_SBB(0x9b, e)
+		RUN_SBB(0x9c, h) RUN_SBB(0x9d, l) RUN_SBB_M(0x9e) RUN_SBB(0x9f, a)
+		RUN_ANA(0xa0, b) RUN_ANA(0xa1, c) RUN_ANA(0xa2, d) RUN_ANA(0xa3, e)
+		RUN_ANA(0xa4, h) RUN_ANA(0xa5, l) RUN_ANA_M(0xa6) RUN_ANA(0xa7, a)
+		RUN_XRA(0xa8, b) RUN_XRA(0xa9, c) RUN_XRA(0xaa, d) RUN_XRA(0xab, e)
+		RUN_XRA(0xac, h) RUN_XRA(0xad, l) RUN_XRA_M(0xae) RUN_XRA(0xaf, a)
+		RUN_ORA(0xb0, b) RUN_ORA(0xb1, c) RUN_ORA(0xb2, d) RUN_ORA(0xb3, e)
+		RUN_ORA(0xb4, h) RUN_ORA(0xb5, l) RUN_ORA_M(0xb6) RUN_ORA(0xb7, a)
+		RUN_CMP(0xb8, b) RUN_CMP(0xb9, c) RUN_CMP(0xba, d) RUN_CMP(0xbb, e)
+		RUN_CMP(0xbc, h) RUN_CMP(0xbd, l) RUN_CMP_M(0xbe) RUN_CMP(0xbf, a)
+
+		RUN_INR(0x04, b) RUN_INR(0x0c, c) RUN_INR(0x14, d) RUN_INR(0x1c, e)
+		RUN_INR(0x24, h) RUN_INR(0x2c, l) RUN_INR(0x3c, a)
+		RUN_DCR(0x05, b) RUN_DCR(0x0d, c) RUN_DCR(0x15, d) RUN_DCR(0x1d, e)
+		RUN_DCR(0x25, h) RUN_DCR(0x2d, l) RUN_DCR(0x3d, a)
+		RUN_MVI(0x06, b) RUN_MVI(0x0e, c) RUN_MVI(0x16, d) RUN_MVI(0x1e, e)
+		RUN_MVI(0x26, h) RUN_MVI(0x2e, l) RUN_MVI(0x3e, a)
+
+		RUN_LXI(0x01, b, c) RUN_LXI(0x11, d, e) RUN_LXI(0x21, h, l)
+		RUN_INX(0x03, b, c) RUN_INX(0x13, d, e) RUN_INX(0x23, h, l)
+		RUN_DCX(0x0b, b, c) RUN_DCX(0x1b, d, e) RUN_DCX(0x2b, h, l)
+		RUN_DAD(0x09, RUN_PAIR(b, c)) RUN_DAD(0x19, RUN_PAIR(d, e)) RUN_DAD(0x29, RUN_HL) RUN_DAD(0x39, sp)
+		RUN_PUSH(0xc5, RUN_PAIR(b, c)) RUN_PUSH(0xd5, RUN_PAIR(d, e)) RUN_PUSH(0xe5, RUN_HL)
+		RUN_POP(0xc1, b, c) RUN_POP(0xd1, d, e) RUN_POP(0xe1, h, l)
+
+		RUN_JCC(0xc2) RUN_JCC(0xca) RUN_JCC(0xd2) RUN_JCC(0xda)
+		RUN_JCC(0xe2) RUN_JCC(0xea) RUN_JCC(0xf2) RUN_JCC(0xfa)
+		RUN_CCC(0xc4) RUN_CCC(0xcc) RUN_CCC(0xd4) RUN_CCC(0xdc)
+		RUN_CCC(0xe4) RUN_CCC(0xec) RUN_CCC(0xf4) RUN_CCC(0xfc)
+		RUN_RCC(0xc0) RUN_RCC(0xc8) RUN_RCC(0xd0) RUN_RCC(0xd8)
+		RUN_RCC(0xe0) RUN_RCC(0xe8) RUN_RCC(0xf0) RUN_RCC(0xf8)
+		RUN_RST(0xc7) RUN_RST(0xcf) RUN_RST(0xd7) RUN_RST(0xdf)
+		RUN_RST(0xe7) RUN_RST(0xef) RUN_RST(0xf7) RUN_RST(0xff)
+
+		case 0x34: // INR M
+		{
+			uint8_t val = RUN_READ8(RUN_HL);
+			RUN_ALU_INR(val);
+			RUN_WRITE8(RUN_HL, val);
+			RUN_NEXT(1, CYCLES_INR_MEM);
+		}
+		case 0x35: // DCR M
+		{
+			uint8_t val = RUN_READ8(RUN_HL);
+			RUN_ALU_DCR(val);
+			RUN_WRITE8(RUN_HL, val);
+			RUN_NEXT(1, CYCLES_DCR_MEM);
+		}
+		case 0xf5: // PUSH PSW
+			RUN_FLAGS();
+			sp -= 2;
+			RUN_WRITE16(sp, RUN_PAIR(a, f));
+			RUN_NEXT(1, CYCLES_PUSH);
+		case 0xf1: // POP PSW
+			RUN_SET_PAIR(a, f, RUN_READ16(sp));
+			RUN_LAZY_RESET();
+			sp += 2;
+			RUN_NEXT(1, CYCLES_POP);
+		case 0x36: // MVI M
+			RUN_WRITE8(RUN_HL, RUN_IMM8);
+			RUN_NEXT(2, CYCLES_MVI_MEM);
+		case 0x31: // LXI SP
+			sp = RUN_IMM16;
+			RUN_NEXT(3, CYCLES_LXI);
+		case 0x33: // INX SP
+			sp++;
+			RUN_NEXT(1, CYCLES_INX);
+		case 0x3b: // DCX SP
+			sp--;
+			RUN_NEXT(1, CYCLES_DCX);
+		case 0x02: // STAX B
+			RUN_WRITE8(RUN_PAIR(b, c), a);
+			RUN_NEXT(1, CYCLES_STAX);
+		case 0x12: // STAX D
+			RUN_WRITE8(RUN_PAIR(d, e), a);
+			RUN_NEXT(1, CYCLES_STAX);
+		case 0x0a: // LDAX B
+			a = RUN_READ8(RUN_PAIR(b, c));
+			RUN_NEXT(1, CYCLES_LDAX);
+		case 0x1a: // LDAX D
+			a = RUN_READ8(RUN_PAIR(d, e));
+			RUN_NEXT(1, CYCLES_LDAX);
+		case 0x22: // SHLD
+			RUN_WRITE16(RUN_IMM16, RUN_HL);
+			RUN_NEXT(3, CYCLES_SHLD);
+		case 0x2a: // LHLD
+			RUN_SET_PAIR(h, l, RUN_READ16(RUN_IMM16));
+			RUN_NEXT(3, CYCLES_LHLD);
+		case 0x32: // STA
+			RUN_WRITE8(RUN_IMM16, a);
+			RUN_NEXT(3, CYCLES_STA);
+		case 0x3a: // LDA
+			a = RUN_READ8(RUN_IMM16);
+			RUN_NEXT(3, CYCLES_LDA);
+
+		case 0x07: // RLC
+			if (a & 0x80) { a = (uint8_t)(a << 1) | 1; f |= FLAGS_CARRY; }
+			else { a = (uint8_t)(a << 1); f &= (uint8_t)~FLAGS_CARRY; }
+			RUN_NEXT(1, CYCLES_RLC);
+		case 0x0f: // RRC
+			if (a & 1) { a = (a >> 1) | 0x80; f |= FLAGS_CARRY; }
+			else { a >>= 1; f &= (uint8_t)~FLAGS_CARRY; }
+			RUN_NEXT(1, CYCLES_RRC);
+		case 0x17: // RAL
+		{
+			uint8_t high_bit = a & 0x80;
+			a = (uint8_t)(a << 1) | (f & FLAGS_CARRY ? 1 : 0);
+			f = high_bit ? (f | FLAGS_CARRY) : (f & (uint8_t)~FLAGS_CARRY);
+			RUN_NEXT(1, CYCLES_RAL);
+		}
+		case 0x1f: // RAR
+		{
+			uint8_t low_bit = a & 1;
+			a = (a >> 1) | (f & FLAGS_CARRY ? 0x80 : 0);
+			f = low_bit ? (f | FLAGS_CARRY) : (f & (uint8_t)~FLAGS_CARRY);
+			RUN_NEXT(1, CYCLES_RAR);
+		}
+		case 0x27: // DAA
+		{
+			uint8_t val = a, add = 0;
+			RUN_FLAGS();
+			if ((val & 0xf) > 9 || f & FLAGS_H)
+				add += 0x06;
+			val += add;
+			if (((val & 0xf0) >> 4) > 9 || f & FLAGS_CARRY)
+				add += 0x60;
+			RUN_ALU_ADD(add);
+			RUN_NEXT(1, CYCLES_DAA);
+		}
+		case 0x2f: // CMA
+			a = ~a;
+			RUN_NEXT(1, CYCLES_CMA);
+		case 0x37: // STC
+			f |= FLAGS_CARRY;
+			RUN_NEXT(1, CYCLES_STC);
+		case 0x3f: // CMC
+			f ^= FLAGS_CARRY;
+			RUN_NEXT(1, CYCLES_CMC);
+
+		case 0xc6: RUN_ALU_ADD(RUN_IMM8); RUN_NEXT(2, CYCLES_ADI);
+		case 0xce: RUN_ALU_ADD((uint16_t)RUN_IMM8 + RUN_CARRY_IN); RUN_NEXT(2, CYCLES_ACI);
+		case 0xd6: RUN_ALU_SUB(RUN_IMM8, true); RUN_NEXT(2, CYCLES_SUI);
+		case 0xde: RUN_ALU_SUB((uint16_t)RUN_IMM8 + RUN_CARRY_IN, true); RUN_NEXT(2, CYCLES_SBI);
+		case 0xe6: RUN_ALU_ANA(RUN_IMM8); RUN_CLR_H(); RUN_NEXT(2, CYCLES_ANI);
+		case 0xee: RUN_ALU_XRA(RUN_IMM8); RUN_NEXT(2, CYCLES_XRI);
+		case 0xf6: RUN_ALU_ORA(RUN_IMM8); RUN_NEXT(2, CYCLES_ORI);
+		case 0xfe: RUN_ALU_SUB(RUN_IMM8, false); RUN_NEXT(2, CYCLES_CPI);
+
+		case 0xc3: // JMP
+#ifdef ALTAIR_BDOS_TRAP
+			if (UNLIKELY(pc == I8080_BDOS_VECTOR) && primary)
+			{
+				RUN_SAVE();
+				uint8_t t_states = i8080_bdos_trap(cpu);
+				RUN_LOAD();
+				if (t_states)
+				{
+					cycles += t_states;
+					if (pc == I8080_BDOS_VECTOR)
+						goto run_exit; // Waiting for console input
+					break;
+				}
+			}
+#endif
+			pc = RUN_IMM16;
+			cycles += CYCLES_JMP;
+			break;
+		case 0xcd: // CALL
+			sp -= 2;
+			RUN_WRITE16(sp, pc + 3);
+			pc = RUN_IMM16;
+			cycles += CYCLES_CALL;
+			break;
+		case 0xc9: // RET
+			pc = RUN_READ16(sp);
+			sp += 2;
+			cycles += CYCLES_RET;
+			break;
+		case 0xe9: // PCHL
+			pc = RUN_HL;
+			cycles += CYCLES_PCHL;
+			break;
+		case 0xe3: // XTHL
+		{
+			uint16_t temp = RUN_READ16(sp);
+			RUN_WRITE16(sp, RUN_HL);
+			RUN_SET_PAIR(h, l, temp);
+			RUN_NEXT(1, CYCLES_XTHL);
+		}
+		case 0xeb: // XCHG
+		{
+			uint8_t t = h; h = d; d = t;
+			t = l; l = e; e = t;
+			RUN_NEXT(1, CYCLES_XCHG);
+		}
+		case 0xf9: // SPHL
+			sp = RUN_HL;
+			RUN_NEXT(1, CYCLES_SPHL);
+		case 0xf3: // DI
+			f &= (uint8_t)~FLAGS_IF;
+			RUN_NEXT(1, CYCLES_DI);
+		case 0xfb: // EI
+			f |= FLAGS_IF;
+			// A batch that would end before the next instruction, or should end for an interrupt,
+			// ends here instead: the next one runs that instruction before accepting any
+			if (UNLIKELY(I8080_INTERRUPT_WAITING(cpu) || cycles + CYCLES_EI >= limit || cpu->exit_requested))
+			{
+				pc++;
+				cycles += CYCLES_EI;
+				cpu->ei_pending = true;
+				goto run_exit;
+			}
+			RUN_NEXT(1, CYCLES_EI);
+
+		case 0xd3: // OUT
+		case 0xdb: // IN
+		{
+			uint8_t port = RUN_IMM8;
+			RUN_SAVE();
+			cpu->t_states = t_start + cycles;
+			cpu->instruction_count += instructions; // Both as the port handlers see them
+			instructions = 0;
+			cycles += (op_code == 0xdb) ? i8080_in(cpu, op_code) : i8080_out(cpu, op_code);
+			RUN_LOAD();
+			if (!i8080_is_builtin_port(port))
+			{
+				goto run_exit;
+			}
+			break;
+		}
+
+		case 0x76: // HLT (executes as NOP) ends the batch
+			pc++;
+			cycles += CYCLES_NOP;
+			cpu->halted = true;
+			goto run_exit;
+
+		default: // NOP and undefined opcodes
+			RUN_NEXT(1, CYCLES_NOP);
+		}
+	}
+
+#ifdef ALTAIR_PANEL_DUTY
+	// Sample points only shorten the loop, so the per-instruction path does not change
+	if (cycles < n_cycles && !cpu->exit_requested)
+	{
+		i8080_duty_sample(pc, RUN_FETCH8(pc)); // The bus shows this opcode fetch
+		duty_point += I8080_DUTY_CYCLES;
+		limit = duty_point < n_cycles ? duty_point : n_cycles;
+		goto run_loop;
+	}
+#endif
+
+run_exit:
+	RUN_SAVE();
+	cpu->t_states = t_start + cycles;
+#ifdef ALTAIR_PANEL_DUTY
+	if (primary)
+		i8080_duty.countdown = duty_point > cycles ? duty_point - cycles : 0;
+#endif
+	if (primary)
+		I8080_PROFILE_T_STATES(cycles);
+	cpu->instruction_count += instructions;
+
+	// Leave the bus showing the next opcode fetch, as i8080_cycle would
+	cpu->address_bus = pc;
+	cpu->data_bus = fetch8(mem, pc);
+	cpu->cpuStatus = STATUS_MEMORY_READ;
+
+#ifdef ALTAIR_INTERP
+	if (primary)
+		interp_restore(interp0, &interp_saved);
+#endif
+	return cycles;
+}
+
+#ifdef RUN_VARIANTS
+// Each copy is a function of its own, so the plain one compiles exactly as without the options.
+// The copies that only run under the debugger stay in flash with ALTAIR_SRAM_PLACEMENT.
+#define RUN_VARIANT(placement, name, mem, primary, tracing, checking, basic) \
+	static __attribute__((noinline)) placement uint32_t name(intel8080_t *cpu, uint32_t n_cycles) \
+	{ return run_batch(cpu, n_cycles, mem, primary, tracing, checking, basic); }
+RUN_VARIANT(I8080_IN_RAM, run_plain, &memory_main, true, false, false, false)
+#ifdef ALTAIR_BASIC_FP
+RUN_VARIANT(I8080_IN_RAM, run_basic, &memory_main, true, false, false, true)
+#endif
+#ifdef ALTAIR_TRACE
+RUN_VARIANT(, run_traced, &memory_main, true, true, false, false)
+#endif
+#ifdef ALTAIR_BREAKPOINTS
+RUN_VARIANT(, run_checked, &memory_main, true, false, true, false)
+#endif
+#if defined(ALTAIR_TRACE) && defined(ALTAIR_BREAKPOINTS)
+RUN_VARIANT(, run_traced_checked, &memory_main, true, true, true, false)
+#endif
+#ifdef ALTAIR_SECOND_MACHINE
+RUN_VARIANT(I8080_IN_RAM, run_second, &memory_second, false, false, false, false)
+#ifdef ALTAIR_BASIC_FP
+RUN_VARIANT(I8080_IN_RAM, run_second_basic, &memory_second, false, false, false, true)
+#endif
+#endif
+
+I8080_IN_RAM uint32_t i8080_run(intel8080_t *cpu, uint32_t n_cycles)
+{
+#ifdef ALTAIR_SECOND_MACHINE
+	if (cpu->memory == &memory_second)
+	{
+#ifdef ALTAIR_BASIC_FP
+		if (i8080_basic_fp_present(&memory_second))
+			return run_second_basic(cpu, n_cycles);
+#endif
+		return run_second(cpu, n_cycles);
+	}
+#endif
+#ifdef ALTAIR_BREAKPOINTS
+	if (UNLIKELY(i8080_break.armed))
+	{
+#ifdef ALTAIR_TRACE
+		if (i8080_trace.enabled)
+			return run_traced_checked(cpu, n_cycles);
+#endif
+		return run_checked(cpu, n_cycles);
+	}
+#endif
+#ifdef ALTAIR_TRACE
+	if (i8080_trace.enabled)
+		return run_traced(cpu, n_cycles);
+#endif
+#ifdef ALTAIR_BASIC_FP
+	if (i8080_basic_fp_present(&memory_main))
+		return run_basic(cpu, n_cycles);
+#endif
+	return run_plain(cpu, n_cycles);
+}
+#endif
@@ -2,6 +2,7 @@
 #define _INTEL8080_H_
 
 #include "types.h"
+#include <stdbool.h>
 
 #define FLAGS_CARRY		0x1
 #define FLAGS_PARITY		0x4
@@ -64,6 +65,54 @@ typedef void (*port_out)(uint8_t b);
 typedef uint8_t (*port_in)(void);
 typedef uint8_t (*read_sense_switches)(void);
 
+// Disk DMA: OUT 0x0B/0x0C load the address (IN 0x0C reads back its high byte). IN 0x0B stores the
+// DISK_DMA_SECTOR_SIZE bytes that many IN 0x0A would return there, advances the address and
+// returns 0. The BIOS on disks/cpm63k_dma.dsk reads sectors this way instead of a 137-byte IN loop.
+#define DISK_DMA_PORT_LOW 0x0b
+#define DISK_DMA_PORT_HIGH 0x0c
+#define DISK_DMA_SECTOR_SIZE 137
+
+// Interrupts: i8080_interrupt raises a request for RST n. Requests are accepted at the start of
+// a batch (i8080_run) or instruction (i8080_cycle) while interrupts are enabled, lowest n
+// first, except right after EI: as on the 8080 the instruction that follows it runs first, so
+// an EI; RET at the end of a handler returns before the next request nests another. Setting
+// bit 7 (receive interrupt enable) in the 2SIO port 1 control register (OUT 0x10) requests
+// I8080_SIO_RX_RST whenever a console character is waiting.
+#ifndef I8080_SIO_RX_RST
+#define I8080_SIO_RX_RST 5
+#endif
+#define I8080_SIO_RX_INTERRUPT 0x80
+
+// 2SIO port 1 (IN/OUT 0x10 and 0x11) is a 6850 ACIA with I8080_SIO_FIFO_SIZE byte receive and
+// transmit FIFOs, timed in T-states. A status read only looks at the FIFOs: console input is
+// moved into the receive FIFO by a term_in poll at most every I8080_SIO_POLL_T_STATES while it
+// is empty, so a guest spinning on the status port does not reach the console queues on every
+// read. With a line rate set (I8080_SIO_BAUD, i8080_sio_set_baud) one character arrives per
+// character time, and each byte written takes up the transmit FIFO for a character time:
+// transmit buffer empty is clear while it is full. The byte itself goes to term_out at once.
+// Character times are those of a 10-bit frame at I8080_SIO_CLOCK_HZ, the Altair's 2 MHz.
+#ifndef I8080_SIO_BAUD
+#define I8080_SIO_BAUD 0 // Unlimited
+#endif
+#ifndef I8080_SIO_FIFO_SIZE
+#define I8080_SIO_FIFO_SIZE 16
+#endif
+#ifndef I8080_SIO_POLL_T_STATES
+#define I8080_SIO_POLL_T_STATES 256
+#endif
+#define I8080_SIO_CLOCK_HZ 2000000
+
+typedef struct
+{
+	uint32_t baud;					// Line rate, 0 unlimited
+	uint32_t char_t_states;			// T-states per character at baud, 0 unlimited
+	uint32_t rx_poll_at;			// T-state of the next term_in poll
+	uint32_t tx_free_at;			// T-state the transmit FIFO runs empty
+	uint8_t rx[I8080_SIO_FIFO_SIZE];
+	uint8_t rx_head;
+	uint8_t rx_count;
+} i8080_sio_t;
+
 typedef struct
 {
 	port_out disk_select;
@@ -74,11 +123,15 @@ typedef struct
 	port_in read;
 } disk_controller_t;
 
+struct memory_space;
+
 typedef struct
 {
 	uint8_t data_bus;
 	uint16_t address_bus;
 
+	struct memory_space *memory;	// Address space the CPU runs in (memory.h)
+
 	uint8_t current_op_code;
 
 	registers_t registers;
@@ -92,9 +145,23 @@ typedef struct
 	uint8_t cpuStatus;
 
 	disk_controller_t disk_controller;
+	uint16_t disk_dma;				// Target address of the next DMA sector read
+
+	uint8_t interrupt_request;		// Bit n: RST n requested (core 0)
+	uint8_t sio_control;			// Last 2SIO port 1 control byte
+	bool ei_pending;				// The last instruction was EI, no interrupt before the next one
+	i8080_sio_t sio;				// 2SIO port 1 FIFOs and line timing
+	uint32_t t_states;				// T-states executed, wraps. Inside i8080_run only kept up to date
+									// for IN and OUT, which time the 2SIO with it
+
+	volatile bool exit_requested;	// Ask i8080_run to return at the next instruction boundary
+	uint32_t instruction_count;		// Instructions executed, wraps (used for rate metrics). Kept up
+									// to date for IN and OUT like t_states
+	uint32_t idle_polls;			// Console polls that found no input since the last console I/O
+	bool halted;					// The last i8080_run batch ended on HLT
 } intel8080_t;
 
-void i8080_reset(intel8080_t *cpu, port_in in, port_out out, read_sense_switches sense,
+void i8080_reset(intel8080_t *cpu, struct memory_space *memory, port_in in, port_out out, read_sense_switches sense,
 		 disk_controller_t *disk_controller, io_port_in_fn io_in, io_port_out_fn io_out);
 void i8080_deposit(intel8080_t *cpu, uint8_t data);
 void i8080_deposit_next(intel8080_t *cpu, uint8_t data);
@@ -102,6 +169,26 @@ void i8080_deposit_next(intel8080_t *cpu, uint8_t data);
 void i8080_examine(intel8080_t *cpu, uint16_t address);
 void i8080_examine_next(intel8080_t *cpu);
 
-void i8080_cycle(intel8080_t *cpu);
+// Execute one instruction, returns the number of T-states it took
+uint8_t i8080_cycle(intel8080_t *cpu);
+
+// Execute instructions until at least n_cycles T-states have run, HLT, an IN/OUT to a
+// port outside the built-in console/disk set, or i8080_request_exit(). Registers are kept
+// in locals and written back on exit. Returns the number of T-states executed.
+uint32_t i8080_run(intel8080_t *cpu, uint32_t n_cycles);
+void i8080_request_exit(intel8080_t *cpu);
+
+// Request RST rst (0-7) and end the running batch so it is seen (core 0)
+void i8080_interrupt(intel8080_t *cpu, uint8_t rst);
+
+// Set the 2SIO port 1 line rate in baud, 0 for unlimited. i8080_reset sets I8080_SIO_BAUD.
+void i8080_sio_set_baud(intel8080_t *cpu, uint32_t baud);
+
+// Next console character for code standing in for the guest's (i8080_bdos.c), from the 2SIO
+// receive FIFO first so nothing the guest has buffered is overtaken. 0 if there is none.
+uint8_t i8080_console_read(intel8080_t *cpu);
+
+// Put ch back at the front of the 2SIO receive FIFO, for the guest's next read
+void i8080_console_unread(intel8080_t *cpu, uint8_t ch);
 
 #endif
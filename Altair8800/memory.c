@@ -4,20 +4,222 @@
 // Altair system memory - 64KB
 uint8_t memory[64 * 1024] = {0};
 
+#if (ALTAIR_BANK_COMMON_BASE & MEMORY_PAGE_MASK) != 0 || ALTAIR_BANK_COMMON_BASE > 0x10000
+#error "ALTAIR_BANK_COMMON_BASE must be a page aligned address within 64KB"
+#endif
+
+#if ALTAIR_MEMORY_BANKS > 1
+// Banked part of banks 1..N-1; the common area always comes from memory[]
+static uint8_t bank_memory[ALTAIR_MEMORY_BANKS - 1][ALTAIR_BANK_COMMON_BASE];
+#endif
+
+// Writes to ROM pages land here and are never read back
+static uint8_t rom_write_sink[MEMORY_PAGE_SIZE];
+
+#ifdef ALTAIR_DIRTY_PAGES
+static uint8_t main_dirty[ALTAIR_MEMORY_BANKS][MEMORY_PAGES];
+#endif
+
+// Flat identity mapping of memory[], valid before any init code runs
+#define MEMORY_PAGE(n) &memory[(n) << MEMORY_PAGE_SHIFT]
+#define MEMORY_PAGES_4(n) MEMORY_PAGE(n), MEMORY_PAGE(n + 1), MEMORY_PAGE(n + 2), MEMORY_PAGE(n + 3)
+#define MEMORY_PAGES_16(n) MEMORY_PAGES_4(n), MEMORY_PAGES_4(n + 4), MEMORY_PAGES_4(n + 8), MEMORY_PAGES_4(n + 12)
+#define MEMORY_PAGES_64(n) MEMORY_PAGES_16(n), MEMORY_PAGES_16(n + 16), MEMORY_PAGES_16(n + 32), MEMORY_PAGES_16(n + 48)
+#define MEMORY_PAGES_256 MEMORY_PAGES_64(0), MEMORY_PAGES_64(64), MEMORY_PAGES_64(128), MEMORY_PAGES_64(192)
+
+memory_space_t memory_main = {
+    .read_map = {MEMORY_PAGES_256},
+    .write_map = {MEMORY_PAGES_256},
+#ifdef ALTAIR_DIRTY_PAGES
+    .dirty = main_dirty[0],
+    .dirty_maps = main_dirty,
+#endif
+    .ram = memory,
+#if ALTAIR_MEMORY_BANKS > 1
+    .banked = bank_memory,
+#endif
+    .banks = ALTAIR_MEMORY_BANKS,
+};
+
+#ifdef ALTAIR_SECOND_MACHINE
+// Mapped by the memory_reset that starts the second machine
+static uint8_t second_ram[64 * 1024];
+#ifdef ALTAIR_DIRTY_PAGES
+static uint8_t second_dirty[1][MEMORY_PAGES];
+#endif
+
+memory_space_t memory_second = {
+#ifdef ALTAIR_DIRTY_PAGES
+    .dirty = second_dirty[0],
+    .dirty_maps = second_dirty,
+#endif
+    .ram = second_ram,
+    .banks = 1,
+};
+#endif
+
 // ROM data stored in flash (XIP)
 #include "88dskrom.h"
 #include "8krom.h"
 
+static uint8_t* page_backing(memory_space_t* mem, uint8_t bank, uint16_t page)
+{
+    uint16_t offset = page << MEMORY_PAGE_SHIFT;
+
+#if ALTAIR_MEMORY_BANKS > 1
+    if (bank != 0 && offset < ALTAIR_BANK_COMMON_BASE)
+    {
+        return &mem->banked[bank - 1][offset];
+    }
+#else
+    (void)bank;
+#endif
+    return &mem->ram[offset];
+}
+
+static void map_page(memory_space_t* mem, uint16_t page)
+{
+    uint8_t* backing = page_backing(mem, mem->current_bank, page);
+
+    mem->read_map[page] = backing;
+    mem->write_map[page] = mem->page_rom[page] ? rom_write_sink : backing;
+}
+
+void memory_reset(memory_space_t* mem)
+{
+    memset(mem->ram, 0x00, 64 * 1024);
+#if ALTAIR_MEMORY_BANKS > 1
+    if (mem->banks > 1)
+    {
+        memset(mem->banked, 0x00, (size_t)(mem->banks - 1) * ALTAIR_BANK_COMMON_BASE);
+    }
+#endif
+    memset(mem->page_rom, 0, sizeof(mem->page_rom));
+    mem->current_bank = 0;
+#ifdef ALTAIR_DIRTY_PAGES
+    memset(mem->dirty_maps, 1, (size_t)mem->banks * MEMORY_PAGES);
+    mem->dirty = mem->dirty_maps[0];
+#endif
+
+    for (uint16_t page = 0; page < MEMORY_PAGES; page++)
+    {
+        map_page(mem, page);
+    }
+}
+
+void memory_set_rom(memory_space_t* mem, uint16_t address, uint32_t length, bool rom)
+{
+    if (length == 0)
+    {
+        return;
+    }
+
+    uint32_t last = (uint32_t)address + length - 1;
+    if (last > 0xffff)
+    {
+        last = 0xffff;
+    }
+
+    for (uint32_t page = address >> MEMORY_PAGE_SHIFT; page <= (last >> MEMORY_PAGE_SHIFT); page++)
+    {
+        mem->page_rom[page] = rom;
+        map_page(mem, (uint16_t)page);
+    }
+}
+
+bool memory_is_rom(const memory_space_t* mem, uint16_t address)
+{
+    return mem->page_rom[address >> MEMORY_PAGE_SHIFT];
+}
+
+bool memory_select_bank(memory_space_t* mem, uint8_t bank)
+{
+    if (bank >= mem->banks)
+    {
+        return false;
+    }
+
+    if (bank != mem->current_bank)
+    {
+        mem->current_bank = bank;
+#ifdef ALTAIR_DIRTY_PAGES
+        mem->dirty = mem->dirty_maps[bank];
+#endif
+        for (uint16_t page = 0; page < (ALTAIR_BANK_COMMON_BASE >> MEMORY_PAGE_SHIFT); page++)
+        {
+            map_page(mem, page);
+        }
+    }
+    return true;
+}
+
+uint8_t memory_get_bank(const memory_space_t* mem)
+{
+    return mem->current_bank;
+}
+
+uint8_t* memory_bank_page(memory_space_t* mem, uint8_t bank, uint16_t page)
+{
+    return page_backing(mem, bank, page);
+}
+
+void memory_mark_dirty_range(memory_space_t* mem, uint16_t address, uint32_t length)
+{
+    for (uint32_t offset = 0; offset < length; offset += MEMORY_PAGE_SIZE)
+    {
+        memory_mark_dirty(mem, (uint16_t)(address + offset));
+    }
+    if (length != 0)
+    {
+        memory_mark_dirty(mem, (uint16_t)(address + length - 1));
+    }
+}
+
+bool memory_page_dirty(const memory_space_t* mem, uint8_t bank, uint16_t page)
+{
+#ifdef ALTAIR_DIRTY_PAGES
+    if (page >= (ALTAIR_BANK_COMMON_BASE >> MEMORY_PAGE_SHIFT))
+    {
+        for (uint8_t b = 0; b < mem->banks; b++)
+        {
+            if (mem->dirty_maps[b][page])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    return mem->dirty_maps[bank][page] != 0;
+#else
+    (void)mem;
+    (void)bank;
+    (void)page;
+    return true;
+#endif
+}
+
+void memory_dirty_clear(memory_space_t* mem)
+{
+#ifdef ALTAIR_DIRTY_PAGES
+    memset(mem->dirty_maps, 0, (size_t)mem->banks * MEMORY_PAGES);
+#else
+    (void)mem;
+#endif
+}
+
 // Load disk boot loader ROM into memory at specified address
-void loadDiskLoader(uint16_t address)
+void loadDiskLoader(memory_space_t* mem, uint16_t address)
 {
-    // Copy ROM data from flash to RAM
-    memcpy(&memory[address], disk_loader_rom, sizeof(disk_loader_rom));
+    // Copy ROM data from flash to RAM, then write protect it like the real PROM
+    memcpy(&mem->ram[address], disk_loader_rom, sizeof(disk_loader_rom));
+    memory_mark_dirty_range(mem, address, sizeof(disk_loader_rom));
+    memory_set_rom(mem, address, sizeof(disk_loader_rom), true);
 }
 
 // Load 8K BASIC ROM into memory at specified address
-void load8kRom(uint16_t address)
+void load8kRom(memory_space_t* mem, uint16_t address)
 {
     // Copy ROM data from flash to RAM
-    memcpy(&memory[address], basic_8k_rom, sizeof(basic_8k_rom));
+    memcpy(&mem->ram[address], basic_8k_rom, sizeof(basic_8k_rom));
+    memory_mark_dirty_range(mem, address, sizeof(basic_8k_rom));
 }
@@ -2,33 +2,130 @@
 #define _MEMORY_H_
 
 #include "altair_panel.h"
+#include "i8080_heatmap.h"
 #include "types.h"
+#include <stdbool.h>
 
+// Number of 64KB memory banks (bank 0 is the flat memory[] array)
+#ifndef ALTAIR_MEMORY_BANKS
+#define ALTAIR_MEMORY_BANKS 1
+#endif
+
+// Addresses at or above this boundary are common to all banks (MP/M style)
+#ifndef ALTAIR_BANK_COMMON_BASE
+#define ALTAIR_BANK_COMMON_BASE 0xC000
+#endif
+
+// I/O port used to select the active bank (write) and read it back
+#define MEMORY_BANK_PORT 64
+
+#define MEMORY_PAGE_SHIFT 8
+#define MEMORY_PAGE_SIZE (1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_MASK (MEMORY_PAGE_SIZE - 1)
+#define MEMORY_PAGES (64 * 1024 / MEMORY_PAGE_SIZE)
+
+// One memory_space_t is the address space of one machine: memory_main is the Altair, and
+// memory_second the one ALTAIR_SECOND_MACHINE runs on core 1 (a single bank).
+typedef struct memory_space
+{
+    // Per-page pointers used by read8/write8. ROM pages keep their read pointer but
+    // have their write pointer aimed at a discard page, so writes need no branch.
+    uint8_t* read_map[MEMORY_PAGES];
+    uint8_t* write_map[MEMORY_PAGES];
+#ifdef ALTAIR_DIRTY_PAGES
+    uint8_t* dirty;                      // Flags of the selected bank
+    uint8_t (*dirty_maps)[MEMORY_PAGES]; // One set per bank
+#endif
+    uint8_t* ram; // Bank 0 and the common area
+#if ALTAIR_MEMORY_BANKS > 1
+    uint8_t (*banked)[ALTAIR_BANK_COMMON_BASE]; // Banked part of banks 1 and up
+#endif
+    uint8_t banks;
+    uint8_t current_bank;
+    bool page_rom[MEMORY_PAGES];
+} memory_space_t;
+
+extern memory_space_t memory_main;
+#ifdef ALTAIR_SECOND_MACHINE
+extern memory_space_t memory_second;
+#endif
+
+// Bank 0 of memory_main
 extern uint8_t memory[64 * 1024];
 
-void loadDiskLoader(uint16_t address);
-void load8kRom(uint16_t address);
+void loadDiskLoader(memory_space_t* mem, uint16_t address);
+void load8kRom(memory_space_t* mem, uint16_t address);
+
+// The Altair 8K BASIC image load8kRom copies
+extern const unsigned char basic_8k_rom[];
+
+// Clear all banks, select bank 0 and drop all ROM protection
+void memory_reset(memory_space_t* mem);
+
+// Write protect (or unprotect) every page touched by [address, address + length)
+void memory_set_rom(memory_space_t* mem, uint16_t address, uint32_t length, bool rom);
+bool memory_is_rom(const memory_space_t* mem, uint16_t address);
+
+// Map bank into the pages below ALTAIR_BANK_COMMON_BASE, returns false if out of range
+bool memory_select_bank(memory_space_t* mem, uint8_t bank);
+uint8_t memory_get_bank(const memory_space_t* mem);
+
+// Backing store of a page of bank, pages from ALTAIR_BANK_COMMON_BASE up are the same in every bank
+uint8_t* memory_bank_page(memory_space_t* mem, uint8_t bank, uint16_t page);
+
+// Dirty page tracking (ALTAIR_DIRTY_PAGES) for incremental snapshots: a flag per page written
+// since memory_dirty_clear, a byte each so write8 marks it with one store. Banked pages are
+// tracked per bank, a write to the common area is marked in the bank selected at the time.
+// Without the option every page counts as dirty.
+static inline void memory_mark_dirty(memory_space_t* mem, uint16_t address)
+{
+#ifdef ALTAIR_DIRTY_PAGES
+    mem->dirty[address >> MEMORY_PAGE_SHIFT] = 1;
+#else
+    (void)mem;
+    (void)address;
+#endif
+}
+
+// Devices that copy straight into the pages mark what they wrote
+void memory_mark_dirty_range(memory_space_t* mem, uint16_t address, uint32_t length);
+bool memory_page_dirty(const memory_space_t* mem, uint8_t bank, uint16_t page);
+void memory_dirty_clear(memory_space_t* mem);
+
+// Inline memory operations for better performance. The cores fetch opcodes and operands with
+// fetch8 and fetch16, which are read8 and read16 without the ALTAIR_HEATMAP count.
+static inline uint8_t fetch8(const memory_space_t* mem, uint16_t address)
+{
+    return mem->read_map[address >> MEMORY_PAGE_SHIFT][address & MEMORY_PAGE_MASK];
+}
+
+static inline uint16_t fetch16(const memory_space_t* mem, uint16_t address)
+{
+    return fetch8(mem, address) | (fetch8(mem, address + 1) << 8);
+}
 
-// Inline memory operations for better performance
-static inline uint8_t read8(uint16_t address)
+static inline uint8_t read8(const memory_space_t* mem, uint16_t address)
 {
-    return memory[address];
+    I8080_HEATMAP_COUNT(mem, I8080_HEATMAP_READ, address);
+    return fetch8(mem, address);
 }
 
-static inline void write8(uint16_t address, uint8_t val)
+static inline void write8(memory_space_t* mem, uint16_t address, uint8_t val)
 {
-    memory[address] = val;
+    I8080_HEATMAP_COUNT(mem, I8080_HEATMAP_WRITE, address);
+    mem->write_map[address >> MEMORY_PAGE_SHIFT][address & MEMORY_PAGE_MASK] = val;
+    memory_mark_dirty(mem, address);
 }
 
-static inline uint16_t read16(uint16_t address)
+static inline uint16_t read16(const memory_space_t* mem, uint16_t address)
 {
-    return memory[address] | (memory[address + 1] << 8);
+    return read8(mem, address) | (read8(mem, address + 1) << 8);
 }
 
-static inline void write16(uint16_t address, uint16_t val)
+static inline void write16(memory_space_t* mem, uint16_t address, uint16_t val)
 {
-    memory[address] = val & 0xff;
-    memory[address + 1] = (val >> 8) & 0xff;
+    write8(mem, address, val & 0xff);
+    write8(mem, address + 1, (val >> 8) & 0xff);
 }
 
 #endif
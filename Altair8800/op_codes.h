@@ -53,7 +53,9 @@
 #define CYCLES_SBB		4
 #define CYCLES_SBI		7
 #define CYCLES_INR		5
+#define CYCLES_INR_MEM	10
 #define CYCLES_DCR		5
+#define CYCLES_DCR_MEM	10
 #define CYCLES_INX		5
 #define CYCLES_DCX		5
 #define CYCLES_DAD		10
@@ -75,15 +77,19 @@
 #define CYCLES_RRC		4
 #define CYCLES_RAL		4
 #define CYCLES_RAR		4
-#define CYCLES_RET		5
+#define CYCLES_RET		10
+#define CYCLES_RET_COND	11
+#define CYCLES_RET_SKIP	5
 #define CYCLES_CALL		17
+#define CYCLES_CALL_SKIP	11
 #define CYCLES_RST		11
 #define CYCLES_CMP		4
+#define CYCLES_ALU_MEM	7
 #define CYCLES_CPI		7
-#define CYCLES_STC		1
-#define CYCLES_CMC		2
-#define CYCLES_CMA		2
+#define CYCLES_STC		4
+#define CYCLES_CMC		4
+#define CYCLES_CMA		4
 #define CYCLES_PCHL		5
-#define CYCLES_DAA		5
+#define CYCLES_DAA		4
 
 #endif
\ No newline at end of file
@@ -1,20 +1,34 @@
 #include "pico_88dcdd_flash.h"
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
+#ifdef ALTAIR_FLASH_DISK_LOG
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#endif
+#ifdef ALTAIR_FLASH_STREAM
+#include "hardware/dma.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "pico/stdlib.h"
+#endif
+
 // Global disk controller instance
 pico_disk_controller_t pico_disk_controller;
 
 // Static patch pool - pre-allocated to avoid heap exhaustion
-// 256 patches × ~141 bytes = ~36KB
+// Free patches are chained through next_pool_index
 static sector_patch_t g_patch_pool[PATCH_POOL_SIZE];
-static uint16_t g_patch_pool_next_free = 0; // Next index to allocate
+static uint16_t g_patch_free_head = 0;      // First free patch (0xFFFF = none)
 static uint16_t g_patch_pool_used = 0;      // Number of patches currently in use
 static bool g_patch_pool_exhausted = false; // Set true when pool is full
 
 // Invalid index marker
 #define PATCH_INDEX_INVALID 0xFFFF
 
+
 static inline void set_status(uint8_t bit)
 {
     pico_disk_controller.current->status &= ~bit;
@@ -30,15 +44,667 @@ static const uint8_t STATUS_DEFAULT =
     STATUS_ENWD | STATUS_MOVE_HEAD | STATUS_HEAD | STATUS_IE | STATUS_TRACK_0 | STATUS_NRDA;
 
 // Hash function for sector index (fast bitwise AND for modulo)
-static inline uint8_t hash_sector(uint16_t index)
+static inline uint16_t hash_sector(uint16_t index)
+{
+    return (uint16_t)(index & (PATCH_HASH_SIZE - 1));
+}
+
+#ifdef ALTAIR_FLASH_STREAM
+// Image bytes are read by the XIP streaming engine, which DMA moves into this buffer: a disk read
+// is one burst from flash and leaves the XIP cache to the emulator's code. Word aligned, a track
+// and the partial words at both ends.
+static uint32_t g_flash_stage[(TRACK_SIZE + 6) / 4 + 1];
+static int g_flash_dma = -1;
+
+// Bytes [src, src + length) of flash, in g_flash_stage until the next call. Memory outside flash,
+// and reads larger than a track, are returned where they are
+static const uint8_t* flash_fetch(const uint8_t* src, uint32_t length)
+{
+    uintptr_t address = (uintptr_t)src;
+    if (address - XIP_BASE >= PICO_FLASH_SIZE_BYTES || length == 0 || length > TRACK_SIZE)
+    {
+        return src;
+    }
+    if (g_flash_dma < 0)
+    {
+        g_flash_dma = dma_claim_unused_channel(true);
+    }
+
+    uintptr_t first = address & ~(uintptr_t)3;
+    uint32_t words = (uint32_t)((address + length - first + 3) / 4);
+    while (!(xip_ctrl_hw->stat & XIP_STAT_FIFO_EMPTY_BITS))
+    {
+        (void)xip_ctrl_hw->stream_fifo; // Left over from an earlier stream
+    }
+    xip_ctrl_hw->stream_addr = (uint32_t)first;
+    xip_ctrl_hw->stream_ctr = words;
+
+    dma_channel_config config = dma_channel_get_default_config(g_flash_dma);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_XIP_STREAM);
+    dma_channel_configure(g_flash_dma, &config, g_flash_stage, (const void*)XIP_AUX_BASE, words, true);
+    dma_channel_wait_for_finish_blocking(g_flash_dma);
+    return (const uint8_t*)g_flash_stage + (address - first);
+}
+#else
+#define flash_fetch(src, length) ((void)(length), (src))
+#endif
+
+#ifdef ALTAIR_COMPRESSED_DISKS
+typedef struct
+{
+    int8_t drive; // -1 = empty
+    uint8_t track;
+    uint32_t last_used;
+    uint8_t data[TRACK_SIZE];
+} image_track_t;
+
+// Decompressed tracks shared by all compressed drives, the least recently used one is replaced
+static image_track_t g_image_tracks[IMAGE_TRACK_BUFFERS];
+static uint32_t g_image_track_clock = 0;
+
+// Decode one raw LZ4 block, false unless it produces exactly dst_len bytes
+static bool lz4_decode_block(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len)
+{
+    const uint8_t* ip = src;
+    const uint8_t* ip_end = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_len;
+
+    while (ip < ip_end)
+    {
+        uint8_t token = *ip++;
+
+        uint32_t length = token >> 4;
+        if (length == 15)
+        {
+            uint8_t extra;
+            do
+            {
+                if (ip >= ip_end)
+                {
+                    return false;
+                }
+                extra = *ip++;
+                length += extra;
+            } while (extra == 255);
+        }
+        if (length > (uint32_t)(ip_end - ip) || length > (uint32_t)(op_end - op))
+        {
+            return false;
+        }
+        memcpy(op, ip, length);
+        op += length;
+        ip += length;
+
+        // The last sequence is literals only
+        if (ip >= ip_end)
+        {
+            break;
+        }
+
+        if (ip_end - ip < 2)
+        {
+            return false;
+        }
+        uint32_t offset = (uint32_t)ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - dst))
+        {
+            return false;
+        }
+
+        length = token & 15;
+        if (length == 15)
+        {
+            uint8_t extra;
+            do
+            {
+                if (ip >= ip_end)
+                {
+                    return false;
+                }
+                extra = *ip++;
+                length += extra;
+            } while (extra == 255);
+        }
+        length += 4;
+        if (length > (uint32_t)(op_end - op))
+        {
+            return false;
+        }
+
+        // Matches may overlap their own output (runs of filler bytes), copy those bytewise
+        const uint8_t* match = op - offset;
+        if (offset >= length)
+        {
+            memcpy(op, match, length);
+            op += length;
+        }
+        else
+        {
+            while (length--)
+            {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == op_end;
+}
+
+// Decompress a track of a compressed image into a shared track buffer unless it is already there
+static const uint8_t* image_track(pico_disk_t* disk, uint8_t track)
+{
+    int8_t drive = (int8_t)(disk - pico_disk_controller.disk);
+    image_track_t* victim = &g_image_tracks[0];
+    for (int i = 0; i < IMAGE_TRACK_BUFFERS; i++)
+    {
+        image_track_t* buffer = &g_image_tracks[i];
+        if (buffer->drive == drive && buffer->track == track)
+        {
+            buffer->last_used = ++g_image_track_clock;
+            return buffer->data;
+        }
+        if (buffer->last_used < victim->last_used)
+        {
+            victim = buffer;
+        }
+    }
+
+    uint32_t start = (uint32_t)track * TRACK_SIZE;
+    uint32_t length = disk->disk_size - start < TRACK_SIZE ? disk->disk_size - start : TRACK_SIZE;
+    uint32_t block_length = disk->track_offsets[track + 1] - disk->track_offsets[track];
+    const uint8_t* block = flash_fetch(disk->disk_image_flash + disk->track_offsets[track], block_length);
+
+    if (block_length == length)
+    {
+        memcpy(victim->data, block, length);
+    }
+    else if (!lz4_decode_block(block, block_length, victim->data, length))
+    {
+        printf("[DISK] ERROR: Drive %d track %u does not decompress, reading zeros\n", drive, track);
+        memset(victim->data, 0, length);
+    }
+
+    victim->drive = drive;
+    victim->track = track;
+    victim->last_used = ++g_image_track_clock;
+    return victim->data;
+}
+
+// Drop any decompressed tracks of a drive whose image is being replaced
+static void image_tracks_forget(pico_disk_t* disk)
 {
-    return (uint8_t)(index & (PATCH_HASH_SIZE - 1));
+    int8_t drive = (int8_t)(disk - pico_disk_controller.disk);
+    for (int i = 0; i < IMAGE_TRACK_BUFFERS; i++)
+    {
+        if (g_image_tracks[i].drive == drive)
+        {
+            g_image_tracks[i].drive = -1;
+            g_image_tracks[i].last_used = 0;
+        }
+    }
 }
+#endif
+
+// Image bytes [offset, offset + length), which must not cross a track boundary: from flash, or
+// from the decompressed track for compressed images. Valid until the next read of an image
+static const uint8_t* image_data(pico_disk_t* disk, uint32_t offset, uint32_t length)
+{
+#ifdef ALTAIR_COMPRESSED_DISKS
+    if (disk->track_offsets)
+    {
+        return image_track(disk, (uint8_t)(offset / TRACK_SIZE)) + offset % TRACK_SIZE;
+    }
+#endif
+    return flash_fetch(&disk->disk_image_flash[offset], length);
+}
+
+#ifdef ALTAIR_FLASH_DISK_LOG
+// Patch log layout: one sector record per flash page in a circular region directly below the
+// Wi-Fi config sector. Records are only ever appended; the oldest sector is compacted (live
+// records copied to the head) and erased before the head wraps onto it, so every sector sees
+// the same number of erase cycles.
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#endif
+#ifndef PATCH_LOG_SIZE
+#define PATCH_LOG_SIZE (PICO_FLASH_SIZE_BYTES / 4)
+#endif
+#define PATCH_LOG_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE - PATCH_LOG_SIZE)
+#define PATCH_LOG_PAGES (PATCH_LOG_SIZE / FLASH_PAGE_SIZE)
+#define PATCH_LOG_PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define PATCH_LOG_MAGIC 0x50544348 // "PTCH" in hex
+
+// Stop accepting new sectors at 3/4 live so compaction always has garbage to reclaim
+#define PATCH_LOG_MAX_LIVE (PATCH_LOG_PAGES * 3 / 4)
+// Compact the oldest sector once this few pages are left, one sector is kept for relocation
+#define PATCH_LOG_COMPACT_PAGES (2 * PATCH_LOG_PAGES_PER_SECTOR)
+// Records saved per pico_disk_poll call, bounds how long core 1 is held off flash
+#define PATCH_LOG_BATCH 8
+
+_Static_assert(PATCH_LOG_SIZE % FLASH_SECTOR_SIZE == 0, "PATCH_LOG_SIZE must be whole flash sectors");
+_Static_assert(PATCH_LOG_SIZE >= 4 * FLASH_SECTOR_SIZE, "PATCH_LOG_SIZE must be at least 4 flash sectors");
+_Static_assert(PATCH_LOG_PAGES < PATCH_INDEX_INVALID, "PATCH_LOG_SIZE too large for 16-bit slots");
+
+typedef struct
+{
+    uint32_t magic;    // PATCH_LOG_MAGIC
+    uint32_t sequence; // Write order, the newest record of a sector wins on replay
+    uint32_t image_id; // Embedded image the sector belongs to
+    uint16_t index;    // Sector index
+    uint8_t drive;
+    uint8_t reserved;
+    uint8_t data[SECTOR_SIZE];
+    uint8_t padding[FLASH_PAGE_SIZE - 16 - SECTOR_SIZE - 4];
+    uint32_t crc; // CRC32 of everything above
+} patch_log_record_t;
+
+_Static_assert(sizeof(patch_log_record_t) == FLASH_PAGE_SIZE, "patch log record must fill one flash page");
+
+// RAM index of the log: sector index of each live slot (0xFFFF = free or superseded) and the
+// next slot in the per-drive log_hash chain
+static uint16_t g_log_sector[PATCH_LOG_PAGES];
+static uint16_t g_log_next[PATCH_LOG_PAGES];
+static uint16_t g_log_live = 0;  // Slots holding the current copy of a sector
+static uint16_t g_log_head = 0;  // Next page to program
+static uint16_t g_log_free = 0;  // Erased pages from the head onwards
+static uint32_t g_log_sequence = 0;
+static bool g_log_enabled = false;
+static bool g_log_full_reported = false;
+
+// Dirty patch tracking for pico_disk_poll
+static uint16_t g_patch_dirty = 0;
+static uint16_t g_persist_cursor = 0;
+static uint16_t g_evict_cursor = 0;
+static uint32_t g_patch_writes = 0;
+static uint32_t g_polled_writes = 0;
+static uint32_t g_first_dirty_us = 0;
+static uint32_t g_last_write_us = 0;
+static bool g_persist_pending = false;
+
+// CRC32 four bits at a time, quick enough to take over whole images at boot
+static const uint32_t crc32_nibble[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+                                          0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+                                          0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+    }
+    return crc;
+}
+
+static uint32_t crc32(const uint8_t* data, size_t length)
+{
+    return ~crc32_update(0xFFFFFFFF, data, length);
+}
+
+static inline const patch_log_record_t* log_record(uint16_t slot)
+{
+    return (const patch_log_record_t*)(XIP_BASE + PATCH_LOG_OFFSET + (uint32_t)slot * FLASH_PAGE_SIZE);
+}
+
+static bool log_record_valid(const patch_log_record_t* record)
+{
+    return record->magic == PATCH_LOG_MAGIC &&
+           record->crc == crc32((const uint8_t*)record, offsetof(patch_log_record_t, crc));
+}
+
+static bool log_page_erased(uint16_t slot)
+{
+    const uint32_t* words = (const uint32_t*)log_record(slot);
+    for (size_t i = 0; i < FLASH_PAGE_SIZE / sizeof(uint32_t); i++)
+    {
+        if (words[i] != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Core 1 runs Wi-Fi from XIP, so it is parked in RAM while flash is programmed or erased
+static uint32_t log_flash_lock(void)
+{
+    if (multicore_lockout_victim_is_initialized(1 - get_core_num()))
+    {
+        multicore_lockout_start_blocking();
+    }
+    return save_and_disable_interrupts();
+}
+
+static void log_flash_unlock(uint32_t ints)
+{
+    restore_interrupts(ints);
+    if (multicore_lockout_victim_is_initialized(1 - get_core_num()))
+    {
+        multicore_lockout_end_blocking();
+    }
+}
+
+// Find the current log slot of a sector, returns PATCH_INDEX_INVALID when only the image has it
+static uint16_t log_find(const pico_disk_t* disk, uint16_t sector_index)
+{
+    uint16_t slot = disk->log_hash[hash_sector(sector_index)];
+    while (slot != PATCH_INDEX_INVALID && g_log_sector[slot] != sector_index)
+    {
+        slot = g_log_next[slot];
+    }
+    return slot;
+}
+
+static void log_link(pico_disk_t* disk, uint16_t slot, uint16_t sector_index)
+{
+    uint16_t bucket = hash_sector(sector_index);
+    g_log_sector[slot] = sector_index;
+    g_log_next[slot] = disk->log_hash[bucket];
+    disk->log_hash[bucket] = slot;
+    g_log_live++;
+}
+
+static void log_unlink(pico_disk_t* disk, uint16_t slot)
+{
+    uint16_t* link = &disk->log_hash[hash_sector(g_log_sector[slot])];
+    while (*link != slot)
+    {
+        link = &g_log_next[*link];
+    }
+    *link = g_log_next[slot];
+    g_log_sector[slot] = PATCH_INDEX_INVALID;
+    g_log_next[slot] = PATCH_INDEX_INVALID;
+    g_log_live--;
+}
+
+// Program one record at the head and make it the current copy of its sector
+static void log_write(uint8_t drive, uint16_t sector_index, const uint8_t* data)
+{
+    pico_disk_t* disk = &pico_disk_controller.disk[drive];
+
+    // Built in RAM, flash cannot be read while it is being programmed
+    patch_log_record_t record;
+    memset(&record, 0xFF, sizeof(record));
+    record.magic = PATCH_LOG_MAGIC;
+    record.sequence = g_log_sequence++;
+    record.image_id = disk->image_id;
+    record.index = sector_index;
+    record.drive = drive;
+    memcpy(record.data, data, SECTOR_SIZE);
+    record.crc = crc32((const uint8_t*)&record, offsetof(patch_log_record_t, crc));
+
+    uint16_t slot = g_log_head;
+    uint32_t ints = log_flash_lock();
+    flash_range_program(PATCH_LOG_OFFSET + (uint32_t)slot * FLASH_PAGE_SIZE, (const uint8_t*)&record,
+                        FLASH_PAGE_SIZE);
+    log_flash_unlock(ints);
+
+    uint16_t previous = log_find(disk, sector_index);
+    if (previous != PATCH_INDEX_INVALID)
+    {
+        log_unlink(disk, previous);
+    }
+    log_link(disk, slot, sector_index);
+
+    g_log_head = (uint16_t)((g_log_head + 1) % PATCH_LOG_PAGES);
+    g_log_free--;
+}
+
+// Append a sector unless that would eat into the compaction reserve or overfill the log
+static bool log_append(uint8_t drive, uint16_t sector_index, const uint8_t* data)
+{
+    bool is_new = log_find(&pico_disk_controller.disk[drive], sector_index) == PATCH_INDEX_INVALID;
+    if (g_log_free <= PATCH_LOG_PAGES_PER_SECTOR || (is_new && g_log_live >= PATCH_LOG_MAX_LIVE))
+    {
+        if (!g_log_full_reported)
+        {
+            g_log_full_reported = true;
+            printf("[DISK] Patch log full (%u/%u live). Writes stay in RAM only!\n", g_log_live, PATCH_LOG_MAX_LIVE);
+        }
+        return false;
+    }
+    log_write(drive, sector_index, data);
+    return true;
+}
+
+// Grow the free run past the head over any pages that are already erased
+static void log_extend_free(void)
+{
+    while (g_log_free < PATCH_LOG_PAGES && log_page_erased((uint16_t)((g_log_head + g_log_free) % PATCH_LOG_PAGES)))
+    {
+        g_log_free++;
+    }
+}
+
+// Log has pages that are neither free nor live
+static bool log_has_garbage(void)
+{
+    return (uint32_t)g_log_free + g_log_live < PATCH_LOG_PAGES;
+}
+
+// Copy the live records of the oldest sector to the head, then erase it
+static bool log_compact(void)
+{
+    uint16_t tail = (uint16_t)((g_log_head + g_log_free) % PATCH_LOG_PAGES);
+    uint16_t first = (uint16_t)(tail - tail % PATCH_LOG_PAGES_PER_SECTOR);
+    bool head_sector = first == g_log_head - g_log_head % PATCH_LOG_PAGES_PER_SECTOR;
+
+    uint16_t live = 0;
+    for (uint16_t slot = first; slot < first + PATCH_LOG_PAGES_PER_SECTOR; slot++)
+    {
+        if (g_log_sector[slot] != PATCH_INDEX_INVALID)
+        {
+            live++;
+        }
+    }
+
+    // The head sector can only be erased when nothing in it is live
+    if (g_log_free == PATCH_LOG_PAGES || (live > 0 && (head_sector || live > g_log_free)))
+    {
+        return false;
+    }
+
+    for (uint16_t slot = first; slot < first + PATCH_LOG_PAGES_PER_SECTOR; slot++)
+    {
+        if (g_log_sector[slot] != PATCH_INDEX_INVALID)
+        {
+            const patch_log_record_t* record = log_record(slot);
+            uint8_t data[SECTOR_SIZE];
+            memcpy(data, record->data, SECTOR_SIZE);
+            log_write(record->drive, g_log_sector[slot], data);
+        }
+    }
+
+    uint32_t ints = log_flash_lock();
+    flash_range_erase(PATCH_LOG_OFFSET + (uint32_t)first * FLASH_PAGE_SIZE, FLASH_SECTOR_SIZE);
+    log_flash_unlock(ints);
+
+    if (head_sector)
+    {
+        g_log_head = first;
+        g_log_free = 0;
+    }
+    log_extend_free();
+    g_log_full_reported = false;
+    return true;
+}
+
+// Scan the log once at boot: find the newest record and the erased run after it
+static void log_init(void)
+{
+    extern char __flash_binary_end;
+    uint32_t binary_end = (uint32_t)((uintptr_t)&__flash_binary_end - XIP_BASE);
+
+    for (uint16_t slot = 0; slot < PATCH_LOG_PAGES; slot++)
+    {
+        g_log_sector[slot] = PATCH_INDEX_INVALID;
+        g_log_next[slot] = PATCH_INDEX_INVALID;
+    }
+    g_log_live = 0;
+    g_log_head = 0;
+    g_log_free = 0;
+    g_log_sequence = 0;
+    g_log_full_reported = false;
+    g_patch_dirty = 0;
+    g_persist_pending = false;
+
+    g_log_enabled = binary_end <= PATCH_LOG_OFFSET;
+    if (!g_log_enabled)
+    {
+        printf("[DISK] Patch log disabled: firmware ends at 0x%08lx, past log start 0x%08lx\n",
+               (unsigned long)binary_end, (unsigned long)PATCH_LOG_OFFSET);
+        return;
+    }
+
+    bool found = false;
+    uint16_t records = 0;
+    for (uint16_t slot = 0; slot < PATCH_LOG_PAGES; slot++)
+    {
+        const patch_log_record_t* record = log_record(slot);
+        if (log_record_valid(record))
+        {
+            records++;
+            if (!found || (int32_t)(record->sequence - (g_log_sequence - 1)) > 0)
+            {
+                found = true;
+                g_log_sequence = record->sequence + 1;
+                g_log_head = (uint16_t)((slot + 1) % PATCH_LOG_PAGES);
+            }
+        }
+    }
+
+    // Step over a page left half-programmed by a reset, it is garbage for compaction
+    for (uint16_t n = 0; n < PATCH_LOG_PAGES && !log_page_erased(g_log_head); n++)
+    {
+        g_log_head = (uint16_t)((g_log_head + 1) % PATCH_LOG_PAGES);
+    }
+    log_extend_free();
+
+    printf("[DISK] Patch log: %u KB at 0x%08lx, %u records, %u free pages\n", PATCH_LOG_SIZE / 1024,
+           (unsigned long)PATCH_LOG_OFFSET, records, g_log_free);
+}
+
+// Point a freshly loaded drive at the newest log record of each of its sectors
+static void log_load_drive(pico_disk_t* disk, uint8_t drive)
+{
+    // Forget slots indexed for the previous image
+    for (uint16_t i = 0; i < PATCH_HASH_SIZE; i++)
+    {
+        uint16_t slot = disk->log_hash[i];
+        while (slot != PATCH_INDEX_INVALID)
+        {
+            uint16_t next = g_log_next[slot];
+            g_log_sector[slot] = PATCH_INDEX_INVALID;
+            g_log_next[slot] = PATCH_INDEX_INVALID;
+            g_log_live--;
+            slot = next;
+        }
+        disk->log_hash[i] = PATCH_INDEX_INVALID;
+    }
+
+    if (!g_log_enabled)
+    {
+        return;
+    }
+
+    // Identify the image by its size and the CRC of all of it, so a firmware update that changes
+    // any track of an image drops its old patches. Blank images share patches per drive only.
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t offset = 0; offset < disk->disk_size; offset += TRACK_SIZE)
+    {
+        uint32_t length = disk->disk_size - offset < TRACK_SIZE ? disk->disk_size - offset : TRACK_SIZE;
+        crc = crc32_update(crc, image_data(disk, offset, length), length);
+    }
+    disk->image_id = ~crc ^ disk->disk_size;
+
+    uint16_t sectors = 0;
+    for (uint16_t slot = 0; slot < PATCH_LOG_PAGES; slot++)
+    {
+        const patch_log_record_t* record = log_record(slot);
+        if (record->magic != PATCH_LOG_MAGIC || record->drive != drive || record->image_id != disk->image_id ||
+            (uint32_t)(record->index + 1) * SECTOR_SIZE > disk->disk_size || !log_record_valid(record))
+        {
+            continue;
+        }
+
+        uint16_t current = log_find(disk, record->index);
+        if (current == PATCH_INDEX_INVALID)
+        {
+            log_link(disk, slot, record->index);
+            sectors++;
+        }
+        else if ((int32_t)(record->sequence - log_record(current)->sequence) > 0)
+        {
+            log_unlink(disk, current);
+            log_link(disk, slot, record->index);
+        }
+    }
+
+    if (sectors > 0)
+    {
+        printf("[DISK] Drive %u: %u sectors restored from patch log\n", drive, sectors);
+    }
+}
+
+// Append up to max dirty patches to the log, returns how many were saved
+static uint16_t persist_dirty(uint16_t max)
+{
+    uint16_t saved = 0;
+    for (uint16_t n = 0; n < PATCH_POOL_SIZE && saved < max && g_patch_dirty > 0; n++)
+    {
+        sector_patch_t* patch = &g_patch_pool[g_persist_cursor];
+        g_persist_cursor = (uint16_t)((g_persist_cursor + 1) % PATCH_POOL_SIZE);
+        if (patch->index == PATCH_INDEX_INVALID || !patch->dirty)
+        {
+            continue;
+        }
+        if (!log_append(patch->drive, patch->index, patch->data))
+        {
+            break;
+        }
+        patch->dirty = false;
+        g_patch_dirty--;
+        saved++;
+    }
+    return saved;
+}
+
+// Reuse a patch whose contents are already in the log, the RAM copy is only a cache
+static uint16_t evict_clean_patch(void)
+{
+    for (uint16_t n = 0; n < PATCH_POOL_SIZE; n++)
+    {
+        uint16_t idx = g_evict_cursor;
+        g_evict_cursor = (uint16_t)((g_evict_cursor + 1) % PATCH_POOL_SIZE);
+        sector_patch_t* patch = &g_patch_pool[idx];
+        if (patch->index == PATCH_INDEX_INVALID || patch->dirty)
+        {
+            continue;
+        }
+
+        pico_disk_t* disk = &pico_disk_controller.disk[patch->drive];
+        uint16_t* link = &disk->patch_hash[hash_sector(patch->index)];
+        while (*link != idx)
+        {
+            link = &g_patch_pool[*link].next_pool_index;
+        }
+        *link = patch->next_pool_index;
+        patch->index = PATCH_INDEX_INVALID;
+        return idx;
+    }
+    return PATCH_INDEX_INVALID;
+}
+#endif
 
 // Find a patch in the hash table, returns pool index or PATCH_INDEX_INVALID
 static uint16_t find_patch_index(pico_disk_t* disk, uint16_t sector_index)
 {
-    uint8_t bucket = hash_sector(sector_index);
+    uint16_t bucket = hash_sector(sector_index);
     uint16_t pool_idx = disk->patch_hash[bucket];
 
     while (pool_idx != PATCH_INDEX_INVALID)
@@ -52,21 +718,32 @@ static uint16_t find_patch_index(pico_disk_t* disk, uint16_t sector_index)
     return PATCH_INDEX_INVALID;
 }
 
-// Allocate a new patch from the static pool
+// Allocate a new patch from the head of the free list
 static uint16_t alloc_patch(void)
 {
-    // Linear scan for a free slot (could optimize with free list if needed)
-    for (uint16_t i = 0; i < PATCH_POOL_SIZE; i++)
+    uint16_t idx = g_patch_free_head;
+    if (idx != PATCH_INDEX_INVALID)
+    {
+        g_patch_free_head = g_patch_pool[idx].next_pool_index;
+        g_patch_pool_used++;
+        return idx;
+    }
+
+#ifdef ALTAIR_FLASH_DISK_LOG
+    // Drop a RAM copy that is already in the log, saving one dirty patch first if none is
+    if (g_log_enabled)
     {
-        uint16_t idx = (g_patch_pool_next_free + i) % PATCH_POOL_SIZE;
-        // Check if this slot is unused (index == 0xFFFF means free)
-        if (g_patch_pool[idx].index == PATCH_INDEX_INVALID)
+        idx = evict_clean_patch();
+        if (idx == PATCH_INDEX_INVALID && persist_dirty(1) == 1)
+        {
+            idx = evict_clean_patch();
+        }
+        if (idx != PATCH_INDEX_INVALID)
         {
-            g_patch_pool_next_free = (idx + 1) % PATCH_POOL_SIZE;
-            g_patch_pool_used++;
             return idx;
         }
     }
+#endif
 
     // Pool exhausted
     if (!g_patch_pool_exhausted)
@@ -97,10 +774,12 @@ static uint16_t get_patch(pico_disk_t* disk, uint16_t sector_index)
 
     // Initialize the patch
     g_patch_pool[new_idx].index = sector_index;
+    g_patch_pool[new_idx].drive = (uint8_t)(disk - pico_disk_controller.disk);
+    g_patch_pool[new_idx].dirty = false;
     memset(g_patch_pool[new_idx].data, 0, SECTOR_SIZE);
 
     // Insert into hash table
-    uint8_t bucket = hash_sector(sector_index);
+    uint16_t bucket = hash_sector(sector_index);
     g_patch_pool[new_idx].next_pool_index = disk->patch_hash[bucket];
     disk->patch_hash[bucket] = new_idx;
 
@@ -110,15 +789,23 @@ static uint16_t get_patch(pico_disk_t* disk, uint16_t sector_index)
 // Clear all patches for a disk (return them to the pool)
 static void clear_patches(pico_disk_t* disk)
 {
-    for (uint8_t i = 0; i < PATCH_HASH_SIZE; i++)
+    for (uint16_t i = 0; i < PATCH_HASH_SIZE; i++)
     {
         uint16_t pool_idx = disk->patch_hash[i];
         while (pool_idx != PATCH_INDEX_INVALID)
         {
             uint16_t next = g_patch_pool[pool_idx].next_pool_index;
-            // Mark as free by setting index to invalid
+#ifdef ALTAIR_FLASH_DISK_LOG
+            if (g_patch_pool[pool_idx].dirty)
+            {
+                g_patch_pool[pool_idx].dirty = false;
+                g_patch_dirty--;
+            }
+#endif
+            // Push back onto the free list
             g_patch_pool[pool_idx].index = PATCH_INDEX_INVALID;
-            g_patch_pool[pool_idx].next_pool_index = PATCH_INDEX_INVALID;
+            g_patch_pool[pool_idx].next_pool_index = g_patch_free_head;
+            g_patch_free_head = pool_idx;
             g_patch_pool_used--;
             pool_idx = next;
         }
@@ -139,6 +826,14 @@ static void flush_sector(pico_disk_t* disk)
     if (patch_idx != PATCH_INDEX_INVALID)
     {
         memcpy(g_patch_pool[patch_idx].data, disk->sector_data, SECTOR_SIZE);
+#ifdef ALTAIR_FLASH_DISK_LOG
+        if (!g_patch_pool[patch_idx].dirty)
+        {
+            g_patch_pool[patch_idx].dirty = true;
+            g_patch_dirty++;
+        }
+        g_patch_writes++;
+#endif
     }
     // Note: if patch allocation failed, data is lost (error already printed)
 
@@ -171,16 +866,24 @@ void pico_disk_init(void)
 {
     memset(&pico_disk_controller, 0, sizeof(pico_disk_controller_t));
 
-    // Initialize static patch pool - all entries marked as free
+    // Initialize static patch pool - all entries chained on the free list in order
     for (uint16_t i = 0; i < PATCH_POOL_SIZE; i++)
     {
         g_patch_pool[i].index = PATCH_INDEX_INVALID;
-        g_patch_pool[i].next_pool_index = PATCH_INDEX_INVALID;
+        g_patch_pool[i].next_pool_index = (i + 1 < PATCH_POOL_SIZE) ? (uint16_t)(i + 1) : PATCH_INDEX_INVALID;
     }
-    g_patch_pool_next_free = 0;
+    g_patch_free_head = 0;
     g_patch_pool_used = 0;
     g_patch_pool_exhausted = false;
 
+#ifdef ALTAIR_COMPRESSED_DISKS
+    for (int i = 0; i < IMAGE_TRACK_BUFFERS; i++)
+    {
+        g_image_tracks[i].drive = -1;
+        g_image_tracks[i].last_used = 0;
+    }
+#endif
+
     // Initialize all drives
     for (int i = 0; i < MAX_DRIVES; i++)
     {
@@ -190,9 +893,12 @@ void pico_disk_init(void)
         pico_disk_controller.disk[i].disk_loaded = false;
         pico_disk_controller.disk[i].disk_image_flash = NULL;
         // Initialize hash table with invalid indices
-        for (uint8_t j = 0; j < PATCH_HASH_SIZE; j++)
+        for (uint16_t j = 0; j < PATCH_HASH_SIZE; j++)
         {
             pico_disk_controller.disk[i].patch_hash[j] = PATCH_INDEX_INVALID;
+#ifdef ALTAIR_FLASH_DISK_LOG
+            pico_disk_controller.disk[i].log_hash[j] = PATCH_INDEX_INVALID;
+#endif
         }
     }
 
@@ -202,10 +908,14 @@ void pico_disk_init(void)
 
     printf("[DISK] Patch pool initialized: %u slots (%u KB)\n", PATCH_POOL_SIZE,
            (PATCH_POOL_SIZE * sizeof(sector_patch_t)) / 1024);
+
+#ifdef ALTAIR_FLASH_DISK_LOG
+    log_init();
+#endif
 }
 
-// Load disk image for specified drive (Copy-on-Write)
-bool pico_disk_load(uint8_t drive, const uint8_t* disk_image, uint32_t size)
+// Load disk image for specified drive (Copy-on-Write), track_offsets is NULL for a raw image
+static bool load_image(uint8_t drive, const uint8_t* disk_image, const unsigned int* track_offsets, uint32_t size)
 {
     if (drive >= MAX_DRIVES)
     {
@@ -213,10 +923,23 @@ bool pico_disk_load(uint8_t drive, const uint8_t* disk_image, uint32_t size)
     }
 
     pico_disk_t* disk = &pico_disk_controller.disk[drive];
+#ifdef ALTAIR_FLASH_DISK_LOG
+    // Writes to the image being replaced go to the log under its own image id
+    if (disk->disk_loaded)
+    {
+        pico_disk_flush();
+    }
+#endif
     clear_patches(disk);
 
     // Copy-on-Write: Keep flash pointer, allocate RAM on first write
     disk->disk_image_flash = disk_image;
+#ifdef ALTAIR_COMPRESSED_DISKS
+    disk->track_offsets = track_offsets;
+    image_tracks_forget(disk);
+#else
+    (void)track_offsets;
+#endif
     disk->disk_size = size;
     disk->disk_loaded = true;
     disk->disk_pointer = 0;
@@ -227,10 +950,13 @@ bool pico_disk_load(uint8_t drive, const uint8_t* disk_image, uint32_t size)
     disk->have_sector_data = false;
     disk->write_status = 0;
     // Initialize hash table with invalid indices
-    for (uint8_t i = 0; i < PATCH_HASH_SIZE; i++)
+    for (uint16_t i = 0; i < PATCH_HASH_SIZE; i++)
     {
         disk->patch_hash[i] = PATCH_INDEX_INVALID;
     }
+#ifdef ALTAIR_FLASH_DISK_LOG
+    log_load_drive(disk, drive);
+#endif
 
     // Start from default hardware reset value, then reflect initial state
     disk->status = STATUS_DEFAULT;
@@ -241,6 +967,22 @@ bool pico_disk_load(uint8_t drive, const uint8_t* disk_image, uint32_t size)
     return true;
 }
 
+bool pico_disk_load(uint8_t drive, const uint8_t* disk_image, uint32_t size)
+{
+    return load_image(drive, disk_image, NULL, size);
+}
+
+#ifdef ALTAIR_COMPRESSED_DISKS
+bool pico_disk_load_lz4(uint8_t drive, const uint8_t* blocks, const unsigned int* track_offsets, uint32_t size)
+{
+    if (track_offsets == NULL || size == 0)
+    {
+        return false;
+    }
+    return load_image(drive, blocks, track_offsets, size);
+}
+#endif
+
 // Select disk drive
 void pico_disk_select(uint8_t drive)
 {
@@ -409,16 +1151,31 @@ uint8_t pico_disk_read(void)
         uint32_t offset = disk->disk_pointer;
         if (offset + SECTOR_SIZE <= disk->disk_size)
         {
-            memcpy(disk->sector_data, &disk->disk_image_flash[offset], SECTOR_SIZE);
             disk->have_sector_data = true;
 
-            // Apply patch if exists
+            // A patch replaces the sector, the image is only read without one
             uint16_t sector_index = (uint16_t)(offset / SECTOR_SIZE);
             uint16_t patch_idx = find_patch_index(disk, sector_index);
+            const uint8_t* source = NULL;
             if (patch_idx != PATCH_INDEX_INVALID)
             {
-                memcpy(disk->sector_data, g_patch_pool[patch_idx].data, SECTOR_SIZE);
+                source = g_patch_pool[patch_idx].data;
             }
+#ifdef ALTAIR_FLASH_DISK_LOG
+            else
+            {
+                uint16_t slot = log_find(disk, sector_index);
+                if (slot != PATCH_INDEX_INVALID)
+                {
+                    source = flash_fetch(log_record(slot)->data, SECTOR_SIZE);
+                }
+            }
+#endif
+            if (source == NULL)
+            {
+                source = image_data(disk, offset, SECTOR_SIZE);
+            }
+            memcpy(disk->sector_data, source, SECTOR_SIZE);
         }
     }
 
@@ -439,3 +1196,107 @@ void pico_disk_get_patch_stats(uint16_t* used, uint16_t* total)
         *total = PATCH_POOL_SIZE;
     }
 }
+
+// Save dirty patches once writes pause for PATCH_LOG_IDLE_US, or PATCH_LOG_MAX_AGE_US after the
+// first unsaved write, and compact one log sector per call when free pages run low
+void pico_disk_poll(uint32_t now_us)
+{
+#ifdef ALTAIR_FLASH_DISK_LOG
+    if (!g_log_enabled)
+    {
+        return;
+    }
+
+    if (g_patch_writes != g_polled_writes)
+    {
+        g_polled_writes = g_patch_writes;
+        g_last_write_us = now_us;
+        if (!g_persist_pending)
+        {
+            g_persist_pending = true;
+            g_first_dirty_us = now_us;
+        }
+    }
+
+    if (g_log_free <= PATCH_LOG_COMPACT_PAGES && log_has_garbage() && log_compact())
+    {
+        return;
+    }
+
+    if (!g_persist_pending)
+    {
+        return;
+    }
+
+    if (now_us - g_last_write_us >= PATCH_LOG_IDLE_US || now_us - g_first_dirty_us >= PATCH_LOG_MAX_AGE_US)
+    {
+        // Keep going on later calls until everything is saved, give up on a full log until the next write
+        if (persist_dirty(PATCH_LOG_BATCH) < PATCH_LOG_BATCH || g_patch_dirty == 0)
+        {
+            g_persist_pending = false;
+        }
+    }
+#else
+    (void)now_us;
+#endif
+}
+
+void pico_disk_flush(void)
+{
+#ifdef ALTAIR_FLASH_DISK_LOG
+    if (!g_log_enabled)
+    {
+        return;
+    }
+
+    while (g_patch_dirty > 0)
+    {
+        if (g_log_free <= PATCH_LOG_COMPACT_PAGES && log_has_garbage() && log_compact())
+        {
+            continue;
+        }
+        if (persist_dirty(PATCH_LOG_BATCH) == 0)
+        {
+            break;
+        }
+    }
+    g_persist_pending = g_patch_dirty > 0;
+#endif
+}
+
+uint32_t pico_disk_dirty_sectors(void)
+{
+#ifdef ALTAIR_FLASH_DISK_LOG
+    return g_patch_dirty;
+#else
+    return 0;
+#endif
+}
+
+// Get patch log statistics (all zero when the log is not built in or disabled)
+void pico_disk_get_log_stats(uint16_t* live, uint16_t* free_pages, uint16_t* total)
+{
+    uint16_t log_live = 0;
+    uint16_t log_free = 0;
+    uint16_t log_total = 0;
+#ifdef ALTAIR_FLASH_DISK_LOG
+    if (g_log_enabled)
+    {
+        log_live = g_log_live;
+        log_free = g_log_free;
+        log_total = PATCH_LOG_PAGES;
+    }
+#endif
+    if (live)
+    {
+        *live = log_live;
+    }
+    if (free_pages)
+    {
+        *free_pages = log_free;
+    }
+    if (total)
+    {
+        *total = log_total;
+    }
+}
@@ -38,24 +38,41 @@
 #define DRIVE_SELECT_MASK 0x0F
 #define SECTOR_SHIFT_BITS 1
 
-// Hash table size for sector patches (power of 2 for fast modulo)
-#define PATCH_HASH_SIZE 32
+// Hash table size for sector patches (power of 2 for fast modulo). 256 buckets keep the
+// chains at a handful of entries even with the whole pool on one disk (2464 sectors).
+#define PATCH_HASH_SIZE 256
 
 // Static patch pool configuration
-// Each patch is ~141 bytes (137 data + 2 index + 2 next_index)
-// 1200 patches = ~165KB
+// Each patch is ~143 bytes (137 data + 2 index + 2 next_index + drive + dirty)
+// 1200 patches = ~168KB
 #define PATCH_POOL_SIZE 1200
 
+// Flash patch log (ALTAIR_FLASH_DISK_LOG): dirty patches are appended to flash once the guest
+// has not written for PATCH_LOG_IDLE_US, or the oldest unsaved write is PATCH_LOG_MAX_AGE_US old
+#ifndef PATCH_LOG_IDLE_US
+#define PATCH_LOG_IDLE_US 250000
+#endif
+#ifndef PATCH_LOG_MAX_AGE_US
+#define PATCH_LOG_MAX_AGE_US 2000000
+#endif
+
 typedef struct sector_patch
 {
     uint16_t index;           // Sector index this patch applies to
-    uint16_t next_pool_index; // Index into static pool (0xFFFF = end of list)
+    uint16_t next_pool_index; // Next patch in the hash chain, or in the free list (0xFFFF = end of list)
+    uint8_t drive;            // Drive whose hash chain holds this patch
+    bool dirty;               // Not yet written to the flash patch log
     uint8_t data[SECTOR_SIZE];
 } sector_patch_t;
 
+// Compressed images (ALTAIR_COMPRESSED_DISKS): decompressed tracks are kept in this many shared buffers
+#ifndef IMAGE_TRACK_BUFFERS
+#define IMAGE_TRACK_BUFFERS 2
+#endif
+
 typedef struct
 {
-    const uint8_t* disk_image_flash;      // Read-only pointer to flash image
+    const uint8_t* disk_image_flash;      // Read-only pointer to flash image (LZ4 track blocks when compressed)
     uint32_t disk_size;                   // Size of disk image
     uint8_t track;                        // Current track (0-76)
     uint8_t sector;                       // Current sector (0-31)
@@ -68,6 +85,13 @@ typedef struct
     bool have_sector_data;                // Sector buffer is valid
     bool disk_loaded;                     // Disk image is loaded
     uint16_t patch_hash[PATCH_HASH_SIZE]; // Hash table - indices into static pool (0xFFFF = empty)
+#ifdef ALTAIR_COMPRESSED_DISKS
+    const unsigned int* track_offsets;    // Start of each track's LZ4 block plus the end, NULL when uncompressed
+#endif
+#ifdef ALTAIR_FLASH_DISK_LOG
+    uint32_t image_id;                    // Identifies the embedded image the log records apply to
+    uint16_t log_hash[PATCH_HASH_SIZE];   // Hash table - current log slot per sector (0xFFFF = empty)
+#endif
 } pico_disk_t;
 
 typedef struct
@@ -91,8 +115,18 @@ uint8_t pico_disk_read(void);
 // Initialization
 void pico_disk_init(void);
 bool pico_disk_load(uint8_t drive, const uint8_t* disk_image, uint32_t size);
+#ifdef ALTAIR_COMPRESSED_DISKS
+// Image from dsk_to_header.py --lz4: one LZ4 block per track, a block as long as its track is stored raw
+bool pico_disk_load_lz4(uint8_t drive, const uint8_t* blocks, const unsigned int* track_offsets, uint32_t size);
+#endif
+
+// Flash patch log, no-ops unless built with ALTAIR_FLASH_DISK_LOG
+void pico_disk_poll(uint32_t now_us); // Core 0 main loop: save dirty patches, compact the log
+void pico_disk_flush(void);           // Save every dirty patch now
+uint32_t pico_disk_dirty_sectors(void);
 
 // Statistics
 void pico_disk_get_patch_stats(uint16_t* used, uint16_t* total);
+void pico_disk_get_log_stats(uint16_t* live, uint16_t* free_pages, uint16_t* total);
 
 #endif
@@ -0,0 +1,581 @@
+#include "pico_88dcdd_remote.h"
+
+#include "pico/stdlib.h"
+#include "remote_fs.h"
+
+// MITS 88-DCDD Disk Controller Emulation backed by the RemoteFS sector server
+// Implements active-low status bit logic for Altair 8800 floppy disk controller
+// Core 1 runs the TCP protocol; this side only talks to it through the RemoteFS queues
+
+// Global disk controller instance
+remote_disk_controller_t remote_disk_controller;
+
+typedef enum
+{
+    SLOT_EMPTY = 0,
+    SLOT_READING, // READ_SECTOR in flight
+    SLOT_VALID
+} SLOT_STATE;
+
+typedef struct
+{
+    uint8_t drive;
+    uint8_t track;
+    uint8_t state;    // SLOT_STATE
+    bool dirty;       // Written by the guest, WRITE_SECTOR not queued yet
+    uint8_t writes;   // WRITE_SECTORs queued and not acknowledged yet
+    uint32_t last_use;
+    uint8_t data[SECTOR_SIZE];
+} remote_sector_t;
+
+// Set-associative sector cache indexed by sector number. Slots with a request in flight or an
+// unsent write are never evicted, so every response finds its slot.
+static remote_sector_t cache[SECTORS_PER_TRACK][REMOTE_CACHE_WAYS];
+static uint32_t use_clock = 0;
+static uint32_t reads_in_flight = 0;
+static uint32_t dirty_slots = 0;
+static uint32_t writes_in_flight = 0;
+
+static queue_t* request_queue = NULL;  // Core 0 -> Core 1
+static queue_t* response_queue = NULL; // Core 1 -> Core 0
+
+static void writeSector(remote_disk_t* pDisk);
+
+static const uint8_t STATUS_DEFAULT =
+    STATUS_ENWD | STATUS_MOVE_HEAD | STATUS_HEAD | STATUS_IE | STATUS_TRACK_0 | STATUS_NRDA;
+
+// Set status condition to TRUE (clears bit for active-low hardware)
+static inline void set_status(uint8_t bit)
+{
+    remote_disk_controller.current->status &= ~bit;
+}
+
+// Set status condition to FALSE (sets bit for active-low hardware)
+static inline void clear_status(uint8_t bit)
+{
+    remote_disk_controller.current->status |= bit;
+}
+
+static inline uint8_t drive_number(const remote_disk_t* disk)
+{
+    return (uint8_t)(disk - remote_disk_controller.disk);
+}
+
+static remote_sector_t* cache_find(uint8_t drive, uint8_t track, uint8_t sector)
+{
+    remote_sector_t* set = cache[sector];
+    for (int way = 0; way < REMOTE_CACHE_WAYS; way++)
+    {
+        if (set[way].state != SLOT_EMPTY && set[way].drive == drive && set[way].track == track)
+        {
+            return &set[way];
+        }
+    }
+    return NULL;
+}
+
+// Claim the least recently used slot of the sector's set that is not waiting on the server
+static remote_sector_t* cache_alloc(uint8_t drive, uint8_t track, uint8_t sector)
+{
+    remote_sector_t* set = cache[sector];
+    remote_sector_t* victim = NULL;
+    for (int way = 0; way < REMOTE_CACHE_WAYS; way++)
+    {
+        remote_sector_t* slot = &set[way];
+        if (slot->state == SLOT_READING || slot->dirty || slot->writes != 0)
+        {
+            continue;
+        }
+        if (slot->state == SLOT_EMPTY)
+        {
+            victim = slot;
+            break;
+        }
+        if (victim == NULL || (int32_t)(slot->last_use - victim->last_use) < 0)
+        {
+            victim = slot;
+        }
+    }
+
+    if (victim != NULL)
+    {
+        victim->drive = drive;
+        victim->track = track;
+        victim->state = SLOT_EMPTY;
+        victim->last_use = ++use_clock;
+    }
+    return victim;
+}
+
+// Apply completed core 1 requests
+static void collect_responses(void)
+{
+    if (response_queue == NULL)
+    {
+        return;
+    }
+
+    remote_fs_response_t response;
+    while (queue_try_remove(response_queue, &response))
+    {
+        remote_sector_t* slot = NULL;
+        if (response.drive < MAX_DRIVES && response.track < MAX_TRACKS && response.sector < SECTORS_PER_TRACK)
+        {
+            slot = cache_find(response.drive, response.track, response.sector);
+        }
+
+        if (response.cmd == REMOTE_FS_CMD_READ_SECTOR)
+        {
+            reads_in_flight--;
+
+            // A guest write that overtook the read already made the slot valid
+            if (slot != NULL && slot->state == SLOT_READING)
+            {
+                if (response.status == REMOTE_FS_RESP_OK)
+                {
+                    memcpy(slot->data, response.data, SECTOR_SIZE);
+                }
+                else
+                {
+                    printf("[REMOTE_DISK] Read failed: drive %u track %u sector %u\n", response.drive,
+                           response.track, response.sector);
+                    memset(slot->data, 0x00, SECTOR_SIZE);
+                }
+                slot->state = SLOT_VALID;
+            }
+        }
+        else
+        {
+            writes_in_flight--;
+            if (slot != NULL && slot->writes != 0)
+            {
+                slot->writes--;
+            }
+            if (response.status != REMOTE_FS_RESP_OK)
+            {
+                printf("[REMOTE_DISK] Write failed: drive %u track %u sector %u\n", response.drive, response.track,
+                       response.sector);
+            }
+        }
+    }
+}
+
+static bool post_read(uint8_t drive, uint8_t track, uint8_t sector)
+{
+    remote_sector_t* slot = cache_alloc(drive, track, sector);
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    remote_fs_request_t request = {
+        .cmd = REMOTE_FS_CMD_READ_SECTOR, .drive = drive, .track = track, .sector = sector};
+    if (!queue_try_add(request_queue, &request))
+    {
+        return false;
+    }
+
+    slot->state = SLOT_READING;
+    reads_in_flight++;
+    return true;
+}
+
+// Queue the slot's data to the server; left dirty (and retried by remote_disk_poll) if the queue is full
+static void post_write(remote_sector_t* slot, uint8_t sector)
+{
+    remote_fs_request_t request = {
+        .cmd = REMOTE_FS_CMD_WRITE_SECTOR, .drive = slot->drive, .track = slot->track, .sector = sector};
+    memcpy(request.data, slot->data, SECTOR_SIZE);
+
+    if (request_queue == NULL || !queue_try_add(request_queue, &request))
+    {
+        return;
+    }
+
+    slot->dirty = false;
+    slot->writes++;
+    dirty_slots--;
+    writes_in_flight++;
+}
+
+// Keep the next REMOTE_READ_AHEAD sectors of the track under the head requested, so they
+// stream in while the guest is busy with the current one
+static void read_ahead(remote_disk_t* disk)
+{
+    if (request_queue == NULL)
+    {
+        return;
+    }
+
+    uint8_t drive = drive_number(disk);
+    for (int i = 0; i < REMOTE_READ_AHEAD && reads_in_flight < REMOTE_READ_AHEAD; i++)
+    {
+        uint8_t sector = (uint8_t)((disk->sector + i) % SECTORS_PER_TRACK);
+        if (cache_find(drive, disk->track, sector) == NULL && !post_read(drive, disk->track, sector))
+        {
+            break;
+        }
+    }
+}
+
+// Slot for a guest access that did not wait for sector true; gives up after REMOTE_WAIT_US
+static remote_sector_t* wait_for_slot(remote_disk_t* disk, uint8_t sector, bool need_data)
+{
+    uint8_t drive = drive_number(disk);
+    uint32_t start_us = time_us_32();
+
+    while (true)
+    {
+        collect_responses();
+
+        remote_sector_t* slot = cache_find(drive, disk->track, sector);
+        if (slot == NULL && request_queue != NULL)
+        {
+            if (need_data)
+            {
+                post_read(drive, disk->track, sector);
+            }
+            else
+            {
+                slot = cache_alloc(drive, disk->track, sector);
+            }
+        }
+        if (slot != NULL && (slot->state == SLOT_VALID || !need_data))
+        {
+            return slot;
+        }
+
+        if (time_us_32() - start_us >= REMOTE_WAIT_US)
+        {
+            printf("[REMOTE_DISK] Server timeout: drive %u track %u sector %u\n", drive, disk->track, sector);
+            return NULL;
+        }
+        tight_loop_contents();
+    }
+}
+
+// Helper function to handle common track positioning logic
+static void seek_to_track(void)
+{
+    remote_disk_t* disk = remote_disk_controller.current;
+
+    if (!disk->disk_loaded)
+    {
+        return;
+    }
+
+    disk->haveSectorData = false;
+    disk->sectorPointer = 0;
+    disk->sector = 0;
+}
+
+// Initialize disk controller
+void remote_disk_init(void)
+{
+    memset(&remote_disk_controller, 0, sizeof(remote_disk_controller_t));
+    memset(cache, 0, sizeof(cache));
+    reads_in_flight = 0;
+    dirty_slots = 0;
+    writes_in_flight = 0;
+
+    if (request_queue == NULL)
+    {
+        remote_fs_init();
+        remote_fs_queues(&request_queue, &response_queue);
+    }
+
+    // The server always has MAX_DRIVES images per client
+    for (int i = 0; i < MAX_DRIVES; i++)
+    {
+        remote_disk_t* disk = &remote_disk_controller.disk[i];
+        disk->disk_loaded = true;
+
+        // Start from default hardware reset value, then reflect initial state
+        disk->status = STATUS_DEFAULT;
+        disk->status &= (uint8_t)~STATUS_MOVE_HEAD;
+        disk->status &= (uint8_t)~STATUS_TRACK_0; // head at track 0 (active-low)
+        disk->status &= (uint8_t)~STATUS_SECTOR;  // sector true
+    }
+
+    // Select drive 0 by default
+    remote_disk_controller.current = &remote_disk_controller.disk[0];
+    remote_disk_controller.currentDisk = 0;
+}
+
+// Select disk drive
+void remote_disk_select(uint8_t drive)
+{
+    uint8_t select = drive & DRIVE_SELECT_MASK;
+
+    if (select < MAX_DRIVES)
+    {
+        remote_disk_controller.currentDisk = select;
+        remote_disk_controller.current = &remote_disk_controller.disk[select];
+    }
+    else
+    {
+        remote_disk_controller.currentDisk = 0;
+        remote_disk_controller.current = &remote_disk_controller.disk[0];
+    }
+}
+
+// Get disk status
+uint8_t remote_disk_status(void)
+{
+    return remote_disk_controller.current->status;
+}
+
+// Disk control function
+void remote_disk_function(uint8_t control)
+{
+    remote_disk_t* disk = remote_disk_controller.current;
+
+    if (!disk->disk_loaded)
+    {
+        return;
+    }
+
+    // A partly written sector belongs to the track the head is leaving
+    if ((control & (CONTROL_STEP_IN | CONTROL_STEP_OUT)) && disk->sectorDirty)
+    {
+        writeSector(disk);
+    }
+
+    // Step in (increase track)
+    if (control & CONTROL_STEP_IN)
+    {
+        if (disk->track < MAX_TRACKS - 1)
+        {
+            disk->track++;
+        }
+        if (disk->track != 0)
+        {
+            clear_status(STATUS_TRACK_0);
+        }
+        seek_to_track();
+    }
+
+    // Step out (decrease track)
+    if (control & CONTROL_STEP_OUT)
+    {
+        if (disk->track > 0)
+        {
+            disk->track--;
+        }
+        if (disk->track == 0)
+        {
+            set_status(STATUS_TRACK_0);
+        }
+        seek_to_track();
+    }
+
+    // Head load
+    if (control & CONTROL_HEAD_LOAD)
+    {
+        set_status(STATUS_HEAD);
+        set_status(STATUS_NRDA);
+    }
+
+    // Head unload
+    if (control & CONTROL_HEAD_UNLOAD)
+    {
+        clear_status(STATUS_HEAD);
+    }
+
+    // Write enable
+    if (control & CONTROL_WE)
+    {
+        set_status(STATUS_ENWD);
+        disk->write_status = 0;
+    }
+}
+
+// Get current sector
+uint8_t remote_disk_sector(void)
+{
+    remote_disk_t* disk = remote_disk_controller.current;
+
+    if (!disk->disk_loaded)
+    {
+        return 0xC0; // Invalid sector
+    }
+
+    // Wrap sector to 0 after reaching end of track
+    if (disk->sector == SECTORS_PER_TRACK)
+    {
+        disk->sector = 0;
+    }
+
+    if (disk->sectorDirty)
+    {
+        writeSector(disk);
+    }
+
+    collect_responses();
+    read_ahead(disk);
+
+    // The head keeps rotating, but only sectors already in the cache pass as sector true (D0=0).
+    // The guest waits for its sector to come round again while the reads are in flight.
+    remote_sector_t* slot = cache_find(drive_number(disk), disk->track, disk->sector);
+    uint8_t ret_val = 0xC0;                         // Set D7-D6
+    ret_val |= (disk->sector << SECTOR_SHIFT_BITS); // D5-D1
+
+    if (slot == NULL || slot->state != SLOT_VALID)
+    {
+        ret_val |= 1; // D0: not at sector start
+    }
+    else
+    {
+        slot->last_use = ++use_clock;
+        disk->dataSector = disk->sector;
+        disk->sectorPointer = 0;
+        disk->haveSectorData = false;
+    }
+
+    disk->sector++;
+    return ret_val;
+}
+
+// Write byte to disk
+void remote_disk_write(uint8_t data)
+{
+    remote_disk_t* disk = remote_disk_controller.current;
+
+    if (!disk->disk_loaded)
+    {
+        return;
+    }
+
+    if (disk->sectorPointer >= SECTOR_SIZE + 2)
+    {
+        disk->sectorPointer = SECTOR_SIZE + 1;
+    }
+
+    disk->sectorData[disk->sectorPointer++] = data;
+    disk->sectorDirty = true;
+
+    if (disk->write_status == SECTOR_SIZE)
+    {
+        writeSector(disk);
+        disk->write_status = 0;
+        clear_status(STATUS_ENWD);
+    }
+    else
+    {
+        disk->write_status++;
+    }
+}
+
+// Read byte from disk
+uint8_t remote_disk_read(void)
+{
+    remote_disk_t* disk = remote_disk_controller.current;
+
+    if (!disk->disk_loaded)
+    {
+        return 0x00;
+    }
+
+    // Load sector data if not already loaded
+    if (!disk->haveSectorData)
+    {
+        disk->sectorPointer = 0;
+
+        // Normally a cache hit, the guest waited for sector true
+        remote_sector_t* slot = wait_for_slot(disk, disk->dataSector, true);
+        if (slot != NULL)
+        {
+            memcpy(disk->sectorData, slot->data, SECTOR_SIZE);
+        }
+        else
+        {
+            memset(disk->sectorData, 0x00, SECTOR_SIZE);
+        }
+        disk->haveSectorData = true;
+    }
+
+    // Return current byte and advance pointer within sector
+    return disk->sectorData[disk->sectorPointer++];
+}
+
+// Write sector buffer through the cache to the server
+static void writeSector(remote_disk_t* pDisk)
+{
+    if (!pDisk->sectorDirty)
+    {
+        return;
+    }
+
+    pDisk->sectorPointer = 0;
+    pDisk->sectorDirty = false;
+
+    remote_sector_t* slot = wait_for_slot(pDisk, pDisk->dataSector, false);
+    if (slot == NULL)
+    {
+        printf("[REMOTE_DISK] Cache full, write to drive %u track %u sector %u lost\n", drive_number(pDisk),
+               pDisk->track, pDisk->dataSector);
+        return;
+    }
+
+    memcpy(slot->data, pDisk->sectorData, SECTOR_SIZE);
+    slot->state = SLOT_VALID;
+    slot->last_use = ++use_clock;
+    if (!slot->dirty)
+    {
+        slot->dirty = true;
+        dirty_slots++;
+    }
+    post_write(slot, pDisk->dataSector);
+}
+
+// Queue writes that found the request queue full
+static void post_dirty(void)
+{
+    for (int sector = 0; sector < SECTORS_PER_TRACK && dirty_slots != 0; sector++)
+    {
+        for (int way = 0; way < REMOTE_CACHE_WAYS; way++)
+        {
+            if (cache[sector][way].dirty)
+            {
+                post_write(&cache[sector][way], (uint8_t)sector);
+            }
+        }
+    }
+}
+
+void remote_disk_poll(uint32_t now_us)
+{
+    (void)now_us;
+
+    collect_responses();
+    if (dirty_slots != 0)
+    {
+        post_dirty();
+    }
+}
+
+// Wait until the server acknowledged every write, or REMOTE_WAIT_US passed without progress
+void remote_disk_flush(void)
+{
+    uint32_t start_us = time_us_32();
+    uint32_t pending = remote_disk_dirty_sectors();
+
+    while (pending != 0 && time_us_32() - start_us < REMOTE_WAIT_US)
+    {
+        remote_disk_poll(time_us_32());
+
+        uint32_t now_pending = remote_disk_dirty_sectors();
+        if (now_pending != pending)
+        {
+            pending = now_pending;
+            start_us = time_us_32();
+        }
+        tight_loop_contents();
+    }
+}
+
+// Written sectors the server has not acknowledged yet
+uint32_t remote_disk_dirty_sectors(void)
+{
+    return dirty_slots + writes_in_flight;
+}
@@ -0,0 +1,98 @@
+#ifndef _PICO_88DCDD_REMOTE_H_
+#define _PICO_88DCDD_REMOTE_H_
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// MITS 88-DCDD compatible disk controller backed by RemoteFS/remote_fs_server.py
+// Sectors are fetched over TCP by core 1 (PortDrivers/remote_fs.c) and kept in a RAM cache
+
+// Status bits (active-low)
+#define STATUS_ENWD 1
+#define STATUS_MOVE_HEAD 2
+#define STATUS_HEAD 4
+#define STATUS_SECTOR 8 // Bit 3: Sector position (0=positioned, 1=not ready)
+#define STATUS_IE 32
+#define STATUS_TRACK_0 64
+#define STATUS_NRDA 128
+
+// Control bits
+#define CONTROL_STEP_IN 1
+#define CONTROL_STEP_OUT 2
+#define CONTROL_HEAD_LOAD 4
+#define CONTROL_HEAD_UNLOAD 8
+#define CONTROL_IE 16
+#define CONTROL_ID 32
+#define CONTROL_HCS 64
+#define CONTROL_WE 128
+
+// Disk geometry for 8" floppy
+#define SECTOR_SIZE 137
+#define SECTORS_PER_TRACK 32
+#define MAX_TRACKS 77
+#define TRACK_SIZE (SECTORS_PER_TRACK * SECTOR_SIZE)
+#define DISK_SIZE (MAX_TRACKS * TRACK_SIZE)
+
+// Sector cache: one set per sector number, REMOTE_CACHE_WAYS tracks of each (~4.7 KB per way)
+#ifndef REMOTE_CACHE_WAYS
+#define REMOTE_CACHE_WAYS 4
+#endif
+
+// Sector reads kept in flight ahead of the head, must not exceed REMOTE_FS_WINDOW
+#ifndef REMOTE_READ_AHEAD
+#define REMOTE_READ_AHEAD 8
+#endif
+
+// How long a guest access that cannot complete from the cache waits for the server
+#define REMOTE_WAIT_US 2000000
+
+// Drive selection
+#define MAX_DRIVES 4
+#define DRIVE_SELECT_MASK 0x0F
+#define SECTOR_SHIFT_BITS 1
+
+typedef struct
+{
+    uint8_t track;                       // Current track (0-76)
+    uint8_t sector;                      // Current sector (0-31)
+    uint8_t status;                      // Status register
+    uint8_t write_status;                // Write operation status
+    uint8_t dataSector;                  // Sector that sectorData belongs to
+    uint8_t sectorPointer;               // Position within current sector
+    uint8_t sectorData[SECTOR_SIZE + 2]; // Sector buffer
+    bool sectorDirty;                    // Sector needs writing back
+    bool haveSectorData;                 // Sector buffer is valid
+    bool disk_loaded;                    // Drive is served by the remote server
+} remote_disk_t;
+
+typedef struct
+{
+    remote_disk_t disk[MAX_DRIVES];
+    remote_disk_t* current;
+    uint8_t currentDisk;
+} remote_disk_controller_t;
+
+// Global disk controller
+extern remote_disk_controller_t remote_disk_controller;
+
+// Disk controller functions (88-DCDD compatible interface)
+void remote_disk_select(uint8_t drive);
+uint8_t remote_disk_status(void);
+void remote_disk_function(uint8_t control);
+uint8_t remote_disk_sector(void);
+void remote_disk_write(uint8_t data);
+uint8_t remote_disk_read(void);
+
+// Initialization, all drives map to the server's images of the same number
+void remote_disk_init(void);
+
+// Write-through control (core 0)
+void remote_disk_poll(uint32_t now_us);
+void remote_disk_flush(void);
+uint32_t remote_disk_dirty_sectors(void);
+
+#endif // _PICO_88DCDD_REMOTE_H_
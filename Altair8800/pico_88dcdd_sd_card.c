@@ -1,5 +1,14 @@
 #include "pico_88dcdd_sd_card.h"
 
+#include "io_ports.h"
+#include "pico/util/queue.h"
+#include <ctype.h>
+#include <strings.h>
+
+#ifdef ALTAIR_SD_DIRECT_LBA
+#include "diskio.h"
+#endif
+
 // MITS 88-DCDD Disk Controller Emulation for Pico with SD Card
 // Implements active-low status bit logic for Altair 8800 floppy disk controller
 // Uses FatFs for file I/O on SD card
@@ -8,6 +17,73 @@
 sd_disk_controller_t sd_disk_controller;
 
 static void writeSector(sd_disk_t* pDisk);
+static void flush_track(sd_disk_t* disk);
+static void wait_idle(sd_disk_t* disk);
+static size_t mount_port_output(int port, uint8_t data, char* buffer, size_t buffer_length);
+
+// Track I/O requests (core 0 -> core 1) and completions (core 1 -> core 0). Each drive has at
+// most one request in flight, plus one sd_disk_io_call, so the queues never fill.
+typedef enum
+{
+    SD_REQUEST_LOAD = 0,  // Write back dirty sectors of the old track, then read the new one
+    SD_REQUEST_FLUSH = 1, // Write back dirty sectors only
+    SD_REQUEST_CALL = 2   // Run a function of another SD card device (sd_disk_io_call)
+} SD_REQUEST_OP;
+
+typedef struct
+{
+    uint8_t drive;
+    uint8_t op;
+    uint8_t slot;        // Track cache slot to write back from and read into
+    uint8_t flush_drive; // Drive the dirty sectors in the slot belong to, the previous owner
+    int16_t flush_track; // Track the dirty mask belongs to
+    int16_t load_track;  // Track to read (SD_REQUEST_LOAD)
+    uint32_t dirty;      // Sectors of flush_track to write back
+    sd_disk_io_fn fn;    // SD_REQUEST_CALL
+    void* arg;
+} sd_disk_request_t;
+
+typedef struct
+{
+    uint8_t drive;
+    uint8_t op;
+    int16_t loaded_track; // Track now in trackData (SD_REQUEST_LOAD)
+} sd_disk_response_t;
+
+static queue_t request_queue;
+static queue_t response_queue;
+static volatile bool service_ready = false;  // Queues initialized by core 0
+static volatile bool service_online = false; // Core 1 is polling the service
+static bool call_busy = false;               // sd_disk_io_call waiting for core 1
+
+// Write-back timing state for sd_disk_poll
+static uint32_t sector_writes = 0;
+static uint32_t polled_writes = 0;
+static uint32_t first_dirty_us = 0;
+static uint32_t last_write_us = 0;
+static bool flush_pending = false;
+
+#define NO_CACHED_TRACK (-1)
+#define NO_SLOT (-1)
+
+// Track cache arena, see SD_TRACK_SLOTS. Core 0 hands out the slots, the core doing the I/O
+// fills and writes back the one a request names.
+typedef struct
+{
+    int8_t owner;       // Drive the slot belongs to, NO_SLOT if free
+    uint32_t last_used; // slot_clock when its track was last ready for the owner
+    uint8_t data[SD_TRACK_SLOT_SIZE] __attribute__((aligned(4)));
+} sd_track_slot_t;
+
+#if SD_TRACK_SLOTS < 1 || SD_TRACK_SLOTS > MAX_DRIVES
+#error "SD_TRACK_SLOTS must be between 1 and MAX_DRIVES"
+#endif
+
+static sd_track_slot_t track_slots[SD_TRACK_SLOTS];
+static uint32_t slot_clock = 0;
+
+// Zeroes appended to a short image, written from flash
+static const uint8_t zero_block[FF_MIN_SS];
 
 static const uint8_t STATUS_DEFAULT =
     STATUS_ENWD | STATUS_MOVE_HEAD | STATUS_HEAD | STATUS_IE | STATUS_TRACK_0 | STATUS_NRDA;
@@ -34,24 +110,360 @@ static void seek_to_track(void)
         return;
     }
 
-    if (disk->sectorDirty)
+    // The track itself is read on the first sector access, so stepping across tracks is free.
+    // Dirty sectors of the track being left are written back as part of that load.
+    disk->diskPointer = disk->track * TRACK_SIZE;
+    disk->haveSectorData = false;
+    disk->sectorPointer = 0;
+    disk->sector = 0;
+}
+
+// Where the track starts in a slot: the card blocks read directly hold it at its offset in the
+// first block
+static uint8_t* slot_track_data(const sd_disk_t* disk, int8_t slot, int16_t track)
+{
+#ifdef ALTAIR_SD_DIRECT_LBA
+    if (disk->lba != 0)
     {
-        writeSector(disk);
+        return track_slots[slot].data + (uint32_t)track * TRACK_SIZE % FF_MIN_SS;
     }
+#endif
+    return track_slots[slot].data;
+}
+
+// Read a whole track into a slot with one f_read (runs on the core doing the I/O).
+// Whatever could not be read is returned to the guest as zeroes.
+static void read_track(sd_disk_t* disk, uint8_t* data, int16_t track)
+{
+#ifdef ALTAIR_SD_DIRECT_LBA
+    if (disk->lba != 0)
+    {
+        uint32_t offset = (uint32_t)track * TRACK_SIZE;
+        uint32_t first = offset / FF_MIN_SS;
+        uint32_t end = (offset + TRACK_SIZE + FF_MIN_SS - 1) / FF_MIN_SS;
+        DRESULT dr = disk_read(disk->fil.obj.fs->pdrv, data, disk->lba + first, (UINT)(end - first));
+        if (dr != RES_OK)
+        {
+            printf("[SD_DISK] Track %d read failed, error: %d\n", track, dr);
+            memset(data + offset % FF_MIN_SS, 0x00, TRACK_SIZE);
+        }
+        return;
+    }
+#endif
 
-    uint32_t seek_offset = disk->track * TRACK_SIZE;
-    
-    // Seek to track position in file
-    FRESULT fr = f_lseek(&disk->fil, seek_offset);
+    UINT bytes_read = 0;
+    FRESULT fr = f_lseek(&disk->fil, (FSIZE_t)track * TRACK_SIZE);
     if (fr != FR_OK)
     {
-        printf("[SD_DISK] Seek failed for track %u, error: %d\n", disk->track, fr);
+        printf("[SD_DISK] Seek failed for track %d, error: %d\n", track, fr);
+    }
+    else
+    {
+        // FatFs transfers the whole 512-byte blocks inside the range straight into the slot
+        fr = f_read(&disk->fil, data, TRACK_SIZE, &bytes_read);
+        if (fr != FR_OK)
+        {
+            printf("[SD_DISK] Track %d read failed, error: %d\n", track, fr);
+            bytes_read = 0;
+        }
     }
 
-    disk->diskPointer = seek_offset;
-    disk->haveSectorData = false;
-    disk->sectorPointer = 0;
-    disk->sector = 0;
+    // Short image: the missing tail of the track reads as zeroes
+    if (bytes_read < TRACK_SIZE)
+    {
+        memset(data + bytes_read, 0x00, TRACK_SIZE - bytes_read);
+    }
+}
+
+#ifdef ALTAIR_SD_DIRECT_LBA
+// Write the card blocks holding dirty sectors of a contiguous image straight from the slot, one
+// disk_write per run of consecutive sectors. The edges of the run carry the neighbouring
+// sectors as read with the track, which nothing else has changed since.
+static void write_track_blocks(sd_disk_t* disk, const uint8_t* data, int16_t track, uint32_t dirty)
+{
+    BYTE pdrv = disk->fil.obj.fs->pdrv;
+    uint32_t offset = (uint32_t)track * TRACK_SIZE;
+    uint32_t track_block = offset / FF_MIN_SS;
+    DRESULT dr = RES_OK;
+    uint8_t first = 0;
+
+    while (first < SECTORS_PER_TRACK && dr == RES_OK)
+    {
+        if ((dirty & (1u << first)) == 0)
+        {
+            first++;
+            continue;
+        }
+
+        uint8_t end = first + 1;
+        while (end < SECTORS_PER_TRACK && (dirty & (1u << end)))
+        {
+            end++;
+        }
+
+        uint32_t block = (offset + first * SECTOR_SIZE) / FF_MIN_SS;
+        uint32_t block_end = (offset + end * SECTOR_SIZE + FF_MIN_SS - 1) / FF_MIN_SS;
+        dr = disk_write(pdrv, data + (block - track_block) * FF_MIN_SS, disk->lba + block, (UINT)(block_end - block));
+        first = end;
+    }
+
+    if (dr != RES_OK)
+    {
+        printf("[SD_DISK] Track %d write failed, error: %d\n", track, dr);
+    }
+    else
+    {
+        disk_ioctl(pdrv, CTRL_SYNC, NULL);
+    }
+}
+#endif
+
+// Write the dirty sectors of a track from its slot to the card, one f_write per run of
+// consecutive sectors, followed by a single f_sync (runs on the core doing the I/O)
+static void write_track(sd_disk_t* disk, const uint8_t* data, int16_t track, uint32_t dirty)
+{
+    if (dirty == 0)
+    {
+        return;
+    }
+
+#ifdef ALTAIR_SD_DIRECT_LBA
+    if (disk->lba != 0)
+    {
+        write_track_blocks(disk, data, track, dirty);
+        return;
+    }
+#endif
+
+    FSIZE_t track_base = (FSIZE_t)track * TRACK_SIZE;
+    FRESULT fr = FR_OK;
+    uint8_t first = 0;
+
+    while (first < SECTORS_PER_TRACK && fr == FR_OK)
+    {
+        if ((dirty & (1u << first)) == 0)
+        {
+            first++;
+            continue;
+        }
+
+        uint8_t end = first + 1;
+        while (end < SECTORS_PER_TRACK && (dirty & (1u << end)))
+        {
+            end++;
+        }
+
+        UINT length = (UINT)(end - first) * SECTOR_SIZE;
+        UINT bytes_written;
+        fr = f_lseek(&disk->fil, track_base + (FSIZE_t)first * SECTOR_SIZE);
+        if (fr == FR_OK)
+        {
+            fr = f_write(&disk->fil, data + first * SECTOR_SIZE, length, &bytes_written);
+        }
+        if (fr == FR_OK && bytes_written != length)
+        {
+            printf("[SD_DISK] Track %d write incomplete: wrote %u of %u bytes\n", track, bytes_written, length);
+        }
+        first = end;
+    }
+
+    if (fr != FR_OK)
+    {
+        printf("[SD_DISK] Track %d write failed, error: %d\n", track, fr);
+    }
+    else
+    {
+        // One FAT/directory update per track instead of one per sector
+        f_sync(&disk->fil);
+    }
+}
+
+// Write back, then read the slot of a request (runs on the core doing the I/O)
+static void run_request(const sd_disk_request_t* request)
+{
+    uint8_t* data = track_slots[request->slot].data;
+    write_track(&sd_disk_controller.disk[request->flush_drive], data, request->flush_track, request->dirty);
+    if (request->op == SD_REQUEST_LOAD)
+    {
+        read_track(&sd_disk_controller.disk[request->drive], data, request->load_track);
+    }
+}
+
+// Core 0: apply completed core 1 requests
+static void collect_responses(void)
+{
+    sd_disk_response_t response;
+    while (queue_try_remove(&response_queue, &response))
+    {
+        if (response.op == SD_REQUEST_CALL)
+        {
+            call_busy = false;
+            continue;
+        }
+
+        sd_disk_t* disk = &sd_disk_controller.disk[response.drive];
+        if (response.op == SD_REQUEST_LOAD)
+        {
+            disk->cachedTrack = response.loaded_track;
+        }
+        disk->busy = false;
+    }
+}
+
+// Core 0: a free slot, else the least recently used one of a drive with no I/O in flight,
+// NO_SLOT while every slot is in use by such I/O
+static int8_t find_slot(void)
+{
+    int8_t found = NO_SLOT;
+    for (int8_t i = 0; i < SD_TRACK_SLOTS; i++)
+    {
+        if (track_slots[i].owner == NO_SLOT)
+        {
+            return i;
+        }
+        if (!sd_disk_controller.disk[track_slots[i].owner].busy &&
+            (found == NO_SLOT || (int32_t)(track_slots[i].last_used - track_slots[found].last_used) < 0))
+        {
+            found = i;
+        }
+    }
+    return found;
+}
+
+// Start replacing the drive's slot contents with the current track. A drive without a slot
+// takes one from another drive, whose dirty sectors are written back first in the same request.
+// With the core 1 service online this only posts the request; otherwise the I/O is done here.
+static void start_load(sd_disk_t* disk)
+{
+    uint8_t drive = (uint8_t)(disk - sd_disk_controller.disk);
+    sd_disk_t* owner = disk;
+
+    if (disk->slot == NO_SLOT)
+    {
+        int8_t slot = find_slot();
+        if (slot == NO_SLOT)
+        {
+            return; // Tried again on the next access
+        }
+        if (track_slots[slot].owner != NO_SLOT)
+        {
+            owner = &sd_disk_controller.disk[track_slots[slot].owner];
+            owner->slot = NO_SLOT;
+            owner->trackData = NULL;
+        }
+        track_slots[slot].owner = (int8_t)drive;
+        disk->slot = slot;
+    }
+
+    sd_disk_request_t request = {.drive = drive,
+                                 .op = SD_REQUEST_LOAD,
+                                 .slot = (uint8_t)disk->slot,
+                                 .flush_drive = (uint8_t)(owner - sd_disk_controller.disk),
+                                 .flush_track = owner->cachedTrack,
+                                 .load_track = disk->track,
+                                 .dirty = owner->dirtySectors};
+
+    owner->dirtySectors = 0;
+    owner->cachedTrack = NO_CACHED_TRACK;
+    disk->cachedTrack = NO_CACHED_TRACK;
+    disk->trackData = slot_track_data(disk, disk->slot, disk->track);
+
+    if (service_online)
+    {
+        disk->busy = true;
+        queue_add_blocking(&request_queue, &request);
+        return;
+    }
+
+    run_request(&request);
+    disk->cachedTrack = request.load_track;
+}
+
+// True when trackData holds the current track and no I/O is in flight; starts the load if needed
+static bool track_ready(sd_disk_t* disk)
+{
+    collect_responses();
+
+    if (disk->busy)
+    {
+        return false;
+    }
+    if (disk->cachedTrack != disk->track)
+    {
+        start_load(disk);
+    }
+    if (disk->busy || disk->cachedTrack != disk->track)
+    {
+        return false;
+    }
+    track_slots[disk->slot].last_used = ++slot_clock;
+    return true;
+}
+
+// Like track_ready, but waits for core 1 (guest accessed data without waiting for sector true)
+static void load_track(sd_disk_t* disk)
+{
+    while (!track_ready(disk))
+    {
+        wait_idle(disk);
+    }
+}
+
+// Core 0: wait for the drive's in-flight request to complete
+static void wait_idle(sd_disk_t* disk)
+{
+    collect_responses();
+    while (disk->busy)
+    {
+        tight_loop_contents();
+        collect_responses();
+    }
+}
+
+// Core 1: execute queued track I/O. The first call moves all disk I/O to this core.
+void sd_disk_service_poll(void)
+{
+    if (!service_ready)
+    {
+        return;
+    }
+    service_online = true;
+
+    sd_disk_request_t request;
+    while (queue_try_remove(&request_queue, &request))
+    {
+        if (request.op == SD_REQUEST_CALL)
+        {
+            sd_disk_response_t response = {.op = SD_REQUEST_CALL};
+            request.fn(request.arg);
+            queue_add_blocking(&response_queue, &response);
+            continue;
+        }
+
+        sd_disk_response_t response = {.drive = request.drive, .op = request.op, .loaded_track = request.load_track};
+        run_request(&request);
+        queue_add_blocking(&response_queue, &response);
+    }
+}
+
+// Core 0: run fn on the core that owns FatFs and wait for it. Queued behind the track I/O
+// already posted, so SD card devices other than the floppies never race the write-back.
+void sd_disk_io_call(sd_disk_io_fn fn, void* arg)
+{
+    if (!service_online)
+    {
+        fn(arg);
+        return;
+    }
+
+    sd_disk_request_t request = {.op = SD_REQUEST_CALL, .fn = fn, .arg = arg};
+    call_busy = true;
+    queue_add_blocking(&request_queue, &request);
+    while (call_busy)
+    {
+        tight_loop_contents();
+        collect_responses();
+    }
 }
 
 // Initialize disk controller
@@ -66,47 +478,164 @@ void sd_disk_init(void)
         sd_disk_controller.disk[i].track = 0;
         sd_disk_controller.disk[i].sector = 0;
         sd_disk_controller.disk[i].disk_loaded = false;
+        sd_disk_controller.disk[i].cachedTrack = NO_CACHED_TRACK;
+        sd_disk_controller.disk[i].slot = NO_SLOT;
     }
+    for (int i = 0; i < SD_TRACK_SLOTS; i++)
+    {
+        track_slots[i].owner = NO_SLOT;
+    }
+
+    io_port_register_response(SD_DISK_MOUNT_PORT, mount_port_output);
 
     // Select drive 0 by default
     sd_disk_controller.current = &sd_disk_controller.disk[0];
     sd_disk_controller.currentDisk = 0;
+
+    if (!service_ready)
+    {
+        queue_init(&request_queue, sizeof(sd_disk_request_t), MAX_DRIVES + 1);
+        queue_init(&response_queue, sizeof(sd_disk_response_t), MAX_DRIVES + 1);
+        service_ready = true;
+    }
 }
 
-// Load disk image for specified drive from SD card
-bool sd_disk_load(uint8_t drive, const char* disk_path)
+// Extend a short image to DISK_SIZE with zeroes, which is what its missing tracks read as. The
+// file has to be full size before fast seek, which cannot grow it, is turned on.
+static bool pad_image(FIL* fil)
 {
-    if (drive >= MAX_DRIVES)
+    FRESULT fr = f_lseek(fil, f_size(fil));
+    while (fr == FR_OK && f_size(fil) < DISK_SIZE)
     {
-        printf("[SD_DISK] Invalid drive number: %u\n", drive);
-        return false;
+        UINT length = (UINT)(DISK_SIZE - f_size(fil));
+        UINT written = 0;
+        fr = f_write(fil, zero_block, length < sizeof(zero_block) ? length : sizeof(zero_block), &written);
+        if (written == 0)
+        {
+            fr = FR_DENIED; // Card full
+        }
     }
+    return f_sync(fil) == FR_OK && fr == FR_OK;
+}
 
-    sd_disk_t* disk = &sd_disk_controller.disk[drive];
-
-    // Close existing file if open
-    if (disk->disk_loaded)
+// Core 0: the slot only holds a track of the old image once it is written back, another drive
+// may have it
+static void release_slot(sd_disk_t* disk)
+{
+    if (disk->slot != NO_SLOT)
     {
-        f_close(&disk->fil);
-        disk->disk_loaded = false;
+        track_slots[disk->slot].owner = NO_SLOT;
+        disk->slot = NO_SLOT;
+        disk->trackData = NULL;
     }
+    disk->cachedTrack = NO_CACHED_TRACK;
+}
+
+// Core 0: write back everything of the image in the drive and wait until it is on the card
+static void sync_drive(sd_disk_t* disk)
+{
+    writeSector(disk);
+    flush_track(disk);
+    wait_idle(disk);
+}
+
+typedef struct
+{
+    sd_disk_t* disk;
+    const char* path;
+    bool opened;
+} sd_disk_open_t;
 
-    // Open disk file for read/write
-    FRESULT fr = f_open(&disk->fil, disk_path, FA_READ | FA_WRITE);
+// The FatFs part of sd_disk_load, run by sd_disk_io_call. The old image is only closed once the
+// new one is open, so a drive keeps its disk when the name is wrong.
+static void open_image(void* arg)
+{
+    sd_disk_open_t* open = arg;
+    sd_disk_t* disk = open->disk;
+    const char* disk_path = open->path;
+
+    FIL fil;
+    FRESULT fr = f_open(&fil, disk_path, FA_READ | FA_WRITE);
     if (fr != FR_OK)
     {
         printf("[SD_DISK] Failed to open %s, error: %d\n", disk_path, fr);
-        return false;
+        open->opened = false;
+        return;
     }
 
+    // Close existing file if open
+    if (disk->disk_loaded)
+    {
+        f_close(&disk->fil);
+    }
+    disk->fil = fil;
+#ifdef ALTAIR_SD_DIRECT_LBA
+    disk->lba = 0;
+#endif
+
     // Verify file size
     FSIZE_t file_size = f_size(&disk->fil);
     if (file_size < DISK_SIZE)
     {
         printf("[SD_DISK] Warning: %s is smaller than expected (%lu bytes)\n", 
                disk_path, (unsigned long)file_size);
+        if (!pad_image(&disk->fil))
+        {
+            printf("[SD_DISK] Could not extend %s, writes past its end fail\n", disk_path);
+        }
+    }
+
+    // Fast seek: track seeks look up their cluster in the link map instead of the FAT
+    disk->clmt[0] = SD_DISK_CLMT_ITEMS;
+    disk->fil.cltbl = disk->clmt;
+    fr = f_lseek(&disk->fil, CREATE_LINKMAP);
+    if (fr != FR_OK)
+    {
+        printf("[SD_DISK] %s is in more than %d fragments, seeks follow the FAT (copy it to defragment)\n",
+               disk_path, SD_DISK_CLMT_ITEMS / 2 - 1);
+        disk->fil.cltbl = NULL;
+    }
+
+#ifdef ALTAIR_SD_DIRECT_LBA
+    // A map of a single fragment (length and first cluster) means the image is contiguous
+    if (disk->fil.cltbl != NULL && disk->clmt[0] == 4 && f_size(&disk->fil) >= DISK_SIZE)
+    {
+        const FATFS* fs = disk->fil.obj.fs;
+        disk->lba = fs->database + (LBA_t)(disk->clmt[2] - 2) * fs->csize;
+        printf("[SD_DISK] %s is contiguous from card block %lu, I/O bypasses FatFs\n", disk_path,
+               (unsigned long)disk->lba);
+    }
+#endif
+    open->opened = true;
+}
+
+// Load disk image for specified drive from SD card
+bool sd_disk_load(uint8_t drive, const char* disk_path)
+{
+    if (drive >= MAX_DRIVES)
+    {
+        printf("[SD_DISK] Invalid drive number: %u\n", drive);
+        return false;
+    }
+
+    sd_disk_t* disk = &sd_disk_controller.disk[drive];
+
+    // Everything written to the old image goes to the card before it is closed
+    if (disk->disk_loaded)
+    {
+        sync_drive(disk);
+    }
+
+    sd_disk_open_t open = {.disk = disk, .path = disk_path};
+    sd_disk_io_call(open_image, &open);
+    if (!open.opened)
+    {
+        return false;
     }
 
+    release_slot(disk);
+
+    snprintf(disk->path, sizeof(disk->path), "%s", disk_path);
     disk->disk_loaded = true;
     disk->diskPointer = 0;
     disk->sector = 0;
@@ -115,6 +644,8 @@ bool sd_disk_load(uint8_t drive, const char* disk_path)
     disk->sectorDirty = false;
     disk->haveSectorData = false;
     disk->write_status = 0;
+    disk->cachedTrack = NO_CACHED_TRACK;
+    disk->dirtySectors = 0;
 
     // Start from default hardware reset value, then reflect initial state
     disk->status = STATUS_DEFAULT;
@@ -125,6 +656,150 @@ bool sd_disk_load(uint8_t drive, const char* disk_path)
     return true;
 }
 
+bool sd_disk_mount(uint8_t drive, const char* name)
+{
+    char path[SD_DISK_PATH_MAX];
+    if (strchr(name, '/') != NULL)
+    {
+        snprintf(path, sizeof(path), "%s", name);
+    }
+    else
+    {
+        snprintf(path, sizeof(path), "%s/%s", SD_DISK_DIR, name);
+    }
+
+    if (!sd_disk_load(drive, path))
+    {
+        return false;
+    }
+    printf("[SD_DISK] Drive %c: %s\n", 'A' + drive, path);
+    return true;
+}
+
+static void close_image(void* arg)
+{
+    f_close(&((sd_disk_t*)arg)->fil);
+}
+
+void sd_disk_eject(uint8_t drive)
+{
+    if (drive >= MAX_DRIVES || !sd_disk_controller.disk[drive].disk_loaded)
+    {
+        return;
+    }
+
+    sd_disk_t* disk = &sd_disk_controller.disk[drive];
+    sync_drive(disk);
+    sd_disk_io_call(close_image, disk);
+    release_slot(disk);
+    disk->disk_loaded = false;
+    disk->path[0] = '\0';
+}
+
+const char* sd_disk_image(uint8_t drive)
+{
+    if (drive >= MAX_DRIVES || !sd_disk_controller.disk[drive].disk_loaded)
+    {
+        return NULL;
+    }
+    return sd_disk_controller.disk[drive].path;
+}
+
+typedef struct
+{
+    uint16_t index;
+    char* name;
+    size_t name_len;
+    uint32_t size;
+    bool found;
+} sd_disk_find_t;
+
+static bool is_image_name(const char* name)
+{
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".dsk") == 0;
+}
+
+// The directory scan of sd_disk_find_image, run by sd_disk_io_call
+static void find_image(void* arg)
+{
+    sd_disk_find_t* find = arg;
+    static FILINFO info; // Long file names make it too large for the stack
+    DIR dir;
+    uint16_t index = 0;
+
+    find->found = false;
+    if (f_opendir(&dir, SD_DISK_DIR) != FR_OK)
+    {
+        return;
+    }
+    while (f_readdir(&dir, &info) == FR_OK && info.fname[0] != '\0')
+    {
+        if ((info.fattrib & AM_DIR) || !is_image_name(info.fname) || index++ != find->index)
+        {
+            continue;
+        }
+        snprintf(find->name, find->name_len, "%s", info.fname);
+        find->size = (uint32_t)info.fsize;
+        find->found = true;
+        break;
+    }
+    f_closedir(&dir);
+}
+
+bool sd_disk_find_image(uint16_t index, char* name, size_t name_len, uint32_t* size)
+{
+    sd_disk_find_t find = {.index = index, .name = name, .name_len = name_len};
+    sd_disk_io_call(find_image, &find);
+    if (find.found && size != NULL)
+    {
+        *size = find.size;
+    }
+    return find.found;
+}
+
+// SD_DISK_MOUNT_PORT command being received
+static char mount_command[SD_DISK_PATH_MAX];
+static size_t mount_length = 0;
+
+static size_t mount_port_output(int port, uint8_t data, char* buffer, size_t buffer_length)
+{
+    (void)port;
+    if (data != 0)
+    {
+        if (mount_length < sizeof(mount_command) - 1)
+        {
+            mount_command[mount_length++] = (char)data;
+        }
+        return 0;
+    }
+
+    mount_command[mount_length] = '\0';
+    mount_length = 0;
+
+    if (mount_command[0] == '#')
+    {
+        if (!sd_disk_find_image((uint16_t)strtoul(mount_command + 1, NULL, 10), buffer, buffer_length, NULL))
+        {
+            return 0;
+        }
+        return strlen(buffer);
+    }
+
+    uint8_t drive = (uint8_t)(toupper((unsigned char)mount_command[0]) - 'A');
+    if (drive >= MAX_DRIVES || mount_command[1] != ':')
+    {
+        return (size_t)snprintf(buffer, buffer_length, "ERROR");
+    }
+    if (mount_command[2] == '\0')
+    {
+        const char* image = sd_disk_image(drive);
+        return image != NULL ? (size_t)snprintf(buffer, buffer_length, "%s", image) : 0;
+    }
+    return (size_t)snprintf(buffer, buffer_length, "%s", sd_disk_mount(drive, mount_command + 2) ? "OK" : "ERROR");
+}
+
+
 // Select disk drive
 void sd_disk_select(uint8_t drive)
 {
@@ -145,7 +820,15 @@ void sd_disk_select(uint8_t drive)
 // Get disk status
 uint8_t sd_disk_status(void)
 {
-    return sd_disk_controller.current->status;
+    sd_disk_t* disk = sd_disk_controller.current;
+
+    // No read data while core 1 is still transferring the track
+    collect_responses();
+    if (disk->busy)
+    {
+        return disk->status | STATUS_NRDA;
+    }
+    return disk->status;
 }
 
 // Disk control function
@@ -158,6 +841,12 @@ void sd_disk_function(uint8_t control)
         return;
     }
 
+    // A partly written sector belongs to the track the head is leaving
+    if ((control & (CONTROL_STEP_IN | CONTROL_STEP_OUT)) && disk->sectorDirty)
+    {
+        writeSector(disk);
+    }
+
     // Step in (increase track)
     if (control & CONTROL_STEP_IN)
     {
@@ -228,16 +917,14 @@ uint8_t sd_disk_sector(void)
         writeSector(disk);
     }
 
-    uint32_t seek_offset = disk->track * TRACK_SIZE + disk->sector * SECTOR_SIZE;
-    
-    // Seek to sector position in file
-    FRESULT fr = f_lseek(&disk->fil, seek_offset);
-    if (fr != FR_OK)
+    // Until the track is in the cache the head is never over a sector start (D0 stays 1), so
+    // the guest keeps polling like it would while a real disk rotates
+    if (!track_ready(disk))
     {
-        printf("[SD_DISK] Seek failed for sector, error: %d\n", fr);
+        return (uint8_t)(0xC0 | (disk->sector << SECTOR_SHIFT_BITS) | 1);
     }
 
-    disk->diskPointer = seek_offset;
+    disk->diskPointer = disk->track * TRACK_SIZE + disk->sector * SECTOR_SIZE;
     disk->sectorPointer = 0;
     disk->haveSectorData = false;
 
@@ -297,27 +984,10 @@ uint8_t sd_disk_read(void)
     if (!disk->haveSectorData)
     {
         disk->sectorPointer = 0;
-        memset(disk->sectorData, 0x00, SECTOR_SIZE);
 
-        // Read sector from SD card
-        UINT bytes_read;
-        FRESULT fr = f_read(&disk->fil, disk->sectorData, SECTOR_SIZE, &bytes_read);
-        
-        if (fr != FR_OK)
-        {
-            printf("[SD_DISK] Sector read failed, error: %d\n", fr);
-            disk->haveSectorData = false;
-        }
-        else if (bytes_read != SECTOR_SIZE)
-        {
-            printf("[SD_DISK] Sector read incomplete: read %u of %u bytes\n", 
-                   bytes_read, SECTOR_SIZE);
-            disk->haveSectorData = (bytes_read > 0);
-        }
-        else
-        {
-            disk->haveSectorData = true;
-        }
+        load_track(disk);
+        memcpy(disk->sectorData, disk->trackData + (disk->diskPointer - disk->track * TRACK_SIZE), SECTOR_SIZE);
+        disk->haveSectorData = true;
     }
 
     // Return current byte and advance pointer within sector
@@ -332,25 +1002,105 @@ static void writeSector(sd_disk_t* pDisk)
         return;
     }
 
-    // Write sector to SD card
-    UINT bytes_written;
-    FRESULT fr = f_write(&pDisk->fil, pDisk->sectorData, SECTOR_SIZE, &bytes_written);
-    
-    if (fr != FR_OK)
+    pDisk->sectorPointer = 0;
+    pDisk->sectorDirty = false;
+    sector_writes++;
+
+    // The sector only goes into the track cache and is written back later
+    uint32_t track_offset = pDisk->diskPointer - pDisk->track * TRACK_SIZE;
+    if (track_offset + SECTOR_SIZE <= TRACK_SIZE)
     {
-        printf("[SD_DISK] Sector write failed, error: %d\n", fr);
+        load_track(pDisk);
+        memcpy(pDisk->trackData + track_offset, pDisk->sectorData, SECTOR_SIZE);
+        pDisk->dirtySectors |= 1u << (track_offset / SECTOR_SIZE);
     }
-    else if (bytes_written != SECTOR_SIZE)
+}
+
+// Start writing back the dirty sectors of the cached track
+static void flush_track(sd_disk_t* disk)
+{
+    collect_responses();
+    if (disk->busy || disk->dirtySectors == 0)
     {
-        printf("[SD_DISK] Sector write incomplete: wrote %u of %u bytes\n", 
-               bytes_written, SECTOR_SIZE);
+        return;
     }
-    else
+
+    sd_disk_request_t request = {.drive = (uint8_t)(disk - sd_disk_controller.disk),
+                                 .op = SD_REQUEST_FLUSH,
+                                 .slot = (uint8_t)disk->slot,
+                                 .flush_drive = (uint8_t)(disk - sd_disk_controller.disk),
+                                 .flush_track = disk->cachedTrack,
+                                 .load_track = disk->cachedTrack,
+                                 .dirty = disk->dirtySectors};
+    disk->dirtySectors = 0;
+
+    if (service_online)
     {
-        // Flush to ensure data is written to SD card
-        f_sync(&pDisk->fil);
+        disk->busy = true;
+        queue_add_blocking(&request_queue, &request);
+        return;
     }
 
-    pDisk->sectorPointer = 0;
-    pDisk->sectorDirty = false;
+    run_request(&request);
+}
+
+// Write back all drives and wait until the data is on the card
+void sd_disk_flush(void)
+{
+    for (int i = 0; i < MAX_DRIVES; i++)
+    {
+        if (sd_disk_controller.disk[i].disk_loaded)
+        {
+            flush_track(&sd_disk_controller.disk[i]);
+        }
+    }
+    for (int i = 0; i < MAX_DRIVES; i++)
+    {
+        wait_idle(&sd_disk_controller.disk[i]);
+    }
+    flush_pending = false;
+}
+
+// Sectors held in the track caches that are not on the card yet
+uint32_t sd_disk_dirty_sectors(void)
+{
+    uint32_t count = 0;
+    for (int i = 0; i < MAX_DRIVES; i++)
+    {
+        count += (uint32_t)__builtin_popcount(sd_disk_controller.disk[i].dirtySectors);
+    }
+    return count;
+}
+
+// Flush once writes have paused for SD_FLUSH_IDLE_US, or SD_FLUSH_MAX_AGE_US after the first unflushed write
+void sd_disk_poll(uint32_t now_us)
+{
+    if (sector_writes != polled_writes)
+    {
+        polled_writes = sector_writes;
+        last_write_us = now_us;
+        if (!flush_pending)
+        {
+            flush_pending = true;
+            first_dirty_us = now_us;
+        }
+    }
+
+    if (!flush_pending)
+    {
+        return;
+    }
+
+    // Only start the write-back, core 0 keeps emulating while core 1 does it
+    if (now_us - last_write_us >= SD_FLUSH_IDLE_US || now_us - first_dirty_us >= SD_FLUSH_MAX_AGE_US)
+    {
+        for (int i = 0; i < MAX_DRIVES; i++)
+        {
+            if (sd_disk_controller.disk[i].disk_loaded)
+            {
+                flush_track(&sd_disk_controller.disk[i]);
+            }
+        }
+        flush_pending = false;
+    }
 }
@@ -38,6 +38,36 @@
 #define TRACK_SIZE (SECTORS_PER_TRACK * SECTOR_SIZE)
 #define DISK_SIZE (MAX_TRACKS * TRACK_SIZE)
 
+// Write-back: dirty sectors stay in the track cache until the track changes, no sector has been
+// written for SD_FLUSH_IDLE_US, or the oldest unflushed write is SD_FLUSH_MAX_AGE_US old
+#ifndef SD_FLUSH_IDLE_US
+#define SD_FLUSH_IDLE_US 250000
+#endif
+#ifndef SD_FLUSH_MAX_AGE_US
+#define SD_FLUSH_MAX_AGE_US 2000000
+#endif
+
+// FatFs fast seek: a cluster link map per image lets seeks find their cluster without following
+// the FAT chain. It holds SD_DISK_CLMT_ITEMS / 2 - 1 fragments, enough for a copied image.
+#define SD_DISK_CLMT_ITEMS 34
+
+// Direct LBA (ALTAIR_SD_DIRECT_LBA): an image found in one piece at load is read and written
+// with disk_read/disk_write from its first card block, bypassing FatFs. The track cache is then
+// the run of SD_TRACK_BLOCKS card blocks the track lies in, and trackData points into it.
+#define SD_TRACK_BLOCKS ((TRACK_SIZE + FF_MIN_SS - 1) / FF_MIN_SS + 1)
+
+// Track caches shared by all drives. A drive takes a free slot, or the least recently used one
+// of a drive with no I/O in flight after writing its dirty sectors back, when its track is not
+// cached. With fewer slots than drives, drives used in turn reload their track.
+#ifndef SD_TRACK_SLOTS
+#define SD_TRACK_SLOTS 2
+#endif
+#ifdef ALTAIR_SD_DIRECT_LBA
+#define SD_TRACK_SLOT_SIZE (SD_TRACK_BLOCKS * FF_MIN_SS)
+#else
+#define SD_TRACK_SLOT_SIZE TRACK_SIZE
+#endif
+
 // Drive selection
 #define MAX_DRIVES 4
 #define DRIVE_SELECT_MASK 0x0F
@@ -55,6 +85,18 @@
 #define DISK_C_PATH "Disks/escape-posix.dsk"
 #define DISK_D_PATH "Disks/blank.dsk"
 
+// Images for MOUNT and the mount port: a name without a '/' is looked up in SD_DISK_DIR, and
+// DISKS lists the .dsk files there
+#define SD_DISK_DIR "Disks"
+#define SD_DISK_PATH_MAX 64
+
+// Mount port: OUT a NUL-terminated command, then read the reply from IO_PORT_RESPONSE
+//   "B:NAME.DSK"  Mount the image into drive B, replies "OK" or "ERROR". The drive keeps its old
+//                 image if the new one cannot be opened.
+//   "B:"          Replies the image in drive B, empty if none
+//   "#3"          Replies the name of the fourth image in SD_DISK_DIR, empty past the last one
+#define SD_DISK_MOUNT_PORT 0xFC
+
 typedef struct
 {
     FIL fil;                                 // FatFs file handle
@@ -68,6 +110,16 @@ typedef struct
     bool sectorDirty;                        // Sector needs writing back
     bool haveSectorData;                     // Sector buffer is valid
     bool disk_loaded;                        // Disk file is open
+    int16_t cachedTrack;                     // Track held in trackData, -1 if none
+    uint32_t dirtySectors;                   // Bit per trackData sector not yet written to the card
+    bool busy;                               // Track I/O in flight on core 1, trackData off limits
+    int8_t slot;                             // Track cache slot owned, -1 if none
+    uint8_t* trackData;                      // Whole-track read cache, inside the slot
+#ifdef ALTAIR_SD_DIRECT_LBA
+    LBA_t lba;                               // First card block of a contiguous image, 0 to use FatFs
+#endif
+    DWORD clmt[SD_DISK_CLMT_ITEMS];          // Cluster link map of fil (FatFs fast seek)
+    char path[SD_DISK_PATH_MAX];             // Image file, as opened
 } sd_disk_t;
 
 typedef struct
@@ -88,8 +140,35 @@ uint8_t sd_disk_sector(void);
 void sd_disk_write(uint8_t data);
 uint8_t sd_disk_read(void);
 
-// Initialization
+// Initialization, also registers SD_DISK_MOUNT_PORT
 void sd_disk_init(void);
 bool sd_disk_load(uint8_t drive, const char* disk_path);
 
+// Hot swap (core 0, any time): the drive's dirty sectors are written back and only its cache
+// is dropped. A name without a '/' is taken from SD_DISK_DIR.
+bool sd_disk_mount(uint8_t drive, const char* name);
+
+// Write back and close the image in a drive, which is then empty (core 0)
+void sd_disk_eject(uint8_t drive);
+
+// Image file in a drive, NULL if the drive is empty
+const char* sd_disk_image(uint8_t drive);
+
+// Name and size of the index-th .dsk file in SD_DISK_DIR, false past the last one
+bool sd_disk_find_image(uint16_t index, char* name, size_t name_len, uint32_t* size);
+
+// Write-back cache control (core 0)
+void sd_disk_flush(void);
+void sd_disk_poll(uint32_t now_us);
+uint32_t sd_disk_dirty_sectors(void);
+
+// Run fn where the FatFs I/O happens (core 1 once its service is online) and wait for it.
+// Other devices on the card, e.g. the hard disk, go through this so FatFs stays on one core.
+typedef void (*sd_disk_io_fn)(void* arg);
+void sd_disk_io_call(sd_disk_io_fn fn, void* arg);
+
+// Core 1: execute the track reads/writes posted by core 0. Until core 1 first calls this
+// (e.g. no Wi-Fi), core 0 does the FatFs I/O itself.
+void sd_disk_service_poll(void);
+
 #endif // _PICO_88DCDD_SD_CARD_H_
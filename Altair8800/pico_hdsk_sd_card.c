@@ -0,0 +1,327 @@
+#include "pico_hdsk_sd_card.h"
+
+#include "io_ports.h"
+#include "memory.h"
+#include "pico_88dcdd_sd_card.h"
+#include <stdio.h>
+#include <string.h>
+
+// SIMH style hard disk emulation for Pico with SD Card
+// Sectors go straight between the image file and the guest's memory pages
+
+static hdsk_t hdsk[HDSK_MAX_DRIVES];
+
+// Command block being received on HDSK_PORT
+static uint8_t command = HDSK_CMD_NONE;
+static uint8_t position = 0;
+static uint8_t block[7];
+
+// HDSK_CMD_PARAM reply
+static uint8_t param[HDSK_DPB_SIZE + 2];
+static uint8_t param_pointer = sizeof(param);
+
+// Sync timing state for hdsk_poll
+static uint32_t sector_writes = 0;
+static uint32_t polled_writes = 0;
+static uint32_t last_write_us = 0;
+
+// Sector transfer, run by sd_disk_io_call on the core that owns FatFs
+typedef struct
+{
+    hdsk_t* disk;
+    bool write;
+    FSIZE_t offset;
+    uint16_t dma;
+    uint8_t result;
+} hdsk_transfer_t;
+
+// Move the sector one memory page at a time, a ROM page's write pointer aims at the discard page
+static void transfer(void* arg)
+{
+    hdsk_transfer_t* t = (hdsk_transfer_t*)arg;
+
+    FRESULT fr = f_lseek(&t->disk->fil, t->offset);
+    uint32_t done = 0;
+    while (fr == FR_OK && done < HDSK_SECTOR_SIZE)
+    {
+        uint16_t address = (uint16_t)(t->dma + done);
+        uint32_t length = MEMORY_PAGE_SIZE - (address & MEMORY_PAGE_MASK);
+        if (length > HDSK_SECTOR_SIZE - done)
+        {
+            length = HDSK_SECTOR_SIZE - done;
+        }
+
+        UINT count = 0;
+        if (t->write)
+        {
+            fr = f_write(&t->disk->fil, memory_main.read_map[address >> MEMORY_PAGE_SHIFT] + (address & MEMORY_PAGE_MASK),
+                         length, &count);
+        }
+        else
+        {
+            fr = f_read(&t->disk->fil, memory_main.write_map[address >> MEMORY_PAGE_SHIFT] + (address & MEMORY_PAGE_MASK),
+                        length, &count);
+            memory_mark_dirty_range(&memory_main, address, length);
+        }
+        if (fr == FR_OK && count != length)
+        {
+            fr = FR_DISK_ERR;
+        }
+        done += length;
+    }
+
+    if (fr != FR_OK)
+    {
+        printf("[HDSK] Sector %s failed at offset %lu, error: %d\n", t->write ? "write" : "read",
+               (unsigned long)t->offset, fr);
+    }
+    t->result = fr == FR_OK ? HDSK_OK : HDSK_ERROR;
+}
+
+static void sync_disk(void* arg)
+{
+    hdsk_t* disk = (hdsk_t*)arg;
+    f_sync(&disk->fil);
+}
+
+static uint8_t execute(bool write)
+{
+    uint8_t drive = block[1];
+    uint8_t sector = block[2];
+    uint32_t track = block[3] | ((uint32_t)block[4] << 8);
+    uint16_t dma = (uint16_t)(block[5] | (block[6] << 8));
+
+    if (drive >= HDSK_MAX_DRIVES || !hdsk[drive].loaded || sector >= HDSK_SECTORS_PER_TRACK ||
+        track >= hdsk[drive].tracks)
+    {
+        return HDSK_ERROR;
+    }
+
+    hdsk_transfer_t t = {.disk = &hdsk[drive],
+                         .write = write,
+                         .offset = (FSIZE_t)track * HDSK_TRACK_SIZE + (FSIZE_t)sector * HDSK_SECTOR_SIZE,
+                         .dma = dma,
+                         .result = HDSK_ERROR};
+    sd_disk_io_call(transfer, &t);
+
+    if (write)
+    {
+        hdsk[drive].unsynced = true;
+        hdsk[drive].writes++;
+        sector_writes++;
+    }
+    return t.result;
+}
+
+static inline void put16(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+// CP/M 3 disk parameter block for the drive's image size, followed by the sector size
+static void build_param(uint8_t drive)
+{
+    memset(param, 0, sizeof(param));
+    param_pointer = 0;
+
+    if (drive >= HDSK_MAX_DRIVES || !hdsk[drive].loaded || hdsk[drive].tracks <= HDSK_RESERVED_TRACKS)
+    {
+        return;
+    }
+
+    uint32_t blocks = (hdsk[drive].tracks - HDSK_RESERVED_TRACKS) * HDSK_TRACK_SIZE / HDSK_BLOCK_SIZE;
+    uint32_t dsm = (blocks > 0x10000 ? 0x10000 : blocks) - 1;
+    uint16_t dir_blocks = HDSK_DIR_ENTRIES * 32 / HDSK_BLOCK_SIZE;
+    uint16_t al = (uint16_t)(0xFFFF << (16 - dir_blocks));
+    uint8_t records = HDSK_SECTOR_SIZE / 128;
+    uint8_t psh = 0;
+    while ((1u << psh) < records)
+    {
+        psh++;
+    }
+
+    put16(&param[0], HDSK_SECTORS_PER_TRACK * records); // SPT, 128-byte records per track
+    param[2] = 5;                                          // BSH, 4 KB blocks
+    param[3] = 31;                                         // BLM
+    param[4] = dsm < 256 ? 3 : 1;                          // EXM
+    put16(&param[5], dsm);                                 // DSM
+    put16(&param[7], HDSK_DIR_ENTRIES - 1);                // DRM
+    param[9] = (uint8_t)(al >> 8);                         // AL0
+    param[10] = (uint8_t)al;                               // AL1
+    put16(&param[11], 0x8000);                             // CKS, fixed disk
+    put16(&param[13], HDSK_RESERVED_TRACKS);               // OFF
+    param[15] = psh;                                       // PSH
+    param[16] = (uint8_t)(records - 1);                    // PHM
+    put16(&param[HDSK_DPB_SIZE], HDSK_SECTOR_SIZE);
+}
+
+void hdsk_out(uint8_t data)
+{
+    // Drive number following HDSK_CMD_PARAM
+    if (command == HDSK_CMD_PARAM && position == 1)
+    {
+        build_param(data);
+        command = HDSK_CMD_NONE;
+        position = 0;
+        return;
+    }
+
+    if (position == 0)
+    {
+        block[0] = data;
+        param_pointer = sizeof(param);
+        switch (data)
+        {
+            case HDSK_CMD_READ:
+            case HDSK_CMD_WRITE:
+            case HDSK_CMD_PARAM:
+                command = data;
+                position = 1;
+                break;
+            default:
+                command = HDSK_CMD_NONE;
+                break;
+        }
+        return;
+    }
+
+    block[position++] = data;
+    if (position == sizeof(block))
+    {
+        position = 0; // Command block complete, executed by the next IN
+    }
+}
+
+uint8_t hdsk_in(void)
+{
+    if (param_pointer < sizeof(param))
+    {
+        return param[param_pointer++];
+    }
+
+    if ((command == HDSK_CMD_READ || command == HDSK_CMD_WRITE) && position == 0)
+    {
+        bool write = command == HDSK_CMD_WRITE;
+        command = HDSK_CMD_NONE;
+        return execute(write);
+    }
+
+    command = HDSK_CMD_NONE;
+    position = 0;
+    return HDSK_ERROR;
+}
+
+bool hdsk_load(uint8_t drive, const char* path)
+{
+    if (drive >= HDSK_MAX_DRIVES)
+    {
+        return false;
+    }
+
+    hdsk_t* disk = &hdsk[drive];
+    if (disk->loaded)
+    {
+        hdsk_flush();
+        f_close(&disk->fil);
+        disk->loaded = false;
+    }
+
+    if (f_open(&disk->fil, path, FA_READ | FA_WRITE) != FR_OK)
+    {
+        return false;
+    }
+
+    FSIZE_t tracks = f_size(&disk->fil) / HDSK_TRACK_SIZE;
+    if (tracks == 0)
+    {
+        printf("[HDSK] %s is smaller than one track, ignored\n", path);
+        f_close(&disk->fil);
+        return false;
+    }
+
+    disk->loaded = true;
+    disk->unsynced = false;
+    disk->writes = 0;
+    disk->tracks = tracks > HDSK_MAX_TRACKS ? HDSK_MAX_TRACKS : (uint32_t)tracks;
+    return true;
+}
+
+static uint8_t hdsk_port_in(void* context, uint8_t port)
+{
+    (void)context;
+    (void)port;
+    return hdsk_in();
+}
+
+static void hdsk_port_out(void* context, uint8_t port, uint8_t data)
+{
+    (void)context;
+    (void)port;
+    hdsk_out(data);
+}
+
+uint8_t hdsk_init(void)
+{
+    io_port_register_in(HDSK_PORT, hdsk_port_in, NULL);
+    io_port_register_out(HDSK_PORT, hdsk_port_out, NULL);
+
+    memset(hdsk, 0, sizeof(hdsk));
+    command = HDSK_CMD_NONE;
+    position = 0;
+    param_pointer = sizeof(param);
+
+    uint8_t attached = 0;
+    for (uint8_t i = 0; i < HDSK_MAX_DRIVES; i++)
+    {
+        char path[32];
+        snprintf(path, sizeof(path), HDSK_PATH_FORMAT, i);
+        if (hdsk_load(i, path))
+        {
+            printf("Hard disk %u: %s (%lu tracks, %lu KB)\n", i, path, (unsigned long)hdsk[i].tracks,
+                   (unsigned long)((uint64_t)hdsk[i].tracks * HDSK_TRACK_SIZE / 1024));
+            attached++;
+        }
+    }
+    return attached;
+}
+
+// Sync every image written to since the last sync
+void hdsk_flush(void)
+{
+    for (int i = 0; i < HDSK_MAX_DRIVES; i++)
+    {
+        if (hdsk[i].loaded && hdsk[i].unsynced)
+        {
+            sd_disk_io_call(sync_disk, &hdsk[i]);
+            hdsk[i].unsynced = false;
+            hdsk[i].writes = 0;
+        }
+    }
+}
+
+uint32_t hdsk_dirty_sectors(void)
+{
+    uint32_t count = 0;
+    for (int i = 0; i < HDSK_MAX_DRIVES; i++)
+    {
+        count += hdsk[i].writes;
+    }
+    return count;
+}
+
+// Sync once the guest has not written for HDSK_SYNC_IDLE_US
+void hdsk_poll(uint32_t now_us)
+{
+    if (sector_writes != polled_writes)
+    {
+        polled_writes = sector_writes;
+        last_write_us = now_us;
+        return;
+    }
+
+    if (now_us - last_write_us >= HDSK_SYNC_IDLE_US && hdsk_dirty_sectors() != 0)
+    {
+        hdsk_flush();
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef _PICO_HDSK_SD_CARD_H_
+#define _PICO_HDSK_SD_CARD_H_
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"
+
+// SIMH AltairZ80 compatible hard disk (HDSK) on a single I/O port, backed by image files on
+// the SD card. A BIOS with the SIMH HDSK driver sends a 7-byte command block to the port, then
+// reads one result byte; the controller moves the whole sector between the image and guest
+// memory in one go (DMA) instead of one IN/OUT per byte.
+//
+//   OUT: HDSK_CMD_READ or HDSK_CMD_WRITE, drive, sector, track lo, track hi, dma lo, dma hi
+//   IN:  HDSK_OK or HDSK_ERROR
+//   OUT: HDSK_CMD_PARAM, drive
+//   IN:  17-byte CP/M 3 DPB for the drive, then the sector size lo, hi
+//   OUT: HDSK_CMD_RESET (any number of times) returns to the start of a command block
+
+#define HDSK_PORT 0xFD
+
+#define HDSK_CMD_NONE 0
+#define HDSK_CMD_RESET 1
+#define HDSK_CMD_READ 2
+#define HDSK_CMD_WRITE 3
+#define HDSK_CMD_PARAM 4
+
+#define HDSK_OK 0
+#define HDSK_ERROR 1
+
+// Geometry: the track count of each drive follows from its image size
+#ifndef HDSK_SECTOR_SIZE
+#define HDSK_SECTOR_SIZE 128
+#endif
+#ifndef HDSK_SECTORS_PER_TRACK
+#define HDSK_SECTORS_PER_TRACK 32
+#endif
+#define HDSK_TRACK_SIZE (HDSK_SECTOR_SIZE * HDSK_SECTORS_PER_TRACK)
+#define HDSK_MAX_TRACKS 65536
+
+// CP/M layout reported through HDSK_CMD_PARAM: reserved tracks, 4 KB blocks, 1024 directory
+// entries. A 2048-track image gives the 8 MB SIMH "HDSK" format.
+#define HDSK_RESERVED_TRACKS 6
+#define HDSK_BLOCK_SIZE 4096
+#define HDSK_DIR_ENTRIES 1024
+#define HDSK_DPB_SIZE 17
+
+// Images the guest has not written to for this long are synced (directory entry, FAT)
+#ifndef HDSK_SYNC_IDLE_US
+#define HDSK_SYNC_IDLE_US 250000
+#endif
+
+#define HDSK_MAX_DRIVES 8
+#define HDSK_PATH_FORMAT "Disks/hdsk%u.dsk"
+
+typedef struct
+{
+    FIL fil;          // FatFs file handle
+    bool loaded;      // Image file is open
+    bool unsynced;    // Written since the last f_sync
+    uint32_t tracks;  // Tracks in the image
+    uint32_t writes;  // Sectors written since the last sync
+} hdsk_t;
+
+// Register HDSK_PORT and open Disks/hdsk0.dsk .. hdsk7.dsk where present, returns the number of
+// drives attached
+uint8_t hdsk_init(void);
+bool hdsk_load(uint8_t drive, const char* path);
+
+// HDSK_PORT handlers (called from io_ports.c)
+void hdsk_out(uint8_t data);
+uint8_t hdsk_in(void);
+
+// Write-back control (core 0)
+void hdsk_poll(uint32_t now_us);
+void hdsk_flush(void);
+uint32_t hdsk_dirty_sectors(void);
+
+#endif // _PICO_HDSK_SD_CARD_H_
@@ -0,0 +1,989 @@
+#include "snapshot.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ALTAIR_SNAPSHOT
+#include "PortDrivers/time_io.h"
+#include "cpu_state.h"
+#include "memory.h"
+#ifdef SD_CARD_SUPPORT
+#include "ff.h"
+#include "pico_88dcdd_sd_card.h"
+#ifdef ALTAIR_HDSK
+#include "pico_hdsk_sd_card.h"
+#endif
+#elif defined(REMOTE_FS)
+#include "pico_88dcdd_remote.h"
+#else
+#include "pico_88dcdd_flash.h"
+#endif
+#ifndef SD_CARD_SUPPORT
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#endif
+#include "pico/stdlib.h"
+
+#define SNAPSHOT_MAGIC 0x50414E53 // "SNAP" in hex
+#define SNAPSHOT_VERSION 3
+
+// Records start on 256-byte boundaries, one flash page
+#define SNAPSHOT_RECORD_ALIGN 256
+#define SNAPSHOT_MAX_RECORDS 64
+#define SNAPSHOT_NEWEST 0xFFFF // Record for read_job
+#ifndef ALTAIR_SNAPSHOT_JOURNAL_KB
+#define ALTAIR_SNAPSHOT_JOURNAL_KB 64
+#endif
+#ifndef ALTAIR_CHECKPOINT_SECONDS
+#define ALTAIR_CHECKPOINT_SECONDS 0
+#endif
+
+// Page slots: the pages of bank 0, then the banked pages of banks 1 to ALTAIR_MEMORY_BANKS - 1
+#define SNAPSHOT_BANKED_PAGES (ALTAIR_BANK_COMMON_BASE >> MEMORY_PAGE_SHIFT)
+#define SNAPSHOT_SLOTS (MEMORY_PAGES + (ALTAIR_MEMORY_BANKS - 1) * SNAPSHOT_BANKED_PAGES)
+
+typedef struct
+{
+    uint8_t track;
+    uint8_t sector;
+    uint8_t status;
+    uint8_t write_status;
+} snapshot_drive_t;
+
+// One record of the journal, followed by MEMORY_PAGE_SIZE bytes for every slot set in present, in
+// slot order. Record 0 is the full snapshot, records 1, 2, ... are checkpoints that only hold the
+// pages written since the record before. Each record carries the whole CPU and device state.
+typedef struct
+{
+    uint32_t magic;      // SNAPSHOT_MAGIC
+    uint16_t version;
+    uint16_t slots;      // SNAPSHOT_SLOTS of the build that saved it
+    uint32_t length;     // Header and pages in bytes
+    uint32_t crc;        // CRC32 of header and pages, taken with this field 0
+    uint32_t generation; // Of the full snapshot, records left over from older journals do not match
+    uint16_t index;      // Position in the journal
+    uint16_t af;
+    uint16_t bc;
+    uint16_t de;
+    uint16_t hl;
+    uint16_t sp;
+    uint16_t pc;
+    uint16_t address_bus;
+    uint16_t bus_switches;
+    uint16_t disk_dma;
+    uint8_t data_bus;
+    uint8_t interrupt_request;
+    uint8_t sio_control;
+    uint8_t sio_rx_count;
+    uint8_t halted;
+    uint8_t bank;
+    uint8_t current_drive;
+    uint8_t rtc_period_ms;
+    uint8_t rtc_rst;
+    uint8_t ei_pending;
+    uint8_t sio_fifo_size; // I8080_SIO_FIFO_SIZE of the build that saved it
+    uint8_t reserved;
+    uint32_t clock_khz;
+    uint32_t sio_baud;
+    int32_t sio_rx_poll_in; // 2SIO line timing, T-states from cpu.t_states
+    int32_t sio_tx_free_in;
+    uint8_t sio_rx[I8080_SIO_FIFO_SIZE]; // Receive FIFO, oldest first
+    snapshot_drive_t drive[MAX_DRIVES];
+    uint8_t rom[MEMORY_PAGES / 8];       // Write protected pages
+    uint8_t present[SNAPSHOT_SLOTS / 8]; // Slots stored after the header. The others are all zero
+                                         // in a full snapshot and unchanged in a checkpoint
+} snapshot_header_t;
+
+// Room for a full snapshot of every page, rounded up to flash sectors, plus the checkpoints
+#define SNAPSHOT_STORE_SIZE                                                                                             \
+    (((sizeof(snapshot_header_t) + SNAPSHOT_SLOTS * MEMORY_PAGE_SIZE + 4095) & ~(size_t)4095) +                        \
+     ALTAIR_SNAPSHOT_JOURNAL_KB * 1024)
+
+// Built and checked on core 0, written and read by the job on the core doing the storage I/O
+static snapshot_header_t header;
+static uint8_t page_buffer[MEMORY_PAGE_SIZE];
+
+// Records found by the last scan of the store; journal_offset[journal_count] is where the next
+// one goes. journal_current is the record memory was last saved as or restored from, -1 when
+// the machine does not descend from any, so the dirty pages since then make the next checkpoint.
+static uint32_t journal_offset[SNAPSHOT_MAX_RECORDS + 1];
+static uint16_t journal_count = 0;
+static int32_t journal_current = -1;
+static uint32_t journal_generation = 0;
+static bool journal_scanned = false;
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (-(crc & 1)));
+        }
+    }
+    return crc;
+}
+
+static inline bool bit_test(const uint8_t* map, uint32_t n)
+{
+    return (map[n >> 3] >> (n & 7)) & 1;
+}
+
+static inline void bit_set(uint8_t* map, uint32_t n)
+{
+    map[n >> 3] |= (uint8_t)(1u << (n & 7));
+}
+
+// Memory behind a page slot
+static uint8_t* slot_page(uint32_t slot)
+{
+    if (slot < MEMORY_PAGES)
+    {
+        return memory_bank_page(&memory_main, 0, (uint16_t)slot);
+    }
+    slot -= MEMORY_PAGES;
+    return memory_bank_page(&memory_main, (uint8_t)(1 + slot / SNAPSHOT_BANKED_PAGES), (uint16_t)(slot % SNAPSHOT_BANKED_PAGES));
+}
+
+static bool page_is_zero(const uint8_t* page)
+{
+    const uint32_t* words = (const uint32_t*)page;
+    for (size_t i = 0; i < MEMORY_PAGE_SIZE / sizeof(uint32_t); i++)
+    {
+        if (words[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline uint32_t record_end(uint32_t offset, uint32_t length)
+{
+    return (offset + length + SNAPSHOT_RECORD_ALIGN - 1) & ~(uint32_t)(SNAPSHOT_RECORD_ALIGN - 1);
+}
+
+static uint32_t snapshot_length(const snapshot_header_t* h)
+{
+    uint32_t pages = 0;
+    for (size_t i = 0; i < sizeof(h->present); i++)
+    {
+        pages += (uint32_t)__builtin_popcount(h->present[i]);
+    }
+    return (uint32_t)sizeof(*h) + pages * MEMORY_PAGE_SIZE;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Storage: a file on the SD card, or a flash region
+// ---------------------------------------------------------------------------------------------
+
+#ifdef SD_CARD_SUPPORT
+
+static FIL store_file;
+static bool store_writing = false;
+
+// Writing at offset 0 starts the file over, anything later appends a checkpoint
+static SNAPSHOT_RESULT store_open(bool write, uint32_t offset)
+{
+    BYTE mode = write ? FA_WRITE | (offset == 0 ? FA_CREATE_ALWAYS : FA_OPEN_ALWAYS) : FA_READ;
+    FRESULT fr = f_open(&store_file, SNAPSHOT_PATH, mode);
+    if (fr == FR_OK && write)
+    {
+        fr = f_lseek(&store_file, offset);
+        if (fr != FR_OK)
+        {
+            f_close(&store_file);
+        }
+    }
+    if (fr == FR_OK)
+    {
+        store_writing = write;
+        return SNAPSHOT_OK;
+    }
+    return !write && (fr == FR_NO_FILE || fr == FR_NO_PATH) ? SNAPSHOT_NONE : SNAPSHOT_IO_ERROR;
+}
+
+static bool store_write(const void* data, uint32_t length)
+{
+    UINT count = 0;
+    return f_write(&store_file, data, length, &count) == FR_OK && count == length;
+}
+
+static bool store_read(uint32_t offset, void* data, uint32_t length)
+{
+    UINT count = 0;
+    return f_lseek(&store_file, offset) == FR_OK && f_read(&store_file, data, length, &count) == FR_OK &&
+           count == length;
+}
+
+// A written record is the end of the journal, what followed it belonged to an abandoned one
+static bool store_close(void)
+{
+    bool ok = !store_writing || f_truncate(&store_file) == FR_OK;
+    return f_close(&store_file) == FR_OK && ok;
+}
+
+static SNAPSHOT_RESULT store_erase(void)
+{
+    FRESULT fr = f_unlink(SNAPSHOT_PATH);
+    return fr == FR_OK || fr == FR_NO_FILE ? SNAPSHOT_OK : SNAPSHOT_IO_ERROR;
+}
+
+// FatFs runs on core 1 once its SD service is online
+static void store_call(void (*job)(void* arg), void* arg)
+{
+    sd_disk_io_call(job, arg);
+}
+
+#else
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#endif
+// The patch log of the embedded disks (pico_88dcdd_flash.c) and the Wi-Fi credentials in the last
+// sector sit above the snapshot, with the same default size for the log
+#ifndef PATCH_LOG_SIZE
+#define PATCH_LOG_SIZE (PICO_FLASH_SIZE_BYTES / 4)
+#endif
+#define SNAPSHOT_FLASH_SIZE ((SNAPSHOT_STORE_SIZE + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1))
+#define SNAPSHOT_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE - PATCH_LOG_SIZE - SNAPSHOT_FLASH_SIZE)
+
+static uint8_t store_page[FLASH_PAGE_SIZE];
+static uint32_t store_position = 0; // Region offset of store_page
+static uint32_t store_fill = 0;
+
+// Core 1 runs Wi-Fi from XIP, so it is parked in RAM while flash is programmed or erased
+static uint32_t store_flash_lock(void)
+{
+    if (multicore_lockout_victim_is_initialized(1 - get_core_num()))
+    {
+        multicore_lockout_start_blocking();
+    }
+    return save_and_disable_interrupts();
+}
+
+static void store_flash_unlock(uint32_t ints)
+{
+    restore_interrupts(ints);
+    if (multicore_lockout_victim_is_initialized(1 - get_core_num()))
+    {
+        multicore_lockout_end_blocking();
+    }
+}
+
+static bool store_fits(void)
+{
+    extern char __flash_binary_end;
+    uint32_t binary_end = (uint32_t)((uintptr_t)&__flash_binary_end - XIP_BASE);
+    return binary_end <= SNAPSHOT_FLASH_OFFSET;
+}
+
+// Program store_page, erasing each sector as the first of its pages is reached. Records only ever
+// grow the journal from a record boundary, so the rest of a sector that is already started is
+// still erased.
+static void store_program_page(void)
+{
+    uint32_t offset = SNAPSHOT_FLASH_OFFSET + store_position;
+    uint32_t ints = store_flash_lock();
+    if (store_position % FLASH_SECTOR_SIZE == 0)
+    {
+        flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(offset, store_page, FLASH_PAGE_SIZE);
+    store_flash_unlock(ints);
+
+    store_position += FLASH_PAGE_SIZE;
+    store_fill = 0;
+}
+
+static SNAPSHOT_RESULT store_open(bool write, uint32_t offset)
+{
+    if (!store_fits())
+    {
+        return SNAPSHOT_NO_SPACE;
+    }
+    (void)write;
+    store_position = offset;
+    store_fill = 0;
+    return SNAPSHOT_OK;
+}
+
+static bool store_write(const void* data, uint32_t length)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (length > 0)
+    {
+        uint32_t chunk = FLASH_PAGE_SIZE - store_fill;
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+        memcpy(store_page + store_fill, bytes, chunk);
+        store_fill += chunk;
+        bytes += chunk;
+        length -= chunk;
+        if (store_fill == FLASH_PAGE_SIZE)
+        {
+            store_program_page();
+        }
+    }
+    return true;
+}
+
+static bool store_read(uint32_t offset, void* data, uint32_t length)
+{
+    if (offset + length > SNAPSHOT_FLASH_SIZE)
+    {
+        return false;
+    }
+    memcpy(data, (const void*)(XIP_BASE + SNAPSHOT_FLASH_OFFSET + offset), length);
+    return true;
+}
+
+static bool store_close(void)
+{
+    if (store_fill > 0)
+    {
+        memset(store_page + store_fill, 0xFF, FLASH_PAGE_SIZE - store_fill);
+        store_program_page();
+    }
+    return true;
+}
+
+// Erasing the first sector removes the header
+static SNAPSHOT_RESULT store_erase(void)
+{
+    if (!store_fits())
+    {
+        return SNAPSHOT_NO_SPACE;
+    }
+    uint32_t ints = store_flash_lock();
+    flash_range_erase(SNAPSHOT_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    store_flash_unlock(ints);
+    return SNAPSHOT_OK;
+}
+
+static void store_call(void (*job)(void* arg), void* arg)
+{
+    job(arg);
+}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------
+// Jobs, run where the storage I/O happens while core 0 waits
+// ---------------------------------------------------------------------------------------------
+
+// Check one record, its header and the checksum over its pages, leaving its header in header
+static SNAPSHOT_RESULT verify(uint32_t offset)
+{
+    if (offset + sizeof(header) > SNAPSHOT_STORE_SIZE || !store_read(offset, &header, sizeof(header)) ||
+        header.magic != SNAPSHOT_MAGIC)
+    {
+        return SNAPSHOT_NONE;
+    }
+    if (header.version != SNAPSHOT_VERSION || header.slots != SNAPSHOT_SLOTS ||
+        header.sio_fifo_size != I8080_SIO_FIFO_SIZE)
+    {
+        return SNAPSHOT_MISMATCH;
+    }
+    if (header.length != snapshot_length(&header) || offset + header.length > SNAPSHOT_STORE_SIZE)
+    {
+        return SNAPSHOT_CORRUPT;
+    }
+
+    uint32_t stored_crc = header.crc;
+    header.crc = 0;
+    uint32_t crc = crc32_update(0xFFFFFFFF, (const uint8_t*)&header, sizeof(header));
+    header.crc = stored_crc;
+
+    for (uint32_t page = sizeof(header); page < header.length; page += MEMORY_PAGE_SIZE)
+    {
+        if (!store_read(offset + page, page_buffer, MEMORY_PAGE_SIZE))
+        {
+            return SNAPSHOT_CORRUPT;
+        }
+        crc = crc32_update(crc, page_buffer, MEMORY_PAGE_SIZE);
+    }
+    return ~crc == stored_crc ? SNAPSHOT_OK : SNAPSHOT_CORRUPT;
+}
+
+// Find the records of the journal: the full snapshot, then every checkpoint of the same
+// generation that follows in order and checks out. A damaged checkpoint ends the journal.
+static void scan_job(void* arg)
+{
+    SNAPSHOT_RESULT* result = (SNAPSHOT_RESULT*)arg;
+    journal_count = 0;
+    journal_offset[0] = 0;
+    *result = store_open(false, 0);
+    if (*result != SNAPSHOT_OK)
+    {
+        return;
+    }
+
+    uint32_t offset = 0;
+    while (journal_count < SNAPSHOT_MAX_RECORDS)
+    {
+        SNAPSHOT_RESULT record = verify(offset);
+        if (record == SNAPSHOT_OK &&
+            (header.index != journal_count || (journal_count > 0 && header.generation != journal_generation)))
+        {
+            record = SNAPSHOT_NONE;
+        }
+        if (record != SNAPSHOT_OK)
+        {
+            if (journal_count == 0)
+            {
+                *result = record;
+            }
+            break;
+        }
+        journal_generation = header.generation;
+        journal_offset[journal_count++] = offset;
+        offset = record_end(offset, header.length);
+        journal_offset[journal_count] = offset;
+    }
+    store_close();
+}
+
+// Append header and its pages at the offset in the job, then read the record back
+typedef struct
+{
+    uint32_t offset;
+    uint16_t record;
+    SNAPSHOT_RESULT result;
+} snapshot_job_t;
+
+static void write_job(void* arg)
+{
+    snapshot_job_t* job = (snapshot_job_t*)arg;
+    job->result = store_open(true, job->offset);
+    if (job->result != SNAPSHOT_OK)
+    {
+        return;
+    }
+
+    bool ok = store_write(&header, sizeof(header));
+    for (uint32_t slot = 0; ok && slot < SNAPSHOT_SLOTS; slot++)
+    {
+        if (bit_test(header.present, slot))
+        {
+            ok = store_write(slot_page(slot), MEMORY_PAGE_SIZE);
+        }
+    }
+    ok = store_close() && ok;
+    if (!ok)
+    {
+        job->result = SNAPSHOT_IO_ERROR;
+        return;
+    }
+
+    job->result = store_open(false, 0);
+    if (job->result == SNAPSHOT_OK)
+    {
+        job->result = verify(job->offset) == SNAPSHOT_OK ? SNAPSHOT_OK : SNAPSHOT_IO_ERROR;
+        store_close();
+    }
+}
+
+// Scan again so nothing is touched unless every record up to the target checks out, then clear
+// memory and lay the pages of the full snapshot and each checkpoint over it. The target header is
+// left in header.
+static void read_job(void* arg)
+{
+    snapshot_job_t* job = (snapshot_job_t*)arg;
+    scan_job(&job->result);
+    if (job->result != SNAPSHOT_OK)
+    {
+        return;
+    }
+    if (job->record == SNAPSHOT_NEWEST)
+    {
+        job->record = (uint16_t)(journal_count - 1);
+    }
+    if (job->record >= journal_count)
+    {
+        job->result = SNAPSHOT_CORRUPT;
+        return;
+    }
+    job->result = store_open(false, 0);
+    if (job->result != SNAPSHOT_OK)
+    {
+        return;
+    }
+
+    memory_reset(&memory_main);
+    for (uint32_t record = 0; record <= job->record && job->result == SNAPSHOT_OK; record++)
+    {
+        uint32_t offset = journal_offset[record];
+        if (!store_read(offset, &header, sizeof(header)))
+        {
+            job->result = SNAPSHOT_IO_ERROR;
+            break;
+        }
+        offset += sizeof(header);
+        for (uint32_t slot = 0; slot < SNAPSHOT_SLOTS; slot++)
+        {
+            if (!bit_test(header.present, slot))
+            {
+                continue;
+            }
+            if (!store_read(offset, slot_page(slot), MEMORY_PAGE_SIZE))
+            {
+                job->result = SNAPSHOT_IO_ERROR; // Memory is cleared, the guest has to be reset
+                break;
+            }
+            offset += MEMORY_PAGE_SIZE;
+        }
+    }
+    store_close();
+}
+
+static void erase_job(void* arg)
+{
+    *(SNAPSHOT_RESULT*)arg = store_erase();
+}
+
+// ---------------------------------------------------------------------------------------------
+// Disk controller state
+// ---------------------------------------------------------------------------------------------
+
+#ifdef SD_CARD_SUPPORT
+#define SNAPSHOT_DISKS sd_disk_controller.disk
+#define SNAPSHOT_CURRENT_DRIVE sd_disk_controller.currentDisk
+#define snapshot_disk_select sd_disk_select
+
+// Forget the sector buffer, the next sector poll positions the head again
+static void drive_reposition(sd_disk_t* disk)
+{
+    disk->diskPointer = disk->track * TRACK_SIZE;
+    disk->sectorPointer = 0;
+    disk->haveSectorData = false;
+    disk->sectorDirty = false;
+}
+
+static void disks_sync(void)
+{
+    sd_disk_flush();
+#ifdef ALTAIR_HDSK
+    hdsk_flush();
+#endif
+}
+#elif defined(REMOTE_FS)
+#define SNAPSHOT_DISKS remote_disk_controller.disk
+#define SNAPSHOT_CURRENT_DRIVE remote_disk_controller.currentDisk
+#define snapshot_disk_select remote_disk_select
+
+static void drive_reposition(remote_disk_t* disk)
+{
+    disk->sectorPointer = 0;
+    disk->haveSectorData = false;
+    disk->sectorDirty = false;
+}
+
+static void disks_sync(void)
+{
+    remote_disk_flush();
+}
+#else
+#define SNAPSHOT_DISKS pico_disk_controller.disk
+#define SNAPSHOT_CURRENT_DRIVE pico_disk_controller.current_disk
+#define snapshot_disk_select pico_disk_select
+
+static void drive_reposition(pico_disk_t* disk)
+{
+    disk->disk_pointer = disk->track * TRACK_SIZE;
+    disk->sector_pointer = 0;
+    disk->have_sector_data = false;
+    disk->sector_dirty = false;
+}
+
+static void disks_sync(void)
+{
+    pico_disk_flush();
+}
+#endif
+
+// ---------------------------------------------------------------------------------------------
+
+// Header for the machine as it is, storing the pages that are not zero (full) or dirty (checkpoint)
+static void build_header(uint16_t index)
+{
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.slots = SNAPSHOT_SLOTS;
+    header.generation = journal_generation;
+    header.index = index;
+
+    header.af = cpu.registers.af;
+    header.bc = cpu.registers.bc;
+    header.de = cpu.registers.de;
+    header.hl = cpu.registers.hl;
+    header.sp = cpu.registers.sp;
+    header.pc = cpu.registers.pc;
+    header.address_bus = cpu.address_bus;
+    header.bus_switches = bus_switches;
+    header.disk_dma = cpu.disk_dma;
+    header.data_bus = cpu.data_bus;
+    header.interrupt_request = cpu.interrupt_request;
+    header.sio_control = cpu.sio_control;
+    header.sio_rx_count = cpu.sio.rx_count;
+    for (uint8_t i = 0; i < cpu.sio.rx_count; i++)
+    {
+        header.sio_rx[i] = cpu.sio.rx[(cpu.sio.rx_head + i) % I8080_SIO_FIFO_SIZE];
+    }
+    header.sio_fifo_size = I8080_SIO_FIFO_SIZE;
+    header.sio_baud = cpu.sio.baud;
+    header.sio_rx_poll_in = (int32_t)(cpu.sio.rx_poll_at - cpu.t_states);
+    header.sio_tx_free_in = (int32_t)(cpu.sio.tx_free_at - cpu.t_states);
+    header.ei_pending = cpu.ei_pending;
+    header.halted = cpu.halted;
+    header.bank = memory_get_bank(&memory_main);
+    header.rtc_period_ms = time_io_get_rtc(&header.rtc_rst);
+    header.clock_khz = cpu_state_get_clock_khz();
+
+    header.current_drive = SNAPSHOT_CURRENT_DRIVE;
+    for (int i = 0; i < MAX_DRIVES; i++)
+    {
+        header.drive[i].track = SNAPSHOT_DISKS[i].track;
+        header.drive[i].sector = SNAPSHOT_DISKS[i].sector;
+        header.drive[i].status = SNAPSHOT_DISKS[i].status;
+        header.drive[i].write_status = SNAPSHOT_DISKS[i].write_status;
+    }
+
+    for (uint32_t page = 0; page < MEMORY_PAGES; page++)
+    {
+        if (memory_is_rom(&memory_main, (uint16_t)(page << MEMORY_PAGE_SHIFT)))
+        {
+            bit_set(header.rom, page);
+        }
+    }
+    for (uint32_t slot = 0; slot < SNAPSHOT_SLOTS; slot++)
+    {
+        bool store;
+        if (index == 0)
+        {
+            store = !page_is_zero(slot_page(slot));
+        }
+        else if (slot < MEMORY_PAGES)
+        {
+            store = memory_page_dirty(&memory_main, 0, (uint16_t)slot);
+        }
+        else
+        {
+            uint32_t banked = slot - MEMORY_PAGES;
+            store = memory_page_dirty(&memory_main, (uint8_t)(1 + banked / SNAPSHOT_BANKED_PAGES),
+                                      (uint16_t)(banked % SNAPSHOT_BANKED_PAGES));
+        }
+        if (store)
+        {
+            bit_set(header.present, slot);
+        }
+    }
+    header.length = snapshot_length(&header);
+
+    uint32_t crc = crc32_update(0xFFFFFFFF, (const uint8_t*)&header, sizeof(header));
+    for (uint32_t slot = 0; slot < SNAPSHOT_SLOTS; slot++)
+    {
+        if (bit_test(header.present, slot))
+        {
+            crc = crc32_update(crc, slot_page(slot), MEMORY_PAGE_SIZE);
+        }
+    }
+    header.crc = ~crc;
+}
+
+// Scan the store once, the journal is kept up to date from then on
+static SNAPSHOT_RESULT journal_load(void)
+{
+    if (journal_scanned)
+    {
+        return journal_count > 0 ? SNAPSHOT_OK : SNAPSHOT_NONE;
+    }
+    SNAPSHOT_RESULT result = SNAPSHOT_IO_ERROR;
+    store_call(scan_job, &result);
+    if (result != SNAPSHOT_IO_ERROR && result != SNAPSHOT_NO_SPACE)
+    {
+        journal_scanned = true;
+    }
+    return result;
+}
+
+// Store the record built in header
+static SNAPSHOT_RESULT write_record(uint16_t index, uint32_t offset, uint32_t* length)
+{
+    snapshot_job_t job = {.offset = offset, .result = SNAPSHOT_IO_ERROR};
+    store_call(write_job, &job);
+    if (job.result == SNAPSHOT_OK)
+    {
+        journal_count = (uint16_t)(index + 1);
+        journal_offset[index] = offset;
+        journal_offset[journal_count] = record_end(offset, header.length);
+        journal_current = index;
+        memory_dirty_clear(&memory_main);
+    }
+    if (length)
+    {
+        *length = job.result == SNAPSHOT_OK ? header.length : 0;
+    }
+    return job.result;
+}
+
+SNAPSHOT_RESULT snapshot_save(uint32_t* length)
+{
+    disks_sync();
+    SNAPSHOT_RESULT result = journal_load();
+    if (result == SNAPSHOT_IO_ERROR || result == SNAPSHOT_NO_SPACE)
+    {
+        if (length)
+        {
+            *length = 0;
+        }
+        return result;
+    }
+
+    // A new generation, so checkpoints of the old journal further on in the store are not taken
+    // for this one's
+    journal_generation = journal_count > 0 ? journal_generation + 1 : time_us_32();
+    journal_count = 0;
+    journal_current = -1;
+    build_header(0);
+    return write_record(0, 0, length);
+}
+
+SNAPSHOT_RESULT snapshot_checkpoint(uint32_t* length)
+{
+    SNAPSHOT_RESULT result = journal_load();
+    if (result == SNAPSHOT_IO_ERROR || result == SNAPSHOT_NO_SPACE)
+    {
+        if (length)
+        {
+            *length = 0;
+        }
+        return result;
+    }
+
+    // Only the newest record can be continued, and only while memory still descends from it
+    if (journal_count == 0 || journal_current != journal_count - 1 || journal_count == SNAPSHOT_MAX_RECORDS)
+    {
+        return snapshot_save(length);
+    }
+
+    disks_sync();
+    uint32_t offset = journal_offset[journal_count];
+    build_header(journal_count);
+    if (offset + header.length > SNAPSHOT_STORE_SIZE)
+    {
+        return snapshot_save(length); // Journal full, start over
+    }
+    result = write_record(journal_count, offset, length);
+    if (result == SNAPSHOT_IO_ERROR)
+    {
+        // The journal ends before the damaged record, a full snapshot rewrites the store from the
+        // start
+        journal_count = (uint16_t)(journal_current + 1);
+        return snapshot_save(length);
+    }
+    return result;
+}
+
+// Bring back a record of the journal, memory and state together
+static SNAPSHOT_RESULT restore_record(uint16_t record)
+{
+    // Pending disk writes belong to the machine being replaced
+    disks_sync();
+
+    snapshot_job_t job = {.record = record, .result = SNAPSHOT_IO_ERROR};
+    store_call(read_job, &job);
+    if (job.result != SNAPSHOT_OK)
+    {
+        if (job.result != SNAPSHOT_IO_ERROR)
+        {
+            journal_scanned = true;
+        }
+        journal_current = -1;
+        return job.result;
+    }
+    journal_scanned = true;
+    journal_current = job.record;
+
+    for (uint32_t page = 0; page < MEMORY_PAGES; page++)
+    {
+        if (bit_test(header.rom, page))
+        {
+            memory_set_rom(&memory_main, (uint16_t)(page << MEMORY_PAGE_SHIFT), MEMORY_PAGE_SIZE, true);
+        }
+    }
+    memory_select_bank(&memory_main, header.bank);
+    memory_dirty_clear(&memory_main);
+
+    cpu.registers.af = header.af;
+    cpu.registers.bc = header.bc;
+    cpu.registers.de = header.de;
+    cpu.registers.hl = header.hl;
+    cpu.registers.sp = header.sp;
+    cpu.registers.pc = header.pc;
+    cpu.address_bus = header.address_bus;
+    cpu.data_bus = header.data_bus;
+    cpu.disk_dma = header.disk_dma;
+    cpu.interrupt_request = header.interrupt_request;
+    cpu.sio_control = header.sio_control;
+    i8080_sio_set_baud(&cpu, header.sio_baud);
+    cpu.sio.rx_poll_at = cpu.t_states + (uint32_t)header.sio_rx_poll_in;
+    cpu.sio.tx_free_at = cpu.t_states + (uint32_t)header.sio_tx_free_in;
+    memcpy(cpu.sio.rx, header.sio_rx, sizeof(cpu.sio.rx));
+    cpu.sio.rx_head = 0;
+    cpu.sio.rx_count = header.sio_rx_count;
+    cpu.ei_pending = header.ei_pending != 0;
+    cpu.halted = header.halted != 0;
+    cpu.cpuStatus = 0;
+    cpu.exit_requested = false;
+    bus_switches = header.bus_switches;
+
+    time_io_set_rtc(header.rtc_period_ms, header.rtc_rst);
+    cpu_state_set_clock_khz(header.clock_khz);
+
+    for (int i = 0; i < MAX_DRIVES; i++)
+    {
+        if (!SNAPSHOT_DISKS[i].disk_loaded)
+        {
+            continue;
+        }
+        SNAPSHOT_DISKS[i].track = header.drive[i].track;
+        SNAPSHOT_DISKS[i].sector = header.drive[i].sector;
+        SNAPSHOT_DISKS[i].status = header.drive[i].status;
+        SNAPSHOT_DISKS[i].write_status = header.drive[i].write_status;
+        drive_reposition(&SNAPSHOT_DISKS[i]);
+    }
+    snapshot_disk_select(header.current_drive);
+    return SNAPSHOT_OK;
+}
+
+SNAPSHOT_RESULT snapshot_restore(void)
+{
+    return restore_record(SNAPSHOT_NEWEST);
+}
+
+SNAPSHOT_RESULT snapshot_rewind(uint16_t steps)
+{
+    SNAPSHOT_RESULT result = journal_load();
+    if (result != SNAPSHOT_OK)
+    {
+        return result;
+    }
+    int32_t from = journal_current >= 0 ? journal_current : journal_count - 1;
+    int32_t target = from - (int32_t)steps;
+    return restore_record((uint16_t)(target < 0 ? 0 : target));
+}
+
+void snapshot_position(int32_t* current, uint16_t* count)
+{
+    *current = journal_current;
+    *count = journal_scanned ? journal_count : 0;
+}
+
+SNAPSHOT_RESULT snapshot_delete(void)
+{
+    SNAPSHOT_RESULT result = SNAPSHOT_IO_ERROR;
+    store_call(erase_job, &result);
+    if (result == SNAPSHOT_OK)
+    {
+        journal_count = 0;
+        journal_offset[0] = 0;
+        journal_current = -1;
+        journal_scanned = true;
+    }
+    return result;
+}
+
+void snapshot_poll(uint32_t now_us)
+{
+#if ALTAIR_CHECKPOINT_SECONDS > 0
+    static uint32_t last_us = 0;
+    static SNAPSHOT_RESULT last_result = SNAPSHOT_OK;
+    if (now_us - last_us < ALTAIR_CHECKPOINT_SECONDS * 1000000u)
+    {
+        return;
+    }
+    last_us = now_us;
+
+    SNAPSHOT_RESULT result = snapshot_checkpoint(NULL);
+    if (result != SNAPSHOT_OK && result != last_result)
+    {
+        printf("[SNAPSHOT] Checkpoint failed: %s\n", snapshot_result_text(result));
+    }
+    last_result = result;
+#else
+    (void)now_us;
+#endif
+}
+
+#else
+
+SNAPSHOT_RESULT snapshot_save(uint32_t* length)
+{
+    if (length)
+    {
+        *length = 0;
+    }
+    return SNAPSHOT_DISABLED;
+}
+
+SNAPSHOT_RESULT snapshot_checkpoint(uint32_t* length)
+{
+    return snapshot_save(length);
+}
+
+SNAPSHOT_RESULT snapshot_restore(void)
+{
+    return SNAPSHOT_DISABLED;
+}
+
+SNAPSHOT_RESULT snapshot_rewind(uint16_t steps)
+{
+    (void)steps;
+    return SNAPSHOT_DISABLED;
+}
+
+void snapshot_position(int32_t* current, uint16_t* count)
+{
+    *current = -1;
+    *count = 0;
+}
+
+void snapshot_poll(uint32_t now_us)
+{
+    (void)now_us;
+}
+
+SNAPSHOT_RESULT snapshot_delete(void)
+{
+    return SNAPSHOT_DISABLED;
+}
+
+#endif
+
+const char* snapshot_result_text(SNAPSHOT_RESULT result)
+{
+    switch (result)
+    {
+        case SNAPSHOT_OK:
+            return "OK";
+        case SNAPSHOT_NONE:
+            return "No snapshot saved";
+        case SNAPSHOT_CORRUPT:
+            return "Snapshot damaged";
+        case SNAPSHOT_MISMATCH:
+            return "Snapshot is from another firmware version or build";
+        case SNAPSHOT_IO_ERROR:
+            return "Storage error";
+        case SNAPSHOT_NO_SPACE:
+            return "Firmware overlaps the snapshot flash region";
+        case SNAPSHOT_DISABLED:
+            return "Not enabled, build with -DALTAIR_SNAPSHOT=ON";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,59 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Machine snapshots, only stored when built with ALTAIR_SNAPSHOT. A snapshot holds memory (every
+// bank, only the pages that are not all zero, and which pages are ROM), the 8080 registers and
+// interrupt state, the front panel switches, the 2SIO console's FIFO and line timing, the floppy
+// controller's drive and head positions and the interrupt clock. SD card builds keep it in SNAPSHOT_PATH on the card, the others in a flash
+// region below the disk patch log. A valid snapshot is restored at boot instead of the cold boot.
+//
+// The store is a journal: a full snapshot followed by checkpoints, each holding the state and the
+// pages written since the record before it (every page unless built with ALTAIR_DIRTY_PAGES). A
+// checkpoint after a rewind, or once ALTAIR_SNAPSHOT_JOURNAL_KB is used up, starts a new journal
+// with a full snapshot.
+//
+// Disk contents are not part of it: the disks are synced when it is taken, and the guest only
+// finds them consistent if they have not been written since.
+#define SNAPSHOT_PATH "Disks/snapshot.bin"
+
+typedef enum
+{
+    SNAPSHOT_OK = 0,
+    SNAPSHOT_NONE,     // Nothing saved
+    SNAPSHOT_CORRUPT,  // Checksum or length does not match
+    SNAPSHOT_MISMATCH, // Saved in an older format, or by a build with other memory banks or FIFOs
+    SNAPSHOT_IO_ERROR, // The card or flash could not be written or read
+    SNAPSHOT_NO_SPACE, // The firmware reaches into the flash region
+    SNAPSHOT_DISABLED  // Built without ALTAIR_SNAPSHOT
+} SNAPSHOT_RESULT;
+
+// Save the machine in full as a new journal, syncing the disks first. length receives the bytes
+// stored.
+SNAPSHOT_RESULT snapshot_save(uint32_t* length);
+
+// Append a checkpoint to the journal, or save in full when the journal cannot be continued
+SNAPSHOT_RESULT snapshot_checkpoint(uint32_t* length);
+
+// Replace the machine state with the newest record. The machine is left alone unless every record
+// up to it checks out.
+SNAPSHOT_RESULT snapshot_restore(void);
+
+// Go back steps records from the one last saved or restored, or from the newest when there is none,
+// stopping at the full snapshot
+SNAPSHOT_RESULT snapshot_rewind(uint16_t steps);
+
+// Record the machine was last saved as or restored from (-1 for none) and the records stored
+void snapshot_position(int32_t* current, uint16_t* count);
+
+// Take a checkpoint every ALTAIR_CHECKPOINT_SECONDS while the guest runs, when that is not 0
+void snapshot_poll(uint32_t now_us);
+
+// Remove the stored snapshot so the next boot is a cold boot again
+SNAPSHOT_RESULT snapshot_delete(void);
+
+const char* snapshot_result_text(SNAPSHOT_RESULT result);
+
+#endif
@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include "dxtimer.h"
+#include "dxsys.h"
+
+/* BENCH - in-guest benchmarks for the Altair 8800 emulator
+ *
+ * Times integer and string code, console output, sequential
+ * and random disk I/O through the BDOS and, given a file name,
+ * an HTTP download from the gf endpoint (gf.txt). Each test
+ * takes the T-states, instructions and host microseconds of
+ * ports 46 (x_perf) before and after, and prints one line:
+ *
+ *   BENCH BEGIN V=<bench version> FW=<firmware version>
+ *   BENCH <test> N=<count> UNIT=<unit> US=<us> TS=<t> IN=<n>
+ *   BENCH <test> FAIL
+ *   BENCH <test> SKIP
+ *   BENCH END
+ *
+ * FW= takes the rest of its line. N/US is the host rate,
+ * TS/US the emulated clock in MHz. Other output, such as the
+ * console test's text, never starts with "BENCH ". Each test
+ * stays well below 2^31 T-states, the range of long.c.
+ *
+ * Usage: bench [file]
+ */
+
+#define BENCH_VER "1.0"
+
+#define TMPFILE "BENCH.TMP"
+#define RECS 128   /* Records in the disk test file, 16KB */
+#define CHUNK 8    /* Records per sequential read or write */
+#define RNDOPS 128 /* Random record reads and writes */
+#define CONCH 4096 /* Characters of console output */
+#define LINE 64    /* Console test line length */
+#define INTN 10000 /* Integer loop iterations */
+#define STRN 500   /* String loop iterations */
+
+/* HTTP ports as in gf.c */
+#define WG_IDX_RESET 109
+#define WG_EP_NAME   110
+#define WG_FILENAME  114
+#define WG_STATUS    33
+#define WG_GET_BYTE  201
+#define WG_DMA_LO    202
+#define WG_DMA_HI    203
+#define WG_GET_REC   202
+#define WG_BLOCK_VER 203
+#define WG_EOF       0
+#define WG_DATAREADY 2
+#define WG_FAILED    3
+
+int inp();
+int outp();
+int bdos();
+char *itol();
+char *utol();
+char *ladd();
+char *lsub();
+char *ltoa();
+
+char ts0[4], in0[4], us0[4]; /* Counters at the start of a test */
+char ts1[4], in1[4], us1[4]; /* and at its end */
+char dbuf[CHUNK * 128];      /* Sequential disk transfers */
+char rec[128];               /* Random disk and HTTP records */
+char sbuf[128];              /* String and console tests */
+char sbuf2[128];
+char url[128];               /* gf endpoint */
+unsigned seed;
+
+/* ------------------------------------------------------- */
+/* b_start() - Latch the counters at the start of a test.
+ */
+int b_start()
+{
+    x_perf(ts0, in0, us0);
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* b_end(name, count, unit) - Print the result line of the
+ * test started by b_start: count (a long) of unit done,
+ * host microseconds, T-states and instructions taken.
+ */
+int b_end(name, count, unit)
+char *name, *count, *unit;
+{
+    char d[4], txt[16];
+
+    x_perf(ts1, in1, us1);
+    printf("BENCH %s N=%s UNIT=%s", name, ltoa(txt, count), unit);
+    printf(" US=%s", ltoa(txt, lsub(d, us1, us0)));
+    printf(" TS=%s", ltoa(txt, lsub(d, ts1, ts0)));
+    printf(" IN=%s\n", ltoa(txt, lsub(d, in1, in0)));
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* b_fail(name) - Report a test that could not run.
+ * Returns -1.
+ */
+int b_fail(name)
+char *name;
+{
+    printf("BENCH %s FAIL\n", name);
+    return -1;
+}
+
+/* ------------------------------------------------------- */
+/* b_rnd() - Next record of the random disk tests. A fixed
+ * sequence, so every run touches the same records.
+ */
+unsigned b_rnd()
+{
+    seed = seed * 25173 + 13849;
+    return (seed >> 8) % RECS;
+}
+
+/* ------------------------------------------------------- */
+/* b_int() - Integer arithmetic: add, multiply, shift, xor
+ * and divide in a counted loop.
+ */
+int b_int()
+{
+    unsigned i, a, b;
+    char n[4];
+
+    b_start();
+    a = 1;
+    b = 0;
+    for (i = 0; i < INTN; i++)
+    {
+        a = a * 3 + i;
+        b += (a >> 3) ^ i;
+        if (b & 1)
+            b -= i / 7;
+    }
+    b_end("CPU.INT", utol(n, INTN), "LOOP");
+    return b;
+}
+
+/* ------------------------------------------------------- */
+/* b_str() - String library: copy, append, length and
+ * compare a 54 character line.
+ */
+int b_str()
+{
+    int i, m;
+    char n[4];
+
+    strcpy(sbuf2, "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789");
+    m = 0;
+    b_start();
+    for (i = 0; i < STRN; i++)
+    {
+        strcpy(sbuf, "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG");
+        strcat(sbuf, " 0123456789");
+        m += strlen(sbuf);
+        if (strcmp(sbuf, sbuf2) == 0)
+            m++;
+    }
+    b_end("CPU.STR", utol(n, STRN), "LOOP");
+    return m;
+}
+
+/* ------------------------------------------------------- */
+/* b_cch() - Console output one character at a time through
+ * BDOS function 2, in lines of LINE characters.
+ */
+int b_cch()
+{
+    int i;
+    char n[4];
+
+    b_start();
+    for (i = 0; i < CONCH; i++)
+    {
+        if (i % LINE == LINE - 2)
+            bdos(2, '\r');
+        else if (i % LINE == LINE - 1)
+            bdos(2, '\n');
+        else
+            bdos(2, 'A' + i % 26);
+    }
+    b_end("CON.CHAR", utol(n, CONCH), "BYTE");
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* b_cstr() - Console output a line at a time through BDOS
+ * function 9 (print string).
+ */
+int b_cstr()
+{
+    int i;
+    char n[4];
+
+    for (i = 0; i < LINE - 2; i++)
+        sbuf[i] = 'a' + i % 26;
+    sbuf[LINE - 2] = '\r';
+    sbuf[LINE - 1] = '\n';
+    sbuf[LINE] = '$';
+
+    b_start();
+    for (i = 0; i < CONCH / LINE; i++)
+        bdos(9, sbuf);
+    b_end("CON.STR", utol(n, CONCH), "BYTE");
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* b_dsw() - Write TMPFILE sequentially, CHUNK records per
+ * write, closing it so the directory is on the disk.
+ */
+int b_dsw()
+{
+    int fd, i;
+    char n[4];
+
+    for (i = 0; i < CHUNK * 128; i++)
+        dbuf[i] = i;
+    unlink(TMPFILE);
+
+    b_start();
+    if ((fd = creat(TMPFILE)) == -1)
+        return b_fail("DISK.SEQW");
+    for (i = 0; i < RECS; i += CHUNK)
+    {
+        if (write(fd, dbuf, CHUNK) != CHUNK)
+        {
+            close(fd);
+            return b_fail("DISK.SEQW");
+        }
+    }
+    if (close(fd) == -1)
+        return b_fail("DISK.SEQW");
+    b_end("DISK.SEQW", utol(n, RECS * 128), "BYTE");
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* b_dsr() - Read TMPFILE back sequentially.
+ */
+int b_dsr()
+{
+    int fd, i;
+    char n[4];
+
+    b_start();
+    if ((fd = open(TMPFILE, 0)) == -1)
+        return b_fail("DISK.SEQR");
+    for (i = 0; i < RECS; i += CHUNK)
+    {
+        if (read(fd, dbuf, CHUNK) != CHUNK)
+        {
+            close(fd);
+            return b_fail("DISK.SEQR");
+        }
+    }
+    close(fd);
+    b_end("DISK.SEQR", utol(n, RECS * 128), "BYTE");
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* b_drw(wr) - Random single record reads (wr 0) or writes
+ * (wr 1) within TMPFILE.
+ */
+int b_drw(wr)
+int wr;
+{
+    int fd, i, ok;
+    char n[4];
+    char *name;
+
+    name = wr ? "DISK.RNDW" : "DISK.RNDR";
+    seed = wr ? 1 : 2;
+
+    b_start();
+    if ((fd = open(TMPFILE, wr ? 2 : 0)) == -1)
+        return b_fail(name);
+    for (i = 0; i < RNDOPS; i++)
+    {
+        ok = seek(fd, b_rnd(), 0) != -1;
+        if (ok)
+            ok = (wr ? write(fd, rec, 1) : read(fd, rec, 1)) == 1;
+        if (!ok)
+        {
+            close(fd);
+            return b_fail(name);
+        }
+    }
+    if (close(fd) == -1)
+        return b_fail(name);
+    b_end(name, utol(n, RNDOPS), "REC");
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* b_url() - Load the gf endpoint from gf.txt into url.
+ * Returns its length, 0 if there is none.
+ */
+int b_url()
+{
+    FILE *fp;
+    int len;
+
+    url[0] = 0;
+    if ((fp = fopen("gf.txt", "r")) == NULL)
+        return 0;
+    if (fgets(url, 128, fp) == NULL)
+        url[0] = 0;
+    fclose(fp);
+
+    len = strlen(url);
+    if (len > 0 && url[len - 1] == '\n')
+        url[--len] = 0;
+    return len;
+}
+
+/* ------------------------------------------------------- */
+/* b_http(file) - Download file from the gf endpoint as gf
+ * does, counting the bytes instead of writing them, so the
+ * disk does not count.
+ */
+int b_http(file)
+char *file;
+{
+    int i, len, block, status;
+    unsigned dma;
+    char total[4], t[4];
+
+    if ((len = b_url()) == 0)
+    {
+        printf("BENCH NET.GET SKIP\n");
+        return 0;
+    }
+    block = (inp(WG_BLOCK_VER) & 255) != 0;
+
+    outp(WG_IDX_RESET, 0);
+    for (i = 0; i < len; i++)
+        outp(WG_EP_NAME, url[i]);
+    outp(WG_EP_NAME, 0);
+    dma = rec;
+    outp(WG_DMA_LO, dma & 255);
+    outp(WG_DMA_HI, dma >> 8);
+
+    itol(total, 0);
+    b_start();
+    outp(WG_IDX_RESET, 0);
+    for (i = 0; file[i]; i++)
+        outp(WG_FILENAME, file[i]);
+    outp(WG_FILENAME, 0);
+
+    while ((status = inp(WG_STATUS) & 255) != WG_EOF)
+    {
+        if (status == WG_FAILED)
+            return b_fail("NET.GET");
+        if (status != WG_DATAREADY)
+            continue;
+        if (block)
+        {
+            /* 0 until a full record is in */
+            ladd(total, total, itol(t, inp(WG_GET_REC) & 255));
+        }
+        else
+        {
+            inp(WG_GET_BYTE);
+            ladd(total, total, itol(t, 1));
+        }
+    }
+    b_end("NET.GET", total, "BYTE");
+    return 0;
+}
+
+int main(argc, argv)
+int argc;
+char **argv;
+{
+    char ver[64];
+
+    x_altr(ver, 64);
+    printf("BENCH BEGIN V=%s FW=%s\n", BENCH_VER, ver);
+
+    b_int();
+    b_str();
+    b_cch();
+    b_cstr();
+    if (b_dsw() == 0 && b_dsr() == 0)
+    {
+        b_drw(1);
+        b_drw(0);
+    }
+    unlink(TMPFILE);
+
+    if (argc > 1)
+        b_http(argv[1]);
+    else
+        printf("BENCH NET.GET SKIP\n");
+
+    printf("BENCH END\n");
+    return 0;
+}
@@ -1,6 +1,6 @@
 #include <stdio.h>
 
-#define GF_VERSION "1.3"
+#define GF_VERSION "1.4"
 #define GMSREPO "https://raw.githubusercontent.com/AzureSphereCloudEnabledAltair8800/RetroGames/main"
 
 
@@ -22,9 +22,22 @@ int str_tolower();
 #define WG_GET_BYTE  201
 #define WG_WAITING   1
 
+/* Block protocol, IN WG_BLOCK_VER reads 0 on firmware without it */
+#define WG_DMA_LO    202
+#define WG_DMA_HI    203
+#define WG_GET_REC   202
+#define WG_BLOCK_VER 203
+#define WG_RECORD    128
+#define CPMEOF       0x1A
+
 int inp();
 int outp();
 int fputc();
+int creat();
+int write();
+int close();
+
+char record[WG_RECORD];
 
 int dxwebfn(filename, len, endpoint)
 char *filename;
@@ -87,6 +100,61 @@ int *bytes_written;
     return 0;
 }
 
+/* The firmware copies each record straight into record[], one IN per 128 bytes */
+int dxwebblk(fd, bytes_written)
+int fd;
+int *bytes_written;
+{
+    int status;
+    int count;
+    int len;
+    unsigned dma;
+
+    count = 0;
+    dma = record;
+    outp(WG_DMA_LO, dma & 255);
+    outp(WG_DMA_HI, dma >> 8);
+
+    while (1)
+    {
+        status = inp(WG_STATUS) & 255;
+        if (status == WG_EOF)
+        {
+            break;
+        }
+
+        if (status == WG_FAILED)
+        {
+            return -1;
+        }
+
+        /* 0 until a full record is in, only the last one is shorter */
+        if (status == WG_DATAREADY)
+        {
+            len = inp(WG_GET_REC) & 255;
+            if (len > 0)
+            {
+                count += len;
+                for (; len < WG_RECORD; len++)
+                {
+                    record[len] = CPMEOF;
+                }
+                if (write(fd, record, 1) != 1)
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    if (bytes_written != 0)
+    {
+        *bytes_written = count;
+    }
+
+    return 0;
+}
+
 int dxseturl(endpoint, len)
 char *endpoint;
 int len;
@@ -104,10 +172,48 @@ int len;
 /* --- End dxweb.c inlined --- */
 
 FILE *fp_output;
+int fd_output;
+int blockio;
 char *endpoint;
 char *filename;
 char file_content[128];
 
+/* Create the output file, raw for the block protocol, buffered for the byte protocol */
+int dxcreate(name)
+char *name;
+{
+    if (blockio)
+    {
+        fd_output = creat(name);
+        return fd_output;
+    }
+
+    if ((fp_output = fopen(name, "w")) == NULL)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int dxwebsave(bytes_written)
+int *bytes_written;
+{
+    if (blockio)
+    {
+        return dxwebblk(fd_output, bytes_written);
+    }
+    return dxwebcpy(fp_output, bytes_written);
+}
+
+int dxclose()
+{
+    if (blockio)
+    {
+        return close(fd_output);
+    }
+    return fclose(fp_output);
+}
+
 int defaults()
 {
     FILE *fp;
@@ -148,6 +254,7 @@ char **argv;
     bytes_written = 0;
 
     defaults();
+    blockio = (inp(WG_BLOCK_VER) & 255) != 0;
 
     if (argc == 1)
     {
@@ -222,7 +329,7 @@ char **argv;
                 printf("Saving as '%s'\n", save_filename);
             }
 
-            if ((fp_output = fopen(save_filename, "w")) == NULL)
+            if (dxcreate(save_filename) == -1)
             {
                 printf("Error: Failed to create output file '%s'\n", save_filename);
                 printf("Check disk space and write permissions.\n");
@@ -230,7 +337,7 @@ char **argv;
             }
             
             dxwebfn(filename, strlen(filename), 0);
-            wg_result = dxwebcpy(fp_output, &bytes_written);
+            wg_result = dxwebsave(&bytes_written);
             if (wg_result == 0)
             {
                 printf(" done (%d bytes)\n", bytes_written);
@@ -240,7 +347,7 @@ char **argv;
                 printf(" failed\n");
             }
 
-            fclose(fp_output);
+            dxclose();
             if (wg_result == -1)
             {
                 printf("\n\nWeb copy failed for file '%s'. Check filename and network connection\n", save_filename);
@@ -272,7 +379,7 @@ char **argv;
                 printf("Saving as '%s'\n", save_filename);
             }
 
-            if ((fp_output = fopen(save_filename, "w")) == NULL)
+            if (dxcreate(save_filename) == -1)
             {
                 printf("Error: Failed to create output file '%s'\n", save_filename);
                 printf("Check disk space and write permissions.\n");
@@ -282,7 +389,7 @@ char **argv;
             /* Set games repository as the custom endpoint */
             dxseturl(GMSREPO, strlen(GMSREPO));
             dxwebfn(filename, strlen(filename), 0);
-            wg_result = dxwebcpy(fp_output, &bytes_written);
+            wg_result = dxwebsave(&bytes_written);
             if (wg_result == 0)
             {
                 printf(" done (%d bytes)\n", bytes_written);
@@ -292,7 +399,7 @@ char **argv;
                 printf(" failed\n");
             }
 
-            fclose(fp_output);
+            dxclose();
             if (wg_result == -1)
             {
                 printf("\n\nGame download failed for file '%s'. Check filename and network connection\n", save_filename);
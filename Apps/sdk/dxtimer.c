@@ -35,6 +35,14 @@
  * Timer 0: Ports 24/25 - Set high byte (24), low byte (25) and start
  * Timer 1: Ports 26/27 - Set high byte (26), low byte (27) and start
  * Timer 2: Ports 28/29 - Set high byte (28), low byte (29) and start
+ *
+ * Binary time ports, no string to parse:
+ * Port 46 - OUT n latches counter n, each IN returns its next byte (low first);
+ *           counter 6 latches T-states, instructions and microseconds at once
+ * Port 47 - IN low byte of the millisecond counter, latches the high byte
+ * Port 48 - IN high byte latched by port 47
+ * Port 49 - IN running timers (bit n = timer n), OUT timers that interrupt
+ * Port 50 - OUT RST the timer interrupt raises (default 4)
  */
 
 #include "dxtimer.h"
@@ -46,6 +54,20 @@
 #define T1_MSL 27 /* Timer 1 low byte */
 #define T2_MSH 28 /* Timer 2 high byte */
 #define T2_MSL 29 /* Timer 2 low byte */
+#define CNT_PT 46 /* Counter latch */
+#define MSL_PT 47 /* Millisecond counter low byte */
+#define MSH_PT 48 /* Millisecond counter high byte */
+#define TST_PT 49 /* Timer status and interrupt enable */
+#define TRST_PT 50 /* Timer interrupt RST */
+
+/* Counters latched through CNT_PT */
+#define CNT_MS 0  /* Milliseconds since boot */
+#define CNT_SEC 1 /* Seconds since boot */
+#define CNT_UNX 2 /* Seconds since 1970 UTC, 0 if not set */
+#define CNT_US 3  /* Microseconds since boot */
+#define CNT_TST 4 /* T-states the 8080 ran */
+#define CNT_INS 5 /* Instructions the 8080 ran */
+#define CNT_PRF 6 /* CNT_TST, CNT_INS and CNT_US in one latch */
 
 /* BDS C I/O entry points */
 int inp(); /* int inp(port) */
@@ -186,3 +208,140 @@ int x_tmract(timer) int timer;
     return inp(lo_port); /* non-zero if running, 0 if expired */
 }
 
+/* ------------------------------------------------------- */
+/* x_msnow() - Free-running millisecond counter (0..65535).
+ * Wraps every 65.5 seconds, subtract two readings for the
+ * time between them. Two port reads, no timer needed.
+ */
+unsigned x_msnow()
+{
+    unsigned ms;
+
+    ms = inp(MSL_PT);         /* latches the high byte */
+    ms |= (inp(MSH_PT) << 8);
+    return ms;
+}
+
+/* ------------------------------------------------------- */
+/* x_tmrsta() - Running timers in one read.
+ * Returns bit n set while timer n (0-2) runs, bit 3 for
+ * the seconds timer of port 30.
+ */
+int x_tmrsta()
+{
+    return inp(TST_PT);
+}
+
+/* ------------------------------------------------------- */
+/* x_tmrint(mask, rst) - Interrupt when timers expire.
+ * mask: timers as in x_tmrsta, 0 for none
+ * rst: RST 1-7 the expiry raises; the program installs
+ * its handler at rst * 8 and enables interrupts (EI).
+ */
+int x_tmrint(mask, rst) int mask, rst;
+{
+    outp(TRST_PT, rst);
+    outp(TST_PT, mask);
+    return 0;
+}
+
+/* ------------------------------------------------------- */
+/* x_cntget(result, counter) - Latch a 32-bit counter into a
+ * long (long.c layout, most significant byte first).
+ * Returns result.
+ */
+char *x_cntget(result, counter) char *result;
+int counter;
+{
+    outp(CNT_PT, counter);
+    return x_cntrd(result);
+}
+
+/* ------------------------------------------------------- */
+/* x_cntrd(result) - Next 32-bit value of the latched
+ * counters into a long (long.c layout).
+ * Returns result.
+ */
+char *x_cntrd(result) char *result;
+{
+    int i;
+
+    for (i = 3; i >= 0; i--)
+        result[i] = inp(CNT_PT); /* low byte first */
+    return result;
+}
+
+/* ------------------------------------------------------- */
+/* x_millis(result) - Milliseconds since boot as a long.
+ * Returns result.
+ */
+char *x_millis(result) char *result;
+{
+    return x_cntget(result, CNT_MS);
+}
+
+/* ------------------------------------------------------- */
+/* x_upsec(result) - Seconds since boot as a long.
+ * Cheaper than x_uptime, which formats a string.
+ * Returns result.
+ */
+char *x_upsec(result) char *result;
+{
+    return x_cntget(result, CNT_SEC);
+}
+
+/* ------------------------------------------------------- */
+/* x_unix(result) - Seconds since 1970 UTC as a long,
+ * 0 until the emulator has set its clock.
+ * Returns result.
+ */
+char *x_unix(result) char *result;
+{
+    return x_cntget(result, CNT_UNX);
+}
+
+/* ------------------------------------------------------- */
+/* x_tstat(result) - T-states the 8080 has run as a long,
+ * wraps. At the emulated clock this times code exactly,
+ * whatever speed the emulator runs at.
+ * Returns result.
+ */
+char *x_tstat(result) char *result;
+{
+    return x_cntget(result, CNT_TST);
+}
+
+/* ------------------------------------------------------- */
+/* x_instr(result) - Instructions the 8080 has run as a
+ * long, wraps.
+ * Returns result.
+ */
+char *x_instr(result) char *result;
+{
+    return x_cntget(result, CNT_INS);
+}
+
+/* ------------------------------------------------------- */
+/* x_usec(result) - Host microseconds since boot as a long,
+ * wraps every 71 minutes.
+ * Returns result.
+ */
+char *x_usec(result) char *result;
+{
+    return x_cntget(result, CNT_US);
+}
+
+/* ------------------------------------------------------- */
+/* x_perf(tst, ins, us) - T-states, instructions and host
+ * microseconds latched together, for benchmarks: subtract
+ * two readings, T-states per microsecond is the emulated
+ * speed in MHz.
+ */
+int x_perf(tst, ins, us) char *tst, *ins, *us;
+{
+    outp(CNT_PT, CNT_PRF);
+    x_cntrd(tst);
+    x_cntrd(ins);
+    x_cntrd(us);
+    return 0;
+}
@@ -36,3 +36,15 @@ int x_delay(timer, ms);  /* Blocking delay in milliseconds */
 int x_tmrset(timer, ms); /* Start non-blocking timer */
 int x_tmrexp(timer); /* Check if non-blocking timer has expired. True if expired, false if still running, 1 if invalid timer. */
 int x_tmract(timer); /* Check if non-blocking timer is active. Non-zero if active/running, 0 if expired, -1 if invalid timer. */
+unsigned x_msnow(); /* Free-running millisecond counter, wraps at 65535 */
+int x_tmrsta();     /* Running timers, bit n for timer n, bit 3 for the seconds timer */
+int x_tmrint();     /* Timers (mask) whose expiry raises RST rst */
+char *x_cntget();   /* Latch a 32-bit counter (0 ms, 1 s since boot, 2 Unix time, 3 us, 4 T-states, 5 instructions) into a long */
+char *x_millis();   /* Milliseconds since boot as a long */
+char *x_upsec();    /* Seconds since boot as a long */
+char *x_unix();     /* Seconds since 1970 UTC as a long, 0 if not set */
+char *x_cntrd();    /* Next 32-bit value of the latched counters into a long */
+char *x_tstat();    /* T-states the 8080 has run as a long */
+char *x_instr();    /* Instructions the 8080 has run as a long */
+char *x_usec();     /* Host microseconds since boot as a long */
+int x_perf();       /* T-states, instructions and microseconds latched together */
@@ -1,5 +1,53 @@
 #include "string.h"
 
+#define ALTR_PT 70
+#define LOAD_PT 200
+#define MX_PARM 51 /* Accelerator parameters, one byte per OUT */
+#define MX_CMD 52  /* OUT runs an operation, two IN return its result */
+#define MX_MIN 16  /* Shorter blocks are not worth the port traffic */
+
+#define MX_MOVE 1
+#define MX_FILL 2
+#define MX_CMP 3
+#define MX_LEN 4
+#define MX_FIND 5
+
+int inp();
+outp();
+
+/* True when the firmware has the block memory accelerator; asked each
+ * call, as globals in a library are shared by position with the app */
+int x_mxok()
+{
+    outp(ALTR_PT, 2);
+    if (inp(LOAD_PT) != 0xA5)
+        return 0;
+    return inp(LOAD_PT) & 1;
+}
+
+/* Run accelerator operation op, returns its 16-bit result */
+unsigned x_mxrun(op, src, dst, n, c)
+int op;
+unsigned src;
+unsigned dst;
+unsigned n;
+int c;
+{
+    unsigned r;
+
+    outp(MX_PARM, src & 0xFF);
+    outp(MX_PARM, src >> 8);
+    outp(MX_PARM, dst & 0xFF);
+    outp(MX_PARM, dst >> 8);
+    outp(MX_PARM, n & 0xFF);
+    outp(MX_PARM, n >> 8);
+    outp(MX_PARM, c & 0xFF);
+    outp(MX_CMD, op);
+    r = inp(MX_CMD);
+    r |= (inp(MX_CMD) << 8);
+    return r;
+}
+
 char *memcpy_bds(dest, src, n)
 register char *dest;
 register char *src;
@@ -9,6 +57,12 @@ unsigned n;
 
     orig = dest;
 
+    if (n >= MX_MIN && x_mxok())
+    {
+        x_mxrun(MX_MOVE, src, dest, n, 0);
+        return orig;
+    }
+
     while (n--)
         *dest++ = *src++;
 
@@ -27,6 +81,12 @@ unsigned n;
     if (dest == src || n == 0)
         return orig;
 
+    if (n >= MX_MIN && x_mxok())
+    {
+        x_mxrun(MX_MOVE, src, dest, n, 0);
+        return orig;
+    }
+
     if (dest < src)
     {
         while (n--)
@@ -52,6 +112,12 @@ unsigned n;
 
     orig = s;
 
+    if (n >= MX_MIN && x_mxok())
+    {
+        x_mxrun(MX_FILL, 0, s, n, c);
+        return orig;
+    }
+
     while (n--)
         *s++ = c;
 
@@ -69,6 +135,9 @@ unsigned n;
     if (n == 0)
         return 0;
 
+    if (n >= MX_MIN && x_mxok())
+        return x_mxrun(MX_CMP, s1, s2, n, 0);
+
     while (n--)
     {
         c1 = *s1++ & 0xFF;
@@ -87,9 +156,16 @@ int c;
 unsigned n;
 {
     register int target;
+    unsigned off;
 
     target = c & 0xFF;
 
+    if (n >= MX_MIN && x_mxok())
+    {
+        off = x_mxrun(MX_FIND, s, 0, n, target);
+        return off == n ? 0 : s + off;
+    }
+
     while (n--)
     {
         if ((*s & 0xFF) == target)
@@ -0,0 +1,481 @@
+/* Native benchmark for the 8080 interpreter core.
+
+   Links intel8080.c, memory.c and the flash disk controller with stub terminal
+   callbacks, runs a set of guest workloads and reports instructions/sec and
+   T-states/sec, so core variants can be compared before flashing a board. */
+
+#include "intel8080.h"
+#include "memory.h"
+#include "pico_88dcdd_flash.h"
+
+#include "cpm63k_disk.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Guest ports used by the .COM runner stubs
+#define BENCH_PORT_BDOS 0xFE
+#define BENCH_PORT_EXIT 0xFD
+
+#define BENCH_BATCH_CYCLES 100000
+
+// FNV-1a of the console output of the cpm workload as the guest's own BDOS prints it. Builds with
+// ALTAIR_BDOS_TRAP have to print the same bytes.
+#define CPM_OUTPUT_HASH 0xf87d6f06u
+#define BENCH_MAX_T_STATES 50000000000ULL // Safety net against a workload that never finishes
+
+intel8080_t cpu;
+
+typedef enum
+{
+    CORE_RUN,  // i8080_run batches (what the firmware main loop uses)
+    CORE_CYCLE // i8080_cycle per instruction (jump table or threaded core)
+} bench_core_t;
+
+typedef struct
+{
+    const char* name;
+    uint64_t instructions;
+    uint64_t t_states;
+    double seconds;
+    bool completed;
+} bench_result_t;
+
+static bench_core_t bench_core = CORE_RUN;
+static bool bench_echo = true;
+
+// Terminal: scripted input, output is matched against the prompt that ends the current phase
+static const char* input_script = NULL;
+static bool input_armed = false;
+static const char* wait_for = NULL;
+static size_t wait_pos = 0;
+static int wait_hits = 0;
+static bool workload_done = false;
+static uint32_t output_hash = 0; // FNV-1a of the console output of the current workload
+
+static uint8_t bench_term_in(void)
+{
+    if (input_armed && input_script != NULL && *input_script != '\0')
+    {
+        return (uint8_t)*input_script++;
+    }
+    return 0;
+}
+
+static void bench_term_out(uint8_t c)
+{
+    c &= 0x7f;
+    if (bench_echo)
+    {
+        putchar(c);
+    }
+    output_hash = (output_hash ^ c) * 16777619u;
+
+    if (wait_for == NULL)
+    {
+        return;
+    }
+    if (c == (uint8_t)wait_for[wait_pos])
+    {
+        if (wait_for[++wait_pos] == '\0')
+        {
+            wait_pos = 0;
+            wait_hits++;
+        }
+    }
+    else
+    {
+        wait_pos = (c == (uint8_t)wait_for[0]) ? 1 : 0;
+    }
+}
+
+static uint8_t bench_sense(void)
+{
+    return 0;
+}
+
+// Minimal CP/M BDOS for exercisers: function 2 (console out) and 9 (print $ string)
+static void bench_bdos(void)
+{
+    switch (cpu.registers.c)
+    {
+        case 2:
+            bench_term_out(cpu.registers.e);
+            break;
+        case 9:
+            for (uint16_t addr = cpu.registers.de; read8(&memory_main, addr) != '$'; addr++)
+            {
+                bench_term_out(read8(&memory_main, addr));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static uint8_t bench_io_in(uint8_t port)
+{
+    (void)port;
+    return 0xff;
+}
+
+static void bench_io_out(uint8_t port, uint8_t data)
+{
+    (void)data;
+    if (port == BENCH_PORT_BDOS)
+    {
+        bench_bdos();
+    }
+    else if (port == BENCH_PORT_EXIT)
+    {
+        workload_done = true;
+    }
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_reset(uint16_t start)
+{
+    static disk_controller_t disk_controller = {.disk_select = (port_out)pico_disk_select,
+                                                .disk_status = (port_in)pico_disk_status,
+                                                .disk_function = (port_out)pico_disk_function,
+                                                .sector = (port_in)pico_disk_sector,
+                                                .write = (port_out)pico_disk_write,
+                                                .read = (port_in)pico_disk_read};
+    i8080_reset(&cpu, &memory_main, bench_term_in, bench_term_out, bench_sense, &disk_controller, bench_io_in,
+                bench_io_out);
+    i8080_examine(&cpu, start);
+
+    input_script = NULL;
+    input_armed = false;
+    wait_for = NULL;
+    wait_pos = 0;
+    wait_hits = 0;
+    workload_done = false;
+}
+
+// Run until the check callback reports completion, accumulating into result
+static void bench_execute(bench_result_t* result, bool (*finished)(void))
+{
+    double start = now_seconds();
+
+    while (!finished() && result->t_states < BENCH_MAX_T_STATES)
+    {
+        if (bench_core == CORE_RUN)
+        {
+            uint32_t before = cpu.instruction_count;
+            result->t_states += i8080_run(&cpu, BENCH_BATCH_CYCLES);
+            result->instructions += (uint32_t)(cpu.instruction_count - before);
+        }
+        else
+        {
+            uint32_t cycles = 0;
+            while (cycles < BENCH_BATCH_CYCLES && !workload_done)
+            {
+                cycles += i8080_cycle(&cpu);
+                result->instructions++;
+            }
+            result->t_states += cycles;
+        }
+    }
+
+    result->seconds += now_seconds() - start;
+    result->completed = finished();
+}
+
+// ----------------------------------------------------------------------------
+// CRC: CRC-16/CCITT over 0x1000-0x8FFF, 20 passes. Pure ALU/branch/memory mix.
+// ----------------------------------------------------------------------------
+static const uint8_t crc_program[] = {
+    0x31, 0x00, 0xf0, // 0100 LXI SP,0F000H
+    0x06, 0x14,       // 0103 MVI B,20
+    0x21, 0x00, 0x10, // 0105 OUTER: LXI H,1000H
+    0x11, 0xff, 0xff, // 0108 LXI D,0FFFFH
+    0x7e,             // 010B INNER: MOV A,M
+    0xaa,             // 010C XRA D
+    0x57,             // 010D MOV D,A
+    0x0e, 0x08,       // 010E MVI C,8
+    0x7b,             // 0110 BIT: MOV A,E
+    0x87,             // 0111 ADD A
+    0x5f,             // 0112 MOV E,A
+    0x7a,             // 0113 MOV A,D
+    0x17,             // 0114 RAL
+    0x57,             // 0115 MOV D,A
+    0xd2, 0x21, 0x01, // 0116 JNC SKIP
+    0x7a,             // 0119 MOV A,D
+    0xee, 0x10,       // 011A XRI 10H
+    0x57,             // 011C MOV D,A
+    0x7b,             // 011D MOV A,E
+    0xee, 0x21,       // 011E XRI 21H
+    0x5f,             // 0120 MOV E,A
+    0x0d,             // 0121 SKIP: DCR C
+    0xc2, 0x10, 0x01, // 0122 JNZ BIT
+    0x23,             // 0125 INX H
+    0x7c,             // 0126 MOV A,H
+    0xfe, 0x90,       // 0127 CPI 90H
+    0xc2, 0x0b, 0x01, // 0129 JNZ INNER
+    0x05,             // 012C DCR B
+    0xc2, 0x05, 0x01, // 012D JNZ OUTER
+    0xeb,             // 0130 XCHG
+    0x22, 0x80, 0x00, // 0131 SHLD 0080H
+    0xd3, 0xfd,       // 0134 OUT BENCH_PORT_EXIT
+    0x76,             // 0136 HLT
+};
+
+static bool workload_exit_seen(void)
+{
+    return workload_done;
+}
+
+static void bench_crc(bench_result_t* result)
+{
+    memory_reset(&memory_main);
+    memcpy(&memory[0x0100], crc_program, sizeof(crc_program));
+
+    uint32_t seed = 0x12345678;
+    for (uint32_t addr = 0x1000; addr < 0x9000; addr++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        memory[addr] = (uint8_t)(seed >> 16);
+    }
+
+    bench_reset(0x0100);
+    bench_execute(result, workload_exit_seen);
+    printf("  crc result 0x%04x\n", read16(&memory_main, 0x0080));
+}
+
+// ----------------------------------------------------------------------------
+// BASIC: Mandelbrot in 8K BASIC, typed in over the terminal
+// ----------------------------------------------------------------------------
+static const char* basic_script = "\r\rY\r"
+                                  "10 FOR Y=-12 TO 12\r"
+                                  "20 FOR X=-39 TO 20\r"
+                                  "30 CA=X*0.0458:CB=Y*0.08333\r"
+                                  "40 A=CA:B=CB\r"
+                                  "50 FOR I=0 TO 15\r"
+                                  "60 T=A*A-B*B+CA:B=2*A*B+CB:A=T\r"
+                                  "70 IF (A*A+B*B)>4 THEN 90\r"
+                                  "80 NEXT I:PRINT \" \";:GOTO 100\r"
+                                  "90 PRINT CHR$(48+I);\r"
+                                  "100 NEXT X:PRINT\r"
+                                  "110 NEXT Y\r"
+                                  "RUN\r";
+
+static bool basic_finished(void)
+{
+    // Every "OK" after the whole script was typed means RUN returned to the prompt
+    if (*input_script != '\0')
+    {
+        wait_hits = 0;
+        return false;
+    }
+    return wait_hits > 0;
+}
+
+static void bench_basic(bench_result_t* result)
+{
+    memory_reset(&memory_main);
+    load8kRom(&memory_main, 0x0000);
+
+    bench_reset(0x0000);
+    input_script = basic_script;
+    input_armed = true;
+    wait_for = "OK";
+    bench_execute(result, basic_finished);
+}
+
+// ----------------------------------------------------------------------------
+// CP/M: boot cpm63k from the disk boot loader, then run DIR a number of times
+// ----------------------------------------------------------------------------
+#define CPM_DIR_REPEATS 20
+
+static bool cpm_prompt_seen(void)
+{
+    return wait_hits > 0;
+}
+
+static void bench_cpm(bench_result_t* result)
+{
+    memory_reset(&memory_main);
+    pico_disk_init();
+    pico_disk_load(0, cpm63k_dsk, cpm63k_dsk_len);
+    loadDiskLoader(&memory_main, 0xFF00);
+
+    bench_reset(0xFF00);
+    wait_for = "A>";
+    bench_execute(result, cpm_prompt_seen);
+
+    input_armed = true;
+    for (int i = 0; i < CPM_DIR_REPEATS; i++)
+    {
+        wait_hits = 0;
+        input_script = "DIR\r";
+        bench_execute(result, cpm_prompt_seen);
+    }
+
+    printf("  console output 0x%08x\n", (unsigned int)output_hash);
+    if (output_hash != CPM_OUTPUT_HASH)
+    {
+        printf("  console output differs from the guest BDOS (0x%08x)\n", (unsigned int)CPM_OUTPUT_HASH);
+        result->completed = false;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// COM: run a CP/M .COM exerciser (8080EXM, CPUDIAG, ...) with BDOS print stubs
+// ----------------------------------------------------------------------------
+static const char* com_path = NULL;
+
+static void bench_com(bench_result_t* result)
+{
+    FILE* file = fopen(com_path, "rb");
+    if (file == NULL)
+    {
+        printf("  cannot open %s\n", com_path);
+        return;
+    }
+
+    memory_reset(&memory_main);
+    size_t size = fread(&memory[0x0100], 1, 0xE000, file);
+    fclose(file);
+
+    // 0000: warm boot ends the run, 0005: JMP to the BDOS stub, which also marks the top of the TPA
+    static const uint8_t warm_boot[] = {0xd3, BENCH_PORT_EXIT, 0x76};   // OUT exit, HLT
+    static const uint8_t bdos_entry[] = {0xc3, 0x00, 0xe0};             // JMP 0E000H
+    static const uint8_t bdos_stub[] = {0xd3, BENCH_PORT_BDOS, 0xc9};   // OUT bdos, RET
+    memcpy(&memory[0x0000], warm_boot, sizeof(warm_boot));
+    memcpy(&memory[0x0005], bdos_entry, sizeof(bdos_entry));
+    memcpy(&memory[0xE000], bdos_stub, sizeof(bdos_stub));
+
+    printf("  loaded %zu bytes\n", size);
+    bench_reset(0x0100);
+    cpu.registers.sp = 0xDFF0;
+    bench_execute(result, workload_exit_seen);
+}
+
+static void print_result(const bench_result_t* result)
+{
+    double seconds = result->seconds > 0 ? result->seconds : 1e-9;
+
+    printf("%-8s %s %12llu instr %14llu T %8.3f s %9.2f MIPS %9.2f MHz\n", result->name,
+           result->completed ? "ok  " : "FAIL", (unsigned long long)result->instructions,
+           (unsigned long long)result->t_states, result->seconds, result->instructions / seconds / 1e6,
+           result->t_states / seconds / 1e6);
+}
+
+static void usage(const char* argv0)
+{
+    printf("usage: %s [--core run|cycle] [--quiet] [crc] [basic] [cpm] [com=FILE.COM]\n", argv0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* workloads[16];
+    int workload_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--core") == 0 && i + 1 < argc)
+        {
+            bench_core = strcmp(argv[++i], "cycle") == 0 ? CORE_CYCLE : CORE_RUN;
+        }
+        else if (strcmp(argv[i], "--quiet") == 0)
+        {
+            bench_echo = false;
+        }
+        else if (strncmp(argv[i], "com=", 4) == 0)
+        {
+            com_path = argv[i] + 4;
+            workloads[workload_count++] = "com";
+        }
+        else if (argv[i][0] == '-' || workload_count >= 15)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            workloads[workload_count++] = argv[i];
+        }
+    }
+
+    if (workload_count == 0)
+    {
+        workloads[workload_count++] = "crc";
+        workloads[workload_count++] = "basic";
+        workloads[workload_count++] = "cpm";
+    }
+
+    bench_result_t results[16];
+    int result_count = 0;
+
+    printf("8080 core: %s", bench_core == CORE_RUN ? "i8080_run" : "i8080_cycle");
+#ifdef ALTAIR_THREADED_CORE
+    printf(", threaded");
+#endif
+#ifdef ALTAIR_LAZY_FLAGS
+    printf(", lazy flags");
+#endif
+#ifdef ALTAIR_PROFILE
+    printf(", profile");
+#endif
+#ifdef ALTAIR_HEATMAP
+    printf(", heatmap");
+#endif
+#ifdef ALTAIR_TRACE
+    printf(", trace");
+#endif
+    printf("\n");
+
+    for (int i = 0; i < workload_count; i++)
+    {
+        bench_result_t* result = &results[result_count];
+        memset(result, 0, sizeof(*result));
+        result->name = workloads[i];
+        output_hash = 2166136261u;
+
+        printf("\n[%s]\n", workloads[i]);
+        if (strcmp(workloads[i], "crc") == 0)
+        {
+            bench_crc(result);
+        }
+        else if (strcmp(workloads[i], "basic") == 0)
+        {
+            bench_basic(result);
+        }
+        else if (strcmp(workloads[i], "cpm") == 0)
+        {
+            bench_cpm(result);
+        }
+        else if (strcmp(workloads[i], "com") == 0)
+        {
+            bench_com(result);
+        }
+        else
+        {
+            printf("  unknown workload\n");
+            continue;
+        }
+        printf("\n");
+        result_count++;
+    }
+
+    printf("\n");
+    bool all_completed = true;
+    for (int i = 0; i < result_count; i++)
+    {
+        print_result(&results[i]);
+        all_completed = all_completed && results[i].completed;
+    }
+
+    return all_completed ? 0 : 1;
+}
@@ -7,8 +7,10 @@
 
 #ifdef DISPLAY_2_8_SUPPORT
 
+#include "Altair8800/i8080_duty.h"
 #include "build_version.h"
 #include "st7789_async.h"
+#include "web_panel.h"
 #include "wifi.h"
 #include <stdio.h>
 #include <string.h>
@@ -19,6 +21,24 @@ static const int LED_SPACING_STATUS = 32;
 static const int LED_SPACING_ADDRESS = 20;
 static const int LED_SPACING_DATA = 20;
 
+// LED brightness steps from off (0) to fully lit (LED_LEVELS - 1), they share the 16 colour
+// palette of the driver with the labels
+#define LED_LEVELS 8
+
+// Level each LED was last drawn with, LED_UNDRAWN forces the next frame to draw it
+#define LED_UNDRAWN 0xFF
+static uint8_t status_drawn[10];
+static uint8_t address_drawn[16];
+static uint8_t data_drawn[8];
+
+// Start of the last frame drawn by display_2_8_poll
+static uint32_t last_frame_us = 0;
+
+#ifdef ALTAIR_PANEL_DUTY
+// Duty counters as of the last frame
+static i8080_duty_t last_duty;
+#endif
+
 void display_2_8_init(void)
 {
     // Initialize async ST7789 driver
@@ -42,6 +62,9 @@ void display_2_8_init_front_panel(void)
 {
     // Clear screen once
     st7789_async_clear(rgb332(0, 0, 0));
+    memset(status_drawn, LED_UNDRAWN, sizeof(status_drawn));
+    memset(address_drawn, LED_UNDRAWN, sizeof(address_drawn));
+    memset(data_drawn, LED_UNDRAWN, sizeof(data_drawn));
 
     color_t TEXT_WHITE = rgb332(255, 255, 255);
     color_t TEXT_GRAY = rgb332(100, 100, 100);
@@ -131,71 +154,125 @@ void display_2_8_init_front_panel(void)
     printf("[Display] Static elements drawn (labels persist)\n");
 }
 
-void display_2_8_show_front_panel(uint16_t address, uint8_t data, uint16_t status)
+// Dark red when off up to bright red
+static color_t led_color(uint8_t level)
 {
-    static uint16_t last_status = 0xFFFF; // Initialize to impossible values to force first draw
-    static uint16_t last_address = 0xFFFF;
-    static uint8_t last_data = 0xFF;
-
-    bool needs_update = false;
-
-    color_t LED_ON = rgb332(255, 0, 0); // Bright red
-    color_t LED_OFF = rgb332(40, 0, 0); // Dark red
-
-    // === ONLY update the LED rectangles (no clear, no labels!) ===
+    return rgb332((uint8_t)(40 + (255 - 40) * level / (LED_LEVELS - 1)), 0, 0);
+}
 
-    // STATUS LEDs (10 LEDs) - only update if changed
-    if (status != last_status)
+// Draw one row of LEDs, most significant first, only those whose level changed
+static void draw_leds(const uint8_t* levels, uint8_t* drawn, int count, int x, int y, int spacing)
+{
+    for (int bit = count - 1; bit >= 0; bit--)
     {
-        int x_status = 10;
-        int y_status = 35;
-        for (int i = 0; i < 10; i++)
+        if (levels[bit] != drawn[bit])
         {
-            bool led_state = (status >> i) & 1;
-            st7789_async_fill_rect(x_status, y_status, LED_SIZE, LED_SIZE, led_state ? LED_ON : LED_OFF);
-            x_status += LED_SPACING_STATUS;
+            st7789_async_fill_rect(x, y, LED_SIZE, LED_SIZE, led_color(levels[bit]));
+            drawn[bit] = levels[bit];
         }
-        last_status = status;
-        needs_update = true;
+        x += spacing;
     }
+}
 
-    // ADDRESS LEDs (16 LEDs) - only update if changed
-    if (address != last_address)
+static void led_levels(uint32_t value, uint8_t* levels, int count)
+{
+    for (int bit = 0; bit < count; bit++)
     {
-        int x_addr = 2;
-        int y_addr = 100;
-        for (int i = 15; i >= 0; i--)
+        levels[bit] = ((value >> bit) & 1) ? LED_LEVELS - 1 : 0;
+    }
+}
+
+// Draw the three LED rows, levels are indexed by bit
+static void show_levels(const uint8_t* status, const uint8_t* address, const uint8_t* data)
+{
+    // STATUS LEDs drawn left to right from bit 0, the labels follow that order
+    int x_status = 10;
+    for (int i = 0; i < 10; i++)
+    {
+        if (status[i] != status_drawn[i])
         {
-            int bit = 15 - i;
-            bool led_state = (address >> bit) & 1;
-            st7789_async_fill_rect(x_addr, y_addr, LED_SIZE, LED_SIZE, led_state ? LED_ON : LED_OFF);
-            x_addr += LED_SPACING_ADDRESS;
+            st7789_async_fill_rect(x_status, 35, LED_SIZE, LED_SIZE, led_color(status[i]));
+            status_drawn[i] = status[i];
         }
-        last_address = address;
-        needs_update = true;
+        x_status += LED_SPACING_STATUS;
+    }
+
+    draw_leds(address, address_drawn, 16, 2, 100, LED_SPACING_ADDRESS); // A15-A0
+    draw_leds(data, data_drawn, 8, 2, 170, LED_SPACING_DATA);           // D7-D0
+
+    // Sends only the LEDs that changed colour, and catches up on changes a busy DMA held back
+    st7789_async_update();
+}
+
+void display_2_8_show_front_panel(uint16_t address, uint8_t data, uint16_t status)
+{
+    uint8_t status_levels[10];
+    uint8_t address_levels[16];
+    uint8_t data_levels[8];
+    led_levels(status, status_levels, 10);
+    led_levels(address, address_levels, 16);
+    led_levels(data, data_levels, 8);
+    show_levels(status_levels, address_levels, data_levels);
+}
+
+#ifdef ALTAIR_PANEL_DUTY
+// Share of the samples since the last frame that saw a line high, rounded to the nearest level
+static uint8_t duty_level(uint32_t high, uint32_t samples)
+{
+    if (high >= samples)
+    {
+        return LED_LEVELS - 1; // Read just after a sample the sample count did not include yet
     }
+    return (uint8_t)((high * (LED_LEVELS - 1) + samples / 2) / samples);
+}
+#endif
+
+void display_2_8_show_published(void)
+{
+    web_panel_state_t state;
+    web_panel_read(&state);
 
-    // DATA LEDs (8 LEDs) - only update if changed
-    if (data != last_data)
+#ifdef ALTAIR_PANEL_DUTY
+    // While the 8080 runs, address and data LEDs show how long each line was high since the last
+    // frame, as the real panel's LEDs do; stopped or single stepped they show the bus as it is
+    const i8080_duty_t* duty = i8080_duty_get();
+    uint32_t samples = duty->samples - last_duty.samples;
+    if (samples != 0)
     {
-        int x_data = 2;
-        int y_data = 170;
-        for (int i = 7; i >= 0; i--)
+        uint8_t status_levels[10];
+        uint8_t address_levels[16];
+        uint8_t data_levels[8];
+        led_levels(state.status, status_levels, 10);
+
+        last_duty.samples += samples;
+        for (int i = 0; i < 16; i++)
         {
-            int bit = 7 - i;
-            bool led_state = (data >> bit) & 1;
-            st7789_async_fill_rect(x_data, y_data, LED_SIZE, LED_SIZE, led_state ? LED_ON : LED_OFF);
-            x_data += LED_SPACING_DATA;
+            uint32_t high = duty->address[i];
+            address_levels[i] = duty_level(high - last_duty.address[i], samples);
+            last_duty.address[i] = high;
         }
-        last_data = data;
-        needs_update = true;
+        for (int i = 0; i < 8; i++)
+        {
+            uint32_t high = duty->data[i];
+            data_levels[i] = duty_level(high - last_duty.data[i], samples);
+            last_duty.data[i] = high;
+        }
+        show_levels(status_levels, address_levels, data_levels);
+        return;
     }
+#endif
 
-    // Only send update to display if something changed
-    if (needs_update)
+    display_2_8_show_front_panel(state.address, state.data, state.status);
+}
+
+void display_2_8_poll(uint32_t now_us)
+{
+    if (now_us - last_frame_us < DISPLAY_2_8_FRAME_US)
     {
-        st7789_async_update();
+        return;
     }
+    last_frame_us = now_us;
+    display_2_8_show_published();
 }
 
 void display_2_8_get_stats(uint64_t* skipped_updates)
@@ -13,6 +13,9 @@ extern "C"
 {
 #endif
 
+// Front panel refresh interval (50 Hz)
+#define DISPLAY_2_8_FRAME_US 20000
+
 #ifdef DISPLAY_2_8_SUPPORT
 
     // Initialize the 2.8" LCD display
@@ -39,6 +42,13 @@ extern "C"
     //   status: 16-bit status word (bits 0-9 for status LEDs)
     void display_2_8_show_front_panel(uint16_t address, uint8_t data, uint16_t status);
 
+    // Show the bus state core 0 last published for the browser panel (web_panel.h)
+    // The core that called display_2_8_init must call this, the DMA IRQ is enabled there
+    void display_2_8_show_published(void);
+
+    // Show the published bus state once DISPLAY_2_8_FRAME_US have passed since the last frame
+    void display_2_8_poll(uint32_t now_us);
+
     // Get display statistics
     void display_2_8_get_stats(uint64_t* skipped_updates);
 
@@ -62,6 +72,11 @@ static inline void display_2_8_show_front_panel(uint16_t address, uint8_t data,
     (void)data;
     (void)status;
 }
+static inline void display_2_8_show_published(void) {}
+static inline void display_2_8_poll(uint32_t now_us)
+{
+    (void)now_us;
+}
 
 #endif // DISPLAY_2_8_SUPPORT
 
@@ -28,10 +28,105 @@ enum InkyPin
     INKY_BUSY = 26,
 };
 
+// Layout: 16 pixel text rows, the refreshed fields start on 8 pixel rows as partial updates
+// of the UC8151 need
+static const int LEFT_MARGIN = 5;
+static const int VALUE_OFFSET = 60; // Aligned offset for values
+static const int ROW_HEIGHT = 16;
+
+// Minimum time between two refreshes, the panel keeps its image without power anyway
+#define INKY_REFRESH_INTERVAL_US 2000000
+
+// A full refresh clears the ghosting partial refreshes leave behind, after this many of them
+#define INKY_PARTIALS_PER_FULL 20
+
+// Status lines redrawn on their own when their text changes
+typedef struct
+{
+    int x;
+    int y;
+    int w;
+    const char* label;
+    char value[40];
+    char shown[40]; // What the panel shows, "" before the first full refresh
+} inky_field_t;
+
+enum
+{
+    FIELD_WIFI,
+    FIELD_IP,
+    FIELD_CPU,
+    FIELD_DISK,
+    FIELD_COUNT
+};
+
+static inky_field_t g_fields[FIELD_COUNT] = {
+    {0, 72, 296, "WiFi", "Not connected", ""},
+    {0, 88, 296, "IP", "---.---.---.---", ""},
+    {0, 112, 144, "CPU", "Stopped", ""},
+    {144, 112, 152, "Disk", "idle", ""},
+};
+
 // Static C++ objects (only created when INKY_SUPPORT is enabled)
 static pimoroni::UC8151* g_uc8151 = nullptr;
 static pimoroni::PicoGraphics_Pen1BitY* g_graphics = nullptr;
 
+static bool g_full_pending = true;
+static int g_partials = 0;
+static uint32_t g_last_refresh_us = 0;
+
+static void set_field(int field, const char* value)
+{
+    strncpy(g_fields[field].value, value, sizeof(g_fields[field].value) - 1);
+}
+
+// Draw a status line into the frame buffer, over white
+static void draw_field(inky_field_t* field)
+{
+    g_graphics->set_pen(15);
+    g_graphics->rectangle({field->x, field->y, field->w, ROW_HEIGHT});
+    g_graphics->set_pen(0);
+    g_graphics->text(field->label, {field->x + LEFT_MARGIN, field->y}, 296);
+    g_graphics->text(field->value, {field->x + LEFT_MARGIN + VALUE_OFFSET, field->y}, 296);
+    strcpy(field->shown, field->value);
+}
+
+static void draw_all(void)
+{
+    // Clear display to white
+    g_graphics->set_pen(15);
+    g_graphics->clear();
+
+    // Set pen to black for text
+    g_graphics->set_pen(0);
+
+    char line_buffer[64];
+
+    // Line 1: Title (larger font)
+    g_graphics->set_font("bitmap14_outline");
+    snprintf(line_buffer, sizeof(line_buffer), "ALTAIR 8800");
+    g_graphics->text(line_buffer, {LEFT_MARGIN, 2}, 296);
+
+    // Switch to bitmap8 font for remaining text
+    g_graphics->set_font("bitmap8");
+
+    // Line 2: Board name (label + value aligned)
+    g_graphics->text("Board", {LEFT_MARGIN, 32}, 296);
+    snprintf(line_buffer, sizeof(line_buffer), "%s", PICO_BOARD);
+    g_graphics->text(line_buffer, {LEFT_MARGIN + VALUE_OFFSET, 32}, 296);
+
+    // Line 3: Build version with date and time (label + value aligned)
+    g_graphics->text("Build", {LEFT_MARGIN, 48}, 296);
+    snprintf(line_buffer, sizeof(line_buffer), "v%d %s %s", BUILD_VERSION, BUILD_DATE, BUILD_TIME);
+    g_graphics->text(line_buffer, {LEFT_MARGIN + VALUE_OFFSET, 48}, 296);
+
+    // WiFi, IP, CPU and disk lines
+    for (int i = 0; i < FIELD_COUNT; i++)
+    {
+        draw_field(&g_fields[i]);
+    }
+}
+
 extern "C"
 {
 
@@ -42,78 +137,59 @@ extern "C"
         g_uc8151 = new pimoroni::UC8151(296, 128, pimoroni::ROTATE_0);
         g_graphics = new pimoroni::PicoGraphics_Pen1BitY(g_uc8151->width, g_uc8151->height, nullptr);
 
+        // Refreshes run on the panel while the emulator goes on, inky_display_poll waits for BUSY
+        // to clear before sending the next one. The fast waveform keeps partial updates short.
+        g_uc8151->set_blocking(false);
+        g_uc8151->update_speed(2);
+
         // Clear display to white
-        g_graphics->set_pen(0);
+        g_graphics->set_pen(15);
         g_graphics->clear();
     }
 
     void inky_display_update(const char* ssid, const char* ip)
+    {
+        set_field(FIELD_WIFI, ssid && ssid[0] != '\0' ? ssid : "Not connected");
+        set_field(FIELD_IP, ip && ip[0] != '\0' ? ip : "---.---.---.---");
+    }
+
+    void inky_display_poll(uint32_t now_us, bool cpu_running, bool disk_busy)
     {
         if (!g_graphics || !g_uc8151)
         {
             return; // Not initialized
         }
-
-        // Clear display to white
-        g_graphics->set_pen(15);
-        g_graphics->clear();
-
-        // Set pen to black for text
-        g_graphics->set_pen(0);
-
-        int y_pos = 5;
-        const int left_margin = 5;
-        const int value_offset = 60; // Aligned offset for values
-        char line_buffer[64];
-
-        // Line 1: Title (larger font)
-        g_graphics->set_font("bitmap14_outline");
-        snprintf(line_buffer, sizeof(line_buffer), "ALTAIR 8800");
-        g_graphics->text(line_buffer, {left_margin, y_pos}, 296);
-        y_pos += 30;
-
-        // Switch to bitmap8 font for remaining text
-        g_graphics->set_font("bitmap8");
-
-        // Line 2: Board name (label + value aligned)
-        g_graphics->text("Board", {left_margin, y_pos}, 296);
-        snprintf(line_buffer, sizeof(line_buffer), "%s", PICO_BOARD);
-        g_graphics->text(line_buffer, {left_margin + value_offset, y_pos}, 296);
-        y_pos += 18;
-
-        // Line 3: Build version with date and time (label + value aligned)
-        g_graphics->text("Build", {left_margin, y_pos}, 296);
-        snprintf(line_buffer, sizeof(line_buffer), "v%d %s %s", BUILD_VERSION, BUILD_DATE, BUILD_TIME);
-        g_graphics->text(line_buffer, {left_margin + value_offset, y_pos}, 296);
-        y_pos += 24;
-
-        // Line 4: WiFi SSID (label + value aligned)
-        g_graphics->text("WiFi", {left_margin, y_pos}, 296);
-        if (ssid && ssid[0] != '\0')
+        if (now_us - g_last_refresh_us < INKY_REFRESH_INTERVAL_US || g_uc8151->is_busy())
         {
-            snprintf(line_buffer, sizeof(line_buffer), "%s", ssid);
+            return;
         }
-        else
-        {
-            snprintf(line_buffer, sizeof(line_buffer), "Not connected");
-        }
-        g_graphics->text(line_buffer, {left_margin + value_offset, y_pos}, 296);
-        y_pos += 20;
 
-        // Line 5: IP Address (label + value aligned)
-        g_graphics->text("IP", {left_margin, y_pos}, 296);
-        if (ip && ip[0] != '\0')
+        set_field(FIELD_CPU, cpu_running ? "Running" : "Stopped");
+        set_field(FIELD_DISK, disk_busy ? "writing" : "idle");
+
+        if (g_full_pending)
         {
-            snprintf(line_buffer, sizeof(line_buffer), "%s", ip);
+            draw_all();
+            g_uc8151->update(g_graphics);
+            g_full_pending = false;
+            g_partials = 0;
+            g_last_refresh_us = now_us;
+            return;
         }
-        else
+
+        // One changed line per refresh, the next goes out once the panel is done with this one
+        for (int i = 0; i < FIELD_COUNT; i++)
         {
-            snprintf(line_buffer, sizeof(line_buffer), "---.---.---.---");
+            inky_field_t* field = &g_fields[i];
+            if (strcmp(field->value, field->shown) != 0)
+            {
+                draw_field(field);
+                g_uc8151->partial_update(g_graphics, {field->x, field->y, field->w, ROW_HEIGHT});
+                g_full_pending = ++g_partials >= INKY_PARTIALS_PER_FULL;
+                g_last_refresh_us = now_us;
+                return;
+            }
         }
-        g_graphics->text(line_buffer, {left_margin + value_offset, y_pos}, 296);
-
-        // Update the physical display
-        g_uc8151->update(g_graphics);
     }
 
 } // extern "C"
@@ -6,6 +6,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -17,12 +18,20 @@ extern "C"
     // Initialize the Inky display
     void inky_display_init(void);
 
-    // Update the display with current system information
+    // Set the network information shown, the panel is refreshed later by inky_display_poll
     // Parameters:
     //   ssid: WiFi SSID (NULL if not connected)
     //   ip: IP address string (NULL if not connected)
     void inky_display_update(const char* ssid, const char* ip);
 
+    // Draw what changed since the last refresh, called from the main loop. Returns at once while
+    // the panel is still refreshing or the last refresh was less than 2 s ago. The first refresh
+    // and every 20th after it redraws the whole panel, the others only the changed status line.
+    // Parameters:
+    //   cpu_running: CPU line shows Running or Stopped
+    //   disk_busy: Disk line shows writing while written sectors wait to be flushed
+    void inky_display_poll(uint32_t now_us, bool cpu_running, bool disk_busy);
+
 #else
 
 // No-op stubs when Inky support is disabled
@@ -32,6 +41,12 @@ static inline void inky_display_update(const char* ssid, const char* ip)
     (void)ssid;
     (void)ip;
 }
+static inline void inky_display_poll(uint32_t now_us, bool cpu_running, bool disk_busy)
+{
+    (void)now_us;
+    (void)cpu_running;
+    (void)disk_busy;
+}
 
 #endif // INKY_SUPPORT
 
@@ -34,11 +34,49 @@
 #define PIN_LED_G 27
 #define PIN_LED_B 28
 
+// Requested SPI clock. The SPI block runs at the fastest rate at or below it that clk_peri divides
+// down to, and clk_peri follows clk_sys, so a raised clock profile never drives the panel faster.
+#ifndef ST7789_SPI_BAUD
+#define ST7789_SPI_BAUD (75 * 1000 * 1000)
+#endif
+
 // SPI instance
 #define SPI_INST spi0
 
-// Framebuffer (320x240 x 2 bytes RGB565)
-static uint16_t g_framebuffer[ST7789_ASYNC_WIDTH * ST7789_ASYNC_HEIGHT];
+// Dirty rectangles: only the regions drawn to since the last update are sent
+#define MAX_DIRTY_RECTS 8
+#define RECT_OVERHEAD_PIXELS 32 // Window setup and DMA restart per rectangle, in pixel transfer time
+
+// The front panel needs a handful of colours, so pixels are 4-bit indices into a palette of
+// RGB565 colours: 37.5 KB instead of 150 KB for a full RGB565 framebuffer. Rows are expanded
+// to RGB565 on the fly into two line buffers, one filled while the other is DMAed.
+#define PALETTE_SIZE 16
+
+typedef struct
+{
+    uint16_t x0, y0, x1, y1; // Inclusive
+} rect_t;
+
+// Framebuffer (320x240 x 4 bits), two pixels per byte with the even one in the low nibble
+static uint8_t g_framebuffer[ST7789_ASYNC_WIDTH * ST7789_ASYNC_HEIGHT / 2];
+static color_t g_palette[PALETTE_SIZE];
+static int g_palette_count = 0;
+
+// Regions changed since the last update
+static rect_t g_dirty[MAX_DIRTY_RECTS];
+static int g_dirty_count = 0;
+
+// Regions of the update in flight, sent row by row from the DMA IRQ
+static rect_t g_frame[MAX_DIRTY_RECTS];
+static int g_frame_count = 0;
+static int g_window_rect = -1; // Rectangle the display's RAM write is open for
+static int g_prep_rect = 0;    // Next row to expand
+static int g_prep_row = 0;
+
+// Ping-pong line buffers, each holding one expanded row of a frame rectangle
+static uint16_t g_line[2][ST7789_ASYNC_WIDTH];
+static int g_line_rect[2] = {-1, -1}; // -1 when the buffer holds nothing to send
+static int g_sending = 0;
 
 // DMA channel
 static int g_dma_channel = -1;
@@ -133,21 +171,240 @@ static void set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
     send_data(data, 4);
 }
 
+static uint32_t rect_area(const rect_t* rect)
+{
+    return (uint32_t)(rect->x1 - rect->x0 + 1) * (rect->y1 - rect->y0 + 1);
+}
+
+static rect_t rect_union(const rect_t* a, const rect_t* b)
+{
+    rect_t u = {
+        .x0 = a->x0 < b->x0 ? a->x0 : b->x0,
+        .y0 = a->y0 < b->y0 ? a->y0 : b->y0,
+        .x1 = a->x1 > b->x1 ? a->x1 : b->x1,
+        .y1 = a->y1 > b->y1 ? a->y1 : b->y1,
+    };
+    return u;
+}
+
+// Pixels the union of a and b sends that neither of them needs
+static uint32_t merge_waste(const rect_t* a, const rect_t* b)
+{
+    rect_t u = rect_union(a, b);
+    int w = (a->x1 < b->x1 ? a->x1 : b->x1) - (a->x0 > b->x0 ? a->x0 : b->x0) + 1;
+    int h = (a->y1 < b->y1 ? a->y1 : b->y1) - (a->y0 > b->y0 ? a->y0 : b->y0) + 1;
+    uint32_t overlap = w > 0 && h > 0 ? (uint32_t)w * (uint32_t)h : 0;
+    return rect_area(&u) + overlap - rect_area(a) - rect_area(b);
+}
+
+// Add a changed region. It is merged with another one whenever the union wastes less than a
+// rectangle's overhead; when the list is full, the pair that wastes the fewest pixels is merged.
+static void mark_dirty(int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 >= ST7789_ASYNC_WIDTH)
+        x1 = ST7789_ASYNC_WIDTH - 1;
+    if (y1 >= ST7789_ASYNC_HEIGHT)
+        y1 = ST7789_ASYNC_HEIGHT - 1;
+    if (x0 > x1 || y0 > y1)
+        return;
+
+    rect_t rect = {(uint16_t)x0, (uint16_t)y0, (uint16_t)x1, (uint16_t)y1};
+    for (;;)
+    {
+        // Cheapest partner for the new rectangle (index g_dirty_count stands for rect itself)
+        int best_a = -1;
+        int best_b = -1;
+        uint32_t best_waste = UINT32_MAX;
+        for (int i = 0; i < g_dirty_count; i++)
+        {
+            uint32_t waste = merge_waste(&g_dirty[i], &rect);
+            if (waste < best_waste)
+            {
+                best_a = i;
+                best_b = g_dirty_count;
+                best_waste = waste;
+            }
+        }
+
+        if (best_waste > RECT_OVERHEAD_PIXELS)
+        {
+            if (g_dirty_count < MAX_DIRTY_RECTS)
+            {
+                break;
+            }
+
+            // Full: a pair already in the list may be the better merge
+            for (int i = 0; i < g_dirty_count; i++)
+            {
+                for (int j = i + 1; j < g_dirty_count; j++)
+                {
+                    uint32_t waste = merge_waste(&g_dirty[i], &g_dirty[j]);
+                    if (waste < best_waste)
+                    {
+                        best_a = i;
+                        best_b = j;
+                        best_waste = waste;
+                    }
+                }
+            }
+        }
+
+        if (best_b == g_dirty_count)
+        {
+            // Merge into the new rectangle, then try the grown one against the others again
+            rect = rect_union(&g_dirty[best_a], &rect);
+            g_dirty[best_a] = g_dirty[--g_dirty_count];
+            continue;
+        }
+
+        g_dirty[best_a] = rect_union(&g_dirty[best_a], &g_dirty[best_b]);
+        g_dirty[best_b] = g_dirty[--g_dirty_count];
+        break;
+    }
+    g_dirty[g_dirty_count++] = rect;
+}
+
+// Palette index of a colour, the closest one once the palette is full
+static uint8_t palette_index(color_t color)
+{
+    for (int i = 0; i < g_palette_count; i++)
+    {
+        if (g_palette[i] == color)
+        {
+            return (uint8_t)i;
+        }
+    }
+    if (g_palette_count < PALETTE_SIZE)
+    {
+        g_palette[g_palette_count] = color;
+        return (uint8_t)g_palette_count++;
+    }
+
+    // Colours are byte swapped RGB565, compare the components
+    uint16_t c = (uint16_t)((color >> 8) | (color << 8));
+    int best = 0;
+    int best_distance = 1 << 30;
+    for (int i = 0; i < PALETTE_SIZE; i++)
+    {
+        uint16_t p = (uint16_t)((g_palette[i] >> 8) | (g_palette[i] << 8));
+        int dr = ((c >> 11) & 0x1F) - ((p >> 11) & 0x1F);
+        int dg = ((c >> 5) & 0x3F) - ((p >> 5) & 0x3F);
+        int db = (c & 0x1F) - (p & 0x1F);
+        int distance = 4 * dr * dr + dg * dg + 4 * db * db;
+        if (distance < best_distance)
+        {
+            best = i;
+            best_distance = distance;
+        }
+    }
+    return (uint8_t)best;
+}
+
+// Store a palette index, true if the pixel changed
+static inline bool put_index(int x, int y, uint8_t index)
+{
+    uint8_t* cell = &g_framebuffer[(y * ST7789_ASYNC_WIDTH + x) >> 1];
+    uint8_t value = (x & 1) ? (uint8_t)((*cell & 0x0F) | (index << 4)) : (uint8_t)((*cell & 0xF0) | index);
+    if (value == *cell)
+    {
+        return false;
+    }
+    *cell = value;
+    return true;
+}
+
+// Expand the next row of the frame into line buffer slot, marking it empty once all are sent
+static void prepare_line(int slot)
+{
+    if (g_prep_rect >= g_frame_count)
+    {
+        g_line_rect[slot] = -1;
+        return;
+    }
+
+    const rect_t* rect = &g_frame[g_prep_rect];
+    int y = rect->y0 + g_prep_row;
+    const uint8_t* row = &g_framebuffer[y * ST7789_ASYNC_WIDTH / 2];
+    uint16_t* out = g_line[slot];
+    for (int x = rect->x0; x <= rect->x1; x++)
+    {
+        uint8_t cell = row[x >> 1];
+        *out++ = g_palette[(x & 1) ? (cell >> 4) : (cell & 0x0F)];
+    }
+    g_line_rect[slot] = g_prep_rect;
+
+    if (y == rect->y1)
+    {
+        g_prep_rect++;
+        g_prep_row = 0;
+    }
+    else
+    {
+        g_prep_row++;
+    }
+}
+
+// DMA a prepared line, opening the window of its rectangle first. Rows of one rectangle follow
+// each other in the same RAM write.
+static void send_line(int slot)
+{
+    const rect_t* rect = &g_frame[g_line_rect[slot]];
+    if (g_line_rect[slot] != g_window_rect)
+    {
+        // The DMA is done once the last bytes are in the FIFO, not on the wire
+        while (spi_is_busy(SPI_INST))
+        {
+            tight_loop_contents();
+        }
+        gpio_put(PIN_CS, 1);
+
+        set_window(rect->x0, rect->y0, rect->x1, rect->y1);
+        send_command(ST7789_RAMWR);
+        gpio_put(PIN_DC, 1);
+        gpio_put(PIN_CS, 0);
+        g_window_rect = g_line_rect[slot];
+    }
+
+    g_sending = slot;
+    dma_channel_set_read_addr(g_dma_channel, g_line[slot], false);
+    dma_channel_set_trans_count(g_dma_channel, (rect->x1 - rect->x0 + 1) * sizeof(uint16_t), true);
+}
+
 // DMA completion IRQ handler
 static void dma_irq_handler(void)
 {
     if (dma_channel_get_irq0_status(g_dma_channel))
     {
         dma_channel_acknowledge_irq0(g_dma_channel);
-        g_dma_busy = false;
+
+        // Send the line prepared meanwhile and refill the one just sent
+        int done = g_sending;
+        int next = done ^ 1;
+        if (g_line_rect[next] >= 0)
+        {
+            send_line(next);
+            prepare_line(done);
+            return;
+        }
+
+        while (spi_is_busy(SPI_INST))
+        {
+            tight_loop_contents();
+        }
         gpio_put(PIN_CS, 1); // Deassert CS when done
+        g_line_rect[done] = -1;
+        g_window_rect = -1;
+        g_dma_busy = false;
     }
 }
 
 bool st7789_async_init(void)
 {
-    // Initialize SPI at 75 MHz
-    spi_init(SPI_INST, 75 * 1000 * 1000);
+    spi_init(SPI_INST, ST7789_SPI_BAUD);
 
     // Set up SPI pins
     gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
@@ -232,11 +489,11 @@ bool st7789_async_init(void)
     return true;
 }
 
-static void st7789_async_set_pixel(int x, int y, color_t color)
+static void st7789_async_set_pixel(int x, int y, uint8_t index)
 {
     if (x >= 0 && x < ST7789_ASYNC_WIDTH && y >= 0 && y < ST7789_ASYNC_HEIGHT)
     {
-        g_framebuffer[y * ST7789_ASYNC_WIDTH + x] = color;
+        put_index(x, y, index);
     }
 }
 
@@ -248,6 +505,9 @@ void st7789_async_text(const char* str, int x, int y, color_t color)
     while (str[len])
         len++;
 
+    int x_start = x;
+    uint8_t index = palette_index(color);
+
     // Draw string in reverse order
     for (int i = len - 1; i >= 0; i--)
     {
@@ -285,13 +545,15 @@ void st7789_async_text(const char* str, int x, int y, color_t color)
                 {
                     if (column_data & (1 << row))
                     {
-                        st7789_async_set_pixel(x + col, y + row, color);
+                        st7789_async_set_pixel(x + col, y + row, index);
                     }
                 }
             }
             x += 6; // 5 pixels + 1 space
         }
     }
+
+    mark_dirty(x_start, y, x - 1, y + 7);
 }
 
 void st7789_async_fill_rect(int x, int y, int w, int h, color_t color)
@@ -314,48 +576,71 @@ void st7789_async_fill_rect(int x, int y, int w, int h, color_t color)
     if (w <= 0 || h <= 0)
         return;
 
-    // Direct framebuffer access (much faster than set_pixel per pixel)
+    // Redrawing an LED in the colour it already has leaves nothing to send
+    uint8_t index = palette_index(color);
+    bool changed = false;
     for (int dy = 0; dy < h; dy++)
     {
-        uint16_t* row = &g_framebuffer[(y + dy) * ST7789_ASYNC_WIDTH + x];
         for (int dx = 0; dx < w; dx++)
         {
-            row[dx] = color;
+            changed |= put_index(x + dx, y + dy, index);
         }
     }
+
+    if (changed)
+    {
+        mark_dirty(x, y, x + w - 1, y + h - 1);
+    }
 }
 
 void st7789_async_clear(color_t color)
 {
-    for (int i = 0; i < ST7789_ASYNC_WIDTH * ST7789_ASYNC_HEIGHT; i++)
-    {
-        g_framebuffer[i] = color;
-    }
+    // Nothing else is on screen any more, the palette starts over
+    g_palette[0] = color;
+    g_palette_count = 1;
+    memset(g_framebuffer, 0, sizeof(g_framebuffer));
+    g_dirty_count = 0;
+    mark_dirty(0, 0, ST7789_ASYNC_WIDTH - 1, ST7789_ASYNC_HEIGHT - 1);
 }
 
 bool st7789_async_update(void)
 {
-    // Check if DMA is still busy
+    if (g_dirty_count == 0)
+    {
+        return true; // Nothing changed
+    }
+
+    // Check if DMA is still busy, the changes wait for the next update
     if (g_dma_busy)
     {
         g_skip_count++;
         return false;
     }
 
-    // Set window to full screen
-    set_window(0, 0, ST7789_ASYNC_WIDTH - 1, ST7789_ASYNC_HEIGHT - 1);
-
-    // Start RAM write
-    send_command(ST7789_RAMWR);
-
-    // Set up for data mode and assert CS
-    gpio_put(PIN_DC, 1);
-    gpio_put(PIN_CS, 0);
-
-    // Start DMA transfer (non-blocking!) - 2x size for 16-bit pixels as bytes
+    uint32_t pixels = 0;
+    for (int i = 0; i < g_dirty_count; i++)
+    {
+        g_frame[i] = g_dirty[i];
+        pixels += rect_area(&g_dirty[i]);
+    }
+    g_frame_count = g_dirty_count;
+    if (pixels >= ST7789_ASYNC_WIDTH * ST7789_ASYNC_HEIGHT)
+    {
+        // No cheaper than the whole screen
+        rect_t screen = {0, 0, ST7789_ASYNC_WIDTH - 1, ST7789_ASYNC_HEIGHT - 1};
+        g_frame[0] = screen;
+        g_frame_count = 1;
+    }
+    g_dirty_count = 0;
+
+    // Start DMA transfer (non-blocking!), the IRQ handler sends the remaining rows
+    g_prep_rect = 0;
+    g_prep_row = 0;
+    g_window_rect = -1;
+    prepare_line(0);
+    prepare_line(1);
     g_dma_busy = true;
-    dma_channel_set_read_addr(g_dma_channel, g_framebuffer, false);
-    dma_channel_set_trans_count(g_dma_channel, sizeof(g_framebuffer), true);
+    send_line(0);
 
     g_update_count++;
     return true;
@@ -16,7 +16,8 @@ extern "C"
 #define ST7789_ASYNC_WIDTH 320
 #define ST7789_ASYNC_HEIGHT 240
 
-    // RGB565 color format (16-bit color)
+    // RGB565 color format (16-bit color). The framebuffer holds a palette of 16 of them, started
+    // over by st7789_async_clear; further colours are drawn in the closest one.
     typedef uint16_t color_t;
 
     // Create RGB565 color from RGB values with byte swap for SPI
@@ -43,8 +44,8 @@ extern "C"
     // Clear the entire framebuffer to a color
     void st7789_async_clear(color_t color);
 
-    // Start non-blocking DMA transfer to display
-    // Returns true if transfer started, false if DMA is busy
+    // Start non-blocking DMA transfer of the regions changed since the last update
+    // Returns true if transfer started or nothing changed, false if DMA is busy
     bool st7789_async_update(void);
 
     // Check if DMA transfer is complete
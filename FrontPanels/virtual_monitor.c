@@ -2,9 +2,31 @@
    Licensed under the MIT License. */
 
 #include "virtual_monitor.h"
+#include "i8080_break.h"
 #include "i8080_disasm.h"
+#include "i8080_heatmap.h"
+#include "i8080_profile.h"
+#include "i8080_trace.h"
 #include "memory.h"
+#include "metrics.h"
+#include "snapshot.h"
+#include "wifi_power.h"
+#include "PortDrivers/disk_fetch.h"
+#include "PortDrivers/printer_io.h"
+#include "pico/stdlib.h" // Board definitions for the Wi-Fi check
+#ifdef SD_CARD_SUPPORT
+#include "pico_88dcdd_sd_card.h"
+#ifdef ALTAIR_HDSK
+#include "pico_hdsk_sd_card.h"
+#endif
+#elif defined(REMOTE_FS)
+#include "pico_88dcdd_remote.h"
+#else
+#include "pico_88dcdd_flash.h"
+#endif
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char* too_many_switches = "\r\nError: Number of input switches must be less that or equal to 16.\n\r";
@@ -20,7 +42,7 @@ static bool validate_input_data(const char* command)
 
     if (len > 16)
     {
-        publish_message(too_many_switches, strlen(too_many_switches));
+        monitor_write(too_many_switches, strlen(too_many_switches));
         return false;
     }
 
@@ -28,7 +50,7 @@ static bool validate_input_data(const char* command)
     {
         if (!(command[i] == '1' || command[i] == '0'))
         {
-            publish_message(invalid_switches, strlen(invalid_switches));
+            monitor_write(invalid_switches, strlen(invalid_switches));
             return false;
         }
     }
@@ -47,7 +69,7 @@ static void publish_virtual_input_data(uint16_t switches)
     snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %s %s (0x%04x), %s %dB", "Input", address_bus_high_byte,
              address_bus_low_byte, switches, get_i8080_instruction_name((uint8_t)switches, &i8080_instruction_size),
              i8080_instruction_size);
-    publish_message(panel_info, strlen(panel_info));
+    monitor_write(panel_info, strlen(panel_info));
 }
 
 static void process_virtual_switches(const char* command)
@@ -74,11 +96,794 @@ static void process_virtual_switches(const char* command)
     }
 }
 
-void process_virtual_input(const char* command, size_t len)
+// CLOCK shows the emulated CPU clock, CLOCK <kHz> sets it (0 = unthrottled, 2000 = 2 MHz)
+static void process_clock_command(const char* command)
+{
+    const char* arg = command + 5;
+    while (*arg == ' ')
+    {
+        arg++;
+    }
+
+    if (*arg != '\0')
+    {
+        cpu_state_set_clock_khz((uint32_t)strtoul(arg, NULL, 10));
+    }
+
+    uint32_t khz = cpu_state_get_clock_khz();
+    size_t msg_length;
+    if (khz == 0)
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Unthrottled", "CPU clock");
+    }
+    else
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu kHz", "CPU clock",
+                                      (unsigned long)khz);
+    }
+    monitor_write(panel_info, msg_length);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// BAUD shows the 2SIO console line rate, BAUD <rate> sets it (0 = unlimited)
+static void process_baud_command(const char* command)
+{
+    const char* arg = command + 4;
+    while (*arg == ' ')
+    {
+        arg++;
+    }
+
+    if (*arg != '\0')
+    {
+        i8080_sio_set_baud(&cpu, (uint32_t)strtoul(arg, NULL, 10));
+    }
+
+    size_t msg_length;
+    if (cpu.sio.baud == 0)
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Unlimited", "2SIO line rate");
+    }
+    else
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu baud", "2SIO line rate",
+                                      (unsigned long)cpu.sio.baud);
+    }
+    monitor_write(panel_info, msg_length);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// Indexes of the n largest non-zero counters, largest first
+static size_t profile_top(const uint32_t* counts, uint8_t* top, size_t n)
+{
+    bool used[256] = {false};
+    size_t found = 0;
+
+    for (; found < n; found++)
+    {
+        int best = -1;
+        for (int i = 0; i < 256; i++)
+        {
+            if (!used[i] && counts[i] != 0 && (best < 0 || counts[i] > counts[best]))
+            {
+                best = i;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+        used[best] = true;
+        top[found] = (uint8_t)best;
+    }
+    return found;
+}
+
+// Percentage in tenths, for "%lu.%lu%%" output without floating point
+static unsigned long profile_permille(uint64_t count, uint64_t total)
+{
+    return total ? (unsigned long)(count * 1000 / total) : 0;
+}
+
+// PROFILE dumps the guest profile (hot opcodes, hot 256-byte pages, port usage), PROFILE RESET clears it
+static void process_profile_command(const char* command)
+{
+    const i8080_profile_t* profile = i8080_profile_get();
+    size_t msg_length;
+
+    if (profile == NULL)
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Not enabled, build with -DALTAIR_PROFILE=ON",
+                                      "Profile");
+        monitor_write(panel_info, msg_length);
+        monitor_write("\r\nCPU MONITOR> ", 15);
+        return;
+    }
+
+    if (strcmp(command, "PROFILE RESET") == 0)
+    {
+        i8080_profile_reset();
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Counters cleared", "Profile");
+        monitor_write(panel_info, msg_length);
+        monitor_write("\r\nCPU MONITOR> ", 15);
+        return;
+    }
+
+    uint64_t total = profile->instructions;
+    uint8_t top[10];
+    uint8_t instruction_length = 0;
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %llu instructions, %llu T-states",
+                                  "Profile", (unsigned long long)total, (unsigned long long)profile->t_states);
+    monitor_write(panel_info, msg_length);
+
+    size_t count = profile_top(profile->opcode, top, 10);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t hits = profile->opcode[top[i]];
+        unsigned long permille = profile_permille(hits, total);
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: 0x%02x %-12s %10lu %3lu.%lu%%",
+                                      "Hot opcode", top[i], get_i8080_instruction_name(top[i], &instruction_length),
+                                      (unsigned long)hits, permille / 10, permille % 10);
+        monitor_write(panel_info, msg_length);
+    }
+
+    count = profile_top(profile->page, top, 8);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t hits = profile->page[top[i]];
+        unsigned long permille = profile_permille(hits, total);
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: 0x%04x-0x%04x %10lu %3lu.%lu%%",
+                                      "Hot page", top[i] << 8, (top[i] << 8) | 0xff, (unsigned long)hits,
+                                      permille / 10, permille % 10);
+        monitor_write(panel_info, msg_length);
+    }
+
+    for (int port = 0; port < 256; port++)
+    {
+        if (profile->port_in[port] != 0 || profile->port_out[port] != 0)
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: 0x%02x IN %10lu OUT %10lu",
+                                          "Port", port, (unsigned long)profile->port_in[port],
+                                          (unsigned long)profile->port_out[port]);
+            monitor_write(panel_info, msg_length);
+        }
+    }
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// Shade of a page in the HEATMAP map, on a log scale from '.' for one access to '@' for the
+// busiest page of the kind
+static char heatmap_shade(uint32_t count, uint32_t max)
+{
+    static const char shades[] = " .:-=+*#%@";
+    if (count == 0)
+    {
+        return shades[0];
+    }
+    int bits = 32 - __builtin_clz(count);
+    int max_bits = 32 - __builtin_clz(max);
+    return shades[1 + (max_bits > 1 ? (bits - 1) * 8 / (max_bits - 1) : 8)];
+}
+
+// HEATMAP dumps the guest memory accesses per 256-byte page (a map and the hot pages of each kind),
+// HEATMAP RESET clears them
+static void process_heatmap_command(const char* command)
+{
+    static const char* const kinds[I8080_HEATMAP_KINDS] = {"Reads", "Writes", "Executes"};
+    const i8080_heatmap_t* heatmap = i8080_heatmap_get();
+    size_t msg_length;
+
+    if (heatmap == NULL)
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Not enabled, build with -DALTAIR_HEATMAP=ON",
+                                      "Heatmap");
+        monitor_write(panel_info, msg_length);
+        monitor_write("\r\nCPU MONITOR> ", 15);
+        return;
+    }
+
+    if (strcmp(command, "HEATMAP RESET") == 0)
+    {
+        i8080_heatmap_reset();
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Counters cleared", "Heatmap");
+        monitor_write(panel_info, msg_length);
+        monitor_write("\r\nCPU MONITOR> ", 15);
+        return;
+    }
+
+    // Copied first, the counters keep going while the CPU runs
+    static i8080_heatmap_t counts;
+    counts = *heatmap;
+    uint64_t total[I8080_HEATMAP_KINDS] = {0};
+    uint32_t max[I8080_HEATMAP_KINDS] = {0};
+    for (int kind = 0; kind < I8080_HEATMAP_KINDS; kind++)
+    {
+        for (int page = 0; page < 256; page++)
+        {
+            total[kind] += counts.count[kind][page];
+            if (counts.count[kind][page] > max[kind])
+            {
+                max[kind] = counts.count[kind][page];
+            }
+        }
+    }
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %llu reads, %llu writes, %llu instructions",
+                                  "Heatmap", (unsigned long long)total[I8080_HEATMAP_READ],
+                                  (unsigned long long)total[I8080_HEATMAP_WRITE],
+                                  (unsigned long long)total[I8080_HEATMAP_EXECUTE]);
+    monitor_write(panel_info, msg_length);
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %-16s %-16s %s", "Pages", kinds[0],
+                                  kinds[1], kinds[2]);
+    monitor_write(panel_info, msg_length);
+
+    // A row of 16 pages (4KB) per line, each kind shaded against its busiest page
+    for (int row = 0; row < 16; row++)
+    {
+        char map[I8080_HEATMAP_KINDS][17];
+        for (int kind = 0; kind < I8080_HEATMAP_KINDS; kind++)
+        {
+            for (int column = 0; column < 16; column++)
+            {
+                map[kind][column] = heatmap_shade(counts.count[kind][row * 16 + column], max[kind]);
+            }
+            map[kind][16] = '\0';
+        }
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%8s0x%04x: %s %s %s", "", row << 12,
+                                      map[0], map[1], map[2]);
+        monitor_write(panel_info, msg_length);
+    }
+
+    for (int kind = 0; kind < I8080_HEATMAP_KINDS; kind++)
+    {
+        uint8_t top[4];
+        size_t count = profile_top(counts.count[kind], top, 4);
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t hits = counts.count[kind][top[i]];
+            unsigned long permille = profile_permille(hits, total[kind]);
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: 0x%04x-0x%04x %10lu %3lu.%lu%%",
+                                          kinds[kind], top[i] << 8, (top[i] << 8) | 0xff, (unsigned long)hits,
+                                          permille / 10, permille % 10);
+            monitor_write(panel_info, msg_length);
+        }
+    }
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// STATS shows the host load metrics of the last one second window
+static void process_stats_command(void)
+{
+    const metrics_snapshot_t* stats = metrics_get();
+    size_t msg_length;
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu instr/s, %lu T-states/s",
+                                  "Emulation", (unsigned long)stats->instructions_per_sec,
+                                  (unsigned long)stats->t_states_per_sec);
+    monitor_write(panel_info, msg_length);
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: CPU %u.%u%%, display %u.%u%%", "Core 0",
+                                  stats->core0_cpu_permille / 10, stats->core0_cpu_permille % 10,
+                                  stats->core0_display_permille / 10, stats->core0_display_permille % 10);
+    monitor_write(panel_info, msg_length);
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: busy %u.%u%%", "Core 1",
+                                  stats->core1_busy_permille / 10, stats->core1_busy_permille % 10);
+    monitor_write(panel_info, msg_length);
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: TX high water %lu, RX high water %lu",
+                                  "WS queues", (unsigned long)stats->ws_tx_high_water,
+                                  (unsigned long)stats->ws_rx_high_water);
+    monitor_write(panel_info, msg_length);
+
+    const uint32_t* sizes = stats->ws_frame_sizes;
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                  "\r\n%14s: <16B %lu, <64B %lu, <256B %lu, <1KB %lu, 1KB+ %lu", "WS frames",
+                                  (unsigned long)sizes[0], (unsigned long)sizes[1], (unsigned long)sizes[2],
+                                  (unsigned long)sizes[3], (unsigned long)sizes[4]);
+    monitor_write(panel_info, msg_length);
+
+    const uint32_t* latency = stats->ws_frame_latency;
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                  "\r\n%14s: <1ms %lu, <5ms %lu, <10ms %lu, <20ms %lu, <50ms %lu, 50ms+ %lu",
+                                  "WS latency", (unsigned long)latency[0], (unsigned long)latency[1],
+                                  (unsigned long)latency[2], (unsigned long)latency[3], (unsigned long)latency[4],
+                                  (unsigned long)latency[5]);
+    monitor_write(panel_info, msg_length);
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu bytes/s, %lu chunks (%llu bytes) total",
+                                  "HTTP", (unsigned long)stats->http_bytes_per_sec, (unsigned long)stats->http_chunks,
+                                  (unsigned long long)stats->http_bytes);
+    monitor_write(panel_info, msg_length);
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu dirty sectors", "Disk cache",
+                                  (unsigned long)stats->disk_dirty_sectors);
+    monitor_write(panel_info, msg_length);
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: ", "Printer");
+    msg_length += printer_io_describe(panel_info + msg_length, sizeof(panel_info) - msg_length);
+    monitor_write(panel_info, msg_length < sizeof(panel_info) ? msg_length : sizeof(panel_info) - 1);
+
+#if defined(CYW43_WL_GPIO_LED_PIN) && defined(ALTAIR_WIFI_POWER)
+    const uint32_t* pm_ms = stats->wifi_pm_ms;
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                  "\r\n%14s: %s, %lu changes, interactive %lus, balanced %lus, idle %lus", "Wi-Fi power",
+                                  wifi_power_mode_name((uint8_t)stats->wifi_pm_mode),
+                                  (unsigned long)stats->wifi_pm_switches, (unsigned long)(pm_ms[0] / 1000),
+                                  (unsigned long)(pm_ms[1] / 1000), (unsigned long)(pm_ms[2] / 1000));
+    monitor_write(panel_info, msg_length);
+#endif
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %llu instructions, %llu T-states", "Total",
+                                  (unsigned long long)stats->instructions, (unsigned long long)stats->t_states);
+    monitor_write(panel_info, msg_length);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// SYNC writes the SD card write-back cache to the card, the patch pool to the flash patch log,
+// or waits for the RemoteFS server to acknowledge all writes
+static void process_sync_command(void)
+{
+    size_t msg_length;
+#ifdef SD_CARD_SUPPORT
+    uint32_t dirty = sd_disk_dirty_sectors();
+    sd_disk_flush();
+#ifdef ALTAIR_HDSK
+    dirty += hdsk_dirty_sectors();
+    hdsk_flush();
+#endif
+    metrics_disk_dirty(0);
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu sectors written", "Sync",
+                                  (unsigned long)dirty);
+#elif defined(REMOTE_FS)
+    uint32_t dirty = remote_disk_dirty_sectors();
+    remote_disk_flush();
+    uint32_t left = remote_disk_dirty_sectors();
+    metrics_disk_dirty(left);
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu sectors written, %lu unacknowledged",
+                                  "Sync", (unsigned long)(dirty - left), (unsigned long)left);
+#elif defined(ALTAIR_FLASH_DISK_LOG)
+    uint32_t dirty = pico_disk_dirty_sectors();
+    pico_disk_flush();
+    uint32_t left = pico_disk_dirty_sectors();
+    metrics_disk_dirty(left);
+    uint16_t live, total;
+    pico_disk_get_log_stats(&live, NULL, &total);
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                  "\r\n%14s: %lu sectors written, %lu unsaved, log %u/%u pages live", "Sync",
+                                  (unsigned long)(dirty - left), (unsigned long)left, live, total);
+#else
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: no SD card disks", "Sync");
+#endif
+    monitor_write(panel_info, msg_length);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// DISKS lists what each drive holds and the images in the SD card disk directory, MOUNT <drive>
+// <image> puts an image into a drive without a reboot (reboot the guest OS if it had the drive
+// logged in)
+static void process_mount_command(const char* command)
+{
+    size_t msg_length;
+#ifdef SD_CARD_SUPPORT
+    if (strncmp(command, "MOUNT", 5) == 0)
+    {
+        const char* arg = command + 5;
+        while (*arg == ' ')
+        {
+            arg++;
+        }
+        uint8_t drive = (uint8_t)(arg[0] - 'A');
+        const char* name = arg + 1;
+        if (*name == ':')
+        {
+            name++;
+        }
+        while (*name == ' ')
+        {
+            name++;
+        }
+
+        if (drive >= MAX_DRIVES || *name == '\0')
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\nUsage: MOUNT <A-D> <image>");
+        }
+        else if (sd_disk_mount(drive, name))
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %s", "Mounted",
+                                          sd_disk_image(drive));
+        }
+        else
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Cannot open %s, drive %c unchanged",
+                                          "Mount", name, 'A' + drive);
+        }
+        monitor_write(panel_info, msg_length);
+        monitor_write("\r\nCPU MONITOR> ", 15);
+        return;
+    }
+
+    for (uint8_t drive = 0; drive < MAX_DRIVES; drive++)
+    {
+        const char* image = sd_disk_image(drive);
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%13s%c: %s", "Drive ", 'A' + drive,
+                                      image != NULL ? image : "(empty)");
+        monitor_write(panel_info, msg_length);
+    }
+
+    char name[48];
+    uint32_t size = 0;
+    for (uint16_t index = 0; sd_disk_find_image(index, name, sizeof(name), &size); index++)
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %-32s %8lu bytes",
+                                      index == 0 ? SD_DISK_DIR : "", name, (unsigned long)size);
+        monitor_write(panel_info, msg_length);
+    }
+#else
+    (void)command;
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: SD card builds only", "Mount");
+    monitor_write(panel_info, msg_length);
+#endif
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// FETCH <drive> <url> [crc] downloads a disk image onto the SD card in the background and mounts
+// it into the drive, checking the CRC-32 (hex) when given. FETCH alone shows how the download
+// is doing, FETCH CANCEL stops it. text is the command as typed, for the case of the URL.
+static void process_fetch_command(const char* command, const char* text)
+{
+    size_t msg_length;
+    const char* arg = command + 5;
+    while (*arg == ' ')
+    {
+        arg++;
+    }
+
+    if (strcmp(arg, "CANCEL") == 0)
+    {
+        disk_fetch_cancel();
+    }
+    else if (*arg != '\0')
+    {
+        uint8_t drive = (uint8_t)(arg[0] - 'A');
+        const char* url = text + (arg - command) + 1;
+        if (*url == ':')
+        {
+            url++;
+        }
+        while (*url == ' ')
+        {
+            url++;
+        }
+
+        char url_text[MONITOR_COMMAND_MAX];
+        size_t url_len = strcspn(url, " ");
+        memcpy(url_text, url, url_len);
+        url_text[url_len] = '\0';
+        char* end;
+        uint32_t crc = (uint32_t)strtoul(url + url_len, &end, 16);
+        bool check_crc = end != url + url_len;
+
+        if (drive >= MAX_DRIVES || url_len == 0)
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\nUsage: FETCH <A-D> <url> [crc32] | FETCH CANCEL");
+            monitor_write(panel_info, msg_length);
+            monitor_write("\r\nCPU MONITOR> ", 15);
+            return;
+        }
+        if (!disk_fetch_start(drive, url_text, check_crc, crc))
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                          "\r\n%14s: Not started, a download is running or the URL has no file name",
+                                          "Fetch");
+            monitor_write(panel_info, msg_length);
+        }
+    }
+
+    msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: ", "Fetch");
+    msg_length += disk_fetch_describe(panel_info + msg_length, sizeof(panel_info) - msg_length);
+    monitor_write(panel_info, msg_length < sizeof(panel_info) ? msg_length : sizeof(panel_info) - 1);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// SNAPSHOT saves the machine, CHECKPOINT adds the pages written since to it, SNAPSHOT DELETE
+// removes it all, RESTORE brings back the newest and runs, REWIND [n] goes back n checkpoints
+// (default 1) and stops
+static void process_snapshot_command(const char* command)
+{
+    size_t msg_length;
+    int32_t current = -1;
+    uint16_t count = 0;
+    if (strncmp(command, "REWIND", 6) == 0 && (command[6] == '\0' || command[6] == ' '))
+    {
+        unsigned long steps = command[6] == ' ' ? strtoul(command + 7, NULL, 10) : 1;
+        SNAPSHOT_RESULT result = snapshot_rewind((uint16_t)(steps > 0xFFFF ? 0xFFFF : steps));
+        if (result == SNAPSHOT_OK)
+        {
+            snapshot_position(&current, &count);
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                          "\r\nRewound to checkpoint %ld of %u at %04X - CPU STOPPED", (long)current,
+                                          count - 1, cpu.registers.pc);
+        }
+        else
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%s", snapshot_result_text(result));
+        }
+    }
+    else if (strcmp(command, "CHECKPOINT") == 0)
+    {
+        uint32_t length = 0;
+        SNAPSHOT_RESULT result = snapshot_checkpoint(&length);
+        if (result == SNAPSHOT_OK)
+        {
+            // A journal that could not be continued starts over with a full snapshot
+            snapshot_position(&current, &count);
+            if (current == 0)
+            {
+                msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                              "\r\nSnapshot saved at %04X, %lu bytes (new journal)", cpu.registers.pc,
+                                              (unsigned long)length);
+            }
+            else
+            {
+                msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\nCheckpoint %ld saved at %04X, %lu bytes",
+                                              (long)current, cpu.registers.pc, (unsigned long)length);
+            }
+        }
+        else
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%s", snapshot_result_text(result));
+        }
+    }
+    else if (strcmp(command, "RESTORE") == 0)
+    {
+        SNAPSHOT_RESULT result = snapshot_restore();
+        if (result == SNAPSHOT_OK)
+        {
+            cpu_state_set_mode(CPU_RUNNING);
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                          "\r\n*** SNAPSHOT RESTORED AT %04X - CPU RUNNING ***\r\n", cpu.registers.pc);
+            monitor_write(panel_info, msg_length);
+            return;
+        }
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%s", snapshot_result_text(result));
+    }
+    else if (strcmp(command, "SNAPSHOT DELETE") == 0)
+    {
+        SNAPSHOT_RESULT result = snapshot_delete();
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%s",
+                                      result == SNAPSHOT_OK ? "Snapshot deleted" : snapshot_result_text(result));
+    }
+    else if (strcmp(command, "SNAPSHOT") == 0)
+    {
+        uint32_t length = 0;
+        SNAPSHOT_RESULT result = snapshot_save(&length);
+        if (result == SNAPSHOT_OK)
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\nSnapshot saved at %04X, %lu bytes",
+                                          cpu.registers.pc, (unsigned long)length);
+        }
+        else
+        {
+            msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%s", snapshot_result_text(result));
+        }
+    }
+    else
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\nUsage: SNAPSHOT | SNAPSHOT DELETE | CHECKPOINT | RESTORE | REWIND [n]");
+    }
+    monitor_write(panel_info, msg_length);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// L <n>: list n instructions from the switch address, one line each, and leave the switches
+// after the last one so the next L <n> carries on
+static void disassemble_bulk(uint32_t count)
+{
+    uint16_t address = bus_switches;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t instruction_length = 0;
+        char* line = monitor_reserve(MONITOR_LINE_MAX);
+        monitor_commit(i8080_format_listing(line, address, &instruction_length));
+        address = (uint16_t)(address + instruction_length);
+    }
+    bus_switches = address;
+    i8080_examine(&cpu, bus_switches);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// T <n>: execute n instructions from the switch address, listing each with the registers it left
+static void trace_bulk(uint32_t count)
+{
+    i8080_examine(&cpu, bus_switches);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t instruction_length = 0;
+        char* line = monitor_reserve(MONITOR_LINE_MAX);
+        size_t length = i8080_format_listing(line, cpu.registers.pc, &instruction_length);
+        i8080_cycle(&cpu);
+
+        const registers_t* r = &cpu.registers;
+        length += (size_t)snprintf(line + length, MONITOR_LINE_MAX - length,
+                                   "%*sA=%02X F=%02X BC=%04X DE=%04X HL=%04X SP=%04X",
+                                   length < 36 ? (int)(36 - length) : 1, "", r->a, r->flags, r->bc, r->de, r->hl,
+                                   r->sp);
+        monitor_commit(length);
+    }
+    bus_switches = cpu.registers.pc;
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// HISTORY [n] decodes the last n (default 32) instructions of the execution history, oldest
+// first, with the A, flags and SP each one started with. The high byte of a recorded three-byte
+// instruction is read from memory now. HISTORY ON / OFF starts and stops recording, HISTORY CLEAR
+// forgets it.
+static void process_history_command(const char* command)
+{
+    const i8080_trace_t* history = i8080_trace_get();
+    const char* arg = command + 7;
+    while (*arg == ' ')
+    {
+        arg++;
+    }
+    size_t msg_length;
+
+    if (history == NULL)
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Not enabled, build with -DALTAIR_TRACE=ON",
+                                      "History");
+    }
+    else if (strcmp(arg, "ON") == 0 || strcmp(arg, "OFF") == 0)
+    {
+        i8080_trace_enable(arg[1] == 'N');
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Recording %s", "History", arg);
+    }
+    else if (strcmp(arg, "CLEAR") == 0)
+    {
+        i8080_trace_clear();
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Cleared", "History");
+    }
+    else
+    {
+        uint32_t recorded = history->head < I8080_TRACE_ENTRIES ? history->head : I8080_TRACE_ENTRIES;
+        uint32_t count = *arg != '\0' ? (uint32_t)strtoul(arg, NULL, 0) : 32;
+        if (count > recorded)
+        {
+            count = recorded;
+        }
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Last %lu of %lu instructions%s",
+                                      "History", (unsigned long)count, (unsigned long)history->head,
+                                      history->enabled ? "" : ", recording off");
+        monitor_write(panel_info, msg_length);
+
+        for (uint32_t index = history->head - count; index != history->head; index++)
+        {
+            const i8080_trace_entry_t* entry = &history->entries[index & (I8080_TRACE_ENTRIES - 1)];
+            uint8_t bytes[3] = {entry->opcode, entry->operand, read8(&memory_main, (uint16_t)(entry->pc + 2))};
+            uint8_t instruction_length = 0;
+            char* line = monitor_reserve(MONITOR_LINE_MAX);
+            size_t length = i8080_format_instruction(line, entry->pc, bytes, &instruction_length);
+            length += (size_t)snprintf(line + length, MONITOR_LINE_MAX - length, "%*sA=%02X F=%02X SP=%04X",
+                                       length < 36 ? (int)(36 - length) : 1, "", entry->a, entry->flags,
+                                       entry->sp);
+            monitor_commit(length);
+        }
+        monitor_write("\r\nCPU MONITOR> ", 15);
+        return;
+    }
+    monitor_write(panel_info, msg_length);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// Lists the set addresses of a breakpoint bitmap, runs of addresses as one range
+static void list_break_map(const char* label, const uint32_t* map, uint32_t count)
+{
+    size_t msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: %lu", label,
+                                         (unsigned long)count);
+    monitor_write(panel_info, msg_length);
+
+    uint32_t address = 0;
+    while (address <= 0xFFFF)
+    {
+        if (!i8080_break_test(map, (uint16_t)address))
+        {
+            address++;
+            continue;
+        }
+        uint32_t end = address;
+        while (end < 0xFFFF && i8080_break_test(map, (uint16_t)(end + 1)))
+        {
+            end++;
+        }
+        msg_length = end == address
+                         ? (size_t)snprintf(panel_info, sizeof(panel_info), " %04lX", (unsigned long)address)
+                         : (size_t)snprintf(panel_info, sizeof(panel_info), " %04lX-%04lX", (unsigned long)address,
+                                            (unsigned long)end);
+        monitor_write(panel_info, msg_length);
+        address = end + 1;
+    }
+}
+
+// BREAK <addr> stops the CPU before the instruction at addr, WATCH <addr> [length] after an
+// instruction writes to [addr, addr + length). Addresses are hex. BREAK CLEAR [addr] and
+// WATCH CLEAR [addr [length]] remove one or all; BREAK or WATCH alone lists both.
+static void process_break_command(const char* command)
+{
+    bool watch = command[0] == 'W';
+    const char* arg = command + 5;
+    size_t msg_length;
+
+    if (i8080_break_get() == NULL)
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info),
+                                      "\r\n%14s: Not enabled, build with -DALTAIR_BREAKPOINTS=ON", "Breakpoints");
+        monitor_write(panel_info, msg_length);
+        monitor_write("\r\nCPU MONITOR> ", 15);
+        return;
+    }
+
+    while (*arg == ' ')
+    {
+        arg++;
+    }
+    bool clear = strncmp(arg, "CLEAR", 5) == 0;
+    if (clear)
+    {
+        arg += 5;
+    }
+
+    char* end;
+    unsigned long address = strtoul(arg, &end, 16);
+    bool has_address = end != arg && address <= 0xFFFF;
+    unsigned long length = has_address ? strtoul(end, NULL, 0) : 0;
+    if (length == 0)
+    {
+        length = 1;
+    }
+
+    if (clear && !has_address)
+    {
+        i8080_break_clear(watch ? I8080_BREAK_WRITE : I8080_BREAK_PC);
+    }
+    else if (has_address && watch)
+    {
+        i8080_break_set_write((uint16_t)address, (uint32_t)length, !clear);
+    }
+    else if (has_address)
+    {
+        i8080_break_set_pc((uint16_t)address, !clear);
+    }
+    else if (*arg != '\0')
+    {
+        msg_length = (size_t)snprintf(panel_info, sizeof(panel_info), "\r\n%14s: Expected a hex address",
+                                      watch ? "Watch" : "Break");
+        monitor_write(panel_info, msg_length);
+    }
+
+    const i8080_break_t* breaks = i8080_break_get();
+    list_break_map("Breakpoints", breaks->pc, breaks->pc_count);
+    list_break_map("Watchpoints", breaks->write, breaks->write_count);
+    monitor_write("\r\nCPU MONITOR> ", 15);
+}
+
+// Count argument of L <n> and T <n>, 0 if there is none
+static uint32_t command_count(const char* command)
+{
+    const char* arg = command + 1;
+    while (*arg == ' ')
+    {
+        arg++;
+    }
+    return (uint32_t)strtoul(arg, NULL, 0);
+}
+
+static void run_monitor_command(const char* command, const char* text, size_t len)
 {
     if (len == 0)
     {
-        publish_message("\r\nCPU MONITOR> ", 15);
+        monitor_write("\r\nCPU MONITOR> ", 15);
         return;
     }
 
@@ -117,6 +922,17 @@ void process_virtual_input(const char* command, size_t len)
         cmd_switches = TRACE;
         process_control_panel_commands();
     }
+    else if ((command[0] == 'L' || command[0] == 'T') && command[1] == ' ' && command_count(command) != 0)
+    {
+        if (command[0] == 'L')
+        {
+            disassemble_bulk(command_count(command));
+        }
+        else
+        {
+            trace_bulk(command_count(command));
+        }
+    }
     else if (strcmp(command, "R") == 0)
     {
         cmd_switches = RESET;
@@ -132,121 +948,121 @@ void process_virtual_input(const char* command, size_t len)
         cmd_switches = RUN_CMD;
         process_control_panel_commands();
     }
+    else if (strncmp(command, "CLOCK", 5) == 0)
+    {
+        process_clock_command(command);
+    }
+    else if (strncmp(command, "BAUD", 4) == 0)
+    {
+        process_baud_command(command);
+    }
+    else if (strncmp(command, "PROFILE", 7) == 0)
+    {
+        process_profile_command(command);
+    }
+    else if (strncmp(command, "HEATMAP", 7) == 0)
+    {
+        process_heatmap_command(command);
+    }
+    else if (strncmp(command, "BREAK", 5) == 0 || strncmp(command, "WATCH", 5) == 0)
+    {
+        process_break_command(command);
+    }
+    else if (strncmp(command, "HISTORY", 7) == 0)
+    {
+        process_history_command(command);
+    }
+    else if (strcmp(command, "STATS") == 0)
+    {
+        process_stats_command();
+    }
+    else if (strcmp(command, "SYNC") == 0)
+    {
+        process_sync_command();
+    }
+    else if (strcmp(command, "DISKS") == 0 || strncmp(command, "MOUNT", 5) == 0)
+    {
+        process_mount_command(command);
+    }
+    else if (strncmp(command, "FETCH", 5) == 0 && (command[5] == '\0' || command[5] == ' '))
+    {
+        process_fetch_command(command, text);
+    }
+    else if (strncmp(command, "SNAPSHOT", 8) == 0 || strcmp(command, "RESTORE") == 0 ||
+             strcmp(command, "CHECKPOINT") == 0 || strncmp(command, "REWIND", 6) == 0)
+    {
+        process_snapshot_command(command);
+    }
     else
     {
         process_virtual_switches(command);
-        publish_message("\r\nCPU MONITOR> ", 15);
+        monitor_write("\r\nCPU MONITOR> ", 15);
     }
 }
 
-void disassemble(intel8080_t* cpu)
+// Monitor commands run on core 0, their output leaves in whole batches once the command is done
+void process_virtual_input(const char* command, size_t len)
 {
-    char address_bus_high_byte[9];
-    char address_bus_low_byte[9];
-    char data_bus_binary[9];
-    uint8_t instruction_length = 0;
-
-    for (size_t instruction_count = 0; instruction_count < 20; instruction_count++)
+    char upper[MONITOR_COMMAND_MAX];
+    size_t n = len < sizeof(upper) - 1 ? len : sizeof(upper) - 1;
+    for (size_t i = 0; i < n; i++)
     {
-        uint8_to_binary((uint8_t)(cpu->address_bus >> 8), address_bus_high_byte, sizeof(address_bus_high_byte));
-        uint8_to_binary((uint8_t)(cpu->address_bus), address_bus_low_byte, sizeof(address_bus_low_byte));
-        uint8_to_binary(cpu->data_bus, data_bus_binary, sizeof(data_bus_binary));
-
-        size_t msg_length = (size_t)snprintf(
-            panel_info, sizeof(panel_info), "\r\n%14s: Addr bus: %s%s (0x%04x), Data bus %s (0x%02x), %-12s  %dB",
-            "Disasm", address_bus_high_byte, address_bus_low_byte, cpu->address_bus, data_bus_binary, cpu->data_bus,
-            get_i8080_instruction_name(cpu->data_bus, &instruction_length), instruction_length);
+        upper[i] = (char)toupper((unsigned char)command[i]);
+    }
+    upper[n] = '\0';
 
-        publish_message(panel_info, msg_length);
+    run_monitor_command(upper, command, n);
+    monitor_flush();
+}
 
-        for (size_t i = 1; i < instruction_length; i++)
-        {
-            i8080_examine_next(cpu);
+// Bus line for an opcode fetch followed by one for each of its operand bytes
+static void write_instruction_fetches(intel8080_t* cpu, const char* label)
+{
+    uint8_t instruction_length = 0;
+    get_i8080_instruction_name(cpu->data_bus, &instruction_length);
 
-            uint8_to_binary((uint8_t)(cpu->address_bus >> 8), address_bus_high_byte, sizeof(address_bus_high_byte));
-            uint8_to_binary((uint8_t)(cpu->address_bus), address_bus_low_byte, sizeof(address_bus_low_byte));
-            uint8_to_binary(cpu->data_bus, data_bus_binary, sizeof(data_bus_binary));
+    char* line = monitor_reserve(MONITOR_LINE_MAX);
+    monitor_commit(i8080_format_bus_line(line, label, cpu->address_bus, cpu->data_bus, true));
 
-            msg_length = (size_t)snprintf(
-                panel_info, sizeof(panel_info), "\r\n%14s: Addr bus: %s%s (0x%04x), Data bus %s (0x%02x)", "Disasm",
-                address_bus_high_byte, address_bus_low_byte, cpu->address_bus, data_bus_binary, cpu->data_bus);
+    for (size_t i = 1; i < instruction_length; i++)
+    {
+        i8080_examine_next(cpu);
+        line = monitor_reserve(MONITOR_LINE_MAX);
+        monitor_commit(i8080_format_bus_line(line, label, cpu->address_bus, cpu->data_bus, false));
+    }
+}
 
-            publish_message(panel_info, msg_length);
-        }
+void disassemble(intel8080_t* cpu)
+{
+    for (size_t instruction_count = 0; instruction_count < 20; instruction_count++)
+    {
+        write_instruction_fetches(cpu, "Disasm");
         i8080_examine_next(cpu);
     }
     i8080_examine(cpu, bus_switches);
     bus_switches = cpu->address_bus;
-    publish_message("\n\rCPU MONITOR> ", 15);
+    monitor_write("\n\rCPU MONITOR> ", 15);
 }
 
 void trace(intel8080_t* cpu)
 {
-    char address_bus_high_byte[9];
-    char address_bus_low_byte[9];
-    char data_bus_binary[9];
-    uint8_t instruction_length = 0;
-    // uint16_t old_address_bus;
-
-    // Note: Pico SDK stdio is already unbuffered by default
     i8080_cycle(cpu);
 
     for (size_t instruction_count = 0; instruction_count < 20; instruction_count++)
     {
-        uint8_to_binary((uint8_t)(cpu->address_bus >> 8), address_bus_high_byte, sizeof(address_bus_high_byte));
-        uint8_to_binary((uint8_t)(cpu->address_bus), address_bus_low_byte, sizeof(address_bus_low_byte));
-        uint8_to_binary(cpu->data_bus, data_bus_binary, sizeof(data_bus_binary));
-
-        size_t msg_length = (size_t)snprintf(
-            panel_info, sizeof(panel_info), "\r\n%14s: Addr bus: %s%s (0x%04x), Data bus %s (0x%02x), %-12s  %dB",
-            "Trace", address_bus_high_byte, address_bus_low_byte, cpu->address_bus, data_bus_binary, cpu->data_bus,
-            get_i8080_instruction_name(cpu->data_bus, &instruction_length), instruction_length);
-
-        publish_message(panel_info, msg_length);
-
-        // old_address_bus = cpu->address_bus;
-
-        for (size_t i = 1; i < instruction_length; i++)
-        {
-            i8080_examine_next(cpu);
-
-            uint8_to_binary((uint8_t)(cpu->address_bus >> 8), address_bus_high_byte, sizeof(address_bus_high_byte));
-            uint8_to_binary((uint8_t)(cpu->address_bus), address_bus_low_byte, sizeof(address_bus_low_byte));
-            uint8_to_binary(cpu->data_bus, data_bus_binary, sizeof(data_bus_binary));
-
-            msg_length = (size_t)snprintf(
-                panel_info, sizeof(panel_info), "\r\n%14s: Addr bus: %s%s (0x%04x), Data bus %s (0x%02x)", "Trace",
-                address_bus_high_byte, address_bus_low_byte, cpu->address_bus, data_bus_binary, cpu->data_bus);
-
-            publish_message(panel_info, msg_length);
-        }
-        // i8080_examine(cpu, old_address_bus);
+        write_instruction_fetches(cpu, "Trace");
         i8080_examine_next(cpu);
         i8080_cycle(cpu);
     }
     bus_switches = cpu->address_bus;
-    publish_message("\n\rCPU MONITOR> ", 15);
+    monitor_write("\n\rCPU MONITOR> ", 15);
 }
 
 void publish_cpu_state(char* command, uint16_t address_bus, uint8_t data_bus)
 {
-    char address_bus_high_byte[9];
-    char address_bus_low_byte[9];
-    char data_bus_binary[9];
-    uint8_t instruction_length = 0;
-
-    uint8_to_binary((uint8_t)(address_bus >> 8), address_bus_high_byte, sizeof(address_bus_high_byte));
-    uint8_to_binary((uint8_t)(address_bus), address_bus_low_byte, sizeof(address_bus_low_byte));
-    uint8_to_binary(data_bus, data_bus_binary, sizeof(data_bus_binary));
-
-    size_t msg_length =
-        (size_t)snprintf(panel_info, sizeof(panel_info),
-                         "\r\n%14s: Addr bus: %s%s (0x%04x), Data bus %s (0x%02x), %-12s  %dB\n\rCPU "
-                         "MONITOR> ",
-                         command, address_bus_high_byte, address_bus_low_byte, address_bus, data_bus_binary, data_bus,
-                         get_i8080_instruction_name(data_bus, &instruction_length), instruction_length);
-
-    publish_message((const char*)panel_info, msg_length);
+    char* line = monitor_reserve(MONITOR_LINE_MAX);
+    monitor_commit(i8080_format_bus_line(line, command, address_bus, data_bus, true));
+    monitor_write("\n\rCPU MONITOR> ", 15);
 }
 
 /// <summary>
@@ -291,12 +1107,12 @@ void altair_panel_command_handler(void)
         case RESET:
             altair_reset();
             cpu_state_set_mode(CPU_RUNNING);
-            publish_message("\r\n*** RESET - CPU RUNNING ***\r\n", 32);
+            monitor_write("\r\n*** RESET - CPU RUNNING ***\r\n", 32);
             break;
         case LOAD_ALTAIR_BASIC:
-            memset(memory, 0x00, 64 * 1024); // clear altair memory
-            load8kRom(0x0000);               // load Altair BASIC at 0x0000
-            publish_message("\r\n*** Altair BASIC Loaded ***\r\n", 32);
+            memory_reset(&memory_main);      // clear altair memory
+            load8kRom(&memory_main, 0x0000); // load Altair BASIC at 0x0000
+            monitor_write("\r\n*** Altair BASIC Loaded ***\r\n", 32);
             i8080_examine(&cpu, 0x0000); // 0x0000 loads Altair BASIC
             cpu_state_set_mode(CPU_RUNNING);
             break;
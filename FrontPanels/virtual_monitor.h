@@ -27,6 +27,10 @@ typedef enum
     RUN_CMD = 11
 } ALTAIR_COMMAND;
 
+// Longest monitor command line, FETCH takes a URL. Commands are matched in upper case, the
+// URL is passed on as typed.
+#define MONITOR_COMMAND_MAX 300
+
 extern intel8080_t cpu;
 extern uint8_t memory[64 * 1024];
 extern ALTAIR_COMMAND cmd_switches;
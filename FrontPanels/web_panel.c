@@ -0,0 +1,131 @@
+/* Browser front panel for Altair 8800 Emulator
+ * Samples the state published by core 0 and delta encodes it for WebSocket clients
+ */
+
+#include "web_panel.h"
+
+#include <string.h>
+
+web_panel_state_t web_panel_slots[2];
+volatile uint32_t web_panel_published = 0;
+
+// Core 1 state
+static web_panel_state_t samples[WEB_PANEL_BATCH];
+static uint8_t sample_count = 0;
+static uint32_t next_sample_us = 0;
+static bool started = false;
+
+static uint8_t record[WEB_PANEL_RECORD_MAX];
+static size_t record_length = 0;
+static web_panel_state_t last_sent[WEB_PANEL_BATCH];
+static uint32_t last_sent_us = 0;
+
+void web_panel_read(web_panel_state_t* out)
+{
+    for (;;)
+    {
+        uint32_t published = __atomic_load_n(&web_panel_published, __ATOMIC_ACQUIRE);
+        *out = web_panel_slots[published & 1];
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&web_panel_published, __ATOMIC_RELAXED) == published)
+        {
+            return;
+        }
+    }
+}
+
+static uint8_t* put_sample(uint8_t* p, const web_panel_state_t* previous, const web_panel_state_t* sample)
+{
+    const uint8_t bytes[WEB_PANEL_SAMPLE_SIZE] = {(uint8_t)sample->address, (uint8_t)(sample->address >> 8),
+                                                  sample->data, (uint8_t)sample->status,
+                                                  (uint8_t)(sample->status >> 8)};
+    if (previous == NULL)
+    {
+        memcpy(p, bytes, WEB_PANEL_SAMPLE_SIZE);
+        return p + WEB_PANEL_SAMPLE_SIZE;
+    }
+
+    const uint8_t before[WEB_PANEL_SAMPLE_SIZE] = {(uint8_t)previous->address, (uint8_t)(previous->address >> 8),
+                                                   previous->data, (uint8_t)previous->status,
+                                                   (uint8_t)(previous->status >> 8)};
+    uint8_t* mask = p++;
+    *mask = 0;
+    for (int i = 0; i < WEB_PANEL_SAMPLE_SIZE; i++)
+    {
+        if (bytes[i] != before[i])
+        {
+            *mask |= (uint8_t)(1 << i);
+            *p++ = bytes[i];
+        }
+    }
+    return p;
+}
+
+static void encode_batch(uint32_t now_us)
+{
+    // Nothing moved: only refresh clients that connected since the last record now and then
+    if (memcmp(samples, last_sent, sizeof(samples)) == 0 && now_us - last_sent_us < WEB_PANEL_KEYFRAME_US)
+    {
+        return;
+    }
+
+    uint8_t* p = record;
+    *p++ = WEB_PANEL_BATCH;
+    *p++ = (uint8_t)(WEB_PANEL_SAMPLE_US / 1000);
+    for (int i = 0; i < WEB_PANEL_BATCH; i++)
+    {
+        p = put_sample(p, i == 0 ? NULL : &samples[i - 1], &samples[i]);
+    }
+    record_length = (size_t)(p - record);
+    memcpy(last_sent, samples, sizeof(samples));
+    last_sent_us = now_us;
+}
+
+void web_panel_poll(uint32_t now_us)
+{
+    if (!started)
+    {
+        started = true;
+        next_sample_us = now_us;
+        last_sent_us = now_us - WEB_PANEL_KEYFRAME_US;
+    }
+
+    if ((int32_t)(now_us - next_sample_us) < 0)
+    {
+        return;
+    }
+    next_sample_us += WEB_PANEL_SAMPLE_US;
+    if ((int32_t)(now_us - next_sample_us) >= 0)
+    {
+        next_sample_us = now_us + WEB_PANEL_SAMPLE_US; // Fell behind, do not catch up
+    }
+
+    web_panel_state_t sample;
+    web_panel_read(&sample);
+    memset(&samples[sample_count], 0, sizeof(sample)); // Keep struct padding comparable
+    samples[sample_count].address = sample.address;
+    samples[sample_count].data = sample.data;
+    samples[sample_count].status = sample.status;
+    if (++sample_count == WEB_PANEL_BATCH)
+    {
+        sample_count = 0;
+        encode_batch(now_us);
+    }
+}
+
+bool web_panel_ready(void)
+{
+    return record_length != 0;
+}
+
+size_t web_panel_take(uint8_t* buffer, size_t max_len)
+{
+    size_t length = record_length;
+    if (length == 0 || length > max_len)
+    {
+        return 0;
+    }
+    memcpy(buffer, record, length);
+    record_length = 0;
+    return length;
+}
@@ -0,0 +1,64 @@
+/* Browser front panel for Altair 8800 Emulator
+ * Streams the address, data and status LEDs to WebSocket clients (WS_CHANNEL_PANEL)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Core 1 samples the panel this often and sends WEB_PANEL_BATCH samples per record
+#ifndef WEB_PANEL_SAMPLE_US
+#define WEB_PANEL_SAMPLE_US 10000
+#endif
+#define WEB_PANEL_BATCH 10
+
+// A batch identical to the last one is only sent to refresh new clients, this often
+#define WEB_PANEL_KEYFRAME_US 1000000
+
+// Record payload: sample count, sample interval in ms, then the first sample in full
+// (address lo, address hi, data, status lo, status hi) and every later one as a mask of the
+// WEB_PANEL_CHANGED_* bytes that differ from the sample before, followed by those bytes
+#define WEB_PANEL_CHANGED_ADDRESS_LO 0x01
+#define WEB_PANEL_CHANGED_ADDRESS_HI 0x02
+#define WEB_PANEL_CHANGED_DATA 0x04
+#define WEB_PANEL_CHANGED_STATUS_LO 0x08
+#define WEB_PANEL_CHANGED_STATUS_HI 0x10
+#define WEB_PANEL_SAMPLE_SIZE 5
+#define WEB_PANEL_RECORD_MAX (2 + WEB_PANEL_SAMPLE_SIZE + (WEB_PANEL_BATCH - 1) * (1 + WEB_PANEL_SAMPLE_SIZE))
+
+typedef struct
+{
+    uint16_t address;
+    uint8_t data;
+    uint16_t status; // Status LEDs as on the 2.8" display: CPU status byte, bit 9 INTE
+} web_panel_state_t;
+
+// Two slots, core 0 fills the one not published and then publishes it
+extern web_panel_state_t web_panel_slots[2];
+extern volatile uint32_t web_panel_published;
+
+// Core 0: publish the bus state, a few stores, called once per run batch
+static inline void web_panel_publish(uint16_t address, uint8_t data, uint16_t status)
+{
+    uint32_t next = web_panel_published + 1;
+    web_panel_state_t* slot = &web_panel_slots[next & 1];
+    slot->address = address;
+    slot->data = data;
+    slot->status = status;
+    __atomic_store_n(&web_panel_published, next, __ATOMIC_RELEASE);
+}
+
+// Either core: the last published bus state, retried if core 0 publishes while it is copied
+void web_panel_read(web_panel_state_t* out);
+
+// Core 1: take a sample when one is due
+void web_panel_poll(uint32_t now_us);
+
+// Core 1: true when a batch is waiting to be sent
+bool web_panel_ready(void);
+
+// Core 1: move the waiting batch into buffer as a record payload, returns its length (0 if
+// nothing is waiting or it does not fit into max_len)
+size_t web_panel_take(uint8_t* buffer, size_t max_len);
@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+"""
+Load generator for the Altair 8800 Emulator's WebSocket console and HTTP transfers
+
+Drives a firmware built with -DALTAIR_LOAD_TEST=ON, which serves a fixed workload on the
+console instead of running the 8080:
+- every console byte it receives is echoed back to all clients
+- Ctrl-O, a decimal count and CR sends that many bytes of 64-byte output lines
+- Ctrl-G, a URL and CR fetches the URL through http_get.c and reports "{HTTP bytes ms OK}"
+
+Each session floods the console with tokens "<session.sequence>" as fast as its input credit
+allows and times their echo. Session 0 also asks for bulk output and queues HTTP transfers
+of generated data from a server this tool runs. At the end the tool prints echo latency
+percentiles, output throughput, HTTP throughput, and from the metrics channel the bytes the
+device dropped and how long its CPU core stalled on output.
+
+Protocol (see websocket_console.h): binary messages of records, channel(1) + length(2, LE) +
+payload. Channel 0 is the console, 4 the metrics window, 5 control (credit: 0x02 + limit(4, LE)).
+"""
+
+import argparse
+import asyncio
+import base64
+import os
+import re
+import socket
+import struct
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+CHANNEL_CONSOLE = 0
+CHANNEL_METRICS = 4
+CHANNEL_CONTROL = 5
+CONTROL_CREDIT = 2
+
+LOAD_TEST_OUTPUT = b"\x0f"
+LOAD_TEST_HTTP = b"\x07"
+
+TOKEN = re.compile(rb"<(\d+)\.(\d+)>")
+HTTP_REPORT = re.compile(rb"\{HTTP (\d+) (\d+) (OK|FAILED)\}")
+
+# Metrics record fields, 32-bit little-endian each
+METRIC_FIELDS = ("ips", "tps", "core0_cpu", "core0_display", "core1_busy", "tx_high_water", "rx_high_water",
+                 "http_bytes_per_sec", "dirty_sectors", "rx_dropped", "tx_dropped", "tx_skipped", "tx_stall_ms")
+
+
+class WebSocket:
+    """Just enough of an RFC 6455 client for binary messages"""
+
+    def __init__(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+
+    @classmethod
+    async def connect(cls, host, port):
+        reader, writer = await asyncio.open_connection(host, port)
+        key = base64.b64encode(os.urandom(16)).decode()
+        writer.write((f"GET / HTTP/1.1\r\nHost: {host}:{port}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n").encode())
+        await writer.drain()
+        status = await reader.readline()
+        if b" 101 " not in status:
+            writer.close()
+            raise ConnectionError(f"handshake refused: {status.decode(errors='replace').strip()}")
+        while (await reader.readline()) not in (b"\r\n", b""):
+            pass
+        return cls(reader, writer)
+
+    async def send(self, payload, opcode=0x2):
+        header = bytearray([0x80 | opcode])
+        if len(payload) < 126:
+            header.append(0x80 | len(payload))
+        elif len(payload) < 65536:
+            header += bytes([0x80 | 126]) + struct.pack(">H", len(payload))
+        else:
+            header += bytes([0x80 | 127]) + struct.pack(">Q", len(payload))
+        mask = os.urandom(4)
+        header += mask
+        self.writer.write(bytes(header) + bytes(b ^ mask[i & 3] for i, b in enumerate(payload)))
+        await self.writer.drain()
+
+    async def receive(self):
+        """Next binary message, None once the connection is closed"""
+        while True:
+            head = await self.reader.readexactly(2)
+            length = head[1] & 0x7F
+            if length == 126:
+                length = struct.unpack(">H", await self.reader.readexactly(2))[0]
+            elif length == 127:
+                length = struct.unpack(">Q", await self.reader.readexactly(8))[0]
+            payload = await self.reader.readexactly(length)
+            opcode = head[0] & 0x0F
+            if opcode == 0x8:
+                return None
+            if opcode == 0x9:
+                await self.send(payload, 0xA)
+            elif opcode in (0x1, 0x2):
+                return payload
+
+    def close(self):
+        self.writer.close()
+
+
+def records(message):
+    while len(message) >= 3:
+        channel = message[0]
+        length = message[1] | (message[2] << 8)
+        yield channel, message[3:3 + length]
+        message = message[3 + length:]
+
+
+class Session:
+    def __init__(self, index, args, stats):
+        self.index = index
+        self.args = args
+        self.stats = stats
+        self.ws = None
+        self.limit = 0        # Console bytes the device allows in total
+        self.sent = 0         # Console bytes sent
+        self.sequence = 0
+        self.pending = {}     # Sequence -> send time of tokens not echoed yet
+        self.latencies = []
+        self.received = 0     # Console bytes received
+        self.tail = b""       # End of the console text, a token may continue in the next record
+        self.credit = asyncio.Event()
+
+    async def run(self, deadline):
+        try:
+            self.ws = await WebSocket.connect(self.args.host, self.args.port)
+        except (OSError, ConnectionError) as error:
+            self.stats["refused"].append(f"session {self.index}: {error}")
+            return
+        reader = asyncio.ensure_future(self.read())
+        try:
+            if self.index == 0:
+                await self.commands()
+            await self.flood(deadline)
+            await self.drain()
+        finally:
+            reader.cancel()
+            self.ws.close()
+
+    async def console(self, data):
+        await self.ws.send(bytes([CHANNEL_CONSOLE, len(data) & 0xFF, len(data) >> 8]) + data)
+        self.sent += len(data)
+
+    async def commands(self):
+        await self.wait_credit(64)
+        if self.args.output_bytes:
+            await self.console(LOAD_TEST_OUTPUT + str(self.args.output_bytes).encode() + b"\r")
+        for i in range(self.args.http_count):
+            url = f"http://{self.args.http_host}:{self.args.http_port}/blob/{self.args.http_size}/{i}"
+            await self.wait_credit(len(url) + 2)
+            await self.console(LOAD_TEST_HTTP + url.encode() + b"\r")
+            self.stats["http_requested"] += 1
+
+    async def wait_credit(self, length):
+        while self.limit - self.sent < length:
+            self.credit.clear()
+            await self.credit.wait()
+
+    async def flood(self, deadline):
+        interval = 1.0 / self.args.rate if self.args.rate else 0
+        while time.monotonic() < deadline:
+            try:
+                await asyncio.wait_for(self.wait_credit(16), max(0.01, deadline - time.monotonic()))
+            except asyncio.TimeoutError:
+                break
+            # One token at the set rate, or as many as credit allows in messages of up to 256 bytes
+            room = min(self.limit - self.sent, 256)
+            now = time.monotonic()
+            batch = b""
+            while True:
+                token = b"<%d.%d>" % (self.index, self.sequence)
+                if batch and (interval or len(batch) + len(token) > room):
+                    break
+                self.pending[self.sequence] = now
+                self.sequence += 1
+                batch += token
+            await self.console(batch)
+            if interval:
+                await asyncio.sleep(interval)
+
+    async def drain(self):
+        # Give what is on the way time to come back
+        end = time.monotonic() + self.args.drain
+        while self.pending and time.monotonic() < end:
+            await asyncio.sleep(0.05)
+
+    async def read(self):
+        try:
+            while True:
+                message = await self.ws.receive()
+                if message is None:
+                    return
+                now = time.monotonic()
+                for channel, payload in records(message):
+                    if channel == CHANNEL_CONSOLE:
+                        self.on_console(payload, now)
+                    elif channel == CHANNEL_CONTROL and len(payload) >= 5 and payload[0] == CONTROL_CREDIT:
+                        self.limit = struct.unpack("<I", payload[1:5])[0]
+                        self.credit.set()
+                    elif channel == CHANNEL_METRICS and self.index == 0 and len(payload) >= 4 * len(METRIC_FIELDS):
+                        values = struct.unpack("<%dI" % len(METRIC_FIELDS), payload[:4 * len(METRIC_FIELDS)])
+                        self.stats["metrics"].append(dict(zip(METRIC_FIELDS, values)))
+        except (asyncio.IncompleteReadError, ConnectionError):
+            return
+
+    def on_console(self, payload, now):
+        self.received += len(payload)
+        text = self.tail + payload
+        last = 0
+        for match in TOKEN.finditer(text):
+            last = match.end()
+            if int(match.group(1)) != self.index:
+                continue
+            sent = self.pending.pop(int(match.group(2)), None)
+            if sent is not None:
+                self.latencies.append(now - sent)
+        if self.index == 0:
+            for match in HTTP_REPORT.finditer(text):
+                last = max(last, match.end())
+                self.stats["http"].append((int(match.group(1)), int(match.group(2)), match.group(3) == b"OK"))
+        # Keep what may be the start of a token or report
+        cut = max(last, len(text) - 32)
+        self.tail = text[cut:]
+
+
+class BlobHandler(BaseHTTPRequestHandler):
+    """GET /blob/<size>[/...] answers size bytes of generated data"""
+    served = 0
+    lock = threading.Lock()
+
+    def do_GET(self):
+        parts = self.path.strip("/").split("/")
+        if len(parts) < 2 or parts[0] != "blob" or not parts[1].isdigit():
+            self.send_error(404)
+            return
+        size = int(parts[1])
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(size))
+        self.end_headers()
+        block = bytes(range(256)) * 16
+        left = size
+        while left > 0:
+            n = min(left, len(block))
+            self.wfile.write(block[:n])
+            left -= n
+        with BlobHandler.lock:
+            BlobHandler.served += size
+
+    def log_message(self, format, *args):
+        pass
+
+
+def local_address(host):
+    """Address of this machine as seen from the device"""
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as probe:
+        probe.connect((host, 9))
+        return probe.getsockname()[0]
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(round(p / 100 * (len(ordered) - 1))))]
+
+
+async def main_async(args):
+    stats = {"refused": [], "metrics": [], "http": [], "http_requested": 0}
+    sessions = [Session(i, args, stats) for i in range(args.sessions)]
+    start = time.monotonic()
+    deadline = start + args.duration
+    await asyncio.gather(*(session.run(deadline) for session in sessions))
+    return sessions, stats, time.monotonic() - start
+
+
+def report(sessions, stats, elapsed):
+    for line in stats["refused"]:
+        print(f"refused     {line}")
+
+    latencies = [latency for session in sessions for latency in session.latencies]
+    sent = sum(session.sequence for session in sessions)
+    lost = sum(len(session.pending) for session in sessions)
+    print(f"sessions    {len(sessions) - len(stats['refused'])} of {len(sessions)} connected, {elapsed:.1f} s")
+    print(f"echo        {len(latencies)} of {sent} tokens returned, {lost} missing")
+    if latencies:
+        print("latency     p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms" %
+              tuple(1000 * percentile(latencies, p) for p in (50, 90, 99, 100)))
+    for session in sessions:
+        if session.ws:
+            print(f"output      session {session.index}: {session.received} bytes, "
+                  f"{session.received / elapsed / 1024:.1f} KB/s")
+
+    if stats["http_requested"]:
+        done = [entry for entry in stats["http"] if entry[2]]
+        total = sum(entry[0] for entry in done)
+        busy = sum(entry[1] for entry in done) / 1000
+        print(f"http        {len(done)} of {stats['http_requested']} transfers ok, {total} bytes, "
+              f"{total / busy / 1024 if busy else 0:.1f} KB/s while transferring, {BlobHandler.served} bytes served")
+
+    if len(stats["metrics"]) >= 2:
+        first, last = stats["metrics"][0], stats["metrics"][-1]
+        delta = {name: (last[name] - first[name]) & 0xFFFFFFFF for name in
+                 ("rx_dropped", "tx_dropped", "tx_skipped", "tx_stall_ms")}
+        high = {name: max(window[name] for window in stats["metrics"]) for name in
+                ("tx_high_water", "rx_high_water", "core1_busy")}
+        print(f"device      input dropped {delta['rx_dropped']} bytes, output dropped {delta['tx_dropped']} bytes, "
+              f"skipped by lagging clients {delta['tx_skipped']} bytes")
+        print(f"device      core 0 stalled on output {delta['tx_stall_ms']} ms, TX high water "
+              f"{high['tx_high_water']}, RX high water {high['rx_high_water']}, core 1 busy up to "
+              f"{high['core1_busy'] / 10:.1f}%")
+    else:
+        print("device      no metrics windows received (firmware without the drop counters?)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="WebSocket and HTTP load generator for Altair 8800 Emulator")
+    parser.add_argument("host", help="Address of the Pico")
+    parser.add_argument("--port", type=int, default=8088, help="WebSocket console port (default: 8088)")
+    parser.add_argument("--sessions", type=int, default=2,
+                        help="Concurrent WebSocket sessions (default: 2, the firmware serves 2, or 4 on RP2350)")
+    parser.add_argument("--duration", type=float, default=10, help="Seconds to flood for (default: 10)")
+    parser.add_argument("--rate", type=float, default=0,
+                        help="Tokens per second per session, 0 floods as fast as credit allows (default: 0)")
+    parser.add_argument("--drain", type=float, default=2, help="Seconds to wait for the last echoes (default: 2)")
+    parser.add_argument("--output-bytes", type=int, default=1 << 20,
+                        help="Bulk output session 0 asks for (default: 1048576)")
+    parser.add_argument("--http-count", type=int, default=4, help="HTTP transfers session 0 queues (default: 4)")
+    parser.add_argument("--http-size", type=int, default=256 * 1024, help="Bytes per HTTP transfer (default: 262144)")
+    parser.add_argument("--http-port", type=int, default=8090, help="Port of the HTTP server run here (default: 8090)")
+    parser.add_argument("--http-host", help="Address the Pico reaches this machine at (default: detected)")
+    args = parser.parse_args()
+
+    server = None
+    if args.http_count:
+        args.http_host = args.http_host or local_address(args.host)
+        server = ThreadingHTTPServer(("0.0.0.0", args.http_port), BlobHandler)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+
+    try:
+        sessions, stats, elapsed = asyncio.run(main_async(args))
+    except KeyboardInterrupt:
+        return 1
+    finally:
+        if server:
+            server.shutdown()
+    report(sessions, stats, elapsed)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,325 @@
+#include "disk_fetch.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+// Downloads go to the SD card, over Wi-Fi
+#if defined(SD_CARD_SUPPORT) && defined(CYW43_WL_GPIO_LED_PIN)
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "Altair8800/pico_88dcdd_sd_card.h"
+#include "PortDrivers/http_get.h"
+
+// The download, written by core 0 before it sets DISK_FETCH_QUEUED and by core 1 until it sets
+// DISK_FETCH_VERIFIED or DISK_FETCH_FAILED
+typedef struct
+{
+    volatile uint8_t state; // DISK_FETCH_STATE
+    volatile bool cancel;   // Core 0 asks core 1 to stop
+    uint8_t drive;
+    bool check_crc;
+    uint32_t expected_crc;
+    uint32_t crc;
+    volatile uint32_t bytes;
+    char url[HTTP_URL_MAX_LEN];
+    char name[SD_DISK_PATH_MAX]; // Image name in SD_DISK_DIR
+    const char* error;
+} disk_fetch_t;
+
+static disk_fetch_t fetch;
+
+// Core 1
+static http_response_stream_t stream;
+static uint8_t stream_buffer[DISK_FETCH_RING_SIZE];
+static queue_t* outbound_queue;
+static FIL file;
+static uint32_t transfer = 0; // Requests sent on stream
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (-(crc & 1)));
+        }
+    }
+    return crc;
+}
+
+// Last part of the URL path, without query or fragment
+static bool url_file_name(const char* url, char* name, size_t name_len)
+{
+    size_t end = strcspn(url, "?#");
+    size_t start = end;
+    while (start > 0 && url[start - 1] != '/')
+    {
+        start--;
+    }
+    if (start == end || start < 3 || url[start - 2] == '/' || end - start >= name_len)
+    {
+        return false; // No path, a bare host or a name that does not fit
+    }
+    memcpy(name, url + start, end - start);
+    name[end - start] = '\0';
+    return true;
+}
+
+bool disk_fetch_start(uint8_t drive, const char* url, bool check_crc, uint32_t crc)
+{
+    uint8_t state = __atomic_load_n(&fetch.state, __ATOMIC_ACQUIRE);
+    if (state == DISK_FETCH_QUEUED || state == DISK_FETCH_RUNNING || state == DISK_FETCH_VERIFIED ||
+        drive >= MAX_DRIVES || strlen(url) >= sizeof(fetch.url) ||
+        !url_file_name(url, fetch.name, sizeof(fetch.name) - sizeof(SD_DISK_DIR)))
+    {
+        return false;
+    }
+
+    fetch.drive = drive;
+    fetch.check_crc = check_crc;
+    fetch.expected_crc = crc;
+    fetch.crc = 0xFFFFFFFF;
+    fetch.bytes = 0;
+    fetch.error = NULL;
+    fetch.cancel = false;
+    snprintf(fetch.url, sizeof(fetch.url), "%s", url);
+    __atomic_store_n(&fetch.state, DISK_FETCH_QUEUED, __ATOMIC_RELEASE);
+    return true;
+}
+
+void disk_fetch_cancel(void)
+{
+    fetch.cancel = true;
+}
+
+// Core 1: give up, keeping nothing of the image
+static void fail(const char* error)
+{
+    f_close(&file);
+    f_unlink(DISK_FETCH_TEMP);
+    fetch.error = error;
+    printf("[FETCH] %s: %s\n", fetch.url, error);
+    __atomic_store_n(&fetch.state, DISK_FETCH_FAILED, __ATOMIC_RELEASE);
+}
+
+// Core 1: create the temporary file and post the request
+static void start_download(void)
+{
+    if (outbound_queue == NULL)
+    {
+        http_response_stream_t* unused;
+        http_get_queues(&outbound_queue, &unused);
+        http_get_stream_init(&stream, stream_buffer, sizeof(stream_buffer));
+    }
+
+    if (f_open(&file, DISK_FETCH_TEMP, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    {
+        fetch.error = "cannot create " DISK_FETCH_TEMP;
+        __atomic_store_n(&fetch.state, DISK_FETCH_FAILED, __ATOMIC_RELEASE);
+        return;
+    }
+
+    http_request_t request;
+    memset(&request, 0, sizeof(request));
+    memcpy(request.url, fetch.url, sizeof(request.url));
+    request.stream = &stream;
+    if (!queue_try_add(outbound_queue, &request))
+    {
+        f_close(&file); // Queue full, tried again on the next poll
+        return;
+    }
+    transfer++;
+    __atomic_store_n(&fetch.state, DISK_FETCH_RUNNING, __ATOMIC_RELEASE);
+}
+
+// Core 1: write what arrived, then check the image once the transfer is complete
+static void receive(void)
+{
+    if (fetch.cancel)
+    {
+        http_request_t request;
+        memset(&request, 0, sizeof(request));
+        request.abort = true;
+        request.stream = &stream;
+        if (queue_try_add(outbound_queue, &request))
+        {
+            fail("cancelled");
+        }
+        return;
+    }
+    if (__atomic_load_n(&stream.started, __ATOMIC_ACQUIRE) != transfer)
+    {
+        return; // Behind a transfer of the guest
+    }
+
+    // Result first, as in http_io.c: once it is final all data is in the ring
+    uint8_t result = __atomic_load_n(&stream.result, __ATOMIC_ACQUIRE);
+    size_t budget = DISK_FETCH_WRITE_SIZE;
+    uint32_t index;
+    const uint8_t* data;
+    size_t n;
+    while (budget > 0 && (n = spsc_ring_peek(&stream.ring, &index, &data, budget)) > 0)
+    {
+        UINT written = 0;
+        if (f_write(&file, data, (UINT)n, &written) != FR_OK || written != n)
+        {
+            fail("card write failed");
+            return;
+        }
+        fetch.crc = crc32_update(fetch.crc, data, n);
+        fetch.bytes += (uint32_t)n;
+        spsc_ring_consume(&stream.ring, index, n);
+        budget -= n;
+    }
+
+    if (result == HTTP_WG_WAITING || spsc_ring_level(&stream.ring) != 0)
+    {
+        return;
+    }
+    if (result != HTTP_WG_EOF)
+    {
+        fail("download failed");
+        return;
+    }
+    if (f_close(&file) != FR_OK)
+    {
+        fail("card write failed");
+        return;
+    }
+    fetch.crc = ~fetch.crc;
+    if (fetch.bytes == 0)
+    {
+        fail("empty image");
+        return;
+    }
+    if (fetch.check_crc && fetch.crc != fetch.expected_crc)
+    {
+        fail("CRC mismatch");
+        return;
+    }
+    __atomic_store_n(&fetch.state, DISK_FETCH_VERIFIED, __ATOMIC_RELEASE);
+}
+
+void disk_fetch_core1_poll(void)
+{
+    uint8_t state = __atomic_load_n(&fetch.state, __ATOMIC_ACQUIRE);
+    if (state == DISK_FETCH_QUEUED)
+    {
+        start_download();
+    }
+    else if (state == DISK_FETCH_RUNNING)
+    {
+        receive();
+    }
+}
+
+typedef struct
+{
+    const char* path;
+    bool ok;
+} disk_fetch_install_t;
+
+// Replace the image by the download, run by sd_disk_io_call
+static void install_image(void* arg)
+{
+    disk_fetch_install_t* install = arg;
+    FRESULT fr = f_unlink(install->path);
+    install->ok = (fr == FR_OK || fr == FR_NO_FILE) && f_rename(DISK_FETCH_TEMP, install->path) == FR_OK;
+}
+
+void disk_fetch_poll(void)
+{
+    if (__atomic_load_n(&fetch.state, __ATOMIC_ACQUIRE) != DISK_FETCH_VERIFIED)
+    {
+        return;
+    }
+
+    char path[SD_DISK_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", SD_DISK_DIR, fetch.name);
+
+    // An open image cannot be replaced: the target drive lets go of it, another drive keeps it
+    for (uint8_t drive = 0; drive < MAX_DRIVES; drive++)
+    {
+        const char* image = sd_disk_image(drive);
+        if (image == NULL || strcasecmp(image, path) != 0)
+        {
+            continue;
+        }
+        if (drive != fetch.drive)
+        {
+            fetch.error = "image in use by another drive";
+            __atomic_store_n(&fetch.state, DISK_FETCH_FAILED, __ATOMIC_RELEASE);
+            return;
+        }
+        sd_disk_eject(drive);
+    }
+
+    disk_fetch_install_t install = {.path = path};
+    sd_disk_io_call(install_image, &install);
+    if (!install.ok)
+    {
+        fetch.error = "cannot rename " DISK_FETCH_TEMP;
+    }
+    else if (!sd_disk_mount(fetch.drive, fetch.name))
+    {
+        fetch.error = "cannot mount the image";
+    }
+    __atomic_store_n(&fetch.state, fetch.error == NULL ? DISK_FETCH_DONE : DISK_FETCH_FAILED, __ATOMIC_RELEASE);
+}
+
+size_t disk_fetch_describe(char* buffer, size_t buffer_length)
+{
+    static const char* const states[] = {"idle", "waiting", "downloading", "installing", "mounted", "failed"};
+    uint8_t state = __atomic_load_n(&fetch.state, __ATOMIC_ACQUIRE);
+    if (state == DISK_FETCH_IDLE)
+    {
+        return (size_t)snprintf(buffer, buffer_length, "No download");
+    }
+
+    int len = snprintf(buffer, buffer_length, "%c: %s %lu bytes, %s", 'A' + fetch.drive, fetch.name,
+                       (unsigned long)fetch.bytes, states[state]);
+    if (state == DISK_FETCH_FAILED && fetch.error != NULL && len >= 0 && (size_t)len < buffer_length)
+    {
+        len += snprintf(buffer + len, buffer_length - (size_t)len, " (%s)", fetch.error);
+    }
+    else if (state == DISK_FETCH_DONE && len >= 0 && (size_t)len < buffer_length)
+    {
+        len += snprintf(buffer + len, buffer_length - (size_t)len, ", CRC-32 %08lX", (unsigned long)fetch.crc);
+    }
+    return len < 0 ? 0 : (size_t)len;
+}
+
+#else
+
+#include <stdio.h>
+
+bool disk_fetch_start(uint8_t drive, const char* url, bool check_crc, uint32_t crc)
+{
+    (void)drive;
+    (void)url;
+    (void)check_crc;
+    (void)crc;
+    return false;
+}
+
+void disk_fetch_cancel(void)
+{
+}
+
+void disk_fetch_poll(void)
+{
+}
+
+void disk_fetch_core1_poll(void)
+{
+}
+
+size_t disk_fetch_describe(char* buffer, size_t buffer_length)
+{
+    return (size_t)snprintf(buffer, buffer_length, "Not available, SD card builds on boards with Wi-Fi only");
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Disk image download, SD card builds on boards with Wi-Fi. Core 1 fetches the image through
+// http_get.c into DISK_FETCH_TEMP on the card while the emulation keeps running, checks its
+// CRC-32 and renames it into SD_DISK_DIR under the last part of the URL path; core 0 then mounts
+// it into the drive. The guest's HTTP transfers wait while the download is running, and the
+// download waits for a transfer of the guest that is already running.
+#define DISK_FETCH_TEMP "Disks/fetch.tmp"
+
+// Response ring of the download, the TCP window closes when the card falls behind
+#define DISK_FETCH_RING_SIZE 4096
+
+// Most written to the card per core 1 poll, so the network is not held up for long
+#define DISK_FETCH_WRITE_SIZE 2048
+
+typedef enum
+{
+    DISK_FETCH_IDLE = 0,
+    DISK_FETCH_QUEUED,   // Core 0 has handed core 1 a download
+    DISK_FETCH_RUNNING,  // Core 1 is writing the image to DISK_FETCH_TEMP
+    DISK_FETCH_VERIFIED, // Complete and checked, core 0 has it to install and mount
+    DISK_FETCH_DONE,
+    DISK_FETCH_FAILED
+} DISK_FETCH_STATE;
+
+/**
+ * Start downloading url into the drive
+ * Called from Core 0
+ *
+ * @param drive Drive to mount the image into once it is on the card
+ * @param url http:// URL of the image
+ * @param check_crc Compare the image with crc
+ * @param crc CRC-32 (as zlib and cksfv compute it) of the whole image
+ * @return false while a download is running, or when the URL does not end in a file name
+ */
+bool disk_fetch_start(uint8_t drive, const char* url, bool check_crc, uint32_t crc);
+
+/**
+ * Stop the running download, the drive keeps its image
+ * Called from Core 0
+ */
+void disk_fetch_cancel(void);
+
+/**
+ * Install and mount a verified download
+ * Called from Core 0's main loop
+ */
+void disk_fetch_poll(void);
+
+/**
+ * Write received image data to the card
+ * Called from Core 1's main loop, after sd_disk_service_poll()
+ */
+void disk_fetch_core1_poll(void);
+
+/**
+ * Describe the last download in one line
+ * Called from Core 0
+ *
+ * @param buffer Output buffer
+ * @param buffer_length Size of buffer
+ * @return Length of the text
+ */
+size_t disk_fetch_describe(char* buffer, size_t buffer_length);
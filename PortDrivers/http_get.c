@@ -6,203 +6,574 @@
 #if defined(CYW43_WL_GPIO_LED_PIN)
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
-#include "lwip/altcp.h"
-#include "lwip/apps/http_client.h"
 #include "lwip/dns.h"
 #include "lwip/err.h"
+#include "lwip/ip_addr.h"
 #include "lwip/pbuf.h"
+#include "lwip/tcp.h"
 #include "pico/cyw43_arch.h"
 #include "pico/time.h"
+#include "wifi_power.h"
 
 // Queue sizes
 #define OUTBOUND_QUEUE_SIZE 4
-#define INBOUND_QUEUE_SIZE 2 // Small queue creates TCP backpressure
 
-// Queues for inter-core communication
-static queue_t outbound_queue; // Core 0 -> Core 1
-static queue_t inbound_queue;  // Core 1 -> Core 0
+// Connection to the endpoint of the last request (Core 1). Once a response is complete the
+// connection stays open for the next request to the same host and port, so a run of gf
+// transfers pays DNS, the TCP handshake and slow start only once. Name lookups go through the
+// lwIP DNS table (DNS_TABLE_SIZE), which answers repeated lookups from its cache.
+typedef struct
+{
+    struct tcp_pcb* pcb;
+    char host[HTTP_HOST_MAX_LEN];
+    u16_t port;
+    ip_addr_t addr;
+    uint32_t generation; // Counts connections, so a late DNS answer for an old one is ignored
+    bool connected;      // Handshake done
+    bool busy;           // A request is out and its response not complete
+    bool reusable;       // The server keeps the connection open after the response
+    bool remote_closed;  // The server closed or reset the connection
+    uint32_t requests;   // Sent on this connection
+    uint32_t idle_since_ms;
+} http_connection_t;
+
+// Inter-core communication
+static queue_t outbound_queue;          // Core 0 -> Core 1
+static http_response_stream_t response; // Core 1 -> Core 0
+static uint8_t response_buffer[HTTP_RX_RING_SIZE];
 
 // State variables
 static http_transfer_state_t transfer_state;
+static http_connection_t connection;
 
 // === CORE 1: HTTP Client ===
 
-// lwIP HTTP client callback: receive data
-static err_t http_recv_callback(void* arg, struct altcp_pcb* conn, struct pbuf* p, err_t err)
+static uint32_t now_ms(void)
 {
-    http_transfer_state_t* state = (http_transfer_state_t*)arg;
+    return to_ms_since_boot(get_absolute_time());
+}
 
-    // Store connection handle for async TCP ACKs in poll loop
-    state->conn = conn;
+// Hand core 0 the end of the transfer once all of its data is in the ring
+static void publish_result(http_transfer_state_t* state)
+{
+    if (state->pending_result && state->pending_pbuf == NULL)
+    {
+        state->pending_result = false;
+        __atomic_store_n(&state->stream->result, state->result, __ATOMIC_RELEASE);
+    }
+}
 
-    if (err != ERR_OK || p == NULL)
+static void drop_pending(http_transfer_state_t* state)
+{
+    if (state->pending_pbuf)
     {
-        if (p != NULL)
+        pbuf_free(state->pending_pbuf);
+        state->pending_pbuf = NULL;
+    }
+}
+
+// Start the response of a new request: nothing of an earlier transfer reaches the guest
+static void start_response(http_response_stream_t* stream)
+{
+    drop_pending(&transfer_state);
+    memset(&transfer_state, 0, sizeof(transfer_state));
+    transfer_state.stream = stream;
+
+    __atomic_store_n(&stream->result, HTTP_WG_WAITING, __ATOMIC_RELEASE);
+    spsc_ring_clear_producer(&stream->ring);
+    __atomic_store_n(&stream->started, stream->started + 1, __ATOMIC_RELEASE);
+}
+
+static void fail_response(void)
+{
+    drop_pending(&transfer_state);
+    transfer_state.transfer_active = false;
+    transfer_state.pending_result = false;
+    transfer_state.rx_state = HTTP_RX_DONE;
+    __atomic_store_n(&transfer_state.stream->result, HTTP_WG_FAILED, __ATOMIC_RELEASE);
+}
+
+// The response is complete, the result follows the data still held in pending_pbuf
+static void finish_response(uint8_t result)
+{
+    transfer_state.rx_state = HTTP_RX_DONE;
+    transfer_state.transfer_active = false;
+    transfer_state.result = result;
+    transfer_state.pending_result = true;
+
+    connection.busy = false;
+    connection.idle_since_ms = now_ms();
+}
+
+// Forget the connection, closing its pcb unless lwIP has freed it already
+static void connection_close(void)
+{
+    if (connection.pcb != NULL)
+    {
+        tcp_arg(connection.pcb, NULL);
+        tcp_recv(connection.pcb, NULL);
+        tcp_err(connection.pcb, NULL);
+        if (tcp_close(connection.pcb) != ERR_OK)
         {
-            pbuf_free(p);
+            tcp_abort(connection.pcb);
         }
-        return err;
+        connection.pcb = NULL;
     }
+    connection.generation++;
+    connection.connected = false;
+    connection.busy = false;
+    connection.reusable = false;
+    connection.remote_closed = false;
+    connection.requests = 0;
+    connection.host[0] = '\0';
+}
 
-    // If we already have a pending pbuf (in-flight data), chain it to avoid
-    // aborting the connection. TCP window should close naturally.
-    if (state->pending_pbuf != NULL)
+static void send_request(void)
+{
+    char request[HTTP_PATH_MAX_LEN + HTTP_HOST_MAX_LEN + 160];
+    const char* method = transfer_state.body != NULL ? "POST" : "GET";
+    int len;
+    if (connection.port == 80)
     {
-        // Chain the new pbuf to the end of existing pending pbuf
-        pbuf_cat(state->pending_pbuf, p);
+        len = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n", method,
+                       transfer_state.path, connection.host);
+    }
+    else
+    {
+        len = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\nHost: %s:%u\r\nConnection: keep-alive\r\n",
+                       method, transfer_state.path, connection.host, connection.port);
+    }
+    if (len > 0 && (size_t)len < sizeof(request))
+    {
+        if (transfer_state.body != NULL)
+        {
+            len += snprintf(request + len, sizeof(request) - (size_t)len,
+                            "Content-Type: text/plain\r\nContent-Length: %u\r\n\r\n",
+                            (unsigned)transfer_state.body_length);
+        }
+        else
+        {
+            len += snprintf(request + len, sizeof(request) - (size_t)len, "\r\n");
+        }
+    }
 
-        // Return ERR_OK to accept the data (but we don't ACK it yet)
-        return ERR_OK;
+    u16_t body_length = transfer_state.body != NULL ? transfer_state.body_length : 0;
+    bool sent = len > 0 && (size_t)len < sizeof(request) && tcp_sndbuf(connection.pcb) >= (uint32_t)len + body_length &&
+                tcp_write(connection.pcb, request, (u16_t)len, TCP_WRITE_FLAG_COPY) == ERR_OK;
+    if (sent && body_length != 0)
+    {
+        sent = tcp_write(connection.pcb, transfer_state.body, body_length, TCP_WRITE_FLAG_COPY) == ERR_OK;
     }
+    if (!sent)
+    {
+        // Closed from http_get_poll, this may run inside an lwIP callback
+        connection.remote_closed = true;
+        fail_response();
+        return;
+    }
+    tcp_output(connection.pcb);
 
-    // Process received data
-    // We try to push as much as possible to the queue
-    struct pbuf* current = p;
-    size_t offset = 0;
+    connection.busy = true;
+    connection.reusable = false; // Until the response says otherwise
+    connection.requests++;
+    transfer_state.rx_state = HTTP_RX_STATUS;
+    transfer_state.last_rx_ms = now_ms();
+}
 
-    // Iterate through pbuf chain
-    while (current != NULL)
+// Case-insensitive match of a header name at the start of line, returns its value
+static const char* header_value(const char* line, const char* name)
+{
+    size_t len = strlen(name);
+    if (strncasecmp(line, name, len) != 0 || line[len] != ':')
     {
-        // Process current pbuf
-        while (offset < current->len)
-        {
-            // Determine how much can fit in current chunk
-            size_t bytes_available = current->len - offset;
-            size_t chunk_space = HTTP_CHUNK_SIZE - state->current_chunk.len;
-            size_t copy_size = (bytes_available > chunk_space) ? chunk_space : bytes_available;
-
-            // Copy to chunk
-            uint8_t* payload = (uint8_t*)current->payload;
-            memcpy(&state->current_chunk.data[state->current_chunk.len], &payload[offset], copy_size);
+        return NULL;
+    }
+    const char* value = line + len + 1;
+    while (*value == ' ' || *value == '\t')
+    {
+        value++;
+    }
+    return value;
+}
 
-            state->current_chunk.len += copy_size;
-            offset += copy_size;
+static bool contains_token(const char* value, const char* token)
+{
+    size_t len = strlen(token);
+    for (; *value != '\0'; value++)
+    {
+        if (strncasecmp(value, token, len) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-            // If chunk is full, send to queue
-            if (state->current_chunk.len >= HTTP_CHUNK_SIZE)
+// Handle one complete status, header, chunk size or trailer line (without its line end)
+static void handle_line(http_transfer_state_t* state, const char* line)
+{
+    switch (state->rx_state)
+    {
+        case HTTP_RX_STATUS:
+        {
+            // "HTTP/1.1 200 OK"; HTTP/1.0 servers only keep the connection when they say so
+            unsigned major = 0;
+            unsigned minor = 0;
+            unsigned code = 0;
+            if (sscanf(line, "HTTP/%u.%u %u", &major, &minor, &code) != 3)
             {
-                state->current_chunk.status = HTTP_WG_DATAREADY;
+                finish_response(HTTP_WG_FAILED);
+                break;
+            }
+            state->status_code = (uint16_t)code;
+            connection.reusable = major > 1 || (major == 1 && minor >= 1);
+            state->rx_state = HTTP_RX_HEADERS;
+            break;
+        }
 
-                // Try to queue non-blocking
-                if (queue_try_add(&inbound_queue, &state->current_chunk))
+        case HTTP_RX_HEADERS:
+        {
+            const char* value;
+            if (line[0] != '\0')
+            {
+                if ((value = header_value(line, "Content-Length")) != NULL)
                 {
-                    // Successfully queued - reset chunk
-                    memset(&state->current_chunk, 0, sizeof(state->current_chunk));
+                    state->body_left = (uint32_t)strtoul(value, NULL, 10);
+                    state->length_known = true;
                 }
-                else
+                else if ((value = header_value(line, "Transfer-Encoding")) != NULL)
                 {
-                    // Queue full - pause and store pbuf for later processing
-                    state->pending_pbuf = p;
-
-                    // Calculate global offset into pbuf chain
-                    size_t total_processed_so_far = 0;
-                    struct pbuf* temp = p;
-                    while (temp != current)
+                    state->chunked = contains_token(value, "chunked");
+                }
+                else if ((value = header_value(line, "Connection")) != NULL)
+                {
+                    if (contains_token(value, "close"))
+                    {
+                        connection.reusable = false;
+                    }
+                    else if (contains_token(value, "keep-alive"))
                     {
-                        total_processed_so_far += temp->len;
-                        temp = temp->next;
+                        connection.reusable = true;
                     }
-                    total_processed_so_far += offset;
-                    state->pending_pbuf_offset = total_processed_so_far;
+                }
+                break;
+            }
 
-                    // Don't ACK unprocessed data - closes TCP window
-                    return ERR_OK;
+            // End of the headers. Only a 2xx body goes to the guest; for anything else the
+            // connection is dropped rather than read to the end.
+            if (state->status_code < 200 || state->status_code >= 300)
+            {
+                connection.reusable = false;
+                finish_response(HTTP_WG_FAILED);
+            }
+            else if (state->status_code == 204)
+            {
+                finish_response(HTTP_WG_EOF);
+            }
+            else if (state->chunked)
+            {
+                state->rx_state = HTTP_RX_CHUNK_SIZE;
+            }
+            else if (state->length_known)
+            {
+                state->rx_state = HTTP_RX_BODY;
+                if (state->body_left == 0)
+                {
+                    finish_response(HTTP_WG_EOF);
                 }
             }
+            else
+            {
+                connection.reusable = false; // The body ends with the connection
+                state->rx_state = HTTP_RX_BODY;
+            }
+            break;
         }
 
-        // Finished this pbuf in chain, move to next
-        current = current->next;
-        offset = 0;
+        case HTTP_RX_CHUNK_SIZE:
+        {
+            char* end;
+            state->body_left = (uint32_t)strtoul(line, &end, 16);
+            if (end == line)
+            {
+                connection.reusable = false;
+                finish_response(HTTP_WG_FAILED);
+            }
+            else
+            {
+                state->rx_state = state->body_left > 0 ? HTTP_RX_CHUNK_DATA : HTTP_RX_TRAILER;
+            }
+            break;
+        }
+
+        case HTTP_RX_CHUNK_END:
+            state->rx_state = HTTP_RX_CHUNK_SIZE;
+            break;
+
+        case HTTP_RX_TRAILER:
+            if (line[0] == '\0')
+            {
+                finish_response(HTTP_WG_EOF);
+            }
+            break;
     }
+}
 
-    // Consumed entire pbuf chain - free and ACK
-    size_t total_bytes = p->tot_len;
-    pbuf_free(p);
-    state->total_bytes_received += total_bytes;
-    altcp_recved(conn, total_bytes);
+// Parse a piece of the response, body bytes go into the ring. Returns the bytes used, fewer
+// than len when the ring is full.
+static size_t parse(http_transfer_state_t* state, const uint8_t* data, size_t len)
+{
+    size_t used = 0;
+    while (used < len)
+    {
+        if (state->rx_state == HTTP_RX_DONE)
+        {
+            return len; // Nothing is pipelined, anything after the response is discarded
+        }
 
-    return ERR_OK;
+        if (state->rx_state == HTTP_RX_BODY || state->rx_state == HTTP_RX_CHUNK_DATA)
+        {
+            size_t n = len - used;
+            bool counted = state->rx_state == HTTP_RX_CHUNK_DATA || state->length_known;
+            if (counted && n > state->body_left)
+            {
+                n = state->body_left;
+            }
+            n = spsc_ring_push(&state->stream->ring, data + used, n);
+            if (n == 0)
+            {
+                break; // Ring full, the rest waits unacknowledged
+            }
+            used += n;
+            state->total_bytes_received += n;
+
+            if (counted)
+            {
+                state->body_left -= (uint32_t)n;
+                if (state->body_left == 0)
+                {
+                    if (state->rx_state == HTTP_RX_CHUNK_DATA)
+                    {
+                        state->rx_state = HTTP_RX_CHUNK_END;
+                    }
+                    else
+                    {
+                        finish_response(HTTP_WG_EOF);
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Line based parts, a line ends with LF and an optional CR before it is dropped
+        char ch = (char)data[used++];
+        if (ch != '\n')
+        {
+            if (state->line_len < sizeof(state->line) - 1)
+            {
+                state->line[state->line_len++] = ch;
+            }
+            continue;
+        }
+        if (state->line_len > 0 && state->line[state->line_len - 1] == '\r')
+        {
+            state->line_len--;
+        }
+        state->line[state->line_len] = '\0';
+        state->line_len = 0;
+        handle_line(state, state->line);
+    }
+    return used;
 }
 
-// lwIP HTTP client callback: headers received
-static err_t http_headers_done_callback(httpc_state_t* connection, void* arg, struct pbuf* hdr, u16_t hdr_len,
-                                        u32_t content_len)
+// Parse pending data as far as the ring has room and ACK what was taken. The rest stays in the
+// pbuf chain, unacknowledged, so the TCP window closes until the guest catches up.
+static void rx_process(http_transfer_state_t* state)
 {
-    (void)connection;
-    (void)hdr;
-    (void)hdr_len;
-    // Headers received - content length available
-    (void)content_len;
-    return ERR_OK;
+    while (state->pending_pbuf != NULL)
+    {
+        struct pbuf* p = state->pending_pbuf;
+        u16_t len = p->len;
+        size_t used = parse(state, (const uint8_t*)p->payload, len);
+        if (used == 0)
+        {
+            break;
+        }
+
+        state->pending_pbuf = pbuf_free_header(p, (u16_t)used);
+        if (connection.pcb != NULL)
+        {
+            tcp_recved(connection.pcb, (u16_t)used);
+        }
+        if (used < len)
+        {
+            break;
+        }
+    }
+    publish_result(state);
+}
+
+// lwIP callback: connection reset, the pcb is already freed
+static void http_err_callback(void* arg, err_t err)
+{
+    (void)arg;
+    (void)err;
+    connection.pcb = NULL;
+    connection.remote_closed = true;
 }
 
-// lwIP HTTP client callback: transfer complete
-static void http_result_callback(void* arg, httpc_result_t httpc_result, u32_t rx_content_len, u32_t srv_res, err_t err)
+// lwIP callback: data received, or the server closed the connection (p == NULL)
+static err_t http_recv_callback(void* arg, struct tcp_pcb* tpcb, struct pbuf* p, err_t err)
 {
-    http_transfer_state_t* state = (http_transfer_state_t*)arg;
+    (void)arg;
 
-    // Prepare final status message (calculated early for both paths)
-    memset(&state->final_status, 0, sizeof(state->final_status));
-    if (httpc_result == HTTPC_RESULT_OK && srv_res >= 200 && srv_res < 300)
+    if (p == NULL || err != ERR_OK)
     {
-        state->final_status.status = HTTP_WG_EOF;
+        if (p != NULL)
+        {
+            pbuf_free(p);
+        }
+        connection.remote_closed = true;
+        return ERR_OK;
     }
-    else
+
+    if (!connection.busy && transfer_state.pending_pbuf == NULL)
     {
-        state->final_status.status = HTTP_WG_FAILED;
+        // Nothing was asked for
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
     }
-    state->final_status.len = 0;
 
-    // If we have pending data frozen in a pbuf (paused), we MUST NOT queue new things yet.
-    // Core 0 must receive the pending pbuf data BEFORE valid EOF.
-    if (state->pending_pbuf != NULL)
+    wifi_power_traffic(); // A download wants the radio awake
+
+    // Data behind a paused chain waits its turn; the TCP window closes naturally
+    transfer_state.rx_seen = true;
+    transfer_state.last_rx_ms = now_ms();
+    if (transfer_state.pending_pbuf != NULL)
+    {
+        pbuf_cat(transfer_state.pending_pbuf, p);
+    }
+    else
     {
-        // Defer sending status until http_get_poll drains the pbuf
-        state->pending_final_status = true;
+        transfer_state.pending_pbuf = p;
+    }
+    rx_process(&transfer_state);
+    return ERR_OK;
+}
 
-        // Note: We do NOT touch current_chunk or set pending_final_chunk here.
-        // The poll loop is actively using current_chunk to drain the pbuf.
-        // It will handle flushing the remainder when the pbuf is empty.
+// lwIP callback: TCP handshake done
+static err_t http_connected_callback(void* arg, struct tcp_pcb* tpcb, err_t err)
+{
+    (void)arg;
+    (void)tpcb;
 
-        state->transfer_active = false;
-        state->transfer_complete = true;
+    if (err != ERR_OK)
+    {
+        connection.remote_closed = true;
+        return ERR_OK;
+    }
+    connection.connected = true;
+    send_request();
+    return ERR_OK;
+}
+
+static void connect_resolved(void)
+{
+    connection.pcb = tcp_new_ip_type(IP_GET_TYPE(&connection.addr));
+    if (connection.pcb == NULL)
+    {
+        connection_close();
+        fail_response();
         return;
     }
 
-    // Normal path (no paused pbuf) - Send final chunk if there's data
-    if (state->current_chunk.len > 0)
+    tcp_recv(connection.pcb, http_recv_callback);
+    tcp_err(connection.pcb, http_err_callback);
+    if (tcp_connect(connection.pcb, &connection.addr, connection.port, http_connected_callback) != ERR_OK)
     {
-        if (state->final_status.status == HTTP_WG_EOF)
-        {
-            state->current_chunk.status = HTTP_WG_DATAREADY;
-        }
-        else
-        {
-            state->current_chunk.status = HTTP_WG_FAILED;
-        }
+        connection_close();
+        fail_response();
+    }
+}
 
-        // Try to queue, but don't block
-        if (!queue_try_add(&inbound_queue, &state->current_chunk))
-        {
-            // Queue full - save for retry in http_get_poll()
-            state->final_chunk = state->current_chunk;
-            state->pending_final_chunk = true;
-        }
+// lwIP callback: name lookup finished, arg carries the generation of the connection it was for
+static void http_dns_callback(const char* name, const ip_addr_t* ipaddr, void* arg)
+{
+    (void)name;
+
+    if ((uint32_t)(uintptr_t)arg != connection.generation || connection.pcb != NULL)
+    {
+        return; // The request was superseded meanwhile
     }
+    if (ipaddr == NULL)
+    {
+        connection_close();
+        fail_response();
+        return;
+    }
+    connection.addr = *ipaddr;
+    connect_resolved();
+}
 
-    // Try to queue final status, but don't block
-    if (!queue_try_add(&inbound_queue, &state->final_status))
+// Open a connection to host:port and send the request for transfer_state.path once it is up
+static void connection_open(const char* host, u16_t port)
+{
+    connection_close();
+    strncpy(connection.host, host, sizeof(connection.host) - 1);
+    connection.host[sizeof(connection.host) - 1] = '\0';
+    connection.port = port;
+    transfer_state.last_rx_ms = now_ms();
+
+    err_t err = dns_gethostbyname(connection.host, &connection.addr, http_dns_callback,
+                                  (void*)(uintptr_t)connection.generation);
+    if (err == ERR_OK)
     {
-        // Queue full - save for retry in http_get_poll()
-        state->pending_final_status = true;
+        connect_resolved(); // Address literal or cached
     }
+    else if (err != ERR_INPROGRESS)
+    {
+        connection_close();
+        fail_response();
+    }
+}
+
+// The server closed or reset the connection: end a body that runs up to the close, send the
+// request again on a fresh connection when a reused one was closed before any reply, or fail
+static void handle_remote_close(void)
+{
+    bool waiting = transfer_state.transfer_active; // Still connecting, or the response is not complete
+    bool reused = connection.requests > 1;
+    bool unanswered = !transfer_state.rx_seen;
+    bool until_close = transfer_state.rx_state == HTTP_RX_BODY && !transfer_state.length_known;
+
+    char host[HTTP_HOST_MAX_LEN];
+    strcpy(host, connection.host);
+    u16_t port = connection.port;
+    connection_close();
 
-    state->transfer_active = false;
-    state->transfer_complete = true;
-    state->conn = NULL; // Clear connection handle to prevent use-after-free
+    if (!waiting)
+    {
+        return;
+    }
+    if (until_close)
+    {
+        finish_response(HTTP_WG_EOF);
+        publish_result(&transfer_state);
+    }
+    else if (unanswered && reused && !transfer_state.retried)
+    {
+        transfer_state.retried = true;
+        connection_open(host, port);
+    }
+    else
+    {
+        fail_response();
+    }
 }
 
 // Parse URL to extract hostname/IP, port, and path
@@ -285,231 +656,116 @@ static int parse_url(const char* url, char* hostname, size_t hostname_len, u16_t
     return 0;
 }
 
+void http_get_stream_init(http_response_stream_t* stream, uint8_t* buffer, size_t size)
+{
+    spsc_ring_init(&stream->ring, buffer, (uint32_t)size);
+    stream->started = 0;
+    stream->result = HTTP_WG_EOF;
+}
+
 void http_get_init(void)
 {
-    // Initialize queues
+    // Initialize queue and response stream
     queue_init(&outbound_queue, sizeof(http_request_t), OUTBOUND_QUEUE_SIZE);
-    queue_init(&inbound_queue, sizeof(http_response_t), INBOUND_QUEUE_SIZE);
+    http_get_stream_init(&response, response_buffer, HTTP_RX_RING_SIZE);
 
     // Initialize state
     memset(&transfer_state, 0, sizeof(transfer_state));
+    transfer_state.stream = &response;
+    memset(&connection, 0, sizeof(connection));
 }
 
-void http_get_poll(void)
+// Nothing of the last transfer is still on its way into its stream
+static bool transfer_idle(void)
 {
-    // PRIORITY 1: SERVICE PENDING BUFFERS (Resume Flow Control)
-    // CRITICAL: Must drain pbufs BEFORE sending final messages!
-    if (transfer_state.pending_pbuf != NULL)
-    {
-        // We have data that was paused because queue was full. Try to drain it now.
-        struct pbuf* p = transfer_state.pending_pbuf;
-        struct pbuf* current = p;
-        size_t current_offset = 0;
-        size_t target_offset = transfer_state.pending_pbuf_offset;
-
-        // Fast-forward to where we left off
-        while (current != NULL)
-        {
-            if (current_offset + current->len > target_offset)
-            {
-                break;
-            }
-            current_offset += current->len;
-            current = current->next;
-        }
-
-        // Local offset within the 'current' pbuf
-        size_t local_offset = target_offset - current_offset;
-        bool stuck = false;
-
-        while (current != NULL && !stuck)
-        {
-            while (local_offset < current->len)
-            {
-                // Determine how much can fit in current chunk
-                size_t bytes_available = current->len - local_offset;
-                size_t chunk_space = HTTP_CHUNK_SIZE - transfer_state.current_chunk.len;
-                size_t copy_size = (bytes_available > chunk_space) ? chunk_space : bytes_available;
-
-                // Copy to chunk
-                uint8_t* payload = (uint8_t*)current->payload;
-                memcpy(&transfer_state.current_chunk.data[transfer_state.current_chunk.len], &payload[local_offset],
-                       copy_size);
-
-                transfer_state.current_chunk.len += copy_size;
-                local_offset += copy_size;
-                transfer_state.pending_pbuf_offset += copy_size; // Advance global offset
-
-                // If chunk is full, send to queue
-                if (transfer_state.current_chunk.len >= HTTP_CHUNK_SIZE)
-                {
-                    transfer_state.current_chunk.status = HTTP_WG_DATAREADY;
-
-                    if (queue_try_add(&inbound_queue, &transfer_state.current_chunk))
-                    {
-                        // Success! ACK this chunk.
-                        // This re-opens the TCP window, signaling the server to send more.
-                        if (transfer_state.conn)
-                        {
-                            altcp_recved((struct tcp_pcb*)transfer_state.conn, HTTP_CHUNK_SIZE);
-                        }
-
-                        memset(&transfer_state.current_chunk, 0, sizeof(transfer_state.current_chunk));
-                    }
-                    else
-                    {
-                        // Still stuck. Stop draining.
-                        stuck = true;
-                        break;
-                    }
-                }
-            }
-
-            if (!stuck)
-            {
-                current = current->next;
-                local_offset = 0;
-            }
-        }
+    return !transfer_state.transfer_active && transfer_state.pending_pbuf == NULL && !transfer_state.pending_result;
+}
 
-        // If we finished the entire chain
-        if (current == NULL && !stuck)
-        {
-            // ACK any remaining bytes buffered in current_chunk
-            if (transfer_state.conn && transfer_state.current_chunk.len > 0)
-            {
-                altcp_recved((struct tcp_pcb*)transfer_state.conn, transfer_state.current_chunk.len);
-            }
+void http_get_poll(void)
+{
+    // Resume data paused because the ring was full, then the result that waits behind it
+    rx_process(&transfer_state);
 
-            pbuf_free(p);
-            transfer_state.pending_pbuf = NULL;
-            transfer_state.pending_pbuf_offset = 0;
-        }
+    // A close is handled once the data before it is in the ring
+    if (connection.remote_closed && transfer_state.pending_pbuf == NULL)
+    {
+        handle_remote_close();
     }
 
-    // PRIORITY 2: Handle Final Messages (Only if no pending pbuf)
-    if (transfer_state.pending_pbuf == NULL)
+    uint32_t now = now_ms();
+    if (transfer_state.pending_pbuf != NULL)
     {
-        // 2a. Flush any partial data remaining in current_chunk
-        // This happens when http_result_callback deferred because pbuf was pending
-        if (transfer_state.pending_final_status && transfer_state.current_chunk.len > 0)
-        {
-            // We have leftover data that needs to be sent before EOF status
-            if (transfer_state.final_status.status == HTTP_WG_EOF)
-            {
-                transfer_state.current_chunk.status = HTTP_WG_DATAREADY;
-            }
-            else
-            {
-                transfer_state.current_chunk.status = HTTP_WG_FAILED;
-            }
-
-            if (queue_try_add(&inbound_queue, &transfer_state.current_chunk))
-            {
-                // Success, clear it
-                memset(&transfer_state.current_chunk, 0, sizeof(transfer_state.current_chunk));
-            }
-            else
-            {
-                // Queue full, will retry next poll
-                return;
-            }
-        }
-
-        // 2b. Retry pending final chunk (from normal result callback path)
-        if (transfer_state.pending_final_chunk)
-        {
-            if (queue_try_add(&inbound_queue, &transfer_state.final_chunk))
-            {
-                transfer_state.pending_final_chunk = false;
-            }
-        }
-
-        // 2c. Send Final Status (EOF/Fail)
-        // Only if preceding data chunks are clear
-        if (!transfer_state.pending_final_chunk && transfer_state.current_chunk.len == 0)
-        {
-            if (transfer_state.pending_final_status)
-            {
-                if (queue_try_add(&inbound_queue, &transfer_state.final_status))
-                {
-                    transfer_state.pending_final_status = false;
-                }
-            }
-        }
+        transfer_state.last_rx_ms = now; // Waiting for the guest, not for the server
+    }
+    if (transfer_state.transfer_active && now - transfer_state.last_rx_ms >= HTTP_RESPONSE_TIMEOUT_MS)
+    {
+        printf("[HTTP] No response from %s\n", connection.host);
+        connection_close();
+        fail_response();
+    }
+    if (connection.pcb != NULL && connection.connected && !connection.busy &&
+        (!connection.reusable || now - connection.idle_since_ms >= HTTP_KEEPALIVE_IDLE_MS))
+    {
+        connection_close(); // Not kept by the server, or idle too long
     }
 
-    // Check for new HTTP requests from Core 0
+    // Check for new HTTP requests. One for another stream than the running transfer's waits for
+    // it, so a disk image download and the guest's transfers do not cut each other off.
     http_request_t request;
 
-    if (queue_try_remove(&outbound_queue, &request))
+    if (queue_try_peek(&outbound_queue, &request))
     {
+        http_response_stream_t* stream = request.stream != NULL ? request.stream : &response;
+        if (stream != transfer_state.stream && !transfer_idle())
+        {
+            return;
+        }
+        queue_try_remove(&outbound_queue, &request);
+
         if (request.abort)
         {
             // Clean up any pending state
-            if (transfer_state.pending_pbuf)
-            {
-                pbuf_free(transfer_state.pending_pbuf);
-            }
+            connection_close();
+            drop_pending(&transfer_state);
             memset(&transfer_state, 0, sizeof(transfer_state));
+            transfer_state.stream = stream;
             return;
         }
 
+        start_response(stream);
+
         // Parse URL to extract hostname, port, and path
-        char hostname[128];
-        char path[128];
+        char hostname[HTTP_HOST_MAX_LEN];
         u16_t port;
 
-        if (parse_url(request.url, hostname, sizeof(hostname), &port, path, sizeof(path)) != 0)
+        if (parse_url(request.url, hostname, sizeof(hostname), &port, transfer_state.path,
+                      sizeof(transfer_state.path)) != 0)
         {
-            // Send failure status
-            http_response_t response;
-            memset(&response, 0, sizeof(response));
-            response.status = HTTP_WG_FAILED;
-            response.len = 0;
-            queue_try_add(&inbound_queue, &response);
+            fail_response();
             return;
         }
 
-        // Build full URL for lwIP (hostname/path, port separate)
-        char full_url[256];
-        snprintf(full_url, sizeof(full_url), "%s%s", hostname, path);
-        (void)full_url; // Used for debugging if needed
-
-        // Reset transfer state
-        memset(&transfer_state, 0, sizeof(transfer_state));
+        transfer_state.body = request.body;
+        transfer_state.body_length = request.body_length;
         transfer_state.transfer_active = true;
 
-        // Configure HTTP client settings
-        httpc_connection_t settings;
-        memset(&settings, 0, sizeof(settings));
-        settings.use_proxy = 0;
-        settings.result_fn = http_result_callback;
-        settings.headers_done_fn = http_headers_done_callback;
-
-        // Start HTTP GET request with parsed port
-        httpc_state_t* connection = NULL;
-        err_t err =
-            httpc_get_file_dns(hostname, port, path, &settings, http_recv_callback, &transfer_state, &connection);
-
-        if (err != ERR_OK)
+        // Reuse the open connection when it is idle and goes to the same endpoint
+        if (connection.pcb != NULL && connection.connected && !connection.busy && connection.reusable &&
+            !connection.remote_closed && connection.port == port && strcasecmp(connection.host, hostname) == 0)
+        {
+            send_request();
+        }
+        else
         {
-            // Send failure status
-            http_response_t response;
-            memset(&response, 0, sizeof(response));
-            response.status = HTTP_WG_FAILED;
-            response.len = 0;
-            queue_try_add(&inbound_queue, &response);
-
-            transfer_state.transfer_active = false;
+            connection_open(hostname, port);
         }
     }
 }
 
-void http_get_queues(queue_t** outbound, queue_t** inbound)
+void http_get_queues(queue_t** outbound, http_response_stream_t** inbound)
 {
     *outbound = &outbound_queue;
-    *inbound = &inbound_queue;
+    *inbound = &response;
 }
 
 #else // !CYW43_WL_GPIO_LED_PIN - Stub implementations for non-WiFi boards
@@ -524,7 +780,14 @@ void http_get_poll(void)
     // No-op on non-WiFi boards
 }
 
-void http_get_queues(queue_t** outbound, queue_t** inbound)
+void http_get_stream_init(http_response_stream_t* stream, uint8_t* buffer, size_t size)
+{
+    (void)stream;
+    (void)buffer;
+    (void)size;
+}
+
+void http_get_queues(queue_t** outbound, http_response_stream_t** inbound)
 {
     // No-op on non-WiFi boards
     *outbound = NULL;
@@ -5,10 +5,29 @@
 #include <stdint.h>
 
 #include "pico/util/queue.h"
+#include "spsc_ring.h"
 
 // Configuration
-#define HTTP_CHUNK_SIZE 256
+#define HTTP_CHUNK_SIZE 256 // Most the guest reads in place before the ring space is released
 #define HTTP_URL_MAX_LEN 280
+#define HTTP_HOST_MAX_LEN 128
+#define HTTP_PATH_MAX_LEN 128
+#define HTTP_LINE_MAX_LEN 128 // Longer status and header lines are cut, only their start is parsed
+
+// Requests to the endpoint of the previous one reuse its connection (HTTP/1.1 keep-alive)
+// until the server closes it or it has been idle this long
+#define HTTP_KEEPALIVE_IDLE_MS 15000
+
+// A transfer fails when the server sends nothing for this long (a full ring does not count)
+#define HTTP_RESPONSE_TIMEOUT_MS 30000
+
+// Response body buffer between the cores. The TCP window (TCP_WND in lwipopts.h) fits into it,
+// so a download keeps streaming while the guest reads.
+#if PICO_RP2350
+#define HTTP_RX_RING_SIZE 16384
+#else
+#define HTTP_RX_RING_SIZE 8192
+#endif
 
 // Status values matching gf.c
 #define HTTP_WG_EOF 0
@@ -16,39 +35,71 @@
 #define HTTP_WG_DATAREADY 2
 #define HTTP_WG_FAILED 3
 
-// HTTP request message (Core 0 -> Core 1)
+// Response of the current transfer (Core 1 -> Core 0). For each request core 1 sets result to
+// HTTP_WG_WAITING, empties the ring and counts the request in started; the body follows in the
+// ring, and result becomes HTTP_WG_EOF or HTTP_WG_FAILED once the last byte is in.
+typedef struct
+{
+    spsc_ring_t ring;
+    volatile uint32_t started; // Requests taken since boot
+    volatile uint8_t result;
+} http_response_stream_t;
+
+// HTTP request message (Core 0 -> Core 1). One transfer runs at a time: a request for another
+// stream waits until the running transfer is complete, one for the same stream replaces it.
+// A request with a body is a POST of it as text/plain; the body is sent from where it is and
+// has to stay in place until the response is complete.
 typedef struct
 {
     char url[HTTP_URL_MAX_LEN];
     bool abort;
+    http_response_stream_t* stream; // Where the response goes, NULL for the guest's (http_get_queues)
+    const uint8_t* body;            // NULL for a GET
+    uint16_t body_length;
 } http_request_t;
 
-// HTTP response message (Core 1 -> Core 0)
-typedef struct
+// Response parser (Core 1)
+typedef enum
 {
-    uint8_t data[HTTP_CHUNK_SIZE];
-    size_t len;
-    uint8_t status;
-} http_response_t;
+    HTTP_RX_STATUS = 0, // Status line
+    HTTP_RX_HEADERS,    // Header lines up to the blank line
+    HTTP_RX_BODY,       // Content-Length bytes, or everything up to the server's close
+    HTTP_RX_CHUNK_SIZE, // Chunked encoding: size line
+    HTTP_RX_CHUNK_DATA, // Chunked encoding: chunk data
+    HTTP_RX_CHUNK_END,  // Chunked encoding: line end after the data
+    HTTP_RX_TRAILER,    // Chunked encoding: trailer lines after the last chunk
+    HTTP_RX_DONE        // Response complete, anything more is discarded
+} HTTP_RX_STATE;
 
 // State for HTTP transfer (Core 1)
 typedef struct
 {
     bool transfer_active;
-    bool transfer_complete;
-    http_response_t current_chunk;
     size_t total_bytes_received;
+    char path[HTTP_PATH_MAX_LEN];
+    const uint8_t* body; // Of a POST, sent again with the request on a retry
+    uint16_t body_length;
+    bool retried; // Sent again after a reused connection was closed before the response
 
-    // Pending final messages (for non-blocking retry)
-    bool pending_final_chunk;
-    bool pending_final_status;
-    http_response_t final_chunk;
-    http_response_t final_status;
+    // Response parser
+    uint8_t rx_state; // HTTP_RX_STATE
+    bool rx_seen;     // Any byte of the response arrived
+    uint16_t status_code;
+    bool chunked;
+    bool length_known;
+    uint32_t body_left; // Of the Content-Length or the current chunk
+    char line[HTTP_LINE_MAX_LEN];
+    size_t line_len;
+    uint32_t last_rx_ms;
 
-    // TCP Flow Control: Pending pbuf when queue is full
+    http_response_stream_t* stream; // Of the request
+
+    // Transfer finished, result published once pending_pbuf is in the ring
+    bool pending_result;
+    uint8_t result;
+
+    // TCP Flow Control: received data the ring had no room for, not ACKed yet
     struct pbuf* pending_pbuf;
-    size_t pending_pbuf_offset;
-    void* conn; // Connection handle for async Flow Control ACKs (opaque, cast in http_get.c)
 } http_transfer_state_t;
 
 /**
@@ -66,10 +117,19 @@ void http_get_init(void);
 void http_get_poll(void);
 
 /**
- * Get pointers to the HTTP GET queues
- * Used by http_io.c to access queues for port handling
+ * Set up a response stream of another client of the request queue
+ *
+ * @param stream Stream to initialize
+ * @param buffer Ring storage
+ * @param size Ring size in bytes, a power of two
+ */
+void http_get_stream_init(http_response_stream_t* stream, uint8_t* buffer, size_t size);
+
+/**
+ * Get pointers to the HTTP GET request queue and response stream
+ * Used by http_io.c to access them for port handling
  *
  * @param outbound Pointer to receive outbound queue pointer (Core 0 -> Core 1)
- * @param inbound Pointer to receive inbound queue pointer (Core 1 -> Core 0)
+ * @param inbound Pointer to receive the response stream pointer (Core 1 -> Core 0)
  */
-void http_get_queues(queue_t** outbound, queue_t** inbound);
+void http_get_queues(queue_t** outbound, http_response_stream_t** inbound);
@@ -1,5 +1,6 @@
 #include "http_io.h"
 #include "http_get.h"
+#include "io_ports.h"
 
 #include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
 
@@ -11,6 +12,9 @@
 
 #include "pico/util/queue.h"
 
+#include "Altair8800/memory.h"
+#include "metrics.h"
+
 // Port definitions matching gf.c
 #define WG_IDX_RESET 109
 #define WG_EP_NAME 110
@@ -18,6 +22,15 @@
 #define WG_STATUS 33
 #define WG_GET_BYTE 201
 
+// Block protocol: OUT sets the guest's DMA address, IN WG_GET_RECORD copies the next record of
+// the response there and returns its length. IN WG_BLOCK_VERSION is 0 on firmware without it.
+#define WG_DMA_LO 202
+#define WG_DMA_HI 203
+#define WG_GET_RECORD 202
+#define WG_BLOCK_VERSION 203
+#define WG_BLOCK_PROTOCOL 1
+#define WG_RECORD_SIZE 128 // CP/M record
+
 // Status values matching gf.c
 #define WG_EOF 0
 #define WG_WAITING 1
@@ -34,17 +47,20 @@ typedef struct
     char endpoint[ENDPOINT_LEN];
     char filename[FILENAME_LEN];
     int index;
-    uint8_t status;
-
-    // Current chunk being read by Altair
-    uint8_t chunk_buffer[HTTP_CHUNK_SIZE];
-    size_t chunk_bytes_available;
-    size_t chunk_position;
+    uint32_t transfer;  // Requests sent, the response is current once core 1 has started as many
+    bool request_lost;  // The last request did not fit into the outbound queue
+    uint16_t dma;       // Guest address WG_GET_RECORD copies to
+
+    // Block of the response the Altair is reading, in place in the response ring
+    const uint8_t* chunk;
+    uint32_t chunk_index;
+    size_t chunk_size;
+    size_t chunk_left;
 } http_port_state_t;
 
-// Queues for inter-core communication (provided by http_get module)
-static queue_t* outbound_queue; // Core 0 -> Core 1
-static queue_t* inbound_queue;  // Core 1 -> Core 0
+// Inter-core communication (provided by http_get module)
+static queue_t* outbound_queue;          // Core 0 -> Core 1
+static http_response_stream_t* inbound;  // Core 1 -> Core 0
 
 // State variables
 static http_port_state_t port_state;
@@ -57,11 +73,87 @@ void http_io_init(void)
     http_get_init();
 
     // Get queue pointers from http_get module
-    http_get_queues(&outbound_queue, &inbound_queue);
+    http_get_queues(&outbound_queue, &inbound);
 
     // Initialize state
     memset(&port_state, 0, sizeof(port_state));
-    port_state.status = WG_EOF;
+}
+
+// Hand the block read so far back to core 1 and take the next one
+static void next_chunk(void)
+{
+    if (port_state.chunk_size > 0)
+    {
+        spsc_ring_consume(&inbound->ring, port_state.chunk_index, port_state.chunk_size);
+        __sev(); // Room for core 1 to take more of the response
+    }
+    port_state.chunk_size = spsc_ring_peek(&inbound->ring, &port_state.chunk_index, &port_state.chunk, HTTP_CHUNK_SIZE);
+    port_state.chunk_left = port_state.chunk_size;
+    if (port_state.chunk_size > 0)
+    {
+        metrics_http_chunk(port_state.chunk_size);
+    }
+}
+
+// WG_STATUS of the current transfer, with a block ready to read while it is WG_DATAREADY
+static uint8_t transfer_status(void)
+{
+    if (port_state.request_lost)
+    {
+        return WG_FAILED;
+    }
+    if (__atomic_load_n(&inbound->started, __ATOMIC_ACQUIRE) != port_state.transfer)
+    {
+        return WG_WAITING; // Core 1 has not taken the request yet
+    }
+
+    // Read the result first: it is only set once the last byte is in the ring
+    uint8_t result = __atomic_load_n(&inbound->result, __ATOMIC_ACQUIRE);
+    if (port_state.chunk_left == 0)
+    {
+        next_chunk();
+    }
+    return port_state.chunk_left > 0 ? WG_DATAREADY : result;
+}
+
+// Copy the next record to the DMA address, 0 until a full record is in or the transfer has ended
+static uint8_t read_record(void)
+{
+    if (transfer_status() != WG_DATAREADY)
+    {
+        return 0;
+    }
+
+    // Result before level, as in transfer_status: once it is final all data is in the ring
+    uint8_t result = __atomic_load_n(&inbound->result, __ATOMIC_ACQUIRE);
+    uint32_t available = spsc_ring_level(&inbound->ring) - (uint32_t)(port_state.chunk_size - port_state.chunk_left);
+    if (available < WG_RECORD_SIZE && result == WG_WAITING)
+    {
+        return 0;
+    }
+
+    // One piece per memory page and ring block, a ROM page's write pointer aims at the discard page
+    uint8_t length = 0;
+    while (length < WG_RECORD_SIZE && transfer_status() == WG_DATAREADY)
+    {
+        uint16_t address = (uint16_t)(port_state.dma + length);
+        size_t n = MEMORY_PAGE_SIZE - (address & MEMORY_PAGE_MASK);
+        if (n > WG_RECORD_SIZE - length)
+        {
+            n = WG_RECORD_SIZE - length;
+        }
+        if (n > port_state.chunk_left)
+        {
+            n = port_state.chunk_left;
+        }
+
+        memcpy(memory_main.write_map[address >> MEMORY_PAGE_SHIFT] + (address & MEMORY_PAGE_MASK), port_state.chunk, n);
+        memory_mark_dirty_range(&memory_main, address, (uint32_t)n);
+        port_state.chunk += n;
+        port_state.chunk_left -= n;
+        length += (uint8_t)n;
+    }
+    return length;
 }
 
 size_t http_output(int port, uint8_t data, char* buffer, size_t buffer_length)
@@ -95,6 +187,14 @@ size_t http_output(int port, uint8_t data, char* buffer, size_t buffer_length)
             }
             break;
 
+        case WG_DMA_LO:
+            port_state.dma = (uint16_t)((port_state.dma & 0xFF00) | data);
+            break;
+
+        case WG_DMA_HI:
+            port_state.dma = (uint16_t)((port_state.dma & 0x00FF) | (data << 8));
+            break;
+
         case WG_FILENAME: // Set filename and trigger transfer
             if (port_state.index == 0)
             {
@@ -120,15 +220,19 @@ size_t http_output(int port, uint8_t data, char* buffer, size_t buffer_length)
                 snprintf(request.url, HTTP_URL_MAX_LEN, "%s/%s", port_state.endpoint, port_state.filename);
                 request.abort = false;
 
-                // Reset chunk state for new transfer
-                port_state.chunk_bytes_available = 0;
-                port_state.chunk_position = 0;
-                port_state.status = WG_WAITING;
+                // Drop what is left of the previous transfer
+                if (port_state.chunk_size > 0)
+                {
+                    spsc_ring_consume(&inbound->ring, port_state.chunk_index, port_state.chunk_size);
+                }
+                port_state.chunk_size = 0;
+                port_state.chunk_left = 0;
 
                 // Send request to Core 1
-                if (!queue_try_add(outbound_queue, &request))
+                port_state.request_lost = !queue_try_add(outbound_queue, &request);
+                if (!port_state.request_lost)
                 {
-                    port_state.status = WG_FAILED;
+                    port_state.transfer++;
                 }
             }
             break;
@@ -144,67 +248,25 @@ uint8_t http_input(uint8_t port)
     switch (port)
     {
         case WG_STATUS:
-            // If no data in buffer, try to load a chunk from the queue
-            if (port_state.chunk_bytes_available == 0)
-            {
-                http_response_t response;
-                if (queue_try_remove(inbound_queue, &response))
-                {
-                    // Load chunk
-                    memcpy(port_state.chunk_buffer, response.data, response.len);
-                    port_state.chunk_bytes_available = response.len;
-                    port_state.chunk_position = 0;
-                    port_state.status = response.status;
-                }
-            }
-            retVal = port_state.status;
+            retVal = transfer_status();
             break;
 
         case WG_GET_BYTE:
-            // Check if we have data in current chunk
-            if (port_state.chunk_bytes_available > 0 && port_state.chunk_position < port_state.chunk_bytes_available)
+            // Next byte straight from the response ring, 0x00 while none is ready
+            if (transfer_status() == WG_DATAREADY)
             {
-                retVal = port_state.chunk_buffer[port_state.chunk_position++];
-
-                // Check if chunk is depleted
-                if (port_state.chunk_position >= port_state.chunk_bytes_available)
-                {
-                    // Try to get next chunk from queue
-                    http_response_t response;
-                    if (queue_try_remove(inbound_queue, &response))
-                    {
-                        // Load new chunk
-                        memcpy(port_state.chunk_buffer, response.data, response.len);
-                        port_state.chunk_bytes_available = response.len;
-                        port_state.chunk_position = 0;
-                        port_state.status = response.status;
-                    }
-                    else
-                    {
-                        // No more chunks available
-                        port_state.chunk_bytes_available = 0;
-                        port_state.chunk_position = 0;
-
-                        // Status remains as-is (could be WAITING, EOF, or FAILED)
-                        // If status was DATAREADY but no more chunks, set to WAITING
-                        if (port_state.status == WG_DATAREADY)
-                        {
-                            port_state.status = WG_WAITING;
-                        }
-                    }
-                }
-                else
-                {
-                    // More bytes available in current chunk
-                    port_state.status = WG_DATAREADY;
-                }
-            }
-            else
-            {
-                // No data in buffer
-                retVal = 0x00;
+                retVal = *port_state.chunk++;
+                port_state.chunk_left--;
             }
             break;
+
+        case WG_GET_RECORD:
+            retVal = read_record();
+            break;
+
+        case WG_BLOCK_VERSION:
+            retVal = WG_BLOCK_PROTOCOL;
+            break;
     }
 
     return retVal;
@@ -250,3 +312,23 @@ void http_poll(void)
 }
 
 #endif // CYW43_WL_GPIO_LED_PIN
+
+static uint8_t http_port_in(void* context, uint8_t port)
+{
+    (void)context;
+    return http_input(port);
+}
+
+void http_io_register(void)
+{
+    static const uint8_t in_ports[] = {33, 201, 202, 203};
+    static const uint8_t out_ports[] = {109, 110, 114, 202, 203};
+    for (size_t i = 0; i < sizeof(in_ports); i++)
+    {
+        io_port_register_in(in_ports[i], http_port_in, NULL);
+    }
+    for (size_t i = 0; i < sizeof(out_ports); i++)
+    {
+        io_port_register_response(out_ports[i], http_output);
+    }
+}
@@ -13,9 +13,9 @@ void http_io_init(void);
 
 /**
  * HTTP port output handler
- * Called from io_port_out() on Core 0 (Altair emulator)
+ * Called through the I/O port table on Core 0 (Altair emulator)
  *
- * @param port Port number (109, 110, 114)
+ * @param port Port number (109, 110, 114, 202, 203)
  * @param data Data byte written to port
  * @param buffer Output buffer for response data
  * @param buffer_length Size of output buffer
@@ -25,13 +25,19 @@ size_t http_output(int port, uint8_t data, char* buffer, size_t buffer_length);
 
 /**
  * HTTP port input handler
- * Called from io_port_in() on Core 0 (Altair emulator)
+ * Called through the I/O port table on Core 0 (Altair emulator)
  *
- * @param port Port number (33, 201)
+ * @param port Port number (33, 201, 202, 203)
  * @return Data byte read from port
  */
 uint8_t http_input(uint8_t port);
 
+/**
+ * Register the HTTP ports (IN 33, 201-203; OUT 109, 110, 114, 202, 203) in the I/O port table
+ * Stubs answer on non-WiFi boards
+ */
+void http_io_register(void);
+
 /**
  * Poll for HTTP requests and process responses
  * Called from Core 1's main loop in websocket_console_core1_entry()
@@ -0,0 +1,286 @@
+#include "printer_io.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+#include <stdio.h>
+
+// The card when there is one, otherwise the URL over Wi-Fi
+#if defined(ALTAIR_PRINTER) && defined(SD_CARD_SUPPORT)
+#define PRINTER_TO_CARD 1
+#define PRINTER_TARGET PRINTER_FILE
+#elif defined(ALTAIR_PRINTER) && defined(CYW43_WL_GPIO_LED_PIN) && defined(ALTAIR_PRINTER_URL)
+#define PRINTER_TO_HTTP 1
+#define PRINTER_TARGET ALTAIR_PRINTER_URL
+#endif
+
+#if defined(PRINTER_TO_CARD) || defined(PRINTER_TO_HTTP)
+
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "io_ports.h"
+#include "spsc_ring.h"
+#ifdef PRINTER_TO_CARD
+#include "Altair8800/pico_88dcdd_sd_card.h"
+#else
+#include "PortDrivers/http_get.h"
+#endif
+
+// Written out by the core that polls the spool: core 1 on boards with Wi-Fi, core 0 otherwise
+typedef struct
+{
+    uint32_t level;            // Spool level the writer last saw
+    uint32_t changed_ms;       // When it last saw the guest print
+    uint32_t retry_ms;         // When to try a failed block again
+    volatile bool offline;     // The last block could not be written
+    volatile uint32_t printed; // Bytes written out since boot
+} printer_t;
+
+static spsc_ring_t spool; // Core 0 -> writer
+static uint8_t spool_buffer[PRINTER_SPOOL_SIZE];
+static printer_t printer;
+
+#ifdef PRINTER_TO_CARD
+typedef struct
+{
+    const uint8_t* data;
+    size_t length;
+    bool ok;
+} printer_write_t;
+
+static FIL file;
+#else
+_Static_assert(sizeof(ALTAIR_PRINTER_URL) <= HTTP_URL_MAX_LEN, "ALTAIR_PRINTER_URL is too long");
+
+static http_response_stream_t stream; // The server's reply, dropped
+static uint8_t stream_buffer[256];
+static queue_t* outbound_queue;
+static uint32_t transfer = 0; // Requests sent on stream
+static bool posting = false;  // A block is out, until the reply is complete
+static uint32_t post_index;
+static size_t post_length;
+#endif
+
+static uint32_t now_ms(void)
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+static uint8_t status_in(void* context, uint8_t port)
+{
+    (void)context;
+    (void)port;
+    return spsc_ring_level(&spool) < PRINTER_SPOOL_SIZE ? PRINTER_STATUS_READY : 0x00;
+}
+
+static void data_out(void* context, uint8_t port, uint8_t data)
+{
+    (void)context;
+    (void)port;
+    if (spsc_ring_push(&spool, &data, 1) == 1 && spsc_ring_level(&spool) % PRINTER_BLOCK_SIZE == 0)
+    {
+#if defined(CYW43_WL_GPIO_LED_PIN)
+        __sev(); // Wake core 1, a block is complete
+#endif
+    }
+}
+
+void printer_io_register(void)
+{
+    spsc_ring_init(&spool, spool_buffer, sizeof(spool_buffer));
+    io_port_register_in(PRINTER_STATUS_PORT, status_in, NULL);
+    io_port_register_out(PRINTER_DATA_PORT, data_out, NULL);
+}
+
+// Writer: the next block to write out, in place in the spool. A whole block once there is one,
+// the rest once the guest has printed nothing for PRINTER_IDLE_MS.
+static size_t next_block(uint32_t now, uint32_t* index, const uint8_t** data)
+{
+    uint32_t level = spsc_ring_level(&spool);
+    if (level != printer.level)
+    {
+        printer.level = level;
+        printer.changed_ms = now;
+    }
+    if (level == 0 || (level < PRINTER_BLOCK_SIZE && now - printer.changed_ms < PRINTER_IDLE_MS) ||
+        (printer.offline && (int32_t)(now - printer.retry_ms) < 0))
+    {
+        return 0;
+    }
+    return spsc_ring_peek(&spool, index, data, PRINTER_BLOCK_SIZE);
+}
+
+// Writer: the block is out, its room goes back to the guest
+static void block_done(uint32_t index, size_t length)
+{
+    spsc_ring_consume(&spool, index, length);
+    printer.level -= (uint32_t)length;
+    printer.printed += (uint32_t)length;
+    printer.offline = false;
+}
+
+static void block_failed(uint32_t now)
+{
+    if (!printer.offline)
+    {
+        printf("[PRINTER] Cannot write to %s, trying again\n", PRINTER_TARGET);
+    }
+    printer.offline = true;
+    printer.retry_ms = now + PRINTER_RETRY_MS;
+}
+
+#ifdef PRINTER_TO_CARD
+
+// Append the block to PRINTER_FILE, closed again so the card holds all that is printed
+static void append_file(void* arg)
+{
+    printer_write_t* write = arg;
+    write->ok = false;
+    if (f_open(&file, PRINTER_FILE, FA_OPEN_APPEND | FA_WRITE) != FR_OK)
+    {
+        return;
+    }
+    UINT written = 0;
+    bool ok = f_write(&file, write->data, (UINT)write->length, &written) == FR_OK && written == write->length;
+    write->ok = f_close(&file) == FR_OK && ok;
+}
+
+static void write_spool(bool io_call)
+{
+    uint32_t now = now_ms();
+    uint32_t index;
+    printer_write_t write;
+    write.length = next_block(now, &index, &write.data);
+    if (write.length == 0)
+    {
+        return;
+    }
+    if (io_call)
+    {
+        sd_disk_io_call(append_file, &write);
+    }
+    else
+    {
+        append_file(&write);
+    }
+    if (write.ok)
+    {
+        block_done(index, write.length);
+    }
+    else
+    {
+        block_failed(now);
+    }
+}
+
+#else
+
+// Core 1: POST the next block, then wait for the reply to it before the block is let go
+static void post_spool(void)
+{
+    if (outbound_queue == NULL)
+    {
+        http_response_stream_t* unused;
+        http_get_queues(&outbound_queue, &unused);
+        http_get_stream_init(&stream, stream_buffer, sizeof(stream_buffer));
+    }
+    uint32_t now = now_ms();
+
+    if (posting)
+    {
+        if (__atomic_load_n(&stream.started, __ATOMIC_ACQUIRE) != transfer)
+        {
+            return; // Behind another transfer
+        }
+        // Result first, as in http_io.c: once it is final all of the reply is in the ring
+        uint8_t result = __atomic_load_n(&stream.result, __ATOMIC_ACQUIRE);
+        uint32_t index;
+        const uint8_t* data;
+        size_t n;
+        while ((n = spsc_ring_peek(&stream.ring, &index, &data, sizeof(stream_buffer))) > 0)
+        {
+            spsc_ring_consume(&stream.ring, index, n);
+        }
+        if (result == HTTP_WG_WAITING)
+        {
+            return;
+        }
+        posting = false;
+        if (result == HTTP_WG_EOF)
+        {
+            block_done(post_index, post_length);
+        }
+        else
+        {
+            block_failed(now);
+        }
+        return;
+    }
+
+    const uint8_t* data;
+    size_t length = next_block(now, &post_index, &data);
+    if (length == 0)
+    {
+        return;
+    }
+    http_request_t request;
+    memset(&request, 0, sizeof(request));
+    memcpy(request.url, ALTAIR_PRINTER_URL, sizeof(ALTAIR_PRINTER_URL));
+    request.stream = &stream;
+    request.body = data;
+    request.body_length = (uint16_t)length;
+    if (!queue_try_add(outbound_queue, &request))
+    {
+        return; // Queue full, tried again on the next poll
+    }
+    transfer++;
+    posting = true;
+    post_length = length;
+}
+
+#endif
+
+void printer_io_poll(void)
+{
+#if defined(PRINTER_TO_CARD) && !defined(CYW43_WL_GPIO_LED_PIN)
+    write_spool(true);
+#endif
+}
+
+void printer_io_core1_poll(void)
+{
+#if defined(PRINTER_TO_CARD) && defined(CYW43_WL_GPIO_LED_PIN)
+    write_spool(false);
+#elif defined(PRINTER_TO_HTTP)
+    post_spool();
+#endif
+}
+
+size_t printer_io_describe(char* buffer, size_t buffer_length)
+{
+    int len = snprintf(buffer, buffer_length, "%lu bytes printed to %s, %lu spooled%s",
+                       (unsigned long)printer.printed, PRINTER_TARGET, (unsigned long)spsc_ring_level(&spool),
+                       printer.offline ? ", offline" : "");
+    return len < 0 ? 0 : (size_t)len;
+}
+
+#else
+
+void printer_io_register(void)
+{
+}
+
+void printer_io_poll(void)
+{
+}
+
+void printer_io_core1_poll(void)
+{
+}
+
+size_t printer_io_describe(char* buffer, size_t buffer_length)
+{
+    return (size_t)snprintf(buffer, buffer_length, "Not available, SD card builds or ALTAIR_PRINTER_URL on boards with Wi-Fi");
+}
+
+#endif
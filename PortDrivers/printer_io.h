@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Line printer on the 88-LPC ports the CP/M BIOS's LIST and LISTST use, only built with
+// ALTAIR_PRINTER. OUT PRINTER_DATA_PORT puts a character into a RAM spool; IN PRINTER_STATUS_PORT
+// has PRINTER_STATUS_READY set while the spool has room, so the guest prints at CPU speed and
+// only waits once the spool is full. The spool is written out in blocks of PRINTER_BLOCK_SIZE,
+// and what is left once the guest has printed nothing for PRINTER_IDLE_MS:
+//   SD card builds append it to PRINTER_FILE on the card, from core 1 on boards with Wi-Fi
+//   Boards with Wi-Fi and no card POST each block as text/plain to ALTAIR_PRINTER_URL
+// A block that cannot be written is tried again after PRINTER_RETRY_MS, the guest waits for
+// the printer meanwhile. Without a card or a URL the ports are not there.
+#define PRINTER_STATUS_PORT 2
+#define PRINTER_DATA_PORT 3
+#define PRINTER_STATUS_READY 0x02
+
+#if PICO_RP2350
+#define PRINTER_SPOOL_SIZE 16384
+#else
+#define PRINTER_SPOOL_SIZE 8192
+#endif
+
+#define PRINTER_BLOCK_SIZE 512
+#define PRINTER_IDLE_MS 1000
+#define PRINTER_RETRY_MS 5000
+
+// On the card's root, next to the Disks directory
+#define PRINTER_FILE "printer.txt"
+
+// Printer ports 2 and 3, when there is somewhere to print to
+void printer_io_register(void);
+
+/**
+ * Write the spool out on boards without Wi-Fi
+ * Called from Core 0's main loop
+ */
+void printer_io_poll(void);
+
+/**
+ * Write the spool out on boards with Wi-Fi
+ * Called from Core 1's main loop, after sd_disk_service_poll()
+ */
+void printer_io_core1_poll(void);
+
+/**
+ * Describe the printer in one line
+ * Called from Core 0
+ *
+ * @param buffer Output buffer
+ * @param buffer_length Size of buffer
+ * @return Length of the text
+ */
+size_t printer_io_describe(char* buffer, size_t buffer_length);
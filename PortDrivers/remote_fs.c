@@ -0,0 +1,438 @@
+#include "remote_fs.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+// RemoteFS is only available on WiFi-enabled boards
+#if defined(CYW43_WL_GPIO_LED_PIN)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "pico/cyw43_arch.h"
+#include "pico/time.h"
+
+// Queue sizes, core 0 never has more than the window outstanding
+#define OUTBOUND_QUEUE_SIZE REMOTE_FS_WINDOW
+#define INBOUND_QUEUE_SIZE REMOTE_FS_WINDOW
+
+// Wire size of a request: command, drive, track, sector (+ data for WRITE_SECTOR)
+#define REQUEST_HEADER_SIZE 4
+// READ_RANGE adds count and flags
+#define RANGE_HEADER_SIZE 6
+
+typedef enum
+{
+    REMOTE_FS_IDLE = 0,   // No connection, waiting for the retry time
+    REMOTE_FS_CONNECTING, // TCP connect in progress
+    REMOTE_FS_INIT,       // INIT sent, waiting for its status byte
+    REMOTE_FS_CAPS,       // CAPS sent, waiting for status and capability bits
+    REMOTE_FS_READY       // Sector requests are being served
+} REMOTE_FS_STATE;
+
+// Queues for inter-core communication
+static queue_t outbound_queue; // Core 0 -> Core 1
+static queue_t inbound_queue;  // Core 1 -> Core 0
+
+// Requests taken from the outbound queue and not answered yet, oldest first. The first
+// window_sent of them went out on the current connection; all are resent after a reconnect.
+// window_batch holds, for the first entry of each wire request, how many entries it covers.
+static remote_fs_request_t window[REMOTE_FS_WINDOW];
+static uint8_t window_batch[REMOTE_FS_WINDOW];
+static uint8_t window_head = 0;
+static uint8_t window_count = 0;
+static uint8_t window_sent = 0;
+
+// Connection state (Core 1)
+static REMOTE_FS_STATE state = REMOTE_FS_IDLE;
+static struct tcp_pcb* pcb = NULL;
+static bool retry_wait = false;
+static uint32_t retry_at_us = 0;
+static bool reset_pending = false;
+static bool server_ranges = false; // Server answered CAPS with REMOTE_FS_CAP_RANGES
+
+// Receive state: unparsed data, and the response being assembled at the window head
+static struct pbuf* rx_pbuf = NULL;
+static remote_fs_response_t rx_response;
+static uint8_t rx_batch_left = 0; // Window entries still to come from the current wire response
+static uint8_t rx_batch_status = REMOTE_FS_RESP_ERROR;
+static size_t rx_have = 0;        // Data bytes of the head entry received so far
+static bool rx_ready = false;     // rx_response is complete but the inbound queue was full
+
+// === CORE 1: TCP client ===
+
+// Consume up to len bytes from the front of the received data and ACK them to the server
+static size_t rx_take(void* dst, size_t len)
+{
+    if (rx_pbuf == NULL)
+    {
+        return 0;
+    }
+
+    size_t n = pbuf_copy_partial(rx_pbuf, dst, (u16_t)len, 0);
+    rx_pbuf = pbuf_free_header(rx_pbuf, (u16_t)n);
+    if (pcb != NULL)
+    {
+        tcp_recved(pcb, (u16_t)n);
+    }
+    return n;
+}
+
+// Send the window entries not yet on the wire, as far as the TCP send buffer allows
+static void send_window(void)
+{
+    if (state != REMOTE_FS_READY || pcb == NULL)
+    {
+        return;
+    }
+
+    bool queued = false;
+    while (window_sent < window_count)
+    {
+        uint8_t first = (uint8_t)((window_head + window_sent) % REMOTE_FS_WINDOW);
+        const remote_fs_request_t* request = &window[first];
+
+        // Reads of the following sectors of the same track ride along in one READ_RANGE
+        uint8_t count = 1;
+        if (server_ranges && request->cmd == REMOTE_FS_CMD_READ_SECTOR)
+        {
+            while (window_sent + count < window_count)
+            {
+                const remote_fs_request_t* next = &window[(first + count) % REMOTE_FS_WINDOW];
+                if (next->cmd != REMOTE_FS_CMD_READ_SECTOR || next->drive != request->drive ||
+                    next->track != request->track || next->sector != request->sector + count)
+                {
+                    break;
+                }
+                count++;
+            }
+        }
+
+        err_t err;
+        if (count > 1)
+        {
+            uint8_t range[RANGE_HEADER_SIZE] = {REMOTE_FS_CMD_READ_RANGE, request->drive, request->track,
+                                                request->sector, count, 0};
+            err = tcp_sndbuf(pcb) < RANGE_HEADER_SIZE ? ERR_MEM
+                                                      : tcp_write(pcb, range, RANGE_HEADER_SIZE, TCP_WRITE_FLAG_COPY);
+        }
+        else
+        {
+            u16_t len = REQUEST_HEADER_SIZE;
+            if (request->cmd == REMOTE_FS_CMD_WRITE_SECTOR)
+            {
+                len += REMOTE_FS_SECTOR_SIZE;
+            }
+
+            // The request struct is laid out exactly like the wire format
+            err = tcp_sndbuf(pcb) < len ? ERR_MEM : tcp_write(pcb, request, len, TCP_WRITE_FLAG_COPY);
+        }
+        if (err != ERR_OK)
+        {
+            break;
+        }
+
+        window_batch[first] = count;
+        window_sent += count;
+        queued = true;
+    }
+
+    if (queued)
+    {
+        tcp_output(pcb);
+    }
+}
+
+// Parse received responses and hand them to core 0. Stops (leaving the data un-ACKed, which
+// closes the TCP window) while the inbound queue is full.
+static void rx_process(void)
+{
+    while (!reset_pending)
+    {
+        if (rx_ready)
+        {
+            if (!queue_try_add(&inbound_queue, &rx_response))
+            {
+                return;
+            }
+            rx_ready = false;
+        }
+
+        // The remaining entries of a failed range need no more data
+        bool need_data = rx_batch_left == 0 || rx_batch_status == REMOTE_FS_RESP_OK;
+        if (rx_pbuf == NULL && (need_data || state != REMOTE_FS_READY))
+        {
+            return;
+        }
+
+        if (state == REMOTE_FS_INIT)
+        {
+            uint8_t status = REMOTE_FS_RESP_ERROR;
+            rx_take(&status, 1);
+            if (status != REMOTE_FS_RESP_OK)
+            {
+                printf("[REMOTE_FS] Server rejected INIT (0x%02X)\n", status);
+                reset_pending = true;
+                return;
+            }
+            // Probe for the range commands, an older server answers with one error byte
+            static const uint8_t caps = REMOTE_FS_CMD_CAPS;
+            state = REMOTE_FS_CAPS;
+            tcp_write(pcb, &caps, 1, TCP_WRITE_FLAG_COPY);
+            tcp_output(pcb);
+            continue;
+        }
+
+        if (state == REMOTE_FS_CAPS)
+        {
+            uint8_t reply[2] = {REMOTE_FS_RESP_ERROR, 0};
+            if (rx_have == 0)
+            {
+                rx_take(&reply[0], 1);
+                rx_batch_status = reply[0];
+                rx_have = 1;
+            }
+            if (rx_batch_status == REMOTE_FS_RESP_OK && rx_take(&reply[1], 1) == 0)
+            {
+                return;
+            }
+            rx_have = 0;
+            server_ranges = rx_batch_status == REMOTE_FS_RESP_OK && (reply[1] & REMOTE_FS_CAP_RANGES);
+            printf("[REMOTE_FS] Server ready%s, %u requests pending\n", server_ranges ? " (ranges)" : "",
+                   window_count);
+            state = REMOTE_FS_READY;
+            window_sent = 0;
+            send_window();
+            continue;
+        }
+
+        // One status byte per wire request, then the data of each sector it covers
+        const remote_fs_request_t* request = &window[window_head];
+        if (rx_batch_left == 0)
+        {
+            if (window_sent == 0)
+            {
+                printf("[REMOTE_FS] Unexpected data from server, reconnecting\n");
+                reset_pending = true;
+                return;
+            }
+            rx_take(&rx_batch_status, 1);
+            rx_batch_left = window_batch[window_head];
+        }
+
+        // Errors carry no data, even for reads
+        if (request->cmd == REMOTE_FS_CMD_READ_SECTOR && rx_batch_status == REMOTE_FS_RESP_OK)
+        {
+            rx_have += rx_take(&rx_response.data[rx_have], REMOTE_FS_SECTOR_SIZE - rx_have);
+            if (rx_have < REMOTE_FS_SECTOR_SIZE)
+            {
+                return;
+            }
+        }
+
+        rx_response.cmd = request->cmd;
+        rx_response.drive = request->drive;
+        rx_response.track = request->track;
+        rx_response.sector = request->sector;
+        rx_response.status = rx_batch_status;
+
+        // Request answered, drop it from the window
+        window_head = (uint8_t)((window_head + 1) % REMOTE_FS_WINDOW);
+        window_count--;
+        window_sent--;
+        rx_batch_left--;
+        rx_have = 0;
+        rx_ready = true;
+        send_window();
+    }
+}
+
+// Forget the connection, keeping unanswered requests for the next one
+static void connection_lost(void)
+{
+    if (rx_pbuf != NULL)
+    {
+        pbuf_free(rx_pbuf);
+        rx_pbuf = NULL;
+    }
+    rx_have = 0;
+    rx_batch_left = 0;
+    window_sent = 0;
+    reset_pending = false;
+    server_ranges = false;
+    state = REMOTE_FS_IDLE;
+    retry_wait = true;
+    retry_at_us = time_us_32() + REMOTE_FS_RETRY_US;
+}
+
+static void close_connection(void)
+{
+    if (pcb != NULL)
+    {
+        tcp_arg(pcb, NULL);
+        tcp_recv(pcb, NULL);
+        tcp_err(pcb, NULL);
+        if (tcp_close(pcb) != ERR_OK)
+        {
+            tcp_abort(pcb);
+        }
+        pcb = NULL;
+    }
+    connection_lost();
+}
+
+// lwIP callback: connection failed or was reset, the pcb is already freed
+static void remote_fs_err_callback(void* arg, err_t err)
+{
+    (void)arg;
+    printf("[REMOTE_FS] Connection to %s:%d lost (err %d)\n", REMOTE_FS_SERVER_IP, REMOTE_FS_SERVER_PORT, err);
+    pcb = NULL;
+    connection_lost();
+}
+
+// lwIP callback: data received, or the server closed the connection (p == NULL)
+static err_t remote_fs_recv_callback(void* arg, struct tcp_pcb* tpcb, struct pbuf* p, err_t err)
+{
+    (void)arg;
+    (void)tpcb;
+
+    if (p == NULL || err != ERR_OK)
+    {
+        if (p != NULL)
+        {
+            pbuf_free(p);
+        }
+        printf("[REMOTE_FS] Server closed the connection\n");
+        reset_pending = true;
+        return ERR_OK;
+    }
+
+    if (rx_pbuf == NULL)
+    {
+        rx_pbuf = p;
+    }
+    else
+    {
+        pbuf_cat(rx_pbuf, p);
+    }
+    rx_process();
+    return ERR_OK;
+}
+
+// lwIP callback: connected, open the session with INIT
+static err_t remote_fs_connected_callback(void* arg, struct tcp_pcb* tpcb, err_t err)
+{
+    (void)arg;
+
+    if (err != ERR_OK)
+    {
+        return err;
+    }
+
+    static const uint8_t init = REMOTE_FS_CMD_INIT;
+    printf("[REMOTE_FS] Connected to %s:%d\n", REMOTE_FS_SERVER_IP, REMOTE_FS_SERVER_PORT);
+    state = REMOTE_FS_INIT;
+    tcp_write(tpcb, &init, 1, TCP_WRITE_FLAG_COPY);
+    tcp_output(tpcb);
+    return ERR_OK;
+}
+
+static void start_connect(void)
+{
+    ip_addr_t addr;
+    if (!ipaddr_aton(REMOTE_FS_SERVER_IP, &addr))
+    {
+        printf("[REMOTE_FS] Invalid server address %s\n", REMOTE_FS_SERVER_IP);
+        connection_lost();
+        return;
+    }
+
+    pcb = tcp_new_ip_type(IP_GET_TYPE(&addr));
+    if (pcb == NULL)
+    {
+        connection_lost();
+        return;
+    }
+
+    tcp_err(pcb, remote_fs_err_callback);
+    tcp_recv(pcb, remote_fs_recv_callback);
+    tcp_nagle_disable(pcb); // Requests are tiny and latency bound
+
+    state = REMOTE_FS_CONNECTING;
+    if (tcp_connect(pcb, &addr, REMOTE_FS_SERVER_PORT, remote_fs_connected_callback) != ERR_OK)
+    {
+        close_connection();
+    }
+}
+
+void remote_fs_init(void)
+{
+    // Initialize queues
+    queue_init(&outbound_queue, sizeof(remote_fs_request_t), OUTBOUND_QUEUE_SIZE);
+    queue_init(&inbound_queue, sizeof(remote_fs_response_t), INBOUND_QUEUE_SIZE);
+}
+
+void remote_fs_poll(void)
+{
+    if (reset_pending)
+    {
+        close_connection();
+    }
+
+    if (state == REMOTE_FS_IDLE && (!retry_wait || (int32_t)(time_us_32() - retry_at_us) >= 0))
+    {
+        retry_wait = false;
+        start_connect();
+    }
+
+    // Take new requests from core 0 into the window
+    while (window_count < REMOTE_FS_WINDOW &&
+           queue_try_remove(&outbound_queue, &window[(window_head + window_count) % REMOTE_FS_WINDOW]))
+    {
+        window_count++;
+    }
+
+    // Resume a response core 0 had no room for, then send what is new
+    rx_process();
+    send_window();
+}
+
+bool remote_fs_connected(void)
+{
+    return state == REMOTE_FS_READY;
+}
+
+void remote_fs_queues(queue_t** outbound, queue_t** inbound)
+{
+    *outbound = &outbound_queue;
+    *inbound = &inbound_queue;
+}
+
+#else // !CYW43_WL_GPIO_LED_PIN - Stub implementations for non-WiFi boards
+
+void remote_fs_init(void)
+{
+    // No-op on non-WiFi boards
+}
+
+void remote_fs_poll(void)
+{
+    // No-op on non-WiFi boards
+}
+
+bool remote_fs_connected(void)
+{
+    return false;
+}
+
+void remote_fs_queues(queue_t** outbound, queue_t** inbound)
+{
+    // No-op on non-WiFi boards
+    *outbound = NULL;
+    *inbound = NULL;
+}
+
+#endif // CYW43_WL_GPIO_LED_PIN
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/util/queue.h"
+
+// Client for RemoteFS/remote_fs_server.py, the sector server's TCP protocol
+#define REMOTE_FS_CMD_READ_SECTOR 0x01
+#define REMOTE_FS_CMD_WRITE_SECTOR 0x02
+#define REMOTE_FS_CMD_INIT 0x03
+#define REMOTE_FS_CMD_READ_RANGE 0x04
+#define REMOTE_FS_CMD_WRITE_RANGE 0x05
+#define REMOTE_FS_CMD_CAPS 0x06
+
+#define REMOTE_FS_RESP_OK 0x00
+#define REMOTE_FS_RESP_ERROR 0xFF
+
+// CAPS bits, servers without CAPS answer it with REMOTE_FS_RESP_ERROR
+#define REMOTE_FS_CAP_RANGES 0x01
+#define REMOTE_FS_CAP_ZLIB 0x02
+
+#define REMOTE_FS_SECTOR_SIZE 137
+
+#ifndef REMOTE_FS_SERVER_IP
+#define REMOTE_FS_SERVER_IP "192.168.1.151"
+#endif
+#ifndef REMOTE_FS_SERVER_PORT
+#define REMOTE_FS_SERVER_PORT 8080
+#endif
+
+// Requests sent to the server and not yet answered. The server answers in order, so this many
+// sector reads are in flight while the guest consumes the one before. Consecutive reads of a
+// track in the window go out as one READ_RANGE when the server supports it.
+#ifndef REMOTE_FS_WINDOW
+#define REMOTE_FS_WINDOW 16
+#endif
+
+// Delay before reconnecting after the connection failed or was closed
+#define REMOTE_FS_RETRY_US 2000000
+
+// Sector request (Core 0 -> Core 1)
+typedef struct
+{
+    uint8_t cmd; // REMOTE_FS_CMD_READ_SECTOR or REMOTE_FS_CMD_WRITE_SECTOR
+    uint8_t drive;
+    uint8_t track;
+    uint8_t sector;
+    uint8_t data[REMOTE_FS_SECTOR_SIZE]; // WRITE_SECTOR only
+} remote_fs_request_t;
+
+// Sector response (Core 1 -> Core 0), in request order
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t drive;
+    uint8_t track;
+    uint8_t sector;
+    uint8_t status;                      // REMOTE_FS_RESP_OK or REMOTE_FS_RESP_ERROR
+    uint8_t data[REMOTE_FS_SECTOR_SIZE]; // READ_SECTOR with status OK only
+} remote_fs_response_t;
+
+/**
+ * Initialize the RemoteFS client
+ * Creates queues for inter-core communication
+ * Must be called before starting Core 1 operations
+ */
+void remote_fs_init(void);
+
+/**
+ * Connect to the server, send queued requests and hand back responses
+ * Called from Core 1's main loop
+ */
+void remote_fs_poll(void);
+
+/**
+ * True while the client holds a connection that answered INIT
+ */
+bool remote_fs_connected(void);
+
+/**
+ * Get pointers to the RemoteFS queues
+ * Used by the remote disk controller on core 0
+ *
+ * @param outbound Pointer to receive outbound queue pointer (Core 0 -> Core 1)
+ * @param inbound Pointer to receive inbound queue pointer (Core 1 -> Core 0)
+ */
+void remote_fs_queues(queue_t** outbound, queue_t** inbound);
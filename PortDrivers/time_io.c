@@ -1,4 +1,6 @@
 #include "PortDrivers/time_io.h"
+#include "cpu_state.h"
+#include "io_ports.h"
 
 #include "pico/stdlib.h"
 #include "pico/time.h"
@@ -12,16 +14,63 @@
 #define TIMER_1 1
 #define TIMER_2 2
 #define NUM_MS_TIMERS 3
+#define TIMER_SECONDS 3 // Bit TIME_TIMER_SECONDS
+#define NUM_TIMERS 4
 
-static uint64_t ms_timer_targets[NUM_MS_TIMERS] = {0, 0, 0};
+// Timers run against time_us_32(): the longest, 65.5 s or 255 s, is well inside its 71-minute
+// wrap, so an expiry check is a 32-bit compare
+static uint32_t timer_due_us[NUM_TIMERS];
 static uint16_t ms_timer_delays[NUM_MS_TIMERS] = {0, 0, 0};
-static uint64_t seconds_timer_target = 0;
+static uint8_t timers_running = 0;   // Bit n: timer n has not expired
+static uint8_t timer_interrupts = 0; // Bit n: timer n raises timer_rst when it expires
+static uint8_t timer_rst = TIME_TIMER_RST;
+
+// Binary counters, room for TIME_COUNTER_PERF
+static uint8_t counter_latch[12];
+static uint8_t counter_length = 0;
+static uint8_t counter_pos = 0;
+static uint8_t ms_high_latch = 0;
+
+// Interrupt clock
+static uint32_t rtc_period_us = 0;
+static uint32_t rtc_next_us = 0;
+static uint8_t rtc_rst = TIME_RTC_RST;
+static uint8_t rtc_ticks = 0;
 
 static inline uint64_t get_elapsed_ms(void)
 {
     return to_ms_since_boot(get_absolute_time());
 }
 
+static void timer_start(int timer, uint32_t delay_us)
+{
+    timer_due_us[timer] = time_us_32() + delay_us;
+    timers_running |= (uint8_t)(1u << timer);
+}
+
+// Stop the timers that are due and raise the timer interrupt for the enabled ones, whether the
+// guest or time_io_poll looks first. Returns the timers still running.
+static uint8_t timers_update(uint32_t now_us)
+{
+    uint8_t expired = 0;
+    for (int i = 0; i < NUM_TIMERS; i++)
+    {
+        if ((timers_running & (1u << i)) && (int32_t)(now_us - timer_due_us[i]) >= 0)
+        {
+            expired |= (uint8_t)(1u << i);
+        }
+    }
+    if (expired)
+    {
+        timers_running &= (uint8_t)~expired;
+        if (expired & timer_interrupts)
+        {
+            i8080_interrupt(&cpu, timer_rst);
+        }
+    }
+    return timers_running;
+}
+
 static int get_timer_index(int port)
 {
     switch (port)
@@ -96,11 +145,11 @@ size_t time_output(int port, uint8_t data, char* buffer, size_t buffer_length)
             if (timer_idx >= 0 && timer_idx < NUM_MS_TIMERS)
             {
                 ms_timer_delays[timer_idx] = (ms_timer_delays[timer_idx] & 0xFF00u) | data;
-                ms_timer_targets[timer_idx] = get_elapsed_ms() + ms_timer_delays[timer_idx];
+                timer_start(timer_idx, (uint32_t)ms_timer_delays[timer_idx] * 1000u);
             }
             break;
         case 30:
-            seconds_timer_target = get_elapsed_ms() / 1000ULL + data;
+            timer_start(TIMER_SECONDS, (uint32_t)data * 1000000u);
             break;
         case 41:
             len = (size_t)snprintf(buffer, buffer_length, "%llu", (unsigned long long)(get_elapsed_ms() / 1000ULL));
@@ -131,45 +180,21 @@ uint8_t time_input(uint8_t port)
         case 27:
         case 28:
         case 29:
-            if (timer_idx >= 0 && timer_idx < NUM_MS_TIMERS)
+            if (timer_idx >= 0 && timer_idx < NUM_MS_TIMERS && timers_running)
             {
-                uint64_t target_time = ms_timer_targets[timer_idx];
-                if (target_time > 0 && get_elapsed_ms() >= target_time)
+                retVal = (timers_update(time_us_32()) >> timer_idx) & 1u;
+                if (!retVal)
                 {
-                    ms_timer_targets[timer_idx] = 0;
                     ms_timer_delays[timer_idx] = 0;
-                    retVal = 0;
-                }
-                else if (target_time > 0)
-                {
-                    retVal = 1;
-                }
-                else
-                {
-                    retVal = 0;
                 }
             }
             break;
         case 30:
-        {
-            uint64_t target_time = seconds_timer_target;
-            uint64_t now_seconds = get_elapsed_ms() / 1000ULL;
-
-            if (target_time > 0 && now_seconds >= target_time)
+            if (timers_running)
             {
-                seconds_timer_target = 0;
-                retVal = 0;
+                retVal = (timers_update(time_us_32()) >> TIMER_SECONDS) & 1u;
             }
-            else if (target_time > 0)
-            {
-                retVal = 1;
-            }
-            else
-            {
-                retVal = 0;
-            }
-        }
-        break;
+            break;
         default:
             retVal = 0;
             break;
@@ -177,3 +202,173 @@ uint8_t time_input(uint8_t port)
 
     return retVal;
 }
+
+static void counter_store(size_t offset, uint32_t value)
+{
+    for (size_t i = 0; i < 4; i++)
+    {
+        counter_latch[offset + i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+// The CPU counters are those of the OUT to TIME_COUNTER_PORT, up to date in the port handlers
+static void counter_latch_value(uint8_t counter)
+{
+    uint32_t value;
+    counter_pos = 0;
+    switch (counter)
+    {
+        case TIME_COUNTER_MS:
+            value = (uint32_t)get_elapsed_ms();
+            break;
+        case TIME_COUNTER_SECONDS:
+            value = (uint32_t)(time_us_64() / 1000000ULL);
+            break;
+        case TIME_COUNTER_UNIX:
+            value = (uint32_t)time(NULL);
+            break;
+        case TIME_COUNTER_US:
+            value = time_us_32();
+            break;
+        case TIME_COUNTER_T_STATES:
+            value = cpu.t_states;
+            break;
+        case TIME_COUNTER_INSTRUCTIONS:
+            value = cpu.instruction_count;
+            break;
+        case TIME_COUNTER_PERF:
+            counter_store(0, cpu.t_states);
+            counter_store(4, cpu.instruction_count);
+            counter_store(8, time_us_32());
+            counter_length = 12;
+            return;
+        default:
+            value = 0;
+            break;
+    }
+    counter_store(0, value);
+    counter_length = 4;
+}
+
+static uint8_t binary_port_in(void* context, uint8_t port)
+{
+    (void)context;
+    switch (port)
+    {
+        case TIME_COUNTER_PORT:
+            return counter_pos < counter_length ? counter_latch[counter_pos++] : 0;
+        case TIME_MS_LOW_PORT:
+        {
+            uint16_t ms = (uint16_t)get_elapsed_ms();
+            ms_high_latch = (uint8_t)(ms >> 8);
+            return (uint8_t)ms;
+        }
+        case TIME_MS_HIGH_PORT:
+            return ms_high_latch;
+        case TIME_TIMER_STATUS_PORT:
+            return timers_running ? timers_update(time_us_32()) : 0;
+        default:
+            return 0;
+    }
+}
+
+static void binary_port_out(void* context, uint8_t port, uint8_t data)
+{
+    (void)context;
+    switch (port)
+    {
+        case TIME_COUNTER_PORT:
+            counter_latch_value(data);
+            break;
+        case TIME_TIMER_STATUS_PORT:
+            timer_interrupts = data & ((1u << NUM_TIMERS) - 1);
+            break;
+        case TIME_TIMER_RST_PORT:
+            timer_rst = data & 7;
+            break;
+        default:
+            break;
+    }
+}
+
+static uint8_t time_port_in(void* context, uint8_t port)
+{
+    (void)context;
+    return time_input(port);
+}
+
+static uint8_t rtc_port_in(void* context, uint8_t port)
+{
+    (void)context;
+    (void)port;
+    uint8_t ticks = rtc_ticks;
+    rtc_ticks = 0;
+    return ticks;
+}
+
+static void rtc_port_out(void* context, uint8_t port, uint8_t data)
+{
+    (void)context;
+    if (port == TIME_RTC_RST_PORT)
+    {
+        rtc_rst = data & 7;
+        return;
+    }
+    rtc_period_us = (uint32_t)data * 1000u;
+    rtc_next_us = time_us_32() + rtc_period_us;
+    rtc_ticks = 0;
+}
+
+void time_io_poll(uint32_t now_us)
+{
+    if (timers_running & timer_interrupts)
+    {
+        timers_update(now_us);
+    }
+
+    if (rtc_period_us == 0 || (int32_t)(now_us - rtc_next_us) < 0)
+    {
+        return;
+    }
+
+    // Missed ticks are counted but requested once, like a latched clock line
+    uint32_t ticks = (now_us - rtc_next_us) / rtc_period_us + 1;
+    rtc_next_us += ticks * rtc_period_us;
+    rtc_ticks = rtc_ticks + ticks < 255 ? (uint8_t)(rtc_ticks + ticks) : 255;
+    i8080_interrupt(&cpu, rtc_rst);
+}
+
+uint8_t time_io_get_rtc(uint8_t* rst)
+{
+    *rst = rtc_rst;
+    return (uint8_t)(rtc_period_us / 1000u);
+}
+
+void time_io_set_rtc(uint8_t period_ms, uint8_t rst)
+{
+    rtc_port_out(NULL, TIME_RTC_RST_PORT, rst);
+    rtc_port_out(NULL, TIME_RTC_PERIOD_PORT, period_ms);
+}
+
+void time_io_register(void)
+{
+    for (uint8_t port = 24; port <= 30; port++)
+    {
+        io_port_register_in(port, time_port_in, NULL);
+        io_port_register_response(port, time_output);
+    }
+    io_port_register_in(TIME_RTC_PERIOD_PORT, rtc_port_in, NULL);
+    io_port_register_out(TIME_RTC_PERIOD_PORT, rtc_port_out, NULL);
+    io_port_register_out(TIME_RTC_RST_PORT, rtc_port_out, NULL);
+    for (uint8_t port = 41; port <= 43; port++)
+    {
+        io_port_register_response(port, time_output);
+    }
+    for (uint8_t port = TIME_COUNTER_PORT; port <= TIME_TIMER_STATUS_PORT; port++)
+    {
+        io_port_register_in(port, binary_port_in, NULL);
+    }
+    io_port_register_out(TIME_COUNTER_PORT, binary_port_out, NULL);
+    io_port_register_out(TIME_TIMER_STATUS_PORT, binary_port_out, NULL);
+    io_port_register_out(TIME_TIMER_RST_PORT, binary_port_out, NULL);
+}
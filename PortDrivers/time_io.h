@@ -5,3 +5,52 @@
 
 size_t time_output(int port, uint8_t data, char* buffer, size_t buffer_length);
 uint8_t time_input(uint8_t port);
+
+// Timer ports 24-30 (IN and OUT), the interrupt clock ports 31-32, the clock ports 41-43
+// (OUT, reply on the response port) and the binary time ports 46-50
+void time_io_register(void);
+
+// Interrupt clock: OUT 31 sets the tick period in ms (0 stops it), OUT 32 the RST it requests
+// (default TIME_RTC_RST). IN 31 returns the ticks since the last IN 31, up to 255, so the
+// interrupt routine can tell how many it missed.
+#define TIME_RTC_PERIOD_PORT 31
+#define TIME_RTC_RST_PORT 32
+#ifndef TIME_RTC_RST
+#define TIME_RTC_RST 6
+#endif
+
+// Binary time ports, no string formatting and no response port:
+//   OUT 46 n latches counter n (TIME_COUNTER_*) and each IN 46 returns its next byte, least
+//   significant first, 0 after the fourth. TIME_COUNTER_PERF latches three counters at once,
+//   12 bytes
+//   IN 47 returns the low byte of a free-running 16-bit millisecond counter and latches its
+//   high byte for IN 48, so a delay or a stopwatch takes two INs
+//   IN 49 returns a bit per running timer (TIME_TIMER_*), OUT 49 the timers whose expiry raises
+//   RST TIME_TIMER_RST (OUT 50 sets the RST)
+// Timers 0-2 are the millisecond timers of ports 24-29, TIME_TIMER_SECONDS that of port 30.
+#define TIME_COUNTER_PORT 46
+#define TIME_MS_LOW_PORT 47
+#define TIME_MS_HIGH_PORT 48
+#define TIME_TIMER_STATUS_PORT 49
+#define TIME_TIMER_RST_PORT 50
+#ifndef TIME_TIMER_RST
+#define TIME_TIMER_RST 4
+#endif
+
+#define TIME_COUNTER_MS 0      // Milliseconds since boot
+#define TIME_COUNTER_SECONDS 1 // Seconds since boot
+#define TIME_COUNTER_UNIX 2    // Seconds since 1970 UTC, 0 until the clock is set
+#define TIME_COUNTER_US 3      // Microseconds since boot, wraps every 71 minutes
+#define TIME_COUNTER_T_STATES 4     // T-states the 8080 ran up to the OUT 46, wraps
+#define TIME_COUNTER_INSTRUCTIONS 5 // Instructions the 8080 ran, counting the OUT 46, wraps
+#define TIME_COUNTER_PERF 6         // T-states, instructions and microseconds in one latch
+
+#define TIME_TIMER_SECONDS 0x08
+
+// Request the clock interrupt once a tick is due, and the timer interrupt once an enabled timer
+// has expired, called from the core 0 loop while running
+void time_io_poll(uint32_t now_us);
+
+// Interrupt clock settings for machine snapshots: the period in ms (0 = stopped) and the RST
+uint8_t time_io_get_rtc(uint8_t* rst);
+void time_io_set_rtc(uint8_t period_ms, uint8_t rst);
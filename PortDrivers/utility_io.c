@@ -1,16 +1,17 @@
 #include "PortDrivers/utility_io.h"
+#include "io_ports.h"
 
 #include "pico/rand.h"
 #include "pico/time.h"
 
 #include "build_version.h"
+#include "metrics.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
 size_t utility_output(int port, uint8_t data, char* buffer, size_t buffer_length)
 {
-    (void)data;
     size_t len = 0;
 
     switch (port)
@@ -25,11 +26,20 @@ size_t utility_output(int port, uint8_t data, char* buffer, size_t buffer_length
                 break;
             }
         case 70: // Load Altair version number
-            if (buffer != NULL && buffer_length > 0)
+            if (data == UTILITY_VERSION_FEATURES && buffer != NULL && buffer_length >= 2)
+            {
+                buffer[0] = (char)UTILITY_FEATURES_MAGIC;
+                buffer[1] = (char)UTILITY_FEATURE_MEMORY_ACCEL;
+                len = 2;
+            }
+            else if (buffer != NULL && buffer_length > 0)
             {
                 len = (size_t)snprintf(buffer, buffer_length, "%s %d (%s %s)\n", PICO_BOARD, BUILD_VERSION, BUILD_DATE, BUILD_TIME);
             }
             break;
+        case 71: // Runtime metrics, data selects the METRIC_ID (0 = text summary)
+            len = metrics_port_output(data, buffer, buffer_length);
+            break;
         default:
             return 0;
     }
@@ -42,3 +52,10 @@ uint8_t utility_input(uint8_t port)
     (void)port;
     return 0;
 }
+
+void utility_io_register(void)
+{
+    io_port_register_response(45, utility_output);
+    io_port_register_response(70, utility_output);
+    io_port_register_response(71, utility_output);
+}
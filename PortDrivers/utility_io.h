@@ -5,3 +5,13 @@
 
 size_t utility_output(int port, uint8_t data, char* buffer, size_t buffer_length);
 uint8_t utility_input(uint8_t port);
+
+// OUT 70 with UTILITY_VERSION_FEATURES replies UTILITY_FEATURES_MAGIC and a byte of
+// UTILITY_FEATURE_* bits instead of the version text. Older builds reply the text, which never
+// holds the magic byte, so a guest can tell the two apart.
+#define UTILITY_VERSION_FEATURES 2
+#define UTILITY_FEATURES_MAGIC 0xA5
+#define UTILITY_FEATURE_MEMORY_ACCEL 0x01 // Block memory accelerator (io_ports.h)
+
+// Random number (45), version (70) and metrics (71) ports, replies on the response port
+void utility_io_register(void);
@@ -3,13 +3,24 @@
 Remote File System Server for Altair 8800 Emulator
 
 This server handles disk sector read/write requests from Pico clients over TCP.
-Each client (identified by IP address) gets their own copy of the disk images,
-allowing multiple Altair emulators to operate independently.
+Each client (identified by IP address) gets its own overlay of the template disk
+images: sectors it writes go to a delta file of its own, everything else is read
+from the shared template, so multiple Altair emulators operate independently.
 
 Protocol:
-- INIT (0x03): Initialize connection, copies disk files if first time for this client
+- INIT (0x03): Initialize connection
 - READ_SECTOR (0x01): drive(1) + track(1) + sector(1) -> status(1) + data(137)
 - WRITE_SECTOR (0x02): drive(1) + track(1) + sector(1) + data(137) -> status(1)
+- READ_RANGE (0x04): drive(1) + track(1) + sector(1) + count(1) + flags(1)
+      -> status(1) + data(count * 137), or with FLAG_ZLIB status(1) + length(2, LE) + zlib data
+- WRITE_RANGE (0x05): drive(1) + track(1) + sector(1) + count(1) + flags(1)
+      + data(count * 137), or with FLAG_ZLIB length(2, LE) + zlib data -> status(1)
+- CAPS (0x06): -> status(1) + capability bits(1)
+
+A range covers count (1-32) consecutive sectors of one track, count 32 from sector 0 is the
+whole track. Servers without CAPS answer it with a single error byte, so clients can probe
+for the range commands safely. Requests on a connection are answered in order, so clients
+may pipeline them.
 
 Response status:
 - 0x00: OK
@@ -18,9 +29,11 @@ Response status:
 
 import os
 import sys
-import socket
-import shutil
+import mmap
 import struct
+import zlib
+import array
+import asyncio
 import threading
 import argparse
 import logging
@@ -30,21 +43,38 @@ from pathlib import Path
 CMD_READ_SECTOR = 0x01
 CMD_WRITE_SECTOR = 0x02
 CMD_INIT = 0x03
+CMD_READ_RANGE = 0x04
+CMD_WRITE_RANGE = 0x05
+CMD_CAPS = 0x06
 
 RESP_OK = 0x00
 RESP_ERROR = 0xFF
 
+# Range flags and capability bits
+FLAG_ZLIB = 0x01
+CAP_RANGES = 0x01
+CAP_ZLIB = 0x02
+
 # Disk geometry (8" floppy)
 SECTOR_SIZE = 137
 SECTORS_PER_TRACK = 32
 MAX_TRACKS = 77
 TRACK_SIZE = SECTORS_PER_TRACK * SECTOR_SIZE
 DISK_SIZE = MAX_TRACKS * TRACK_SIZE
+DISK_SECTORS = MAX_TRACKS * SECTORS_PER_TRACK
+
+# Overlay delta files: one 16-bit little-endian slot number per sector of the disk (0 while the
+# sector still comes from the template), then the written sectors in the order they were first written
+DELTA_SUFFIX = ".delta"
+DELTA_INDEX_SIZE = DISK_SECTORS * 2
 
 # Drive configuration
 MAX_DRIVES = 4
 DISK_NAMES = ["cpm63k.dsk", "bdsc-v1.60.dsk", "escape-posix.dsk", "blank.dsk"]
 
+# Written disk pages are pushed to the files at most this long after the write
+FLUSH_INTERVAL = 1.0
+
 # Configure logging
 logging.basicConfig(
     level=logging.INFO,
@@ -55,174 +85,430 @@ logger = logging.getLogger(__name__)
 
 
 class DiskImage:
-    """Represents a single disk image file"""
+    """Represents a single disk image file, memory mapped on first access"""
     
     def __init__(self, filepath: Path):
         self.filepath = filepath
-        self.lock = threading.Lock()
+        self.file = None
+        self.map = None
+        self.dirty = False
         
-    def read_sector(self, track: int, sector: int) -> bytes:
+    def _open(self) -> bool:
+        """Map the image, growing a short file to the full disk size"""
+        if self.map is not None:
+            return True
+        try:
+            self.file = open(self.filepath, 'r+b')
+            if os.fstat(self.file.fileno()).st_size < DISK_SIZE:
+                self.file.truncate(DISK_SIZE)
+            self.map = mmap.mmap(self.file.fileno(), 0)
+            return True
+        except Exception as e:
+            logger.error(f"Error mapping {self.filepath}: {e}")
+            if self.file:
+                self.file.close()
+                self.file = None
+            return False
+    
+    @staticmethod
+    def _valid(track: int, sector: int, count: int) -> bool:
+        return track < MAX_TRACKS and count >= 1 and sector + count <= SECTORS_PER_TRACK
+    
+    def read_range(self, track: int, sector: int, count: int):
+        """Read consecutive sectors of a track, returns a view into the mapping or None"""
+        if not self._valid(track, sector, count):
+            logger.warning(f"Invalid sector range: track={track}, sector={sector}, count={count}")
+            return None
+        if not self._open():
+            return None
+        offset = track * TRACK_SIZE + sector * SECTOR_SIZE
+        return memoryview(self.map)[offset:offset + count * SECTOR_SIZE]
+    
+    def read_sector(self, track: int, sector: int):
         """Read a sector from the disk image"""
-        if track >= MAX_TRACKS or sector >= SECTORS_PER_TRACK:
-            logger.warning(f"Invalid sector address: track={track}, sector={sector}")
-            return bytes(SECTOR_SIZE)
-            
+        data = self.read_range(track, sector, 1)
+        return data if data is not None else bytes(SECTOR_SIZE)
+    
+    def write_range(self, track: int, sector: int, data) -> bool:
+        """Write consecutive sectors of a track"""
+        count = len(data) // SECTOR_SIZE
+        if len(data) != count * SECTOR_SIZE or not self._valid(track, sector, count):
+            logger.warning(f"Invalid sector range: track={track}, sector={sector}, size={len(data)}")
+            return False
+        if not self._open():
+            return False
         offset = track * TRACK_SIZE + sector * SECTOR_SIZE
-        
-        with self.lock:
-            try:
-                with open(self.filepath, 'rb') as f:
-                    f.seek(offset)
-                    data = f.read(SECTOR_SIZE)
-                    if len(data) < SECTOR_SIZE:
-                        data = data + bytes(SECTOR_SIZE - len(data))
-                    return data
-            except Exception as e:
-                logger.error(f"Error reading sector: {e}")
-                return bytes(SECTOR_SIZE)
+        self.map[offset:offset + len(data)] = data
+        self.dirty = True
+        return True
     
     def write_sector(self, track: int, sector: int, data: bytes) -> bool:
         """Write a sector to the disk image"""
-        if track >= MAX_TRACKS or sector >= SECTORS_PER_TRACK:
-            logger.warning(f"Invalid sector address: track={track}, sector={sector}")
-            return False
-            
         if len(data) != SECTOR_SIZE:
             logger.warning(f"Invalid sector data size: {len(data)}")
             return False
-            
+        return self.write_range(track, sector, data)
+    
+    def flush(self):
+        """Write dirty pages of the mapping back to the file"""
+        if self.dirty:
+            try:
+                self.map.flush()
+            except Exception as e:
+                logger.error(f"Error flushing {self.filepath}: {e}")
+            self.dirty = False
+    
+    def close(self):
+        self.flush()
+        if self.map is not None:
+            self.map.close()
+            self.map = None
+        if self.file is not None:
+            self.file.close()
+            self.file = None
+
+
+class TemplateImage:
+    """A template disk image, mapped read-only on first access and shared by all overlays of it"""
+    
+    def __init__(self, filepath: Path):
+        self.filepath = filepath
+        self.file = None
+        self.map = None
+        
+    def _open(self):
+        """Map the image, a missing or short one reads as zeros past its end"""
+        if self.map is not None:
+            return self.map
+        try:
+            self.file = open(self.filepath, 'rb')
+            if os.fstat(self.file.fileno()).st_size >= DISK_SIZE:
+                self.map = memoryview(mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ))
+            else:
+                self.map = memoryview(self.file.read().ljust(DISK_SIZE, b'\0'))
+                self.file.close()
+                self.file = None
+        except FileNotFoundError:
+            logger.warning(f"Template {self.filepath.name} not found, it reads as an empty disk")
+            self.map = memoryview(bytes(DISK_SIZE))
+        except Exception as e:
+            logger.error(f"Error mapping {self.filepath}: {e}")
+            if self.file:
+                self.file.close()
+                self.file = None
+            return None
+        return self.map
+    
+    def read(self, offset: int, length: int):
+        """A view of the template's bytes, or None"""
+        view = self._open()
+        return view[offset:offset + length] if view is not None else None
+    
+    def close(self):
+        if self.map is not None:
+            self.map.release()
+            self.map = None
+        if self.file is not None:
+            self.file.close()
+            self.file = None
+
+
+class OverlayImage(DiskImage):
+    """A client's copy-on-write view of a template: sectors it wrote are kept in a delta file,
+    created on the first write, all others are read from the template"""
+    
+    def __init__(self, template: TemplateImage, filepath: Path):
+        super().__init__(filepath)
+        self.template = template
+        self.index = None  # Slot of each sector in the delta, 0 for the template
+        self.slots = 0  # Slots in use
+        
+    def load_index(self) -> bool:
+        """Read the delta's index, an absent delta is all template"""
+        if self.index is not None:
+            return True
+        self.index = array.array('H', [0]) * DISK_SECTORS
+        self.slots = 0
+        try:
+            with open(self.filepath, 'rb') as f:
+                header = f.read(DELTA_INDEX_SIZE)
+                size = os.fstat(f.fileno()).st_size
+        except FileNotFoundError:
+            return True
+        except Exception as e:
+            logger.error(f"Error reading {self.filepath}: {e}")
+            self.index = None
+            return False
+        if len(header) == DELTA_INDEX_SIZE:
+            self.index = array.array('H')
+            self.index.frombytes(header)
+            if sys.byteorder == 'big':
+                self.index.byteswap()
+        # A slot past the end of the file was not written completely, the sector keeps its old data
+        stored = max(0, (size - DELTA_INDEX_SIZE) // SECTOR_SIZE)
+        for i, slot in enumerate(self.index):
+            if slot > stored:
+                logger.warning(f"{self.filepath}: sector {i} lost its slot {slot}")
+                self.index[i] = 0
+        self.slots = max(self.index, default=0)
+        return True
+    
+    def _open(self) -> bool:
+        """Open the delta for writing, creating it with an empty index"""
+        if self.file is not None:
+            return True
+        if not self.load_index():
+            return False
+        try:
+            if self.filepath.exists():
+                self.file = open(self.filepath, 'r+b')
+            else:
+                self.file = open(self.filepath, 'w+b')
+                self.file.write(bytes(DELTA_INDEX_SIZE))
+                self.file.flush()
+            return True
+        except Exception as e:
+            logger.error(f"Error opening {self.filepath}: {e}")
+            self.file = None
+            return False
+    
+    def _slot_offset(self, slot: int) -> int:
+        return DELTA_INDEX_SIZE + (slot - 1) * SECTOR_SIZE
+    
+    def read_range(self, track: int, sector: int, count: int):
+        """Read consecutive sectors of a track, a view into the template while none were written"""
+        if not self._valid(track, sector, count):
+            logger.warning(f"Invalid sector range: track={track}, sector={sector}, count={count}")
+            return None
+        if not self.load_index():
+            return None
+        first = track * SECTORS_PER_TRACK + sector
         offset = track * TRACK_SIZE + sector * SECTOR_SIZE
+        slots = self.index[first:first + count]
+        if not any(slots):
+            return self.template.read(offset, count * SECTOR_SIZE)
+        if not self._open():
+            return None
         
-        with self.lock:
+        data = bytearray()
+        for i, slot in enumerate(slots):
+            if slot:
+                self.file.seek(self._slot_offset(slot))
+                data += self.file.read(SECTOR_SIZE)
+            else:
+                view = self.template.read(offset + i * SECTOR_SIZE, SECTOR_SIZE)
+                if view is None:
+                    return None
+                data += view
+        return memoryview(data)
+    
+    def write_range(self, track: int, sector: int, data) -> bool:
+        """Write consecutive sectors of a track into their slots, giving new sectors one at the
+        end of the delta. The data is there before the index points at it"""
+        count = len(data) // SECTOR_SIZE
+        if len(data) != count * SECTOR_SIZE or not self._valid(track, sector, count):
+            logger.warning(f"Invalid sector range: track={track}, sector={sector}, size={len(data)}")
+            return False
+        if not self._open():
+            return False
+        first = track * SECTORS_PER_TRACK + sector
+        try:
+            new = []
+            for i in range(count):
+                slot = self.index[first + i]
+                if not slot:
+                    self.slots += 1
+                    slot = self.slots
+                    new.append((first + i, slot))
+                self.file.seek(self._slot_offset(slot))
+                self.file.write(data[i * SECTOR_SIZE:(i + 1) * SECTOR_SIZE])
+            if new:
+                self.file.flush()
+                for i, slot in new:
+                    self.file.seek(i * 2)
+                    self.file.write(struct.pack('<H', slot))
+                    self.index[i] = slot
+            self.file.flush()
+        except Exception as e:
+            logger.error(f"Error writing {self.filepath}: {e}")
+            return False
+        self.dirty = True
+        return True
+    
+    def flush(self):
+        """Push the delta to the disk"""
+        if self.dirty:
             try:
-                with open(self.filepath, 'r+b') as f:
-                    f.seek(offset)
-                    f.write(data)
-                    f.flush()
-                return True
+                os.fsync(self.file.fileno())
             except Exception as e:
-                logger.error(f"Error writing sector: {e}")
-                return False
+                logger.error(f"Error flushing {self.filepath}: {e}")
+            self.dirty = False
+    
+    def reset(self):
+        """Back to the template: drop the delta"""
+        self.close()
+        self.filepath.unlink(missing_ok=True)
+        self.index = None
+    
+    def close(self):
+        self.flush()
+        if self.file is not None:
+            self.file.close()
+            self.file = None
 
 
 class ClientSession:
     """Handles a single client connection"""
     
-    def __init__(self, conn: socket.socket, addr: tuple, client_dir: Path, disks: list):
-        self.conn = conn
-        self.addr = addr
-        self.client_ip = addr[0]
-        self.client_dir = client_dir
+    def __init__(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter, client_ip: str, disks: list):
+        self.reader = reader
+        self.writer = writer
+        self.client_ip = client_ip
         self.disks = disks
-        self.running = True
         
-    def handle(self):
+    async def handle(self):
         """Main handler loop for client connection"""
         logger.info(f"Client connected: {self.client_ip}")
         
+        handlers = {
+            CMD_INIT: self._handle_init,
+            CMD_READ_SECTOR: self._handle_read_sector,
+            CMD_WRITE_SECTOR: self._handle_write_sector,
+            CMD_READ_RANGE: self._handle_read_range,
+            CMD_WRITE_RANGE: self._handle_write_range,
+            CMD_CAPS: self._handle_caps,
+        }
+        
         try:
-            while self.running:
+            while True:
                 # Read command byte
-                cmd_data = self._recv_exact(1)
-                if not cmd_data:
-                    break
-                    
-                cmd = cmd_data[0]
+                cmd = (await self.reader.readexactly(1))[0]
                 
-                if cmd == CMD_INIT:
-                    self._handle_init()
-                elif cmd == CMD_READ_SECTOR:
-                    self._handle_read_sector()
-                elif cmd == CMD_WRITE_SECTOR:
-                    self._handle_write_sector()
-                else:
+                handler = handlers.get(cmd)
+                if handler is None:
                     logger.warning(f"Unknown command: 0x{cmd:02X}")
-                    self.conn.sendall(bytes([RESP_ERROR]))
+                    self.writer.write(bytes([RESP_ERROR]))
+                else:
+                    await handler()
+                
+                # Only waits when the client stops reading and the send buffer fills up
+                await self.writer.drain()
                     
+        except asyncio.IncompleteReadError:
+            logger.info(f"Client disconnected: {self.client_ip}")
+        except asyncio.CancelledError:
+            logger.info(f"Client reconnected, dropping old connection: {self.client_ip}")
+            raise
         except ConnectionResetError:
             logger.info(f"Client disconnected: {self.client_ip}")
         except Exception as e:
             logger.error(f"Error handling client {self.client_ip}: {e}")
         finally:
-            self.conn.close()
+            for disk in self.disks:
+                disk.flush()
+            self.writer.close()
             logger.info(f"Connection closed: {self.client_ip}")
     
-    def _recv_exact(self, size: int) -> bytes:
-        """Receive exactly 'size' bytes from the connection"""
-        data = b''
-        while len(data) < size:
-            chunk = self.conn.recv(size - len(data))
-            if not chunk:
-                return None
-            data += chunk
-        return data
-    
-    def _handle_init(self):
+    def _disk(self, drive: int):
+        if drive >= MAX_DRIVES or drive >= len(self.disks):
+            logger.warning(f"Invalid drive: {drive}")
+            return None
+        return self.disks[drive]
+    
+    async def _handle_init(self):
         """Handle INIT command"""
         logger.info(f"INIT from {self.client_ip}")
-        self.conn.sendall(bytes([RESP_OK]))
+        self.writer.write(bytes([RESP_OK]))
     
-    def _handle_read_sector(self):
+    async def _handle_caps(self):
+        """Handle CAPS command"""
+        self.writer.write(bytes([RESP_OK, CAP_RANGES | CAP_ZLIB]))
+    
+    async def _handle_read_sector(self):
         """Handle READ_SECTOR command"""
         # Read drive, track, sector
-        params = self._recv_exact(3)
-        if not params:
-            return
-            
-        drive, track, sector = params[0], params[1], params[2]
+        drive, track, sector = await self.reader.readexactly(3)
         
-        if drive >= MAX_DRIVES or drive >= len(self.disks):
-            logger.warning(f"Invalid drive: {drive}")
-            self.conn.sendall(bytes([RESP_ERROR]))
+        disk = self._disk(drive)
+        if disk is None:
+            self.writer.write(bytes([RESP_ERROR]))
             return
             
-        disk = self.disks[drive]
-        data = disk.read_sector(track, sector)
-        
         # Send response: status + data
-        response = bytes([RESP_OK]) + data
-        self.conn.sendall(response)
+        self.writer.write(bytes([RESP_OK]))
+        self.writer.write(disk.read_sector(track, sector))
         
-        logger.info(f"[{self.client_ip}] READ:  drive={drive}, track={track:02d}, sector={sector:02d}")
+        logger.debug(f"[{self.client_ip}] READ:  drive={drive}, track={track:02d}, sector={sector:02d}")
     
-    def _handle_write_sector(self):
+    async def _handle_write_sector(self):
         """Handle WRITE_SECTOR command"""
         # Read drive, track, sector, data
-        params = self._recv_exact(3)
-        if not params:
-            return
+        drive, track, sector = await self.reader.readexactly(3)
+        data = await self.reader.readexactly(SECTOR_SIZE)
             
-        drive, track, sector = params[0], params[1], params[2]
-        
-        data = self._recv_exact(SECTOR_SIZE)
-        if not data:
+        disk = self._disk(drive)
+        if disk is None:
+            self.writer.write(bytes([RESP_ERROR]))
             return
             
-        if drive >= MAX_DRIVES or drive >= len(self.disks):
-            logger.warning(f"Invalid drive: {drive}")
-            self.conn.sendall(bytes([RESP_ERROR]))
-            return
-            
-        disk = self.disks[drive]
         success = disk.write_sector(track, sector, data)
+        self.writer.write(bytes([RESP_OK if success else RESP_ERROR]))
+        
+        logger.debug(f"[{self.client_ip}] WRITE: drive={drive}, track={track:02d}, sector={sector:02d}, success={success}")
+    
+    async def _handle_read_range(self):
+        """Handle READ_RANGE command"""
+        drive, track, sector, count, flags = await self.reader.readexactly(5)
+        
+        disk = self._disk(drive)
+        data = disk.read_range(track, sector, count) if disk is not None else None
+        if data is None:
+            self.writer.write(bytes([RESP_ERROR]))
+            return
         
-        self.conn.sendall(bytes([RESP_OK if success else RESP_ERROR]))
+        if flags & FLAG_ZLIB:
+            packed = zlib.compress(data, 1)
+            self.writer.write(struct.pack('<BH', RESP_OK, len(packed)) + packed)
+        else:
+            self.writer.write(bytes([RESP_OK]))
+            self.writer.write(data)
         
-        logger.info(f"[{self.client_ip}] WRITE: drive={drive}, track={track:02d}, sector={sector:02d}, success={success}")
+        logger.debug(f"[{self.client_ip}] READ:  drive={drive}, track={track:02d}, sectors={sector:02d}-{sector + count - 1:02d}")
+    
+    async def _handle_write_range(self):
+        """Handle WRITE_RANGE command"""
+        drive, track, sector, count, flags = await self.reader.readexactly(5)
+        
+        if flags & FLAG_ZLIB:
+            (length,) = struct.unpack('<H', await self.reader.readexactly(2))
+            try:
+                data = zlib.decompress(await self.reader.readexactly(length))
+            except zlib.error as e:
+                logger.warning(f"Invalid compressed range: {e}")
+                data = None
+        else:
+            data = await self.reader.readexactly(count * SECTOR_SIZE)
+        
+        disk = self._disk(drive)
+        success = (disk is not None and data is not None and len(data) == count * SECTOR_SIZE and
+                   disk.write_range(track, sector, data))
+        self.writer.write(bytes([RESP_OK if success else RESP_ERROR]))
+        
+        logger.debug(f"[{self.client_ip}] WRITE: drive={drive}, track={track:02d}, sectors={sector:02d}-{sector + count - 1:02d}, success={success}")
 
 
 class RemoteFSServer:
-    """Remote File System Server"""
+    """Remote File System Server, one asyncio task per client connection"""
     
     def __init__(self, host: str, port: int, template_dir: Path, clients_dir: Path):
         self.host = host
         self.port = port
         self.template_dir = template_dir
         self.clients_dir = clients_dir
-        self.running = False
-        self.server_socket = None
-        self.client_disks = {}  # client_ip -> [DiskImage, ...]
-        self.lock = threading.Lock()
+        self.client_disks = {}  # client_ip -> [DiskImage or OverlayImage, ...]
+        self.sessions = {}  # client_ip -> task serving its current connection
+        self.lock = threading.Lock()  # First-connect setup runs in the executor
+        self.templates = [TemplateImage(template_dir / disk_name) for disk_name in DISK_NAMES]
         
     def _get_client_dir(self, client_ip: str) -> Path:
         """Get the directory for a specific client, create if needed"""
@@ -232,22 +518,8 @@ class RemoteFSServer:
         
         with self.lock:
             if not client_dir.exists():
-                # First time for this client - copy template disks
                 logger.info(f"Creating disk folder for new client: {client_ip}")
                 client_dir.mkdir(parents=True, exist_ok=True)
-                
-                # Copy disk images from template directory
-                for disk_name in DISK_NAMES:
-                    src = self.template_dir / disk_name
-                    dst = client_dir / disk_name
-                    if src.exists():
-                        logger.info(f"  Copying {disk_name}...")
-                        shutil.copy2(src, dst)
-                    else:
-                        # Create empty disk if template doesn't exist
-                        logger.warning(f"  Template {disk_name} not found, creating empty disk")
-                        with open(dst, 'wb') as f:
-                            f.write(bytes(DISK_SIZE))
                             
         return client_dir
     
@@ -259,15 +531,77 @@ class RemoteFSServer:
                 
         client_dir = self._get_client_dir(client_ip)
         
+        # A full copy made by an older server stays in use, otherwise the client gets an overlay
         disks = []
-        for disk_name in DISK_NAMES:
+        for disk_name, template in zip(DISK_NAMES, self.templates):
             disk_path = client_dir / disk_name
-            disks.append(DiskImage(disk_path))
+            if disk_path.exists():
+                disks.append(DiskImage(disk_path))
+            else:
+                overlay = OverlayImage(template, client_dir / (disk_name + DELTA_SUFFIX))
+                overlay.load_index()
+                disks.append(overlay)
             
         with self.lock:
-            self.client_disks[client_ip] = disks
-            
-        return disks
+            return self.client_disks.setdefault(client_ip, disks)
+    
+    def reset_client(self, client_ip: str):
+        """Put the disks of a client, which must not be connected, back to the templates"""
+        client_dir = self._get_client_dir(client_ip)
+        for disk_name, template in zip(DISK_NAMES, self.templates):
+            copy = client_dir / disk_name
+            if copy.exists():
+                copy.unlink()
+            OverlayImage(template, client_dir / (disk_name + DELTA_SUFFIX)).reset()
+        logger.info(f"Disks of {client_ip} reset to the templates")
+    
+    async def _handle_client(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter):
+        client_ip = writer.get_extra_info('peername')[0]
+        
+        # Reading the delta indexes of a new client must not stall the other clients
+        loop = asyncio.get_running_loop()
+        disks = await loop.run_in_executor(None, self._get_client_disks, client_ip)
+        
+        # A reconnecting client resends everything that was not answered. Its old session must
+        # stop first, or a stale write still buffered there could land after a newer one.
+        previous = self.sessions.get(client_ip)
+        if previous is not None:
+            previous.cancel()
+            try:
+                await previous
+            except asyncio.CancelledError:
+                pass
+        
+        task = asyncio.current_task()
+        self.sessions[client_ip] = task
+        try:
+            await ClientSession(reader, writer, client_ip, disks).handle()
+        finally:
+            if self.sessions.get(client_ip) is task:
+                del self.sessions[client_ip]
+    
+    async def _flush_loop(self):
+        """Push written pages of all mapped images to their files"""
+        while True:
+            await asyncio.sleep(FLUSH_INTERVAL)
+            for disks in list(self.client_disks.values()):
+                for disk in disks:
+                    disk.flush()
+    
+    async def serve(self):
+        """Accept clients until cancelled"""
+        server = await asyncio.start_server(self._handle_client, self.host, self.port, reuse_address=True)
+        
+        logger.info(f"Remote FS Server listening on {self.host}:{self.port}")
+        logger.info(f"Template directory: {self.template_dir}")
+        logger.info(f"Client data directory: {self.clients_dir}")
+        
+        flusher = asyncio.ensure_future(self._flush_loop())
+        try:
+            async with server:
+                await server.serve_forever()
+        finally:
+            flusher.cancel()
     
     def start(self):
         """Start the server"""
@@ -288,43 +622,20 @@ class RemoteFSServer:
         
         logger.info(f"Found {len(found_disks)} disk image(s) in template directory")
         
-        # Create server socket
-        self.server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-        self.server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-        self.server_socket.bind((self.host, self.port))
-        self.server_socket.listen(5)
-        
-        self.running = True
-        logger.info(f"Remote FS Server listening on {self.host}:{self.port}")
-        logger.info(f"Template directory: {self.template_dir}")
-        logger.info(f"Client data directory: {self.clients_dir}")
-        
         try:
-            while self.running:
-                try:
-                    conn, addr = self.server_socket.accept()
-                    client_ip = addr[0]
-                    
-                    # Get or create disk images for this client
-                    disks = self._get_client_disks(client_ip)
-                    client_dir = self._get_client_dir(client_ip)
-                    
-                    # Handle client in a new thread
-                    session = ClientSession(conn, addr, client_dir, disks)
-                    thread = threading.Thread(target=session.handle, daemon=True)
-                    thread.start()
-                    
-                except KeyboardInterrupt:
-                    break
-                    
+            asyncio.run(self.serve())
+        except KeyboardInterrupt:
+            pass
         finally:
             self.stop()
     
     def stop(self):
         """Stop the server"""
-        self.running = False
-        if self.server_socket:
-            self.server_socket.close()
+        for disks in self.client_disks.values():
+            for disk in disks:
+                disk.close()
+        for template in self.templates:
+            template.close()
         logger.info("Server stopped")
 
 
@@ -350,6 +661,10 @@ def main():
         default=Path(__file__).parent / 'clients',
         help='Directory for per-client disk storage (default: ./clients)'
     )
+    parser.add_argument(
+        '--reset', metavar='CLIENT_IP',
+        help='Put the disks of a client back to the templates and exit (run with the server stopped)'
+    )
     parser.add_argument(
         '--debug', action='store_true',
         help='Enable debug logging'
@@ -367,6 +682,10 @@ def main():
         clients_dir=args.clients_dir
     )
     
+    if args.reset:
+        server.reset_client(args.reset)
+        return
+    
     try:
         server.start()
     except KeyboardInterrupt:
@@ -1,5 +1,7 @@
 #!/usr/bin/env bash
 # Rebuild static.html.gz and static_html_hex.h from Terminal/index.html.
+# The page is stored gzip-compressed and sent as is with Content-Encoding: gzip. gzip -n leaves
+# out the file name and time, so the same page always gives the same header.
 
 set -euo pipefail
 
@@ -20,7 +22,7 @@ if ! command -v xxd >/dev/null 2>&1; then
 fi
 
 echo "Compressing ${HTML_FILE} -> ${GZIP_FILE}" && \
-  gzip --best -c "${HTML_FILE}" > "${GZIP_FILE}"
+  gzip --best -n -c "${HTML_FILE}" > "${GZIP_FILE}"
 
 echo "Generating ${HEADER_FILE}" && \
   {
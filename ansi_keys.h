@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+
+// Translates ANSI cursor key sequences from a terminal into the control keys CP/M programs
+// expect (WordStar style). Each input stream keeps its own state, so a sequence split between
+// two reads is still recognised. Bytes that are part of a sequence translate to 0x00.
+#define ANSI_KEYS_CTRL(ch) ((ch) & 0x1F)
+
+typedef enum
+{
+    ANSI_KEYS_NORMAL = 0,
+    ANSI_KEYS_ESC,
+    ANSI_KEYS_ESC_BRACKET,
+    ANSI_KEYS_ESC_BRACKET_NUM
+} ANSI_KEYS_STATE;
+
+typedef struct
+{
+    uint8_t state;       // ANSI_KEYS_STATE
+    uint8_t pending_key; // Key to return once the '~' of ESC [ n ~ arrives
+} ansi_keys_t;
+
+static inline uint8_t ansi_keys_translate(ansi_keys_t* keys, uint8_t ch)
+{
+    switch (keys->state)
+    {
+        case ANSI_KEYS_NORMAL:
+            if (ch == 0x1B)
+            {
+                keys->state = ANSI_KEYS_ESC;
+                return 0x00; // Start of escape sequence
+            }
+            if (ch == 0x7F || ch == 0x08)
+            {
+                return (uint8_t)ANSI_KEYS_CTRL('H'); // Map delete/backspace to Ctrl-H (0x08)
+            }
+            return ch;
+
+        case ANSI_KEYS_ESC:
+            if (ch == '[')
+            {
+                keys->state = ANSI_KEYS_ESC_BRACKET;
+                return 0x00; // Control sequence introducer
+            }
+            keys->state = ANSI_KEYS_NORMAL;
+            return ch; // Pass through unknown sequences
+
+        case ANSI_KEYS_ESC_BRACKET:
+            switch (ch)
+            {
+                case 'A':
+                    keys->state = ANSI_KEYS_NORMAL;
+                    return (uint8_t)ANSI_KEYS_CTRL('E'); // Up -> Ctrl-E
+                case 'B':
+                    keys->state = ANSI_KEYS_NORMAL;
+                    return (uint8_t)ANSI_KEYS_CTRL('X'); // Down -> Ctrl-X
+                case 'C':
+                    keys->state = ANSI_KEYS_NORMAL;
+                    return (uint8_t)ANSI_KEYS_CTRL('D'); // Right -> Ctrl-D
+                case 'D':
+                    keys->state = ANSI_KEYS_NORMAL;
+                    return (uint8_t)ANSI_KEYS_CTRL('S'); // Left -> Ctrl-S
+                case '2':
+                    // Insert key sends ESC[2~ - need to consume the tilde
+                    keys->pending_key = (uint8_t)ANSI_KEYS_CTRL('O'); // Insert -> Ctrl-O
+                    keys->state = ANSI_KEYS_ESC_BRACKET_NUM;
+                    return 0x00;
+                case '3':
+                    // Delete key sends ESC[3~ - need to consume the tilde
+                    keys->pending_key = (uint8_t)ANSI_KEYS_CTRL('G'); // Delete -> Ctrl-G
+                    keys->state = ANSI_KEYS_ESC_BRACKET_NUM;
+                    return 0x00;
+                default:
+                    keys->state = ANSI_KEYS_NORMAL;
+                    return 0x00; // Ignore other sequences
+            }
+
+        case ANSI_KEYS_ESC_BRACKET_NUM:
+            keys->state = ANSI_KEYS_NORMAL;
+            if (ch == '~')
+            {
+                // Return the pending key now that we've consumed the tilde
+                uint8_t result = keys->pending_key;
+                keys->pending_key = 0;
+                return result;
+            }
+            keys->pending_key = 0;
+            return 0x00; // Unexpected character, ignore
+    }
+
+    keys->state = ANSI_KEYS_NORMAL;
+    return 0x00;
+}
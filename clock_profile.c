@@ -0,0 +1,134 @@
+#include "clock_profile.h"
+
+#include "pico/stdlib.h"
+#include <stdio.h>
+
+#if ALTAIR_SYS_CLOCK_KHZ > 0
+
+#include "hardware/clocks.h"
+#include "hardware/structs/watchdog.h"
+#include "hardware/vreg.h"
+#include "hardware/watchdog.h"
+#if PICO_RP2350
+#include "hardware/structs/qmi.h"
+#endif
+
+// Watchdog scratch register marking a boot that is trying the raised clock, the SDK uses 4 to 7
+#define CLOCK_TRIAL_SCRATCH 2
+#define CLOCK_TRIAL_MAGIC 0xC10C4B00u
+
+// Flash read by the self-test, through the uncached alias so every word comes over QSPI
+#define SELF_TEST_BYTES (64 * 1024)
+
+static clock_profile_result_t profile_result = CLOCK_PROFILE_STOCK;
+static uint32_t stock_khz;
+
+// Flash words mixed through the multiplier, so both flash timing and the core voltage show in the sum
+static uint32_t self_test_sum(void)
+{
+    const volatile uint32_t* flash = (const volatile uint32_t*)XIP_NOCACHE_NOALLOC_BASE;
+    uint32_t sum = 0x9E3779B9u;
+    for (uint32_t i = 0; i < SELF_TEST_BYTES / sizeof(uint32_t); i++)
+    {
+        sum = (sum ^ flash[i]) * 0x01000193u + (sum >> 13);
+    }
+    return sum;
+}
+
+#if PICO_RP2350
+// Runs from RAM, as flash cannot be read while its timing changes
+static void __no_inline_not_in_flash_func(flash_set_timing)(uint32_t timing)
+{
+    qmi_hw->m[0].timing = timing;
+}
+#endif
+
+clock_profile_result_t clock_profile_apply(void)
+{
+    stock_khz = clock_get_hz(clk_sys) / 1000;
+    if (watchdog_caused_reboot() && watchdog_hw->scratch[CLOCK_TRIAL_SCRATCH] == CLOCK_TRIAL_MAGIC)
+    {
+        watchdog_hw->scratch[CLOCK_TRIAL_SCRATCH] = 0;
+        profile_result = CLOCK_PROFILE_RESET;
+        return profile_result;
+    }
+
+    uint32_t expected = self_test_sum();
+    watchdog_hw->scratch[CLOCK_TRIAL_SCRATCH] = CLOCK_TRIAL_MAGIC;
+    watchdog_enable(CLOCK_PROFILE_TRIAL_MS, true);
+
+    vreg_set_voltage(ALTAIR_VREG_VOLTAGE);
+    busy_wait_us(10 * 1000); // Let the regulator settle
+#if PICO_RP2350
+    // Slow the flash clock down before clk_sys goes up
+    uint32_t stock_timing = qmi_hw->m[0].timing;
+    uint32_t divider = (ALTAIR_SYS_CLOCK_KHZ + CLOCK_PROFILE_FLASH_MAX_KHZ - 1) / CLOCK_PROFILE_FLASH_MAX_KHZ;
+    if (divider > (stock_timing & QMI_M0_TIMING_CLKDIV_BITS) >> QMI_M0_TIMING_CLKDIV_LSB)
+    {
+        flash_set_timing((stock_timing & ~QMI_M0_TIMING_CLKDIV_BITS) | (divider << QMI_M0_TIMING_CLKDIV_LSB));
+    }
+#endif
+
+    if (!set_sys_clock_khz(ALTAIR_SYS_CLOCK_KHZ, false))
+    {
+        profile_result = CLOCK_PROFILE_UNREACHABLE;
+    }
+    else if (self_test_sum() != expected)
+    {
+        set_sys_clock_khz(stock_khz, true);
+        profile_result = CLOCK_PROFILE_FAILED;
+    }
+    else
+    {
+        profile_result = CLOCK_PROFILE_RAISED;
+    }
+    if (profile_result != CLOCK_PROFILE_RAISED)
+    {
+#if PICO_RP2350
+        flash_set_timing(stock_timing);
+#endif
+        vreg_set_voltage(VREG_VOLTAGE_DEFAULT);
+    }
+
+    watchdog_disable();
+    watchdog_hw->scratch[CLOCK_TRIAL_SCRATCH] = 0;
+    return profile_result;
+}
+
+void clock_profile_report(void)
+{
+    switch (profile_result)
+    {
+        case CLOCK_PROFILE_RAISED:
+            printf("System clock: %lu MHz (profile, SDK clock %lu MHz)\n", (unsigned long)(ALTAIR_SYS_CLOCK_KHZ / 1000),
+                   (unsigned long)(stock_khz / 1000));
+            break;
+        case CLOCK_PROFILE_UNREACHABLE:
+            printf("System clock: %lu MHz, the PLL cannot make %lu MHz\n", (unsigned long)(stock_khz / 1000),
+                   (unsigned long)(ALTAIR_SYS_CLOCK_KHZ / 1000));
+            break;
+        case CLOCK_PROFILE_FAILED:
+            printf("System clock: %lu MHz, the self-test failed at %lu MHz\n", (unsigned long)(stock_khz / 1000),
+                   (unsigned long)(ALTAIR_SYS_CLOCK_KHZ / 1000));
+            break;
+        case CLOCK_PROFILE_RESET:
+            printf("System clock: %lu MHz, the last boot hung at %lu MHz\n", (unsigned long)(stock_khz / 1000),
+                   (unsigned long)(ALTAIR_SYS_CLOCK_KHZ / 1000));
+            break;
+        default:
+            break;
+    }
+}
+
+#else
+
+clock_profile_result_t clock_profile_apply(void)
+{
+    return CLOCK_PROFILE_STOCK;
+}
+
+void clock_profile_report(void)
+{
+}
+
+#endif
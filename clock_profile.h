@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// System clock profile chosen with ALTAIR_CLOCK_PROFILE. ALTAIR_SYS_CLOCK_KHZ is 0 for the SDK's clock,
+// otherwise the clock to raise clk_sys to at power-on, with the core voltage ALTAIR_VREG_VOLTAGE.
+#ifndef ALTAIR_SYS_CLOCK_KHZ
+#define ALTAIR_SYS_CLOCK_KHZ 0
+#endif
+
+// Fastest flash clock the RP2350 QMI divider is set for (RP2040 builds set theirs in boot stage 2)
+#define CLOCK_PROFILE_FLASH_MAX_KHZ 100000
+
+// The watchdog resets a boot that does not get through the self-test in this time, and the next
+// boot then stays on the SDK's clock
+#define CLOCK_PROFILE_TRIAL_MS 1000
+
+typedef enum
+{
+    CLOCK_PROFILE_STOCK,       // Built without a profile
+    CLOCK_PROFILE_RAISED,      // Running at ALTAIR_SYS_CLOCK_KHZ
+    CLOCK_PROFILE_UNREACHABLE, // The PLL cannot make ALTAIR_SYS_CLOCK_KHZ
+    CLOCK_PROFILE_FAILED,      // The self-test read different data at the raised clock
+    CLOCK_PROFILE_RESET        // The previous boot hung while trying the raised clock
+} clock_profile_result_t;
+
+/**
+ * Raise the system clock to the build's profile, first thing in main()
+ * Sets the core voltage and flash divider first, then checks flash reads and the ALU against the
+ * results at the SDK's clock. On a mismatch it goes back to the SDK's clock and voltage.
+ */
+clock_profile_result_t clock_profile_apply(void);
+
+// Print the outcome of clock_profile_apply once stdio is up
+void clock_profile_report(void);
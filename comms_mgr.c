@@ -3,11 +3,24 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "hardware/sync.h"
 #include "hardware/timer.h"
 #include "pico/stdlib.h"
 
+#include "FrontPanels/display_2_8.h"
+#include "PortDrivers/disk_fetch.h"
 #include "PortDrivers/http_io.h"
+#include "PortDrivers/printer_io.h"
+#include "metrics.h"
+#include "telnet_console.h"
+#ifdef SD_CARD_SUPPORT
+#include "Altair8800/pico_88dcdd_sd_card.h"
+#endif
+#ifdef REMOTE_FS
+#include "PortDrivers/remote_fs.h"
+#endif
 #include "websocket_console.h"
+#include "wifi_power.h"
 
 // Enable WiFi/WebSocket functionality only if board has WiFi capability
 #if defined(CYW43_WL_GPIO_LED_PIN)
@@ -25,42 +38,33 @@
 #define WIFI_AUTH CYW43_AUTH_WPA2_AES_PSK
 #endif
 
+// Core 0 programs flash while core 1 runs: the embedded disks' patch log and machine snapshots
+// outside SD card builds. Core 1 then has to let itself be parked in RAM.
+#if defined(ALTAIR_FLASH_DISK_LOG) || (defined(ALTAIR_SNAPSHOT) && !defined(SD_CARD_SUPPORT))
+#define CORE1_FLASH_LOCKOUT 1
+#endif
+
 #define WIFI_CONNECT_TIMEOUT_MS 30000
-#define WS_OUTPUT_TIMER_INTERVAL_MS 20
-#define WS_INPUT_TIMER_INTERVAL_MS 5
+
+// Longest core 1 sleeps after a poll pass with nothing to do. The CYW43 interrupt, core 0 (a
+// __sev() after console output and HTTP data it took, a queue_t push for disk and HTTP requests)
+// and the flash lockout wake it earlier; the bound covers the lwIP, WebSocket flush and display
+// timers, which are polled.
+#define CORE1_IDLE_WAIT_US 1000
 
 static void websocket_console_core1_entry(void);
 
 volatile bool console_running = false;
 volatile bool console_initialized = false;
 volatile bool wifi_connected = false;
-volatile bool pending_ws_output = false;
-volatile bool pending_ws_input = false;
 
 char ip_address_buffer[32] = {0};
 static char connected_ssid[WIFI_CONFIG_SSID_MAX_LEN + 1] = {0};
 
-// Timer for periodic WebSocket output
-static struct repeating_timer ws_output_timer;
-
-// Timer for periodic WebSocket input
-static struct repeating_timer ws_input_timer;
-
-// Timer callback for output - fires every 20ms
-static bool ws_output_timer_callback(struct repeating_timer* t)
-{
-    (void)t;
-    pending_ws_output = true;
-    return true; // Keep repeating
-}
-
-// Timer callback for input - fires every 10ms
-static bool ws_input_timer_callback(struct repeating_timer* t)
-{
-    (void)t;
-    pending_ws_input = true;
-    return true; // Keep repeating
-}
+// Outcome of the Wi-Fi bring-up on core 1: 0 on failure or the raw IP address. Passed in memory
+// rather than through the SIO FIFO, which the flash lockout handshake also uses.
+static volatile uint32_t wifi_result_ip = 0;
+static volatile bool wifi_result_ready = false;
 
 static bool wifi_init(void)
 {
@@ -106,9 +110,8 @@ static bool wifi_init(void)
 
     wifi_set_connected(true);
 
-    // Use performance power management mode for better responsiveness
-    // CYW43_PERFORMANCE_PM = short 200ms sleep retention, good balance
-    cyw43_wifi_pm(&cyw43_state, CYW43_PERFORMANCE_PM);
+    // Power save mode from here on follows the console traffic, see wifi_power.h
+    wifi_power_init();
 
     // Get and store IP address
     struct netif* netif = netif_default;
@@ -146,7 +149,22 @@ uint32_t wait_for_wifi(void)
 {
     // Block until core 1 signals Wi-Fi init complete
     // Returns 0 on failure, or raw 32-bit IP address on success
-    return multicore_fifo_pop_blocking();
+    uint32_t ip_raw = 0;
+    while (!wifi_poll_result(&ip_raw))
+    {
+        __wfe();
+    }
+    return ip_raw;
+}
+
+bool wifi_poll_result(uint32_t* ip_raw)
+{
+    if (!__atomic_load_n(&wifi_result_ready, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+    *ip_raw = wifi_result_ip;
+    return true;
 }
 
 const char* get_connected_ssid(void)
@@ -159,8 +177,37 @@ bool websocket_console_is_running(void)
     return console_running && wifi_connected && ws_is_running();
 }
 
+// Core 1 has no network left to serve, but keeps the 2.8" front panel going and must keep
+// answering flash lockout requests
+static void websocket_console_core1_park(void)
+{
+#ifdef DISPLAY_2_8_SUPPORT
+    while (true)
+    {
+        display_2_8_poll(time_us_32());
+        tight_loop_contents();
+    }
+#endif
+#ifdef CORE1_FLASH_LOCKOUT
+    while (true)
+    {
+        __wfe();
+    }
+#endif
+}
+
 static void websocket_console_core1_entry(void)
 {
+#ifdef CORE1_FLASH_LOCKOUT
+    // Let core 0 park this core in RAM while it programs flash
+    multicore_lockout_victim_init();
+#endif
+
+    // The 2.8" front panel is drawn on this core from the bus state core 0 publishes, so its DMA
+    // IRQ is set up here as well
+    display_2_8_init();
+    display_2_8_init_front_panel();
+
     // Initialize Wi-Fi on core 1
     bool wifi_ok = wifi_init();
     wifi_connected = wifi_ok;
@@ -179,11 +226,14 @@ static void websocket_console_core1_entry(void)
             }
         }
     }
-    multicore_fifo_push_blocking(ip_raw);
+    wifi_result_ip = ip_raw;
+    __atomic_store_n(&wifi_result_ready, true, __ATOMIC_RELEASE);
+    __sev();
 
     if (!wifi_ok)
     {
         printf("[Core1] Wi-Fi unavailable, network task exiting\n");
+        websocket_console_core1_park();
         return;
     }
 
@@ -191,27 +241,44 @@ static void websocket_console_core1_entry(void)
     if (!websocket_console_init_server())
     {
         printf("[Core1] Failed to start WebSocket server\n");
+        websocket_console_core1_park();
         return;
     }
 
-    // Start WebSocket timers on Core 1 (after WiFi init)
-    add_repeating_timer_ms(-WS_OUTPUT_TIMER_INTERVAL_MS, ws_output_timer_callback, NULL, &ws_output_timer);
-    printf("[Core1] Started WebSocket output timer (%dms interval)\n", WS_OUTPUT_TIMER_INTERVAL_MS);
-
-    add_repeating_timer_ms(-WS_INPUT_TIMER_INTERVAL_MS, ws_input_timer_callback, NULL, &ws_input_timer);
-    printf("[Core1] Started WebSocket input timer (%dms interval)\n", WS_INPUT_TIMER_INTERVAL_MS);
+    if (!telnet_console_init())
+    {
+        printf("[Core1] Telnet console unavailable\n");
+    }
 
     // Mark console as initialized only after successful network stack initialization
     console_initialized = true;
     printf("[Core1] WebSocket server running, entering poll loop\n");
 
-    // Main poll loop - all CYW43/lwIP access stays on core 1
+    // Main poll loop - all CYW43/lwIP access stays on core 1. A pass that found nothing to do
+    // waits for the next event instead of spinning.
     while (true)
     {
+        uint32_t start_us = time_us_32();
         cyw43_arch_poll();
-        ws_poll(&pending_ws_input, &pending_ws_output);
+        ws_poll(start_us);
+        telnet_console_poll(); // Output the TCP send buffer had no room for
         http_poll(); // Poll for HTTP file transfer requests
-        tight_loop_contents();
+        wifi_power_poll(start_us, ws_has_active_clients() || telnet_console_connected());
+#ifdef SD_CARD_SUPPORT
+        sd_disk_service_poll(); // Track reads/write-backs posted by the 8080 on core 0
+        disk_fetch_core1_poll(); // Disk image download onto the card
+#endif
+        printer_io_core1_poll(); // Print spool onto the card or to the printer URL
+#ifdef REMOTE_FS
+        remote_fs_poll(); // Sector requests for the RemoteFS server
+#endif
+        display_2_8_poll(start_us); // Front panel LEDs at 50 Hz
+        uint32_t elapsed_us = time_us_32() - start_us;
+        metrics_core1_iteration(elapsed_us);
+        if (elapsed_us < METRICS_CORE1_IDLE_US)
+        {
+            best_effort_wfe_or_timeout(make_timeout_time_us(CORE1_IDLE_WAIT_US));
+        }
     }
 }
 
@@ -227,6 +294,12 @@ uint32_t wait_for_wifi(void)
     return 0;
 }
 
+bool wifi_poll_result(uint32_t* ip_raw)
+{
+    *ip_raw = 0;
+    return true;
+}
+
 bool websocket_console_is_running(void)
 {
     return false;
@@ -7,4 +7,6 @@
 
 void websocket_console_start(void);
 uint32_t wait_for_wifi(void);
+// Non-blocking wait_for_wifi: true once core 1 has finished, with its result in ip_raw
+bool wifi_poll_result(uint32_t* ip_raw);
 const char* get_connected_ssid(void);
\ No newline at end of file
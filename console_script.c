@@ -0,0 +1,203 @@
+#include "console_script.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+// Only the WebSocket console takes scripts
+#if defined(CYW43_WL_GPIO_LED_PIN)
+
+#include <string.h>
+
+#include "websocket_console.h"
+
+// Text to type, a ring of CONSOLE_SCRIPT_TYPE_SIZE bytes (core 1)
+static uint8_t type_buffer[CONSOLE_SCRIPT_TYPE_SIZE];
+static size_t type_head = 0; // Next byte to pass to the guest
+static size_t type_level = 0;
+static bool type_report = false; // Send WS_SCRIPT_TYPED once the ring is empty
+
+// The pattern waited for, with the Knuth-Morris-Pratt failure table so a match is found one
+// output byte at a time, also across messages
+static uint8_t pattern[CONSOLE_SCRIPT_PATTERN_MAX];
+static uint8_t pattern_fail[CONSOLE_SCRIPT_PATTERN_MAX];
+static size_t pattern_len = 0; // 0 while no wait is armed
+static size_t pattern_matched = 0;
+static bool wait_timed = false;
+static uint64_t wait_deadline_us;
+
+static uint8_t events[CONSOLE_SCRIPT_EVENTS];
+static size_t event_count = 0;
+
+/**
+ * @brief Queues a device event, dropped if CONSOLE_SCRIPT_EVENTS are already waiting.
+ *
+ * @param event WS_SCRIPT_* event
+ */
+static void console_script_event(uint8_t event)
+{
+    if (event_count < CONSOLE_SCRIPT_EVENTS)
+    {
+        events[event_count++] = event;
+    }
+}
+
+/**
+ * @brief Adds text to the type ring, whole or not at all.
+ *
+ * @param text Bytes to type
+ * @param len Number of bytes
+ */
+static void console_script_type(const uint8_t* text, size_t len)
+{
+    if (len > CONSOLE_SCRIPT_TYPE_SIZE - type_level)
+    {
+        console_script_event(WS_SCRIPT_FULL);
+        return;
+    }
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        type_buffer[(type_head + type_level + i) % CONSOLE_SCRIPT_TYPE_SIZE] = text[i];
+    }
+    type_level += len;
+    type_report = true;
+}
+
+/**
+ * @brief Arms a wait for a pattern in the console output.
+ *
+ * @param args 32-bit little-endian timeout in ms, then the pattern
+ * @param len Number of bytes
+ */
+static void console_script_wait(const uint8_t* args, size_t len)
+{
+    pattern_len = 0;
+    if (len <= 4 || len - 4 > CONSOLE_SCRIPT_PATTERN_MAX)
+    {
+        return;
+    }
+
+    uint32_t timeout_ms = args[0] | ((uint32_t)args[1] << 8) | ((uint32_t)args[2] << 16) | ((uint32_t)args[3] << 24);
+    wait_timed = timeout_ms != 0;
+    wait_deadline_us = time_us_64() + (uint64_t)timeout_ms * 1000;
+
+    size_t n = len - 4;
+    memcpy(pattern, args + 4, n);
+    pattern_fail[0] = 0;
+    for (size_t i = 1, k = 0; i < n; ++i)
+    {
+        while (k > 0 && pattern[i] != pattern[k])
+        {
+            k = pattern_fail[k - 1];
+        }
+        if (pattern[i] == pattern[k])
+        {
+            k++;
+        }
+        pattern_fail[i] = (uint8_t)k;
+    }
+    pattern_matched = 0;
+    pattern_len = n;
+}
+
+void console_script_command(const uint8_t* payload, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+
+    switch (payload[0])
+    {
+        case WS_SCRIPT_TYPE:
+            console_script_type(payload + 1, len - 1);
+            break;
+
+        case WS_SCRIPT_WAIT:
+            console_script_wait(payload + 1, len - 1);
+            break;
+
+        case WS_SCRIPT_CANCEL:
+            pattern_len = 0;
+            type_level = 0;
+            type_report = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void console_script_poll(void)
+{
+    while (type_level > 0)
+    {
+        size_t room = websocket_console_input_room();
+        size_t n = CONSOLE_SCRIPT_TYPE_SIZE - type_head;
+        n = n < type_level ? n : type_level;
+        n = n < room ? n : room;
+        if (n == 0)
+        {
+            break;
+        }
+        websocket_console_queue_input(type_buffer + type_head, n);
+        type_head = (type_head + n) % CONSOLE_SCRIPT_TYPE_SIZE;
+        type_level -= n;
+    }
+    if (type_report && type_level == 0)
+    {
+        type_report = false;
+        console_script_event(WS_SCRIPT_TYPED);
+    }
+
+    if (pattern_len != 0 && wait_timed && time_us_64() >= wait_deadline_us)
+    {
+        pattern_len = 0;
+        console_script_event(WS_SCRIPT_TIMEOUT);
+    }
+}
+
+bool console_script_waiting(void)
+{
+    return pattern_len != 0;
+}
+
+void console_script_scan(const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len && pattern_len != 0; ++i)
+    {
+        while (pattern_matched > 0 && data[i] != pattern[pattern_matched])
+        {
+            pattern_matched = pattern_fail[pattern_matched - 1];
+        }
+        if (data[i] == pattern[pattern_matched] && ++pattern_matched == pattern_len)
+        {
+            pattern_len = 0;
+            console_script_event(WS_SCRIPT_MATCHED);
+        }
+    }
+}
+
+bool console_script_pending(void)
+{
+    return event_count != 0;
+}
+
+size_t console_script_take(uint8_t* buffer, size_t max_len)
+{
+    size_t n = event_count < max_len ? event_count : max_len;
+    memcpy(buffer, events, n);
+    memmove(events, events + n, event_count - n);
+    event_count -= n;
+    return n;
+}
+
+void console_script_reset(void)
+{
+    type_head = 0;
+    type_level = 0;
+    type_report = false;
+    pattern_len = 0;
+    event_count = 0;
+}
+
+#endif
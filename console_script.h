@@ -0,0 +1,62 @@
+/* Scripted console for Altair 8800 Emulator
+ * Lets a test harness type text and wait for console output on WS_CHANNEL_SCRIPT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Commands to the device, the first payload byte of a WS_CHANNEL_SCRIPT record:
+//   WS_SCRIPT_TYPE, text        Type the text as fast as the guest reads it. It is taken whole or,
+//                               if it does not fit into CONSOLE_SCRIPT_TYPE_SIZE, refused with
+//                               WS_SCRIPT_FULL. WS_SCRIPT_TYPED follows once all text handed over
+//                               is in the console input of the guest.
+//   WS_SCRIPT_WAIT, ms, pattern Wait for the pattern (1 to CONSOLE_SCRIPT_PATTERN_MAX bytes) in the
+//                               console output, with a 32-bit little-endian timeout in ms (0 waits
+//                               until cancelled). Output still buffered on the device counts, output
+//                               already sent does not. Answered with WS_SCRIPT_MATCHED, in the same
+//                               message as and after the console record the match ends in, or
+//                               WS_SCRIPT_TIMEOUT. A new wait replaces the one before.
+//   WS_SCRIPT_CANCEL            Drop the wait and the text not typed yet
+// Device events are one byte, sent to every WebSocket client. The script is shared by all clients
+// and dropped when the last one leaves.
+#define WS_SCRIPT_TYPE 1
+#define WS_SCRIPT_WAIT 2
+#define WS_SCRIPT_CANCEL 3
+#define WS_SCRIPT_MATCHED 0x81
+#define WS_SCRIPT_TIMEOUT 0x82
+#define WS_SCRIPT_TYPED 0x83
+#define WS_SCRIPT_FULL 0x84
+
+#ifndef CONSOLE_SCRIPT_TYPE_SIZE
+#define CONSOLE_SCRIPT_TYPE_SIZE 2048
+#endif
+#define CONSOLE_SCRIPT_PATTERN_MAX 64
+
+// Events waiting at most, so CONSOLE_SCRIPT_RECORD_MAX is the largest record payload
+#define CONSOLE_SCRIPT_EVENTS 8
+#define CONSOLE_SCRIPT_RECORD_MAX CONSOLE_SCRIPT_EVENTS
+
+// Core 1: handle a WS_CHANNEL_SCRIPT record payload
+void console_script_command(const uint8_t* payload, size_t len);
+
+// Core 1: pass waiting text to the guest as far as the console input has room, and time out the
+// wait, called every poll loop
+void console_script_poll(void);
+
+// Core 1: true while a wait is armed, console output is then sent without coalescing
+bool console_script_waiting(void);
+
+// Core 1: match console output about to be sent against the pattern
+void console_script_scan(const uint8_t* data, size_t len);
+
+// Core 1: true when events are waiting to be sent
+bool console_script_pending(void);
+
+// Core 1: move waiting events into buffer as a record payload, returns its length
+size_t console_script_take(uint8_t* buffer, size_t max_len);
+
+// Core 1: drop the wait, text and events
+void console_script_reset(void);
@@ -1,20 +1,28 @@
 #include "cpu_state.h"
+#include "Altair8800/i8080_break.h"
 #include "Altair8800/intel8080.h"
 #include "FrontPanels/display_2_8.h"
 #include "i8080_disasm.h"
+#include "pico.h"
 #include "virtual_monitor.h"
 #include <ctype.h>
 #include <stdio.h>
 
 // Command buffer for CPU_STOPPED mode
-#define COMMAND_BUFFER_SIZE 30
+#define COMMAND_BUFFER_SIZE MONITOR_COMMAND_MAX
 static char command_buffer[COMMAND_BUFFER_SIZE] = {0};
 static size_t command_buffer_length = 0;
 
-// Global CPU instance
+// Global CPU instance. With ALTAIR_SRAM_PLACEMENT it shares scratch Y with the core 0 stack, a
+// bank of its own that core 1 and DMA leave alone.
+#ifdef ALTAIR_SRAM_PLACEMENT
+__scratch_y("i8080") intel8080_t cpu;
+#else
 intel8080_t cpu;
+#endif
 
 volatile CPU_OPERATING_MODE g_cpu_mode = CPU_STOPPED;
+volatile uint32_t g_cpu_clock_khz = ALTAIR_CPU_CLOCK_KHZ;
 uint16_t bus_switches = 0x00;
 ALTAIR_COMMAND cmd_switches = NOP;
 
@@ -22,6 +30,12 @@ void cpu_state_set_mode(CPU_OPERATING_MODE mode)
 {
     g_cpu_mode = mode;
 
+    // Make a running i8080_run batch return so the main loop sees the new mode
+    if (mode != CPU_RUNNING)
+    {
+        i8080_request_exit(&cpu);
+    }
+
     // Update Display 2.8 LED based on CPU state
     display_2_8_set_cpu_led(mode == CPU_RUNNING);
 
@@ -47,6 +61,15 @@ void cpu_state_set_mode(CPU_OPERATING_MODE mode)
 #endif
 }
 
+void cpu_state_set_clock_khz(uint32_t khz)
+{
+    g_cpu_clock_khz = khz;
+
+#ifdef ALTAIR_DEBUG
+    printf("CPU clock set to %lu kHz%s\n", (unsigned long)khz, khz == 0 ? " (unthrottled)" : "");
+#endif
+}
+
 CPU_OPERATING_MODE cpu_state_toggle_mode(void)
 {
     memset(command_buffer, 0, sizeof(command_buffer));
@@ -75,6 +98,32 @@ CPU_OPERATING_MODE cpu_state_toggle_mode(void)
     return g_cpu_mode;
 }
 
+void cpu_state_stop_at_break(void)
+{
+#ifdef ALTAIR_BREAKPOINTS
+    char message[80];
+    int length;
+
+    memset(command_buffer, 0, sizeof(command_buffer));
+    command_buffer_length = 0;
+    cpu_state_set_mode(CPU_STOPPED);
+    bus_switches = cpu.registers.pc;
+
+    if (i8080_break.hit == I8080_BREAK_PC)
+    {
+        length = snprintf(message, sizeof(message), "\r\n*** BREAKPOINT %04X ***\r\nCPU MONITOR> ",
+                          i8080_break.hit_address);
+    }
+    else
+    {
+        length = snprintf(message, sizeof(message), "\r\n*** WATCHPOINT %04X written at %04X ***\r\nCPU MONITOR> ",
+                          i8080_break.hit_address, i8080_break.hit_pc);
+    }
+    i8080_break.hit = I8080_BREAK_NONE;
+    publish_message(message, (size_t)length);
+#endif
+}
+
 void process_control_panel_commands_char(uint8_t ch)
 {
     if (ch == '\r')
@@ -94,9 +143,7 @@ void process_control_panel_commands_char(uint8_t ch)
         if (command_buffer_length > 0)
         {
             command_buffer_length--;
-            websocket_console_enqueue_output(ch);  // Echo backspace
-            websocket_console_enqueue_output(' '); // Echo space to erase character
-            websocket_console_enqueue_output(ch);  // Echo backspace again
+            publish_message("\b \b", 3); // Echo backspace, space to erase the character, backspace
         }
         // If command_buffer_length == 0, do nothing (don't echo)
     }
@@ -105,11 +152,11 @@ void process_control_panel_commands_char(uint8_t ch)
         // Accumulate characters into the command buffer
         if (command_buffer_length < COMMAND_BUFFER_SIZE - 1)
         {
-            // Convert to uppercase and add to buffer
-            command_buffer[command_buffer_length++] = (char)toupper((unsigned char)ch);
+            // Add to buffer as typed, the monitor matches commands in upper case
+            command_buffer[command_buffer_length++] = (char)ch;
 
             // Echo the character back to the terminal
-            websocket_console_enqueue_output(ch);
+            publish_message((const char*)&ch, 1);
         }
     }
 }
\ No newline at end of file
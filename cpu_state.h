@@ -11,6 +11,11 @@ typedef enum
     CPU_LOW_POWER = 3
 } CPU_OPERATING_MODE;
 
+// Default emulated CPU clock in kHz (0 = unthrottled, 2000 = original 2 MHz 8080)
+#ifndef ALTAIR_CPU_CLOCK_KHZ
+#define ALTAIR_CPU_CLOCK_KHZ 0
+#endif
+
 // Global CPU instance
 extern intel8080_t cpu;
 
@@ -23,6 +28,12 @@ void cpu_state_set_mode(CPU_OPERATING_MODE mode);
 // Toggle the CPU operating mode between RUNNING and STOPPED
 CPU_OPERATING_MODE cpu_state_toggle_mode(void);
 
+// Stop in the CPU monitor after the breakpoint or watchpoint that ended the last batch (core 0)
+void cpu_state_stop_at_break(void);
+
+// Set the emulated CPU clock in kHz used to pace execution (0 = unthrottled)
+void cpu_state_set_clock_khz(uint32_t khz);
+
 // Process a single character for CPU monitor commands in STOPPED mode
 void process_control_panel_commands_char(uint8_t ch);
 
@@ -33,4 +44,11 @@ static inline CPU_OPERATING_MODE cpu_state_get_mode(void)
     return g_cpu_mode;
 }
 
+// Inline wrapper for the emulated CPU clock (kHz, 0 = unthrottled)
+static inline uint32_t cpu_state_get_clock_khz(void)
+{
+    extern volatile uint32_t g_cpu_clock_khz;
+    return g_cpu_clock_khz;
+}
+
 #endif // CPU_STATE_H
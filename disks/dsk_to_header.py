@@ -1,5 +1,5 @@
 #!/usr/bin/env python3
-"""Convert a CP/M disk image into a C header with a byte array."""
+"""Convert a CP/M disk image into a C header with a byte array, optionally LZ4 compressed per track."""
 
 from __future__ import annotations
 
@@ -20,6 +20,98 @@ def format_bytes(data: bytes, width: int = 16, indent: str = "") -> str:
     return "\n".join(lines)
 
 
+# 88-DCDD track: 32 sectors of 137 bytes
+TRACK_SIZE = 32 * 137
+
+LZ4_MIN_MATCH = 4
+LZ4_LAST_LITERALS = 5  # A block always ends with at least this many literals
+LZ4_MF_LIMIT = 12  # The last match starts at least this far from the end
+LZ4_MAX_OFFSET = 65535
+LZ4_CHAIN_DEPTH = 16  # Earlier positions tried per 4-byte key, the longest match wins
+
+
+def lz4_length(out: bytearray, length: int) -> None:
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def lz4_sequence(out: bytearray, literals: bytes, offset: int = 0, match: int = 0) -> None:
+    literal_len = len(literals)
+    token = min(literal_len, 15) << 4
+    if offset:
+        token |= min(match - LZ4_MIN_MATCH, 15)
+    out.append(token)
+    if literal_len >= 15:
+        lz4_length(out, literal_len - 15)
+    out += literals
+    if offset:
+        out += offset.to_bytes(2, "little")
+        if match - LZ4_MIN_MATCH >= 15:
+            lz4_length(out, match - LZ4_MIN_MATCH - 15)
+
+
+def lz4_compress_block(data: bytes) -> bytes:
+    """LZ4 block compressor (raw block format, no frame header) with a short hash chain."""
+    out = bytearray()
+    seen: dict[bytes, list[int]] = {}
+    anchor = 0
+    pos = 0
+    limit = len(data) - LZ4_MF_LIMIT
+
+    def remember(at: int) -> list[int]:
+        chain = seen.setdefault(data[at : at + LZ4_MIN_MATCH], [])
+        chain.append(at)
+        if len(chain) > LZ4_CHAIN_DEPTH:
+            del chain[0]
+        return chain
+
+    while pos <= limit:
+        chain = remember(pos)
+        best_length = 0
+        best_offset = 0
+        max_length = len(data) - LZ4_LAST_LITERALS - pos
+        for candidate in reversed(chain[:-1]):
+            if pos - candidate > LZ4_MAX_OFFSET:
+                break
+            length = LZ4_MIN_MATCH
+            while length < max_length and data[candidate + length] == data[pos + length]:
+                length += 1
+            if length > best_length:
+                best_length = length
+                best_offset = pos - candidate
+        if best_length == 0:
+            pos += 1
+            continue
+        lz4_sequence(out, data[anchor:pos], best_offset, best_length)
+        for inside in range(pos + 1, min(pos + best_length, limit + 1)):
+            remember(inside)
+        pos += best_length
+        anchor = pos
+    lz4_sequence(out, data[anchor:])
+    return bytes(out)
+
+
+def compress_tracks(data: bytes, track_size: int) -> tuple[bytes, list[int]]:
+    """One LZ4 block per track; a track that does not shrink is stored raw (block size == track size)."""
+    blob = bytearray()
+    offsets = []
+    for start in range(0, len(data), track_size):
+        track = data[start : start + track_size]
+        block = lz4_compress_block(track)
+        offsets.append(len(blob))
+        blob += block if len(block) < len(track) else track
+    offsets.append(len(blob))
+    return bytes(blob), offsets
+
+
+def format_numbers(values: list[int], width: int = 16) -> str:
+    lines = [", ".join(str(value) for value in values[idx : idx + width]) + "," for idx in range(0, len(values), width)]
+    lines[-1] = lines[-1].rstrip(",")
+    return "\n".join(lines)
+
+
 def infer_symbol(path: Path) -> str:
     stem = path.stem.replace("-", "_").replace(" ", "_")
     return stem.lower()
@@ -51,6 +143,11 @@ def main() -> None:
         default=None,
         help="Base symbol name for the generated array (defaults to the input stem)",
     )
+    parser.add_argument(
+        "--lz4",
+        action="store_true",
+        help="Compress each track into an LZ4 block and emit a <symbol>_lz4_track offset table",
+    )
     parser.add_argument(
         "--width",
         type=int,
@@ -68,14 +165,27 @@ def main() -> None:
 
     data = input_path.read_bytes()
     symbol = args.symbol or infer_symbol(input_path)
-    formatted = format_bytes(data, width=args.width)
 
-    header = (
-        f"const unsigned char {symbol}[] = {{\n"
-        f"{formatted}\n"
-        f"}};\n"
-        f"const unsigned int {symbol}_len = {len(data)};\n"
-    )
+    if args.lz4:
+        blob, offsets = compress_tracks(data, TRACK_SIZE)
+        header = (
+            f"// {input_path.name}: {len(data)} bytes as {len(offsets) - 1} LZ4 track blocks, {len(blob)} bytes\n"
+            f"const unsigned char {symbol}_lz4[] = {{\n"
+            f"{format_bytes(blob, width=args.width)}\n"
+            f"}};\n"
+            f"const unsigned int {symbol}_lz4_track[] = {{\n"
+            f"{format_numbers(offsets, width=args.width)}\n"
+            f"}};\n"
+            f"const unsigned int {symbol}_len = {len(data)};\n"
+        )
+    else:
+        formatted = format_bytes(data, width=args.width)
+        header = (
+            f"const unsigned char {symbol}[] = {{\n"
+            f"{formatted}\n"
+            f"}};\n"
+            f"const unsigned int {symbol}_len = {len(data)};\n"
+        )
 
     output_path.write_text(header, encoding="ascii")
 
@@ -5,6 +5,9 @@
 #include "hardware/clocks.h"
 #ifndef SDCARD_PIO
 #include "hardware/spi.h"
+#if SDCARD_SPI_DMA
+#include "hardware/dma.h"
+#endif
 #else
 #include "pio_spi.h"
 #endif
@@ -51,7 +54,7 @@
 #define CT_BLOCK       0x08            /* Block addressing */
 
 #define CLK_SLOW	(100 * KHZ)
-#define CLK_FAST	(30 * MHZ)
+#define CLK_FAST	SDCARD_CLK_FAST
 
 static volatile
 DSTATUS Stat = STA_NOINIT;	/* Physical drive status */
@@ -59,6 +62,11 @@ DSTATUS Stat = STA_NOINIT;	/* Physical drive status */
 static
 BYTE CardType;			/* Card type flags */
 
+#if !defined(SDCARD_PIO) && SDCARD_SPI_DMA
+static int dma_tx = -1;		/* Feeds the SPI TX FIFO */
+static int dma_rx = -1;		/* Drains the SPI RX FIFO */
+#endif
+
 #ifdef SDCARD_PIO
 pio_spi_inst_t pio_spi = {
 		.pio = SDCARD_PIO,
@@ -148,6 +156,13 @@ void init_spi(void)
 
 	spi_init(SDCARD_SPI_BUS, CLK_SLOW);
 
+#if SDCARD_SPI_DMA
+	if (dma_tx < 0) {
+		dma_tx = dma_claim_unused_channel(true);
+		dma_rx = dma_claim_unused_channel(true);
+	}
+#endif
+
 	/* SPI0 parameter config */
 	spi_set_format(SDCARD_SPI_BUS,
 		8, /* data_bits */
@@ -160,7 +175,11 @@ void init_spi(void)
     gpio_set_dir(SDCARD_PIN_SPI0_MISO, GPIO_OUT);
     gpio_set_dir(SDCARD_PIN_SPI0_MOSI, GPIO_OUT);
 
-	float clkdiv = 3.0f;
+	/* SCK is a quarter of the PIO clock: aim for CLK_FAST, with the divider of 3 this used to
+	   fix as the floor, so the SDK's clock drives the card as before */
+	float clkdiv = (float)clock_get_hz(clk_sys) / (4.0f * CLK_FAST);
+	if (clkdiv < 3.0f)
+		clkdiv = 3.0f;
 	int cpol = 0;
 	int cpha = 0;
 	uint cpha0_prog_offs = pio_add_program(pio_spi.pio, &spi_cpha0_program);
@@ -193,6 +212,40 @@ BYTE xchg_spi (
 }
 
 
+#if !defined(SDCARD_PIO) && SDCARD_SPI_DMA
+/* Full duplex DMA block transfer. Sends tx, or 0xFF repeatedly when tx is NULL,
+   and stores the received bytes in rx, or discards them when rx is NULL. */
+static
+void dma_spi_transfer (
+	const BYTE *tx,	/* Data to send or NULL */
+	BYTE *rx,		/* Receive buffer or NULL */
+	UINT len		/* Number of bytes */
+)
+{
+	static const uint8_t fill = 0xFF;
+	static uint8_t discard;
+	spi_inst_t *spi = SDCARD_SPI_BUS;
+
+	dma_channel_config c = dma_channel_get_default_config(dma_tx);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+	channel_config_set_dreq(&c, spi_get_dreq(spi, true));
+	channel_config_set_read_increment(&c, tx != NULL);
+	channel_config_set_write_increment(&c, false);
+	dma_channel_configure(dma_tx, &c, &spi_get_hw(spi)->dr, tx ? tx : &fill, len, false);
+
+	c = dma_channel_get_default_config(dma_rx);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+	channel_config_set_dreq(&c, spi_get_dreq(spi, false));
+	channel_config_set_read_increment(&c, false);
+	channel_config_set_write_increment(&c, rx != NULL);
+	dma_channel_configure(dma_rx, &c, rx ? rx : &discard, &spi_get_hw(spi)->dr, len, false);
+
+	/* Start both together so the RX FIFO can never overrun */
+	dma_start_channel_mask((1u << dma_tx) | (1u << dma_rx));
+	dma_channel_wait_for_finish_blocking(dma_rx);
+}
+#endif
+
 /* Receive multiple byte */
 static
 void rcvr_spi_multi (
@@ -202,7 +255,11 @@ void rcvr_spi_multi (
 {
 	uint8_t *b = (uint8_t *) buff;
 #ifndef SDCARD_PIO
+#if SDCARD_SPI_DMA
+	dma_spi_transfer(NULL, b, btr);
+#else
 	spi_read_blocking(SDCARD_SPI_BUS, 0xff, b, btr);
+#endif
 #else
 	pio_spi_repeat8_read8_blocking(&pio_spi, 0xff, b, btr);
 #endif
@@ -473,7 +530,11 @@ void xmit_spi_multi (
 {
 	const uint8_t *b = (const uint8_t *) buff;
 #ifndef SDCARD_PIO
+#if SDCARD_SPI_DMA
+	dma_spi_transfer(b, NULL, btx);
+#else
 	spi_write_blocking(SDCARD_SPI_BUS, b, btx);
+#endif
 #else
 	pio_spi_write8_blocking(&pio_spi, b, btx);
 #endif
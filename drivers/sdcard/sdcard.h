@@ -24,4 +24,14 @@
 #define SDCARD_PIN_SPI0_MISO   16
 #endif
 
+/* SPI clock after card initialization (Hz) */
+#ifndef SDCARD_CLK_FAST
+#define SDCARD_CLK_FAST        (30 * 1000 * 1000)
+#endif
+
+/* Move 512-byte data blocks with DMA instead of CPU loops (hardware SPI only) */
+#ifndef SDCARD_SPI_DMA
+#define SDCARD_SPI_DMA         1
+#endif
+
 #endif // _SDCARD_H_
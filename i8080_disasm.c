@@ -2,6 +2,7 @@
    Licensed under the MIT License. */
 
 #include "i8080_disasm.h"
+#include "Altair8800/memory.h"
 #include "websocket_console.h"
 #include "pico/stdlib.h"
 #include <string.h>
@@ -36,10 +37,178 @@ void publish_message(const char* message, size_t length)
         return;
     }
     
-    for (size_t i = 0; i < length; i++)
+    websocket_console_enqueue_monitor_output((const uint8_t*)message, length);
+}
+
+static char monitor_batch[MONITOR_BATCH_SIZE];
+static size_t monitor_batch_length = 0;
+
+char* monitor_reserve(size_t max_length)
+{
+    if (MONITOR_BATCH_SIZE - monitor_batch_length < max_length)
+    {
+        monitor_flush();
+    }
+    return monitor_batch + monitor_batch_length;
+}
+
+void monitor_commit(size_t length)
+{
+    monitor_batch_length += length;
+}
+
+void monitor_write(const char* text, size_t length)
+{
+    if (length > MONITOR_BATCH_SIZE)
+    {
+        monitor_flush();
+        publish_message(text, length);
+        return;
+    }
+    memcpy(monitor_reserve(length), text, length);
+    monitor_commit(length);
+}
+
+void monitor_flush(void)
+{
+    publish_message(monitor_batch, monitor_batch_length);
+    monitor_batch_length = 0;
+}
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static char* put_text(char* p, const char* text)
+{
+    while (*text)
+    {
+        *p++ = *text++;
+    }
+    return p;
+}
+
+static char* put_hex(char* p, uint16_t value, int digits, const char* digit_set)
+{
+    while (digits-- > 0)
+    {
+        *p++ = digit_set[(value >> (digits * 4)) & 0xf];
+    }
+    return p;
+}
+
+static char* put_binary(char* p, uint16_t value, int bits)
+{
+    while (bits-- > 0)
+    {
+        *p++ = (value >> bits) & 1 ? '1' : '0';
+    }
+    return p;
+}
+
+size_t i8080_format_bus_line(char* out, const char* label, uint16_t address, uint8_t data, bool opcode)
+{
+    char* p = out;
+    *p++ = '\r';
+    *p++ = '\n';
+    for (size_t i = strlen(label); i < 14; i++)
+    {
+        *p++ = ' ';
+    }
+    p = put_text(p, label);
+    p = put_text(p, ": Addr bus: ");
+    p = put_binary(p, address, 16);
+    p = put_text(p, " (0x");
+    p = put_hex(p, address, 4, hex_digits);
+    p = put_text(p, "), Data bus ");
+    p = put_binary(p, data, 8);
+    p = put_text(p, " (0x");
+    p = put_hex(p, data, 2, hex_digits);
+    *p++ = ')';
+
+    if (opcode)
+    {
+        uint8_t length = 0;
+        const char* name = get_i8080_instruction_name(data, &length);
+        *p++ = ',';
+        *p++ = ' ';
+        char* name_start = p;
+        p = put_text(p, name);
+        while (p - name_start < 12)
+        {
+            *p++ = ' ';
+        }
+        *p++ = ' ';
+        *p++ = ' ';
+        *p++ = (char)('0' + length);
+        *p++ = 'B';
+    }
+    return (size_t)(p - out);
+}
+
+size_t i8080_format_instruction(char* out, uint16_t address, const uint8_t* bytes, uint8_t* instruction_length)
+{
+    static const char hex_upper[] = "0123456789ABCDEF";
+    uint8_t length = 0;
+    const char* name = get_i8080_instruction_name(bytes[0], &length);
+    if (length == 0)
+    {
+        length = 1;
+    }
+    uint16_t operand = length == 3 ? (uint16_t)(bytes[1] | (bytes[2] << 8)) : bytes[1];
+
+    char* p = out;
+    *p++ = '\r';
+    *p++ = '\n';
+    p = put_hex(p, address, 4, hex_upper);
+    *p++ = ' ';
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        *p++ = ' ';
+        if (i < length)
+        {
+            p = put_hex(p, bytes[i], 2, hex_upper);
+        }
+        else
+        {
+            *p++ = ' ';
+            *p++ = ' ';
+        }
+    }
+    *p++ = ' ';
+    *p++ = ' ';
+
+    // The mnemonic table names operands D8, D16 and adr
+    while (*name)
+    {
+        if (strncmp(name, "D16", 3) == 0 || strncmp(name, "adr", 3) == 0)
+        {
+            p = put_hex(p, operand, 4, hex_upper);
+            *p++ = 'H';
+            name += 3;
+        }
+        else if (strncmp(name, "D8", 2) == 0)
+        {
+            p = put_hex(p, operand, 2, hex_upper);
+            *p++ = 'H';
+            name += 2;
+        }
+        else
+        {
+            *p++ = *name++;
+        }
+    }
+
+    *instruction_length = length;
+    return (size_t)(p - out);
+}
+
+size_t i8080_format_listing(char* out, uint16_t address, uint8_t* instruction_length)
+{
+    uint8_t bytes[3];
+    for (uint8_t i = 0; i < 3; i++)
     {
-        websocket_console_enqueue_output((uint8_t)message[i]);
+        bytes[i] = read8(&memory_main, (uint16_t)(address + i));
     }
+    return i8080_format_instruction(out, address, bytes, instruction_length);
 }
 
 const char *get_i8080_instruction_name(uint8_t opcode, uint8_t *i8080_instruction_size)
@@ -17,3 +17,34 @@ const char* get_i8080_instruction_name(uint8_t opcode, uint8_t* instruction_leng
 
 // Publish message to WebSocket clients
 void publish_message(const char* message, size_t length);
+
+// Buffered CPU monitor output (core 0): text is formatted straight into a batch buffer, which
+// goes to core 1 as one block when it fills up and on monitor_flush. Half the monitor ring, so
+// a batch fits once core 1 has sent the one before.
+#define MONITOR_BATCH_SIZE 1024
+
+// Longest line the formatters below write
+#define MONITOR_LINE_MAX 112
+
+// Room for at least max_length bytes at the end of the batch (flushing it first if needed);
+// write there, then monitor_commit the bytes written
+char* monitor_reserve(size_t max_length);
+void monitor_commit(size_t length);
+
+// Append text to the batch
+void monitor_write(const char* text, size_t length);
+
+// Hand the batch to core 1
+void monitor_flush(void);
+
+// "\r\n<label>: Addr bus: <A15-A0> (0x....), Data bus <D7-D0> (0x..)" with the label right
+// aligned to 14 columns; for an opcode followed by ", <mnemonic>  <length>B". Returns the length.
+size_t i8080_format_bus_line(char* out, const char* label, uint16_t address, uint8_t data, bool opcode);
+
+// One listing line for the instruction bytes[0..2] at address: "\r\n0100  21 00 10  LXI H,1000H",
+// operands filled in. Returns the length and stores the instruction length (undefined opcodes
+// count as one byte).
+size_t i8080_format_instruction(char* out, uint16_t address, const uint8_t* bytes, uint8_t* instruction_length);
+
+// The same for the instruction in memory at address
+size_t i8080_format_listing(char* out, uint16_t address, uint8_t* instruction_length);
@@ -1,76 +1,286 @@
 #include "io_ports.h"
 
+#include "Altair8800/memory.h"
 #include "PortDrivers/http_io.h"
+#include "PortDrivers/printer_io.h"
 #include "PortDrivers/time_io.h"
 #include "PortDrivers/utility_io.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
-#define REQUEST_BUFFER_SIZE 128
-
 typedef struct
 {
     size_t len;
     size_t count;
-    char buffer[REQUEST_BUFFER_SIZE];
+    char buffer[IO_PORT_RESPONSE_SIZE];
 } request_unit_t;
 
+typedef struct
+{
+    io_port_in_t handler;
+    void* context;
+} in_port_t;
+
+typedef struct
+{
+    io_port_out_t handler;
+    void* context;
+} out_port_t;
+
+typedef struct
+{
+    uint8_t param[MEMORY_ACCEL_PARAMS];
+    uint8_t param_count;
+    uint8_t result[2];
+    uint8_t result_count;
+} memory_accel_t;
+
 static request_unit_t request_unit;
+static memory_accel_t memory_accel;
+
+static in_port_t in_ports[256];
+static out_port_t out_ports[256];
+static io_port_response_t response_ports[256];
 
+void io_port_register_in(uint8_t port, io_port_in_t handler, void* context)
+{
+    in_ports[port].handler = handler;
+    in_ports[port].context = context;
+}
+
+void io_port_register_out(uint8_t port, io_port_out_t handler, void* context)
+{
+    out_ports[port].handler = handler;
+    out_ports[port].context = context;
+}
+
+void io_port_register_response(uint8_t port, io_port_response_t handler)
+{
+    response_ports[port] = handler;
+}
+
+// A new reply replaces whatever was left of the last one
 void io_port_out(uint8_t port, uint8_t data)
 {
-    memset(&request_unit, 0, sizeof(request_unit));
+    io_port_response_t response = response_ports[port];
+    if (response != NULL)
+    {
+        request_unit.count = 0;
+        request_unit.len = response(port, data, request_unit.buffer, sizeof(request_unit.buffer));
+    }
 
-    switch (port)
+    const out_port_t* out = &out_ports[port];
+    if (out->handler != NULL)
     {
-        case 24:
-        case 25:
-        case 26:
-        case 27:
-        case 28:
-        case 29:
-        case 30:
-        case 41:
-        case 42:
-        case 43:
-            request_unit.len = time_output(port, data, request_unit.buffer, sizeof(request_unit.buffer));
-            break;
-        case 45:
-        case 70:
-            request_unit.len = utility_output(port, data, request_unit.buffer, sizeof(request_unit.buffer));
-            break;
-        case 109:
-        case 110:
-        case 114:
-            request_unit.len = http_output(port, data, request_unit.buffer, sizeof(request_unit.buffer));
-            break;
-        default:
-            break;
+        out->handler(out->context, port, data);
     }
 }
 
 uint8_t io_port_in(uint8_t port)
 {
-    switch (port)
+    const in_port_t* in = &in_ports[port];
+    return in->handler != NULL ? in->handler(in->context, port) : 0x00;
+}
+
+static uint8_t response_in(void* context, uint8_t port)
+{
+    (void)context;
+    (void)port;
+    if (request_unit.count < request_unit.len && request_unit.count < sizeof(request_unit.buffer))
+    {
+        return (uint8_t)request_unit.buffer[request_unit.count++];
+    }
+    return 0x00;
+}
+
+static uint8_t bank_in(void* context, uint8_t port)
+{
+    (void)context;
+    (void)port;
+    return memory_get_bank(&memory_main);
+}
+
+static void bank_out(void* context, uint8_t port, uint8_t data)
+{
+    (void)context;
+    (void)port;
+    memory_select_bank(&memory_main, data);
+}
+
+// Bytes from address to the end of its page
+static inline uint32_t page_room(uint16_t address)
+{
+    return MEMORY_PAGE_SIZE - (address & MEMORY_PAGE_MASK);
+}
+
+static inline uint32_t min3(uint32_t a, uint32_t b, uint32_t c)
+{
+    uint32_t m = a < b ? a : b;
+    return m < c ? m : c;
+}
+
+static inline const uint8_t* read_ptr(const memory_space_t* mem, uint16_t address)
+{
+    return mem->read_map[address >> MEMORY_PAGE_SHIFT] + (address & MEMORY_PAGE_MASK);
+}
+
+static inline uint8_t* write_ptr(memory_space_t* mem, uint16_t address)
+{
+    return mem->write_map[address >> MEMORY_PAGE_SHIFT] + (address & MEMORY_PAGE_MASK);
+}
+
+// Page by page, so banks and ROM are those of read8/write8. A destination inside the source is
+// copied from the end, as memmove would.
+static void accel_move(memory_space_t* mem, uint16_t src, uint16_t dst, uint32_t count)
+{
+    if (src == dst)
+    {
+        return;
+    }
+    bool backward = (uint16_t)(dst - src) < count;
+    while (count > 0)
     {
-        case 24:
-        case 25:
-        case 26:
-        case 27:
-        case 28:
-        case 29:
-        case 30:
-            return time_input(port);
-        case 33:
-        case 201:
-            return http_input(port);
-        case 200:
-            if (request_unit.count < request_unit.len && request_unit.count < sizeof(request_unit.buffer))
+        uint32_t chunk;
+        if (backward)
+        {
+            uint16_t src_last = (uint16_t)(src + count - 1);
+            uint16_t dst_last = (uint16_t)(dst + count - 1);
+            chunk = min3(count, (src_last & MEMORY_PAGE_MASK) + 1u, (dst_last & MEMORY_PAGE_MASK) + 1u);
+            memmove(write_ptr(mem, (uint16_t)(dst_last - chunk + 1)), read_ptr(mem, (uint16_t)(src_last - chunk + 1)),
+                    chunk);
+        }
+        else
+        {
+            chunk = min3(count, page_room(src), page_room(dst));
+            memmove(write_ptr(mem, dst), read_ptr(mem, src), chunk);
+            src = (uint16_t)(src + chunk);
+            dst = (uint16_t)(dst + chunk);
+        }
+        count -= chunk;
+    }
+}
+
+static void accel_fill(memory_space_t* mem, uint16_t dst, uint32_t count, uint8_t value)
+{
+    while (count > 0)
+    {
+        uint32_t chunk = count < page_room(dst) ? count : page_room(dst);
+        memset(write_ptr(mem, dst), value, chunk);
+        dst = (uint16_t)(dst + chunk);
+        count -= chunk;
+    }
+}
+
+static uint16_t accel_compare(const memory_space_t* mem, uint16_t src, uint16_t dst, uint32_t count)
+{
+    while (count > 0)
+    {
+        uint32_t chunk = min3(count, page_room(src), page_room(dst));
+        const uint8_t* a = read_ptr(mem, src);
+        const uint8_t* b = read_ptr(mem, dst);
+        if (memcmp(a, b, chunk) != 0)
+        {
+            while (*a == *b)
             {
-                return (uint8_t)request_unit.buffer[request_unit.count++];
+                a++;
+                b++;
             }
-            return 0x00;
+            return (uint16_t)(*a - *b);
+        }
+        src = (uint16_t)(src + chunk);
+        dst = (uint16_t)(dst + chunk);
+        count -= chunk;
+    }
+    return 0;
+}
+
+// Offset of the first value from src within count bytes, count if there is none
+static uint32_t accel_find(const memory_space_t* mem, uint16_t src, uint32_t count, uint8_t value)
+{
+    uint32_t offset = 0;
+    while (offset < count)
+    {
+        uint16_t address = (uint16_t)(src + offset);
+        uint32_t chunk = count - offset < page_room(address) ? count - offset : page_room(address);
+        const uint8_t* start = read_ptr(mem, address);
+        const uint8_t* found = memchr(start, value, chunk);
+        if (found != NULL)
+        {
+            return offset + (uint32_t)(found - start);
+        }
+        offset += chunk;
+    }
+    return count;
+}
+
+static uint16_t accel_run(uint8_t operation)
+{
+    const uint8_t* p = memory_accel.param;
+    uint16_t src = (uint16_t)(p[0] | (p[1] << 8));
+    uint16_t dst = (uint16_t)(p[2] | (p[3] << 8));
+    uint32_t count = (uint32_t)(p[4] | (p[5] << 8));
+    uint8_t value = p[6];
+
+    switch (operation)
+    {
+        case MEMORY_ACCEL_MOVE:
+            accel_move(&memory_main, src, dst, count);
+            memory_mark_dirty_range(&memory_main, dst, count);
+            return 0;
+        case MEMORY_ACCEL_FILL:
+            accel_fill(&memory_main, dst, count, value);
+            memory_mark_dirty_range(&memory_main, dst, count);
+            return 0;
+        case MEMORY_ACCEL_COMPARE:
+            return accel_compare(&memory_main, src, dst, count);
+        case MEMORY_ACCEL_STRLEN:
+            return (uint16_t)accel_find(&memory_main, src, count != 0 ? count : 0xFFFF, 0);
+        case MEMORY_ACCEL_FIND:
+            return (uint16_t)accel_find(&memory_main, src, count, value);
         default:
-            return 0x00;
+            return 0;
     }
 }
+
+static void accel_out(void* context, uint8_t port, uint8_t data)
+{
+    (void)context;
+    if (port == MEMORY_ACCEL_PARAM_PORT)
+    {
+        if (memory_accel.param_count < MEMORY_ACCEL_PARAMS)
+        {
+            memory_accel.param[memory_accel.param_count++] = data;
+        }
+        return;
+    }
+    uint16_t result = accel_run(data);
+    memory_accel.result[0] = (uint8_t)result;
+    memory_accel.result[1] = (uint8_t)(result >> 8);
+    memory_accel.result_count = 0;
+    memory_accel.param_count = 0;
+    memset(memory_accel.param, 0, sizeof(memory_accel.param));
+}
+
+static uint8_t accel_in(void* context, uint8_t port)
+{
+    (void)context;
+    (void)port;
+    return memory_accel.result_count < sizeof(memory_accel.result) ? memory_accel.result[memory_accel.result_count++]
+                                                                   : 0x00;
+}
+
+void io_ports_init(void)
+{
+    io_port_register_in(IO_PORT_RESPONSE, response_in, NULL);
+    io_port_register_in(MEMORY_BANK_PORT, bank_in, NULL);
+    io_port_register_out(MEMORY_BANK_PORT, bank_out, NULL);
+    io_port_register_out(MEMORY_ACCEL_PARAM_PORT, accel_out, NULL);
+    io_port_register_out(MEMORY_ACCEL_PORT, accel_out, NULL);
+    io_port_register_in(MEMORY_ACCEL_PORT, accel_in, NULL);
+
+    time_io_register();
+    utility_io_register();
+    http_io_register();
+    printer_io_register();
+}
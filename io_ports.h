@@ -1,6 +1,45 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+// I/O ports outside the ones the 8080 core decodes itself (console, 2SIO, 88-DCDD disk and
+// sense switches) go through a 256-entry handler table. Drivers register the ports they
+// serve at startup; unregistered ports read 0x00 and ignore writes.
+typedef uint8_t (*io_port_in_t)(void* context, uint8_t port);
+typedef void (*io_port_out_t)(void* context, uint8_t port, uint8_t data);
+
+// An OUT whose reply the guest then reads back byte by byte from IO_PORT_RESPONSE. The driver
+// writes at most buffer_length bytes and returns how many.
+typedef size_t (*io_port_response_t)(int port, uint8_t data, char* buffer, size_t buffer_length);
+
+#define IO_PORT_RESPONSE 200
+#define IO_PORT_RESPONSE_SIZE 128
+
+// Block memory accelerator, native memmove/memset/memcmp/strlen/memchr over the guest's memory
+// as the 8080 sees it (the selected bank, ROM pages not written). OUT MEMORY_ACCEL_PARAM_PORT
+// takes the parameters one byte at a time: source, destination and count, each low byte first,
+// then the fill or search value. OUT MEMORY_ACCEL_PORT n runs MEMORY_ACCEL_* operation n and
+// starts the parameters over; two IN MEMORY_ACCEL_PORT then return its 16-bit result, low byte
+// first. Present when bit UTILITY_FEATURE_MEMORY_ACCEL of the version port's features is set.
+#define MEMORY_ACCEL_PARAM_PORT 51
+#define MEMORY_ACCEL_PORT 52
+#define MEMORY_ACCEL_PARAMS 7
+
+#define MEMORY_ACCEL_MOVE 1    // Copy count bytes from source to destination, overlap allowed
+#define MEMORY_ACCEL_FILL 2    // Set count bytes at destination to the value
+#define MEMORY_ACCEL_COMPARE 3 // First difference source byte - destination byte, 0 if equal
+#define MEMORY_ACCEL_STRLEN 4  // Bytes before the first 0 at source, at most count (0 = 65535)
+#define MEMORY_ACCEL_FIND 5    // Offset of the first byte equal to the value, count if none
+
+// Registering a port again replaces its handler, NULL removes it
+void io_port_register_in(uint8_t port, io_port_in_t handler, void* context);
+void io_port_register_out(uint8_t port, io_port_out_t handler, void* context);
+void io_port_register_response(uint8_t port, io_port_response_t handler);
+
+// Register the memory bank port, the response port, the memory accelerator and the time,
+// utility, HTTP and printer drivers
+void io_ports_init(void);
+
 uint8_t io_port_in(uint8_t port);
 void io_port_out(uint8_t port, uint8_t data);
@@ -0,0 +1,187 @@
+#include "load_test.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+#if defined(ALTAIR_LOAD_TEST) && defined(CYW43_WL_GPIO_LED_PIN)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PortDrivers/http_get.h"
+#include "cpu_state.h"
+#include "metrics.h"
+#include "websocket_console.h"
+
+// Bytes taken from the console input per pass, then echoed together
+#define LOAD_TEST_ECHO_BATCH 64
+
+// Output sent per pass, so echoes keep flowing during a long output command
+#define LOAD_TEST_OUTPUT_BATCH 256
+
+static const char output_line[LOAD_TEST_LINE_SIZE + 1] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789\r\n";
+
+// Command being received (Core 0)
+static uint8_t command_type = 0; // LOAD_TEST_OUTPUT, LOAD_TEST_HTTP or 0 while echoing
+static char command[HTTP_URL_MAX_LEN];
+static size_t command_len = 0;
+
+// Output still to send
+static uint32_t output_left = 0;
+static uint32_t output_pos = 0; // In output_line
+
+// HTTP transfers: waiting requests, then the one core 1 works on
+static http_request_t http_waiting[LOAD_TEST_HTTP_QUEUE];
+static size_t http_waiting_count = 0;
+static queue_t* outbound_queue;
+static http_response_stream_t* inbound;
+static bool http_busy = false;
+static uint32_t http_transfer = 0; // Requests sent
+static uint32_t http_bytes = 0;
+static uint32_t http_start_us;
+
+static void report_http(uint32_t bytes, uint32_t elapsed_us, bool ok)
+{
+    char line[48];
+    int len = snprintf(line, sizeof(line), "{HTTP %lu %lu %s}\r\n", (unsigned long)bytes,
+                       (unsigned long)(elapsed_us / 1000), ok ? "OK" : "FAILED");
+    websocket_console_enqueue_output_bulk((const uint8_t*)line, (size_t)len);
+}
+
+static void command_done(void)
+{
+    command[command_len] = '\0';
+    if (command_type == LOAD_TEST_OUTPUT)
+    {
+        output_left += (uint32_t)strtoul(command, NULL, 10);
+    }
+    else if (http_waiting_count < LOAD_TEST_HTTP_QUEUE)
+    {
+        http_request_t* request = &http_waiting[http_waiting_count++];
+        memset(request, 0, sizeof(*request));
+        memcpy(request->url, command, command_len + 1);
+    }
+    else
+    {
+        report_http(0, 0, false);
+    }
+    command_type = 0;
+}
+
+// Echo console input and collect commands
+static void poll_input(void)
+{
+    uint8_t echo[LOAD_TEST_ECHO_BATCH];
+    size_t n = 0;
+    uint8_t ch;
+    while (n < sizeof(echo) && websocket_console_try_dequeue_input(&ch))
+    {
+        if (command_type != 0)
+        {
+            if (ch == '\r')
+            {
+                command_done();
+            }
+            else if (command_len < sizeof(command) - 1)
+            {
+                command[command_len++] = (char)ch;
+            }
+        }
+        else if (ch == LOAD_TEST_OUTPUT || ch == LOAD_TEST_HTTP)
+        {
+            command_type = ch;
+            command_len = 0;
+        }
+        else
+        {
+            echo[n++] = ch;
+        }
+    }
+    if (n > 0)
+    {
+        websocket_console_enqueue_output_bulk(echo, n);
+    }
+}
+
+static void poll_output(void)
+{
+    uint32_t budget = LOAD_TEST_OUTPUT_BATCH;
+    while (output_left > 0 && budget > 0)
+    {
+        uint32_t n = LOAD_TEST_LINE_SIZE - output_pos;
+        n = n < output_left ? n : output_left;
+        n = n < budget ? n : budget;
+        websocket_console_enqueue_output_bulk((const uint8_t*)output_line + output_pos, n);
+        output_pos = (output_pos + n) % LOAD_TEST_LINE_SIZE;
+        output_left -= n;
+        budget -= n;
+    }
+}
+
+static void poll_http(void)
+{
+    if (!http_busy)
+    {
+        if (http_waiting_count == 0 || !queue_try_add(outbound_queue, &http_waiting[0]))
+        {
+            return;
+        }
+        memmove(http_waiting, http_waiting + 1, (http_waiting_count - 1) * sizeof(http_waiting[0]));
+        http_waiting_count--;
+        http_busy = true;
+        http_transfer++;
+        http_bytes = 0;
+        http_start_us = time_us_32();
+        return;
+    }
+    if (__atomic_load_n(&inbound->started, __ATOMIC_ACQUIRE) != http_transfer)
+    {
+        return; // Core 1 has not taken the request yet
+    }
+
+    // Result first, as in http_io.c: once it is final all data is in the ring
+    uint8_t result = __atomic_load_n(&inbound->result, __ATOMIC_ACQUIRE);
+    uint32_t index;
+    const uint8_t* data;
+    size_t n;
+    while ((n = spsc_ring_peek(&inbound->ring, &index, &data, HTTP_CHUNK_SIZE)) > 0)
+    {
+        spsc_ring_consume(&inbound->ring, index, n);
+        metrics_http_chunk(n);
+        http_bytes += (uint32_t)n;
+    }
+    if (result != HTTP_WG_WAITING && spsc_ring_level(&inbound->ring) == 0)
+    {
+        http_busy = false;
+        report_http(http_bytes, time_us_32() - http_start_us, result == HTTP_WG_EOF);
+    }
+}
+
+void load_test_run(void)
+{
+    // The HTTP queues are set up by core 1 with the network
+    while (!websocket_console_is_running())
+    {
+        sleep_ms(10);
+    }
+    printf("Load test target: echoing the console, Ctrl-O <count> sends output, Ctrl-G <url> fetches\n");
+    http_get_queues(&outbound_queue, &inbound);
+    cpu_state_set_mode(CPU_RUNNING); // Console input goes to the guest queue
+
+    for (;;)
+    {
+        poll_input();
+        poll_output();
+        poll_http();
+        metrics_update();
+    }
+}
+
+#else
+
+void load_test_run(void)
+{
+}
+
+#endif
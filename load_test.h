@@ -0,0 +1,21 @@
+#pragma once
+
+// Load test target, only with ALTAIR_LOAD_TEST on boards with Wi-Fi. Core 0 does not start the
+// emulator but serves the console as a fixed workload for LoadTest/ws_load.py, so networking
+// changes are measured without CP/M timing in the way:
+//   - Every console byte received is echoed back
+//   - LOAD_TEST_OUTPUT, a decimal count and CR sends that many bytes of LOAD_TEST_LINE_SIZE lines
+//   - LOAD_TEST_HTTP, a URL and CR fetches the URL through http_get.c, discards the body and reports
+//     "{HTTP <bytes> <ms> OK}" or "{HTTP <bytes> <ms> FAILED}". Up to LOAD_TEST_HTTP_QUEUE requests
+//     wait their turn, as http_get.c runs one transfer at a time; more are reported as failed.
+// What was dropped and how long core 0 waited for the TX ring is on WS_CHANNEL_METRICS.
+#define LOAD_TEST_OUTPUT 0x0F // Ctrl-O
+#define LOAD_TEST_HTTP 0x07   // Ctrl-G
+#define LOAD_TEST_HTTP_QUEUE 4
+#define LOAD_TEST_LINE_SIZE 64
+
+/**
+ * Serve the load test on core 0, does not return when built in
+ * Called from Core 0 once the console is up in place of the emulation loop
+ */
+void load_test_run(void);
@@ -29,7 +29,11 @@
 #define LWIP_ETHERNET 1           // Enable Ethernet support
 #define LWIP_ICMP 0               // Disable ICMP protocol (ping)
 #define LWIP_RAW 0                // Disable raw IP sockets
-#define TCP_WND (4 * TCP_MSS)     // TCP receive window size - Balanced for 8KB HTML content
+#if PICO_RP2350
+#define TCP_WND (8 * TCP_MSS) // TCP receive window size - Fits into HTTP_RX_RING_SIZE (16 KB)
+#else
+#define TCP_WND (4 * TCP_MSS) // TCP receive window size - Fits into HTTP_RX_RING_SIZE (8 KB)
+#endif
 #define TCP_MSS 1460              // TCP maximum segment size (bytes)
 #define TCP_SND_BUF (4 * TCP_MSS) // TCP sender buffer space (bytes) - Sized to accommodate HTML page
 #define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS)) // TCP sender buffer space (pbufs)
@@ -48,7 +52,6 @@
 #define LWIP_TCP 1                  // Enable TCP protocol
 #define LWIP_UDP 1                  // Enable UDP protocol
 #define LWIP_DNS 1                  // Enable DNS client
-#define LWIP_HTTPC 1                // Enable HTTP client
 #define LWIP_TCP_KEEPALIVE 1        // Enable TCP keepalive
 #define LWIP_NETIF_TX_SINGLE_PBUF 1 // Put all data to send into one pbuf (for DMA compatibility)
 #define DHCP_DOES_ARP_CHECK 0       // Disable ARP check on offered DHCP address
@@ -60,7 +63,6 @@
 #define MEMP_NUM_PBUF 16         // Number of pbufs for memp pool
 #define DNS_MAX_SERVERS 2        // Limit DNS servers (default 2)
 #define DNS_TABLE_SIZE 4         // DNS cache entries - reduced from default 8
-#define HTTPC_DEBUG LWIP_DBG_OFF // Disable HTTP client debug
 
 #ifndef NDEBUG
 #define LWIP_DEBUG 1         // Enable debug output in debug builds
@@ -1,35 +1,80 @@
+#include "Altair8800/i8080_break.h"
 #include "Altair8800/intel8080.h"
 #include "Altair8800/memory.h"
+#include "Altair8800/snapshot.h"
 #ifdef SD_CARD_SUPPORT
 #include "Altair8800/pico_88dcdd_sd_card.h"
+#ifdef ALTAIR_HDSK
+#include "Altair8800/pico_hdsk_sd_card.h"
+#endif
 #include "diskio.h"
 #include "drivers/sdcard/sdcard.h"
 #include "ff.h"
+#elif defined(REMOTE_FS)
+#include "Altair8800/pico_88dcdd_remote.h"
+#include "PortDrivers/remote_fs.h"
 #else
 #include "Altair8800/pico_88dcdd_flash.h"
 #endif
 #include "FrontPanels/display_2_8.h"
 #include "FrontPanels/inky_display.h"
+#include "FrontPanels/web_panel.h"
+#include "PortDrivers/disk_fetch.h"
+#include "PortDrivers/printer_io.h"
+#include "PortDrivers/time_io.h"
+#include "ansi_keys.h"
 #include "build_version.h"
+#include "clock_profile.h"
 #include "comms_mgr.h"
 #include "cpu_state.h"
+#include "hardware/irq.h"
 #include "hardware/timer.h"
 #include "io_ports.h"
+#include "load_test.h"
+#include "metrics.h"
 #include "pico/error.h"
 #include "pico/stdlib.h"
+#include "second_machine.h"
+#include "usb_console.h"
 #include "wifi_config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define ASCII_MASK_7BIT 0x7F
-#define CTRL_KEY(ch) ((ch) & 0x1F)
 
-#ifndef SD_CARD_SUPPORT
+// Cycle-accurate pacing: run one slice of T-states, then wait for the wall clock to catch up
+#define THROTTLE_SLICE_US 1000
+#define THROTTLE_MAX_LAG_US 20000
+
+// Unthrottled batch size in T-states (roughly 1000 instructions)
+#define RUN_BATCH_CYCLES 8000
+
+// Idle detection: a batch is idle when it ended on HLT or polled an empty console at least once
+// every IDLE_POLL_GAP_CYCLES T-states. After IDLE_BATCHES_BEFORE_SLEEP idle batches in a row a
+// throttled slice waits out its deadline for an event (core 1 queue push, USB or timer interrupt)
+// instead of spinning. The stopped CPU monitor waits up to IDLE_SLEEP_US between characters.
+#define IDLE_POLL_GAP_CYCLES 256
+#define IDLE_BATCHES_BEFORE_SLEEP 4
+#define IDLE_SLEEP_US 1000
+
+// Fast boot: GPIO that opens the Wi-Fi setup prompt when held low at power-on, -1 for none
+#ifndef ALTAIR_WIFI_SETUP_PIN
+#define ALTAIR_WIFI_SETUP_PIN -1
+#endif
+
+#if !defined(SD_CARD_SUPPORT) && !defined(REMOTE_FS)
+#ifdef ALTAIR_COMPRESSED_DISKS
+// LZ4 track-compressed images, generated from disks/*.dsk at build time
+#include "disks/bdsc_v1_60_disk_lz4.h"
+#include "disks/blank_disk_lz4.h"
+#include "disks/cpm63k_disk_lz4.h"
+#else
 // Include the CPM disk image (only for embedded XIP disk controller)
 #include "Disks/bdsc_v1_60_disk.h"
 #include "Disks/cpm63k_disk.h"
 #endif
+#endif
 
 // WiFi connection status (global for Inky display)
 static bool g_wifi_ok = false;
@@ -56,118 +101,37 @@ void altair_reset(void)
 {
     if (g_disk_controller)
     {
-        memset(memory, 0x00, 64 * 1024); // Clear Altair memory
-        loadDiskLoader(0xFF00);          // Load disk boot loader at 0xFF00
-        i8080_reset(&cpu, terminal_read, terminal_write, sense, g_disk_controller, io_port_in, io_port_out);
+        memory_reset(&memory_main);           // Clear Altair memory and banks
+        loadDiskLoader(&memory_main, 0xFF00); // Load disk boot loader at 0xFF00
+        uint32_t baud = cpu.sio.baud;         // Set with the BAUD monitor command, kept over a reset
+        i8080_reset(&cpu, &memory_main, terminal_read, terminal_write, sense, g_disk_controller, io_port_in,
+                    io_port_out);
+        i8080_sio_set_baud(&cpu, baud);
         i8080_examine(&cpu, 0xFF00); // Reset to boot loader address
         bus_switches = cpu.address_bus;
     }
 }
 
-// Process character through ANSI escape sequence state machine
-static uint8_t process_ansi_sequence(uint8_t ch)
-{
-    // Translate ANSI cursor sequences to the control keys CP/M expects (WordStar style).
-    enum
-    {
-        KEY_STATE_NORMAL = 0,
-        KEY_STATE_ESC,
-        KEY_STATE_ESC_BRACKET,
-        KEY_STATE_ESC_BRACKET_NUM
-    };
-
-    static uint8_t key_state = KEY_STATE_NORMAL;
-    static uint8_t pending_key = 0;
-
-    switch (key_state)
-    {
-        case KEY_STATE_NORMAL:
-            if (ch == 0x1B)
-            {
-                key_state = KEY_STATE_ESC;
-                return 0x00; // Start of escape sequence
-            }
-            if (ch == 0x7F || ch == 0x08)
-            {
-                return (uint8_t)CTRL_KEY('H'); // Map delete/backspace to Ctrl-H (0x08)
-            }
-            return ch;
-
-        case KEY_STATE_ESC:
-            if (ch == '[')
-            {
-                key_state = KEY_STATE_ESC_BRACKET;
-                return 0x00; // Control sequence introducer
-            }
-            key_state = KEY_STATE_NORMAL;
-            return ch; // Pass through unknown sequences
-
-        case KEY_STATE_ESC_BRACKET:
-            switch (ch)
-            {
-                case 'A':
-                    key_state = KEY_STATE_NORMAL;
-                    return (uint8_t)CTRL_KEY('E'); // Up -> Ctrl-E
-                case 'B':
-                    key_state = KEY_STATE_NORMAL;
-                    return (uint8_t)CTRL_KEY('X'); // Down -> Ctrl-X
-                case 'C':
-                    key_state = KEY_STATE_NORMAL;
-                    return (uint8_t)CTRL_KEY('D'); // Right -> Ctrl-D
-                case 'D':
-                    key_state = KEY_STATE_NORMAL;
-                    return (uint8_t)CTRL_KEY('S'); // Left -> Ctrl-S
-                case '2':
-                    // Insert key sends ESC[2~ - need to consume the tilde
-                    pending_key = (uint8_t)CTRL_KEY('O'); // Insert -> Ctrl-O
-                    key_state = KEY_STATE_ESC_BRACKET_NUM;
-                    return 0x00;
-                case '3':
-                    // Delete key sends ESC[3~ - need to consume the tilde
-                    pending_key = (uint8_t)CTRL_KEY('G'); // Delete -> Ctrl-G
-                    key_state = KEY_STATE_ESC_BRACKET_NUM;
-                    return 0x00;
-                default:
-                    key_state = KEY_STATE_NORMAL;
-                    return 0x00; // Ignore other sequences
-            }
-
-        case KEY_STATE_ESC_BRACKET_NUM:
-            key_state = KEY_STATE_NORMAL;
-            if (ch == '~')
-            {
-                // Return the pending key now that we've consumed the tilde
-                uint8_t result = pending_key;
-                pending_key = 0;
-                return result;
-            }
-            pending_key = 0;
-            return 0x00; // Unexpected character, ignore
-    }
-
-    key_state = KEY_STATE_NORMAL;
-    return 0x00;
-}
-
 // Terminal read function - non-blocking
 static uint8_t terminal_read(void)
 {
 
 #if defined(CYW43_WL_GPIO_LED_PIN)
     uint8_t ws_ch = 0;
-    if (websocket_console_try_dequeue_input(&ws_ch))
+    if (websocket_console_input_pending() && websocket_console_try_dequeue_input(&ws_ch))
     {
         return (uint8_t)(ws_ch & ASCII_MASK_7BIT);
     }
 #else
-    int c = getchar_timeout_us(0); // Non-blocking read
-    if (c == PICO_ERROR_TIMEOUT)
+    uint8_t ch = 0;
+    if (!usb_console_try_read(&ch))
     {
         return 0x00; // Return null if no character available
     }
 
-    uint8_t ch = (uint8_t)(c & ASCII_MASK_7BIT);
-    return process_ansi_sequence(ch);
+    // Translate ANSI cursor sequences from the USB terminal
+    static ansi_keys_t usb_keys;
+    return ansi_keys_translate(&usb_keys, (uint8_t)(ch & ASCII_MASK_7BIT));
 #endif
 }
 
@@ -178,7 +142,11 @@ static void terminal_write(uint8_t c)
 #if defined(CYW43_WL_GPIO_LED_PIN)
     websocket_console_enqueue_output(c);
 #else
-    putchar(c);
+    usb_console_write(c);
+    if (cpu_state_get_mode() != CPU_RUNNING)
+    {
+        usb_console_flush(); // Monitor single steps and low power mode, in order with its printf
+    }
 #endif
 }
 
@@ -188,12 +156,25 @@ static inline uint8_t sense(void)
     return (uint8_t)(bus_switches >> 8);
 }
 
-// Initialize and configure WiFi
-static void setup_wifi(void)
+// Wait for a USB serial terminal, at most timeout_ms (0 = forever)
+static void wait_for_usb_terminal(uint32_t timeout_ms)
 {
+    absolute_time_t start_time = get_absolute_time();
+    while (!stdio_usb_connected() &&
+           (timeout_ms == 0 || absolute_time_diff_us(start_time, get_absolute_time()) < (int64_t)timeout_ms * 1000))
+    {
+        sleep_ms(100);
+    }
+    // Give a brief moment after connection for terminal to be ready
+    if (stdio_usb_connected())
+    {
+        sleep_ms(500);
+    }
+}
 
-    // WiFi configuration system already initialized in main()
-
+// Offer to configure/update the WiFi credentials on the USB terminal
+static void wifi_setup_prompt(void)
+{
     // Determine timeout based on whether credentials exist
     uint32_t config_timeout;
     if (wifi_config_exists())
@@ -220,14 +201,11 @@ static void setup_wifi(void)
             printf("No WiFi credentials configured - WiFi will be unavailable\n");
         }
     }
+}
 
-    // Launch network task on core 1 (handles Wi-Fi init, WebSocket server, polling)
-    websocket_console_start();
-
-    // Wait for core 1 to complete Wi-Fi initialization
-    // Returns 0 on failure, or raw 32-bit IP address on success
-    printf("Waiting for Wi-Fi initialization on core 1...\n");
-    uint32_t ip_raw = wait_for_wifi();
+// Record the outcome core 1 reported (0 on failure, or the raw IP address)
+static void wifi_report(uint32_t ip_raw)
+{
     g_wifi_ok = (ip_raw != 0);
 
     if (g_wifi_ok)
@@ -245,80 +223,257 @@ static void setup_wifi(void)
     }
 }
 
-#ifdef DISPLAY_2_8_SUPPORT
-// Global flag set by timer callback every 20ms
-static volatile bool display_update_pending = false;
+#ifdef ALTAIR_FAST_BOOT
+// Fast boot skips the WiFi prompt unless there is nothing to connect with yet or the setup
+// button (ALTAIR_WIFI_SETUP_PIN, pulled low) is held at power-on
+static bool wifi_setup_requested(void)
+{
+    if (!wifi_config_exists())
+    {
+        return true;
+    }
+#if ALTAIR_WIFI_SETUP_PIN >= 0
+    gpio_init(ALTAIR_WIFI_SETUP_PIN);
+    gpio_set_dir(ALTAIR_WIFI_SETUP_PIN, GPIO_IN);
+    gpio_pull_up(ALTAIR_WIFI_SETUP_PIN);
+    sleep_us(100); // Let the pull-up settle
+    bool held = !gpio_get(ALTAIR_WIFI_SETUP_PIN);
+    gpio_deinit(ALTAIR_WIFI_SETUP_PIN);
+    return held;
+#else
+    return false;
+#endif
+}
+#endif
 
-// Timer callback - fires every 20ms (50 Hz)
-static bool display_timer_callback(struct repeating_timer* t)
+#if defined(ALTAIR_FAST_BOOT) && defined(CYW43_WL_GPIO_LED_PIN)
+// Pick up the result once core 1 is done and show it, called from the emulation loop
+static void wifi_poll_boot(void)
 {
-    display_update_pending = true;
-    return true; // Keep repeating
+    static bool reported = false;
+    uint32_t ip_raw = 0;
+    if (reported || !wifi_poll_result(&ip_raw))
+    {
+        return;
+    }
+    reported = true;
+    wifi_report(ip_raw);
+
+    const char* wifi_ssid = g_wifi_ok ? get_connected_ssid() : NULL;
+    inky_display_update(wifi_ssid, g_wifi_ok ? g_ip_buffer : NULL);
+    display_2_8_update(wifi_ssid, g_wifi_ok ? g_ip_buffer : NULL);
+}
+#endif
+
+// Initialize and configure WiFi
+static void setup_wifi(void)
+{
+    // WiFi configuration system already initialized in main()
+
+#ifdef ALTAIR_FAST_BOOT
+    if (wifi_setup_requested())
+    {
+        wait_for_usb_terminal(0);
+        wifi_setup_prompt();
+    }
+
+    // Core 1 connects in the background, the emulator boots meanwhile and picks up the result
+    // in wifi_poll_boot. Console clients attach once the servers are up.
+    websocket_console_start();
+    printf("Wi-Fi starting on core 1 in the background\n");
+#else
+    wifi_setup_prompt();
+
+    // Launch network task on core 1 (handles Wi-Fi init, WebSocket server, polling)
+    websocket_console_start();
+
+    // Wait for core 1 to complete Wi-Fi initialization
+    // Returns 0 on failure, or raw 32-bit IP address on success
+    printf("Waiting for Wi-Fi initialization on core 1...\n");
+    wifi_report(wait_for_wifi());
+#endif
+}
+
+// Pacing state for cycle-accurate mode
+static uint64_t throttle_deadline_us = 0;
+static int32_t throttle_cycle_debt = 0;
+static uint32_t throttle_clock_khz = 0; // Clock the deadline and debt were kept for
+
+// Consecutive idle batches seen by run_batch
+static uint32_t idle_batches = 0;
+
+// Run one batch and account its T-states and host time to the metrics
+static inline uint32_t run_batch(uint32_t n_cycles)
+{
+    uint32_t start_us = time_us_32();
+    cpu.idle_polls = 0;
+    uint32_t t_states = i8080_run(&cpu, n_cycles);
+    metrics_core0_cpu(t_states, time_us_32() - start_us);
+#if !defined(CYW43_WL_GPIO_LED_PIN)
+    usb_console_flush(); // Guest output ahead of any printf
+#endif
+
+#ifdef ALTAIR_BREAKPOINTS
+    if (i8080_break.hit != I8080_BREAK_NONE)
+    {
+        cpu_state_stop_at_break();
+    }
+#endif
+
+    if (cpu.halted || (cpu.idle_polls != 0 && cpu.idle_polls * IDLE_POLL_GAP_CYCLES >= t_states))
+    {
+        idle_batches++;
+    }
+    else
+    {
+        idle_batches = 0;
+    }
+    return t_states;
+}
+
+// True once the guest has been halted or spinning on an empty console for a few batches
+static inline bool cpu_is_idle(void)
+{
+#ifdef ALTAIR_IDLE_SLEEP
+    return idle_batches >= IDLE_BATCHES_BEFORE_SLEEP;
+#else
+    return false;
+#endif
+}
+
+// Wait until an interrupt, a cross-core event (console input or a queue push from core 1) or
+// the timeout. Input then shows up on the guest's next console poll.
+static inline void idle_wait_until(absolute_time_t timeout)
+{
+    best_effort_wfe_or_timeout(timeout);
+}
+
+// Execute one 1 ms slice worth of T-states at the configured clock, then busy-wait until the
+// slice deadline. Excess cycles from the last instruction carry over into the next slice.
+static void run_throttled_slice(uint32_t clock_khz)
+{
+    uint64_t now = time_us_64();
+
+    // Resynchronise after a stop, a clock change or when the host cannot keep up
+    if (throttle_deadline_us == 0 || clock_khz != throttle_clock_khz ||
+        now > throttle_deadline_us + THROTTLE_MAX_LAG_US)
+    {
+        throttle_deadline_us = now;
+        throttle_cycle_debt = 0;
+        throttle_clock_khz = clock_khz;
+    }
+
+    int32_t budget = (int32_t)(clock_khz * THROTTLE_SLICE_US / 1000) - throttle_cycle_debt;
+    int32_t executed = 0;
+
+    while (executed < budget && cpu_state_get_mode() == CPU_RUNNING)
+    {
+        executed += (int32_t)run_batch((uint32_t)(budget - executed));
+    }
+
+    throttle_cycle_debt = executed - budget;
+    throttle_deadline_us += THROTTLE_SLICE_US;
+
+    // An idle guest does not need exact pacing, so sleep out the slice instead of spinning
+    if (cpu_is_idle())
+    {
+        idle_wait_until(from_us_since_boot(throttle_deadline_us));
+    }
+    else
+    {
+        busy_wait_until(from_us_since_boot(throttle_deadline_us));
+    }
 }
 
-// Function to update the display (called from main loop)
-static inline void update_display_if_changed(void)
+// Front panel status LEDs:
+// Bits 0-7: CPU status byte (MEMR, INP, M1, OUT, HLTA, STACK, WO, INT)
+// Bit 9: INTE (Interrupt Enable) flag from CPU flags
+static inline uint16_t front_panel_status_word(void)
 {
-    // Construct 10-bit status word for display:
-    // Bits 0-7: CPU status byte (MEMR, INP, M1, OUT, HLTA, STACK, WO, INT)
-    // Bit 9: INTE (Interrupt Enable) flag from CPU flags
     uint16_t status_word = cpu.cpuStatus;
     if (cpu.registers.flags & FLAGS_IF)
         status_word |= (1 << 9);
+    return status_word;
+}
+
+#if defined(DISPLAY_2_8_SUPPORT) && !defined(CYW43_WL_GPIO_LED_PIN)
+// Without Wi-Fi there is no core 1 task to draw the 2.8" front panel (see comms_mgr.c). A 50 Hz
+// timer raises a spare IRQ at the lowest priority and the panel is drawn from the bus state in
+// web_panel.h there, so the emulation loop never polls for it and every other IRQ comes first.
+static int display_irq = -1;
+
+static void display_irq_handler(void)
+{
+    uint32_t start_us = time_us_32();
+    display_2_8_show_published();
+    metrics_core0_display(time_us_32() - start_us);
+}
+
+static bool display_timer_callback(struct repeating_timer* t)
+{
+    (void)t;
+    irq_set_pending((uint)display_irq);
+    return true; // Keep repeating
+}
+
+static void display_start(void)
+{
+    display_irq = user_irq_claim_unused(true);
+    irq_set_exclusive_handler((uint)display_irq, display_irq_handler);
+    irq_set_priority((uint)display_irq, PICO_LOWEST_IRQ_PRIORITY);
+    irq_set_enabled((uint)display_irq, true);
 
-    // display_2_8_show_front_panel handles change detection internally
-    display_2_8_show_front_panel(cpu.address_bus, cpu.data_bus, status_word);
+    static struct repeating_timer display_timer;
+    add_repeating_timer_us(-DISPLAY_2_8_FRAME_US, display_timer_callback, NULL, &display_timer);
+    printf("Display update timer started (50 Hz)\n");
 }
 #endif
 
 int main(void)
 {
+    // Raise the system clock before any peripheral derives its divider from it
+    clock_profile_apply();
+
     // Initialize stdio first
     stdio_init_all();
 
     // Initialize displays early (if enabled)
     inky_display_init();
-    display_2_8_init();
+#if !defined(CYW43_WL_GPIO_LED_PIN)
+    display_2_8_init(); // Core 1 owns the 2.8" display on Wi-Fi boards
+#endif
 
 #if defined(CYW43_WL_GPIO_LED_PIN)
     // Board has WiFi - check if credentials exist
     wifi_config_init();
 
+#ifndef ALTAIR_FAST_BOOT
     if (!wifi_config_exists())
     {
         // No credentials - wait for USB serial connection so user sees WiFi config prompt
-        while (!stdio_usb_connected())
-        {
-            sleep_ms(100);
-        }
-        // Give a brief moment after connection for terminal to be ready
-        sleep_ms(500);
+        wait_for_usb_terminal(0);
     }
     else
     {
         // Credentials exist - wait up to 10 seconds for USB connection, then proceed
-        absolute_time_t start_time = get_absolute_time();
-        while (!stdio_usb_connected() && absolute_time_diff_us(start_time, get_absolute_time()) < 10000000)
-        {
-            sleep_ms(100);
-        }
-        // Give a brief moment after connection for terminal to be ready
-        if (stdio_usb_connected())
-        {
-            sleep_ms(500);
-        }
+        wait_for_usb_terminal(10000);
     }
+#endif
 
     setup_wifi();
+#ifdef ALTAIR_FAST_BOOT
+    // Run without waiting for a console client to connect
+    cpu_state_set_mode(CPU_RUNNING);
+#endif
 #else
+#ifndef ALTAIR_FAST_BOOT
     // Board has no WiFi - wait for USB serial connection before proceeding
     // This ensures we don't miss any output on non-WiFi boards
-    while (!stdio_usb_connected())
-    {
-        sleep_ms(100);
-    }
-    // Give a brief moment after connection for terminal to be ready
-    sleep_ms(500);
+    wait_for_usb_terminal(0);
+#endif
+
+    // Core 1 has no network task here, a second machine may run on it instead
+    second_machine_start();
 
     cpu_state_set_mode(CPU_RUNNING);
 #endif
@@ -331,6 +486,7 @@ int main(void)
     printf("  Build: %d (%s %s)\n", BUILD_VERSION, BUILD_DATE, BUILD_TIME);
     printf("========================================\n");
     printf("\n");
+    clock_profile_report();
 
 #if defined(CYW43_WL_GPIO_LED_PIN)
     printf("HTTP file transfer: Enabled (gf command supported)\n");
@@ -343,6 +499,8 @@ int main(void)
     printf("Initializing disk controller...\n");
 #ifdef SD_CARD_SUPPORT
     sd_disk_init();
+#elif defined(REMOTE_FS)
+    remote_disk_init();
 #else
     pico_disk_init();
 #endif
@@ -377,11 +535,40 @@ int main(void)
 
     printf("SD card mounted successfully.\n");
 
-    // Load disk images from SD card
-    printf("Opening DISK_A: %s\n", DISK_A_PATH);
-    if (sd_disk_load(0, DISK_A_PATH))
+    // Load disk images from SD card. Only drive A is needed to boot, the others can be mounted later.
+    static const char* const disk_paths[MAX_DRIVES] = {DISK_A_PATH, DISK_B_PATH, DISK_C_PATH, DISK_D_PATH};
+    for (uint8_t drive = 0; drive < MAX_DRIVES; drive++)
+    {
+        printf("Opening DISK_%c: %s\n", 'A' + drive, disk_paths[drive]);
+        if (sd_disk_load(drive, disk_paths[drive]))
+        {
+            printf("DISK_%c opened successfully\n", 'A' + drive);
+        }
+        else if (drive == DRIVE_A)
+        {
+            printf("DISK_A initialization failed!\n");
+            return -1;
+        }
+        else
+        {
+            printf("DISK_%c initialization failed, drive left empty (MOUNT an image)\n", 'A' + drive);
+        }
+    }
+
+#ifdef ALTAIR_HDSK
+    // Hard disk images are optional, drives without one answer HDSK_ERROR
+    printf("Hard disks: %u attached on port 0x%02X\n", hdsk_init(), HDSK_PORT);
+#endif
+#elif defined(REMOTE_FS)
+    // Sectors are read on demand once core 1 has connected to the server
+    printf("Disks A-D: RemoteFS server %s:%d\n", REMOTE_FS_SERVER_IP, REMOTE_FS_SERVER_PORT);
+#elif defined(ALTAIR_COMPRESSED_DISKS)
+    // Compressed images are small enough to fill all four drives
+    printf("Opening DISK_A: cpm63k.dsk (embedded, compressed)\n");
+    if (pico_disk_load_lz4(0, cpm63k_dsk_lz4, cpm63k_dsk_lz4_track, cpm63k_dsk_len))
     {
-        printf("DISK_A opened successfully\n");
+        printf("DISK_A opened successfully (%u bytes, %u compressed)\n", cpm63k_dsk_len,
+               (unsigned int)sizeof(cpm63k_dsk_lz4));
     }
     else
     {
@@ -389,10 +576,11 @@ int main(void)
         return -1;
     }
 
-    printf("Opening DISK_B: %s\n", DISK_B_PATH);
-    if (sd_disk_load(1, DISK_B_PATH))
+    printf("Opening DISK_B: bdsc_v1_60.dsk (embedded, compressed)\n");
+    if (pico_disk_load_lz4(1, bdsc_v1_60_dsk_lz4, bdsc_v1_60_dsk_lz4_track, bdsc_v1_60_dsk_len))
     {
-        printf("DISK_B opened successfully\n");
+        printf("DISK_B opened successfully (%u bytes, %u compressed)\n", bdsc_v1_60_dsk_len,
+               (unsigned int)sizeof(bdsc_v1_60_dsk_lz4));
     }
     else
     {
@@ -400,10 +588,11 @@ int main(void)
         return -1;
     }
 
-    printf("Opening DISK_C: %s\n", DISK_C_PATH);
-    if (sd_disk_load(2, DISK_C_PATH))
+    // Drives C and D share the one blank image, their writes are kept apart per drive
+    printf("Opening DISK_C: blank.dsk (embedded, compressed)\n");
+    if (pico_disk_load_lz4(2, blank_disk_lz4, blank_disk_lz4_track, blank_disk_len))
     {
-        printf("DISK_C opened successfully\n");
+        printf("DISK_C opened successfully (%u bytes)\n", blank_disk_len);
     }
     else
     {
@@ -411,10 +600,10 @@ int main(void)
         return -1;
     }
 
-    printf("Opening DISK_D: %s\n", DISK_D_PATH);
-    if (sd_disk_load(3, DISK_D_PATH))
+    printf("Opening DISK_D: blank.dsk (embedded, compressed)\n");
+    if (pico_disk_load_lz4(3, blank_disk_lz4, blank_disk_lz4_track, blank_disk_len))
     {
-        printf("DISK_D opened successfully\n");
+        printf("DISK_D opened successfully (%u bytes)\n", blank_disk_len);
     }
     else
     {
@@ -449,7 +638,7 @@ int main(void)
 
     // Load disk boot loader ROM at 0xFF00 (ROM_LOADER_ADDRESS)
     printf("Loading disk boot loader ROM at 0xFF00...\n");
-    loadDiskLoader(0xFF00);
+    loadDiskLoader(&memory_main, 0xFF00);
 
     // Set up disk controller structure for CPU
 #ifdef SD_CARD_SUPPORT
@@ -459,6 +648,13 @@ int main(void)
                                                 .sector = (port_in)sd_disk_sector,
                                                 .write = (port_out)sd_disk_write,
                                                 .read = (port_in)sd_disk_read};
+#elif defined(REMOTE_FS)
+    static disk_controller_t disk_controller = {.disk_select = (port_out)remote_disk_select,
+                                                .disk_status = (port_in)remote_disk_status,
+                                                .disk_function = (port_out)remote_disk_function,
+                                                .sector = (port_in)remote_disk_sector,
+                                                .write = (port_out)remote_disk_write,
+                                                .read = (port_in)remote_disk_read};
 #else
     static disk_controller_t disk_controller = {.disk_select = (port_out)pico_disk_select,
                                                 .disk_status = (port_in)pico_disk_status,
@@ -471,14 +667,31 @@ int main(void)
     // Store reference for reset function
     g_disk_controller = &disk_controller;
 
+#if !defined(CYW43_WL_GPIO_LED_PIN)
+    usb_console_init();
+#endif
+
     // Reset and initialize the CPU
     printf("Initializing Intel 8080 CPU...\n");
-    i8080_reset(&cpu, terminal_read, terminal_write, sense, &disk_controller, io_port_in, io_port_out);
+    io_ports_init();
+    i8080_reset(&cpu, &memory_main, terminal_read, terminal_write, sense, &disk_controller, io_port_in,
+                io_port_out);
 
     // Set CPU to start at ROM_LOADER_ADDRESS (0xFF00) to boot from disk
     printf("Setting CPU to ROM_LOADER_ADDRESS (0xFF00) to boot from disk\n");
     i8080_examine(&cpu, 0xFF00);
 
+    // A saved machine takes the place of the cold boot
+    SNAPSHOT_RESULT snapshot = snapshot_restore();
+    if (snapshot == SNAPSHOT_OK)
+    {
+        printf("Restored machine snapshot, continuing at %04X\n", cpu.registers.pc);
+    }
+    else if (snapshot == SNAPSHOT_CORRUPT || snapshot == SNAPSHOT_MISMATCH || snapshot == SNAPSHOT_IO_ERROR)
+    {
+        printf("Machine snapshot not restored: %s\n", snapshot_result_text(snapshot));
+    }
+
     // Report basic memory usage at startup (static allocation only)
     extern char __StackLimit, __bss_end__;
     extern char __flash_binary_end;
@@ -506,7 +719,8 @@ int main(void)
     printf("  RAM used:       %lu bytes (%.1f KB)\n", used_ram, used_ram / 1024.0f);
     printf("  RAM free (heap):%lu bytes (%.1f KB)\n", heap_free, heap_free / 1024.0f);
     printf("  Total SRAM:     %lu bytes (%.1f KB)\n", total_ram, total_ram / 1024.0f);
-    printf("  Altair memory:  65536 bytes (64 KB)\n");
+    uint32_t altair_ram = 64 * 1024 + (ALTAIR_MEMORY_BANKS - 1) * ALTAIR_BANK_COMMON_BASE;
+    printf("  Altair memory:  %lu bytes (%.1f KB, %d bank(s))\n", altair_ram, altair_ram / 1024.0f, ALTAIR_MEMORY_BANKS);
     printf("\n");
 
     printf("Starting Altair 8800 emulation...\n");
@@ -524,28 +738,44 @@ int main(void)
 #endif
 
 #ifdef DISPLAY_2_8_SUPPORT
-    printf("\n*** Virtual Front Panel (Core 0 Enabled - Polling) ***\n");
+#if defined(CYW43_WL_GPIO_LED_PIN)
+    printf("\n*** Virtual Front Panel (Core 1) ***\n");
+#else
+    printf("\n*** Virtual Front Panel (Core 0 low-priority IRQ) ***\n");
     display_2_8_init_front_panel();
-
-    // Start hardware timer for display updates (20ms = 50 Hz)
-    static struct repeating_timer display_timer;
-    add_repeating_timer_ms(-20, display_timer_callback, NULL, &display_timer);
-    printf("Display update timer started (50 Hz)\n");
+    display_start();
+#endif
 #endif
     // ============================================
 
+    // Load test builds serve a fixed workload on the console from here on
+    load_test_run();
+
     // Main emulation loop - core 0 dedicated to CPU emulation
     for (;;)
     {
+#if defined(ALTAIR_FAST_BOOT) && defined(CYW43_WL_GPIO_LED_PIN)
+        wifi_poll_boot();
+#endif
         CPU_OPERATING_MODE mode = cpu_state_get_mode();
         switch (mode)
         {
             case CPU_RUNNING:
-                for (int i = 0; i < 1000; ++i)
+            {
+                time_io_poll(time_us_32());
+                snapshot_poll(time_us_32());
+                uint32_t clock_khz = cpu_state_get_clock_khz();
+                if (clock_khz == 0)
                 {
-                    i8080_cycle(&cpu);
+                    // Unthrottled the guest gets all of core 0, polling or not
+                    run_batch(RUN_BATCH_CYCLES);
                 }
-                break;
+                else
+                {
+                    run_throttled_slice(clock_khz);
+                }
+            }
+            break;
             case CPU_LOW_POWER:
                 i8080_cycle(&cpu);
                 sleep_us(1);
@@ -558,6 +788,12 @@ int main(void)
                     // Process monitor input character
                     process_control_panel_commands_char(ch);
                 }
+#ifdef ALTAIR_IDLE_SLEEP
+                else
+                {
+                    idle_wait_until(make_timeout_time_us(IDLE_SLEEP_US));
+                }
+#endif
             }
             break;
             default:
@@ -565,13 +801,33 @@ int main(void)
                 break;
         }
 
-#ifdef DISPLAY_2_8_SUPPORT
-        // Check if display update is pending (set by timer callback every 20ms)
-        if (display_update_pending)
-        {
-            display_update_pending = false;
-            update_display_if_changed();
-        }
+        // Bus state for the browser and 2.8" front panels
+        web_panel_publish(cpu.address_bus, cpu.data_bus, front_panel_status_word());
+
+#ifdef SD_CARD_SUPPORT
+        // Write back the disk cache once the guest stops writing
+        sd_disk_poll(time_us_32());
+        disk_fetch_poll(); // Mount a downloaded image
+        printer_io_poll(); // Print spool onto the card on boards without Wi-Fi
+#ifdef ALTAIR_HDSK
+        hdsk_poll(time_us_32());
+        metrics_disk_dirty(sd_disk_dirty_sectors() + hdsk_dirty_sectors());
+#else
+        metrics_disk_dirty(sd_disk_dirty_sectors());
 #endif
+#elif defined(REMOTE_FS)
+        // Queue writes that did not fit into the RemoteFS request queue
+        remote_disk_poll(time_us_32());
+        metrics_disk_dirty(remote_disk_dirty_sectors());
+#elif defined(ALTAIR_FLASH_DISK_LOG)
+        // Save written sectors to the flash patch log once the guest stops writing
+        pico_disk_poll(time_us_32());
+        metrics_disk_dirty(pico_disk_dirty_sectors());
+#endif
+
+        metrics_update();
+
+        // E-ink status lines, refreshed on the panel in the background when they change
+        inky_display_poll(time_us_32(), mode == CPU_RUNNING, metrics_get()->disk_dirty_sectors != 0);
     }
 }
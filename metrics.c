@@ -0,0 +1,320 @@
+#include "metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "cpu_state.h"
+#include "wifi_power.h"
+
+// Core 0 counters
+static uint32_t core0_cpu_us = 0;
+static uint32_t core0_display_us = 0;
+static uint64_t t_states_total = 0;
+static uint64_t http_bytes_total = 0;
+static uint32_t http_chunks_total = 0;
+static volatile uint32_t ws_tx_high_water = 0;
+static uint32_t disk_dirty_sectors = 0;
+static uint32_t ws_tx_dropped = 0;
+static uint32_t ws_tx_stall_us = 0;
+
+// Core 1 counters (single writer, read by core 0 when the window rolls)
+static volatile uint32_t core1_busy_us = 0;
+static volatile uint32_t ws_rx_high_water = 0;
+static volatile uint32_t ws_rx_dropped = 0;
+static volatile uint32_t ws_tx_skipped = 0;
+static volatile uint32_t ws_frame_sizes[METRICS_WS_SIZE_BUCKETS] = {0};
+static volatile uint32_t ws_frame_latency[METRICS_WS_LATENCY_BUCKETS] = {0};
+static volatile uint32_t wifi_pm_mode = WIFI_POWER_BALANCED; // The mode the radio starts in
+static volatile uint32_t wifi_pm_switches = 0;
+static volatile uint32_t wifi_pm_ms[METRICS_WIFI_PM_MODES] = {0};
+
+// Upper bounds of all but the last (open) histogram bucket
+static const uint32_t ws_size_limits[METRICS_WS_SIZE_BUCKETS - 1] = {16, 64, 256, 1024};
+static const uint32_t ws_latency_limits_us[METRICS_WS_LATENCY_BUCKETS - 1] = {1000, 5000, 10000, 20000, 50000};
+
+// Window state (core 0)
+static uint32_t window_start_us = 0;
+static uint32_t window_instructions = 0;
+static uint64_t window_t_states = 0;
+static uint32_t window_cpu_us = 0;
+static uint32_t window_display_us = 0;
+static uint32_t window_core1_busy_us = 0;
+static uint64_t window_http_bytes = 0;
+static uint32_t window_http_chunks = 0;
+static uint64_t instructions_total = 0;
+
+static metrics_snapshot_t snapshot = {0};
+static volatile uint32_t snapshot_sequence = 0; // Odd while metrics_update is writing snapshot
+
+void metrics_core0_cpu(uint32_t t_states, uint32_t elapsed_us)
+{
+    t_states_total += t_states;
+    core0_cpu_us += elapsed_us;
+}
+
+void metrics_core0_display(uint32_t elapsed_us)
+{
+    core0_display_us += elapsed_us;
+}
+
+void metrics_http_chunk(size_t len)
+{
+    http_bytes_total += len;
+    http_chunks_total++;
+}
+
+void metrics_disk_dirty(uint32_t sectors)
+{
+    disk_dirty_sectors = sectors;
+}
+
+void metrics_core1_iteration(uint32_t elapsed_us)
+{
+    if (elapsed_us >= METRICS_CORE1_IDLE_US)
+    {
+        core1_busy_us += elapsed_us;
+    }
+}
+
+void metrics_ws_tx_level(uint32_t level)
+{
+    if (level > ws_tx_high_water)
+    {
+        ws_tx_high_water = level;
+    }
+}
+
+void metrics_ws_rx_level(uint32_t level)
+{
+    if (level > ws_rx_high_water)
+    {
+        ws_rx_high_water = level;
+    }
+}
+
+void metrics_ws_rx_dropped(uint32_t bytes)
+{
+    ws_rx_dropped += bytes;
+}
+
+void metrics_ws_tx_dropped(uint32_t bytes)
+{
+    ws_tx_dropped += bytes;
+}
+
+void metrics_ws_tx_skipped(uint32_t bytes)
+{
+    ws_tx_skipped += bytes;
+}
+
+void metrics_ws_tx_stall(uint32_t elapsed_us)
+{
+    ws_tx_stall_us += elapsed_us;
+}
+
+static size_t bucket(uint32_t value, const uint32_t* limits, size_t count)
+{
+    size_t i = 0;
+    while (i < count && value >= limits[i])
+    {
+        i++;
+    }
+    return i;
+}
+
+void metrics_ws_frame(uint32_t bytes, uint32_t latency_us)
+{
+    ws_frame_sizes[bucket(bytes, ws_size_limits, METRICS_WS_SIZE_BUCKETS - 1)]++;
+    ws_frame_latency[bucket(latency_us, ws_latency_limits_us, METRICS_WS_LATENCY_BUCKETS - 1)]++;
+}
+
+void metrics_wifi_pm(uint8_t mode, uint32_t held_ms)
+{
+    wifi_pm_ms[wifi_pm_mode] += held_ms;
+    wifi_pm_mode = mode;
+    wifi_pm_switches++;
+}
+
+static uint16_t permille(uint32_t part, uint32_t whole)
+{
+    if (whole == 0)
+    {
+        return 0;
+    }
+    uint64_t value = (uint64_t)part * 1000 / whole;
+    return (uint16_t)(value > 1000 ? 1000 : value);
+}
+
+static uint32_t per_second(uint64_t count, uint32_t elapsed_us)
+{
+    return elapsed_us ? (uint32_t)(count * 1000000ULL / elapsed_us) : 0;
+}
+
+void metrics_update(void)
+{
+    uint32_t now = time_us_32();
+    uint32_t elapsed = now - window_start_us;
+
+    if (elapsed < METRICS_WINDOW_US)
+    {
+        return;
+    }
+
+    uint32_t instructions = cpu.instruction_count;
+    uint32_t executed = instructions - window_instructions;
+    uint32_t core1_busy = core1_busy_us;
+
+    instructions_total += executed;
+
+    __atomic_store_n(&snapshot_sequence, snapshot_sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    snapshot.instructions_per_sec = per_second(executed, elapsed);
+    snapshot.t_states_per_sec = per_second(t_states_total - window_t_states, elapsed);
+    snapshot.core0_cpu_permille = permille(core0_cpu_us - window_cpu_us, elapsed);
+    snapshot.core0_display_permille = permille(core0_display_us - window_display_us, elapsed);
+    snapshot.core1_busy_permille = permille(core1_busy - window_core1_busy_us, elapsed);
+    snapshot.ws_tx_high_water = ws_tx_high_water;
+    snapshot.ws_rx_high_water = ws_rx_high_water;
+    snapshot.http_bytes_per_sec = per_second(http_bytes_total - window_http_bytes, elapsed);
+    snapshot.http_chunks_per_sec = per_second(http_chunks_total - window_http_chunks, elapsed);
+    snapshot.disk_dirty_sectors = disk_dirty_sectors;
+    snapshot.ws_rx_dropped = ws_rx_dropped;
+    snapshot.ws_tx_dropped = ws_tx_dropped;
+    snapshot.ws_tx_skipped = ws_tx_skipped;
+    snapshot.ws_tx_stall_us = ws_tx_stall_us;
+    snapshot.wifi_pm_mode = wifi_pm_mode;
+    snapshot.wifi_pm_switches = wifi_pm_switches;
+    snapshot.instructions = instructions_total;
+    snapshot.t_states = t_states_total;
+    snapshot.http_bytes = http_bytes_total;
+    snapshot.http_chunks = http_chunks_total;
+    for (size_t i = 0; i < METRICS_WS_SIZE_BUCKETS; i++)
+    {
+        snapshot.ws_frame_sizes[i] = ws_frame_sizes[i];
+    }
+    for (size_t i = 0; i < METRICS_WS_LATENCY_BUCKETS; i++)
+    {
+        snapshot.ws_frame_latency[i] = ws_frame_latency[i];
+    }
+    for (size_t i = 0; i < METRICS_WIFI_PM_MODES; i++)
+    {
+        snapshot.wifi_pm_ms[i] = wifi_pm_ms[i];
+    }
+    __atomic_store_n(&snapshot_sequence, snapshot_sequence + 1, __ATOMIC_RELEASE);
+
+    window_start_us = now;
+    window_instructions = instructions;
+    window_t_states = t_states_total;
+    window_cpu_us = core0_cpu_us;
+    window_display_us = core0_display_us;
+    window_core1_busy_us = core1_busy;
+    window_http_bytes = http_bytes_total;
+    window_http_chunks = http_chunks_total;
+}
+
+const metrics_snapshot_t* metrics_get(void)
+{
+    return &snapshot;
+}
+
+uint32_t metrics_window(void)
+{
+    return __atomic_load_n(&snapshot_sequence, __ATOMIC_ACQUIRE) / 2;
+}
+
+uint32_t metrics_copy(metrics_snapshot_t* out)
+{
+    for (;;)
+    {
+        uint32_t sequence = __atomic_load_n(&snapshot_sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1)
+        {
+            continue;
+        }
+        memcpy(out, (const void*)&snapshot, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&snapshot_sequence, __ATOMIC_RELAXED) == sequence)
+        {
+            return sequence / 2;
+        }
+    }
+}
+
+static uint32_t metric_value(uint8_t metric)
+{
+    switch (metric)
+    {
+        case METRIC_INSTRUCTIONS_PER_SEC:
+            return snapshot.instructions_per_sec;
+        case METRIC_T_STATES_PER_SEC:
+            return snapshot.t_states_per_sec;
+        case METRIC_CORE0_CPU_PERMILLE:
+            return snapshot.core0_cpu_permille;
+        case METRIC_CORE0_DISPLAY_PERMILLE:
+            return snapshot.core0_display_permille;
+        case METRIC_CORE1_BUSY_PERMILLE:
+            return snapshot.core1_busy_permille;
+        case METRIC_WS_TX_HIGH_WATER:
+            return snapshot.ws_tx_high_water;
+        case METRIC_WS_RX_HIGH_WATER:
+            return snapshot.ws_rx_high_water;
+        case METRIC_HTTP_BYTES_PER_SEC:
+            return snapshot.http_bytes_per_sec;
+        case METRIC_HTTP_CHUNKS:
+            return snapshot.http_chunks;
+        case METRIC_DISK_DIRTY_SECTORS:
+            return snapshot.disk_dirty_sectors;
+        case METRIC_WS_RX_DROPPED:
+            return snapshot.ws_rx_dropped;
+        case METRIC_WS_TX_DROPPED:
+            return snapshot.ws_tx_dropped;
+        case METRIC_WS_TX_SKIPPED:
+            return snapshot.ws_tx_skipped;
+        case METRIC_WS_TX_STALL_MS:
+            return snapshot.ws_tx_stall_us / 1000;
+        case METRIC_WIFI_PM_MODE:
+            return snapshot.wifi_pm_mode;
+        case METRIC_WIFI_PM_SWITCHES:
+            return snapshot.wifi_pm_switches;
+        default:
+            return 0;
+    }
+}
+
+size_t metrics_port_output(uint8_t metric, char* buffer, size_t buffer_length)
+{
+    if (buffer == NULL || buffer_length == 0)
+    {
+        return 0;
+    }
+
+    if (metric == METRIC_SUMMARY)
+    {
+        int len = snprintf(buffer, buffer_length, "IPS=%lu TPS=%lu CPU=%u DISP=%u CORE1=%u TXHW=%lu RXHW=%lu HTTPBPS=%lu DIRTY=%lu\n",
+                           (unsigned long)snapshot.instructions_per_sec, (unsigned long)snapshot.t_states_per_sec,
+                           snapshot.core0_cpu_permille, snapshot.core0_display_permille,
+                           snapshot.core1_busy_permille, (unsigned long)snapshot.ws_tx_high_water,
+                           (unsigned long)snapshot.ws_rx_high_water, (unsigned long)snapshot.http_bytes_per_sec,
+                           (unsigned long)snapshot.disk_dirty_sectors);
+        if (len < 0)
+        {
+            return 0;
+        }
+        return (size_t)len < buffer_length ? (size_t)len : buffer_length - 1;
+    }
+
+    if (buffer_length < 4)
+    {
+        return 0;
+    }
+
+    // Individual metrics are returned as 32-bit little-endian values
+    uint32_t value = metric_value(metric);
+    buffer[0] = (char)(value & 0xff);
+    buffer[1] = (char)((value >> 8) & 0xff);
+    buffer[2] = (char)((value >> 16) & 0xff);
+    buffer[3] = (char)((value >> 24) & 0xff);
+    return 4;
+}
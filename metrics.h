@@ -0,0 +1,117 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Rates are recomputed once per window by metrics_update() on core 0
+#define METRICS_WINDOW_US 1000000
+
+// Core 1 poll loop iterations shorter than this did no real work and count as idle
+#define METRICS_CORE1_IDLE_US 5
+
+// WebSocket console frame histograms: payload size up to 15, 63, 255, 1023 bytes or larger,
+// and the wait of the oldest byte up to 1, 5, 10, 20, 50 ms or longer
+#define METRICS_WS_SIZE_BUCKETS 5
+#define METRICS_WS_LATENCY_BUCKETS 6
+
+// CYW43 power save modes wifi_power switches between (WIFI_POWER_MODES)
+#define METRICS_WIFI_PM_MODES 3
+
+typedef enum
+{
+    METRIC_SUMMARY = 0,
+    METRIC_INSTRUCTIONS_PER_SEC = 1,
+    METRIC_T_STATES_PER_SEC = 2,
+    METRIC_CORE0_CPU_PERMILLE = 3,
+    METRIC_CORE0_DISPLAY_PERMILLE = 4,
+    METRIC_CORE1_BUSY_PERMILLE = 5,
+    METRIC_WS_TX_HIGH_WATER = 6,
+    METRIC_WS_RX_HIGH_WATER = 7,
+    METRIC_HTTP_BYTES_PER_SEC = 8,
+    METRIC_HTTP_CHUNKS = 9,
+    METRIC_DISK_DIRTY_SECTORS = 10,
+    METRIC_WS_RX_DROPPED = 11,
+    METRIC_WS_TX_DROPPED = 12,
+    METRIC_WS_TX_SKIPPED = 13,
+    METRIC_WS_TX_STALL_MS = 14,
+    METRIC_WIFI_PM_MODE = 15,
+    METRIC_WIFI_PM_SWITCHES = 16,
+    METRIC_COUNT
+} METRIC_ID;
+
+typedef struct
+{
+    uint32_t instructions_per_sec;
+    uint32_t t_states_per_sec;
+    uint16_t core0_cpu_permille;     // Share of core 0 time inside i8080_run
+    uint16_t core0_display_permille; // Share of core 0 time refreshing the display
+    uint16_t core1_busy_permille;    // Share of core 1 time in poll iterations that did work
+    uint32_t ws_tx_high_water;       // Deepest ws_tx_queue level seen (bytes)
+    uint32_t ws_rx_high_water;       // Deepest ws_rx_queue level seen (bytes)
+    uint32_t http_bytes_per_sec;
+    uint32_t http_chunks_per_sec;
+    uint32_t disk_dirty_sectors;     // Written disk sectors not yet flushed to the SD card
+    uint32_t ws_rx_dropped;          // Console and monitor input bytes lost to a full ring since boot
+    uint32_t ws_tx_dropped;          // Output bytes WS_TX_OVERFLOW_DROP_OLDEST lost since boot
+    uint32_t ws_tx_skipped;          // Output bytes lagging WebSocket clients skipped since boot
+    uint32_t ws_tx_stall_us;         // Time core 0 waited for room in the TX rings since boot
+    uint32_t wifi_pm_mode;           // CYW43 power save mode (WIFI_POWER_MODE)
+    uint32_t wifi_pm_switches;       // Power save mode changes since boot
+    uint64_t instructions;
+    uint64_t t_states;
+    uint64_t http_bytes;
+    uint32_t http_chunks;
+    uint32_t ws_frame_sizes[METRICS_WS_SIZE_BUCKETS];      // Frames sent since boot by payload size
+    uint32_t ws_frame_latency[METRICS_WS_LATENCY_BUCKETS]; // Frames sent since boot by flush latency
+    uint32_t wifi_pm_ms[METRICS_WIFI_PM_MODES];            // Time in each power save mode up to the last change
+} metrics_snapshot_t;
+
+// Core 0: account one i8080_run batch
+void metrics_core0_cpu(uint32_t t_states, uint32_t elapsed_us);
+
+// Core 0: account one display refresh
+void metrics_core0_display(uint32_t elapsed_us);
+
+// Core 0: account one HTTP chunk handed to the guest
+void metrics_http_chunk(size_t len);
+
+// Core 0: current number of unflushed disk sectors in the write-back cache
+void metrics_disk_dirty(uint32_t sectors);
+
+// Core 0: roll the rate window when it has elapsed, cheap enough to call every loop
+void metrics_update(void);
+
+// Core 1: account one poll loop iteration
+void metrics_core1_iteration(uint32_t elapsed_us);
+
+// Track WebSocket queue depth high-water marks (TX from core 0, RX from core 1)
+void metrics_ws_tx_level(uint32_t level);
+void metrics_ws_rx_level(uint32_t level);
+
+// Bytes lost on the way to the guest (core 1) or to the clients (core 0 drop oldest, core 1
+// lagging clients), and time core 0 waited for the TX rings
+void metrics_ws_rx_dropped(uint32_t bytes);
+void metrics_ws_tx_dropped(uint32_t bytes);
+void metrics_ws_tx_skipped(uint32_t bytes);
+void metrics_ws_tx_stall(uint32_t elapsed_us);
+
+// Core 1: account one WebSocket console frame and how long its oldest byte waited
+void metrics_ws_frame(uint32_t bytes, uint32_t latency_us);
+
+// Core 1: account a change to power save mode mode after held_ms in the one before
+void metrics_wifi_pm(uint8_t mode, uint32_t held_ms);
+
+// Latest completed window plus running totals
+const metrics_snapshot_t* metrics_get(void);
+
+// Number of windows completed since boot
+uint32_t metrics_window(void);
+
+// Core 1: consistent copy of the latest window, returns metrics_window() of the copy
+uint32_t metrics_copy(metrics_snapshot_t* out);
+
+// Port 71: fill buffer with the selected metric for the port 200 reader, returns length
+size_t metrics_port_output(uint8_t metric, char* buffer, size_t buffer_length);
+
+#endif // METRICS_H
@@ -0,0 +1,118 @@
+#include "second_machine.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+// Core 1 is only free on boards without Wi-Fi
+#if defined(ALTAIR_SECOND_MACHINE) && !defined(CYW43_WL_GPIO_LED_PIN)
+
+#include <stdio.h>
+
+#include "Altair8800/intel8080.h"
+#include "Altair8800/memory.h"
+#include "ansi_keys.h"
+#include "hardware/uart.h"
+#include "pico/multicore.h"
+
+// Scratch X holds the core 1 stack as well
+#ifdef ALTAIR_SRAM_PLACEMENT
+static __scratch_x("second_machine") intel8080_t second_cpu;
+#else
+static intel8080_t second_cpu;
+#endif
+
+// Console (Core 1)
+static uint8_t second_term_in(void)
+{
+    if (!uart_is_readable(SECOND_MACHINE_UART))
+    {
+        return 0x00;
+    }
+
+    static ansi_keys_t uart_keys;
+    return ansi_keys_translate(&uart_keys, (uint8_t)(uart_getc(SECOND_MACHINE_UART) & 0x7F));
+}
+
+static void second_term_out(uint8_t c)
+{
+    uart_putc_raw(SECOND_MACHINE_UART, (char)(c & 0x7F));
+}
+
+static uint8_t second_sense(void)
+{
+    return 0x00;
+}
+
+// No drives: the controller status reads all bits high (nothing selected, not ready)
+static uint8_t no_disk_in(void)
+{
+    return 0xFF;
+}
+
+static void no_disk_out(uint8_t data)
+{
+    (void)data;
+}
+
+// Ports without a device read as an empty bus
+static uint8_t second_io_in(uint8_t port)
+{
+    (void)port;
+    return 0xFF;
+}
+
+static void second_io_out(uint8_t port, uint8_t data)
+{
+    (void)port;
+    (void)data;
+}
+
+static void second_machine_core1_entry(void)
+{
+    // Let core 0 park this core in RAM while it programs flash
+    multicore_lockout_victim_init();
+
+    static disk_controller_t no_disks = {.disk_select = no_disk_out,
+                                         .disk_status = no_disk_in,
+                                         .disk_function = no_disk_out,
+                                         .sector = no_disk_in,
+                                         .write = no_disk_out,
+                                         .read = no_disk_in};
+
+    memory_reset(&memory_second);
+    load8kRom(&memory_second, 0x0000);
+    i8080_reset(&second_cpu, &memory_second, second_term_in, second_term_out, second_sense, &no_disks, second_io_in,
+                second_io_out);
+    i8080_examine(&second_cpu, 0x0000);
+
+    while (true)
+    {
+        second_cpu.idle_polls = 0;
+        uint32_t t_states = i8080_run(&second_cpu, SECOND_MACHINE_BATCH_CYCLES);
+        if (second_cpu.halted ||
+            (second_cpu.idle_polls != 0 && second_cpu.idle_polls * SECOND_MACHINE_IDLE_GAP_CYCLES >= t_states))
+        {
+            best_effort_wfe_or_timeout(make_timeout_time_us(SECOND_MACHINE_IDLE_SLEEP_US));
+        }
+    }
+}
+
+bool second_machine_start(void)
+{
+    uart_init(SECOND_MACHINE_UART, SECOND_MACHINE_BAUD);
+    gpio_set_function(SECOND_MACHINE_TX_PIN, GPIO_FUNC_UART);
+    gpio_set_function(SECOND_MACHINE_RX_PIN, GPIO_FUNC_UART);
+
+    multicore_launch_core1(second_machine_core1_entry);
+    printf("Second machine: 8K BASIC on core 1, console on UART%u (GP%u/GP%u, %u baud)\n",
+           uart_get_index(SECOND_MACHINE_UART), SECOND_MACHINE_TX_PIN, SECOND_MACHINE_RX_PIN, SECOND_MACHINE_BAUD);
+    return true;
+}
+
+#else
+
+bool second_machine_start(void)
+{
+    return false;
+}
+
+#endif
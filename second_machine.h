@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+
+// A second Altair, only with ALTAIR_SECOND_MACHINE on boards without Wi-Fi, where core 1 is free.
+// It runs on core 1 in its own 64 KB (memory_second) with 8K BASIC loaded at 0 and its console on
+// a hardware UART at SECOND_MACHINE_BAUD. It has no disk drives, front panel or port drivers, and
+// its sense switches read 0; those all stay with the first machine on core 0.
+#ifndef SECOND_MACHINE_UART
+#define SECOND_MACHINE_UART uart0
+#endif
+#ifndef SECOND_MACHINE_TX_PIN
+#define SECOND_MACHINE_TX_PIN 0
+#endif
+#ifndef SECOND_MACHINE_RX_PIN
+#define SECOND_MACHINE_RX_PIN 1
+#endif
+#define SECOND_MACHINE_BAUD 115200
+
+// T-states per batch. A batch that polled an empty console at least once every
+// SECOND_MACHINE_IDLE_GAP_CYCLES is idle, and core 1 then waits for an event or
+// SECOND_MACHINE_IDLE_SLEEP_US before the next one.
+#define SECOND_MACHINE_BATCH_CYCLES 8000
+#define SECOND_MACHINE_IDLE_GAP_CYCLES 256
+#define SECOND_MACHINE_IDLE_SLEEP_US 1000
+
+/**
+ * Launch the second machine on core 1, false when it is not built in
+ * Called from Core 0 before any flash is written
+ */
+bool second_machine_start(void);
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Lock-free single-producer/single-consumer byte ring for the core 0 <-> core 1 console streams.
+// head, floor and tail count bytes since init and wrap at 2^32; only the producer writes head
+// and floor, only the consumer writes tail, so neither side takes a spin lock. Data moves with
+// memcpy in at most two pieces. size must be a power of two.
+//
+// floor is the oldest byte still valid. The producer raises it to drop bytes the consumer has
+// not read yet: spsc_ring_push_overwrite (drop oldest) and spsc_ring_clear_producer. floor is
+// raised before the bytes are overwritten, and the consumer checks it again after copying, so
+// a pop never returns a byte that was overwritten under it.
+typedef struct
+{
+    uint8_t* buffer;
+    uint32_t mask;
+    volatile uint32_t head;  // Producer: next byte to write
+    volatile uint32_t floor; // Producer: first byte that has not been dropped
+    volatile uint32_t tail;  // Consumer: next byte to read
+} spsc_ring_t;
+
+static inline void spsc_ring_init(spsc_ring_t* ring, uint8_t* buffer, uint32_t size)
+{
+    ring->buffer = buffer;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->floor = 0;
+    ring->tail = 0;
+}
+
+static inline uint32_t spsc_ring_size(const spsc_ring_t* ring)
+{
+    return ring->mask + 1;
+}
+
+// First byte the consumer may still read
+static inline uint32_t spsc_ring_oldest(const spsc_ring_t* ring)
+{
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t floor = __atomic_load_n(&ring->floor, __ATOMIC_ACQUIRE);
+    return (int32_t)(floor - tail) > 0 ? floor : tail;
+}
+
+// Bytes waiting, exact on either side up to what the other side is doing concurrently
+static inline uint32_t spsc_ring_level(const spsc_ring_t* ring)
+{
+    uint32_t oldest = spsc_ring_oldest(ring);
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - oldest;
+}
+
+static inline void spsc_ring_copy_in(spsc_ring_t* ring, uint32_t index, const uint8_t* data, uint32_t length)
+{
+    uint32_t offset = index & ring->mask;
+    uint32_t first = spsc_ring_size(ring) - offset;
+    if (first > length)
+    {
+        first = length;
+    }
+    memcpy(ring->buffer + offset, data, first);
+    memcpy(ring->buffer, data + first, length - first);
+}
+
+// Producer: append as much of data as fits, returns the number of bytes taken
+static inline size_t spsc_ring_push(spsc_ring_t* ring, const uint8_t* data, size_t length)
+{
+    uint32_t head = ring->head;
+    uint32_t space = spsc_ring_size(ring) - (head - spsc_ring_oldest(ring));
+    if (length > space)
+    {
+        length = space;
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    spsc_ring_copy_in(ring, head, data, (uint32_t)length);
+    __atomic_store_n(&ring->head, head + (uint32_t)length, __ATOMIC_RELEASE);
+    return length;
+}
+
+// Producer: append all of data, dropping the oldest unread bytes to make room. Returns the number
+// of bytes dropped, counting those of data that did not fit into the ring at all.
+static inline size_t spsc_ring_push_overwrite(spsc_ring_t* ring, const uint8_t* data, size_t length)
+{
+    uint32_t size = spsc_ring_size(ring);
+    size_t dropped = 0;
+    if (length > size)
+    {
+        dropped = length - size;
+        data += dropped;
+        length = size;
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    uint32_t head = ring->head;
+    uint32_t end = head + (uint32_t)length;
+    uint32_t oldest = spsc_ring_oldest(ring);
+    if (end - oldest > size)
+    {
+        // Announce the drop before the slots are reused
+        dropped += end - oldest - size;
+        __atomic_store_n(&ring->floor, end - size, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    spsc_ring_copy_in(ring, head, data, (uint32_t)length);
+    __atomic_store_n(&ring->head, end, __ATOMIC_RELEASE);
+    return dropped;
+}
+
+// Producer: drop everything not read yet
+static inline void spsc_ring_clear_producer(spsc_ring_t* ring)
+{
+    __atomic_store_n(&ring->floor, ring->head, __ATOMIC_RELEASE);
+}
+
+// Consumer: drop everything not read yet
+static inline void spsc_ring_clear_consumer(spsc_ring_t* ring)
+{
+    __atomic_store_n(&ring->tail, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+// Consumer: move up to max_length bytes into out, returns the number of bytes read
+static inline size_t spsc_ring_pop(spsc_ring_t* ring, uint8_t* out, size_t max_length)
+{
+    for (;;)
+    {
+        uint32_t tail = spsc_ring_oldest(ring);
+        uint32_t length = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+        if (length > max_length)
+        {
+            length = (uint32_t)max_length;
+        }
+        if (length == 0)
+        {
+            return 0;
+        }
+
+        uint32_t offset = tail & ring->mask;
+        uint32_t first = spsc_ring_size(ring) - offset;
+        if (first > length)
+        {
+            first = length;
+        }
+        memcpy(out, ring->buffer + offset, first);
+        memcpy(out + first, ring->buffer, length - first);
+
+        // Bytes the producer dropped while they were being copied are not returned
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        uint32_t floor = __atomic_load_n(&ring->floor, __ATOMIC_ACQUIRE);
+        if ((int32_t)(floor - tail) > 0)
+        {
+            uint32_t lost = floor - tail;
+            if (lost >= length)
+            {
+                continue; // All of it was overwritten, start again at floor
+            }
+            memmove(out, out + lost, length - lost);
+            length -= lost;
+            tail = floor;
+        }
+
+        __atomic_store_n(&ring->tail, tail + length, __ATOMIC_RELEASE);
+        return length;
+    }
+}
+
+// Consumer: point data at up to max_length unread bytes in place, returns how many are contiguous
+// and their position in index. Release them with spsc_ring_consume; until then they stay valid
+// unless the producer drops them (spsc_ring_push_overwrite, spsc_ring_clear_producer).
+static inline size_t spsc_ring_peek(spsc_ring_t* ring, uint32_t* index, const uint8_t** data, size_t max_length)
+{
+    uint32_t tail = spsc_ring_oldest(ring);
+    uint32_t length = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+    uint32_t offset = tail & ring->mask;
+    if (length > spsc_ring_size(ring) - offset)
+    {
+        length = spsc_ring_size(ring) - offset;
+    }
+    if (length > max_length)
+    {
+        length = (uint32_t)max_length;
+    }
+    *index = tail;
+    *data = ring->buffer + offset;
+    return length;
+}
+
+// Consumer: release the length bytes spsc_ring_peek returned at index
+static inline void spsc_ring_consume(spsc_ring_t* ring, uint32_t index, size_t length)
+{
+    __atomic_store_n(&ring->tail, index + (uint32_t)length, __ATOMIC_RELEASE);
+}
+
+// Consumer: whether there may be bytes to pop, without a spsc_ring_pop. Only false when the ring
+// is empty, true can still pop nothing if the producer dropped them all.
+static inline bool spsc_ring_readable(const spsc_ring_t* ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != ring->tail;
+}
+
+static inline bool spsc_ring_pop_byte(spsc_ring_t* ring, uint8_t* value)
+{
+    return spsc_ring_pop(ring, value, 1) == 1;
+}
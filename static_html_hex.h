@@ -5,698 +5,969 @@
 #include <stddef.h>
 
 static const unsigned char static_html_gz[] __attribute__((aligned(4))) = {
-  0x1f, 0x8b, 0x08, 0x08, 0x01, 0x27, 0x49, 0x69, 0x02, 0x03, 0x69, 0x6e,
-  0x64, 0x65, 0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0x00, 0xd5, 0x3d, 0xfd,
-  0x77, 0xdb, 0xb8, 0x91, 0xbf, 0xdf, 0x7b, 0xfd, 0x1f, 0x10, 0x6d, 0x5a,
-  0x49, 0x1b, 0x91, 0x92, 0xed, 0x78, 0xe3, 0x95, 0x2d, 0x6f, 0x1d, 0x5b,
-  0x4e, 0x7c, 0xf5, 0x47, 0x5e, 0xec, 0xb4, 0xdb, 0x6e, 0xd3, 0x84, 0x22,
-  0x21, 0x89, 0x35, 0x45, 0xea, 0x48, 0xca, 0xb2, 0x37, 0xf5, 0xff, 0x7e,
-  0x33, 0xf8, 0x20, 0x01, 0x12, 0xa4, 0xa4, 0xc4, 0x7b, 0xed, 0xe5, 0xed,
-  0x26, 0x36, 0x01, 0x0c, 0x06, 0x83, 0xc1, 0xcc, 0x60, 0x66, 0x00, 0x1c,
-  0x3c, 0x3b, 0xb9, 0x3a, 0xbe, 0xf9, 0xeb, 0xbb, 0x21, 0x99, 0xa6, 0xb3,
-  0xe0, 0xf0, 0x77, 0xff, 0x75, 0x20, 0xfe, 0xc5, 0x9f, 0xa8, 0xe3, 0xc1,
-  0x4f, 0x84, 0x1c, 0x24, 0x6e, 0xec, 0xcf, 0x53, 0x92, 0xc4, 0xee, 0xa0,
-  0x31, 0x4d, 0xd3, 0x79, 0xd2, 0xef, 0x76, 0x5d, 0x2f, 0xb4, 0xff, 0x99,
-  0x78, 0x34, 0xf0, 0xef, 0x62, 0x3b, 0xa4, 0x69, 0x37, 0x9c, 0xcf, 0xba,
-  0xf7, 0x29, 0x8d, 0x67, 0x7f, 0xdc, 0xb5, 0x77, 0xec, 0x5e, 0x37, 0xf0,
-  0x47, 0xfc, 0x77, 0x7b, 0xe6, 0x63, 0xd5, 0xc6, 0xe1, 0x41, 0x97, 0x03,
-  0xfa, 0x1a, 0xa0, 0x96, 0xe3, 0x79, 0x51, 0x68, 0x8d, 0xfd, 0xf4, 0x8f,
-  0x3d, 0x7b, 0x4f, 0x05, 0x9f, 0x97, 0x98, 0x3a, 0xe2, 0x5d, 0xa5, 0x0f,
-  0x01, 0x65, 0xbd, 0x12, 0xd2, 0xfd, 0x9e, 0x9c, 0x85, 0x81, 0x1f, 0x52,
-  0x8f, 0xcc, 0x22, 0x8f, 0xc6, 0xa1, 0xed, 0x26, 0x09, 0xf9, 0xbe, 0xcb,
-  0x4b, 0x71, 0xf4, 0x1d, 0xfe, 0xa3, 0x1f, 0xce, 0x17, 0xe9, 0x2f, 0xe9,
-  0xc3, 0x9c, 0x0e, 0x92, 0xc5, 0x68, 0xe6, 0xa7, 0x1f, 0x45, 0x81, 0xe7,
-  0xdf, 0xd9, 0x63, 0x3f, 0xf4, 0x88, 0xd3, 0x77, 0xdc, 0xd4, 0xbf, 0xa3,
-  0xe4, 0x0b, 0x2f, 0x20, 0x64, 0xe4, 0xb8, 0xb7, 0x93, 0x38, 0x5a, 0x84,
-  0x9e, 0xe5, 0x46, 0x41, 0x14, 0xf7, 0xc9, 0x77, 0x2f, 0x8f, 0x7e, 0xec,
-  0x0d, 0xb7, 0xf7, 0x65, 0x0d, 0xf9, 0x79, 0xcc, 0xfe, 0x88, 0xcf, 0x8f,
-  0x1c, 0x4f, 0x42, 0x9c, 0x27, 0x04, 0xd5, 0x9f, 0x46, 0x77, 0x34, 0xae,
-  0x05, 0xb8, 0xb3, 0xfb, 0xea, 0xe8, 0xf5, 0xc9, 0x9a, 0x00, 0xbf, 0xf3,
-  0x22, 0x37, 0xd9, 0x04, 0xbf, 0x51, 0x14, 0x03, 0x7d, 0xad, 0xa5, 0xef,
-  0xa5, 0xd3, 0x3e, 0x49, 0xa7, 0xbe, 0x7b, 0x5b, 0x28, 0xeb, 0x93, 0xe5,
-  0xd4, 0x4f, 0x69, 0xf6, 0x75, 0x1c, 0x85, 0xa9, 0x35, 0x76, 0x66, 0x7e,
-  0xf0, 0xd0, 0x27, 0xc7, 0xd1, 0x22, 0xf6, 0x61, 0x00, 0x97, 0x74, 0xa9,
-  0x57, 0x48, 0xfc, 0x5f, 0x69, 0x9f, 0x6c, 0xf7, 0xe6, 0xf7, 0xd9, 0xf7,
-  0x39, 0xf0, 0x80, 0x1f, 0x4e, 0xfa, 0x64, 0x6b, 0x7e, 0x8f, 0xff, 0x17,
-  0x71, 0x57, 0xe6, 0x72, 0xb4, 0x48, 0xd3, 0x28, 0xfc, 0x58, 0x37, 0x90,
-  0x51, 0xe0, 0x94, 0x50, 0xb5, 0x8c, 0xc4, 0xc9, 0x4a, 0x19, 0x87, 0xf5,
-  0x49, 0x12, 0x05, 0xbe, 0x57, 0x4d, 0x80, 0xb0, 0x9e, 0xd4, 0xf0, 0x79,
-  0x11, 0x27, 0xf8, 0x7d, 0x1e, 0xf9, 0x21, 0xf0, 0xf6, 0x13, 0x13, 0xe6,
-  0xa5, 0x52, 0x30, 0x73, 0xe2, 0x89, 0x1f, 0x42, 0xed, 0x5a, 0x62, 0xa5,
-  0xf4, 0x3e, 0xfd, 0x6a, 0x52, 0x8d, 0x82, 0x05, 0xfd, 0x8d, 0xe8, 0xf4,
-  0xd4, 0x8c, 0x42, 0x08, 0x8e, 0xd4, 0xf2, 0xa8, 0x1b, 0xc5, 0x4e, 0xea,
-  0x47, 0x40, 0x98, 0x30, 0x0a, 0x69, 0x91, 0x32, 0xa3, 0xc8, 0x7b, 0xf8,
-  0xe6, 0x15, 0xfa, 0x0d, 0xd8, 0xcb, 0x49, 0xeb, 0x95, 0xc7, 0xa3, 0xd5,
-  0xf3, 0xfc, 0x64, 0x1e, 0x38, 0x00, 0x7c, 0x1c, 0xd0, 0xfc, 0x2b, 0xfe,
-  0x62, 0x79, 0x7e, 0x4c, 0x5d, 0x3e, 0x42, 0xc0, 0x6e, 0x31, 0xcb, 0x49,
-  0xed, 0x04, 0xfe, 0x24, 0xb4, 0x60, 0x39, 0xce, 0x12, 0x28, 0xa3, 0x1a,
-  0xff, 0x81, 0x60, 0xb5, 0xa6, 0xd4, 0x9f, 0x4c, 0x53, 0xa0, 0x5c, 0xaf,
-  0x77, 0x37, 0x55, 0xe6, 0xee, 0x1e, 0x31, 0x65, 0x38, 0x88, 0x79, 0x84,
-  0x4f, 0x25, 0xd9, 0x81, 0x82, 0xda, 0x0f, 0x9d, 0x20, 0xa7, 0x9e, 0x98,
-  0x6d, 0x80, 0xf6, 0x7b, 0x65, 0x7c, 0xf7, 0x96, 0xe9, 0xbb, 0x94, 0x16,
-  0xc0, 0xac, 0x9c, 0x75, 0x0c, 0xcb, 0xb0, 0x06, 0x0d, 0x85, 0x4c, 0xbd,
-  0x32, 0x2d, 0x89, 0xb3, 0x48, 0xa3, 0xec, 0x33, 0xca, 0xcc, 0x71, 0x10,
-  0x2d, 0xfb, 0x64, 0xea, 0x7b, 0x1e, 0x0d, 0x8b, 0x23, 0x51, 0xd4, 0x07,
-  0x57, 0x6e, 0xa8, 0x3d, 0x98, 0xc2, 0x23, 0x69, 0x44, 0x68, 0x98, 0x2c,
-  0x62, 0x0a, 0x2c, 0x0c, 0xff, 0xcb, 0x11, 0xc7, 0x34, 0x04, 0x74, 0x12,
-  0x10, 0x75, 0x34, 0x64, 0x25, 0x73, 0x67, 0x42, 0x65, 0x77, 0xc4, 0x4f,
-  0x08, 0x9d, 0x8d, 0x28, 0x74, 0xe5, 0xc1, 0xc2, 0x03, 0x10, 0x63, 0x3f,
-  0x9e, 0x2d, 0x1d, 0x00, 0xb2, 0xf4, 0xd3, 0x69, 0xb4, 0x48, 0x09, 0xc5,
-  0x7e, 0x10, 0x90, 0x93, 0x24, 0x34, 0x4d, 0xec, 0x4c, 0x57, 0xd9, 0x0c,
-  0x81, 0x9c, 0xa2, 0x52, 0x78, 0x20, 0x2b, 0xe7, 0x23, 0x8f, 0x12, 0x9f,
-  0x4f, 0x77, 0x4c, 0x03, 0x07, 0xb5, 0x55, 0x56, 0xb4, 0x48, 0x70, 0x41,
-  0xd2, 0x00, 0xf8, 0x41, 0x63, 0x77, 0x42, 0xac, 0x59, 0x62, 0xd5, 0x94,
-  0x2e, 0xe9, 0xe8, 0xd6, 0x4f, 0x2b, 0x6b, 0x64, 0xb4, 0xe2, 0x08, 0xda,
-  0xe3, 0xc8, 0x5d, 0x24, 0x1d, 0xf5, 0x53, 0x9f, 0x7d, 0xca, 0x31, 0x87,
-  0x61, 0x22, 0x49, 0xeb, 0xa0, 0x88, 0x7f, 0x80, 0x0b, 0x83, 0x39, 0x52,
-  0xf3, 0x4b, 0x79, 0x80, 0xce, 0x08, 0x78, 0x63, 0xa1, 0xa8, 0x93, 0x34,
-  0x9a, 0xab, 0x33, 0xfe, 0xab, 0x05, 0x4a, 0x9b, 0xde, 0xf7, 0xc9, 0xee,
-  0x3a, 0x5d, 0x58, 0x48, 0x46, 0x98, 0x07, 0x45, 0x25, 0x1b, 0xb8, 0x48,
-  0x72, 0x66, 0xaf, 0x6e, 0x8d, 0x56, 0x63, 0x18, 0xcd, 0x1d, 0xd7, 0x4f,
-  0x1f, 0xd4, 0xda, 0x01, 0x1d, 0x03, 0x39, 0xad, 0x1f, 0xe1, 0x0f, 0x9d,
-  0x55, 0x0d, 0x45, 0x2c, 0x92, 0xfc, 0x83, 0x5c, 0x9c, 0x86, 0xd1, 0x5a,
-  0xbb, 0x79, 0x33, 0xd4, 0xb6, 0x56, 0x02, 0x9d, 0x32, 0x5a, 0x2f, 0x63,
-  0x67, 0xbe, 0x8a, 0xf1, 0x09, 0xf0, 0x0d, 0x97, 0x44, 0x75, 0x73, 0xe3,
-  0x46, 0x33, 0x39, 0x4a, 0xeb, 0xce, 0xa7, 0x4b, 0x93, 0x90, 0x04, 0x39,
-  0xd8, 0xeb, 0xf5, 0x4a, 0xb2, 0xf1, 0xf4, 0xf4, 0xb4, 0x2c, 0xb7, 0x34,
-  0x7e, 0xab, 0xa1, 0x5f, 0xdd, 0x80, 0x32, 0x02, 0x6c, 0xad, 0x8b, 0xb5,
-  0x5d, 0x34, 0xe7, 0x32, 0x7c, 0x46, 0x41, 0x94, 0xa9, 0xb9, 0x0a, 0xae,
-  0x41, 0x00, 0xf3, 0x28, 0x4e, 0x6b, 0xf5, 0x83, 0x4a, 0x00, 0x49, 0x70,
-  0x0b, 0xe0, 0x83, 0xb9, 0x1a, 0x05, 0x41, 0xc9, 0x0c, 0xf0, 0xe8, 0xd8,
-  0x59, 0x04, 0xe9, 0x3a, 0x94, 0x88, 0x8b, 0xf3, 0xcf, 0xf9, 0xa8, 0x57,
-  0xc5, 0x41, 0xa3, 0x08, 0xcc, 0xa0, 0x59, 0xfe, 0xa5, 0x62, 0x54, 0x80,
-  0x18, 0x05, 0xb1, 0xf5, 0x65, 0xa5, 0x38, 0xa9, 0x6f, 0xef, 0x3a, 0xe1,
-  0x9d, 0xb3, 0xde, 0xa2, 0xad, 0xc5, 0xbb, 0xba, 0x17, 0x20, 0x9f, 0xa5,
-  0xaf, 0xd6, 0x3b, 0x3f, 0xf1, 0x47, 0x7e, 0xc0, 0x96, 0x97, 0x59, 0x96,
-  0x8b, 0xd6, 0xee, 0xd4, 0x89, 0xad, 0x19, 0x75, 0x50, 0x74, 0x5b, 0x20,
-  0xce, 0x66, 0xa0, 0xfb, 0x0c, 0x3c, 0xe0, 0x33, 0xb1, 0x6f, 0xa9, 0xac,
-  0x50, 0xd3, 0xc9, 0x26, 0x82, 0xc9, 0xbc, 0xe4, 0x59, 0x6f, 0x72, 0x5d,
-  0x87, 0x51, 0x3c, 0x73, 0x82, 0x0a, 0x01, 0x4b, 0x43, 0x67, 0x14, 0x50,
-  0x6b, 0x16, 0x81, 0x44, 0xb6, 0xe8, 0x1d, 0xa0, 0x9f, 0x94, 0xb5, 0x82,
-  0xce, 0x4b, 0x45, 0x10, 0x82, 0x12, 0xac, 0xae, 0x25, 0xac, 0xcf, 0x8e,
-  0x89, 0xd4, 0x7a, 0x95, 0x72, 0x37, 0xba, 0xe5, 0x5a, 0xec, 0x86, 0x9b,
-  0x1c, 0x42, 0x69, 0xd8, 0x05, 0x2d, 0x20, 0x41, 0xc0, 0x64, 0x26, 0xc9,
-  0xd4, 0xf1, 0xe3, 0xfa, 0x49, 0x77, 0x5c, 0x97, 0x26, 0x19, 0xf5, 0xc3,
-  0x28, 0x6d, 0xd9, 0x1e, 0x1d, 0x2d, 0x26, 0x6d, 0x23, 0xde, 0x33, 0xa8,
-  0x0b, 0x7a, 0xf7, 0xdb, 0x59, 0xb0, 0xbc, 0x74, 0x0c, 0x8b, 0x2f, 0x97,
-  0x3d, 0x25, 0x81, 0x97, 0xc6, 0x4e, 0x08, 0x02, 0x0b, 0xac, 0x02, 0x75,
-  0x5d, 0x33, 0xa2, 0x89, 0xb9, 0x5b, 0x47, 0x0d, 0x6a, 0x83, 0xb7, 0x52,
-  0x58, 0x64, 0x2a, 0x05, 0xc8, 0xf7, 0xfd, 0x3e, 0xa7, 0x31, 0x0c, 0x50,
-  0x21, 0x70, 0x15, 0x06, 0x6b, 0x77, 0x92, 0xc3, 0xd2, 0x94, 0xbf, 0x66,
-  0x71, 0x68, 0x32, 0x79, 0x1e, 0x57, 0x0e, 0x04, 0xf6, 0xf8, 0xd4, 0x8a,
-  0xe9, 0x44, 0x43, 0x71, 0xe5, 0xac, 0xb0, 0x55, 0xa2, 0x98, 0xba, 0xd2,
-  0x5c, 0x54, 0x3e, 0x65, 0x86, 0xaa, 0xf2, 0x6d, 0x95, 0x59, 0x27, 0x46,
-  0xec, 0xf9, 0x8a, 0x3d, 0x95, 0x29, 0xe7, 0x2d, 0xf2, 0xcc, 0x9f, 0xa1,
-  0x6c, 0x77, 0xaa, 0x28, 0x66, 0x2d, 0xd0, 0xc6, 0x63, 0x2b, 0x76, 0x2b,
-  0x07, 0x50, 0xda, 0x53, 0x64, 0xb5, 0x56, 0x42, 0xd9, 0xae, 0x81, 0xe2,
-  0x45, 0x0b, 0x58, 0xee, 0x1b, 0x00, 0xdb, 0xa9, 0x01, 0xb6, 0x74, 0xee,
-  0x1e, 0x36, 0x00, 0xf5, 0xb2, 0x16, 0xaf, 0x34, 0x05, 0x2b, 0x76, 0x7d,
-  0x60, 0xbb, 0x75, 0xc0, 0x9c, 0x64, 0xba, 0x06, 0x30, 0x9c, 0x57, 0x2c,
-  0xae, 0x81, 0x24, 0xab, 0xac, 0x80, 0xb0, 0xd1, 0x44, 0x66, 0xdd, 0xae,
-  0x8b, 0xdf, 0x46, 0x13, 0x9c, 0x41, 0x5f, 0x73, 0xa6, 0x2b, 0x3b, 0xd9,
-  0x59, 0xa7, 0x93, 0xb5, 0x38, 0xa0, 0xb2, 0x8b, 0x97, 0xeb, 0x8d, 0x63,
-  0x2d, 0xce, 0xa8, 0xec, 0x64, 0x77, 0xad, 0x4e, 0xd6, 0xe3, 0x98, 0x24,
-  0x8d, 0xfd, 0x5b, 0x9a, 0x4e, 0xc1, 0x30, 0x9b, 0x4c, 0x6b, 0xe0, 0xb2,
-  0x8e, 0x45, 0xb5, 0x2a, 0x50, 0xdc, 0xb8, 0x91, 0xb2, 0x23, 0x6b, 0x0c,
-  0xe6, 0x5e, 0x98, 0x3a, 0xd0, 0x3e, 0x2e, 0x97, 0xe5, 0x3d, 0x66, 0x3a,
-  0xe2, 0x87, 0xd5, 0x26, 0xc3, 0x53, 0xf4, 0x5c, 0xae, 0x0c, 0x7a, 0xcd,
-  0x02, 0xd3, 0x46, 0x55, 0xe3, 0x19, 0x52, 0xaf, 0xaa, 0x24, 0x64, 0xde,
-  0x1c, 0x29, 0x8f, 0x56, 0xaf, 0x15, 0x2f, 0x02, 0x23, 0x8c, 0xbd, 0xaf,
-  0xb0, 0x85, 0x4a, 0xaa, 0x74, 0x7d, 0xdd, 0x58, 0x18, 0x9a, 0x01, 0xa1,
-  0xed, 0xfd, 0x75, 0xec, 0x58, 0x42, 0x0e, 0xba, 0xd2, 0x63, 0xcc, 0x7e,
-  0x03, 0x56, 0xb8, 0xc5, 0x7a, 0x83, 0x86, 0x0f, 0xf4, 0x6d, 0x08, 0x4f,
-  0x71, 0x4c, 0xc7, 0x83, 0x86, 0xe7, 0xa4, 0x4e, 0xdf, 0x9f, 0x81, 0x65,
-  0xd1, 0x4d, 0xee, 0x26, 0x2f, 0xee, 0x67, 0x41, 0xe7, 0x00, 0x7e, 0x20,
-  0xf0, 0x43, 0x98, 0x0c, 0x9a, 0xe8, 0xd7, 0xee, 0x77, 0xbb, 0xcb, 0xe5,
-  0xd2, 0x5e, 0xee, 0xd8, 0x51, 0x3c, 0xe9, 0x6e, 0xc3, 0x16, 0x00, 0xab,
-  0x36, 0x09, 0x92, 0xee, 0x75, 0x74, 0x3f, 0x68, 0xf6, 0x48, 0x0f, 0xdd,
-  0x1d, 0xf8, 0x7f, 0xf3, 0xf0, 0x00, 0xdd, 0x33, 0x5c, 0xab, 0x0d, 0x9a,
-  0xf8, 0x45, 0xa8, 0x33, 0xf1, 0xcb, 0xd8, 0x0f, 0x82, 0x41, 0xf3, 0xf7,
-  0xdb, 0x3b, 0xbd, 0xde, 0xd6, 0x78, 0x67, 0xdc, 0xec, 0x8a, 0x06, 0x00,
-  0x66, 0x6b, 0xb7, 0x49, 0x1e, 0x06, 0xcd, 0x6d, 0xa8, 0x25, 0x9a, 0xbf,
-  0x52, 0x5a, 0xef, 0xc2, 0xcf, 0x31, 0xd4, 0xda, 0x51, 0x60, 0xd0, 0xdd,
-  0xd1, 0x1e, 0x02, 0x85, 0x25, 0x11, 0xdd, 0x52, 0x01, 0x36, 0xfb, 0xdd,
-  0x12, 0x50, 0xb6, 0xd5, 0x4e, 0x10, 0x3a, 0x76, 0xb2, 0x9b, 0x75, 0xf2,
-  0x83, 0xd2, 0xc9, 0x8e, 0x8e, 0x61, 0x0f, 0x5b, 0xba, 0x7e, 0xec, 0x82,
-  0x0c, 0x73, 0xef, 0x79, 0xb1, 0x0b, 0xad, 0x7f, 0x00, 0x24, 0x62, 0x1d,
-  0x95, 0x72, 0xe5, 0x97, 0xbb, 0x1b, 0x54, 0xde, 0xdd, 0xa4, 0xf2, 0xab,
-  0x95, 0x68, 0xa0, 0x30, 0xc0, 0xd1, 0xee, 0xf2, 0xd1, 0xbe, 0xc4, 0x2a,
-  0xb9, 0xcf, 0x6e, 0xd0, 0x9c, 0x45, 0x61, 0xc4, 0x0c, 0x9c, 0x66, 0xee,
-  0xaa, 0x83, 0x09, 0xd8, 0x36, 0xd0, 0x96, 0xc9, 0x15, 0x27, 0x74, 0xa7,
-  0x11, 0x74, 0x35, 0x03, 0xdb, 0x23, 0xa0, 0xcd, 0xc3, 0x3d, 0x28, 0x3a,
-  0xe8, 0x62, 0x11, 0x86, 0x2a, 0xee, 0x26, 0x87, 0x82, 0xa7, 0x98, 0xcf,
-  0xb5, 0xa1, 0xb1, 0x53, 0x43, 0x0d, 0x96, 0x88, 0x10, 0x46, 0x03, 0x8c,
-  0x2f, 0x9c, 0x24, 0xdf, 0x4d, 0x1b, 0xfb, 0xb9, 0x63, 0xea, 0x7b, 0xc1,
-  0xdc, 0xdf, 0x93, 0xa3, 0x00, 0x84, 0x40, 0x4c, 0x6e, 0xa4, 0x0b, 0xea,
-  0x2f, 0x74, 0x44, 0x8e, 0x03, 0x1f, 0x16, 0x50, 0x56, 0xe5, 0x6c, 0x36,
-  0x8f, 0x61, 0x01, 0x7b, 0x04, 0x16, 0x71, 0x82, 0x72, 0x09, 0xdd, 0x4d,
-  0x64, 0x44, 0x53, 0xb4, 0xea, 0x69, 0x1c, 0x47, 0x31, 0x99, 0x3a, 0xa1,
-  0x07, 0xac, 0x3f, 0xe9, 0x80, 0xe1, 0xe8, 0x51, 0x02, 0xdc, 0xeb, 0x84,
-  0xfe, 0xaf, 0x6c, 0x7d, 0x75, 0x08, 0x94, 0x91, 0x38, 0x1a, 0x2d, 0x92,
-  0x34, 0x04, 0x1b, 0x51, 0x82, 0x15, 0x9e, 0x29, 0x58, 0x25, 0x49, 0x2a,
-  0xb0, 0xc8, 0x90, 0x18, 0x90, 0xd6, 0x78, 0x11, 0x72, 0x93, 0xb4, 0xd5,
-  0xce, 0x57, 0x67, 0xb7, 0x4b, 0xde, 0xc5, 0xfe, 0x9d, 0x93, 0xe2, 0x98,
-  0xf0, 0x6f, 0x8b, 0xd0, 0xd0, 0x75, 0xe6, 0xc9, 0x02, 0x16, 0x26, 0x20,
-  0x98, 0x46, 0xc4, 0xb9, 0x8b, 0x7c, 0x8f, 0x4c, 0x82, 0x68, 0x04, 0x70,
-  0xe6, 0xb0, 0xd5, 0x5b, 0x20, 0x94, 0xdc, 0xac, 0xc5, 0xde, 0x78, 0xdb,
-  0x41, 0x0e, 0x17, 0x6c, 0x43, 0x14, 0x17, 0x8b, 0x40, 0x06, 0x74, 0x44,
-  0xdd, 0x10, 0x58, 0x99, 0x7a, 0x7d, 0x32, 0x76, 0x82, 0x84, 0x2a, 0x45,
-  0x51, 0x28, 0x7c, 0x50, 0xce, 0x9d, 0x3f, 0x71, 0xd2, 0x28, 0xb6, 0xa3,
-  0xf0, 0x1c, 0xbe, 0x28, 0x55, 0x98, 0xef, 0xaa, 0x08, 0x12, 0x96, 0x06,
-  0x07, 0x7a, 0x04, 0xb4, 0x9b, 0xcd, 0x51, 0x46, 0xf5, 0x94, 0xe2, 0x99,
-  0x73, 0xff, 0xbe, 0x5c, 0x63, 0xd7, 0x04, 0xe0, 0x84, 0xb2, 0x8d, 0x26,
-  0x8a, 0x08, 0xa5, 0x78, 0xee, 0x24, 0x29, 0x7d, 0x8b, 0x73, 0x81, 0x8e,
-  0xa6, 0x42, 0xe7, 0xb7, 0xf4, 0xa1, 0xaa, 0x08, 0xd8, 0xdd, 0x09, 0x17,
-  0xf3, 0x33, 0x94, 0x9e, 0x77, 0x4e, 0x50, 0x8d, 0xf7, 0x8d, 0x3f, 0x33,
-  0x34, 0x47, 0x03, 0xff, 0x2c, 0x04, 0x21, 0x89, 0x93, 0x70, 0xe2, 0x27,
-  0xa2, 0x72, 0x99, 0x6e, 0x2c, 0x5c, 0xf0, 0x7a, 0x31, 0x1e, 0x23, 0x90,
-  0x5f, 0x3e, 0x16, 0x4b, 0xcc, 0xd0, 0x61, 0x86, 0x23, 0xe6, 0x38, 0x0b,
-  0xe9, 0x12, 0xf8, 0xf4, 0x3e, 0x1d, 0xf2, 0x0f, 0xad, 0xb6, 0xac, 0xf3,
-  0x98, 0x71, 0xb6, 0x9c, 0x61, 0x14, 0xef, 0x50, 0x05, 0xe6, 0x58, 0x36,
-  0x3a, 0xe1, 0x5f, 0x5a, 0x8d, 0x45, 0x3a, 0xb6, 0xf6, 0x1a, 0x1d, 0xf2,
-  0x05, 0xb0, 0x4b, 0x71, 0xac, 0x0c, 0x49, 0xf2, 0xd8, 0x56, 0x80, 0x00,
-  0x9f, 0x1d, 0x47, 0xe1, 0xd8, 0x9f, 0x2c, 0x84, 0x26, 0x66, 0x50, 0xc1,
-  0xa4, 0x4f, 0xf4, 0x6e, 0x8e, 0xaf, 0x2e, 0x4f, 0xcf, 0xde, 0xe8, 0x9c,
-  0xf4, 0xf3, 0xcd, 0xf0, 0xfd, 0xc5, 0xa7, 0xd3, 0xab, 0xcb, 0x9b, 0x3e,
-  0x69, 0x0a, 0x8f, 0x7d, 0xb3, 0x63, 0x2a, 0xff, 0x74, 0x7d, 0xf6, 0xb7,
-  0x21, 0x6c, 0x19, 0xf6, 0x4a, 0xa5, 0xef, 0xaf, 0xfe, 0x72, 0xdd, 0x27,
-  0x3b, 0xbd, 0x52, 0xc1, 0xf1, 0xd5, 0xf9, 0x35, 0x73, 0x78, 0x2b, 0x25,
-  0x17, 0x47, 0x3f, 0x7f, 0x7a, 0x77, 0x74, 0x7d, 0x33, 0xfc, 0x74, 0x3e,
-  0xbc, 0x7c, 0x73, 0xf3, 0x16, 0xb8, 0x62, 0xf7, 0x07, 0xa5, 0xfc, 0xfa,
-  0xe6, 0xea, 0xfd, 0xd1, 0x9b, 0xe1, 0xa7, 0x9b, 0xb7, 0xc3, 0x8b, 0xe1,
-  0xa7, 0x3f, 0x0d, 0xff, 0x0a, 0x78, 0x39, 0x6c, 0xbd, 0x7d, 0x4a, 0xa7,
-  0x74, 0x46, 0x55, 0xe4, 0x4e, 0x86, 0xa7, 0x47, 0x1f, 0xce, 0x6f, 0x78,
-  0x5d, 0xa8, 0xe7, 0x39, 0xf1, 0x6d, 0xb3, 0xd0, 0xd7, 0xf5, 0xf1, 0xfb,
-  0xab, 0xf3, 0xf3, 0xd7, 0x47, 0xc7, 0x7f, 0xfa, 0x74, 0x7e, 0x76, 0x39,
-  0xe4, 0xf8, 0xa8, 0x08, 0xbd, 0xfe, 0x70, 0x7a, 0x3a, 0x7c, 0xff, 0xe9,
-  0xf8, 0x7c, 0x78, 0x74, 0xf9, 0xe1, 0xdd, 0xa7, 0xb3, 0x4b, 0x40, 0xfd,
-  0xcf, 0x47, 0xe7, 0x38, 0x20, 0xfc, 0xd3, 0x41, 0xf2, 0xee, 0x62, 0x9c,
-  0x00, 0x74, 0x7b, 0x92, 0x37, 0x7b, 0x3f, 0x04, 0x72, 0x5e, 0x0e, 0x8f,
-  0x6f, 0x3e, 0x9d, 0x0c, 0xcf, 0x8f, 0xfe, 0xca, 0x99, 0xdb, 0x34, 0xc5,
-  0xd0, 0xfc, 0xe4, 0xea, 0x82, 0x48, 0xf7, 0x8b, 0xeb, 0xb8, 0x53, 0xaa,
-  0xcf, 0x8b, 0x28, 0x4a, 0xf4, 0x99, 0x91, 0x6e, 0xf6, 0x12, 0x87, 0x4d,
-  0xa3, 0x24, 0xbd, 0x74, 0x66, 0xb4, 0x54, 0x90, 0x46, 0x93, 0x49, 0x40,
-  0x6f, 0x90, 0x4a, 0xd5, 0x6b, 0xe2, 0x75, 0x1a, 0x96, 0x0a, 0x13, 0x1a,
-  0x7a, 0xc3, 0xc4, 0xad, 0x2a, 0x3a, 0x4e, 0xe3, 0xe0, 0xd8, 0x54, 0x08,
-  0xda, 0xc2, 0x07, 0x71, 0x92, 0x15, 0x99, 0x86, 0x9f, 0x49, 0x46, 0x84,
-  0x74, 0x13, 0x5d, 0xc3, 0x92, 0x05, 0xbe, 0x46, 0xeb, 0xa2, 0xad, 0x8e,
-  0xd6, 0x1f, 0x93, 0xd6, 0x33, 0x26, 0xe9, 0xec, 0x4c, 0x92, 0x91, 0x7f,
-  0xfd, 0x8b, 0x88, 0x6f, 0x5c, 0x84, 0x29, 0x1f, 0x96, 0x09, 0xfe, 0x22,
-  0x7f, 0xb6, 0x63, 0xea, 0x78, 0x0f, 0xd7, 0x4c, 0x50, 0x3e, 0x1b, 0x0c,
-  0x50, 0x2d, 0x5c, 0x47, 0x2e, 0x18, 0xc3, 0xf6, 0xd5, 0xbb, 0xe1, 0xa5,
-  0xd6, 0x11, 0x92, 0x22, 0x5d, 0xc4, 0xb9, 0x37, 0x4b, 0xb1, 0xb6, 0x18,
-  0x11, 0xe3, 0x07, 0xbd, 0x3a, 0x5f, 0x5d, 0x80, 0x74, 0xca, 0x34, 0x53,
-  0x38, 0x41, 0xb9, 0xfd, 0x01, 0x4c, 0xb7, 0xbd, 0xa3, 0x38, 0x76, 0x1e,
-  0x10, 0x73, 0x40, 0x17, 0x9d, 0x30, 0xd0, 0x72, 0x0c, 0xda, 0x65, 0x04,
-  0xb3, 0x06, 0x3f, 0x32, 0x67, 0xc4, 0xcc, 0x4f, 0x12, 0x45, 0xa0, 0xe7,
-  0x73, 0x3e, 0x77, 0x1e, 0x82, 0xc8, 0xf1, 0x60, 0xca, 0x51, 0x35, 0x46,
-  0x63, 0x82, 0x14, 0x21, 0x03, 0xc0, 0xbd, 0xc1, 0x7b, 0x69, 0x90, 0x9f,
-  0xc4, 0xf0, 0x84, 0x44, 0x11, 0xff, 0x0a, 0xd2, 0xf5, 0x59, 0x83, 0x7d,
-  0x15, 0x73, 0x4e, 0x44, 0x01, 0xd8, 0x1e, 0x3d, 0xa4, 0xf4, 0x9c, 0x86,
-  0x13, 0xd0, 0x7d, 0x08, 0xb5, 0xd7, 0xce, 0xc7, 0xad, 0x36, 0xc9, 0x28,
-  0x88, 0xd3, 0x23, 0x1b, 0xb7, 0x55, 0xe2, 0x00, 0xc7, 0xa6, 0xee, 0x94,
-  0xb4, 0x98, 0xea, 0x2c, 0x90, 0x12, 0xc7, 0x12, 0x05, 0x80, 0x22, 0x96,
-  0xb5, 0x1a, 0xa7, 0x8e, 0x1f, 0x70, 0xbd, 0x86, 0xd0, 0x18, 0x86, 0x7d,
-  0x90, 0x5d, 0xbc, 0xe5, 0xbe, 0xd6, 0xed, 0x34, 0x5a, 0x0e, 0x2b, 0x1b,
-  0xf1, 0x5f, 0x90, 0x51, 0x1a, 0x6d, 0x7d, 0x9e, 0x4a, 0x13, 0x96, 0x1b,
-  0x07, 0xa8, 0xfb, 0xb9, 0xb0, 0x66, 0x01, 0x27, 0x10, 0xd0, 0x08, 0x66,
-  0xc4, 0x90, 0x8f, 0x9d, 0x39, 0xa8, 0x59, 0x50, 0x29, 0xdc, 0x00, 0x4c,
-  0xba, 0xa8, 0x7a, 0x12, 0x1e, 0x96, 0x4a, 0x80, 0xd8, 0x01, 0xc6, 0xae,
-  0x90, 0x5f, 0xf2, 0x05, 0x2e, 0x35, 0xbe, 0xc2, 0xc1, 0xff, 0xb3, 0xa0,
-  0x0b, 0x7a, 0x86, 0x90, 0x2b, 0xf8, 0x97, 0x7f, 0x35, 0xd0, 0x19, 0x78,
-  0xe8, 0xc8, 0x63, 0x63, 0x1c, 0x31, 0x0c, 0xf5, 0x76, 0x55, 0x1c, 0x50,
-  0x20, 0x36, 0xf2, 0x56, 0x2b, 0xa0, 0x29, 0xf1, 0x81, 0x6b, 0x7a, 0xfb,
-  0xf0, 0xcf, 0x01, 0x6b, 0x63, 0x07, 0x6c, 0x9a, 0xe1, 0xc3, 0x8b, 0x17,
-  0x85, 0x26, 0x72, 0x7e, 0x15, 0x4d, 0x66, 0xcf, 0x17, 0xc9, 0x94, 0xe1,
-  0x6f, 0xa3, 0x7b, 0xf8, 0x18, 0x58, 0xea, 0x28, 0x6d, 0xf9, 0x6d, 0x7d,
-  0x7e, 0x1e, 0x55, 0x06, 0xa0, 0xa8, 0x71, 0x10, 0x51, 0x86, 0xa1, 0xcf,
-  0x74, 0x8b, 0x8b, 0x18, 0xe7, 0xab, 0xa0, 0xd0, 0x2f, 0x03, 0x0f, 0xf8,
-  0x0e, 0x41, 0xd8, 0xb5, 0x46, 0x64, 0x70, 0x58, 0x85, 0xc7, 0xa8, 0xdd,
-  0xae, 0x5a, 0x88, 0x40, 0xb3, 0x6b, 0x10, 0x95, 0x1e, 0x6c, 0xc1, 0xc8,
-  0x38, 0x80, 0xca, 0x6c, 0xa5, 0x45, 0x29, 0x71, 0x02, 0xb6, 0xda, 0xc9,
-  0x1c, 0xd8, 0x05, 0xc8, 0x64, 0x94, 0x21, 0xb9, 0x82, 0x2e, 0x60, 0x56,
-  0x2c, 0x06, 0x52, 0x26, 0x94, 0xfd, 0x18, 0xc1, 0xb4, 0xb2, 0x7e, 0xd8,
-  0x0c, 0x77, 0x40, 0x4d, 0xb4, 0xf7, 0x11, 0x89, 0xad, 0xde, 0x2c, 0xe1,
-  0x6c, 0x84, 0x6b, 0x7f, 0x09, 0x1b, 0xae, 0x68, 0x59, 0xcf, 0x93, 0x19,
-  0xc3, 0xe4, 0xe0, 0x5a, 0x1a, 0x1a, 0x06, 0x24, 0x50, 0x7c, 0xee, 0xeb,
-  0x43, 0x29, 0x93, 0x2c, 0x58, 0xb5, 0x9e, 0x85, 0x39, 0xc1, 0x18, 0x89,
-  0xd9, 0x12, 0xf9, 0x0c, 0x95, 0xc1, 0xa9, 0x94, 0x2f, 0x15, 0x42, 0xfb,
-  0x5f, 0x3e, 0xee, 0xeb, 0x7a, 0x40, 0x97, 0xde, 0xfb, 0x75, 0x23, 0x5f,
-  0xc6, 0x7e, 0x4a, 0x6f, 0x22, 0x69, 0x22, 0xb7, 0x70, 0x47, 0x50, 0x5e,
-  0x2f, 0x6c, 0x37, 0x92, 0xcb, 0x74, 0xd4, 0x78, 0xdf, 0x26, 0xab, 0x73,
-  0x38, 0x36, 0xc3, 0x80, 0xf7, 0xfb, 0x95, 0xd2, 0x8c, 0xc9, 0x27, 0x36,
-  0x12, 0x9c, 0x78, 0x29, 0xb0, 0x61, 0x0d, 0x67, 0x9a, 0xd9, 0x24, 0xdb,
-  0x56, 0x0b, 0x29, 0x6e, 0x7b, 0x06, 0xb0, 0xb3, 0xd2, 0x0c, 0x03, 0xd8,
-  0x75, 0x83, 0xe8, 0x82, 0x85, 0x95, 0xf0, 0x1d, 0x0b, 0xdf, 0xaa, 0xc0,
-  0x0a, 0x70, 0x6f, 0x55, 0x2e, 0x37, 0xc8, 0x25, 0x3f, 0x03, 0x38, 0x14,
-  0x96, 0x84, 0xce, 0x6e, 0x25, 0x32, 0x49, 0x83, 0xc3, 0x4e, 0xf3, 0x2d,
-  0x8c, 0x17, 0xb9, 0x0b, 0xfc, 0x68, 0x4f, 0x68, 0x2a, 0xc0, 0xbc, 0x7e,
-  0x38, 0xf3, 0x5a, 0x0d, 0x59, 0xa7, 0xa1, 0x4b, 0x88, 0x0c, 0x86, 0x34,
-  0x47, 0xea, 0x60, 0x60, 0x9d, 0x4f, 0x21, 0x54, 0xaa, 0x02, 0xa2, 0x98,
-  0x2e, 0xb5, 0xb8, 0xe4, 0xd5, 0xaa, 0x20, 0xa9, 0x86, 0x4e, 0x1d, 0x28,
-  0xb5, 0x5e, 0x15, 0xac, 0xdc, 0x2e, 0xaa, 0x83, 0x94, 0xd7, 0xaa, 0x83,
-  0x23, 0x8d, 0xa8, 0x55, 0x90, 0x64, 0xbd, 0x2a, 0x58, 0xb9, 0xcd, 0x55,
-  0x07, 0x29, 0xaf, 0xd5, 0x68, 0x17, 0x34, 0x3e, 0x88, 0xb4, 0x3f, 0x03,
-  0xb3, 0x78, 0x68, 0x2b, 0xb9, 0xc8, 0xdc, 0x2e, 0xcc, 0x7f, 0x66, 0x82,
-  0xd2, 0x7b, 0x3f, 0x49, 0x8b, 0x36, 0xc5, 0xb3, 0x12, 0xc3, 0x94, 0xf4,
-  0x0c, 0xfa, 0x13, 0x97, 0x4c, 0xe4, 0x08, 0xb5, 0x9e, 0xed, 0x8e, 0x73,
-  0xc7, 0x9d, 0xe4, 0x74, 0x14, 0xe2, 0x63, 0x8c, 0x1e, 0x37, 0x6a, 0x94,
-  0xce, 0xd7, 0x58, 0x1d, 0xbe, 0x71, 0x65, 0x25, 0x9b, 0xd8, 0x20, 0x0a,
-  0x88, 0x6c, 0x71, 0x30, 0x37, 0xdd, 0xd8, 0x71, 0x8b, 0x3c, 0xc7, 0x85,
-  0x13, 0xdf, 0x91, 0x99, 0x24, 0x40, 0x56, 0x23, 0x8d, 0x95, 0x7c, 0xb1,
-  0x47, 0x6d, 0x6b, 0x80, 0x66, 0x41, 0x36, 0xed, 0x84, 0xa7, 0xf0, 0xc1,
-  0x06, 0xd7, 0x77, 0x6f, 0xb9, 0x97, 0x22, 0xb7, 0x15, 0x14, 0x43, 0x3a,
-  0x5d, 0xcc, 0xaf, 0x33, 0x56, 0x61, 0x4d, 0x5a, 0x65, 0xe1, 0x6a, 0xe4,
-  0xbe, 0x76, 0x59, 0xa2, 0x1a, 0xeb, 0x81, 0xc1, 0xcd, 0x91, 0x18, 0x10,
-  0xa3, 0x6b, 0x43, 0xd7, 0x51, 0xb9, 0xc5, 0xfe, 0x87, 0x3f, 0x64, 0x16,
-  0xa5, 0xfa, 0xb3, 0x6a, 0x9f, 0x0f, 0x56, 0xd9, 0xe7, 0x62, 0xd3, 0x01,
-  0x6c, 0x13, 0x47, 0xc1, 0x31, 0xd8, 0x28, 0x0e, 0x80, 0x8e, 0x5b, 0x3b,
-  0x5c, 0x1d, 0x23, 0x86, 0x2f, 0x8e, 0x2b, 0xd8, 0x46, 0x45, 0xca, 0xa0,
-  0x4d, 0x34, 0x05, 0xc1, 0x62, 0xb4, 0xad, 0x6a, 0x0e, 0x5c, 0x31, 0x61,
-  0xb0, 0xe2, 0x37, 0x9c, 0x2e, 0x94, 0x11, 0x6b, 0x4d, 0x16, 0x17, 0x26,
-  0xab, 0xa6, 0x8a, 0xd7, 0xfa, 0x0f, 0x9c, 0xa8, 0xed, 0x57, 0x7c, 0xa6,
-  0x86, 0xd7, 0xc7, 0x68, 0x72, 0xff, 0x7b, 0xa7, 0x4a, 0x08, 0xc2, 0x0d,
-  0xa6, 0xea, 0x42, 0x88, 0xce, 0x95, 0x53, 0x95, 0xcb, 0xd8, 0xba, 0xa9,
-  0xca, 0x6b, 0xfd, 0x27, 0x4e, 0xd5, 0x9e, 0xb2, 0xa8, 0x2e, 0x48, 0xeb,
-  0xe8, 0xfa, 0xf8, 0xec, 0x8c, 0x6c, 0xef, 0x31, 0x2b, 0x87, 0xe9, 0x5a,
-  0x72, 0xfc, 0xee, 0x83, 0x24, 0x62, 0xfb, 0xdf, 0x35, 0x95, 0x9a, 0xf9,
-  0x74, 0xed, 0x8c, 0xa9, 0x30, 0x8e, 0x44, 0x06, 0x4b, 0x96, 0x50, 0xb8,
-  0xc0, 0xbd, 0x1c, 0xec, 0x0f, 0x60, 0xaf, 0x9e, 0xbb, 0xdb, 0x4c, 0x16,
-  0x53, 0x2e, 0xfa, 0x45, 0xf6, 0x84, 0x86, 0x72, 0x41, 0xbf, 0x14, 0x7d,
-  0xce, 0xac, 0x21, 0xea, 0x14, 0xd9, 0xb6, 0x60, 0xb7, 0x97, 0x2c, 0xa3,
-  0x76, 0x85, 0xf5, 0x25, 0xcb, 0x6d, 0xb4, 0x52, 0x71, 0x6e, 0x50, 0x39,
-  0x0e, 0xc8, 0x67, 0xde, 0x01, 0x79, 0xfe, 0x45, 0x74, 0xf0, 0xf8, 0xb9,
-  0xde, 0xf2, 0xb2, 0x59, 0x4c, 0xc7, 0x66, 0x49, 0x10, 0xd0, 0xbe, 0x09,
-  0x1b, 0xe0, 0xe6, 0x46, 0x16, 0x29, 0x23, 0xa9, 0xcc, 0x23, 0x11, 0x44,
-  0x5d, 0x45, 0xbe, 0x0b, 0x5e, 0x5d, 0x12, 0xb0, 0x43, 0xfc, 0x84, 0x1b,
-  0xcc, 0x03, 0xae, 0x10, 0x8d, 0x14, 0x0d, 0xa2, 0x49, 0x89, 0x9e, 0xbf,
-  0x21, 0x25, 0x05, 0xd8, 0x8d, 0xa8, 0x27, 0x87, 0xf1, 0x13, 0xa7, 0x23,
-  0xe9, 0x93, 0x66, 0xd3, 0xac, 0xdc, 0x17, 0x73, 0xb4, 0xa1, 0x32, 0x17,
-  0xb8, 0x14, 0x18, 0xb5, 0xfb, 0xa2, 0x8a, 0x36, 0xd5, 0x42, 0x46, 0x35,
-  0x53, 0x6b, 0xb6, 0x7c, 0xb9, 0xb4, 0x18, 0x90, 0x27, 0x91, 0x1f, 0x26,
-  0x51, 0xa6, 0xe2, 0x62, 0x03, 0x9b, 0x60, 0x6e, 0x96, 0x27, 0xe7, 0x5b,
-  0x69, 0x80, 0x3e, 0x0a, 0xa4, 0x2e, 0x3a, 0xb2, 0xa1, 0xb8, 0x11, 0x44,
-  0x60, 0x62, 0xe2, 0x87, 0x46, 0x61, 0x7e, 0x57, 0xe3, 0xb8, 0x88, 0x8b,
-  0xa6, 0x66, 0x69, 0x33, 0x23, 0x49, 0x00, 0x55, 0xe5, 0xa6, 0xf7, 0xfd,
-  0x79, 0x4b, 0x83, 0xb0, 0xaf, 0xd7, 0x57, 0x70, 0x83, 0x52, 0xc6, 0x08,
-  0xb8, 0x37, 0xd1, 0x65, 0x52, 0x66, 0x80, 0x42, 0xff, 0x06, 0x77, 0x48,
-  0xd1, 0x45, 0xf8, 0x21, 0xe1, 0xc9, 0xd1, 0x08, 0x8c, 0x8c, 0xe3, 0x68,
-  0x46, 0xc0, 0x24, 0xcf, 0x48, 0xfa, 0x21, 0x0e, 0x5a, 0xed, 0xb5, 0x46,
-  0xb1, 0x4c, 0x3e, 0xb0, 0x71, 0x94, 0x5a, 0x57, 0x8f, 0x81, 0x35, 0xb1,
-  0x61, 0xd1, 0xfa, 0x69, 0xab, 0xd9, 0xef, 0x76, 0x9b, 0xed, 0x5f, 0xb6,
-  0x3e, 0x66, 0xbf, 0xc3, 0x6f, 0xbd, 0x8f, 0x6b, 0x0e, 0x6d, 0xd5, 0x9c,
-  0xeb, 0xab, 0x2b, 0x9f, 0xbd, 0x9f, 0xc8, 0xe7, 0x3c, 0x8e, 0xc2, 0x47,
-  0xff, 0xfc, 0x8b, 0xc4, 0xf0, 0xf1, 0x33, 0xac, 0xa1, 0xcf, 0xc7, 0xa2,
-  0x10, 0x14, 0x8b, 0x5a, 0x54, 0xf4, 0x92, 0x9d, 0x70, 0xae, 0xea, 0xf2,
-  0xc4, 0x3f, 0xb6, 0x77, 0x00, 0x85, 0x25, 0xb4, 0x37, 0xba, 0x61, 0x12,
-  0xe8, 0x8e, 0x47, 0x38, 0x42, 0x91, 0x04, 0xc6, 0x66, 0xba, 0x42, 0x6e,
-  0xa8, 0xd6, 0x94, 0xc9, 0x78, 0x52, 0x98, 0xf8, 0x59, 0x36, 0x9c, 0xfd,
-  0x1a, 0x60, 0xb9, 0x1d, 0x6d, 0x36, 0x9b, 0x37, 0x02, 0xa8, 0x1a, 0x10,
-  0x26, 0x7b, 0xa1, 0x1e, 0xd8, 0x63, 0xc1, 0xd2, 0xc9, 0x66, 0x6a, 0x03,
-  0x5b, 0xe7, 0xdb, 0x05, 0x51, 0x3d, 0xc3, 0xfc, 0x5b, 0x2d, 0x1e, 0xce,
-  0x4e, 0x02, 0xaa, 0xc9, 0x20, 0xa9, 0x08, 0x04, 0xa2, 0x4f, 0x5e, 0xdd,
-  0xb0, 0xc9, 0xa0, 0x63, 0x94, 0xd0, 0xe3, 0x8c, 0xed, 0x4a, 0x0b, 0x52,
-  0xd5, 0x89, 0xcd, 0x1c, 0x18, 0xa8, 0x90, 0x0e, 0x03, 0x57, 0xac, 0xbf,
-  0x4a, 0x7b, 0x54, 0xc9, 0x1a, 0x19, 0x90, 0x60, 0x98, 0x5a, 0x98, 0xc3,
-  0x4e, 0x53, 0x65, 0xee, 0x1d, 0x11, 0x88, 0x65, 0xde, 0xe2, 0x31, 0x94,
-  0x4e, 0x71, 0xb0, 0xb1, 0x71, 0xfc, 0xa5, 0xf8, 0x2e, 0xf3, 0x2b, 0x6f,
-  0x46, 0xa9, 0xa2, 0xec, 0x67, 0xe7, 0x6d, 0x38, 0xb8, 0x4a, 0x62, 0x6d,
-  0x66, 0xef, 0x5d, 0xd2, 0x74, 0x19, 0xc5, 0xb7, 0x0c, 0x93, 0x45, 0x42,
-  0x66, 0x4e, 0x08, 0x24, 0x9e, 0xe5, 0x11, 0xff, 0x15, 0x2e, 0x31, 0xd1,
-  0x5c, 0xc4, 0x92, 0x0b, 0x9e, 0x31, 0xee, 0xcd, 0xb5, 0x1d, 0xcf, 0x1b,
-  0x62, 0x12, 0xce, 0xb9, 0x9f, 0x80, 0x6c, 0x03, 0xbb, 0xb8, 0x19, 0x8d,
-  0xc7, 0x18, 0x70, 0x82, 0xb9, 0x83, 0x06, 0x83, 0x43, 0xb3, 0xff, 0x01,
-  0xad, 0x99, 0x66, 0x3e, 0x4a, 0x02, 0x1c, 0x92, 0x36, 0x0b, 0x3e, 0x06,
-  0x35, 0x7a, 0x65, 0xa2, 0x96, 0xc6, 0x36, 0x45, 0x58, 0x65, 0xce, 0x79,
-  0xd4, 0xbd, 0x39, 0xd5, 0xf8, 0x87, 0x9b, 0xa3, 0x0f, 0xcc, 0x02, 0x82,
-  0x07, 0x18, 0xb6, 0x76, 0x08, 0xa5, 0xa5, 0xa1, 0x8d, 0x40, 0x4e, 0x96,
-  0xbb, 0x12, 0x2c, 0x4a, 0x2d, 0xce, 0x27, 0xa8, 0x13, 0x72, 0x06, 0x16,
-  0x4e, 0x7e, 0x77, 0x11, 0x63, 0x1a, 0x6f, 0xf0, 0xa0, 0xa8, 0x19, 0xcc,
-  0xcc, 0xc0, 0x32, 0x96, 0xa1, 0xeb, 0x29, 0x4b, 0xac, 0xe4, 0xaf, 0x32,
-  0x08, 0x94, 0x67, 0xb5, 0x9c, 0x6c, 0x12, 0x1e, 0xef, 0xab, 0x96, 0x16,
-  0x3b, 0xef, 0x14, 0x66, 0x23, 0x05, 0x2b, 0x93, 0x9d, 0x88, 0xf8, 0xda,
-  0x25, 0xe6, 0x62, 0x34, 0x25, 0xc8, 0x24, 0x41, 0x59, 0xb2, 0xe4, 0xf1,
-  0x09, 0x3e, 0x9b, 0x86, 0xf5, 0xd5, 0x61, 0x51, 0xed, 0xea, 0x65, 0xd6,
-  0xde, 0xdf, 0xc4, 0x2d, 0xcd, 0x53, 0xda, 0xff, 0x99, 0xe4, 0x2e, 0x30,
-  0xc5, 0x23, 0x2d, 0x93, 0x67, 0xd6, 0x5b, 0x7e, 0x59, 0x04, 0xa0, 0xde,
-  0x23, 0x8d, 0x32, 0x0d, 0x3d, 0xdd, 0x38, 0x7d, 0xd9, 0x46, 0xcb, 0x4f,
-  0x88, 0x73, 0xe7, 0xf8, 0x01, 0x2a, 0xc1, 0xe2, 0x14, 0x8b, 0x98, 0x59,
-  0x9e, 0x83, 0x03, 0xfa, 0xa0, 0x89, 0x19, 0x92, 0x63, 0x3c, 0xc1, 0xd6,
-  0x5c, 0xed, 0x9f, 0xcc, 0xc6, 0x18, 0xf8, 0xa3, 0x18, 0xe3, 0xb5, 0xc8,
-  0x59, 0xe8, 0xe1, 0xa7, 0x06, 0xb7, 0x64, 0x01, 0xd5, 0x37, 0x18, 0x84,
-  0xe3, 0x43, 0x24, 0x2c, 0x29, 0x81, 0x8c, 0x28, 0xc8, 0x5b, 0xf4, 0xa7,
-  0x52, 0x87, 0x45, 0x0b, 0x24, 0xe1, 0xca, 0x81, 0x5f, 0xd1, 0x4e, 0xba,
-  0xba, 0x99, 0x6d, 0x7c, 0x0d, 0x0b, 0x04, 0x96, 0x0f, 0x7a, 0x71, 0xcf,
-  0x60, 0x6a, 0x5b, 0x3c, 0x51, 0xc3, 0x2e, 0xa5, 0x42, 0xb4, 0x31, 0x58,
-  0x22, 0x0a, 0xb5, 0xdc, 0x87, 0xfd, 0x72, 0x3f, 0x0c, 0xaf, 0x63, 0xdc,
-  0xd4, 0x20, 0xcf, 0xe9, 0xbd, 0x62, 0x8c, 0x31, 0xc0, 0xc4, 0xb6, 0x86,
-  0x4e, 0xa4, 0x9f, 0x8a, 0x54, 0xd3, 0x4f, 0x39, 0x35, 0xc5, 0xd9, 0x44,
-  0x35, 0xc5, 0x22, 0x0b, 0x4d, 0x52, 0x59, 0xab, 0xf1, 0x1d, 0xcb, 0x9b,
-  0xe8, 0x35, 0x4a, 0xb5, 0xe4, 0x31, 0x88, 0xea, 0x1a, 0x59, 0x6a, 0xff,
-  0x6b, 0xa5, 0xdb, 0x46, 0x3c, 0x19, 0x39, 0xad, 0xad, 0xbd, 0xbd, 0xce,
-  0xf6, 0xd6, 0xcb, 0xce, 0xd6, 0xcb, 0xad, 0x0e, 0xe9, 0xd9, 0x2f, 0xdb,
-  0x05, 0xdc, 0x1f, 0xf5, 0x5f, 0xfb, 0xab, 0x86, 0xc2, 0x51, 0x58, 0x35,
-  0x14, 0x3e, 0xe0, 0xba, 0xa1, 0x54, 0xd5, 0xf8, 0x96, 0xa1, 0x18, 0x63,
-  0xf4, 0xec, 0x6c, 0x81, 0xcc, 0x10, 0x12, 0x8b, 0xaa, 0xb8, 0x85, 0x60,
-  0x58, 0xbd, 0xc6, 0xac, 0xce, 0x3e, 0x13, 0xd4, 0x05, 0xac, 0x30, 0xa5,
-  0xef, 0x54, 0x9e, 0xce, 0xe5, 0x6c, 0x94, 0xe7, 0xf7, 0x18, 0xea, 0x5e,
-  0xb3, 0xe3, 0x71, 0xa5, 0x9a, 0x2c, 0x13, 0xa8, 0x53, 0xdc, 0xbd, 0x04,
-  0x49, 0xa1, 0x2a, 0x66, 0xff, 0x14, 0x6a, 0xc1, 0x1a, 0x2c, 0xd6, 0xc2,
-  0xe4, 0xa1, 0x4e, 0x71, 0xad, 0xb2, 0x0c, 0x16, 0x85, 0x83, 0xb5, 0xe5,
-  0x68, 0x08, 0x68, 0x9c, 0xfa, 0xe9, 0x11, 0xde, 0x95, 0x00, 0xd2, 0x7a,
-  0xc6, 0x72, 0xff, 0xd8, 0x89, 0x55, 0x98, 0x4a, 0x97, 0x92, 0xb1, 0x7f,
-  0x8f, 0x1f, 0xa4, 0xa0, 0xf0, 0x40, 0x94, 0x86, 0x98, 0x93, 0x91, 0x90,
-  0xd6, 0x5e, 0x8f, 0xe1, 0x4d, 0xee, 0xc9, 0x4e, 0x8f, 0xe1, 0xd6, 0x2e,
-  0xc0, 0xbd, 0x99, 0x82, 0x0c, 0x9a, 0xc7, 0xe2, 0xe4, 0x91, 0x76, 0xf8,
-  0x95, 0xed, 0x72, 0xe8, 0xfd, 0xdc, 0x61, 0x41, 0x68, 0x10, 0x00, 0x0f,
-  0x11, 0xa8, 0x27, 0x01, 0x07, 0xb7, 0x28, 0xb3, 0x68, 0xe4, 0xc3, 0x16,
-  0xc6, 0xa3, 0x77, 0xbe, 0x8b, 0x89, 0x43, 0xbf, 0x51, 0x50, 0xa5, 0x26,
-  0x98, 0x52, 0x11, 0x19, 0x8d, 0xe6, 0x34, 0x6c, 0x95, 0x3b, 0x2f, 0x53,
-  0x75, 0xa8, 0x51, 0x50, 0x21, 0x9c, 0x33, 0xc6, 0x5c, 0x4a, 0x84, 0xa3,
-  0xc5, 0xdf, 0xb5, 0x5e, 0xf8, 0xe1, 0xca, 0x56, 0x99, 0x23, 0xca, 0xd3,
-  0x6f, 0xe8, 0x9a, 0x9b, 0x6b, 0xc2, 0xbe, 0x11, 0x07, 0x35, 0xc1, 0xda,
-  0x9d, 0xc1, 0x98, 0x71, 0xdc, 0x25, 0x94, 0xd4, 0xe6, 0x95, 0x46, 0x11,
-  0x07, 0x63, 0x36, 0x8a, 0x56, 0xfa, 0x30, 0xbf, 0x65, 0x70, 0x95, 0x72,
-  0xea, 0x51, 0x2f, 0xe5, 0x7b, 0x02, 0x26, 0xa4, 0xc5, 0x7e, 0xa0, 0x4a,
-  0x6e, 0x83, 0xa8, 0x6e, 0x9c, 0x38, 0xf1, 0x6d, 0x03, 0x04, 0x5d, 0xe3,
-  0x9c, 0x7d, 0x2a, 0x99, 0x57, 0xa5, 0x60, 0x78, 0xf3, 0x2f, 0xc3, 0xf3,
-  0xe3, 0xab, 0x8b, 0x21, 0xb9, 0xb9, 0x22, 0x47, 0xe7, 0x37, 0x47, 0x67,
-  0xef, 0x09, 0xa2, 0x79, 0x76, 0x79, 0x74, 0xde, 0x34, 0xcc, 0xc1, 0x35,
-  0x68, 0xb9, 0xc5, 0x3c, 0xe7, 0xf8, 0x39, 0x70, 0x3c, 0x58, 0x6b, 0x52,
-  0xc9, 0x57, 0xcc, 0xbb, 0xa8, 0x35, 0x20, 0xad, 0x59, 0x32, 0x31, 0xd1,
-  0x59, 0xc9, 0xa2, 0xc1, 0x1a, 0x3a, 0xd3, 0x56, 0x4a, 0x3e, 0x01, 0xb7,
-  0xd5, 0x28, 0x8c, 0x93, 0x6d, 0x63, 0xe5, 0xb2, 0x60, 0xf3, 0x9d, 0x5b,
-  0xfa, 0x05, 0x60, 0xa6, 0x60, 0xdc, 0x13, 0x44, 0x1a, 0x6b, 0xb3, 0x01,
-  0xd6, 0x8f, 0x32, 0xc2, 0x3c, 0x92, 0x17, 0x1c, 0x80, 0x6d, 0x70, 0x87,
-  0xae, 0x8e, 0x36, 0x3e, 0x56, 0xe4, 0xdc, 0x95, 0x9c, 0xfe, 0x32, 0xed,
-  0x47, 0x1b, 0xab, 0x32, 0x2b, 0xd7, 0x2c, 0xfb, 0xc8, 0x46, 0x01, 0x77,
-  0x2c, 0xaa, 0xe6, 0x6d, 0xea, 0xdd, 0x9b, 0x75, 0xb3, 0x51, 0x91, 0xed,
-  0xc7, 0x17, 0x9b, 0x39, 0x67, 0xea, 0x3d, 0x93, 0xe6, 0x3c, 0x26, 0x8d,
-  0x42, 0x56, 0xf8, 0x32, 0x12, 0xbc, 0x4a, 0x20, 0x61, 0xfb, 0x06, 0x21,
-  0x9b, 0x89, 0xe3, 0xba, 0x8b, 0x19, 0xa6, 0x55, 0x6b, 0x8c, 0x29, 0x12,
-  0x85, 0xd7, 0x61, 0x0f, 0xe8, 0x2d, 0x0a, 0x4f, 0x30, 0x71, 0x86, 0x77,
-  0x92, 0x88, 0x83, 0xa9, 0x98, 0x9e, 0xc7, 0x82, 0x0a, 0x20, 0xdc, 0x31,
-  0x69, 0x4c, 0x13, 0x78, 0x7c, 0x04, 0x6a, 0x1a, 0x73, 0xe6, 0x7e, 0xe5,
-  0x92, 0x96, 0x41, 0x6c, 0x89, 0x6c, 0xb1, 0xe2, 0x52, 0x28, 0xa6, 0x93,
-  0x55, 0x6f, 0xf3, 0x00, 0x39, 0x96, 0xec, 0xec, 0x52, 0xbc, 0x56, 0x68,
-  0x4e, 0x5d, 0x34, 0x3c, 0x31, 0x9b, 0x4d, 0xda, 0x9d, 0xfc, 0xe0, 0x21,
-  0x2c, 0x11, 0xcc, 0x43, 0xa4, 0x4c, 0x53, 0xcd, 0x8a, 0x68, 0x32, 0x8c,
-  0x60, 0xeb, 0xe0, 0xb8, 0xd3, 0xe3, 0x05, 0x6c, 0xc9, 0x66, 0x7f, 0xa2,
-  0x0f, 0x2a, 0x45, 0x5a, 0x2d, 0x7a, 0x57, 0x46, 0x92, 0x39, 0xac, 0xee,
-  0x6c, 0x34, 0xb7, 0x59, 0x66, 0x65, 0x13, 0xba, 0x05, 0xe9, 0x1a, 0x36,
-  0xdb, 0x85, 0xf5, 0x54, 0xb4, 0xe6, 0xd3, 0x38, 0xb0, 0x2e, 0x32, 0x64,
-  0x4b, 0x9b, 0x86, 0x1c, 0xb4, 0x0b, 0x35, 0x01, 0x15, 0xdc, 0xa3, 0xe1,
-  0xaf, 0x00, 0x9f, 0x1b, 0xf3, 0xb3, 0x26, 0x5a, 0xbb, 0xea, 0x97, 0x8b,
-  0x66, 0x7b, 0xb3, 0xb0, 0x56, 0x16, 0xce, 0x42, 0x67, 0x88, 0x12, 0xc8,
-  0x2a, 0x18, 0x25, 0xe6, 0x85, 0x65, 0x32, 0xfc, 0xaf, 0xc5, 0x70, 0x44,
-  0x08, 0xc3, 0x95, 0x3d, 0x82, 0x62, 0x9a, 0x23, 0x9b, 0x24, 0x65, 0x3b,
-  0x1c, 0x87, 0x87, 0x2b, 0x07, 0x25, 0x62, 0xc0, 0x0e, 0x21, 0x30, 0x22,
-  0xf3, 0x1f, 0xd5, 0x14, 0xbc, 0x5e, 0x9b, 0xfc, 0x81, 0xf4, 0xee, 0xb7,
-  0x4e, 0x0d, 0xc6, 0x3c, 0x90, 0xe0, 0x42, 0xf4, 0xa0, 0x27, 0x09, 0xe3,
-  0x9f, 0x9d, 0x1f, 0xfb, 0x59, 0x2f, 0xad, 0xe6, 0x49, 0xb3, 0xcd, 0x52,
-  0x96, 0xb9, 0x2d, 0xc8, 0x4f, 0x1d, 0x11, 0xeb, 0x90, 0xd5, 0x20, 0x27,
-  0x85, 0x96, 0xaf, 0xd4, 0x96, 0xd7, 0x7a, 0x4b, 0x3c, 0x95, 0x9a, 0x35,
-  0xbc, 0x2e, 0x34, 0xdc, 0x53, 0x1b, 0x0e, 0xf5, 0x86, 0xa0, 0x33, 0x64,
-  0xb3, 0xa1, 0xde, 0xec, 0x65, 0x4f, 0x6d, 0xf6, 0xb3, 0xde, 0x0c, 0xb9,
-  0x2a, 0x6b, 0xf8, 0x73, 0xa1, 0xe1, 0xae, 0xda, 0xf0, 0x4a, 0x34, 0xf4,
-  0xc3, 0x04, 0xb3, 0x72, 0x65, 0x9b, 0xab, 0x42, 0x9b, 0x1f, 0xd4, 0x36,
-  0x6f, 0x44, 0x1b, 0x0f, 0x0c, 0x1f, 0x3c, 0x89, 0x21, 0xda, 0xbc, 0xd1,
-  0xdb, 0x68, 0xc3, 0x7a, 0x0b, 0x3c, 0xce, 0x66, 0x1d, 0x37, 0x0e, 0xec,
-  0x50, 0x4c, 0xd6, 0xec, 0x6d, 0x9d, 0xd2, 0x42, 0xbe, 0x56, 0x26, 0xec,
-  0x17, 0xce, 0xc2, 0x08, 0xf3, 0xe3, 0x7a, 0xec, 0x5b, 0xd5, 0x78, 0xbf,
-  0x86, 0x6f, 0x19, 0x77, 0xe2, 0xd9, 0x30, 0x2e, 0x0a, 0x98, 0x75, 0x9a,
-  0xf0, 0x04, 0x49, 0xe2, 0x83, 0xed, 0x8a, 0xc4, 0x4d, 0x28, 0x88, 0x9c,
-  0xd0, 0xa5, 0xf5, 0x3c, 0x7e, 0x0e, 0x6a, 0x1f, 0x84, 0x6a, 0xfc, 0x90,
-  0xb2, 0x84, 0x47, 0xe6, 0x81, 0x14, 0x9c, 0x9b, 0x74, 0xc0, 0x26, 0xc4,
-  0xf3, 0xf3, 0x18, 0xdb, 0x6f, 0x93, 0x09, 0x06, 0x89, 0x85, 0xd8, 0x5c,
-  0x43, 0xd1, 0x96, 0x64, 0x1a, 0x1a, 0x18, 0xfc, 0xa4, 0xbc, 0x92, 0x54,
-  0x27, 0x8c, 0x4b, 0x2e, 0xd6, 0x33, 0x81, 0x8f, 0xd7, 0xc6, 0x80, 0x72,
-  0x31, 0xca, 0xb4, 0x62, 0x48, 0xd9, 0xa4, 0x98, 0xea, 0x35, 0x41, 0x51,
-  0x35, 0x95, 0xe5, 0xfa, 0xea, 0x20, 0x54, 0xb9, 0x0d, 0xfa, 0xef, 0xe7,
-  0x51, 0x42, 0x4b, 0x4e, 0xdd, 0x1a, 0x83, 0xa3, 0x22, 0x09, 0x91, 0x6d,
-  0x6b, 0x78, 0x16, 0x22, 0xc0, 0x97, 0x64, 0xa9, 0xb0, 0x38, 0xcc, 0x11,
-  0x1d, 0xa3, 0xae, 0xd2, 0xb2, 0x4e, 0xf5, 0xe4, 0x89, 0xcb, 0x88, 0x04,
-  0x51, 0x38, 0x81, 0x6a, 0x8b, 0x84, 0x7a, 0x1d, 0xf8, 0x65, 0xe2, 0xbb,
-  0x24, 0xdb, 0x5d, 0xd5, 0x28, 0x92, 0xdc, 0xbd, 0x54, 0x9a, 0x06, 0x8e,
-  0x38, 0xd4, 0x7f, 0x07, 0x16, 0x74, 0x82, 0x8c, 0x0e, 0x23, 0xb8, 0xc3,
-  0x30, 0x94, 0x6d, 0xdb, 0x39, 0xb6, 0xe8, 0x51, 0x32, 0x3b, 0xa9, 0x8e,
-  0x99, 0xaf, 0x0c, 0xb4, 0x71, 0x96, 0xfe, 0x9b, 0x3b, 0xe8, 0xb0, 0x03,
-  0xe1, 0x1a, 0xab, 0xf3, 0x4d, 0x95, 0xdc, 0x6d, 0xe6, 0xd9, 0xd7, 0x0f,
-  0x11, 0x15, 0xed, 0x42, 0x60, 0xa7, 0x58, 0x3a, 0xe5, 0x8c, 0xf5, 0x0d,
-  0x2e, 0x54, 0xbd, 0x46, 0x39, 0xe7, 0x77, 0x75, 0x9c, 0x1e, 0xfd, 0x4e,
-  0x59, 0xd0, 0x03, 0xc3, 0x9c, 0xdc, 0x2f, 0x77, 0xc7, 0xd3, 0xf9, 0x54,
-  0xd3, 0xc7, 0x30, 0xee, 0x52, 0x44, 0xb1, 0xd6, 0x21, 0x97, 0xc5, 0x54,
-  0xdf, 0x81, 0x54, 0x9a, 0x25, 0x79, 0x64, 0xf5, 0x1a, 0x46, 0xee, 0x4e,
-  0xf9, 0xd7, 0x96, 0xd8, 0x6a, 0xa1, 0x13, 0x8b, 0x1d, 0xc4, 0x4d, 0x58,
-  0x61, 0xdb, 0xa0, 0xc1, 0x30, 0xe4, 0x07, 0x5b, 0x74, 0x9c, 0x76, 0x1e,
-  0x76, 0xe5, 0x10, 0xd0, 0xe5, 0xd5, 0x12, 0xe7, 0x7b, 0x9a, 0x75, 0x99,
-  0x8a, 0x68, 0x7f, 0x25, 0x0e, 0x9a, 0xcd, 0xbf, 0x8a, 0x20, 0xab, 0xc3,
-  0xa1, 0x95, 0xbb, 0xe2, 0xd0, 0xf2, 0xce, 0x94, 0xae, 0x8b, 0xee, 0x2e,
-  0x09, 0xf1, 0x6d, 0x5e, 0xa5, 0xa5, 0x54, 0x6f, 0x17, 0x7d, 0x4a, 0xc5,
-  0xf1, 0xca, 0xd0, 0x31, 0x5a, 0x2a, 0xcd, 0x2c, 0xcc, 0xdd, 0x34, 0x39,
-  0x28, 0x70, 0xbf, 0x9a, 0xcf, 0x1d, 0xbb, 0x4f, 0x07, 0xad, 0x12, 0x61,
-  0x49, 0xe0, 0x69, 0x07, 0x5f, 0x97, 0xcc, 0xe2, 0x9c, 0x08, 0x56, 0x04,
-  0xdb, 0x67, 0xaf, 0xb7, 0xb7, 0xd7, 0x34, 0x6f, 0x68, 0x3e, 0x2f, 0xf1,
-  0x82, 0xc9, 0xe7, 0x5f, 0xb4, 0x71, 0x3f, 0xf6, 0x9f, 0x7f, 0xc1, 0xb6,
-  0x5a, 0xee, 0xc8, 0xd7, 0xed, 0x75, 0x18, 0x22, 0xf1, 0xc2, 0x2d, 0xf0,
-  0x5e, 0x85, 0xf4, 0x11, 0x48, 0x35, 0x19, 0x52, 0x19, 0x49, 0xfa, 0x12,
-  0xff, 0x0d, 0xce, 0x72, 0x38, 0x09, 0x08, 0x1c, 0x75, 0xaa, 0xe5, 0x74,
-  0xad, 0x64, 0x75, 0xd3, 0xb4, 0x0a, 0x18, 0xda, 0xa0, 0xf3, 0x2d, 0x06,
-  0x13, 0x28, 0x71, 0x94, 0x46, 0x6e, 0x84, 0x1b, 0x5d, 0x8a, 0xfe, 0x85,
-  0x84, 0x31, 0xdd, 0x9d, 0xe4, 0xc0, 0x11, 0xc3, 0x67, 0x8c, 0xbb, 0x82,
-  0xb4, 0x94, 0x7e, 0x81, 0xea, 0x85, 0x05, 0x6a, 0x45, 0x37, 0xb0, 0xd8,
-  0xe7, 0x01, 0x58, 0x0c, 0xad, 0xee, 0x3f, 0xd8, 0x0d, 0xa0, 0x3f, 0xf5,
-  0xff, 0xde, 0xfd, 0x7b, 0xb7, 0xdb, 0x21, 0xcd, 0x66, 0x5b, 0x86, 0xe6,
-  0xbb, 0xc5, 0xd0, 0x3c, 0xa0, 0xc3, 0x07, 0x9d, 0x2f, 0x68, 0x62, 0x01,
-  0x3b, 0x07, 0xd1, 0x12, 0xfe, 0x9e, 0x83, 0xf0, 0x5c, 0x80, 0xe0, 0xf0,
-  0xdd, 0x0e, 0x5e, 0x3b, 0x00, 0xba, 0x78, 0xfa, 0x30, 0x9f, 0x52, 0xd5,
-  0xf7, 0xc1, 0xb6, 0x55, 0xdd, 0x7f, 0xfc, 0xe2, 0x58, 0xbf, 0x1e, 0x59,
-  0x7f, 0xeb, 0x59, 0x3f, 0xda, 0xd6, 0xc7, 0x17, 0xcf, 0xbb, 0xa0, 0x26,
-  0x93, 0xb4, 0x25, 0x70, 0x6c, 0x57, 0x4c, 0xfb, 0xd2, 0x89, 0xc3, 0x56,
-  0xe3, 0x2c, 0x64, 0x7d, 0x6b, 0x64, 0xef, 0x88, 0xbc, 0x2a, 0x71, 0xcf,
-  0x8e, 0x39, 0x09, 0x56, 0xe7, 0xfe, 0xea, 0x54, 0x58, 0x81, 0xc5, 0xea,
-  0x70, 0x84, 0x0c, 0x0e, 0xe5, 0x3c, 0xa7, 0x88, 0x79, 0x26, 0xf6, 0x00,
-  0x22, 0x48, 0x2d, 0xa6, 0x97, 0xea, 0x98, 0xc1, 0x10, 0x2d, 0x29, 0xf0,
-  0xc0, 0x9a, 0x4a, 0x45, 0x21, 0xb4, 0x29, 0x64, 0xa3, 0x83, 0xc4, 0x68,
-  0x71, 0xbe, 0x71, 0x55, 0x80, 0xc1, 0x1c, 0x41, 0x47, 0x26, 0x8d, 0xb3,
-  0x4c, 0x4a, 0x5a, 0xa6, 0x3a, 0xe4, 0xfc, 0x58, 0xea, 0x10, 0x44, 0x2f,
-  0xf3, 0x50, 0x62, 0x84, 0x8b, 0x78, 0x4a, 0x3a, 0x46, 0xe0, 0x4c, 0x78,
-  0xc8, 0x6a, 0x06, 0x0c, 0x04, 0xdc, 0x94, 0x85, 0xd4, 0x0c, 0x7b, 0xd9,
-  0xd5, 0x81, 0xde, 0x22, 0xeb, 0xaf, 0x93, 0xb0, 0x62, 0x96, 0xcb, 0xeb,
-  0xe5, 0xad, 0x28, 0x18, 0x2a, 0x81, 0x46, 0x99, 0x4f, 0x22, 0x8e, 0xe3,
-  0x15, 0x85, 0x1f, 0x58, 0x13, 0x9f, 0xf5, 0x39, 0xa9, 0x38, 0x2a, 0xb2,
-  0x94, 0x9a, 0x2d, 0xc3, 0xbd, 0xc5, 0xd0, 0x32, 0xe9, 0xef, 0x65, 0x62,
-  0xf3, 0xa3, 0x7d, 0x37, 0xb8, 0x19, 0x1e, 0x90, 0x86, 0x83, 0xe7, 0x6a,
-  0xf8, 0x81, 0xae, 0x46, 0xd9, 0x29, 0x95, 0x41, 0xd4, 0x8d, 0x4d, 0x0d,
-  0xd1, 0x6f, 0x3f, 0x68, 0xc7, 0x22, 0x4e, 0x34, 0x47, 0x7f, 0x13, 0x2f,
-  0x94, 0x68, 0x9b, 0x33, 0x67, 0xc3, 0x34, 0x6c, 0x35, 0xb5, 0xcc, 0x10,
-  0xbf, 0x16, 0x47, 0xb4, 0xcc, 0xe1, 0xcb, 0x5c, 0xca, 0x1b, 0xd3, 0x0e,
-  0xb9, 0x83, 0x31, 0x5f, 0xe1, 0xba, 0xd1, 0x5f, 0x2b, 0xe1, 0xd7, 0xa6,
-  0x70, 0x85, 0xdb, 0x09, 0x17, 0x9b, 0xc1, 0xe9, 0x94, 0xcd, 0x74, 0x14,
-  0xa2, 0x7b, 0x1b, 0x37, 0xed, 0xf5, 0x01, 0xf4, 0x46, 0x49, 0x3e, 0x95,
-  0xe2, 0x87, 0x65, 0x32, 0x96, 0x62, 0xe8, 0xb0, 0x80, 0xaf, 0x42, 0x58,
-  0x98, 0x95, 0xd9, 0x1c, 0x7c, 0x53, 0x94, 0x2c, 0xd8, 0xbd, 0x55, 0xe3,
-  0x45, 0xa0, 0x4c, 0x5a, 0x6d, 0xc8, 0x82, 0x1f, 0x7c, 0xd4, 0xa4, 0x59,
-  0x10, 0x45, 0xf3, 0xa4, 0xc0, 0xad, 0x7a, 0x7c, 0xb9, 0xd2, 0x31, 0xfe,
-  0xd4, 0x19, 0x3a, 0x9b, 0x44, 0xc9, 0x75, 0xbf, 0x79, 0x87, 0xec, 0x96,
-  0xe2, 0xdd, 0xaa, 0x7c, 0xa8, 0x5c, 0x65, 0x4f, 0x9c, 0xab, 0x6c, 0xe4,
-  0x1c, 0x99, 0x49, 0x3b, 0x40, 0x87, 0x16, 0x4c, 0x83, 0xd9, 0xab, 0xf6,
-  0xac, 0x06, 0x89, 0x52, 0x7a, 0x55, 0x69, 0xa3, 0xae, 0x9d, 0xf4, 0x63,
-  0xbd, 0xd8, 0x15, 0x07, 0x82, 0xd7, 0x3c, 0x5d, 0x4a, 0x4a, 0x67, 0xf6,
-  0x8a, 0x4e, 0xc9, 0xf5, 0x10, 0x33, 0x9d, 0x13, 0x65, 0x07, 0x10, 0xc5,
-  0xa1, 0x43, 0x73, 0xda, 0x23, 0xbf, 0x01, 0x01, 0xd7, 0x86, 0xb8, 0x0b,
-  0xc1, 0xe6, 0xff, 0x32, 0x50, 0x78, 0xfb, 0x01, 0x20, 0x4d, 0x9d, 0x19,
-  0x8f, 0x6a, 0x16, 0xc3, 0x26, 0x06, 0xd4, 0x39, 0xb8, 0xa7, 0xc1, 0xfe,
-  0x75, 0x10, 0x8d, 0x4a, 0x68, 0xb3, 0x7b, 0x3b, 0xd8, 0x31, 0x57, 0x27,
-  0x1f, 0x5c, 0xab, 0x5d, 0xe4, 0x6f, 0x1b, 0x34, 0x72, 0xd8, 0x6a, 0x8d,
-  0xc4, 0xd8, 0xcb, 0x8b, 0x6b, 0x0d, 0x12, 0xf0, 0xc6, 0xab, 0x89, 0xb0,
-  0x01, 0x21, 0xd0, 0x1b, 0x53, 0x42, 0x95, 0xa9, 0x9f, 0x96, 0x54, 0x3f,
-  0x80, 0x6a, 0xa5, 0xd2, 0xe1, 0x50, 0xf1, 0xee, 0xd0, 0x91, 0x3c, 0x17,
-  0x99, 0xeb, 0x9d, 0xcd, 0xd7, 0x0b, 0xb3, 0x73, 0x6a, 0x56, 0x4b, 0x95,
-  0xbc, 0xc5, 0x66, 0xbc, 0x63, 0xc6, 0xff, 0x88, 0x93, 0xfc, 0x19, 0xe8,
-  0x94, 0x44, 0xa1, 0x69, 0x23, 0x9a, 0xc6, 0x30, 0x0c, 0x34, 0x1b, 0x4a,
-  0x74, 0xd6, 0x6b, 0x97, 0x4e, 0xb0, 0x8a, 0x76, 0xa6, 0x40, 0xd9, 0x43,
-  0xe8, 0x4e, 0xe3, 0x28, 0xc4, 0xad, 0x69, 0x21, 0x1b, 0x75, 0x4d, 0x25,
-  0xaa, 0xd8, 0x22, 0xdc, 0x27, 0x60, 0x52, 0x0e, 0x28, 0xdf, 0xb2, 0x2c,
-  0x7d, 0xdc, 0x9a, 0x08, 0xed, 0x50, 0x4e, 0x9e, 0x62, 0x26, 0xa0, 0x2f,
-  0xcd, 0xb8, 0x0a, 0xc1, 0xb3, 0x6e, 0x26, 0x54, 0x55, 0x86, 0x1a, 0x27,
-  0xbf, 0x4d, 0x32, 0xcd, 0x8f, 0x41, 0x23, 0xdb, 0xae, 0x48, 0x77, 0xac,
-  0xb7, 0x13, 0xaa, 0x52, 0x1d, 0x2b, 0x93, 0x2a, 0xab, 0xba, 0xc9, 0xd2,
-  0xb6, 0x98, 0xd5, 0xcb, 0xb5, 0xa6, 0x8c, 0x3d, 0x28, 0x46, 0xf1, 0xb7,
-  0xe6, 0x38, 0xae, 0xc3, 0xd5, 0x54, 0x9c, 0x86, 0x50, 0x16, 0x54, 0x9d,
-  0x49, 0xa7, 0x58, 0x41, 0xf2, 0x7c, 0x89, 0xc9, 0x8e, 0x5b, 0x83, 0x9b,
-  0x30, 0xef, 0x35, 0x0a, 0x9b, 0x78, 0xd5, 0x48, 0x10, 0x94, 0x09, 0x4f,
-  0xa6, 0x34, 0xc6, 0x58, 0xba, 0x5c, 0x77, 0x4b, 0x3f, 0x10, 0xf1, 0x19,
-  0x4a, 0xfc, 0xb4, 0xd6, 0x9a, 0x10, 0xb7, 0xf6, 0xad, 0xd8, 0x1c, 0xad,
-  0x91, 0xd3, 0xc9, 0xb7, 0x47, 0xc6, 0xad, 0x1d, 0xdb, 0x20, 0x06, 0xb5,
-  0xc7, 0x4f, 0x4a, 0xfb, 0xa2, 0xdf, 0x78, 0x3f, 0x57, 0xb3, 0x45, 0x33,
-  0x38, 0x82, 0xb3, 0xcd, 0x58, 0xc1, 0x85, 0x4d, 0xef, 0x61, 0x67, 0xe3,
-  0xfa, 0x98, 0xd2, 0xa8, 0x04, 0x2e, 0x67, 0x74, 0x16, 0xe1, 0x2e, 0x96,
-  0x3a, 0xb7, 0x89, 0x89, 0x2b, 0x55, 0x53, 0xb4, 0xe0, 0x2f, 0xac, 0xb4,
-  0x3a, 0xea, 0xeb, 0x49, 0x69, 0x5b, 0x5f, 0x4b, 0x72, 0xaf, 0x41, 0x1e,
-  0xe5, 0x12, 0x89, 0x83, 0x2a, 0x5c, 0xcb, 0xc0, 0xe5, 0x42, 0x17, 0xff,
-  0x29, 0x04, 0xfc, 0x74, 0x4a, 0xd6, 0xdb, 0x8a, 0x55, 0xb7, 0xbb, 0xe8,
-  0x35, 0xc5, 0x15, 0x3c, 0x67, 0x97, 0x6f, 0x2a, 0x6d, 0x4b, 0x68, 0xce,
-  0x30, 0x6a, 0xb1, 0x6b, 0x7f, 0x48, 0x83, 0xdf, 0x16, 0xa6, 0xc8, 0x82,
-  0x46, 0x7d, 0x86, 0xc6, 0x57, 0x78, 0xeb, 0xc5, 0xd0, 0x57, 0x6e, 0xca,
-  0x1e, 0xeb, 0x75, 0x40, 0xa5, 0x13, 0xbf, 0x7a, 0xf9, 0x57, 0x9f, 0xf0,
-  0x92, 0x37, 0x69, 0x6c, 0xea, 0x2d, 0x37, 0xc8, 0xed, 0xc2, 0x6a, 0xe3,
-  0xb2, 0x46, 0xd6, 0x63, 0xfe, 0x0d, 0xc1, 0x09, 0xf2, 0x9b, 0x47, 0x80,
-  0x28, 0xf0, 0x7d, 0xe6, 0xdc, 0xe7, 0x3b, 0x1a, 0xa8, 0x82, 0xc5, 0x1b,
-  0xbb, 0xde, 0xeb, 0x6f, 0x84, 0x30, 0x00, 0xc9, 0xf6, 0x14, 0x87, 0x03,
-  0x99, 0x9d, 0x83, 0xf7, 0x42, 0xe5, 0xf7, 0x37, 0x1d, 0xdd, 0xdc, 0x0c,
-  0x2f, 0xde, 0xdd, 0x5c, 0x17, 0x6f, 0x0a, 0x51, 0x75, 0xcf, 0x05, 0xa0,
-  0x6e, 0x94, 0x21, 0x72, 0x1c, 0x36, 0x5e, 0x43, 0xe7, 0xde, 0x12, 0xe5,
-  0x9c, 0x0b, 0xf3, 0x4f, 0x99, 0x15, 0xd5, 0xea, 0x41, 0x68, 0xf7, 0x1e,
-  0xd5, 0x61, 0x76, 0x19, 0x29, 0xa9, 0xc8, 0x12, 0xbd, 0xaf, 0xe9, 0xb5,
-  0x82, 0x6c, 0x2f, 0x5e, 0x94, 0x1c, 0x39, 0x1e, 0xde, 0xe6, 0x46, 0x32,
-  0x6a, 0x16, 0x6e, 0xc2, 0x02, 0x6e, 0xbb, 0x70, 0xd2, 0xa9, 0x3d, 0x8f,
-  0x96, 0xad, 0xed, 0x4e, 0xe5, 0x0e, 0xcf, 0x22, 0x5b, 0xed, 0x6a, 0xf7,
-  0x8e, 0x6a, 0x54, 0x80, 0x25, 0x43, 0x9e, 0x7f, 0xe1, 0x9d, 0x76, 0x59,
-  0x9e, 0xf3, 0x63, 0x82, 0xe1, 0xa2, 0xd6, 0xf3, 0x2f, 0x15, 0xc0, 0x1f,
-  0xbb, 0xcf, 0xbf, 0xd4, 0x4e, 0xf5, 0x63, 0xbb, 0xe0, 0x1e, 0xaa, 0x88,
-  0xd0, 0xd4, 0x6f, 0x8d, 0xd7, 0x0b, 0xeb, 0x54, 0xa7, 0xa4, 0x6b, 0x99,
-  0xf5, 0x9b, 0xa7, 0xa8, 0x6f, 0x72, 0xcc, 0xa2, 0xc3, 0x27, 0x6d, 0x8d,
-  0x34, 0xf0, 0xa3, 0xf9, 0x1c, 0x24, 0x3b, 0xde, 0xa4, 0xc6, 0x13, 0x30,
-  0x57, 0x78, 0x61, 0x30, 0x09, 0x8d, 0x65, 0xa7, 0xad, 0x88, 0x27, 0x69,
-  0x79, 0xce, 0xc9, 0x8a, 0x3c, 0x67, 0x10, 0xd3, 0x88, 0x40, 0xa3, 0x6e,
-  0xe3, 0x9e, 0x13, 0x50, 0x24, 0x35, 0x22, 0x46, 0x49, 0xdd, 0x76, 0x5e,
-  0x54, 0xb1, 0x53, 0x91, 0x7a, 0xfd, 0xff, 0x3b, 0x41, 0xb8, 0x42, 0x8d,
-  0x94, 0x53, 0x08, 0x0d, 0xe9, 0x81, 0x9b, 0xdf, 0x82, 0xe3, 0x20, 0x57,
-  0x30, 0x1b, 0x3a, 0x63, 0x8c, 0xaf, 0xbc, 0xfd, 0x86, 0xf3, 0x17, 0xcb,
-  0x62, 0x5c, 0x8b, 0xc1, 0x18, 0xf6, 0xbf, 0x05, 0x87, 0x05, 0x86, 0xac,
-  0xc9, 0xff, 0x63, 0x16, 0xfb, 0x4f, 0x4e, 0xa7, 0xdf, 0x88, 0xc5, 0x4e,
-  0x8a, 0xab, 0xf5, 0x1b, 0x38, 0x4c, 0x61, 0x8d, 0xaf, 0x64, 0xb1, 0x0f,
-  0x0c, 0x41, 0x79, 0x32, 0x83, 0x1f, 0x86, 0xc4, 0xa3, 0xab, 0x75, 0x9c,
-  0x56, 0x1e, 0x94, 0xf1, 0xca, 0x2a, 0xd3, 0x85, 0x45, 0x55, 0x87, 0xd2,
-  0x95, 0x2a, 0x85, 0x93, 0xb3, 0xda, 0xab, 0x02, 0xeb, 0x8c, 0xe8, 0x86,
-  0xdf, 0xc5, 0x30, 0x02, 0x45, 0x4f, 0xf9, 0x5b, 0x4b, 0x33, 0x5a, 0xeb,
-  0x1f, 0x57, 0xfa, 0x5e, 0x2b, 0xd0, 0x2f, 0x8e, 0x5b, 0x3d, 0xf9, 0xa9,
-  0x94, 0xe2, 0xe2, 0xd2, 0xfb, 0xc9, 0xf3, 0x99, 0x0d, 0x89, 0x51, 0xaa,
-  0x6a, 0x59, 0xc7, 0x55, 0xa0, 0x8b, 0x8a, 0x55, 0x4e, 0xbe, 0xa7, 0xf1,
-  0x00, 0x6f, 0xcc, 0xe5, 0x6c, 0x5e, 0x58, 0xd0, 0xea, 0x1b, 0xf8, 0xfb,
-  0x1a, 0x0f, 0x74, 0xc2, 0xd6, 0x36, 0xf6, 0x23, 0x0f, 0x73, 0x72, 0xf8,
-  0x16, 0x52, 0xa4, 0x38, 0xd5, 0x8a, 0x53, 0x6c, 0xf8, 0x4e, 0xb4, 0x3b,
-  0xe6, 0xf5, 0xcb, 0xbb, 0x67, 0xbe, 0x79, 0x95, 0xa1, 0x4b, 0x5f, 0xdc,
-  0xb2, 0xcb, 0x73, 0x6e, 0x4d, 0x96, 0x76, 0xe1, 0x3a, 0x5e, 0x53, 0xaa,
-  0x8c, 0x2c, 0xab, 0x68, 0x51, 0x6f, 0x92, 0x16, 0x6a, 0x73, 0xb3, 0x2c,
-  0x83, 0xd8, 0x32, 0x7b, 0xd7, 0x4d, 0x52, 0x3c, 0x33, 0xbe, 0xca, 0x07,
-  0x2d, 0xca, 0xdb, 0x78, 0x9e, 0x0b, 0x17, 0x4d, 0x24, 0x79, 0x17, 0x6c,
-  0x73, 0x8d, 0x29, 0x1b, 0x22, 0x89, 0xb4, 0xb4, 0xb9, 0x45, 0x15, 0x34,
-  0xb9, 0x60, 0xb5, 0x3f, 0x30, 0x2b, 0xb6, 0x5d, 0xda, 0x38, 0x6b, 0x04,
-  0x76, 0x59, 0x4a, 0x03, 0x7b, 0xe0, 0x07, 0xd5, 0x42, 0xe9, 0x6a, 0x48,
-  0x75, 0x7d, 0x8e, 0xe4, 0xa5, 0x7c, 0x0a, 0x73, 0xf2, 0x6f, 0x25, 0xcf,
-  0x2e, 0x8e, 0x5e, 0x54, 0x87, 0x91, 0x8f, 0xc4, 0xcd, 0x81, 0x60, 0x62,
-  0x26, 0xc5, 0xdf, 0xe5, 0x7d, 0x82, 0x87, 0xea, 0xbe, 0xa8, 0x78, 0x5f,
-  0x6e, 0xbb, 0xca, 0x63, 0x9d, 0x79, 0x64, 0x19, 0x23, 0x21, 0xab, 0xa8,
-  0x87, 0x05, 0x04, 0x06, 0x16, 0x7b, 0x6d, 0x80, 0xdd, 0xc0, 0x65, 0xe8,
-  0xd9, 0xe4, 0xc1, 0xd6, 0x62, 0xd9, 0xca, 0xa9, 0x1d, 0x7e, 0xd3, 0x0b,
-  0x48, 0x73, 0x72, 0x4b, 0xe9, 0xbc, 0x22, 0xfe, 0x55, 0x5a, 0xc0, 0x8c,
-  0xfb, 0x5a, 0x06, 0xf7, 0x77, 0x41, 0xdb, 0xd5, 0xef, 0xf2, 0x2b, 0x16,
-  0xb3, 0xb7, 0x60, 0xd7, 0xc1, 0x66, 0x0b, 0x51, 0x30, 0x6a, 0xc5, 0x6e,
-  0xbf, 0xe8, 0x58, 0xd0, 0xac, 0x73, 0x31, 0x01, 0x15, 0x77, 0x11, 0xaf,
-  0x61, 0xb6, 0xaf, 0xcb, 0xa9, 0x06, 0xa9, 0x50, 0xe4, 0xda, 0xa2, 0xce,
-  0x83, 0xf1, 0xb1, 0xac, 0x97, 0xd0, 0xa5, 0x36, 0xef, 0xa2, 0x6d, 0xcc,
-  0x15, 0x4b, 0x98, 0x43, 0xc2, 0x50, 0x1d, 0x77, 0x34, 0xde, 0x7f, 0x5f,
-  0xbf, 0xa5, 0xce, 0x1c, 0x4f, 0x94, 0xb1, 0x4d, 0xdc, 0xf6, 0x4b, 0xf1,
-  0x4f, 0x1b, 0xf4, 0x24, 0xcb, 0x8e, 0x6a, 0x6d, 0x1b, 0xdd, 0xf5, 0x51,
-  0xca, 0x6f, 0x58, 0x37, 0x80, 0x65, 0x65, 0x5f, 0x05, 0x57, 0xf2, 0xee,
-  0x67, 0x3e, 0x70, 0x60, 0xd3, 0x0f, 0x18, 0x4a, 0x80, 0x6d, 0x26, 0xa2,
-  0xfa, 0x78, 0xf1, 0xba, 0x03, 0x2a, 0x97, 0x5d, 0xb7, 0xfd, 0xfc, 0x0b,
-  0xeb, 0x05, 0x3e, 0x7d, 0xde, 0x4c, 0x48, 0x0b, 0xf1, 0xaa, 0x5c, 0x06,
-  0x0a, 0x13, 0x82, 0x0f, 0x24, 0x92, 0x45, 0x88, 0x01, 0x93, 0x7a, 0x07,
-  0xa7, 0x59, 0x34, 0xb3, 0x04, 0xdf, 0x22, 0xbb, 0xfd, 0xe6, 0x22, 0xb9,
-  0x5a, 0x0e, 0x97, 0x1d, 0x55, 0x9b, 0xf8, 0x61, 0x37, 0x4a, 0xa7, 0x81,
-  0xae, 0x35, 0xf9, 0x52, 0x91, 0x2a, 0xb0, 0xc9, 0x91, 0x8f, 0x4d, 0xe2,
-  0x41, 0xeb, 0x45, 0x83, 0xb2, 0xc4, 0x1f, 0x93, 0x67, 0x7b, 0xfd, 0x54,
-  0x9b, 0x42, 0x7a, 0x80, 0x29, 0x0d, 0xa8, 0x78, 0x69, 0x0a, 0xe6, 0x19,
-  0x1b, 0x0e, 0x1d, 0xd7, 0x5a, 0x3a, 0x95, 0x49, 0xcc, 0x4c, 0x72, 0x3e,
-  0x5d, 0xf2, 0x32, 0x87, 0xa4, 0x9e, 0x8a, 0x5e, 0xdf, 0x1f, 0x2a, 0x0f,
-  0xbd, 0x6e, 0x9a, 0x29, 0xab, 0x1c, 0x66, 0x47, 0x3d, 0x82, 0x9b, 0x0b,
-  0xdf, 0x5d, 0x99, 0x37, 0x98, 0x1f, 0xcb, 0x5a, 0xc3, 0x68, 0xce, 0xf4,
-  0x5f, 0xd6, 0x17, 0x0e, 0xb1, 0x70, 0xb9, 0x95, 0x6d, 0xdb, 0xa5, 0x0b,
-  0x38, 0x99, 0x3b, 0xc8, 0x74, 0x67, 0x6b, 0x45, 0x1a, 0x40, 0xd5, 0xc9,
-  0x94, 0x52, 0xc6, 0x51, 0xfd, 0x65, 0x22, 0xa6, 0x7b, 0x08, 0xcd, 0x15,
-  0xb4, 0x7b, 0x25, 0xcb, 0x55, 0x0a, 0x17, 0xe4, 0xe9, 0x1b, 0xe8, 0xea,
-  0x7b, 0x37, 0xea, 0xa9, 0x90, 0xdf, 0x13, 0xb0, 0x21, 0x15, 0x56, 0xf9,
-  0xc3, 0x8a, 0xb1, 0xda, 0xb5, 0x6c, 0x67, 0xce, 0x7f, 0x06, 0x5b, 0xb9,
-  0xf2, 0x94, 0xa4, 0x80, 0x80, 0x07, 0x7f, 0x4d, 0x42, 0xbe, 0xee, 0x58,
-  0x2a, 0x3f, 0xc3, 0xc5, 0x1b, 0x34, 0x3b, 0x12, 0x52, 0xb1, 0xab, 0xea,
-  0xfb, 0x62, 0x2a, 0x19, 0xb3, 0x78, 0x71, 0x5d, 0x4e, 0x6d, 0x4f, 0x49,
-  0x25, 0x0a, 0x1e, 0xcc, 0x19, 0x9d, 0x4f, 0x7d, 0x4e, 0xd2, 0x70, 0xed,
-  0x5b, 0x7d, 0xa2, 0x5a, 0xb6, 0xae, 0x78, 0x26, 0xec, 0x98, 0x01, 0x7d,
-  0xca, 0x63, 0x92, 0xf8, 0x3e, 0xcb, 0x62, 0x04, 0x82, 0x81, 0x1c, 0xbd,
-  0x3b, 0xcb, 0x1f, 0x85, 0x65, 0xed, 0x55, 0x1b, 0x28, 0x1b, 0x83, 0xf9,
-  0xad, 0x85, 0xf2, 0xcb, 0x24, 0xea, 0x3b, 0x08, 0x3c, 0xd9, 0x42, 0x99,
-  0x28, 0xbc, 0x3f, 0x82, 0xbf, 0xf7, 0x22, 0xe5, 0x0e, 0xbf, 0xac, 0xe7,
-  0xed, 0xcd, 0xc5, 0x39, 0x91, 0x17, 0x26, 0x65, 0x51, 0xc3, 0x96, 0x3c,
-  0xf2, 0x0c, 0xf4, 0xc4, 0x5a, 0xf8, 0xb2, 0x2b, 0xd0, 0x83, 0xbf, 0x5c,
-  0x28, 0x72, 0x38, 0x56, 0xed, 0xfa, 0xf5, 0xe7, 0x6a, 0x6c, 0xad, 0x56,
-  0xe9, 0x15, 0xe8, 0xae, 0x2a, 0x3b, 0x59, 0xda, 0x28, 0x5e, 0xa5, 0xeb,
-  0x27, 0xe2, 0x6e, 0x8c, 0x42, 0x8f, 0x48, 0x1b, 0xd3, 0x15, 0x1f, 0x85,
-  0x2e, 0x55, 0xc1, 0x5a, 0x78, 0x8e, 0x2a, 0x7f, 0xfe, 0xe7, 0x20, 0xf5,
-  0xd3, 0x80, 0x1e, 0x8a, 0x93, 0xc9, 0xf8, 0x92, 0x10, 0x19, 0xb2, 0x33,
-  0x9d, 0x51, 0x7c, 0xd0, 0xe5, 0x65, 0xbf, 0xfb, 0xaf, 0x83, 0xee, 0x94,
-  0x3a, 0x1e, 0x7b, 0xbf, 0xea, 0x80, 0x3d, 0x5a, 0x1e, 0xb1, 0x75, 0x33,
-  0x68, 0xe8, 0x98, 0xec, 0x37, 0x0e, 0xa5, 0x88, 0x3c, 0xf0, 0xfc, 0x3b,
-  0xde, 0x25, 0xbb, 0xe8, 0x6f, 0xd0, 0xd0, 0xdf, 0x10, 0x37, 0xbe, 0x0e,
-  0x4e, 0xfe, 0xb9, 0x80, 0xdd, 0xef, 0xf8, 0x81, 0xbd, 0x3a, 0x06, 0x9f,
-  0xf2, 0x02, 0xf6, 0xd4, 0x38, 0xbe, 0xc6, 0xdb, 0x27, 0xec, 0x4d, 0x5e,
-  0x32, 0xc1, 0x1f, 0xb7, 0xf0, 0xfd, 0xee, 0xbd, 0x39, 0x40, 0x13, 0x2f,
-  0x29, 0x5b, 0xf2, 0x29, 0x4d, 0xf6, 0x51, 0x7d, 0xf9, 0xbb, 0x21, 0x9e,
-  0x3a, 0x3a, 0x78, 0x66, 0x59, 0x28, 0x8d, 0xf0, 0x4e, 0x23, 0x76, 0x0f,
-  0xba, 0xbc, 0xba, 0xc0, 0x49, 0x78, 0xf6, 0xb5, 0x8f, 0x47, 0x50, 0x97,
-  0x6c, 0x41, 0x20, 0x9d, 0x99, 0x1e, 0x13, 0xce, 0x2c, 0xcb, 0x92, 0x40,
-  0xe4, 0x6b, 0x5e, 0x22, 0x85, 0x87, 0xa7, 0xbd, 0x59, 0xa3, 0x54, 0x63,
-  0x60, 0xfe, 0x70, 0xb3, 0xc5, 0x9f, 0x99, 0xdc, 0x53, 0xde, 0x8e, 0x54,
-  0x5f, 0x59, 0xc7, 0x57, 0xe3, 0x5f, 0x6a, 0x65, 0xe2, 0xb5, 0xf1, 0xd8,
-  0xf1, 0xfc, 0x45, 0xc2, 0x6a, 0x94, 0x0a, 0xeb, 0x1e, 0x2e, 0x2f, 0xbc,
-  0x90, 0xbc, 0xb3, 0xfb, 0xea, 0xe8, 0xf5, 0x89, 0x16, 0x4b, 0x32, 0x3e,
-  0x21, 0xaf, 0xbd, 0x11, 0xbf, 0x65, 0x6f, 0xc5, 0xca, 0xc3, 0xb1, 0x85,
-  0xa7, 0x63, 0xb7, 0xec, 0x6d, 0xa5, 0x08, 0x5f, 0xe8, 0xc0, 0xbb, 0xac,
-  0x2d, 0x36, 0xa1, 0x7d, 0xc2, 0x9f, 0xa4, 0x52, 0x3b, 0x34, 0x3e, 0xe4,
-  0x9a, 0xf5, 0x28, 0x9f, 0xad, 0x7f, 0x13, 0x38, 0x49, 0x72, 0x73, 0xf3,
-  0xd7, 0x3f, 0xdf, 0x6c, 0x6f, 0xf7, 0x3a, 0xea, 0x2b, 0xf6, 0xd9, 0x2f,
-  0x1d, 0x92, 0xbd, 0x93, 0x55, 0x84, 0xb2, 0x14, 0xb8, 0xed, 0xf6, 0x7a,
-  0x1a, 0xb5, 0xee, 0xad, 0x64, 0xea, 0x78, 0xf8, 0x4c, 0x27, 0x3e, 0x8a,
-  0x06, 0x93, 0x40, 0x98, 0x1b, 0x16, 0x3a, 0x10, 0xff, 0xd9, 0x3b, 0xed,
-  0x0e, 0x2b, 0x43, 0x8a, 0x0a, 0xa2, 0xb0, 0x13, 0x8e, 0xa9, 0x7e, 0xb3,
-  0x22, 0xbe, 0x18, 0x87, 0x3d, 0xb3, 0x59, 0xdb, 0xd2, 0xe6, 0x84, 0xbd,
-  0xc8, 0x25, 0xbb, 0xd1, 0x1e, 0x9a, 0x56, 0x84, 0x9e, 0xc2, 0x23, 0xfd,
-  0xec, 0x82, 0x39, 0x85, 0x59, 0xf2, 0x87, 0xbb, 0xed, 0x5d, 0x03, 0xf1,
-  0xc2, 0x28, 0xb5, 0xd8, 0x89, 0x04, 0x73, 0x0e, 0xbf, 0x0a, 0x7d, 0x8a,
-  0xcf, 0xe8, 0xb1, 0xc7, 0x5b, 0xb3, 0x8e, 0x34, 0xb5, 0xa1, 0xb1, 0xc7,
-  0xf6, 0xd1, 0xee, 0xe9, 0xde, 0xe9, 0x3a, 0xec, 0x51, 0xa4, 0x25, 0x5b,
-  0x7b, 0x8c, 0x98, 0xdb, 0xbb, 0xbb, 0x1d, 0x92, 0xff, 0x05, 0x03, 0x58,
-  0x49, 0x52, 0x05, 0xf5, 0xef, 0xe4, 0x7b, 0x61, 0x5f, 0x2a, 0x18, 0x63,
-  0x7d, 0x4e, 0x58, 0x8b, 0xb5, 0x75, 0xc6, 0x56, 0xc8, 0xfe, 0x6a, 0xbf,
-  0xb4, 0x74, 0xd9, 0x53, 0x82, 0x7b, 0xeb, 0x4f, 0x36, 0x93, 0x0d, 0x5d,
-  0x55, 0x38, 0x1c, 0x08, 0xd1, 0xe1, 0x83, 0xa8, 0xd4, 0xae, 0xbe, 0x07,
-  0x9d, 0x05, 0xfc, 0x3e, 0x68, 0xe4, 0x13, 0xd7, 0x20, 0x72, 0xba, 0x0e,
-  0x8f, 0xa5, 0xc7, 0xec, 0xa0, 0xcb, 0xdb, 0x1b, 0xa0, 0x29, 0xd7, 0xdf,
-  0x1b, 0x60, 0x1d, 0x42, 0xd1, 0x8a, 0xc6, 0xd9, 0x8d, 0xf7, 0xa6, 0xe6,
-  0xfc, 0xba, 0xef, 0x1a, 0x08, 0xca, 0x4d, 0xf7, 0xc6, 0xf6, 0xef, 0x3e,
-  0x10, 0x61, 0xb0, 0xd6, 0x00, 0x51, 0xdf, 0x15, 0x30, 0x11, 0x44, 0xa8,
-  0x65, 0xad, 0x62, 0xab, 0xdd, 0x38, 0x44, 0x17, 0xb5, 0x06, 0xf6, 0xa0,
-  0x0b, 0xda, 0x46, 0xa8, 0x9e, 0x5c, 0xfd, 0xf0, 0x3e, 0xe4, 0x3b, 0x0a,
-  0x87, 0x79, 0x25, 0x51, 0xfc, 0x14, 0x8a, 0x89, 0xe9, 0x21, 0xa6, 0x6d,
-  0x54, 0x9e, 0xc1, 0xc5, 0x51, 0xa1, 0x7f, 0x24, 0x5e, 0x5e, 0xe4, 0x26,
-  0x8d, 0x0a, 0x14, 0x72, 0xa0, 0x26, 0x64, 0x1a, 0x99, 0xe2, 0x39, 0x70,
-  0xc4, 0xab, 0x91, 0xec, 0xb0, 0x53, 0xbf, 0xdb, 0x9d, 0xf8, 0xe9, 0x74,
-  0x31, 0xc2, 0x77, 0xe8, 0xbb, 0x47, 0xbf, 0x2e, 0x62, 0x7a, 0x3d, 0xc7,
-  0xac, 0x33, 0xd8, 0x1c, 0x2f, 0xbc, 0x21, 0xbb, 0xda, 0xd3, 0xe3, 0x16,
-  0x02, 0x6a, 0xf9, 0xee, 0x7b, 0x9a, 0xc6, 0xd1, 0x1b, 0x07, 0xcc, 0xb9,
-  0x06, 0x01, 0xab, 0x7b, 0x42, 0xd3, 0x41, 0xe3, 0xd3, 0x28, 0x70, 0xc2,
-  0xdb, 0xc6, 0x21, 0xfb, 0x7c, 0xd0, 0x75, 0x6a, 0xba, 0x0a, 0x40, 0xce,
-  0x80, 0x50, 0xa0, 0x89, 0x2d, 0x7a, 0xf5, 0xa3, 0x2e, 0x87, 0x6e, 0x21,
-  0x78, 0x4b, 0x1a, 0x11, 0xdd, 0x32, 0xf4, 0x13, 0xf1, 0x7e, 0x02, 0xb3,
-  0x30, 0x9f, 0xa8, 0x97, 0x1f, 0x7a, 0xd6, 0x3c, 0x8e, 0x26, 0xb1, 0x33,
-  0x83, 0xe9, 0x9e, 0x74, 0xa1, 0xe8, 0x82, 0x9d, 0xbb, 0x49, 0x0c, 0xfd,
-  0x8b, 0x92, 0xbc, 0x67, 0xc9, 0x1a, 0x2a, 0x27, 0x29, 0x73, 0x25, 0x44,
-  0x54, 0xe3, 0x70, 0xc7, 0xde, 0xb6, 0x77, 0xf2, 0x2a, 0xc0, 0x83, 0x60,
-  0x0b, 0x89, 0x1f, 0xa7, 0xe9, 0x2c, 0x38, 0xfc, 0x5f, 0xcc, 0x2f, 0xf5,
-  0x2d, 0xff, 0x8a, 0x00, 0x00
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xbc, 0x3b,
+  0xfb, 0x53, 0x1b, 0x39, 0xd2, 0xbf, 0x7f, 0x55, 0xf7, 0x3f, 0x28, 0xde,
+  0xdb, 0xc5, 0x0e, 0x9e, 0xf1, 0x03, 0x4c, 0x38, 0x83, 0xb9, 0x73, 0x8c,
+  0x49, 0xa8, 0x98, 0x47, 0x61, 0x73, 0xd9, 0xfd, 0x52, 0x14, 0x19, 0x7b,
+  0x64, 0x5b, 0xc7, 0x3c, 0x7c, 0xf3, 0xc0, 0xb0, 0xd9, 0xfc, 0xef, 0xd7,
+  0x2d, 0x69, 0x66, 0x34, 0x2f, 0x63, 0x76, 0xf7, 0x8e, 0x54, 0x60, 0x3c,
+  0x6a, 0x75, 0xb7, 0xfa, 0xdd, 0x92, 0x7c, 0xfc, 0xe6, 0xf4, 0x6a, 0x30,
+  0xf9, 0xe5, 0x7a, 0x48, 0x96, 0x81, 0x6d, 0x9d, 0xfc, 0xe5, 0xff, 0x8e,
+  0xe5, 0x5f, 0x7c, 0xa2, 0x86, 0x09, 0x4f, 0x84, 0x1c, 0xfb, 0x33, 0x8f,
+  0xad, 0x02, 0xe2, 0x7b, 0xb3, 0x5e, 0x65, 0x19, 0x04, 0x2b, 0xbf, 0xdb,
+  0x68, 0xcc, 0x4c, 0x47, 0xff, 0x97, 0x6f, 0x52, 0x8b, 0x3d, 0x7a, 0xba,
+  0x43, 0x83, 0x86, 0xb3, 0xb2, 0x1b, 0x4f, 0x01, 0xf5, 0xec, 0x7f, 0x74,
+  0xf4, 0x3d, 0xbd, 0xd9, 0xb0, 0xd8, 0x54, 0x7c, 0xd6, 0x6d, 0x86, 0xa0,
+  0x95, 0x93, 0xe3, 0x86, 0x40, 0xf4, 0x7b, 0x90, 0x6a, 0x86, 0x69, 0xba,
+  0x8e, 0x36, 0x67, 0xc1, 0x3f, 0x9a, 0xfa, 0xa1, 0x8a, 0x3e, 0x19, 0x29,
+  0x22, 0x24, 0x48, 0x05, 0xcf, 0x16, 0xe5, 0x54, 0x09, 0x69, 0xbc, 0x25,
+  0xe7, 0x8e, 0xc5, 0x1c, 0x6a, 0x12, 0xdb, 0x35, 0xa9, 0xe7, 0xe8, 0x33,
+  0xdf, 0x27, 0x6f, 0x1b, 0x62, 0x14, 0x57, 0x5f, 0x17, 0x8f, 0xcc, 0x59,
+  0x85, 0xc1, 0x97, 0xe0, 0x79, 0x45, 0x7b, 0x7e, 0x38, 0xb5, 0x59, 0x70,
+  0x27, 0x07, 0x4c, 0xf6, 0xa8, 0xcf, 0x99, 0x63, 0x12, 0xa3, 0x6b, 0xcc,
+  0x02, 0xf6, 0x48, 0xc9, 0x37, 0x31, 0x40, 0xc8, 0xd4, 0x98, 0x3d, 0x2c,
+  0x3c, 0x37, 0x74, 0x4c, 0x6d, 0xe6, 0x5a, 0xae, 0xd7, 0x25, 0x3f, 0xec,
+  0xf7, 0xff, 0xd6, 0x1c, 0xb6, 0x8f, 0x22, 0x88, 0xe8, 0xf5, 0x9c, 0xff,
+  0xc8, 0xd7, 0xdf, 0x05, 0x9f, 0x84, 0x18, 0x7f, 0x22, 0xaa, 0xee, 0xd2,
+  0x7d, 0xa4, 0xde, 0x46, 0x84, 0x7b, 0x9d, 0x77, 0xfd, 0xf7, 0xa7, 0x5b,
+  0x22, 0xfc, 0xc1, 0x74, 0x67, 0xfe, 0x6b, 0xf8, 0x9b, 0xba, 0x1e, 0xc8,
+  0x57, 0x5b, 0x33, 0x33, 0x58, 0x76, 0x49, 0xb0, 0x64, 0xb3, 0x87, 0xcc,
+  0x58, 0x97, 0xac, 0x97, 0x2c, 0xa0, 0xf1, 0xdb, 0xb9, 0xeb, 0x04, 0xda,
+  0xdc, 0xb0, 0x99, 0xf5, 0xdc, 0x25, 0x03, 0x37, 0xf4, 0x18, 0x2c, 0xe0,
+  0x92, 0xae, 0xd3, 0x00, 0x3e, 0xfb, 0x95, 0x76, 0x49, 0xbb, 0xb9, 0x7a,
+  0x8a, 0xdf, 0xaf, 0xc0, 0x06, 0x98, 0xb3, 0xe8, 0x92, 0xd6, 0xea, 0x09,
+  0xff, 0x67, 0x79, 0x57, 0x74, 0x39, 0x0d, 0x83, 0xc0, 0x75, 0xee, 0x36,
+  0x2d, 0x64, 0x6a, 0x19, 0x39, 0x56, 0xb5, 0x42, 0xe1, 0xc4, 0xa3, 0xdc,
+  0xc2, 0xba, 0xc4, 0x77, 0x2d, 0x66, 0x96, 0x0b, 0xc0, 0xd9, 0x2c, 0x6a,
+  0x78, 0x1d, 0x7a, 0x3e, 0xbe, 0x5f, 0xb9, 0xcc, 0x01, 0xdb, 0xfe, 0x93,
+  0x05, 0xb3, 0xaf, 0x0c, 0xd8, 0x86, 0xb7, 0x60, 0x0e, 0x40, 0x6f, 0x14,
+  0x56, 0x40, 0x9f, 0x82, 0xdf, 0x2d, 0xaa, 0xa9, 0x15, 0xd2, 0xff, 0x92,
+  0x9c, 0xfe, 0x6c, 0x43, 0x21, 0x04, 0x57, 0xaa, 0x99, 0x74, 0xe6, 0x7a,
+  0x46, 0xc0, 0x5c, 0x10, 0x8c, 0xe3, 0x3a, 0x34, 0x2b, 0x99, 0xa9, 0x6b,
+  0x3e, 0xff, 0x61, 0x0f, 0xfd, 0x03, 0xdc, 0x47, 0x4a, 0x6b, 0xe6, 0xd7,
+  0x93, 0x82, 0x33, 0x99, 0xbf, 0xb2, 0x0c, 0x40, 0x3e, 0xb7, 0x68, 0xf2,
+  0x16, 0x3f, 0x68, 0x26, 0xf3, 0xe8, 0x4c, 0xac, 0x10, 0xb8, 0x0b, 0xed,
+  0x44, 0xd4, 0x86, 0xc5, 0x16, 0x8e, 0x06, 0xee, 0x68, 0xfb, 0x30, 0x46,
+  0x53, 0xf6, 0x07, 0x81, 0x55, 0x5b, 0x52, 0xb6, 0x58, 0x06, 0x20, 0xb9,
+  0x66, 0xf3, 0x71, 0xa9, 0xe8, 0xee, 0x09, 0x39, 0xe5, 0x3c, 0x48, 0x3d,
+  0xc2, 0xab, 0x5c, 0xec, 0x58, 0x19, 0x0e, 0xb5, 0x36, 0x8a, 0xae, 0xd9,
+  0x6c, 0xe6, 0xa2, 0x03, 0x18, 0xa7, 0x30, 0x95, 0x02, 0xb7, 0xdb, 0x40,
+  0x36, 0x25, 0xc0, 0xa6, 0xfe, 0xce, 0xa3, 0x76, 0x46, 0x84, 0x00, 0x0c,
+  0x51, 0xc0, 0xee, 0x92, 0xc3, 0x22, 0xdb, 0x38, 0x00, 0xb2, 0xea, 0x80,
+  0x34, 0x4c, 0x58, 0xf8, 0x8f, 0xc9, 0xc2, 0xf0, 0x8f, 0xce, 0x97, 0xa5,
+  0x79, 0xee, 0x3a, 0x59, 0xda, 0x26, 0x31, 0x6e, 0xd0, 0xcb, 0xda, 0x33,
+  0x56, 0x10, 0x0e, 0xe1, 0x77, 0xfc, 0x7e, 0x81, 0x6f, 0x52, 0xfe, 0xa9,
+  0xd0, 0x0c, 0x58, 0x60, 0x29, 0x89, 0x47, 0xb2, 0xd8, 0xd1, 0x3b, 0xf1,
+  0x5a, 0xd3, 0xf0, 0x33, 0x6a, 0x59, 0xaf, 0x64, 0x92, 0xf1, 0x34, 0xa9,
+  0xbd, 0xc6, 0x86, 0x24, 0x1b, 0x6d, 0xfd, 0xb0, 0x84, 0x0d, 0x0b, 0xd2,
+  0xee, 0x26, 0x2b, 0x98, 0xcf, 0xdb, 0xcd, 0x76, 0xd6, 0x10, 0x34, 0xcf,
+  0x30, 0x59, 0x08, 0x9c, 0x76, 0x62, 0x05, 0x48, 0x0b, 0x58, 0x1a, 0xa6,
+  0xbb, 0x06, 0x1d, 0xc3, 0x3f, 0x54, 0x5a, 0x76, 0x7a, 0x6c, 0xb2, 0x6d,
+  0x45, 0x9b, 0xee, 0xca, 0x98, 0xb1, 0xe0, 0x19, 0x2d, 0xa3, 0xd5, 0xc9,
+  0xe9, 0x38, 0x27, 0xef, 0x1f, 0xa0, 0x0c, 0x0a, 0x6c, 0x63, 0xf5, 0xbf,
+  0x33, 0xde, 0x0d, 0x26, 0x6a, 0x1b, 0x4f, 0x5a, 0xde, 0x1a, 0x4b, 0x4d,
+  0x37, 0x5a, 0x02, 0x96, 0x49, 0xcc, 0x31, 0xac, 0x9c, 0xbd, 0xa4, 0x90,
+  0x94, 0x21, 0xff, 0xc3, 0x0b, 0x8a, 0xb9, 0x6b, 0xe6, 0x23, 0x19, 0x31,
+  0xc2, 0xc0, 0x4d, 0x74, 0x03, 0x15, 0xcb, 0xdc, 0x42, 0x95, 0x2e, 0x99,
+  0x69, 0x52, 0x27, 0x1b, 0x47, 0x94, 0xe2, 0x4d, 0x94, 0x96, 0x58, 0xbb,
+  0xf1, 0x72, 0x93, 0x04, 0x2e, 0xa1, 0x8e, 0x1f, 0x7a, 0x14, 0x12, 0x08,
+  0xfc, 0x8f, 0x56, 0xec, 0x51, 0x07, 0xd8, 0xf1, 0xa1, 0xd0, 0xa0, 0x0e,
+  0x1f, 0x59, 0x19, 0x0b, 0x1a, 0x91, 0x23, 0xcc, 0x27, 0xd4, 0x9e, 0x52,
+  0x20, 0x65, 0x82, 0xb9, 0x03, 0x8a, 0x39, 0xf3, 0xec, 0xb5, 0x01, 0x48,
+  0xd6, 0x2c, 0x58, 0xba, 0x61, 0x40, 0x28, 0xd2, 0x41, 0x44, 0x86, 0xef,
+  0xd3, 0xc0, 0xd7, 0xe3, 0x4a, 0x51, 0xe7, 0x0c, 0x24, 0x12, 0x8d, 0x52,
+  0x37, 0x26, 0x92, 0x64, 0xe5, 0xae, 0xcf, 0x84, 0xa3, 0x78, 0xd4, 0x32,
+  0xb0, 0x56, 0x8c, 0x87, 0x42, 0x1f, 0xd3, 0x21, 0xb5, 0xc0, 0x93, 0x52,
+  0xc9, 0x86, 0x10, 0xcd, 0xf6, 0xb5, 0x0d, 0xa3, 0x6b, 0x3a, 0x7d, 0x60,
+  0x41, 0x29, 0x44, 0x2c, 0x2b, 0xc1, 0xa0, 0x3e, 0x77, 0x67, 0xa1, 0x5f,
+  0x57, 0x5f, 0x75, 0xf9, 0xab, 0x84, 0x73, 0x58, 0x26, 0x8a, 0x74, 0x13,
+  0x16, 0xf9, 0x07, 0x72, 0x80, 0xb5, 0x42, 0x69, 0x7e, 0xcb, 0x2f, 0xd0,
+  0x98, 0x82, 0x6d, 0x84, 0x4a, 0x31, 0x17, 0xb8, 0x2b, 0x55, 0xe3, 0xbf,
+  0x6a, 0x50, 0x32, 0xd3, 0x27, 0x70, 0xe2, 0x6d, 0x48, 0x68, 0x28, 0x46,
+  0xd0, 0x83, 0x52, 0x10, 0x17, 0x58, 0x51, 0x64, 0x99, 0xcd, 0x4d, 0x19,
+  0xb2, 0x9c, 0xc3, 0x24, 0x12, 0xc4, 0xaf, 0x2c, 0x3a, 0x07, 0x71, 0x6a,
+  0x7f, 0x83, 0x1f, 0x25, 0x69, 0x64, 0x96, 0x22, 0x9d, 0x24, 0x1f, 0x67,
+  0x0a, 0x56, 0xab, 0x29, 0x21, 0x06, 0x6b, 0x5d, 0xcd, 0x07, 0xa2, 0x5c,
+  0xd6, 0xa9, 0x58, 0x5f, 0x62, 0xf8, 0x04, 0xec, 0x46, 0xa4, 0xb1, 0x4d,
+  0xba, 0x99, 0xb9, 0x76, 0xb4, 0x4a, 0xed, 0x91, 0xd1, 0x75, 0x51, 0xa8,
+  0xca, 0x04, 0xa9, 0x28, 0x70, 0x9d, 0x9d, 0x9d, 0xe5, 0x03, 0x7f, 0xca,
+  0xde, 0x36, 0xc8, 0x6f, 0xd3, 0x82, 0x62, 0x01, 0xb4, 0xb6, 0xe5, 0x5a,
+  0xcf, 0x36, 0x53, 0x31, 0x3f, 0x53, 0xcb, 0x8d, 0x8b, 0xcc, 0x12, 0xab,
+  0x41, 0x04, 0x2b, 0xd7, 0x0b, 0xb6, 0x8e, 0xd2, 0x91, 0xc0, 0x35, 0xc0,
+  0x0f, 0xcd, 0xa2, 0x6b, 0x59, 0xb9, 0x22, 0xdc, 0xa4, 0x73, 0x23, 0xb4,
+  0x82, 0x6d, 0x24, 0xe1, 0x65, 0xf5, 0x2f, 0xec, 0xa8, 0x59, 0x66, 0x41,
+  0x51, 0x6c, 0x6f, 0x6e, 0x5e, 0x15, 0x30, 0x46, 0x21, 0x6c, 0x7d, 0x7b,
+  0x31, 0x9c, 0x6c, 0x9e, 0x3f, 0x33, 0x9c, 0x47, 0x63, 0x3b, 0xa7, 0xdd,
+  0xc8, 0x77, 0x39, 0x15, 0x10, 0x9f, 0x96, 0xf6, 0xd6, 0x47, 0xe6, 0xb3,
+  0x29, 0xb3, 0xb8, 0x7b, 0x15, 0xc7, 0x72, 0x39, 0x7b, 0xb6, 0x34, 0x3c,
+  0xcd, 0xa6, 0x06, 0x86, 0x6e, 0x0d, 0xc2, 0x99, 0x0d, 0xd5, 0x48, 0x81,
+  0x0d, 0xc8, 0x62, 0x44, 0x35, 0x85, 0x0d, 0x44, 0x5e, 0x13, 0x98, 0x8a,
+  0x5d, 0x9e, 0x53, 0x8b, 0xfc, 0xda, 0x71, 0x3d, 0xdb, 0xb0, 0x4a, 0x02,
+  0x2c, 0x75, 0x8c, 0xa9, 0x45, 0x35, 0xdb, 0x85, 0x88, 0xac, 0xd1, 0x47,
+  0x60, 0xdf, 0xcf, 0x67, 0x85, 0xb4, 0x2d, 0x65, 0x51, 0x48, 0x49, 0x70,
+  0x58, 0x4d, 0xf6, 0x7e, 0xf5, 0x22, 0x51, 0xa7, 0x41, 0xf2, 0x64, 0xd2,
+  0x7d, 0x63, 0x96, 0x8c, 0x28, 0xd6, 0x64, 0xd2, 0xd0, 0x33, 0x59, 0x20,
+  0x42, 0x01, 0xca, 0xf4, 0xa1, 0xae, 0x62, 0xde, 0x66, 0xa5, 0x1b, 0xb3,
+  0x19, 0xf5, 0x63, 0xe9, 0x3b, 0x6e, 0x50, 0xd5, 0x4d, 0x3a, 0x0d, 0x17,
+  0xb5, 0x42, 0xbe, 0x6d, 0x80, 0x85, 0xbc, 0xfb, 0xc7, 0x4d, 0x30, 0xef,
+  0x3a, 0x05, 0xce, 0x97, 0xc4, 0x9e, 0x5c, 0xc0, 0x0b, 0x3c, 0xc3, 0x81,
+  0x80, 0x05, 0x55, 0x81, 0xea, 0xd7, 0x5c, 0x68, 0x52, 0x77, 0xdb, 0xa4,
+  0xc1, 0xd4, 0xe2, 0xb5, 0x00, 0x9c, 0x4c, 0x95, 0x00, 0x79, 0xdb, 0xed,
+  0x0a, 0x19, 0xc3, 0x02, 0x15, 0x01, 0x97, 0x71, 0xb0, 0x35, 0x91, 0x04,
+  0x57, 0x2a, 0xf9, 0xa7, 0x2a, 0x8e, 0x54, 0x4c, 0x5e, 0x79, 0xa5, 0x0b,
+  0xb1, 0x20, 0x78, 0x68, 0x1e, 0x5d, 0xa4, 0x58, 0x7c, 0x51, 0x2b, 0xdc,
+  0x4b, 0x0a, 0x3a, 0x23, 0xe5, 0x55, 0x5c, 0x73, 0xab, 0x25, 0xf7, 0x0b,
+  0x65, 0x9d, 0x5c, 0xb1, 0xc9, 0x94, 0x7a, 0x2a, 0x4e, 0xce, 0x2d, 0xf2,
+  0x86, 0xd9, 0x18, 0xdb, 0x8d, 0x32, 0x89, 0x69, 0x21, 0xd6, 0x78, 0xdc,
+  0x63, 0x5b, 0x09, 0x82, 0x5c, 0x47, 0x1f, 0x43, 0xbd, 0x88, 0xa5, 0xbd,
+  0x01, 0x8b, 0xe9, 0x86, 0xe0, 0xee, 0xaf, 0x40, 0xb6, 0xb7, 0x01, 0xd9,
+  0xda, 0x78, 0x7c, 0x7e, 0x05, 0xaa, 0xfd, 0x8d, 0x7c, 0x05, 0x01, 0x54,
+  0xb1, 0xdb, 0x23, 0xeb, 0x6c, 0x42, 0x66, 0xf8, 0xcb, 0x2d, 0x90, 0xa1,
+  0x5e, 0x71, 0x78, 0x03, 0xa6, 0x08, 0xe4, 0x05, 0x0c, 0xaf, 0x52, 0x64,
+  0x4c, 0x76, 0x5b, 0xfe, 0x5e, 0xa5, 0xe0, 0x18, 0xfb, 0x96, 0x9a, 0x2e,
+  0x25, 0xb2, 0xb7, 0x0d, 0x91, 0xad, 0x2c, 0xa0, 0x94, 0xc4, 0xfe, 0x76,
+  0xeb, 0xd8, 0xca, 0x32, 0x4a, 0x89, 0x74, 0xb6, 0x22, 0xb2, 0x9d, 0xc5,
+  0xf8, 0x81, 0xc7, 0x1e, 0x68, 0xb0, 0x84, 0xc2, 0x6c, 0xb1, 0xdc, 0x80,
+  0x97, 0x13, 0x96, 0x60, 0x65, 0xa8, 0x44, 0x71, 0x13, 0xc5, 0x8e, 0x78,
+  0x32, 0x94, 0x7b, 0x4e, 0x60, 0xc0, 0x7c, 0x2f, 0x3f, 0x96, 0x50, 0x8c,
+  0x73, 0xc4, 0xc1, 0xcb, 0x25, 0xc3, 0x9f, 0x41, 0x39, 0x0f, 0x0c, 0x79,
+  0x4d, 0x83, 0xd2, 0x46, 0x4d, 0xe3, 0x31, 0x53, 0xef, 0xca, 0x22, 0x64,
+  0x32, 0x1d, 0x25, 0x8f, 0x55, 0xaf, 0xe6, 0x85, 0x56, 0x21, 0x8e, 0xc3,
+  0xdf, 0x51, 0x0b, 0xe5, 0x52, 0xe9, 0xf6, 0xb9, 0x31, 0xb3, 0xb4, 0x02,
+  0x86, 0xda, 0x47, 0xdb, 0xd4, 0xb1, 0x84, 0x1c, 0x37, 0xa2, 0xf3, 0x1a,
+  0xfe, 0x09, 0x4c, 0xe1, 0x01, 0xe1, 0x7a, 0x15, 0x06, 0xf2, 0xad, 0xc8,
+  0x73, 0x1a, 0x8f, 0xce, 0x7b, 0x15, 0xd3, 0x08, 0x8c, 0x2e, 0xb3, 0xa1,
+  0xb2, 0x68, 0xf8, 0x8f, 0x8b, 0xdd, 0x27, 0xdb, 0xaa, 0x1f, 0xc3, 0x03,
+  0x81, 0x07, 0xc7, 0xef, 0xed, 0xe0, 0xa9, 0x52, 0xb7, 0xd1, 0x58, 0xaf,
+  0xd7, 0xfa, 0x7a, 0x4f, 0x77, 0xbd, 0x45, 0xa3, 0x0d, 0x2d, 0x00, 0x82,
+  0xee, 0x10, 0x14, 0xdd, 0x7b, 0xf7, 0xa9, 0xb7, 0x83, 0x7b, 0x47, 0xad,
+  0x26, 0xff, 0xbf, 0x73, 0x72, 0x8c, 0x1b, 0x5b, 0x22, 0xab, 0xf5, 0x76,
+  0xf0, 0x8d, 0x4c, 0x67, 0xf2, 0xc3, 0x9c, 0x59, 0x56, 0x6f, 0xe7, 0xc7,
+  0xf6, 0x5e, 0xb3, 0xd9, 0x9a, 0xef, 0xcd, 0x77, 0x1a, 0x72, 0x02, 0xa0,
+  0x69, 0x75, 0x76, 0xc8, 0x73, 0x6f, 0xa7, 0x0d, 0x50, 0x72, 0xfa, 0x3b,
+  0x65, 0x76, 0x07, 0x9e, 0x3d, 0x80, 0xda, 0x53, 0x70, 0xd0, 0xce, 0xf4,
+  0x10, 0x91, 0x82, 0x4b, 0xb8, 0x0f, 0x54, 0xa2, 0x8d, 0x3f, 0x6b, 0x12,
+  0x4b, 0x5b, 0x25, 0x82, 0xd8, 0x91, 0x48, 0x27, 0x26, 0x72, 0xa0, 0x10,
+  0xd9, 0x4b, 0x73, 0xd8, 0xc4, 0x99, 0x33, 0xe6, 0xcd, 0x20, 0x86, 0xcd,
+  0x9e, 0xc4, 0xf0, 0x0c, 0x66, 0x1f, 0x00, 0x13, 0x5e, 0x9a, 0x95, 0x3c,
+  0xf0, 0x7e, 0xe7, 0x15, 0xc0, 0x9d, 0xd7, 0x00, 0xbf, 0x7b, 0x91, 0x0d,
+  0x0c, 0x06, 0xb8, 0xda, 0x8e, 0x58, 0xed, 0x3e, 0x82, 0x24, 0x3b, 0xe6,
+  0xbd, 0x1d, 0xdb, 0x75, 0x5c, 0x5e, 0xe0, 0xec, 0x24, 0xfb, 0xbc, 0xa0,
+  0x80, 0x76, 0x81, 0x6c, 0x79, 0x5c, 0x31, 0x9c, 0xd9, 0xd2, 0x05, 0x52,
+  0x36, 0xd4, 0x1e, 0x16, 0xdd, 0x39, 0x39, 0x84, 0xa1, 0xe3, 0x06, 0x0e,
+  0xe1, 0x41, 0xe1, 0xe3, 0xe2, 0x44, 0xda, 0x14, 0x3f, 0xf1, 0xa8, 0xa4,
+  0xcc, 0xa9, 0xa2, 0x1e, 0x55, 0xca, 0x03, 0xc4, 0x0a, 0x14, 0x5f, 0xa8,
+  0x24, 0x36, 0x0b, 0x2a, 0x47, 0xc9, 0xc6, 0xd4, 0x5b, 0x69, 0xdc, 0x6f,
+  0x49, 0xdf, 0x82, 0x20, 0xe0, 0x91, 0x49, 0xb4, 0x05, 0xf5, 0x99, 0x4e,
+  0xc9, 0xc0, 0x62, 0xe0, 0x40, 0x31, 0xc8, 0xb9, 0xbd, 0xf2, 0xc0, 0x81,
+  0x4d, 0x02, 0x4e, 0xec, 0x63, 0x5c, 0xc2, 0xed, 0x26, 0x32, 0xa5, 0x01,
+  0x56, 0xf5, 0xd4, 0xf3, 0x5c, 0x8f, 0x2c, 0x0d, 0xc7, 0x04, 0xd3, 0x5f,
+  0xd4, 0xa1, 0x70, 0x34, 0x29, 0x01, 0xeb, 0x35, 0x1c, 0xf6, 0x2b, 0xf7,
+  0xaf, 0x3a, 0x81, 0x31, 0xe2, 0xb9, 0xd3, 0xd0, 0x0f, 0x1c, 0xa8, 0x11,
+  0x23, 0xb4, 0x72, 0x67, 0x0a, 0xbc, 0xc4, 0x0f, 0x24, 0x17, 0x31, 0x13,
+  0x3d, 0x52, 0x9d, 0x87, 0x8e, 0x28, 0x49, 0xab, 0xb5, 0xc4, 0x3b, 0x1b,
+  0x0d, 0x72, 0xed, 0xb1, 0x47, 0x23, 0xc0, 0x35, 0xe1, 0x6f, 0x8d, 0x50,
+  0x67, 0x66, 0xac, 0xfc, 0x10, 0x1c, 0x13, 0x18, 0x0c, 0x5c, 0x62, 0x3c,
+  0xba, 0xcc, 0x24, 0x0b, 0xcb, 0x9d, 0x02, 0x9e, 0x15, 0xb4, 0x7a, 0x21,
+  0x62, 0x49, 0xca, 0x5a, 0xa4, 0x26, 0xe6, 0xf6, 0x12, 0xbc, 0x50, 0x1b,
+  0x62, 0xb8, 0x08, 0xad, 0xe8, 0x38, 0x55, 0xc2, 0x3a, 0x60, 0xca, 0xd4,
+  0xec, 0x92, 0xb9, 0x61, 0xf9, 0x54, 0x19, 0x72, 0x1d, 0xb9, 0x07, 0x65,
+  0x3c, 0xb2, 0x85, 0x11, 0xb8, 0x9e, 0xee, 0x3a, 0x23, 0x78, 0xa3, 0x80,
+  0xf0, 0xbd, 0xab, 0x2c, 0x4a, 0x70, 0x0d, 0x81, 0xb4, 0x0f, 0xb2, 0xb3,
+  0x57, 0x18, 0xa3, 0x9a, 0xca, 0xb0, 0x6d, 0x3c, 0xdd, 0xe4, 0x21, 0x3a,
+  0x45, 0x08, 0x4e, 0x29, 0x6f, 0x34, 0x31, 0x44, 0x28, 0xc3, 0x2b, 0xc3,
+  0x0f, 0xe8, 0x47, 0xd4, 0x05, 0x6e, 0x34, 0x65, 0x88, 0x3f, 0xd0, 0xe7,
+  0xb2, 0x21, 0x30, 0x77, 0xc3, 0x09, 0x57, 0xe7, 0x18, 0x3d, 0x1f, 0x0d,
+  0xab, 0x9c, 0xef, 0x09, 0xb3, 0x0b, 0xa6, 0x63, 0x81, 0x7f, 0xee, 0x40,
+  0x90, 0x44, 0x25, 0x9c, 0x32, 0x5f, 0x02, 0xe7, 0xe5, 0xc6, 0x0f, 0xeb,
+  0xde, 0x87, 0xf3, 0x39, 0x22, 0xf9, 0x72, 0x97, 0x1d, 0x29, 0xc6, 0xce,
+  0x87, 0xae, 0xa9, 0x23, 0xf6, 0xd3, 0x60, 0x16, 0x9a, 0xc1, 0x00, 0x14,
+  0xe9, 0x82, 0x93, 0x4e, 0x9f, 0x03, 0xea, 0x43, 0x50, 0xb1, 0x4c, 0xbe,
+  0x87, 0x02, 0x29, 0x3d, 0x60, 0x16, 0xdf, 0x3a, 0x35, 0xe9, 0x23, 0x9b,
+  0x51, 0xb2, 0x80, 0x0e, 0x06, 0x7a, 0x5c, 0x48, 0x82, 0x26, 0x0b, 0x32,
+  0x48, 0xc7, 0x60, 0xe5, 0xa8, 0x81, 0xc8, 0xb6, 0xd2, 0x48, 0x7d, 0xec,
+  0xed, 0x7d, 0xe6, 0x00, 0x12, 0xb9, 0x20, 0x60, 0x20, 0x83, 0x61, 0xc4,
+  0x6c, 0x16, 0xa3, 0xc8, 0x61, 0x50, 0xd8, 0xc0, 0xfe, 0x08, 0xb4, 0x09,
+  0xb3, 0xc0, 0x48, 0x03, 0x30, 0xcd, 0xea, 0xe0, 0xea, 0x72, 0x72, 0x73,
+  0x35, 0xba, 0x1f, 0xdc, 0x0c, 0x4f, 0xcf, 0x27, 0xb5, 0x04, 0x31, 0x58,
+  0xb4, 0xcb, 0x37, 0x0a, 0x1d, 0xba, 0x06, 0xbf, 0x7c, 0x0a, 0x86, 0xe2,
+  0x45, 0x35, 0x86, 0xf9, 0x1e, 0x7b, 0x32, 0x27, 0xfa, 0x1e, 0x7c, 0xc6,
+  0x7b, 0x26, 0x51, 0xdb, 0x8a, 0xca, 0xf2, 0x4c, 0x3c, 0x2a, 0x01, 0xaf,
+  0xc4, 0x83, 0xac, 0x6a, 0x8b, 0xf3, 0x53, 0xab, 0x83, 0x7d, 0x3c, 0x5b,
+  0xae, 0x61, 0x42, 0x7f, 0xe4, 0x2c, 0xc0, 0x85, 0xab, 0x6d, 0xc9, 0x28,
+  0x34, 0x6d, 0x81, 0x45, 0x35, 0x94, 0xb1, 0xe1, 0x24, 0x70, 0x69, 0xaf,
+  0x19, 0x7c, 0xec, 0x5f, 0x5e, 0x0e, 0x47, 0x69, 0xbf, 0x81, 0x55, 0x8c,
+  0xaf, 0x46, 0xc3, 0xb4, 0x1d, 0x5f, 0x5c, 0x5d, 0x9e, 0x4f, 0xae, 0x6e,
+  0xa0, 0x1b, 0x52, 0x5e, 0x5e, 0xf7, 0x61, 0x32, 0x58, 0xac, 0xf2, 0xea,
+  0xec, 0x1c, 0x67, 0xee, 0xa9, 0x33, 0x87, 0x93, 0x9b, 0xf3, 0xc1, 0xb8,
+  0x4b, 0xf6, 0xeb, 0x29, 0x1a, 0x28, 0xa9, 0xb4, 0x27, 0x7c, 0x1c, 0xf6,
+  0x27, 0x17, 0xfd, 0x6b, 0xa8, 0x3e, 0x54, 0xa9, 0xa4, 0xf8, 0x95, 0x02,
+  0x9e, 0x5c, 0x7d, 0xf8, 0x30, 0x1a, 0xde, 0x4b, 0xa6, 0x80, 0xfd, 0x56,
+  0x09, 0xa0, 0xd0, 0x04, 0x00, 0xb4, 0x33, 0x00, 0x37, 0xc3, 0xc1, 0xd5,
+  0xcd, 0xe9, 0x3d, 0x90, 0x3c, 0x1d, 0x22, 0x82, 0xbd, 0xb4, 0xfc, 0xe3,
+  0xb0, 0xe5, 0x86, 0x01, 0xd8, 0x04, 0x54, 0xc9, 0x0c, 0x4d, 0x05, 0xe2,
+  0xbd, 0xc7, 0x4d, 0xc0, 0xc1, 0x14, 0x01, 0xf1, 0xd0, 0x16, 0x55, 0xdd,
+  0xdc, 0x33, 0x6c, 0xaa, 0xc7, 0xa6, 0x82, 0xd1, 0x11, 0x92, 0x04, 0x83,
+  0x28, 0x12, 0xa9, 0x8e, 0x40, 0xc3, 0xad, 0xe0, 0x87, 0x5e, 0xdc, 0xe2,
+  0x81, 0x88, 0x18, 0xbe, 0x54, 0x18, 0x4e, 0xc2, 0x98, 0x2b, 0x62, 0x9e,
+  0xd8, 0x30, 0xf9, 0x97, 0x8f, 0xe3, 0x50, 0xf2, 0x90, 0x5b, 0x28, 0x83,
+  0x0e, 0xfb, 0x9e, 0x67, 0x3c, 0x93, 0x15, 0x84, 0x68, 0x4e, 0xb0, 0x8e,
+  0xcd, 0xf6, 0x6c, 0x49, 0xb0, 0xf0, 0x31, 0x85, 0x6d, 0x2a, 0x24, 0x6e,
+  0x27, 0x67, 0xda, 0x21, 0x61, 0x01, 0x74, 0xe9, 0xf3, 0x3a, 0xf1, 0x5d,
+  0x32, 0x0d, 0xad, 0x87, 0x68, 0x3d, 0x33, 0xd7, 0x0f, 0x04, 0xe2, 0x95,
+  0xe1, 0xf9, 0x82, 0x63, 0x71, 0x52, 0x91, 0xa0, 0x07, 0xc3, 0x86, 0xd0,
+  0x03, 0xa6, 0xe5, 0xce, 0xf9, 0x4b, 0x69, 0x8c, 0x7a, 0x5a, 0x90, 0x12,
+  0x21, 0x58, 0x10, 0x18, 0x67, 0xe8, 0x3c, 0xf8, 0xc2, 0x9f, 0x85, 0x39,
+  0x72, 0x37, 0xe2, 0xc8, 0xf0, 0xa4, 0x25, 0x63, 0xe3, 0x20, 0xad, 0x39,
+  0x5b, 0x84, 0xb2, 0x30, 0xe6, 0xd8, 0xd0, 0xaf, 0x73, 0x8a, 0x3c, 0x3b,
+  0xff, 0x90, 0x36, 0xd0, 0x9f, 0x27, 0xc3, 0x9b, 0x8b, 0xfb, 0x33, 0x50,
+  0x71, 0x97, 0xec, 0xc8, 0xe3, 0xeb, 0x9d, 0x7a, 0xd1, 0xf8, 0xfd, 0xf8,
+  0xfc, 0xff, 0xc1, 0x1c, 0x5b, 0x87, 0xb9, 0xd1, 0x9b, 0xab, 0xcf, 0x60,
+  0x92, 0x7b, 0xcd, 0xdc, 0xc0, 0xe0, 0x6a, 0x34, 0xe6, 0xe7, 0x4f, 0xaa,
+  0x09, 0xf7, 0x7f, 0xbe, 0xbf, 0xee, 0x8f, 0x27, 0xc3, 0xfb, 0xd1, 0xf0,
+  0xf2, 0xc3, 0xe4, 0x23, 0x98, 0x7c, 0xe7, 0x40, 0x19, 0x1f, 0x83, 0x11,
+  0xf6, 0x3f, 0x0c, 0xef, 0x27, 0x1f, 0x87, 0x17, 0xc3, 0xfb, 0x4f, 0xc3,
+  0x5f, 0x80, 0x2f, 0x83, 0xa7, 0xbf, 0x7b, 0xd0, 0x89, 0x4d, 0x55, 0xe6,
+  0x4e, 0x87, 0x67, 0xfd, 0xdb, 0xd1, 0x44, 0xc0, 0x02, 0x9c, 0x69, 0x78,
+  0x0f, 0x3b, 0x19, 0x5a, 0xe3, 0x01, 0xd8, 0xee, 0xe8, 0x7d, 0x7f, 0xf0,
+  0xe9, 0x7e, 0x74, 0x7e, 0x39, 0x14, 0xfc, 0xa8, 0x0c, 0x5d, 0xdd, 0x4e,
+  0xae, 0x6f, 0x27, 0xf7, 0x67, 0xa3, 0xdb, 0xf1, 0xc7, 0xfb, 0xf7, 0xbf,
+  0x4c, 0x10, 0xa4, 0x7d, 0xd0, 0x6e, 0xed, 0xef, 0xf3, 0x48, 0xfa, 0xd9,
+  0x03, 0xe7, 0x87, 0x06, 0xc1, 0x00, 0xf5, 0x40, 0xac, 0xab, 0x13, 0xaa,
+  0x2f, 0x74, 0x34, 0x16, 0xb4, 0x4d, 0xb9, 0x05, 0x42, 0x02, 0x63, 0x4a,
+  0x16, 0x14, 0xac, 0xc0, 0x71, 0x85, 0x8a, 0xfc, 0x04, 0xff, 0xfb, 0xdb,
+  0xb3, 0xb3, 0xe1, 0xcd, 0xfd, 0x60, 0x34, 0xec, 0x5f, 0xde, 0x5e, 0xdf,
+  0x9f, 0x5f, 0x82, 0x68, 0xfe, 0xd9, 0x1f, 0xa1, 0xc0, 0xf0, 0x87, 0x13,
+  0xe9, 0xe0, 0xa1, 0x3c, 0x94, 0xf2, 0xca, 0x34, 0x74, 0x2a, 0x88, 0x27,
+  0x83, 0xc9, 0xfd, 0xe9, 0x70, 0xd4, 0xff, 0x45, 0xe4, 0xb2, 0x92, 0x08,
+  0x77, 0x7a, 0x75, 0x41, 0xa2, 0xdd, 0xd6, 0x99, 0x31, 0x4b, 0x4c, 0x57,
+  0xe8, 0x5d, 0x0e, 0xf9, 0x69, 0xcd, 0x47, 0xa7, 0x6a, 0xb9, 0x84, 0xb2,
+  0x04, 0x7b, 0xbe, 0xe4, 0x66, 0x96, 0x19, 0x08, 0xdc, 0xc5, 0xc2, 0xa2,
+  0x13, 0xd4, 0x42, 0x79, 0x0a, 0x7c, 0x1f, 0x38, 0xb9, 0x41, 0x48, 0x15,
+  0xe6, 0xd0, 0x9f, 0x95, 0x0d, 0x0d, 0x02, 0xcf, 0x1a, 0x14, 0x0d, 0x4a,
+  0xbf, 0x2f, 0x1c, 0xa2, 0x58, 0xb4, 0xe5, 0xab, 0x12, 0x7e, 0x32, 0x9d,
+  0x5f, 0x92, 0x38, 0xf6, 0x15, 0xef, 0x8b, 0x84, 0x18, 0x97, 0x53, 0xc8,
+  0xcf, 0xc4, 0x1d, 0x43, 0x9e, 0x87, 0x8c, 0x82, 0x2d, 0x49, 0x3d, 0xce,
+  0x13, 0xbd, 0x28, 0xc4, 0xeb, 0x32, 0xaa, 0xd7, 0x54, 0x71, 0xb2, 0x39,
+  0xa9, 0xbe, 0xe1, 0x95, 0x93, 0x1e, 0x57, 0x46, 0xe4, 0xb7, 0xdf, 0x88,
+  0x7c, 0x27, 0x4a, 0x22, 0xe5, 0xc5, 0xda, 0xc7, 0x0f, 0xd1, 0xb3, 0xee,
+  0x41, 0x70, 0x78, 0x1e, 0xf3, 0xc2, 0xeb, 0x4d, 0xaf, 0x87, 0x65, 0xe6,
+  0xd8, 0x9d, 0x41, 0x73, 0xad, 0x5f, 0x5d, 0x0f, 0x2f, 0x53, 0x84, 0x50,
+  0xd6, 0x41, 0xe8, 0x25, 0xbb, 0xe3, 0x4a, 0xf7, 0xc6, 0xb5, 0xe4, 0x3d,
+  0xa7, 0xc1, 0x45, 0x78, 0x80, 0xf5, 0x04, 0xbc, 0xd2, 0x85, 0xc8, 0x0b,
+  0x31, 0x51, 0x89, 0x81, 0xc0, 0x39, 0xb0, 0x8b, 0x01, 0x09, 0x66, 0x62,
+  0x50, 0x9e, 0x8a, 0x84, 0xc9, 0x37, 0x37, 0x6d, 0xe6, 0xfb, 0x4a, 0x81,
+  0x98, 0x18, 0x55, 0x94, 0x2b, 0x7b, 0xbc, 0xd4, 0x86, 0xb0, 0x86, 0xc2,
+  0x22, 0x3d, 0xe0, 0xbd, 0x22, 0xa8, 0x54, 0xc8, 0xdf, 0xe5, 0xf2, 0x64,
+  0xc6, 0x96, 0x7f, 0xb9, 0x54, 0x6b, 0xa4, 0xcb, 0x27, 0x1c, 0xa9, 0x9c,
+  0x0b, 0x21, 0x4a, 0xc4, 0x3a, 0x46, 0xf2, 0x91, 0x48, 0xc4, 0x88, 0xb5,
+  0x59, 0x4b, 0xd6, 0x9d, 0x59, 0xdd, 0x67, 0xcf, 0x58, 0x61, 0xe5, 0x10,
+  0x29, 0x2a, 0x4a, 0x13, 0xc0, 0x14, 0x78, 0xad, 0x0d, 0xe6, 0x4c, 0x0e,
+  0x3a, 0x9d, 0xbd, 0x8e, 0x48, 0x0e, 0xf9, 0xa5, 0x44, 0xf0, 0x3d, 0x88,
+  0xb6, 0x47, 0xea, 0x30, 0x0a, 0xa3, 0x6a, 0x51, 0xf0, 0xfc, 0xf9, 0xdc,
+  0xa7, 0x18, 0x98, 0x9b, 0x47, 0xd1, 0xf3, 0x31, 0xc9, 0x33, 0x1a, 0x0f,
+  0xee, 0x02, 0xe4, 0xd3, 0x19, 0xfc, 0x64, 0x34, 0x17, 0x51, 0xe4, 0xd1,
+  0x1d, 0xd0, 0x45, 0x28, 0xfc, 0x70, 0x6a, 0xa0, 0x2e, 0xaa, 0x62, 0x7e,
+  0x3d, 0xc6, 0x13, 0xa1, 0x39, 0x2a, 0xc2, 0x22, 0xf8, 0x06, 0x34, 0x58,
+  0x09, 0x25, 0x0a, 0xad, 0xa6, 0xf3, 0xf1, 0xae, 0xa0, 0xa6, 0xb0, 0x99,
+  0xc5, 0x26, 0xf0, 0x7c, 0x69, 0xde, 0x01, 0x2a, 0x29, 0xc3, 0x62, 0x88,
+  0x96, 0x80, 0x48, 0x63, 0x23, 0x3f, 0x71, 0x26, 0x8b, 0x67, 0xb4, 0x0b,
+  0x67, 0x9c, 0x9c, 0x28, 0x1b, 0x1a, 0x2a, 0xbc, 0x0e, 0x8b, 0xae, 0x72,
+  0xf0, 0x7a, 0xba, 0xaa, 0x28, 0x66, 0xd9, 0xd7, 0x57, 0xa1, 0xbf, 0xac,
+  0x8a, 0x0f, 0x69, 0x90, 0xef, 0x69, 0x87, 0x11, 0xd0, 0xa0, 0xcf, 0x21,
+  0x84, 0xc7, 0x6a, 0x24, 0xb8, 0x93, 0xc4, 0xff, 0xd0, 0xef, 0x23, 0x44,
+  0x2a, 0xa6, 0xef, 0x10, 0x50, 0x03, 0xa8, 0x0b, 0xaa, 0xbc, 0x91, 0xcb,
+  0xa8, 0x73, 0x26, 0x6a, 0x14, 0x9d, 0x8f, 0x55, 0x2b, 0x67, 0x06, 0xb3,
+  0x44, 0xc5, 0x81, 0xd8, 0xb8, 0x7d, 0x77, 0x2b, 0x75, 0xd1, 0x02, 0xa6,
+  0xb9, 0xf3, 0x97, 0xee, 0x7a, 0x58, 0x3a, 0x49, 0x7c, 0xc0, 0x08, 0x54,
+  0xa9, 0xa5, 0xbd, 0x3c, 0xe7, 0xee, 0x49, 0xab, 0x8a, 0x9d, 0xa8, 0x68,
+  0x1d, 0xf8, 0xf5, 0x07, 0xac, 0x23, 0x00, 0xcd, 0x94, 0x33, 0x0f, 0xfe,
+  0x01, 0x4d, 0x1f, 0x34, 0x38, 0x62, 0x3b, 0xc2, 0x6f, 0x60, 0x23, 0xe4,
+  0x8b, 0x4b, 0x12, 0x50, 0xc1, 0x43, 0x50, 0x07, 0x4b, 0xc4, 0x68, 0x93,
+  0x38, 0x47, 0xd4, 0x7f, 0x2a, 0xa1, 0xf1, 0xdf, 0x21, 0x0d, 0xe9, 0x39,
+  0x62, 0x96, 0x2e, 0x9c, 0x8d, 0x7e, 0xe2, 0x6d, 0x81, 0x97, 0x82, 0x8f,
+  0xf6, 0x4d, 0xbe, 0xc6, 0x29, 0xe7, 0x30, 0x3d, 0xaf, 0x2c, 0x7e, 0x64,
+  0x84, 0x1d, 0x3b, 0x23, 0x13, 0x7e, 0xc8, 0xc0, 0x05, 0x71, 0x8e, 0x6e,
+  0x49, 0xdf, 0x63, 0xbb, 0xbb, 0x39, 0x77, 0x13, 0xfa, 0x55, 0xfa, 0x2a,
+  0x61, 0x31, 0x7c, 0x1e, 0x1e, 0x56, 0x0e, 0x20, 0x20, 0xf5, 0x83, 0x2a,
+  0xab, 0x95, 0x5a, 0xcf, 0x77, 0x48, 0x9f, 0x50, 0xd4, 0x21, 0xa3, 0x9c,
+  0x43, 0xc6, 0x4b, 0xab, 0x19, 0x72, 0x9c, 0xb8, 0x5c, 0x86, 0x2e, 0x47,
+  0x1f, 0x19, 0xdb, 0x34, 0xb1, 0xb3, 0x1c, 0x1f, 0xd3, 0x5a, 0xad, 0x2c,
+  0x8c, 0x83, 0xcc, 0xc6, 0x90, 0xc9, 0xcd, 0x10, 0x94, 0x33, 0xb7, 0x00,
+  0x98, 0xc7, 0x69, 0x17, 0x2a, 0x65, 0x8b, 0xe7, 0x0a, 0x28, 0x23, 0x79,
+  0xcb, 0x57, 0x98, 0x81, 0x92, 0x76, 0x31, 0xc3, 0x59, 0x76, 0x18, 0x44,
+  0x09, 0x2e, 0x87, 0x8f, 0x50, 0x7b, 0x56, 0x39, 0x1d, 0xae, 0xe1, 0x3a,
+  0x54, 0x49, 0xb5, 0x23, 0x64, 0xa2, 0xd5, 0xb4, 0x7d, 0x61, 0x46, 0x98,
+  0x39, 0xd6, 0xcc, 0x31, 0xdd, 0xf5, 0x66, 0x9b, 0x8c, 0x0d, 0x26, 0x41,
+  0x57, 0x4d, 0xb1, 0x51, 0xc0, 0x04, 0xe6, 0xe5, 0xa3, 0xf4, 0x52, 0xf2,
+  0x22, 0xb3, 0x5e, 0xca, 0x06, 0xca, 0x14, 0xd9, 0x10, 0xe3, 0xfa, 0x72,
+  0x2f, 0x31, 0x41, 0x83, 0x57, 0xe7, 0x29, 0xa8, 0xca, 0xc8, 0x0d, 0x66,
+  0xd3, 0xc3, 0x2a, 0xb4, 0x57, 0x72, 0x71, 0x47, 0x2f, 0x7a, 0xe6, 0x18,
+  0x7d, 0x9b, 0xb7, 0xe1, 0x32, 0x66, 0x48, 0x17, 0x85, 0x8e, 0x64, 0x6e,
+  0x78, 0xf8, 0x27, 0x69, 0x86, 0x77, 0xa2, 0x76, 0x1c, 0x54, 0x6d, 0xb9,
+  0x6b, 0x9f, 0x37, 0x1c, 0x86, 0xd8, 0xbc, 0x50, 0x50, 0x2e, 0x5c, 0x68,
+  0x53, 0xdc, 0x08, 0x87, 0x1f, 0x44, 0x48, 0x16, 0x21, 0xe5, 0xb9, 0xc1,
+  0x80, 0x8c, 0x86, 0x38, 0x80, 0x30, 0x98, 0x0d, 0xd7, 0x1e, 0xf3, 0x89,
+  0xe9, 0xb9, 0xab, 0x15, 0x35, 0x37, 0xf9, 0xb9, 0xb2, 0x30, 0x55, 0x6b,
+  0x32, 0xe7, 0xb8, 0xae, 0x9d, 0x16, 0x2a, 0xef, 0xf1, 0x89, 0xa6, 0xbe,
+  0x1a, 0xab, 0x27, 0xb2, 0x42, 0x9b, 0x7c, 0xde, 0x31, 0x28, 0x2e, 0xa9,
+  0x7a, 0x52, 0x2a, 0x79, 0x51, 0xb7, 0x32, 0x71, 0xba, 0xa1, 0x83, 0x79,
+  0xf8, 0xc2, 0x08, 0x96, 0xf8, 0x0d, 0x01, 0x8e, 0xb7, 0x5e, 0x8e, 0x50,
+  0xd5, 0xa8, 0xc0, 0x20, 0xc2, 0x4c, 0x36, 0x65, 0x16, 0x20, 0xf0, 0x57,
+  0x16, 0x28, 0xa3, 0xda, 0xac, 0x0b, 0xa2, 0xb5, 0x12, 0xe3, 0xc0, 0xb5,
+  0x62, 0xbe, 0xe7, 0x40, 0x47, 0xe9, 0xc2, 0x36, 0x55, 0x48, 0x16, 0x5a,
+  0x49, 0xaa, 0xee, 0x84, 0x2a, 0x0d, 0xe2, 0xb3, 0x55, 0x9d, 0xb9, 0xb6,
+  0x0d, 0x6a, 0x4b, 0x49, 0x5f, 0xf5, 0x25, 0xee, 0x97, 0x9f, 0x28, 0x5d,
+  0x29, 0x21, 0x9d, 0x57, 0x61, 0x26, 0x99, 0x52, 0x08, 0x3b, 0xe2, 0xd6,
+  0x9c, 0xc4, 0x82, 0x85, 0x11, 0xbf, 0x59, 0x95, 0xd6, 0x47, 0x34, 0x8a,
+  0x02, 0x2f, 0xde, 0x09, 0x28, 0x8f, 0x1c, 0x89, 0x6f, 0x81, 0x43, 0x20,
+  0x2f, 0x9c, 0x2f, 0x80, 0x60, 0x96, 0xa5, 0xec, 0x35, 0xad, 0xc1, 0x20,
+  0x6d, 0x0a, 0x6d, 0x68, 0xdc, 0xe9, 0xe3, 0x77, 0x34, 0x80, 0x45, 0x9c,
+  0x8b, 0x47, 0xd0, 0x05, 0x61, 0x24, 0x23, 0xb7, 0x8c, 0x96, 0xbe, 0x48,
+  0xae, 0xef, 0x6a, 0x75, 0xb5, 0x16, 0x47, 0xe6, 0x37, 0x4b, 0x97, 0xef,
+  0xbf, 0xd2, 0x48, 0xbe, 0xb2, 0xea, 0xca, 0x25, 0xb0, 0x82, 0xca, 0xf3,
+  0xa4, 0x07, 0xbd, 0xd9, 0x4f, 0x3f, 0x45, 0x85, 0x1a, 0xaf, 0x91, 0x14,
+  0x89, 0xc9, 0xcd, 0xa9, 0x7c, 0x55, 0x10, 0xf0, 0x33, 0x09, 0x69, 0x67,
+  0xa7, 0xa0, 0xfd, 0x7f, 0xc2, 0xc7, 0x84, 0x00, 0x0f, 0x28, 0xf5, 0x54,
+  0x05, 0x79, 0x25, 0x2b, 0xbf, 0x3c, 0x13, 0x99, 0xd2, 0x21, 0xeb, 0x79,
+  0x3d, 0x4e, 0x4a, 0x87, 0xf6, 0x13, 0x25, 0xb5, 0xd7, 0xae, 0xb6, 0xea,
+  0x50, 0xba, 0x87, 0x34, 0x3d, 0xad, 0x28, 0x5a, 0xbd, 0x10, 0xbe, 0xb1,
+  0x48, 0xb9, 0x10, 0x6d, 0x56, 0xa9, 0xc8, 0xde, 0x44, 0xbd, 0xa5, 0x2e,
+  0x1b, 0x32, 0x74, 0xef, 0x02, 0x39, 0x1e, 0x93, 0xbd, 0x83, 0x5a, 0xbe,
+  0x71, 0xf9, 0x6f, 0x8a, 0x4a, 0xe0, 0x0e, 0x78, 0x4f, 0xe5, 0x5f, 0x53,
+  0x6f, 0x4c, 0x67, 0x79, 0x59, 0xed, 0xe7, 0x65, 0x25, 0x03, 0xcd, 0x2a,
+  0xbc, 0xc6, 0x06, 0xd9, 0xb2, 0x68, 0x7e, 0xd6, 0x61, 0xe9, 0x2c, 0x70,
+  0xbe, 0x56, 0xf9, 0xbc, 0xd6, 0x41, 0x7e, 0x62, 0x56, 0x80, 0x3a, 0x9e,
+  0x65, 0xa0, 0xa5, 0x52, 0x1e, 0xe8, 0xbe, 0xfe, 0xf5, 0x5b, 0x35, 0xbd,
+  0x06, 0x48, 0xc9, 0xf4, 0xa0, 0xa6, 0x07, 0xee, 0x19, 0x7b, 0xa2, 0x66,
+  0xb5, 0x5d, 0xfb, 0x4e, 0x2e, 0x3e, 0xfe, 0x5a, 0x27, 0x5f, 0xc9, 0xae,
+  0xaa, 0xf0, 0xaf, 0xc8, 0x0b, 0x84, 0x5b, 0x98, 0xaf, 0xae, 0x05, 0x13,
+  0x7a, 0x32, 0xb9, 0x55, 0xfb, 0xfe, 0x63, 0x9d, 0x73, 0x4d, 0x5a, 0x1c,
+  0x32, 0xc5, 0x7f, 0x1e, 0xf6, 0x6b, 0x61, 0xa6, 0x6b, 0x90, 0x8f, 0x51,
+  0x7f, 0x6d, 0x90, 0xd6, 0x01, 0x79, 0xc2, 0x5f, 0x0b, 0x8f, 0xf1, 0xdd,
+  0x2e, 0xf4, 0xfb, 0x76, 0xe7, 0x40, 0x43, 0x25, 0xf1, 0xfb, 0xba, 0x3e,
+  0xdf, 0x00, 0x7b, 0x80, 0x42, 0xa2, 0x0e, 0x8d, 0x03, 0x6e, 0x81, 0xe0,
+  0xc1, 0x25, 0x0f, 0x08, 0x75, 0x98, 0x8f, 0xf7, 0xef, 0x11, 0x60, 0xff,
+  0xd3, 0xfb, 0xf4, 0x2e, 0x86, 0xdc, 0xd1, 0xbc, 0xff, 0x74, 0x7e, 0x79,
+  0x3a, 0xc6, 0xd8, 0x93, 0xac, 0xf6, 0x1b, 0xe1, 0x37, 0xe8, 0xbb, 0xa4,
+  0x72, 0x03, 0xdd, 0xc2, 0xb8, 0x52, 0x8f, 0xee, 0xe7, 0x54, 0xf6, 0xda,
+  0x75, 0xa0, 0xde, 0xa9, 0x93, 0xbd, 0x76, 0x85, 0x7c, 0xaf, 0x17, 0x4d,
+  0xf9, 0x7c, 0x73, 0x3e, 0x19, 0xaa, 0x73, 0x24, 0xfc, 0xa6, 0x39, 0xc3,
+  0x9f, 0x87, 0x83, 0xdb, 0x82, 0x59, 0xad, 0x77, 0x07, 0x72, 0x5a, 0x34,
+  0xeb, 0xee, 0xa8, 0x78, 0x15, 0x83, 0xe1, 0x08, 0xb7, 0x8a, 0x53, 0x97,
+  0x9a, 0xd4, 0xf1, 0x0f, 0xfd, 0x6b, 0xdc, 0x69, 0xdd, 0x2f, 0x19, 0x9e,
+  0x5c, 0xe1, 0x70, 0xeb, 0xe0, 0xa8, 0xac, 0xe0, 0xb8, 0xa0, 0xb6, 0x0b,
+  0x3d, 0x3c, 0xbf, 0x86, 0xc9, 0x82, 0x67, 0xde, 0x0b, 0x47, 0x9b, 0x26,
+  0xb2, 0x8a, 0xeb, 0xc6, 0x8a, 0xe0, 0x45, 0x02, 0xea, 0x86, 0x6b, 0x6b,
+  0x0a, 0x41, 0x45, 0xa6, 0x63, 0x98, 0xc5, 0xa0, 0x51, 0x10, 0xb7, 0x97,
+  0xa8, 0x5f, 0x57, 0x08, 0x98, 0x9e, 0xb1, 0x76, 0xc8, 0x94, 0x1f, 0x32,
+  0x53, 0x11, 0xde, 0x67, 0x96, 0x0b, 0x6d, 0x0b, 0x16, 0x1d, 0x10, 0xa7,
+  0x31, 0x25, 0xb9, 0x02, 0x5f, 0xe8, 0x33, 0xca, 0x77, 0x0c, 0x80, 0x80,
+  0xb4, 0x08, 0xa4, 0xba, 0xa9, 0x06, 0xc1, 0xd8, 0x23, 0x8d, 0xaa, 0x30,
+  0xf6, 0x44, 0x7b, 0x10, 0x68, 0x4e, 0x3d, 0xb4, 0xaf, 0xa3, 0xb2, 0xb8,
+  0x14, 0xdd, 0xf8, 0x2f, 0x8b, 0x4b, 0x29, 0xb3, 0x8a, 0xca, 0x90, 0xb7,
+  0x02, 0x75, 0x69, 0xc4, 0x92, 0x97, 0x30, 0x7b, 0x24, 0x4b, 0x26, 0x07,
+  0xc9, 0xdd, 0x00, 0x35, 0x05, 0x38, 0x55, 0xdd, 0x67, 0xf8, 0x15, 0x08,
+  0x75, 0x7e, 0x56, 0xae, 0xcb, 0x7b, 0x92, 0xa2, 0x19, 0xc2, 0x43, 0xfa,
+  0x6c, 0x2b, 0x24, 0xa1, 0xf9, 0xb1, 0x31, 0x20, 0x2f, 0x59, 0x02, 0x27,
+  0xbd, 0x4b, 0xaa, 0x85, 0xc3, 0x1a, 0x69, 0xd5, 0x14, 0x96, 0xc0, 0xdc,
+  0x8e, 0x0a, 0x28, 0x88, 0xd3, 0x68, 0x85, 0x04, 0xda, 0xdd, 0x2e, 0xc7,
+  0x5c, 0x04, 0x9e, 0x61, 0x9f, 0x54, 0x2a, 0x65, 0xdd, 0x4d, 0x14, 0x2e,
+  0x1d, 0x7e, 0x3e, 0xdc, 0x8b, 0x10, 0x40, 0xa8, 0x1c, 0x88, 0x77, 0xd5,
+  0x4a, 0xdb, 0xac, 0x64, 0x02, 0x2c, 0xbe, 0xd7, 0xf1, 0x58, 0x78, 0x8c,
+  0x74, 0x10, 0x3f, 0xde, 0x02, 0xae, 0x94, 0x00, 0xdd, 0xd0, 0x59, 0x80,
+  0xd5, 0x1b, 0x16, 0x70, 0x8a, 0xbc, 0xea, 0xe9, 0xb5, 0x15, 0x92, 0x70,
+  0x79, 0xe8, 0xad, 0xb4, 0x9a, 0xab, 0x27, 0xf5, 0x2b, 0x5d, 0xf5, 0xe8,
+  0x43, 0x9d, 0xc4, 0xc7, 0xd6, 0x2a, 0xf5, 0xb4, 0xa0, 0xa3, 0xfe, 0xaf,
+  0x2a, 0x42, 0xdd, 0x43, 0x0d, 0xfb, 0xc0, 0x82, 0x42, 0x01, 0x03, 0x1f,
+  0x50, 0x7b, 0x00, 0x6d, 0x54, 0xa5, 0xca, 0x14, 0xad, 0xa4, 0xb3, 0x78,
+  0x34, 0xe3, 0x11, 0x7a, 0xd2, 0xa2, 0xed, 0xa3, 0x87, 0xc8, 0x72, 0xeb,
+  0x04, 0x9e, 0x77, 0x85, 0x8e, 0x85, 0x29, 0x17, 0xe0, 0x89, 0x1c, 0x33,
+  0x2a, 0xa7, 0x8d, 0xa7, 0xaa, 0xae, 0xeb, 0x02, 0x7b, 0x0e, 0xbe, 0x40,
+  0xf8, 0xf3, 0xf9, 0xbc, 0x52, 0x0a, 0x86, 0x27, 0x73, 0x7c, 0xe9, 0x3a,
+  0x0f, 0x9a, 0x75, 0x19, 0xe0, 0xb1, 0xad, 0x2c, 0xec, 0xea, 0x79, 0x74,
+  0xe0, 0x8d, 0x3d, 0x7f, 0x3a, 0x16, 0x6c, 0x8b, 0x4f, 0x05, 0x8d, 0xbd,
+  0x22, 0x09, 0x98, 0x25, 0x78, 0xfe, 0x82, 0xb0, 0x77, 0xf9, 0xad, 0xb2,
+  0x1c, 0xeb, 0x62, 0xda, 0xdf, 0xc9, 0x57, 0x6f, 0x31, 0x35, 0xaa, 0x7f,
+  0xfd, 0xc6, 0xd9, 0xe4, 0x81, 0xfc, 0x7b, 0x1d, 0xd3, 0x20, 0x7e, 0x99,
+  0x08, 0xf7, 0xde, 0xf4, 0xc3, 0x0e, 0xc8, 0x4f, 0x40, 0x37, 0x22, 0x71,
+  0xa5, 0x52, 0x6f, 0xed, 0x2b, 0x81, 0xd8, 0xff, 0x43, 0xeb, 0x10, 0xff,
+  0x55, 0x36, 0x90, 0xe6, 0xd6, 0xc8, 0x55, 0xbd, 0x8b, 0x85, 0x26, 0xac,
+  0xf0, 0x27, 0xd2, 0xea, 0xd4, 0x32, 0x51, 0xa1, 0x9e, 0x71, 0x34, 0x01,
+  0x79, 0x72, 0x42, 0xf6, 0x73, 0x90, 0x69, 0x52, 0x24, 0x9d, 0x58, 0xc0,
+  0xbb, 0xeb, 0xb9, 0x37, 0xe5, 0x5b, 0x1c, 0x85, 0xc5, 0xb3, 0x90, 0x30,
+  0x3f, 0x96, 0xbc, 0x1f, 0x4f, 0xfa, 0x93, 0xdb, 0xf1, 0xfd, 0xa8, 0xff,
+  0x7e, 0x38, 0xe2, 0xb9, 0xb7, 0x72, 0x7e, 0x39, 0x81, 0xe4, 0x57, 0xf9,
+  0x7c, 0x85, 0xbf, 0xc7, 0x93, 0xc1, 0x27, 0xfc, 0xfb, 0x71, 0x34, 0xe9,
+  0xe3, 0xdf, 0xab, 0x5b, 0x3e, 0x78, 0xd1, 0xc2, 0xdf, 0xe7, 0x97, 0xd7,
+  0xfc, 0xc3, 0xf0, 0xe2, 0x06, 0xff, 0x5e, 0xdf, 0x5c, 0x4d, 0xc4, 0xeb,
+  0xc9, 0xb0, 0x92, 0xcd, 0x8e, 0x7c, 0xf7, 0x7e, 0x44, 0xf9, 0x5e, 0xec,
+  0x37, 0x5e, 0xea, 0x86, 0xf2, 0x0c, 0xcc, 0x30, 0x4d, 0x0f, 0x72, 0x90,
+  0xf8, 0xc0, 0x77, 0xd6, 0xe0, 0xa9, 0x78, 0x0b, 0x7f, 0x1a, 0x32, 0xcb,
+  0xbc, 0x46, 0x4c, 0xd5, 0x0d, 0xf5, 0xaa, 0xf8, 0x12, 0x23, 0xcf, 0x0a,
+  0x92, 0xa6, 0x2e, 0x69, 0x44, 0xad, 0x63, 0x59, 0xf0, 0xc7, 0x0a, 0xa5,
+  0x47, 0xaa, 0xd2, 0xac, 0x79, 0xdf, 0x07, 0xd6, 0x6d, 0x4c, 0xc1, 0x02,
+  0xd1, 0xca, 0x4d, 0xbf, 0xd4, 0xd3, 0xf1, 0x04, 0xa0, 0x47, 0x4c, 0x77,
+  0x16, 0x22, 0x0f, 0x3a, 0x74, 0xf9, 0x50, 0xd7, 0x0d, 0x05, 0x47, 0xd5,
+  0x8a, 0xc9, 0x1e, 0x2b, 0x69, 0x1d, 0xf1, 0x1b, 0x7c, 0x33, 0xcb, 0xf0,
+  0x7d, 0x3c, 0x8f, 0x41, 0x9f, 0x8b, 0xbf, 0xa3, 0x58, 0x29, 0xf0, 0x67,
+  0x47, 0x00, 0x95, 0xe1, 0x87, 0x78, 0xe5, 0x64, 0x08, 0xe0, 0x8c, 0x22,
+  0x02, 0x7c, 0x6d, 0x95, 0x3c, 0x68, 0xba, 0x36, 0xe5, 0x50, 0x79, 0x86,
+  0x8d, 0x15, 0x6e, 0x4d, 0x0d, 0x96, 0xa0, 0x85, 0x2a, 0xce, 0x2a, 0x71,
+  0xf8, 0x29, 0xef, 0x5d, 0x44, 0x43, 0x0f, 0xd6, 0x79, 0xc4, 0x5f, 0x9c,
+  0xf0, 0x08, 0x00, 0x4f, 0x9a, 0x56, 0xb6, 0x75, 0x8e, 0xdf, 0x7d, 0x7c,
+  0xd5, 0x22, 0x09, 0x9f, 0x53, 0xb4, 0x4c, 0x7c, 0x5f, 0x39, 0x2a, 0x0e,
+  0x2c, 0xe6, 0x6b, 0x89, 0xc0, 0x94, 0x22, 0x1a, 0xf0, 0xba, 0x84, 0x04,
+  0x5a, 0xcc, 0xab, 0x89, 0xe0, 0xa4, 0x8c, 0x1a, 0x84, 0xe9, 0x41, 0x38,
+  0x13, 0x0f, 0x5f, 0x40, 0x7a, 0x77, 0x10, 0x95, 0xc6, 0x7c, 0x17, 0xb5,
+  0x0a, 0x9f, 0x0a, 0xc5, 0xa1, 0x6a, 0x09, 0x78, 0x7c, 0x19, 0x06, 0x91,
+  0xe7, 0xd8, 0xc9, 0xea, 0x1b, 0xa7, 0x15, 0x08, 0x46, 0x32, 0x85, 0x91,
+  0xd7, 0x2c, 0xdf, 0xa6, 0x4f, 0xfb, 0x66, 0x9a, 0x3a, 0x10, 0x4a, 0x35,
+  0xae, 0xca, 0x33, 0x78, 0x43, 0xb5, 0x22, 0x22, 0x14, 0x04, 0x96, 0x82,
+  0x80, 0x25, 0x1d, 0xba, 0x70, 0xac, 0xae, 0xf8, 0xbf, 0x88, 0x37, 0xb5,
+  0x2c, 0xea, 0xfe, 0xe9, 0xe9, 0xcd, 0x70, 0x8c, 0xb8, 0xb1, 0x7f, 0xe3,
+  0x27, 0x8b, 0xf9, 0xa0, 0x91, 0x9b, 0x75, 0xda, 0xe7, 0xb1, 0xf0, 0x30,
+  0x3f, 0xa3, 0x74, 0x33, 0x28, 0x5d, 0xc1, 0x9f, 0x79, 0x58, 0x86, 0x88,
+  0x30, 0xc5, 0xf7, 0x5f, 0xbb, 0xbc, 0x72, 0x9e, 0x33, 0x0f, 0xaf, 0x68,
+  0x19, 0xf6, 0x8a, 0x6f, 0x22, 0x42, 0xd8, 0x43, 0xec, 0x01, 0x7e, 0x23,
+  0x12, 0xcb, 0x79, 0x39, 0x00, 0xb5, 0xbe, 0xe1, 0x3f, 0x44, 0xd5, 0x76,
+  0x74, 0xdd, 0xc6, 0x08, 0x14, 0xfc, 0x78, 0xd2, 0xb3, 0x00, 0x33, 0x9f,
+  0xbb, 0xb8, 0xcb, 0x88, 0x7b, 0x47, 0xcf, 0x00, 0x02, 0x15, 0xbc, 0x00,
+  0xd7, 0x09, 0x56, 0x2f, 0x64, 0x34, 0x3c, 0xc5, 0xdb, 0x62, 0x6b, 0x5f,
+  0x0c, 0x53, 0xa8, 0xcc, 0xf1, 0x1b, 0x95, 0x80, 0x58, 0x50, 0xe2, 0x7b,
+  0x8c, 0xb8, 0xd3, 0x63, 0xc1, 0x5f, 0xe6, 0xe8, 0x2f, 0x15, 0xf5, 0x22,
+  0x2e, 0xbf, 0xbc, 0x9d, 0xa0, 0x84, 0xe7, 0x82, 0xa2, 0xfd, 0x5d, 0x41,
+  0x70, 0x56, 0xc3, 0x7e, 0x51, 0x7f, 0x2d, 0x8c, 0xaa, 0xb0, 0x44, 0x2d,
+  0xdb, 0x65, 0x4c, 0x76, 0x7d, 0x72, 0x49, 0x40, 0xca, 0xb9, 0x47, 0xf8,
+  0xce, 0x94, 0x3e, 0xf7, 0x5c, 0xbb, 0x9a, 0x2b, 0xc7, 0xa0, 0x87, 0x7c,
+  0x57, 0xcb, 0xef, 0x12, 0x80, 0x28, 0xd4, 0xf4, 0x86, 0xfb, 0x1e, 0x62,
+  0x7f, 0x0b, 0xdb, 0x6d, 0x2c, 0x16, 0xaa, 0xcd, 0x9a, 0x92, 0xf1, 0x94,
+  0xf1, 0x03, 0x65, 0x5c, 0x24, 0xc1, 0x64, 0xf0, 0x30, 0x1e, 0x4b, 0x79,
+  0x47, 0xea, 0xf8, 0xf2, 0x9d, 0x32, 0x10, 0x07, 0x62, 0x47, 0x94, 0x5d,
+  0x0e, 0xc8, 0x55, 0x6c, 0x62, 0x12, 0x27, 0x57, 0x70, 0xa1, 0x72, 0x1c,
+  0x72, 0x82, 0x7b, 0xb3, 0x99, 0xa8, 0x8c, 0x23, 0x12, 0xff, 0x49, 0xaf,
+  0x68, 0x4b, 0x26, 0xaf, 0xa9, 0x44, 0x12, 0xdc, 0x48, 0x13, 0x39, 0x0b,
+  0x3c, 0xbb, 0xbb, 0xd9, 0x1a, 0xae, 0xe8, 0xe8, 0xa7, 0x53, 0x7c, 0xe0,
+  0x23, 0x18, 0xe2, 0x78, 0x7f, 0xc2, 0x9b, 0x5d, 0xc7, 0xc7, 0x84, 0xd5,
+  0x6a, 0x52, 0x5d, 0x5f, 0xd8, 0xdd, 0x16, 0xd4, 0xbe, 0x97, 0x06, 0x28,
+  0xc1, 0xb4, 0x54, 0x0c, 0xee, 0x82, 0x0b, 0xac, 0xcd, 0x3b, 0xf2, 0x1b,
+  0xa9, 0xca, 0x0f, 0xad, 0x3b, 0xa4, 0x79, 0x58, 0x54, 0x6f, 0x0b, 0x85,
+  0x27, 0xf3, 0xf6, 0xd4, 0x79, 0xfb, 0x45, 0xf3, 0x32, 0xc9, 0x52, 0xa4,
+  0x46, 0x58, 0x3c, 0x34, 0xfe, 0xf8, 0x84, 0xeb, 0x77, 0x9d, 0x28, 0x04,
+  0x89, 0x18, 0xbb, 0x0b, 0xa5, 0x49, 0xc4, 0x21, 0x14, 0x8e, 0x18, 0xfe,
+  0xb1, 0xd4, 0xdc, 0x0a, 0xed, 0xa1, 0x8a, 0x15, 0xed, 0x2b, 0x41, 0x29,
+  0xb9, 0x6c, 0xdf, 0xbd, 0x1a, 0x69, 0xab, 0xa9, 0x62, 0x15, 0x32, 0x50,
+  0xf0, 0x0a, 0x99, 0x14, 0x23, 0x4d, 0xb5, 0x8c, 0x1c, 0x7f, 0xd4, 0x54,
+  0xbb, 0xe1, 0x0a, 0x63, 0xd0, 0x97, 0x8a, 0x98, 0x8f, 0x05, 0xa5, 0x5c,
+  0x34, 0x3e, 0x22, 0xeb, 0x95, 0xbb, 0x8c, 0x6d, 0xc4, 0x01, 0xf8, 0x0b,
+  0x9f, 0x7e, 0x97, 0x34, 0x68, 0x90, 0x94, 0xea, 0x82, 0x7c, 0xb6, 0x6e,
+  0x13, 0x59, 0x5d, 0xc4, 0x0c, 0xf9, 0x1d, 0x26, 0x2c, 0xfd, 0xd2, 0xfd,
+  0x81, 0xeb, 0x48, 0x8c, 0x62, 0x55, 0x0d, 0x79, 0x5e, 0xa0, 0xb4, 0x09,
+  0xe9, 0x94, 0xf7, 0xba, 0x33, 0xdd, 0x53, 0x6a, 0x87, 0x56, 0xc0, 0x40,
+  0xf8, 0x4f, 0x10, 0xd5, 0xa7, 0xe9, 0xbb, 0x8c, 0xfc, 0x04, 0x17, 0x77,
+  0x68, 0x32, 0x57, 0x1f, 0x36, 0x45, 0x61, 0xb1, 0x17, 0x7e, 0x23, 0x00,
+  0xab, 0x62, 0x7f, 0xb5, 0x60, 0x6f, 0x45, 0xe4, 0x8c, 0xdc, 0x41, 0xc9,
+  0x34, 0x77, 0x50, 0x96, 0xb9, 0x1f, 0xa1, 0xdc, 0x19, 0xe6, 0x77, 0xa4,
+  0xaa, 0xf1, 0x55, 0x86, 0xf4, 0xb5, 0x84, 0xe3, 0x9e, 0xcc, 0x33, 0x51,
+  0xb5, 0x5d, 0x50, 0x30, 0x27, 0x37, 0x6f, 0x38, 0xa8, 0xf4, 0xd8, 0xbb,
+  0xc2, 0x96, 0x58, 0x1c, 0x1f, 0xa5, 0x00, 0xb1, 0x01, 0xe6, 0x2e, 0x96,
+  0x79, 0xd9, 0x2e, 0x72, 0xb5, 0xe4, 0xe6, 0x46, 0x8a, 0xcf, 0xa3, 0x6c,
+  0x14, 0x8c, 0xb1, 0x48, 0x92, 0x27, 0x99, 0x65, 0x4c, 0xa1, 0x8a, 0x7b,
+  0x38, 0xda, 0x74, 0x5f, 0x46, 0xc0, 0x97, 0x5f, 0xf9, 0xb0, 0x0a, 0x76,
+  0xfd, 0x13, 0xee, 0xe4, 0x69, 0x77, 0xfa, 0x12, 0x8c, 0xbf, 0x66, 0xfc,
+  0x92, 0x82, 0x14, 0x58, 0xbe, 0x74, 0x36, 0x20, 0xad, 0x67, 0x6e, 0x2f,
+  0x75, 0x37, 0x80, 0x44, 0x37, 0x54, 0xb3, 0xb1, 0x95, 0x5f, 0x01, 0xb8,
+  0xe2, 0xb7, 0x14, 0xe3, 0x1c, 0x7e, 0x94, 0x05, 0xca, 0x4b, 0x20, 0x83,
+  0x5d, 0x5c, 0x75, 0xcd, 0x4e, 0xcb, 0x57, 0x07, 0xaf, 0xc7, 0x1c, 0xdd,
+  0x8f, 0x2d, 0xc2, 0x9d, 0x3d, 0xca, 0x78, 0x3d, 0xf6, 0xe8, 0x4e, 0x6d,
+  0x11, 0xf6, 0xec, 0x66, 0xe5, 0xeb, 0xb1, 0x47, 0xd7, 0x78, 0xb3, 0x13,
+  0x8b, 0xcf, 0xae, 0xb6, 0xc2, 0x2f, 0xbf, 0xa8, 0xdc, 0x2d, 0x86, 0xe5,
+  0x17, 0xc3, 0x84, 0xc1, 0x60, 0x71, 0xc8, 0x7c, 0xb1, 0xf3, 0x62, 0xe2,
+  0xb9, 0x32, 0x5e, 0x34, 0x08, 0x7d, 0x5a, 0xb6, 0x61, 0xf0, 0x62, 0xd4,
+  0xe2, 0xd7, 0x3d, 0x32, 0xf7, 0x7e, 0xa3, 0xed, 0x60, 0x7e, 0x25, 0x65,
+  0x2d, 0xaf, 0x55, 0xba, 0x4e, 0xe9, 0x1d, 0xe0, 0x17, 0xef, 0xa2, 0x48,
+  0x43, 0xe4, 0xfe, 0x94, 0x2b, 0x25, 0x55, 0xaf, 0xcc, 0x1d, 0x2b, 0xc7,
+  0x6e, 0xc5, 0x31, 0xe8, 0xe2, 0xb2, 0xad, 0xbc, 0x92, 0xc1, 0xb1, 0xe5,
+  0x61, 0x24, 0xa6, 0xdd, 0x74, 0xd8, 0xca, 0x6c, 0xe3, 0xa6, 0x61, 0x4f,
+  0x7a, 0xf2, 0xca, 0xad, 0x9e, 0xbf, 0x63, 0x9a, 0xbd, 0xdc, 0x82, 0xc7,
+  0xbb, 0x72, 0x3d, 0xe9, 0xeb, 0x47, 0xf1, 0xed, 0x93, 0x37, 0x12, 0x39,
+  0x97, 0x4d, 0x66, 0xba, 0x3a, 0x04, 0x11, 0xc6, 0xa3, 0xff, 0xc6, 0x4b,
+  0x00, 0xfd, 0x48, 0x9e, 0x67, 0xff, 0xa9, 0xee, 0xca, 0x9b, 0xe2, 0x38,
+  0xb2, 0xfc, 0xff, 0x1b, 0xb1, 0xdf, 0xa1, 0xd4, 0xc3, 0xb8, 0xab, 0x43,
+  0x7d, 0x81, 0x24, 0x1b, 0x73, 0x39, 0x10, 0x42, 0xc7, 0x0c, 0x48, 0x0a,
+  0x81, 0xbc, 0xb3, 0xeb, 0xf1, 0x58, 0x7d, 0x14, 0x50, 0x43, 0x77, 0x57,
+  0x47, 0x55, 0x37, 0x87, 0x14, 0x7c, 0xf7, 0x7d, 0xef, 0xe5, 0x51, 0x79,
+  0x57, 0x35, 0xe0, 0xb5, 0x77, 0x3c, 0x61, 0x03, 0x95, 0x77, 0xbe, 0x7c,
+  0xf9, 0xce, 0x5f, 0xe2, 0xdf, 0x63, 0xa5, 0x8f, 0xd5, 0xae, 0x20, 0x0c,
+  0x81, 0x4d, 0xca, 0xbd, 0x03, 0x55, 0x41, 0xdf, 0x51, 0xb9, 0xd1, 0xe8,
+  0x6a, 0xc6, 0x30, 0xe8, 0x34, 0x19, 0x05, 0x77, 0x4f, 0x9b, 0xad, 0xb9,
+  0x71, 0x81, 0x69, 0x8e, 0x30, 0xf0, 0x66, 0x62, 0x4c, 0x4b, 0x2b, 0xbf,
+  0x1d, 0x58, 0x95, 0xfe, 0xb6, 0xd3, 0xe1, 0x6c, 0xef, 0x9b, 0x3f, 0x08,
+  0x01, 0xef, 0x3a, 0x1e, 0x40, 0xa0, 0x91, 0x8e, 0xae, 0x21, 0x28, 0x2d,
+  0x72, 0xca, 0x92, 0x77, 0xc5, 0xba, 0x23, 0x52, 0xc8, 0xbe, 0x64, 0xb5,
+  0xe1, 0x18, 0x26, 0x21, 0xdf, 0x6d, 0xab, 0x09, 0x48, 0x2c, 0xbe, 0x10,
+  0x04, 0x24, 0x6d, 0x18, 0xd6, 0xb5, 0x40, 0x71, 0x4a, 0x4a, 0xc8, 0x1d,
+  0x6b, 0xd8, 0xe4, 0x2d, 0xe5, 0xdd, 0xc3, 0x02, 0xf9, 0x2c, 0xca, 0x77,
+  0xf3, 0x06, 0xe3, 0x74, 0x99, 0xe1, 0x33, 0xc6, 0x92, 0xeb, 0x92, 0x03,
+  0x12, 0xdc, 0x69, 0x26, 0x12, 0x07, 0x6a, 0x84, 0x4f, 0x38, 0x6b, 0x38,
+  0x03, 0xd4, 0x94, 0x10, 0x5c, 0xa4, 0xdb, 0x87, 0x85, 0xd6, 0x96, 0xed,
+  0x74, 0x69, 0x04, 0xc6, 0x48, 0x57, 0x0b, 0x1f, 0xa4, 0x80, 0x40, 0x9a,
+  0x09, 0x06, 0x48, 0x08, 0x79, 0x01, 0xcf, 0x98, 0x88, 0xd4, 0x76, 0x05,
+  0x13, 0x56, 0x1f, 0x5f, 0x96, 0x7a, 0x34, 0x49, 0xbf, 0x26, 0x5a, 0xa0,
+  0x78, 0x9e, 0x60, 0xac, 0x20, 0x1c, 0xa8, 0x82, 0x25, 0xac, 0xb1, 0x4c,
+  0x35, 0x38, 0xde, 0xa3, 0x4b, 0x35, 0xac, 0xcc, 0x71, 0x7c, 0x53, 0xd9,
+  0x20, 0x37, 0x56, 0x15, 0xfa, 0x29, 0xb6, 0x96, 0x49, 0xea, 0xe0, 0x8b,
+  0x32, 0x83, 0x4d, 0x9a, 0xbd, 0xce, 0x93, 0x05, 0x6f, 0xe6, 0xe5, 0xed,
+  0xbb, 0x71, 0xdc, 0x10, 0x65, 0x0c, 0xdb, 0x57, 0xe9, 0x69, 0xe3, 0xe1,
+  0xe9, 0xa1, 0x36, 0xb0, 0xcc, 0x6f, 0x68, 0x7b, 0xf4, 0x35, 0xa2, 0x84,
+  0xb2, 0x07, 0xc7, 0x52, 0x16, 0xf3, 0xb5, 0xa4, 0x06, 0xbe, 0x87, 0x9a,
+  0x52, 0xcb, 0xf9, 0xda, 0x2a, 0xe3, 0xe4, 0x43, 0x2d, 0x95, 0xa5, 0x42,
+  0xed, 0x88, 0xa0, 0xfa, 0xaa, 0x96, 0x44, 0x39, 0x5f, 0x5b, 0x65, 0x0c,
+  0x7e, 0xa8, 0xa5, 0xb2, 0x94, 0xb7, 0x1d, 0xee, 0x7b, 0x0e, 0x35, 0xc2,
+  0x8a, 0xf8, 0x5a, 0x60, 0x26, 0xa1, 0x40, 0x7d, 0x2a, 0xe0, 0x25, 0x1b,
+  0xee, 0x07, 0x0e, 0x51, 0x0d, 0x2b, 0x42, 0x2d, 0x18, 0x21, 0xe6, 0x3f,
+  0x03, 0xb9, 0x8f, 0x31, 0x38, 0x7f, 0x84, 0xc7, 0x73, 0x04, 0x14, 0x2c,
+  0x93, 0x2a, 0x92, 0x9b, 0xb4, 0x58, 0x98, 0x5a, 0xc2, 0x13, 0x8b, 0xe4,
+  0x2d, 0xe6, 0x8b, 0x09, 0xf1, 0xd7, 0xc4, 0xf9, 0x79, 0x24, 0xb0, 0xcc,
+  0x93, 0x2a, 0x33, 0xcf, 0xc5, 0x59, 0x45, 0x71, 0xec, 0x0c, 0xe1, 0x8f,
+  0x1a, 0x81, 0x38, 0xd5, 0xfb, 0x04, 0x2a, 0xa7, 0x4e, 0xde, 0x50, 0xac,
+  0x12, 0xb6, 0xac, 0x34, 0xa1, 0x08, 0x02, 0xf0, 0xe3, 0x19, 0xba, 0x47,
+  0xf5, 0x06, 0x18, 0x7b, 0x65, 0x79, 0x8f, 0xee, 0xdb, 0x98, 0x97, 0xc0,
+  0x28, 0x19, 0x4f, 0xac, 0x09, 0x8a, 0x96, 0x92, 0x70, 0x23, 0x86, 0x00,
+  0x1b, 0x8d, 0x26, 0xe9, 0xe8, 0x92, 0x8b, 0xca, 0xb9, 0x23, 0xb8, 0x6e,
+  0xb1, 0x9c, 0x9f, 0x48, 0x62, 0xa7, 0x2a, 0x21, 0xdf, 0x90, 0x7a, 0x2e,
+  0x1c, 0x52, 0xa3, 0xb3, 0x5c, 0x37, 0x9b, 0xb1, 0x41, 0xec, 0x46, 0xce,
+  0xdc, 0x5c, 0x3d, 0xac, 0xb5, 0x4c, 0x11, 0xf9, 0xee, 0x3b, 0x19, 0x84,
+  0xae, 0xfe, 0xac, 0x26, 0x84, 0xec, 0x56, 0x25, 0x84, 0x44, 0x6a, 0xf8,
+  0x20, 0x88, 0xf4, 0xf9, 0x00, 0x9a, 0xce, 0xe3, 0x67, 0x2c, 0x52, 0x10,
+  0x47, 0xf8, 0xf4, 0xc0, 0x6b, 0xd4, 0x2a, 0x07, 0xe5, 0xb8, 0x0f, 0xb5,
+  0x2b, 0x8e, 0x40, 0x86, 0x62, 0x3f, 0x05, 0x56, 0x6c, 0x18, 0xf0, 0xac,
+  0x15, 0xb7, 0x0b, 0xb9, 0x5c, 0xad, 0xcd, 0x62, 0xec, 0xb0, 0x6a, 0xab,
+  0x58, 0xa9, 0x3f, 0xe1, 0x46, 0x6d, 0xfc, 0xc0, 0x76, 0xea, 0xf0, 0xe4,
+  0x00, 0x43, 0x3a, 0xff, 0xd8, 0xad, 0x12, 0xc9, 0x96, 0xf5, 0xb7, 0xea,
+  0x98, 0x33, 0xff, 0xca, 0xad, 0x2a, 0x6f, 0x89, 0xd0, 0x56, 0x95, 0xa5,
+  0xfe, 0x34, 0x5b, 0x15, 0x7b, 0x42, 0x64, 0xb7, 0xff, 0xa8, 0xad, 0xd2,
+  0x83, 0xcb, 0x07, 0x67, 0x09, 0x17, 0xdf, 0x84, 0x63, 0x43, 0x20, 0x5e,
+  0x2e, 0x31, 0xbd, 0x23, 0x1a, 0xc0, 0xd6, 0x2d, 0xca, 0xfc, 0x68, 0x9f,
+  0x6f, 0x86, 0xb1, 0x76, 0x6e, 0x5b, 0xb4, 0x4c, 0x82, 0xca, 0xfd, 0x61,
+  0x82, 0x22, 0x50, 0x45, 0xbc, 0x33, 0x44, 0x5d, 0x43, 0x19, 0xb2, 0x64,
+  0xb7, 0x96, 0x47, 0x3e, 0x14, 0xdf, 0xcd, 0x20, 0x48, 0xd6, 0x41, 0xb4,
+  0xf6, 0x8d, 0x77, 0x70, 0xf7, 0x25, 0x2c, 0x1b, 0x72, 0x93, 0x2d, 0x85,
+  0x74, 0x40, 0xfd, 0x66, 0x9e, 0x8c, 0x9b, 0x2b, 0xc9, 0xcc, 0xb4, 0xa4,
+  0xc2, 0xca, 0xca, 0x17, 0xb5, 0x6a, 0xf9, 0x8e, 0x59, 0x71, 0xb1, 0x80,
+  0xed, 0x28, 0x2d, 0x98, 0x48, 0xbf, 0xcb, 0x2e, 0x3c, 0xe7, 0x8a, 0x4e,
+  0xb2, 0x73, 0x6b, 0x3d, 0x7f, 0xc7, 0x95, 0xe4, 0xcd, 0xae, 0xb4, 0x7a,
+  0x62, 0x1a, 0x3f, 0xb1, 0x75, 0x8c, 0xb6, 0xa2, 0x66, 0xd3, 0x7d, 0x79,
+  0x2f, 0xe7, 0x28, 0x23, 0x49, 0x8c, 0x06, 0xc1, 0x10, 0x82, 0x9a, 0x9b,
+  0xa7, 0x8e, 0x9f, 0x89, 0xa8, 0x82, 0x74, 0x30, 0x53, 0x40, 0x70, 0x03,
+  0x91, 0xad, 0xf0, 0x40, 0xfe, 0xe0, 0x62, 0x55, 0xea, 0x58, 0xd0, 0xa9,
+  0x88, 0xe0, 0x81, 0x63, 0xb1, 0xdf, 0x86, 0x8d, 0x1c, 0x57, 0xf7, 0x94,
+  0x45, 0xbb, 0x35, 0x26, 0x19, 0x88, 0x90, 0xf8, 0x87, 0x86, 0x19, 0x07,
+  0x58, 0x39, 0xc6, 0x65, 0x6e, 0x8a, 0x92, 0x96, 0xba, 0x25, 0x96, 0x00,
+  0x8a, 0x0a, 0xdb, 0xc2, 0xa7, 0xa3, 0x58, 0x6b, 0xc1, 0x50, 0xf1, 0x95,
+  0xb1, 0xc1, 0x57, 0x22, 0x04, 0xd4, 0x9e, 0x74, 0x9e, 0x24, 0x05, 0x4c,
+  0xe8, 0xdf, 0x91, 0x21, 0x65, 0xe6, 0x9c, 0x7e, 0x2e, 0x98, 0xcd, 0x08,
+  0x1b, 0x8b, 0xd0, 0x3f, 0x8a, 0x19, 0xd2, 0x72, 0x49, 0x3f, 0xe7, 0x13,
+  0x85, 0x21, 0x85, 0x66, 0x71, 0x5d, 0x7c, 0xa6, 0x79, 0x58, 0xb5, 0xfd,
+  0x73, 0xa0, 0x2a, 0x94, 0xc0, 0xb1, 0x88, 0x9b, 0x5b, 0xbd, 0x5e, 0xb3,
+  0xf5, 0xcb, 0xfa, 0xaf, 0xf2, 0x77, 0xf8, 0xad, 0xff, 0x6b, 0xcd, 0xa9,
+  0x55, 0xed, 0xb9, 0x7e, 0xba, 0xca, 0xdd, 0xfb, 0x29, 0xfa, 0x52, 0x02,
+  0x7d, 0xb0, 0xd9, 0xaf, 0x7d, 0x13, 0x23, 0xbc, 0xc3, 0xa0, 0xb1, 0x2f,
+  0x07, 0xfc, 0x23, 0x88, 0xd0, 0xea, 0x27, 0x33, 0x71, 0xee, 0x15, 0xa3,
+  0xaa, 0x1e, 0x43, 0xa6, 0x24, 0xdd, 0x00, 0x2e, 0x24, 0x7e, 0x3b, 0x63,
+  0x66, 0x56, 0x81, 0xf6, 0xb8, 0x99, 0xc4, 0xe0, 0x40, 0x66, 0x84, 0x3b,
+  0xed, 0xe1, 0x1b, 0xaa, 0xb4, 0xe4, 0x12, 0x8e, 0x14, 0x22, 0x7e, 0x22,
+  0xa7, 0xb3, 0x1d, 0x68, 0xac, 0x94, 0x93, 0xdd, 0x62, 0xf1, 0x4a, 0x0d,
+  0xaa, 0x02, 0x82, 0x4b, 0x1e, 0x08, 0x37, 0x76, 0x67, 0x48, 0x32, 0x72,
+  0xa7, 0x56, 0x90, 0x65, 0x1e, 0xce, 0x88, 0xc2, 0x04, 0xf3, 0x87, 0x4a,
+  0x34, 0x8c, 0x9c, 0x78, 0xab, 0x2e, 0x81, 0xc4, 0x83, 0x54, 0x83, 0xb1,
+  0x5e, 0xaa, 0x42, 0x26, 0x50, 0x71, 0xb2, 0x22, 0x39, 0x90, 0x64, 0x67,
+  0x1d, 0x48, 0xf5, 0x4e, 0x6c, 0x96, 0x8d, 0xc1, 0x15, 0xe2, 0x4a, 0x50,
+  0xa9, 0xbe, 0x3d, 0x7c, 0xbc, 0x46, 0x64, 0xb8, 0xd3, 0x48, 0x3b, 0x08,
+  0xb2, 0x9c, 0x2c, 0x94, 0xbd, 0x1f, 0x70, 0xa4, 0x20, 0xb2, 0x8f, 0x9e,
+  0xc1, 0xd7, 0x0b, 0x9c, 0x6c, 0xee, 0x9c, 0xbf, 0x05, 0x40, 0x64, 0x19,
+  0x59, 0xab, 0x57, 0xca, 0xe4, 0xfd, 0x04, 0xd1, 0xcf, 0x9a, 0xf3, 0x2e,
+  0xd6, 0x6a, 0xf2, 0xde, 0xfb, 0x64, 0x71, 0x9d, 0xe5, 0x97, 0x22, 0x9e,
+  0x60, 0x3a, 0x98, 0xc1, 0x12, 0x4f, 0x4b, 0x48, 0xaa, 0x0a, 0xa3, 0x1d,
+  0xaf, 0xce, 0xc1, 0x8e, 0x0c, 0xdb, 0x1d, 0x4b, 0x0d, 0xc0, 0x90, 0x82,
+  0x43, 0x44, 0x89, 0x3b, 0x4a, 0x0b, 0xe0, 0x6d, 0xa0, 0xa2, 0x34, 0xb3,
+  0xb3, 0x33, 0x0c, 0xc2, 0x82, 0xbd, 0x8b, 0xdd, 0xf1, 0x8d, 0x42, 0x9a,
+  0x69, 0x96, 0xb3, 0x8c, 0x80, 0x42, 0x16, 0x4d, 0x57, 0xfe, 0x12, 0x87,
+  0x43, 0x70, 0xad, 0x96, 0x46, 0x36, 0x66, 0x5b, 0x36, 0xe5, 0xdc, 0xe9,
+  0xd6, 0x1a, 0xff, 0xf8, 0x67, 0xab, 0x0f, 0x1f, 0x88, 0x05, 0x18, 0x0f,
+  0x10, 0x6c, 0x70, 0x0a, 0xd6, 0xd1, 0xd0, 0x66, 0x20, 0x36, 0x6b, 0x54,
+  0xd9, 0x2c, 0x72, 0x2d, 0x46, 0x27, 0x78, 0x27, 0x94, 0x04, 0xcc, 0xf3,
+  0x7e, 0x47, 0xcb, 0x1c, 0x71, 0x66, 0x27, 0xb7, 0xca, 0x35, 0xc3, 0x93,
+  0x3b, 0x19, 0x84, 0xec, 0x58, 0x39, 0x62, 0x96, 0x3d, 0xca, 0xc1, 0x50,
+  0x9e, 0x04, 0x29, 0xd9, 0xc5, 0x3c, 0x3e, 0xf9, 0x8e, 0x16, 0x01, 0xf2,
+  0xcf, 0xe4, 0x4c, 0x31, 0xf9, 0x03, 0x53, 0x00, 0xef, 0x7b, 0xc4, 0x98,
+  0x9f, 0x47, 0x72, 0x02, 0x9b, 0xb3, 0x94, 0x29, 0xcb, 0x6c, 0x37, 0x1d,
+  0xe7, 0xab, 0x4d, 0x38, 0x2f, 0x2b, 0xc6, 0x3c, 0x7b, 0x0d, 0xe7, 0x12,
+  0x42, 0x48, 0x9a, 0xb8, 0x14, 0x9b, 0xb9, 0x40, 0x77, 0xab, 0x77, 0xfc,
+  0xa4, 0x8f, 0x22, 0x6c, 0x33, 0x27, 0xe7, 0x6c, 0x02, 0x37, 0x05, 0x6c,
+  0x9f, 0x54, 0xb4, 0xd2, 0x22, 0x1a, 0x5c, 0x0d, 0xd2, 0x09, 0x5e, 0x82,
+  0xe6, 0x16, 0xf3, 0x34, 0xfa, 0x12, 0x24, 0x0e, 0xee, 0x83, 0x26, 0x42,
+  0x78, 0x9e, 0xe1, 0x13, 0x0b, 0xcd, 0x6a, 0xfb, 0xa3, 0x9c, 0xe3, 0x24,
+  0x1d, 0xe6, 0x18, 0x65, 0x82, 0x94, 0x85, 0x3e, 0x88, 0xc4, 0x61, 0x76,
+  0x34, 0x86, 0xfa, 0x06, 0x83, 0xb3, 0xd8, 0x14, 0x23, 0x82, 0xe9, 0x11,
+  0x99, 0xa8, 0x14, 0xd4, 0x4a, 0x98, 0x23, 0x7c, 0x5c, 0x76, 0x64, 0x04,
+  0xaf, 0x27, 0x8c, 0xf1, 0x24, 0x1b, 0x9f, 0xc0, 0x01, 0x41, 0x7c, 0x24,
+  0x10, 0xfa, 0xde, 0xc1, 0xd6, 0xc6, 0xdc, 0x8f, 0x6a, 0x81, 0x03, 0xb5,
+  0xd0, 0x9d, 0xc3, 0x3f, 0x6a, 0x68, 0x40, 0x8e, 0x08, 0x0c, 0x1a, 0xd7,
+  0x01, 0x2a, 0x35, 0x48, 0x73, 0x7a, 0xaf, 0x98, 0x69, 0x33, 0xc1, 0x7c,
+  0x90, 0x86, 0xbe, 0x48, 0x3f, 0xd9, 0xf1, 0x65, 0x2a, 0x0c, 0x7f, 0x93,
+  0x3f, 0x9e, 0xd1, 0xb4, 0xc2, 0xf1, 0x71, 0xf2, 0xa2, 0x14, 0xa5, 0xa9,
+  0x60, 0xa6, 0x8a, 0x55, 0x4a, 0xe0, 0x74, 0xfb, 0x4b, 0x48, 0xec, 0xe9,
+  0x97, 0x4a, 0xb7, 0x0d, 0xca, 0x5b, 0x58, 0xdf, 0xdc, 0x6c, 0x6f, 0xac,
+  0x3f, 0x6f, 0xaf, 0x3f, 0x5f, 0x6f, 0x47, 0xfd, 0xee, 0xf3, 0x56, 0x23,
+  0x10, 0xc7, 0x16, 0x81, 0xc8, 0x59, 0x31, 0x15, 0x36, 0x84, 0xaa, 0xa9,
+  0xb0, 0x09, 0x87, 0xa6, 0xe2, 0x2b, 0xf1, 0x90, 0xa9, 0x98, 0xf1, 0x2e,
+  0xd2, 0x7c, 0xc2, 0x15, 0x1c, 0x79, 0xa8, 0x4c, 0x15, 0x82, 0x46, 0xf5,
+  0x12, 0x61, 0x47, 0xb7, 0x88, 0x51, 0xb7, 0xcd, 0xc8, 0xc2, 0xd9, 0xe2,
+  0xb5, 0x78, 0xbc, 0x89, 0x91, 0x51, 0x89, 0x78, 0xe5, 0x28, 0x7b, 0x42,
+  0xef, 0x37, 0x58, 0x25, 0x09, 0x1b, 0xab, 0x6d, 0x6a, 0x2f, 0x93, 0xc2,
+  0x28, 0x8a, 0x78, 0x58, 0x46, 0x29, 0x38, 0x83, 0x66, 0x29, 0x84, 0xd3,
+  0x6a, 0x9b, 0x67, 0x95, 0x30, 0x97, 0x14, 0x0a, 0xb6, 0x22, 0xca, 0x8c,
+  0x03, 0xf9, 0x3a, 0x5d, 0xec, 0xe3, 0x53, 0x7a, 0xc0, 0xad, 0xa7, 0x04,
+  0x4e, 0x49, 0x4f, 0xaa, 0xc0, 0x56, 0x8e, 0x30, 0x84, 0xf8, 0x26, 0x51,
+  0xc2, 0x33, 0xc6, 0xc0, 0x4a, 0x67, 0x08, 0xf2, 0x53, 0x44, 0xf1, 0x66,
+  0x9f, 0xc6, 0x1d, 0xdd, 0x44, 0xcf, 0xfa, 0x34, 0xb6, 0x96, 0xd1, 0xee,
+  0x29, 0xc5, 0x89, 0xe4, 0x1c, 0x1a, 0x5f, 0xf3, 0xfe, 0x93, 0x96, 0x93,
+  0xdc, 0xcc, 0x07, 0x2c, 0x3b, 0x7c, 0x98, 0xdc, 0x66, 0x70, 0x3d, 0xf1,
+  0x76, 0x50, 0x45, 0x99, 0x66, 0x43, 0x8c, 0x08, 0x63, 0x28, 0x07, 0x85,
+  0x8d, 0xfc, 0xf3, 0x48, 0x4e, 0x93, 0x80, 0xb3, 0xc4, 0xe3, 0xbb, 0xcd,
+  0xe6, 0xc9, 0x2c, 0xb6, 0x3b, 0xb7, 0x57, 0xf5, 0x50, 0x5b, 0x41, 0x65,
+  0xe1, 0x06, 0x67, 0x98, 0x04, 0x89, 0xed, 0x68, 0x90, 0x1c, 0x5a, 0x2f,
+  0xec, 0xf5, 0x8f, 0xd8, 0xa6, 0x08, 0x7b, 0xfb, 0x1d, 0x5d, 0x33, 0x71,
+  0x8d, 0xcb, 0x37, 0xfc, 0x25, 0x11, 0x90, 0x76, 0xa7, 0x30, 0x67, 0x9c,
+  0xb7, 0x35, 0x24, 0xb5, 0xba, 0x57, 0x28, 0x62, 0xcd, 0xb8, 0x85, 0xa2,
+  0x4a, 0x1b, 0xe6, 0x43, 0x26, 0xe7, 0x8f, 0xb7, 0xd5, 0xbf, 0x32, 0x9d,
+  0x80, 0x98, 0x34, 0xd7, 0x07, 0x7c, 0x7c, 0x1b, 0x58, 0x75, 0xe3, 0xd5,
+  0x20, 0xbf, 0x6c, 0x60, 0x42, 0xd6, 0x11, 0xfd, 0xc9, 0x12, 0xaf, 0x2c,
+  0x77, 0x7d, 0xf3, 0xbf, 0x0e, 0x8f, 0x0e, 0x3e, 0x1c, 0x1f, 0x46, 0xa7,
+  0x1f, 0xa2, 0xfd, 0xa3, 0xd3, 0xfd, 0x77, 0x9f, 0x22, 0x1c, 0xe6, 0xbb,
+  0xf7, 0xfb, 0x47, 0x4d, 0xc7, 0x1e, 0x9c, 0xc0, 0x2d, 0xb7, 0x9c, 0x97,
+  0x14, 0x3f, 0x07, 0x8a, 0x07, 0x69, 0x4d, 0x5c, 0xf2, 0x9e, 0x7d, 0xe7,
+  0xa5, 0x76, 0xa3, 0x78, 0x5a, 0x9c, 0xbb, 0xd6, 0x59, 0x01, 0xd6, 0xc1,
+  0x12, 0x3a, 0xd1, 0x7a, 0x39, 0x1f, 0x6f, 0x37, 0x6e, 0x18, 0xf3, 0x24,
+  0x35, 0x56, 0x1c, 0x0b, 0xda, 0xef, 0x52, 0xd2, 0x37, 0x1a, 0x73, 0x39,
+  0xdb, 0x1e, 0xc1, 0x93, 0x18, 0x8c, 0x57, 0xa8, 0xef, 0x45, 0x84, 0x7d,
+  0x8c, 0x9e, 0xb2, 0x06, 0xba, 0x0e, 0x73, 0x68, 0xb5, 0x37, 0xb1, 0x02,
+  0x67, 0xa3, 0xf4, 0xbf, 0x08, 0x24, 0x20, 0x6d, 0xae, 0xca, 0xae, 0xb0,
+  0x54, 0x1a, 0x0a, 0xf2, 0x3f, 0xe0, 0x45, 0xcb, 0x3a, 0x55, 0xb8, 0x1e,
+  0xfe, 0xdd, 0xf0, 0xc0, 0xc7, 0xb1, 0xc3, 0xe6, 0x86, 0x51, 0xfa, 0x44,
+  0xdc, 0x9c, 0xf9, 0x9c, 0x91, 0xc9, 0x72, 0x5b, 0x46, 0xc1, 0xd3, 0x42,
+  0x60, 0x21, 0x39, 0x6f, 0xc6, 0x9c, 0xed, 0xe5, 0x14, 0x71, 0x7f, 0x35,
+  0xc2, 0xe4, 0x48, 0xb6, 0x75, 0xc8, 0x03, 0x7a, 0xcb, 0x66, 0x88, 0xc7,
+  0xc0, 0x3b, 0x29, 0xf8, 0xcb, 0x29, 0x88, 0x34, 0x42, 0x4e, 0x05, 0xca,
+  0x19, 0x2f, 0x74, 0xd4, 0x57, 0x36, 0x03, 0x15, 0x67, 0x57, 0x9a, 0x5f,
+  0x19, 0xa7, 0xa5, 0x16, 0x63, 0x1e, 0x9f, 0x63, 0x1e, 0x05, 0x13, 0x61,
+  0xca, 0xaf, 0xe6, 0x11, 0xe8, 0x08, 0xb4, 0x88, 0xa8, 0xb1, 0x51, 0x31,
+  0x4f, 0x46, 0x28, 0x78, 0x22, 0x1a, 0x8a, 0x90, 0x3b, 0xd9, 0xcb, 0x18,
+  0x70, 0x44, 0x58, 0xe6, 0x3a, 0x5d, 0x9d, 0xe6, 0x30, 0x69, 0x44, 0xa0,
+  0x3a, 0x0c, 0x46, 0x17, 0x07, 0x4b, 0x50, 0xc9, 0xa6, 0x7f, 0x4f, 0x6e,
+  0xd5, 0x15, 0x89, 0xe3, 0xe4, 0xca, 0x1e, 0x24, 0x19, 0xac, 0xae, 0xba,
+  0x28, 0x6e, 0x13, 0x54, 0x5f, 0x13, 0xba, 0x05, 0xee, 0x3a, 0x6b, 0xb6,
+  0x8c, 0xf3, 0x64, 0x4a, 0xf3, 0x8b, 0x7c, 0xd2, 0x39, 0x96, 0x83, 0xb5,
+  0x94, 0x86, 0xb2, 0xe9, 0x11, 0x94, 0x84, 0xa1, 0xa0, 0x8e, 0x86, 0xbf,
+  0x42, 0xfb, 0x4c, 0x98, 0x9f, 0x36, 0x51, 0xda, 0x55, 0xff, 0x72, 0xdc,
+  0x6c, 0x3d, 0xd8, 0x6d, 0xe5, 0x3d, 0x47, 0x2e, 0x39, 0xff, 0x84, 0x8f,
+  0x9e, 0x7b, 0x2c, 0x46, 0xe2, 0x08, 0xc1, 0x3d, 0x34, 0x47, 0xaa, 0x70,
+  0xa0, 0xeb, 0xe1, 0x6c, 0xf0, 0xa0, 0x20, 0x03, 0x9c, 0x10, 0x28, 0x36,
+  0xad, 0x29, 0xfb, 0x51, 0x05, 0xe1, 0xea, 0xb7, 0x08, 0x4a, 0x6e, 0xfd,
+  0xb5, 0x43, 0x76, 0x87, 0x19, 0x1f, 0xf3, 0x1e, 0x74, 0x14, 0x4b, 0xfc,
+  0xdf, 0xb3, 0x1f, 0xb7, 0x64, 0x2f, 0x71, 0xf3, 0x55, 0xb3, 0x45, 0x98,
+  0x9a, 0x4c, 0xf4, 0x63, 0x28, 0xf8, 0x51, 0x67, 0x8f, 0x4a, 0x44, 0xaf,
+  0x8c, 0x9a, 0x3f, 0xa8, 0x35, 0x4f, 0xf4, 0x9a, 0x94, 0xad, 0x2b, 0x2a,
+  0x9e, 0x18, 0x15, 0x37, 0xd5, 0x8a, 0x87, 0x7a, 0x45, 0xb8, 0x22, 0x44,
+  0xb5, 0x43, 0xbd, 0xda, 0xf3, 0xbe, 0x5a, 0xed, 0x1f, 0x7a, 0x35, 0x24,
+  0x22, 0x59, 0xf1, 0x1f, 0x46, 0xc5, 0x17, 0x6a, 0xc5, 0x0f, 0xbc, 0x62,
+  0x3a, 0x2b, 0x10, 0xd5, 0x51, 0xd4, 0xf9, 0x60, 0xd4, 0xf9, 0x5e, 0xad,
+  0xf3, 0x86, 0xd7, 0x19, 0x83, 0x9c, 0x83, 0xc8, 0xe0, 0xbc, 0xce, 0x1b,
+  0xbd, 0x8e, 0x36, 0xad, 0xb7, 0x40, 0xd2, 0xb4, 0xeb, 0xa8, 0x27, 0x50,
+  0xb6, 0xbb, 0xac, 0xf6, 0x36, 0x74, 0x47, 0x21, 0x19, 0x2b, 0x1b, 0xf6,
+  0x0b, 0xa3, 0x58, 0x6c, 0xf3, 0xd7, 0x7a, 0xfe, 0x70, 0x5f, 0xe5, 0x10,
+  0xdd, 0x12, 0x75, 0x22, 0x90, 0x08, 0x3b, 0xf9, 0x24, 0x8c, 0x16, 0x1c,
+  0xa8, 0x08, 0x33, 0x24, 0x70, 0x71, 0x0b, 0x8c, 0x8b, 0x9d, 0x8d, 0x92,
+  0x30, 0x8d, 0x1f, 0xc1, 0x2d, 0x0f, 0x3c, 0x34, 0xbf, 0x65, 0xa0, 0x59,
+  0x64, 0x70, 0xe4, 0x94, 0x5b, 0xb4, 0x41, 0x04, 0xc4, 0xf7, 0x9c, 0xd0,
+  0x55, 0xdf, 0x8a, 0xce, 0x33, 0xe4, 0xb8, 0x8c, 0xa7, 0xd5, 0xb8, 0x57,
+  0x2d, 0x16, 0x86, 0xf2, 0x04, 0x7b, 0xb9, 0x49, 0x89, 0xf2, 0xe3, 0xb2,
+  0x24, 0xe3, 0xe2, 0x92, 0xbf, 0x63, 0xd2, 0x1d, 0xdc, 0x25, 0x4e, 0x16,
+  0x66, 0x7a, 0x90, 0x5d, 0xf7, 0x50, 0x98, 0xf1, 0x9b, 0x37, 0x91, 0xcd,
+  0xc6, 0xab, 0x7d, 0x4e, 0x76, 0x1d, 0x4a, 0xb3, 0xcb, 0x8a, 0xc4, 0xb2,
+  0xe1, 0x06, 0xe4, 0x0b, 0x4f, 0x54, 0x24, 0x69, 0x31, 0x2c, 0x2c, 0x12,
+  0xda, 0x17, 0xcb, 0xe2, 0x11, 0x30, 0xdc, 0x0e, 0x1c, 0xe7, 0xd5, 0xa4,
+  0xe1, 0xce, 0xe9, 0xb1, 0x10, 0xef, 0xb3, 0x68, 0x92, 0xcd, 0xce, 0xa1,
+  0xd8, 0xb2, 0xc0, 0x04, 0xa1, 0x49, 0x76, 0x9e, 0x8e, 0x22, 0xa9, 0x4c,
+  0x05, 0xee, 0x8d, 0xd2, 0x9a, 0xe4, 0x49, 0xbe, 0x81, 0xf2, 0x1f, 0x31,
+  0x57, 0x09, 0x09, 0x1d, 0x66, 0x70, 0x85, 0x5e, 0xa7, 0x6e, 0xb7, 0x5b,
+  0x8e, 0x16, 0x0d, 0x48, 0x6e, 0x9b, 0xd4, 0x01, 0x99, 0xc6, 0xe0, 0xf2,
+  0x95, 0x00, 0x80, 0xa5, 0x3d, 0x0e, 0x3b, 0xe0, 0x96, 0xb0, 0x90, 0x29,
+  0xca, 0xb2, 0xae, 0xb9, 0x77, 0x5f, 0x07, 0xb5, 0x37, 0xc5, 0x40, 0x20,
+  0xa7, 0x5c, 0xd8, 0xe0, 0x9c, 0xe5, 0x1d, 0x16, 0x53, 0xbd, 0x84, 0x8d,
+  0xfa, 0x57, 0xed, 0x96, 0x47, 0x33, 0x93, 0xf4, 0x71, 0xa0, 0x57, 0x93,
+  0x99, 0xe1, 0xae, 0x58, 0x74, 0x9e, 0x2a, 0xe9, 0x38, 0xe6, 0x6d, 0x39,
+  0x10, 0x83, 0xf6, 0x37, 0xe9, 0x42, 0xfd, 0x08, 0x5c, 0x69, 0x5a, 0x94,
+  0x8e, 0xd4, 0x13, 0x98, 0xf9, 0xe8, 0x82, 0xfd, 0x35, 0xe6, 0x9a, 0x15,
+  0xda, 0xac, 0xe8, 0x61, 0x98, 0x82, 0x3e, 0xba, 0x92, 0xff, 0xd0, 0xc3,
+  0xb7, 0x2f, 0x33, 0x07, 0x65, 0xbb, 0x68, 0xe1, 0x8a, 0x39, 0xc0, 0x75,
+  0x33, 0x14, 0x78, 0x88, 0xe2, 0x56, 0x31, 0x40, 0x29, 0xf9, 0x2b, 0xf7,
+  0xa9, 0xf2, 0x84, 0x37, 0x47, 0x82, 0x22, 0xb5, 0x56, 0x76, 0xa6, 0x74,
+  0x6d, 0x5a, 0xb7, 0x44, 0x8b, 0x6f, 0xcb, 0x22, 0xb1, 0x52, 0xbc, 0x65,
+  0x9a, 0x90, 0xcc, 0xf9, 0x0a, 0x4f, 0x31, 0x0a, 0x26, 0x4d, 0xe9, 0xd5,
+  0x6e, 0xba, 0xec, 0x11, 0xa8, 0x9e, 0x96, 0x7b, 0x47, 0xef, 0x3b, 0xa2,
+  0x47, 0x86, 0x4b, 0x12, 0x88, 0x77, 0x9a, 0xea, 0x9c, 0x99, 0xe7, 0x4d,
+  0x61, 0x41, 0x10, 0x75, 0x36, 0xfb, 0x9b, 0x9b, 0x4d, 0xb7, 0xfe, 0xf2,
+  0xe5, 0xba, 0xd8, 0xea, 0xf5, 0xd6, 0xbe, 0x69, 0xf3, 0xbe, 0xdb, 0x5a,
+  0xfb, 0x86, 0x75, 0xb5, 0x50, 0x91, 0xfb, 0xa9, 0x36, 0x34, 0x90, 0x7c,
+  0x39, 0x32, 0x68, 0xcf, 0xc3, 0x7d, 0xf8, 0xa0, 0x9a, 0x34, 0x28, 0xb9,
+  0x24, 0x5b, 0x62, 0xfc, 0x2b, 0xa0, 0xb9, 0x0e, 0x0a, 0x60, 0x38, 0xea,
+  0x56, 0x8b, 0xed, 0xaa, 0x24, 0x75, 0xd7, 0xb6, 0x8a, 0x44, 0x75, 0x75,
+  0xd2, 0xa5, 0x46, 0x41, 0x0c, 0x25, 0xcf, 0x16, 0xd9, 0x28, 0x43, 0xbd,
+  0x36, 0x41, 0x73, 0x02, 0xc3, 0xd1, 0xbf, 0x12, 0x14, 0x38, 0xa4, 0xf1,
+  0x9c, 0xa1, 0x12, 0xb0, 0xb0, 0xa2, 0x2d, 0xf0, 0x7a, 0x21, 0xbf, 0xac,
+  0x00, 0xd1, 0xc8, 0x93, 0xf9, 0x04, 0x24, 0x86, 0xb8, 0xf7, 0x2f, 0x7c,
+  0xb9, 0xa7, 0xf8, 0x69, 0xeb, 0x9f, 0xbd, 0x7f, 0xf6, 0x7a, 0xed, 0xa8,
+  0xd9, 0x6c, 0x09, 0x4f, 0x7c, 0xcf, 0xf4, 0xc4, 0xe3, 0x63, 0x0d, 0xd4,
+  0x49, 0x79, 0xa0, 0xa3, 0x0e, 0x43, 0xc1, 0x84, 0x7f, 0xcf, 0x81, 0x79,
+  0x2e, 0x81, 0x71, 0xa4, 0xa3, 0x36, 0x3e, 0x83, 0x05, 0x77, 0xf1, 0xc5,
+  0xed, 0xfc, 0x22, 0x51, 0x4d, 0x1d, 0xa4, 0x45, 0xf5, 0xfe, 0xf5, 0xcb,
+  0xa0, 0xf3, 0x75, 0xbf, 0xf3, 0x3f, 0xfd, 0xce, 0x8f, 0xdd, 0xce, 0xaf,
+  0x4f, 0xd7, 0x7a, 0x70, 0x4d, 0x16, 0x8b, 0x98, 0x8f, 0xb1, 0xe5, 0xd9,
+  0xf6, 0xeb, 0x41, 0x3e, 0x8b, 0x1b, 0xef, 0x66, 0xd4, 0xb7, 0xb6, 0xec,
+  0x6d, 0x1e, 0x46, 0xc5, 0xd3, 0xa9, 0xdc, 0x31, 0xad, 0x3a, 0xf5, 0xfb,
+  0x23, 0x5b, 0xf9, 0x28, 0xaa, 0xbd, 0x0f, 0xc2, 0x17, 0x54, 0xd2, 0x9c,
+  0xc2, 0xe6, 0x89, 0xed, 0x41, 0x8b, 0xc0, 0xb5, 0xe8, 0x5e, 0x0a, 0x11,
+  0x83, 0xc3, 0x39, 0x62, 0xd0, 0x40, 0xcd, 0x4b, 0x45, 0x59, 0x68, 0x97,
+  0x87, 0x46, 0x6f, 0x12, 0x9d, 0xc3, 0xa5, 0x9e, 0xaa, 0x34, 0x06, 0x7b,
+  0x04, 0x1d, 0xb9, 0x6e, 0x9c, 0xeb, 0xc2, 0xba, 0x65, 0xfc, 0x1e, 0xe6,
+  0x3b, 0xab, 0x43, 0x60, 0xbd, 0x64, 0x90, 0x44, 0x87, 0x56, 0x34, 0x56,
+  0xa2, 0x2f, 0x26, 0x83, 0x73, 0xe6, 0xa1, 0x9a, 0x02, 0x01, 0x01, 0x35,
+  0xdd, 0x3a, 0x1f, 0x2c, 0xa9, 0xeb, 0xd7, 0x35, 0x49, 0xbf, 0x4e, 0x7c,
+  0x8a, 0x9b, 0x2f, 0xd7, 0x0b, 0x53, 0x51, 0x46, 0xa8, 0xf8, 0x15, 0x45,
+  0xf8, 0x08, 0x87, 0x73, 0x37, 0x99, 0x1f, 0x48, 0x13, 0x5f, 0xf4, 0x3d,
+  0xf1, 0xe4, 0xae, 0x5c, 0x8b, 0x9b, 0x4d, 0x8e, 0x3d, 0xa6, 0x61, 0xb9,
+  0xee, 0xef, 0xeb, 0xa2, 0xcb, 0xf2, 0x8f, 0x4f, 0x51, 0xf7, 0xdd, 0x8d,
+  0x1a, 0x94, 0xc0, 0xca, 0x32, 0x82, 0x1b, 0xb6, 0x0d, 0x4a, 0xb6, 0xa8,
+  0x0b, 0x9b, 0xda, 0x40, 0x1f, 0x0e, 0xb5, 0xcd, 0x50, 0x53, 0xca, 0xe1,
+  0xaf, 0x62, 0x74, 0xe2, 0x75, 0x4b, 0xe2, 0x6c, 0xb8, 0xa6, 0xad, 0x46,
+  0x92, 0x39, 0xdc, 0xd5, 0x1c, 0xa4, 0xd9, 0xed, 0xad, 0x2c, 0xb9, 0xbc,
+  0x1b, 0x15, 0x98, 0xec, 0x89, 0xe5, 0x09, 0xd7, 0x85, 0xfe, 0x20, 0x87,
+  0xaf, 0xbd, 0xc2, 0x1e, 0x2b, 0xd3, 0x75, 0x11, 0x80, 0x50, 0x86, 0x9d,
+  0xce, 0x66, 0x68, 0xcd, 0x46, 0xa5, 0x3d, 0xec, 0x2f, 0x6f, 0x58, 0xfc,
+  0xc9, 0x72, 0x17, 0xda, 0xcb, 0x68, 0xb9, 0xcc, 0xf1, 0x00, 0x33, 0xcc,
+  0x63, 0x4a, 0x9e, 0x2f, 0x98, 0xfe, 0xf6, 0x35, 0xc9, 0x51, 0xbd, 0x62,
+  0xda, 0x98, 0xb2, 0x4d, 0x6d, 0x05, 0x09, 0x85, 0x1e, 0x30, 0xe2, 0x20,
+  0x26, 0x05, 0x6e, 0x73, 0xbe, 0x98, 0xdc, 0xd6, 0x01, 0xae, 0xf5, 0x94,
+  0x39, 0x61, 0xa1, 0x5c, 0xfd, 0x2a, 0xd0, 0xd5, 0xbe, 0x39, 0xfe, 0x0f,
+  0x33, 0x60, 0x2c, 0xde, 0xe0, 0x13, 0xa6, 0xd4, 0x15, 0x4b, 0x42, 0x52,
+  0x3c, 0x5b, 0x4e, 0x94, 0xd9, 0x04, 0x3d, 0x2c, 0x0c, 0xba, 0x5d, 0xe3,
+  0xc6, 0x93, 0x2c, 0x9b, 0x17, 0xc6, 0x69, 0xd3, 0xdd, 0xe1, 0x5e, 0x3b,
+  0xfe, 0x63, 0x07, 0x14, 0xad, 0xe2, 0xd4, 0xd7, 0xcd, 0xfc, 0xed, 0xe8,
+  0x85, 0xe5, 0x9e, 0x57, 0xf9, 0x9b, 0x97, 0x4b, 0x3c, 0x72, 0x68, 0xb5,
+  0x93, 0xf2, 0x45, 0xe0, 0xef, 0x2e, 0xda, 0xdf, 0x60, 0x1b, 0xdc, 0x46,
+  0xc0, 0x27, 0x81, 0x41, 0x38, 0x30, 0x4f, 0x0c, 0x43, 0x83, 0x86, 0x46,
+  0x4d, 0xbd, 0x74, 0x3d, 0x0f, 0x62, 0xd4, 0xc4, 0xc7, 0xd7, 0xb3, 0xf3,
+  0xfd, 0x2f, 0x6f, 0xb8, 0xad, 0x28, 0xa1, 0xa1, 0xba, 0xb0, 0xef, 0x29,
+  0x51, 0xf5, 0xa5, 0x0d, 0x1e, 0x51, 0x66, 0xac, 0x0b, 0x84, 0x09, 0xd3,
+  0x92, 0x7b, 0xff, 0x3e, 0x5f, 0x4e, 0xb2, 0xa1, 0xd5, 0x19, 0xbd, 0x67,
+  0x47, 0x89, 0xac, 0x83, 0x72, 0x48, 0x71, 0xcb, 0xa4, 0xd3, 0x2e, 0x22,
+  0x24, 0xc5, 0x12, 0xee, 0x02, 0xf6, 0xd3, 0x89, 0x83, 0x61, 0xd7, 0xa3,
+  0x3b, 0x29, 0x16, 0x77, 0x12, 0xd4, 0xf3, 0xde, 0x44, 0xec, 0xe9, 0x28,
+  0x7c, 0xe0, 0x7e, 0x28, 0xb2, 0x37, 0xcb, 0xcb, 0x68, 0x75, 0x22, 0x24,
+  0xe1, 0x27, 0x40, 0x82, 0x3e, 0x26, 0x8c, 0xd5, 0x58, 0xc7, 0x44, 0x54,
+  0x38, 0x26, 0xf1, 0x33, 0x1c, 0xee, 0x22, 0x9b, 0x19, 0x10, 0x33, 0x46,
+  0xe6, 0xb9, 0x69, 0xf0, 0xbd, 0x9d, 0x8d, 0x2e, 0xf2, 0x6c, 0x86, 0x5a,
+  0xa7, 0x11, 0x57, 0x5a, 0xf3, 0x7e, 0x54, 0xc4, 0x0c, 0xa6, 0xee, 0xbb,
+  0xf8, 0x26, 0x1e, 0x7d, 0x19, 0x6f, 0x8f, 0x5a, 0x07, 0x67, 0x9c, 0x76,
+  0x18, 0x14, 0x49, 0x77, 0xa9, 0x90, 0xd0, 0x3c, 0x67, 0xb2, 0x6e, 0x4c,
+  0x93, 0x2f, 0xd6, 0x8c, 0x2d, 0x62, 0x37, 0x92, 0x97, 0x3a, 0xba, 0x7f,
+  0xba, 0x5d, 0x4f, 0xe0, 0x62, 0x58, 0x04, 0xf0, 0x05, 0x2d, 0x7a, 0xc3,
+  0x23, 0x7d, 0xdd, 0xc8, 0x00, 0x2c, 0x12, 0x68, 0xd9, 0x85, 0x22, 0xbc,
+  0x08, 0x8a, 0xbc, 0xfb, 0xd0, 0x68, 0xc5, 0x3a, 0xb4, 0x99, 0xf0, 0xbc,
+  0x06, 0xe5, 0x58, 0x84, 0xa4, 0x35, 0x45, 0xc0, 0x11, 0x99, 0x22, 0x2e,
+  0x11, 0xad, 0x06, 0x35, 0x61, 0x04, 0x6b, 0x36, 0x6b, 0x22, 0x02, 0xef,
+  0x64, 0x62, 0x2f, 0x7c, 0x74, 0x91, 0xe4, 0xe8, 0x15, 0x17, 0xa7, 0xe7,
+  0x9a, 0x10, 0xe9, 0x99, 0xe7, 0x3c, 0x5d, 0x04, 0x2f, 0x5a, 0xfe, 0x40,
+  0x74, 0x85, 0xde, 0x53, 0x23, 0x3a, 0x93, 0x69, 0x3e, 0x4e, 0xad, 0x8d,
+  0x74, 0xbf, 0x49, 0x30, 0x91, 0xc4, 0x52, 0x79, 0x7e, 0x67, 0x55, 0x2d,
+  0xa0, 0x7d, 0x39, 0x6c, 0xbc, 0x52, 0xcf, 0x32, 0xac, 0xd3, 0xc9, 0x0d,
+  0x3e, 0x96, 0x90, 0x62, 0x70, 0xa2, 0xe2, 0x82, 0x9c, 0x32, 0x0c, 0x6a,
+  0xa8, 0x70, 0x59, 0xb8, 0xa8, 0x52, 0x95, 0x32, 0x0d, 0x53, 0xa0, 0xf7,
+  0x42, 0x0e, 0x97, 0x13, 0x3c, 0x33, 0x5c, 0x4a, 0x50, 0xaf, 0x83, 0x1f,
+  0x95, 0x1c, 0x89, 0x35, 0x65, 0xbc, 0xb9, 0xc2, 0xf8, 0x42, 0x0f, 0xff,
+  0x63, 0xb8, 0xee, 0xf4, 0x95, 0x0c, 0x8b, 0x51, 0xbe, 0x87, 0xbf, 0xf4,
+  0x92, 0xfc, 0xf9, 0xb7, 0x77, 0xef, 0xdf, 0x78, 0xc5, 0x2e, 0xa8, 0x4e,
+  0x23, 0x8a, 0xe9, 0x49, 0xbb, 0xa8, 0xc1, 0x1e, 0xa6, 0x55, 0x78, 0x41,
+  0x23, 0x1c, 0x6b, 0x71, 0x0f, 0x43, 0x3c, 0x9f, 0x7a, 0xa5, 0xbe, 0x75,
+  0x17, 0xbe, 0x03, 0xbc, 0xf6, 0x79, 0xff, 0xf1, 0xf7, 0xe7, 0x6a, 0x89,
+  0x67, 0x72, 0x56, 0x35, 0x84, 0x3b, 0xf8, 0xb6, 0x71, 0xda, 0x18, 0xaf,
+  0x11, 0xe5, 0xc8, 0x74, 0xc1, 0x29, 0x41, 0xfc, 0x6d, 0x1c, 0xc1, 0xa2,
+  0xc0, 0xdf, 0xa7, 0x83, 0x9b, 0x52, 0xd8, 0x87, 0x22, 0xf8, 0x79, 0x65,
+  0xab, 0x7a, 0x18, 0x7d, 0xc2, 0xd1, 0x88, 0x14, 0xb7, 0x4b, 0xa8, 0x19,
+  0x7c, 0xf3, 0xb0, 0x7c, 0x3b, 0x70, 0xff, 0xf4, 0xf4, 0xf0, 0xf8, 0xe3,
+  0xa9, 0x09, 0x37, 0xa3, 0xdd, 0x3d, 0xc7, 0x30, 0x74, 0x27, 0x0f, 0x11,
+  0xf3, 0xe8, 0xe2, 0x8b, 0xc7, 0xa3, 0xcb, 0x48, 0xc9, 0x58, 0x21, 0xd3,
+  0x93, 0xfb, 0xa2, 0xaa, 0x9e, 0x84, 0xf6, 0x24, 0x5e, 0x68, 0x64, 0xef,
+  0x33, 0x25, 0xa8, 0x58, 0x0c, 0xef, 0x3e, 0xbd, 0x7a, 0x96, 0xed, 0xe9,
+  0x53, 0xfb, 0x79, 0x98, 0x84, 0xe1, 0x42, 0xf2, 0xd5, 0x34, 0x5e, 0x61,
+  0x44, 0x60, 0x7d, 0x84, 0xca, 0x9e, 0x67, 0xd7, 0x08, 0xee, 0xe8, 0xdb,
+  0x0d, 0x0e, 0xb6, 0xec, 0xb1, 0xdc, 0xa8, 0x42, 0x05, 0x42, 0xe6, 0xac,
+  0x7d, 0x63, 0x9d, 0xf6, 0x28, 0x62, 0xf9, 0xae, 0x40, 0x4f, 0x50, 0xbc,
+  0xf6, 0xcd, 0xd3, 0xf8, 0x5d, 0x6f, 0xed, 0x5b, 0x70, 0xab, 0xef, 0x5a,
+  0x86, 0xe5, 0xc7, 0xe3, 0x7c, 0x09, 0x6b, 0x8d, 0xf5, 0x3c, 0x36, 0xfe,
+  0xe0, 0x72, 0x2d, 0x46, 0x7e, 0xf5, 0x60, 0xf3, 0x55, 0x12, 0x26, 0xda,
+  0x6c, 0xd3, 0x6a, 0x04, 0x74, 0xef, 0xcf, 0xe7, 0xc0, 0xd9, 0xf1, 0x95,
+  0x50, 0x16, 0x4a, 0x59, 0x61, 0x60, 0xc1, 0x70, 0x32, 0x8a, 0x33, 0xab,
+  0x70, 0x15, 0x69, 0x11, 0xcb, 0x45, 0x45, 0xc4, 0x32, 0xc1, 0x13, 0xe6,
+  0x97, 0x8d, 0x90, 0x4e, 0x5b, 0x2e, 0x20, 0x0f, 0x4f, 0xc4, 0x11, 0x15,
+  0x21, 0x4d, 0x97, 0x17, 0xe9, 0x2e, 0x78, 0x10, 0xf5, 0xff, 0xef, 0x50,
+  0x5f, 0xcf, 0x35, 0x62, 0x07, 0x03, 0x3a, 0x02, 0xfd, 0x56, 0x47, 0xdc,
+  0x19, 0x20, 0x55, 0x90, 0x0c, 0x2d, 0x09, 0xe3, 0x9e, 0x48, 0x3b, 0x8c,
+  0xbe, 0x28, 0x1e, 0xb1, 0x16, 0x81, 0xd1, 0xe8, 0x7f, 0x0f, 0x0a, 0x9b,
+  0x38, 0xe2, 0x1f, 0xff, 0x8f, 0x49, 0xec, 0xcf, 0x1c, 0x18, 0xbf, 0x12,
+  0x89, 0xbd, 0x32, 0x4f, 0xeb, 0x03, 0x28, 0x4c, 0x21, 0x8d, 0x7b, 0x92,
+  0xd8, 0x67, 0x1a, 0xa0, 0xc8, 0xb1, 0x60, 0x69, 0x8d, 0x98, 0x84, 0x1a,
+  0xa2, 0x34, 0x7b, 0x52, 0x58, 0xc3, 0x32, 0x0c, 0xbb, 0xc0, 0x91, 0x7c,
+  0xe9, 0xe5, 0x4a, 0x11, 0x13, 0x14, 0x1e, 0x7e, 0x5b, 0x69, 0x46, 0xa7,
+  0xd4, 0x54, 0x34, 0x84, 0x8b, 0x3e, 0x49, 0x66, 0x6c, 0x66, 0x41, 0xd3,
+  0xb7, 0xd2, 0x77, 0x2d, 0x1f, 0x3e, 0x4f, 0x9c, 0x7a, 0xf4, 0xfc, 0x12,
+  0xf3, 0x70, 0xe9, 0xfd, 0x94, 0x91, 0xc9, 0x8e, 0x98, 0x27, 0xf5, 0x6a,
+  0xa9, 0x63, 0x2a, 0xd0, 0x59, 0x45, 0x95, 0xdd, 0xec, 0x71, 0x8c, 0xa3,
+  0x2b, 0x53, 0x39, 0xed, 0x0b, 0xf9, 0xa3, 0x1e, 0x40, 0xdf, 0x27, 0x98,
+  0x9a, 0x89, 0x48, 0xe6, 0x69, 0x36, 0xc6, 0x70, 0x1b, 0xa6, 0x42, 0xf2,
+  0xe8, 0xa5, 0x20, 0x3b, 0xc5, 0x8a, 0x1f, 0x79, 0xbd, 0x03, 0x56, 0xde,
+  0xd6, 0x9e, 0x99, 0xf2, 0x2a, 0xbc, 0x92, 0x04, 0x53, 0x74, 0x85, 0xa9,
+  0x0b, 0xe8, 0x4a, 0x70, 0x49, 0xda, 0xbc, 0xe3, 0x77, 0xbc, 0xa0, 0x2b,
+  0x0a, 0x46, 0x7c, 0xf3, 0xd4, 0x08, 0x8b, 0xa4, 0x46, 0x69, 0x26, 0x96,
+  0xc9, 0x16, 0x63, 0xb7, 0xe1, 0xd9, 0xc5, 0xc5, 0xa5, 0xf0, 0x65, 0xa7,
+  0x4c, 0xd8, 0x6a, 0x3c, 0x0b, 0x73, 0xcb, 0xce, 0xc5, 0xf2, 0x2e, 0x49,
+  0xb9, 0xc6, 0x68, 0x0c, 0x9e, 0x6b, 0x6d, 0x29, 0xb7, 0x78, 0x05, 0x9d,
+  0xb3, 0x37, 0xa5, 0x3e, 0x93, 0x14, 0xdb, 0xb2, 0x14, 0x67, 0x6d, 0x81,
+  0x47, 0x14, 0xad, 0x30, 0xca, 0xb3, 0xc9, 0x84, 0xde, 0x02, 0x34, 0xdf,
+  0x7d, 0x55, 0xcf, 0xe7, 0x50, 0x3c, 0xaf, 0xa9, 0x10, 0x27, 0xfb, 0xdb,
+  0xb6, 0x0b, 0xdb, 0x9b, 0x17, 0x87, 0x99, 0x0f, 0xf9, 0xb3, 0xa0, 0x20,
+  0x62, 0x16, 0xe6, 0xef, 0x25, 0xe4, 0xa2, 0x22, 0x2c, 0x9b, 0x6f, 0xc1,
+  0x3b, 0x14, 0x6b, 0xc3, 0xae, 0x4a, 0x84, 0x84, 0xa4, 0xa2, 0x86, 0xfd,
+  0xf3, 0x11, 0x74, 0xe8, 0xf9, 0x03, 0xc2, 0xca, 0x72, 0xf4, 0x6c, 0x23,
+  0xb4, 0x1a, 0x6e, 0x6a, 0x25, 0xff, 0x86, 0x61, 0xb6, 0x00, 0x37, 0x8f,
+  0x2e, 0xf1, 0x55, 0x47, 0xb7, 0x6b, 0xc8, 0x3a, 0xc0, 0x44, 0x7d, 0xb1,
+  0xdd, 0x8f, 0x91, 0xf7, 0x55, 0xa1, 0xe5, 0x7b, 0x0e, 0xf3, 0x78, 0x49,
+  0x2f, 0x85, 0xcb, 0x83, 0xc8, 0x09, 0xd5, 0xa3, 0xed, 0xfb, 0x41, 0xd3,
+  0xef, 0x64, 0x02, 0xc8, 0xcb, 0xcf, 0xaf, 0x5f, 0x1f, 0x7e, 0xfa, 0xed,
+  0xe0, 0xe8, 0x70, 0xff, 0xfd, 0xe7, 0x8f, 0xbf, 0xe1, 0xfb, 0x2f, 0x9f,
+  0x7e, 0xde, 0x3f, 0xaa, 0x21, 0xb6, 0xd7, 0xa5, 0x54, 0x07, 0x57, 0x30,
+  0xa9, 0xd6, 0x7a, 0xf2, 0x31, 0xc9, 0x29, 0xa0, 0x65, 0x36, 0x4a, 0xba,
+  0xac, 0x0b, 0x27, 0x10, 0x35, 0x46, 0x00, 0xa2, 0xb9, 0xd3, 0x2e, 0x8e,
+  0x1a, 0xcd, 0xf8, 0x6f, 0x27, 0x6f, 0x93, 0xc1, 0x1c, 0x73, 0xc3, 0x48,
+  0x89, 0xdb, 0x78, 0xce, 0xff, 0xe3, 0xc5, 0x00, 0xe7, 0x09, 0x89, 0xd9,
+  0x82, 0x8e, 0xbc, 0xab, 0x59, 0xfa, 0x76, 0xaf, 0x76, 0x05, 0xed, 0x7e,
+  0xe1, 0x4f, 0xc0, 0x75, 0x10, 0x89, 0x63, 0x8c, 0xe0, 0x39, 0x38, 0xd4,
+  0xbb, 0xe3, 0x97, 0x6d, 0xb8, 0x72, 0x17, 0x98, 0x5e, 0xb1, 0xf6, 0x8d,
+  0x7a, 0x81, 0x3f, 0x7d, 0x59, 0x8d, 0x49, 0x73, 0xf6, 0xaa, 0x00, 0xba,
+  0xc2, 0x86, 0x10, 0x78, 0xf0, 0x72, 0x86, 0x6e, 0x8f, 0xb0, 0x81, 0xd3,
+  0xcd, 0x9a, 0x29, 0x76, 0xd7, 0x24, 0xb7, 0xdf, 0x9d, 0x25, 0xfb, 0xf9,
+  0xb0, 0x6d, 0xa8, 0x5a, 0xc5, 0x0e, 0xbb, 0x52, 0xa4, 0x0c, 0x74, 0xad,
+  0xf1, 0x17, 0x4f, 0x14, 0xc0, 0x2a, 0xc9, 0x1b, 0x7e, 0xaf, 0x8e, 0x8c,
+  0xcd, 0x71, 0x59, 0xa8, 0xeb, 0x47, 0xc3, 0x18, 0x1e, 0x7c, 0x57, 0xa4,
+  0x8e, 0x09, 0x63, 0x82, 0xa1, 0xc0, 0x8e, 0x34, 0xe0, 0xa0, 0xc4, 0xe2,
+  0x8d, 0x33, 0x26, 0x0e, 0xf8, 0x78, 0xf1, 0xc5, 0xac, 0x25, 0x35, 0x4f,
+  0xb9, 0xbe, 0x5d, 0x53, 0xa4, 0xa1, 0xae, 0x1a, 0xcc, 0xaa, 0xa4, 0x97,
+  0xe3, 0x7d, 0x80, 0x4a, 0x42, 0x3a, 0xaa, 0x0c, 0xed, 0x2b, 0x13, 0xa5,
+  0x6a, 0x08, 0xbf, 0xf2, 0x1e, 0x93, 0x7d, 0xe1, 0x14, 0x0d, 0xb8, 0xa9,
+  0x6e, 0xb7, 0x6b, 0x41, 0x5e, 0x92, 0x59, 0xc7, 0x85, 0xf3, 0xea, 0xf1,
+  0x74, 0xfb, 0x92, 0x47, 0xac, 0xa0, 0xa0, 0x30, 0xbc, 0x87, 0x0b, 0xf9,
+  0xcf, 0x5d, 0x40, 0x43, 0x72, 0xb4, 0x8b, 0x18, 0x90, 0x74, 0xba, 0x22,
+  0xec, 0x47, 0xc2, 0x08, 0xaf, 0x42, 0x99, 0xb9, 0xbf, 0xe2, 0x2a, 0x54,
+  0xd9, 0xb5, 0x4c, 0x9f, 0x6b, 0x2d, 0x19, 0x98, 0xd1, 0x9f, 0x43, 0xe6,
+  0xf5, 0xe6, 0x2d, 0xf2, 0x16, 0x30, 0xa2, 0xc6, 0xc5, 0xac, 0x43, 0x89,
+  0xa2, 0x2c, 0xab, 0x8a, 0x55, 0x68, 0xb6, 0x45, 0x4b, 0x66, 0x57, 0x7e,
+  0x04, 0x17, 0x2f, 0x61, 0x9a, 0x50, 0x72, 0xe5, 0x6a, 0x8f, 0x95, 0x68,
+  0x99, 0xc9, 0xad, 0x3b, 0xe8, 0xf2, 0xb1, 0x33, 0x17, 0x1d, 0x40, 0x6c,
+  0xe1, 0x58, 0x32, 0x79, 0xae, 0x38, 0x6e, 0x3d, 0x35, 0xfa, 0x98, 0x89,
+  0x8b, 0xb0, 0x7b, 0x1f, 0x97, 0x43, 0x60, 0x0c, 0xd1, 0xfe, 0xc7, 0x77,
+  0xe2, 0x8f, 0xbc, 0xbe, 0x2a, 0xcb, 0xc8, 0x39, 0x28, 0x86, 0x12, 0x45,
+  0x51, 0x6e, 0x5b, 0xb7, 0x88, 0xec, 0x8b, 0x0f, 0xe0, 0xae, 0xa5, 0x6c,
+  0x14, 0x22, 0x3a, 0x4c, 0xb2, 0x21, 0x6a, 0x46, 0x9c, 0xef, 0x30, 0xf8,
+  0x9c, 0xb7, 0xa7, 0xc7, 0x47, 0x91, 0x80, 0x30, 0x92, 0xde, 0xbf, 0x58,
+  0x24, 0x21, 0xd3, 0x6b, 0x52, 0x39, 0x02, 0x80, 0xcc, 0x61, 0x3d, 0x86,
+  0xe9, 0x24, 0x5d, 0xdc, 0xf2, 0x88, 0x8a, 0x2a, 0xed, 0x9d, 0xad, 0xbc,
+  0x64, 0x49, 0x5a, 0x29, 0x31, 0x42, 0x65, 0x74, 0x0a, 0xef, 0xa4, 0xc8,
+  0x4e, 0x04, 0xaf, 0x4d, 0x0b, 0x8e, 0x56, 0x61, 0xf4, 0x88, 0x6b, 0xe3,
+  0x02, 0xdd, 0x30, 0xba, 0x54, 0x19, 0x6b, 0xd9, 0x63, 0x14, 0xed, 0xf4,
+  0x40, 0x8f, 0x49, 0xe7, 0x8b, 0x3d, 0xfa, 0x85, 0xde, 0xbc, 0xdb, 0xe3,
+  0xb9, 0xc2, 0x9b, 0x9b, 0xfd, 0x7e, 0x74, 0x48, 0x59, 0x96, 0x59, 0xbe,
+  0xd3, 0x63, 0xdf, 0xfe, 0xf3, 0x3f, 0x76, 0x7a, 0x17, 0xc9, 0x60, 0xbc,
+  0x87, 0xc3, 0xdd, 0x19, 0x66, 0xe3, 0x5b, 0x58, 0x31, 0x1c, 0xd8, 0x6e,
+  0x43, 0x1f, 0xc9, 0x76, 0x63, 0x4f, 0xb0, 0xc8, 0x9d, 0x71, 0x7a, 0xc5,
+  0xba, 0x24, 0xe8, 0xbd, 0xdd, 0x06, 0xd7, 0x09, 0xb6, 0xe0, 0x22, 0x4f,
+  0x6e, 0xb6, 0x23, 0x18, 0xd6, 0xf9, 0xac, 0x93, 0x02, 0xef, 0x28, 0xb6,
+  0xa2, 0x51, 0x82, 0x52, 0xca, 0x76, 0xf4, 0xef, 0x25, 0x68, 0xb1, 0x67,
+  0xb7, 0x9d, 0x11, 0xb3, 0xbd, 0x94, 0x1f, 0xb0, 0x4e, 0xe7, 0x3a, 0xc7,
+  0xf7, 0x98, 0xf1, 0xdf, 0xdb, 0xd1, 0x39, 0xfe, 0xb8, 0xbe, 0x31, 0xbf,
+  0x89, 0x36, 0xe7, 0x37, 0xf8, 0xa4, 0xe6, 0x18, 0x05, 0x96, 0xce, 0x30,
+  0x83, 0xf3, 0x39, 0xdd, 0x62, 0x7f, 0xa4, 0xc7, 0x51, 0xb7, 0xd0, 0x05,
+  0xf1, 0x57, 0x1a, 0x18, 0x0e, 0x66, 0xe7, 0x49, 0xa7, 0x83, 0xdc, 0x08,
+  0x51, 0x86, 0xe8, 0xa1, 0x56, 0x01, 0x26, 0x30, 0x28, 0x58, 0x80, 0x74,
+  0x8a, 0x49, 0xa1, 0xd7, 0x74, 0x20, 0x70, 0x9d, 0xf9, 0x73, 0xbf, 0x64,
+  0x94, 0xea, 0x74, 0x44, 0x23, 0x34, 0xa5, 0x3d, 0xb1, 0xea, 0x5d, 0x16,
+  0xd9, 0xd5, 0x19, 0x2e, 0x34, 0x02, 0x9e, 0x0e, 0xf2, 0xf3, 0x74, 0xd6,
+  0xc1, 0x9c, 0x3b, 0x36, 0xa0, 0xf2, 0x13, 0x1f, 0xee, 0x56, 0x84, 0x13,
+  0x58, 0x7f, 0xae, 0x7d, 0x1b, 0xd2, 0xd3, 0xf6, 0x9d, 0x7c, 0x30, 0x4e,
+  0xf1, 0x29, 0xad, 0x0d, 0xc7, 0x47, 0x56, 0x0f, 0x8e, 0x7e, 0x3a, 0x8e,
+  0xb8, 0x55, 0x52, 0x2d, 0xa3, 0x58, 0x0f, 0xff, 0xf2, 0xec, 0xc5, 0x0f,
+  0xfb, 0x2f, 0x5f, 0x69, 0x3e, 0x21, 0x7a, 0xdc, 0xd9, 0xae, 0x86, 0x58,
+  0x10, 0x9d, 0x82, 0xc0, 0x20, 0xd6, 0xbb, 0xeb, 0xb0, 0x2c, 0x2a, 0xd8,
+  0x1f, 0x1c, 0x84, 0x0e, 0x7b, 0x5d, 0x16, 0xbf, 0x6e, 0x28, 0x9f, 0xae,
+  0x92, 0x9c, 0xd0, 0xa3, 0x3b, 0xb4, 0xa1, 0x5b, 0xd1, 0x34, 0x1d, 0x8f,
+  0xb5, 0x27, 0x14, 0x85, 0xdd, 0x73, 0x9e, 0x91, 0x6d, 0xc2, 0xec, 0xf1,
+  0x8c, 0x43, 0x55, 0xbc, 0xc1, 0x77, 0x06, 0x4f, 0x4f, 0xff, 0xfb, 0xe7,
+  0xd3, 0x8d, 0x8d, 0x7e, 0xbb, 0xea, 0x8d, 0x5a, 0xb3, 0x95, 0x6b, 0x3e,
+  0xb6, 0x17, 0xfd, 0xbe, 0xb6, 0x5a, 0x37, 0x9d, 0xe2, 0x62, 0x40, 0x0f,
+  0x43, 0xf7, 0xe1, 0x1f, 0xd8, 0x84, 0x88, 0xcc, 0xa9, 0xec, 0x0d, 0x5d,
+  0xfc, 0x7f, 0xf7, 0x59, 0xab, 0x4d, 0xdf, 0x70, 0x45, 0xf9, 0xa2, 0x50,
+  0x12, 0xe2, 0x42, 0xc7, 0x3a, 0x84, 0x91, 0x77, 0xb0, 0x67, 0xda, 0xb5,
+  0x75, 0x6d, 0x4f, 0x90, 0x8c, 0x64, 0x37, 0xf8, 0xb6, 0xb1, 0x4b, 0xfd,
+  0x53, 0x68, 0x64, 0x4b, 0x42, 0xbe, 0x29, 0xc4, 0xc2, 0x9f, 0x62, 0x82,
+  0x71, 0x76, 0x5f, 0x38, 0x16, 0x6f, 0x96, 0x2d, 0x3a, 0x03, 0xf6, 0xa8,
+  0x5d, 0x55, 0xeb, 0x17, 0x40, 0xce, 0xf9, 0x16, 0x54, 0x88, 0x65, 0x47,
+  0xda, 0xb5, 0xa1, 0x91, 0xc7, 0xc6, 0xfe, 0x8b, 0xd7, 0x9b, 0xaf, 0xeb,
+  0x90, 0x87, 0xb9, 0x96, 0x74, 0xf6, 0x68, 0x31, 0xe9, 0x99, 0xf0, 0xf2,
+  0x5f, 0x30, 0x81, 0xca, 0x25, 0x55, 0x86, 0xfe, 0x17, 0x18, 0x2d, 0xa2,
+  0x3b, 0xa8, 0x43, 0xd4, 0x08, 0xa3, 0x3e, 0x25, 0xd4, 0x22, 0x6d, 0x9d,
+  0xb0, 0x95, 0x65, 0x57, 0x1f, 0x92, 0xe3, 0x47, 0x17, 0xf4, 0x37, 0xf3,
+  0xe4, 0x06, 0x37, 0x9b, 0x78, 0x43, 0x4f, 0x65, 0x0e, 0x3b, 0x9c, 0x75,
+  0xa4, 0xc0, 0x2a, 0x35, 0xb8, 0xfc, 0x88, 0xde, 0xd5, 0xdc, 0x6d, 0x94,
+  0x1b, 0xd7, 0x88, 0xc4, 0x76, 0xed, 0x1d, 0x08, 0xcb, 0xd7, 0x4e, 0x8f,
+  0xd5, 0x77, 0xb4, 0xa6, 0x40, 0xe6, 0x3b, 0xda, 0xda, 0x83, 0x4f, 0x15,
+  0x95, 0x25, 0x4a, 0xbe, 0xab, 0x3a, 0x03, 0xd8, 0x0e, 0xb4, 0xa0, 0xa0,
+  0xe3, 0x3b, 0xeb, 0x7f, 0xfc, 0x1c, 0x71, 0x81, 0x35, 0xd0, 0x88, 0xfa,
+  0x16, 0x81, 0x6b, 0x41, 0xf8, 0xb5, 0xac, 0x15, 0x8c, 0x5b, 0x8d, 0x3d,
+  0x34, 0x35, 0x6b, 0xcd, 0xee, 0xf4, 0xe0, 0xb6, 0xe1, 0x57, 0x4f, 0x79,
+  0xfd, 0x50, 0x1f, 0x0c, 0x41, 0xdf, 0xba, 0x84, 0x68, 0xeb, 0x1a, 0x7b,
+  0x65, 0x45, 0xa8, 0xc2, 0x9f, 0x40, 0xc7, 0x5a, 0x02, 0x37, 0xdf, 0x5f,
+  0x8f, 0x15, 0xde, 0x33, 0x7a, 0x93, 0x2f, 0x3d, 0xe8, 0x2d, 0xe3, 0xe7,
+  0xc7, 0xb8, 0x06, 0xe9, 0xd6, 0xa3, 0xbb, 0x4d, 0xa5, 0x50, 0x3c, 0x8a,
+  0x9e, 0xdb, 0x4e, 0x8c, 0x6b, 0x9c, 0x8d, 0x8a, 0x86, 0x67, 0x08, 0x65,
+  0xa3, 0xae, 0xc1, 0x34, 0xe4, 0x35, 0xb7, 0x33, 0x88, 0x2e, 0xf2, 0xe4,
+  0x0c, 0x16, 0x07, 0xb3, 0x9f, 0xb6, 0x7a, 0xbd, 0xf3, 0x74, 0x71, 0xb1,
+  0x1c, 0x76, 0x41, 0x36, 0xea, 0xed, 0x7f, 0x5d, 0xe6, 0xc9, 0xc9, 0x1c,
+  0x63, 0xd5, 0x40, 0x15, 0x5f, 0x8e, 0x0f, 0x09, 0xda, 0x73, 0xcc, 0xe4,
+  0x11, 0x94, 0x29, 0x7a, 0x9f, 0x92, 0x45, 0x9e, 0xbd, 0x19, 0x80, 0xf0,
+  0xd8, 0x88, 0x40, 0xc6, 0x3f, 0x4f, 0x16, 0xbb, 0x8d, 0xdf, 0x86, 0x93,
+  0xc1, 0xec, 0xb2, 0xb1, 0x47, 0x7f, 0xde, 0xe9, 0x0d, 0x02, 0x5d, 0x4d,
+  0x80, 0xab, 0x01, 0x0b, 0x4a, 0x8a, 0x2e, 0xef, 0x35, 0xcd, 0x7a, 0xac,
+  0xf5, 0x0e, 0x36, 0xdf, 0x11, 0x22, 0x4b, 0xcf, 0x6e, 0xfd, 0x15, 0x7f,
+  0x1c, 0x81, 0xe4, 0xd9, 0x47, 0xea, 0xe5, 0xfb, 0x7e, 0x67, 0x9e, 0x67,
+  0xe7, 0xf9, 0x60, 0x0a, 0xdb, 0x7d, 0xde, 0x83, 0x4f, 0xc7, 0x94, 0x88,
+  0x53, 0x38, 0xfa, 0xe7, 0x5f, 0xca, 0x9e, 0x05, 0x69, 0xa8, 0x74, 0xab,
+  0xec, 0x15, 0x67, 0x88, 0x8d, 0xbd, 0x67, 0xdd, 0x8d, 0xee, 0x33, 0xa5,
+  0xb0, 0x28, 0x20, 0x1e, 0x95, 0x10, 0xfb, 0x69, 0xb2, 0x37, 0x9d, 0xab,
+  0x69, 0xa4, 0x82, 0xa2, 0x86, 0x4a, 0x9b, 0x70, 0x8a, 0x40, 0x9a, 0xe3,
+  0x3f, 0x5e, 0x2c, 0xa6, 0x93, 0xbd, 0xff, 0x05, 0x76, 0x0d, 0x3f, 0xe3,
+  0x72, 0xb9, 0x00, 0x00
 };
-static const unsigned int static_html_gz_len = 8285;
+static const unsigned int static_html_gz_len = 11536;
 
 #endif /* STATIC_HTML_HEX_H */
@@ -0,0 +1,435 @@
+#include "telnet_console.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+// The telnet console is only available on WiFi-enabled boards
+#if defined(CYW43_WL_GPIO_LED_PIN) && defined(ALTAIR_TELNET)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+
+#include "ansi_keys.h"
+#include "cpu_state.h"
+#include "spsc_ring.h"
+#include "websocket_console.h"
+
+// Telnet commands (RFC 854) and the options offered to clients
+#define TELNET_SE 240
+#define TELNET_BRK 243
+#define TELNET_SB 250
+#define TELNET_WILL 251
+#define TELNET_WONT 252
+#define TELNET_DO 253
+#define TELNET_DONT 254
+#define TELNET_IAC 255
+
+#define TELNET_OPT_ECHO 1
+#define TELNET_OPT_SGA 3 // Suppress go-ahead
+
+typedef enum
+{
+    TELNET_RX_DATA = 0, // Plain bytes
+    TELNET_RX_IAC,      // Command byte follows
+    TELNET_RX_OPTION,   // Option of a WILL/WONT/DO/DONT follows
+    TELNET_RX_SB,       // Inside a subnegotiation, skipped
+    TELNET_RX_SB_IAC    // IAC inside a subnegotiation
+} TELNET_RX_STATE;
+
+// Character mode: the guest echoes, and nobody sends go-ahead
+static const uint8_t telnet_greeting[] = {
+    TELNET_IAC, TELNET_WILL, TELNET_OPT_ECHO, // We echo (the guest does)
+    TELNET_IAC, TELNET_WILL, TELNET_OPT_SGA,  // We send no go-ahead
+    TELNET_IAC, TELNET_DO,   TELNET_OPT_SGA,  // Neither does the client
+};
+
+// Connection state (Core 1)
+static struct tcp_pcb* listen_pcb = NULL;
+static struct tcp_pcb* client_pcb = NULL;
+static volatile bool client_connected = false; // Read by core 0 to decide whether to queue output
+static bool close_pending = false;
+
+// Output not yet taken by the TCP send buffer, only ever touched by core 1
+static uint8_t tx_buffer[TELNET_TX_BUFFER_SIZE];
+static spsc_ring_t tx_ring;
+
+// Input not yet taken by the RX ring. It is acknowledged to the client only once taken, so a
+// paste closes the TCP window while the guest is busy instead of overflowing the ring.
+static struct pbuf* rx_pbuf = NULL;
+
+// Input parser state
+static TELNET_RX_STATE rx_state = TELNET_RX_DATA;
+static uint8_t rx_verb = 0;
+static bool rx_after_cr = false; // CR LF and CR NUL are one Enter
+static ansi_keys_t rx_keys;
+
+// Refuse every option but the ones in the greeting. Replies to DO ECHO, DO SGA and WILL SGA
+// would only confirm what was already agreed, and WONT/DONT are never answered, so the
+// negotiation cannot loop.
+static void negotiate(uint8_t verb, uint8_t option)
+{
+    uint8_t reply[3] = {TELNET_IAC, 0, option};
+    if (verb == TELNET_DO && option != TELNET_OPT_ECHO && option != TELNET_OPT_SGA)
+    {
+        reply[1] = TELNET_WONT;
+    }
+    else if (verb == TELNET_WILL && option != TELNET_OPT_SGA)
+    {
+        reply[1] = TELNET_DONT;
+    }
+    else
+    {
+        return;
+    }
+
+    if (client_pcb != NULL && tcp_sndbuf(client_pcb) >= sizeof(reply))
+    {
+        tcp_write(client_pcb, reply, sizeof(reply), TCP_WRITE_FLAG_COPY);
+        tcp_output(client_pcb);
+    }
+}
+
+// Strip telnet commands, translate cursor keys and queue the keystrokes for the guest.
+// Every byte gives at most one keystroke.
+static void receive(const uint8_t* data, size_t len)
+{
+    uint8_t keys[64];
+    size_t count = 0;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint8_t ch = data[i];
+        switch (rx_state)
+        {
+            case TELNET_RX_DATA:
+                if (ch == TELNET_IAC)
+                {
+                    rx_state = TELNET_RX_IAC;
+                    continue;
+                }
+                break;
+
+            case TELNET_RX_IAC:
+                rx_state = TELNET_RX_DATA;
+                if (ch == TELNET_IAC)
+                {
+                    break; // Escaped 0xFF data byte
+                }
+                if (ch >= TELNET_WILL && ch <= TELNET_DONT)
+                {
+                    rx_verb = ch;
+                    rx_state = TELNET_RX_OPTION;
+                }
+                else if (ch == TELNET_SB)
+                {
+                    rx_state = TELNET_RX_SB;
+                }
+                else if (ch == TELNET_BRK)
+                {
+                    cpu_state_toggle_mode();
+                }
+                continue;
+
+            case TELNET_RX_OPTION:
+                negotiate(rx_verb, ch);
+                rx_state = TELNET_RX_DATA;
+                continue;
+
+            case TELNET_RX_SB:
+                if (ch == TELNET_IAC)
+                {
+                    rx_state = TELNET_RX_SB_IAC;
+                }
+                continue;
+
+            case TELNET_RX_SB_IAC:
+                rx_state = ch == TELNET_SE ? TELNET_RX_DATA : TELNET_RX_SB;
+                continue;
+        }
+
+        if (rx_after_cr && (ch == '\n' || ch == '\0'))
+        {
+            rx_after_cr = false;
+            continue;
+        }
+        rx_after_cr = ch == '\r';
+
+        uint8_t key = ansi_keys_translate(&rx_keys, (uint8_t)(ch & 0x7F));
+        if (key != 0)
+        {
+            keys[count++] = key;
+            if (count == sizeof(keys))
+            {
+                websocket_console_queue_input(keys, count);
+                count = 0;
+            }
+        }
+    }
+
+    if (count > 0)
+    {
+        websocket_console_queue_input(keys, count);
+    }
+}
+
+// Move held input to the guest as far as the RX ring has room
+static void rx_process(void)
+{
+    uint8_t chunk[64];
+    while (rx_pbuf != NULL)
+    {
+        size_t room = websocket_console_input_room();
+        if (room == 0)
+        {
+            break;
+        }
+
+        size_t n = pbuf_copy_partial(rx_pbuf, chunk, (u16_t)(room < sizeof(chunk) ? room : sizeof(chunk)), 0);
+        receive(chunk, n);
+        rx_pbuf = pbuf_free_header(rx_pbuf, (u16_t)n);
+        if (client_pcb != NULL)
+        {
+            tcp_recved(client_pcb, (u16_t)n);
+        }
+    }
+}
+
+// Forget the client, the pcb is closed or already freed
+static void connection_lost(void)
+{
+    if (rx_pbuf != NULL)
+    {
+        pbuf_free(rx_pbuf);
+        rx_pbuf = NULL;
+    }
+    client_pcb = NULL;
+    client_connected = false;
+    close_pending = false;
+    spsc_ring_clear_consumer(&tx_ring);
+    websocket_console_release_queues();
+    printf("[TELNET] Client disconnected\n");
+}
+
+static void close_connection(void)
+{
+    if (client_pcb != NULL)
+    {
+        tcp_arg(client_pcb, NULL);
+        tcp_recv(client_pcb, NULL);
+        tcp_err(client_pcb, NULL);
+        if (tcp_close(client_pcb) != ERR_OK)
+        {
+            tcp_abort(client_pcb);
+        }
+    }
+    connection_lost();
+}
+
+// lwIP callback: connection reset, the pcb is already freed
+static void telnet_err_callback(void* arg, err_t err)
+{
+    (void)arg;
+    (void)err;
+    connection_lost();
+}
+
+// lwIP callback: data received, or the client closed the connection (p == NULL)
+static err_t telnet_recv_callback(void* arg, struct tcp_pcb* tpcb, struct pbuf* p, err_t err)
+{
+    (void)arg;
+
+    if (p == NULL || err != ERR_OK)
+    {
+        if (p != NULL)
+        {
+            pbuf_free(p);
+        }
+        close_pending = true;
+        return ERR_OK;
+    }
+
+    (void)tpcb;
+    if (rx_pbuf == NULL)
+    {
+        rx_pbuf = p;
+    }
+    else
+    {
+        pbuf_cat(rx_pbuf, p);
+    }
+    rx_process();
+    return ERR_OK;
+}
+
+// lwIP callback: new client, a second one is turned away
+static err_t telnet_accept_callback(void* arg, struct tcp_pcb* newpcb, err_t err)
+{
+    (void)arg;
+
+    if (err != ERR_OK || newpcb == NULL)
+    {
+        return ERR_VAL;
+    }
+    if (client_pcb != NULL)
+    {
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    client_pcb = newpcb;
+    tcp_err(newpcb, telnet_err_callback);
+    tcp_recv(newpcb, telnet_recv_callback);
+
+    // Output is already coalesced by the console flush policy, Nagle would only hold back echoes
+    tcp_nagle_disable(newpcb);
+    ip_set_option(newpcb, SOF_KEEPALIVE);
+    newpcb->keep_idle = TELNET_KEEPALIVE_MS;
+
+    rx_state = TELNET_RX_DATA;
+    rx_after_cr = false;
+    memset(&rx_keys, 0, sizeof(rx_keys));
+    spsc_ring_clear_consumer(&tx_ring);
+    tcp_write(newpcb, telnet_greeting, sizeof(telnet_greeting), TCP_WRITE_FLAG_COPY);
+    tcp_output(newpcb);
+
+    client_connected = true;
+    printf("[TELNET] Client connected from %s\n", ipaddr_ntoa(&newpcb->remote_ip));
+    client_connected_cb();
+    return ERR_OK;
+}
+
+bool telnet_console_init(void)
+{
+    spsc_ring_init(&tx_ring, tx_buffer, TELNET_TX_BUFFER_SIZE);
+
+    struct tcp_pcb* pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb == NULL)
+    {
+        return false;
+    }
+    if (tcp_bind(pcb, IP_ANY_TYPE, TELNET_PORT) != ERR_OK)
+    {
+        tcp_close(pcb);
+        return false;
+    }
+
+    listen_pcb = tcp_listen_with_backlog(pcb, 1);
+    if (listen_pcb == NULL)
+    {
+        tcp_close(pcb);
+        return false;
+    }
+    tcp_accept(listen_pcb, telnet_accept_callback);
+    printf("Telnet console listening on port %u\n", TELNET_PORT);
+    return true;
+}
+
+void telnet_console_poll(void)
+{
+    if (close_pending)
+    {
+        close_connection();
+    }
+    if (client_pcb == NULL)
+    {
+        return;
+    }
+
+    // Resume input the RX ring had no room for
+    rx_process();
+
+    static uint8_t chunk[TCP_MSS];
+    bool queued = false;
+    while (spsc_ring_level(&tx_ring) > 0)
+    {
+        size_t room = tcp_sndbuf(client_pcb);
+        if (room == 0 || tcp_sndqueuelen(client_pcb) >= TCP_SND_QUEUELEN)
+        {
+            break;
+        }
+
+        size_t len = spsc_ring_pop(&tx_ring, chunk, room < sizeof(chunk) ? room : sizeof(chunk));
+        if (tcp_write(client_pcb, chunk, (u16_t)len, TCP_WRITE_FLAG_COPY) != ERR_OK)
+        {
+            // Out of segments; the bytes are lost, like those of a client that fell behind
+            break;
+        }
+        queued = true;
+    }
+
+    if (queued)
+    {
+        tcp_output(client_pcb);
+    }
+}
+
+bool telnet_console_connected(void)
+{
+    return client_connected;
+}
+
+size_t telnet_console_space(void)
+{
+    if (!client_connected)
+    {
+        return 0;
+    }
+    return TELNET_TX_BUFFER_SIZE - spsc_ring_level(&tx_ring);
+}
+
+void telnet_console_output(const uint8_t* data, size_t len)
+{
+    if (!client_connected)
+    {
+        return;
+    }
+
+    // 0xFF is doubled so the client does not take it for IAC
+    static const uint8_t iac_iac[2] = {TELNET_IAC, TELNET_IAC};
+    while (len > 0)
+    {
+        const uint8_t* iac = memchr(data, TELNET_IAC, len);
+        size_t run = iac != NULL ? (size_t)(iac - data) : len;
+        spsc_ring_push_overwrite(&tx_ring, data, run);
+        if (iac == NULL)
+        {
+            break;
+        }
+        spsc_ring_push_overwrite(&tx_ring, iac_iac, sizeof(iac_iac));
+        data += run + 1;
+        len -= run + 1;
+    }
+}
+
+#else // No telnet console
+
+bool telnet_console_init(void)
+{
+    return false;
+}
+
+void telnet_console_poll(void)
+{
+}
+
+bool telnet_console_connected(void)
+{
+    return false;
+}
+
+size_t telnet_console_space(void)
+{
+    return 0;
+}
+
+void telnet_console_output(const uint8_t* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+#endif
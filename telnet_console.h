@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Plain TCP console for telnet and netcat clients, next to the WebSocket console. It shares the
+// console rings with the WebSocket clients: guest and CPU monitor output go to both, and
+// keystrokes from either reach the guest. Cursor keys are translated like on the USB console;
+// IAC BRK (the telnet "send brk" command) toggles the CPU monitor.
+#ifndef TELNET_PORT
+#define TELNET_PORT 23
+#endif
+
+// Output waiting for the TCP send buffer (core 1). When WebSocket clients set the pace, a telnet
+// client that falls further behind than this loses its oldest output.
+#define TELNET_TX_BUFFER_SIZE 4096
+
+// Idle time before dead clients are probed with TCP keepalives
+#define TELNET_KEEPALIVE_MS 30000
+
+/**
+ * Listen for telnet clients on TELNET_PORT, one at a time
+ * Called from Core 1 once Wi-Fi is up
+ */
+bool telnet_console_init(void);
+
+/**
+ * Send buffered output as far as the TCP send buffer allows
+ * Called from Core 1's main loop
+ */
+void telnet_console_poll(void);
+
+/**
+ * True while a telnet client is connected (either core)
+ */
+bool telnet_console_connected(void);
+
+/**
+ * Free space in the output buffer, 0 without a client (Core 1)
+ */
+size_t telnet_console_space(void);
+
+/**
+ * Queue console or CPU monitor output for the telnet client (Core 1)
+ */
+void telnet_console_output(const uint8_t* data, size_t len);
@@ -0,0 +1,103 @@
+#include "usb_console.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+#if !defined(CYW43_WL_GPIO_LED_PIN)
+
+#include "pico/stdio/driver.h"
+#include "pico/stdio_usb.h"
+
+// Core 0 only: the rings are filled and drained by the emulation loop
+static char tx_buffer[USB_CONSOLE_TX_SIZE];
+static uint32_t tx_count = 0;
+
+static char rx_buffer[USB_CONSOLE_RX_SIZE];
+static uint32_t rx_head = 0;
+static uint32_t rx_count = 0;
+
+// Set by the driver when input arrives and cleared before the ring is refilled, so an empty
+// console poll is one load instead of a call into the driver and its mutex. Stays set on SDKs
+// without the callback.
+static volatile bool rx_pending = true;
+
+#if PICO_STDIO_USB_SUPPORT_CHARS_AVAILABLE_CALLBACK
+static void input_available(void* param)
+{
+    (void)param;
+    rx_pending = true;
+}
+#endif
+
+void usb_console_init(void)
+{
+#if PICO_STDIO_USB_SUPPORT_CHARS_AVAILABLE_CALLBACK
+    stdio_set_chars_available_callback(input_available, NULL);
+#endif
+}
+
+bool usb_console_try_read(uint8_t* ch)
+{
+    if (rx_head == rx_count)
+    {
+        if (!rx_pending)
+        {
+            return false;
+        }
+#if PICO_STDIO_USB_SUPPORT_CHARS_AVAILABLE_CALLBACK
+        rx_pending = false;
+#endif
+        int n = stdio_usb.in_chars(rx_buffer, sizeof(rx_buffer));
+        if (n <= 0)
+        {
+            return false; // PICO_ERROR_NO_DATA
+        }
+        rx_pending = true; // There may be more, read until the driver runs dry
+        rx_head = 0;
+        rx_count = (uint32_t)n;
+    }
+    *ch = (uint8_t)rx_buffer[rx_head++];
+    return true;
+}
+
+void usb_console_write(uint8_t ch)
+{
+    tx_buffer[tx_count++] = (char)ch;
+    if (tx_count == sizeof(tx_buffer))
+    {
+        usb_console_flush();
+    }
+}
+
+void usb_console_flush(void)
+{
+    if (tx_count == 0)
+    {
+        return;
+    }
+    // Raw bytes as putchar wrote them, dropped by the driver while no terminal is connected
+    stdio_usb.out_chars(tx_buffer, (int)tx_count);
+    tx_count = 0;
+}
+
+#else
+
+void usb_console_init(void)
+{
+}
+
+bool usb_console_try_read(uint8_t* ch)
+{
+    (void)ch;
+    return false;
+}
+
+void usb_console_write(uint8_t ch)
+{
+    (void)ch;
+}
+
+void usb_console_flush(void)
+{
+}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// USB console of the boards without Wi-Fi. Guest output collects in a ring and goes to the SDK's
+// USB CDC driver in one write per flush, instead of one putchar at a time through stdio and its
+// mutex; input is read from the driver in blocks into a second ring. Other stdio output (the
+// boot messages, the monitor) still goes through printf, so the ring is flushed after every
+// batch the 8080 runs, and after each character while it is stopped, to keep the two in order.
+
+// Guest output held until the next flush. A full ring is flushed at once.
+#define USB_CONSOLE_TX_SIZE 512
+
+// Input taken from the driver per read, one full-speed CDC packet
+#define USB_CONSOLE_RX_SIZE 64
+
+/**
+ * Ask the USB driver to report arriving input
+ * Called from Core 0 before the CPU starts
+ */
+void usb_console_init(void);
+
+/**
+ * Next input character, false when there is none
+ * Called from Core 0 (terminal_read)
+ */
+bool usb_console_try_read(uint8_t* ch);
+
+/**
+ * Queue a guest output character
+ * Called from Core 0 (terminal_write)
+ */
+void usb_console_write(uint8_t ch);
+
+/**
+ * Send the queued output to the USB driver
+ * Called from Core 0 after each batch
+ */
+void usb_console_flush(void);
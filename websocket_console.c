@@ -10,62 +10,221 @@
 #include "pico/multicore.h"
 #include "pico/mutex.h"
 #include "pico/stdlib.h"
-#include "pico/util/queue.h"
 
+#include "Altair8800/i8080_heatmap.h"
+#include "FrontPanels/web_panel.h"
+#include "console_script.h"
 #include "cpu_state.h"
+#include "metrics.h"
+#include "spsc_ring.h"
+#include "telnet_console.h"
+#include "wifi_power.h"
 #include "ws.h"
 
 // Enable WebSocket console only if board has WiFi capability
 #if defined(CYW43_WL_GPIO_LED_PIN)
 
-#define WS_RX_QUEUE_DEPTH 128
-#define WS_TX_QUEUE_DEPTH 512
-#define MONITOR_QUEUE_DEPTH 16
+// Ring sizes in bytes, powers of two. The RX ring holds pasted text until the guest reads it.
+#if PICO_RP2350
+#define WS_RX_RING_SIZE 4096
+#else
+#define WS_RX_RING_SIZE 1024
+#endif
+#define WS_TX_RING_SIZE 4096
+#define MONITOR_TX_RING_SIZE 2048
+#define MONITOR_RING_SIZE 16
+
+// Console input credit a WebSocket client can hold, so every client can fill its window at once
+#define WS_INPUT_WINDOW (WS_RX_RING_SIZE / WS_MAX_CLIENTS)
+
+// Core 0 produces TX and consumes RX/monitor input, core 1 the other way round
+static uint8_t ws_rx_buffer[WS_RX_RING_SIZE];
+static uint8_t ws_tx_buffer[WS_TX_RING_SIZE];
+static uint8_t monitor_tx_buffer[MONITOR_TX_RING_SIZE];
+static uint8_t monitor_buffer[MONITOR_RING_SIZE];
+spsc_ring_t g_ws_rx_ring;           // Read by websocket_console_input_pending
+static spsc_ring_t ws_tx_ring;      // WS_CHANNEL_CONSOLE output
+static spsc_ring_t monitor_tx_ring; // WS_CHANNEL_MONITOR output
+static spsc_ring_t monitor_ring;
+
+// Output flushing state (core 1)
+static bool tx_pending = false;      // TX ring held bytes at the last check
+static uint32_t tx_pending_since_us; // When core 1 first saw the oldest unsent bytes
+static uint32_t tx_last_flush_us;    // When output was last sent
+static uint32_t metrics_sent = 0;    // Metrics window last sent on WS_CHANNEL_METRICS
+
+// Console input credit per WebSocket client (core 1). A client sends console bytes only up to
+// the limit it was last granted. Limits only grow, and together they never promise more than
+// the RX ring has room for, so a paste is paced to what the guest reads instead of dropped.
+typedef struct
+{
+    bool active;
+    uint32_t received; // Console bytes received from the client
+    uint32_t limit;    // Console bytes the client may send in total
+} ws_input_credit_t;
 
-static queue_t ws_rx_queue;
-static queue_t ws_tx_queue;
-static queue_t monitor_queue;
+static ws_input_credit_t input_credit[WS_MAX_CLIENTS];
 
 static void websocket_console_clear_tx_buffer(void);
 static void websocket_console_clear_queues(void);
 
 /**
- * @brief Pops bytes from the WebSocket console transmit buffer.
+ * @brief Whether any WebSocket or telnet client takes console output.
  *
- * Retrieves up to max_len bytes from the TX queue.
- * Thread-safe, uses Pico SDK queue.
+ * @return true if output should be queued
+ */
+static bool websocket_console_has_clients(void)
+{
+    return ws_has_active_clients() || telnet_console_connected();
+}
+
+/**
+ * @brief Starts a channel record in an outgoing message.
  *
- * @param buffer Destination buffer for retrieved bytes
- * @param max_len Maximum number of bytes to retrieve
- * @return size_t Number of bytes actually retrieved
+ * @param buffer Where the record starts
+ * @param channel WS_CHANNEL_* the payload belongs to
+ * @param length Payload length
+ * @return size_t Size of the record header
  */
-static size_t websocket_console_tx_pop(uint8_t* buffer, size_t max_len)
+static size_t websocket_console_put_record_header(uint8_t* buffer, uint8_t channel, size_t length)
 {
-    if (!buffer || max_len == 0)
+    buffer[0] = channel;
+    buffer[1] = (uint8_t)length;
+    buffer[2] = (uint8_t)(length >> 8);
+    return WS_RECORD_HEADER;
+}
+
+/**
+ * @brief Moves bytes from a transmit ring into a channel record.
+ *
+ * Copies up to max_len - WS_RECORD_HEADER bytes from the ring in one go and
+ * hands the same bytes to the telnet client. Core 1 only (the ring's consumer).
+ *
+ * @param ring Transmit ring to drain
+ * @param channel WS_CHANNEL_* of the ring
+ * @param buffer Destination for the record
+ * @param max_len Room left in the message
+ * @return size_t Size of the record, 0 if the ring was empty
+ */
+static size_t websocket_console_tx_record(spsc_ring_t* ring, uint8_t channel, uint8_t* buffer, size_t max_len)
+{
+    if (max_len <= WS_RECORD_HEADER)
     {
         return 0;
     }
 
-    size_t count = 0;
-    while (count < max_len && queue_try_remove(&ws_tx_queue, &buffer[count]))
+    size_t len = spsc_ring_pop(ring, buffer + WS_RECORD_HEADER, max_len - WS_RECORD_HEADER);
+    if (len == 0)
     {
-        count++;
+        return 0;
     }
+    telnet_console_output(buffer + WS_RECORD_HEADER, len);
+    return websocket_console_put_record_header(buffer, channel, len) + len;
+}
 
-    return count;
+static uint8_t* put32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
 }
 
 /**
- * @brief Clears the WebSocket console transmit buffer.
+ * @brief Adds the waiting front panel batch as a WS_CHANNEL_PANEL record.
  *
- * Removes all pending bytes from the TX queue.
+ * @param buffer Destination for the record
+ * @param max_len Room left in the message
+ * @return size_t Size of the record, 0 if nothing was added
  */
-static void websocket_console_clear_tx_buffer(void)
+static size_t websocket_console_panel_record(uint8_t* buffer, size_t max_len)
+{
+    if (max_len <= WS_RECORD_HEADER)
+    {
+        return 0;
+    }
+
+    size_t len = web_panel_take(buffer + WS_RECORD_HEADER, max_len - WS_RECORD_HEADER);
+    if (len == 0)
+    {
+        return 0;
+    }
+    return websocket_console_put_record_header(buffer, WS_CHANNEL_PANEL, len) + len;
+}
+
+/**
+ * @brief Adds the latest metrics window as a WS_CHANNEL_METRICS record.
+ *
+ * Nothing is added until core 0 has completed a window not sent before.
+ *
+ * @param buffer Destination for the record
+ * @param max_len Room left in the message
+ * @return size_t Size of the record, 0 if nothing was added
+ */
+static size_t websocket_console_metrics_record(uint8_t* buffer, size_t max_len)
+{
+    if (max_len < WS_RECORD_HEADER + WS_METRICS_RECORD_SIZE)
+    {
+        return 0;
+    }
+
+    metrics_snapshot_t stats;
+    uint32_t window = metrics_copy(&stats);
+    if (window == metrics_sent)
+    {
+        return 0;
+    }
+    metrics_sent = window;
+
+    uint8_t* p = buffer + websocket_console_put_record_header(buffer, WS_CHANNEL_METRICS, WS_METRICS_RECORD_SIZE);
+    p = put32(p, stats.instructions_per_sec);
+    p = put32(p, stats.t_states_per_sec);
+    p = put32(p, stats.core0_cpu_permille);
+    p = put32(p, stats.core0_display_permille);
+    p = put32(p, stats.core1_busy_permille);
+    p = put32(p, stats.ws_tx_high_water);
+    p = put32(p, stats.ws_rx_high_water);
+    p = put32(p, stats.http_bytes_per_sec);
+    p = put32(p, stats.disk_dirty_sectors);
+    p = put32(p, stats.ws_rx_dropped);
+    p = put32(p, stats.ws_tx_dropped);
+    p = put32(p, stats.ws_tx_skipped);
+    p = put32(p, stats.ws_tx_stall_us / 1000);
+    p = put32(p, stats.wifi_pm_mode);
+    p = put32(p, stats.wifi_pm_switches);
+    return (size_t)(p - buffer);
+}
+
+/**
+ * @brief Adds the memory activity of the window as a WS_CHANNEL_HEATMAP record.
+ *
+ * Follows each metrics record, nothing is added without ALTAIR_HEATMAP.
+ *
+ * @param buffer Destination for the record
+ * @param max_len Room left in the message
+ * @return size_t Size of the record, 0 if nothing was added
+ */
+static size_t websocket_console_heatmap_record(uint8_t* buffer, size_t max_len)
 {
-    uint8_t discard = 0;
-    while (queue_try_remove(&ws_tx_queue, &discard))
+    if (max_len < WS_RECORD_HEADER + I8080_HEATMAP_LEVELS_SIZE ||
+        !i8080_heatmap_levels(buffer + WS_RECORD_HEADER))
     {
+        return 0;
     }
+    return websocket_console_put_record_header(buffer, WS_CHANNEL_HEATMAP, I8080_HEATMAP_LEVELS_SIZE) +
+           I8080_HEATMAP_LEVELS_SIZE;
+}
+
+/**
+ * @brief Clears the WebSocket console transmit buffers.
+ *
+ * Drops all pending bytes from the TX rings, from the core 0 (producer) side.
+ */
+static void websocket_console_clear_tx_buffer(void)
+{
+    spsc_ring_clear_producer(&ws_tx_ring);
+    spsc_ring_clear_producer(&monitor_tx_ring);
 }
 
 /**
@@ -76,10 +235,11 @@ static void websocket_console_clear_tx_buffer(void)
  */
 void websocket_queue_init(void)
 {
-    // Initialize queues on core 0 before launching core 1
-    queue_init(&ws_tx_queue, sizeof(uint8_t), WS_TX_QUEUE_DEPTH);
-    queue_init(&ws_rx_queue, sizeof(uint8_t), WS_RX_QUEUE_DEPTH);
-    queue_init(&monitor_queue, sizeof(uint8_t), MONITOR_QUEUE_DEPTH);
+    // Initialize rings on core 0 before launching core 1
+    spsc_ring_init(&ws_tx_ring, ws_tx_buffer, WS_TX_RING_SIZE);
+    spsc_ring_init(&monitor_tx_ring, monitor_tx_buffer, MONITOR_TX_RING_SIZE);
+    spsc_ring_init(&g_ws_rx_ring, ws_rx_buffer, WS_RX_RING_SIZE);
+    spsc_ring_init(&monitor_ring, monitor_buffer, MONITOR_RING_SIZE);
 }
 
 /**
@@ -105,22 +265,98 @@ bool websocket_console_init_server(void)
 }
 
 /**
- * @brief Enqueues a byte for transmission to WebSocket clients.
+ * @brief Enqueues bytes for transmission to WebSocket clients.
  *
- * Adds a byte to the TX buffer for sending to connected WebSocket clients.
- * If no clients are connected, clears the buffer instead to prevent accumulation.
+ * Copies the bytes into a TX ring for sending to connected WebSocket and telnet
+ * clients. If no clients are connected, clears the buffers instead to prevent accumulation.
+ * A full ring is handled according to WS_TX_OVERFLOW.
  *
- * @param value Byte to transmit to WebSocket clients
+ * @param ring TX ring of the channel
+ * @param size Size of the ring
+ * @param data Bytes to transmit to WebSocket clients
+ * @param len Number of bytes
  */
-void websocket_console_enqueue_output(uint8_t value)
+static void websocket_console_enqueue(spsc_ring_t* ring, uint32_t size, const uint8_t* data, size_t len)
 {
-    if (!ws_has_active_clients())
+    (void)size; // WS_TX_OVERFLOW_THROTTLE only
+    if (!websocket_console_has_clients())
     {
         websocket_console_clear_tx_buffer();
         return;
     }
 
-    queue_add_blocking(&ws_tx_queue, &value);
+#if WS_TX_OVERFLOW == WS_TX_OVERFLOW_DROP_OLDEST
+    size_t dropped = spsc_ring_push_overwrite(ring, data, len);
+    __sev(); // Wake core 1 from its idle wait
+    if (dropped != 0)
+    {
+        metrics_ws_tx_dropped((uint32_t)dropped);
+    }
+#else
+    uint32_t stall_start_us = 0;
+    for (;;)
+    {
+        size_t pushed = spsc_ring_push(ring, data, len);
+        __sev(); // Wake core 1 from its idle wait
+        data += pushed;
+        len -= pushed;
+        if (len == 0 || !websocket_console_has_clients())
+        {
+            break;
+        }
+        if (stall_start_us == 0)
+        {
+            stall_start_us = time_us_32() | 1;
+        }
+#if WS_TX_OVERFLOW == WS_TX_OVERFLOW_THROTTLE
+        // Full: hold the guest until core 1 has sent half the ring, so it goes out in whole frames
+        while (spsc_ring_level(ring) > size / 2 && websocket_console_has_clients())
+        {
+            tight_loop_contents();
+        }
+#else
+        tight_loop_contents();
+#endif
+    }
+    if (stall_start_us != 0)
+    {
+        metrics_ws_tx_stall(time_us_32() - stall_start_us);
+    }
+#endif
+    metrics_ws_tx_level(spsc_ring_level(ring));
+}
+
+/**
+ * @brief Enqueues guest terminal output (WS_CHANNEL_CONSOLE).
+ *
+ * @param data Bytes to transmit to WebSocket clients
+ * @param len Number of bytes
+ */
+void websocket_console_enqueue_output_bulk(const uint8_t* data, size_t len)
+{
+    websocket_console_enqueue(&ws_tx_ring, WS_TX_RING_SIZE, data, len);
+}
+
+/**
+ * @brief Enqueues CPU monitor output (WS_CHANNEL_MONITOR).
+ *
+ * @param data Bytes to transmit to WebSocket clients
+ * @param len Number of bytes
+ */
+void websocket_console_enqueue_monitor_output(const uint8_t* data, size_t len)
+{
+    websocket_console_enqueue(&monitor_tx_ring, MONITOR_TX_RING_SIZE, data, len);
+}
+
+
+/**
+ * @brief Enqueues a byte for transmission to WebSocket clients.
+ *
+ * @param value Byte to transmit to WebSocket clients
+ */
+void websocket_console_enqueue_output(uint8_t value)
+{
+    websocket_console_enqueue_output_bulk(&value, 1);
 }
 
 /**
@@ -133,29 +369,72 @@ void websocket_console_enqueue_output(uint8_t value)
  */
 bool websocket_console_try_dequeue_input(uint8_t* value)
 {
-    return queue_try_remove(&ws_rx_queue, value);
+    return spsc_ring_pop_byte(&g_ws_rx_ring, value);
 }
 
 bool websocket_console_try_dequeue_monitor_input(uint8_t* value)
 {
-    return queue_try_remove(&monitor_queue, value);
+    return spsc_ring_pop_byte(&monitor_ring, value);
 }
 
 /**
- * @brief Handles incoming WebSocket input data.
+ * @brief Queues console channel input for the guest or the CPU monitor.
  *
- * Processes bytes received from WebSocket clients with CPU monitor support.
- * - Detects CTRL-M (ASCII 28) to toggle CPU mode
- * - In CPU_RUNNING mode: queues input directly to RX queue
+ * - In CPU_RUNNING mode: queues input directly to RX ring (oldest bytes dropped when full)
  * - In CPU_STOPPED mode: accumulates input in command buffer until '\r'
  * Converts newline characters (\n) to carriage returns (\r).
+ * Core 1 only (the RX rings' producer), also used by the telnet console.
+ *
+ * @param data Console bytes
+ * @param len Number of bytes
+ */
+void websocket_console_queue_input(const uint8_t* data, size_t len)
+{
+    CPU_OPERATING_MODE cpu_mode = cpu_state_get_mode();
+    wifi_power_traffic();
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint8_t ch = data[i];
+        if (ch == '\n')
+        {
+            ch = '\r';
+        }
+
+        switch (cpu_mode)
+        {
+            case CPU_RUNNING:
+                metrics_ws_rx_dropped((uint32_t)spsc_ring_push_overwrite(&g_ws_rx_ring, &ch, 1));
+                metrics_ws_rx_level(spsc_ring_level(&g_ws_rx_ring));
+                break;
+
+            case CPU_STOPPED:
+                metrics_ws_rx_dropped((uint32_t)spsc_ring_push_overwrite(&monitor_ring, &ch, 1));
+                break;
+            default:
+                break;
+        }
+    }
+    __sev(); // Wake core 0 from its idle wait, the guest or monitor has input
+}
+
+/**
+ * @brief Handles incoming WebSocket input data.
  *
+ * Each message holds one or more channel records (see WS_CHANNEL_*).
+ * - WS_CHANNEL_CONSOLE: keystrokes, routed by CPU mode
+ * - WS_CHANNEL_MONITOR: CPU monitor command input
+ * - WS_CHANNEL_CONTROL: WS_CONTROL_TOGGLE_MONITOR toggles CPU mode
+ * - WS_CHANNEL_SCRIPT: WS_SCRIPT_* command for console_script
+ * A truncated record ends the message, unknown channels are skipped.
+ *
+ * @param client Slot of the sending client
  * @param payload Pointer to incoming data bytes
  * @param payload_len Number of bytes in the payload
  * @param user_data User-defined context (unused)
  * @return true if processing succeeded, false if payload is NULL
  */
-bool websocket_console_handle_input(const uint8_t* payload, size_t payload_len, void* user_data)
+bool websocket_console_handle_input(uint32_t client, const uint8_t* payload, size_t payload_len, void* user_data)
 {
     (void)user_data;
 
@@ -164,50 +443,49 @@ bool websocket_console_handle_input(const uint8_t* payload, size_t payload_len,
         return false;
     }
 
-    // Check for CTRL-M (ASCII 28) - toggle CPU mode
-    // The web terminal is configured to send 28 for CTRL-M to distinguish it from Enter (13)
-    if (payload[0] == 28)
-    {
-        CPU_OPERATING_MODE new_mode = cpu_state_toggle_mode();
-        return true;
-    }
-
-    CPU_OPERATING_MODE cpu_mode = cpu_state_get_mode();
-
-    for (size_t i = 0; i < payload_len; ++i)
+    while (payload_len >= WS_RECORD_HEADER)
     {
-        uint8_t ch = payload[i];
-        if (ch == '\n')
+        uint8_t channel = payload[0];
+        size_t len = payload[1] | ((size_t)payload[2] << 8);
+        payload += WS_RECORD_HEADER;
+        payload_len -= WS_RECORD_HEADER;
+        if (len > payload_len)
         {
-            ch = '\r';
+            break;
         }
 
-        switch (cpu_mode)
+        switch (channel)
         {
-            case CPU_RUNNING:
-                if (!queue_try_add(&ws_rx_queue, &ch))
-                {
-                    uint8_t discard = 0;
-                    if (queue_try_remove(&ws_rx_queue, &discard))
-                    {
-                        queue_try_add(&ws_rx_queue, &ch);
-                    }
-                }
+            case WS_CHANNEL_CONSOLE:
+                input_credit[client].received += (uint32_t)len;
+                websocket_console_queue_input(payload, len);
                 break;
 
-            case CPU_STOPPED:
-                if (!queue_try_add(&monitor_queue, &ch))
+            case WS_CHANNEL_MONITOR:
+                wifi_power_traffic();
+                metrics_ws_rx_dropped((uint32_t)spsc_ring_push_overwrite(&monitor_ring, payload, len));
+                break;
+
+            case WS_CHANNEL_CONTROL:
+                for (size_t i = 0; i < len; ++i)
                 {
-                    uint8_t discard = 0;
-                    if (queue_try_remove(&monitor_queue, &discard))
+                    if (payload[i] == WS_CONTROL_TOGGLE_MONITOR)
                     {
-                        queue_try_add(&monitor_queue, &ch);
+                        cpu_state_toggle_mode();
                     }
                 }
                 break;
+
+            case WS_CHANNEL_SCRIPT:
+                console_script_command(payload, len);
+                break;
+
             default:
                 break;
         }
+
+        payload += len;
+        payload_len -= len;
     }
 
     return true;
@@ -216,51 +494,150 @@ bool websocket_console_handle_input(const uint8_t* payload, size_t payload_len,
 /**
  * @brief Callback invoked when a WebSocket client connects.
  *
- * Calls the client_connected_cb function to update CPU mode.
+ * Calls the client_connected_cb function to update CPU mode. The client
+ * gets its first input credit from the next websocket_console_grant_input.
  *
+ * @param client Slot of the client
  * @param user_data User-defined context (unused)
  */
-void websocket_console_on_client_connected(void* user_data)
+void websocket_console_on_client_connected(uint32_t client, void* user_data)
 {
     (void)user_data;
+    input_credit[client] = (ws_input_credit_t){.active = true, .received = 0, .limit = 0};
     client_connected_cb();
 }
 
 /**
  * @brief Callback invoked when a WebSocket client disconnects.
  *
- * Clears both TX and RX queues to reset console state when
- * the client connection is lost.
+ * Returns the client's unused input credit and releases the console queues.
+ * The script is dropped with the last WebSocket client.
  *
+ * @param client Slot of the client
  * @param user_data User-defined context (unused)
  */
-void websocket_console_on_client_disconnected(void* user_data)
+void websocket_console_on_client_disconnected(uint32_t client, void* user_data)
 {
     (void)user_data;
-    websocket_console_clear_queues();
+    input_credit[client].active = false;
+    if (!ws_has_active_clients())
+    {
+        console_script_reset();
+    }
+    websocket_console_release_queues();
 }
 
 /**
- * @brief Clears both TX and RX queues.
+ * @brief Resets console state once the last WebSocket or telnet client is gone.
  *
- * Empties the transmit buffer and removes all pending bytes
- * from the receive queue.
+ * Clears both TX and RX queues when no client is left; remaining clients
+ * keep their output.
  */
-static void websocket_console_clear_queues(void)
+void websocket_console_release_queues(void)
+{
+    if (!websocket_console_has_clients())
+    {
+        websocket_console_clear_queues();
+    }
+}
+
+/**
+ * @brief Console input credit granted to WebSocket clients and not used yet.
+ *
+ * @return uint32_t Bytes that may still arrive without being asked for
+ */
+static uint32_t websocket_console_input_promised(void)
+{
+    uint32_t promised = 0;
+    for (uint32_t i = 0; i < WS_MAX_CLIENTS; ++i)
+    {
+        const ws_input_credit_t* credit = &input_credit[i];
+        if (credit->active && (int32_t)(credit->limit - credit->received) > 0)
+        {
+            promised += credit->limit - credit->received;
+        }
+    }
+    return promised;
+}
+
+/**
+ * @brief Room in the RX ring not promised to any WebSocket client.
+ *
+ * Core 1 only (the RX ring's producer).
+ *
+ * @return size_t Console bytes that can be queued without dropping any
+ */
+size_t websocket_console_input_room(void)
 {
-    websocket_console_clear_tx_buffer();
+    uint32_t room = WS_RX_RING_SIZE - spsc_ring_level(&g_ws_rx_ring);
+    uint32_t promised = websocket_console_input_promised();
+    return room > promised ? room - promised : 0;
+}
 
-    uint8_t discard = 0;
-    while (queue_try_remove(&ws_rx_queue, &discard))
+/**
+ * @brief Tops up the input credit of WebSocket clients as the guest reads.
+ *
+ * A client whose unused credit fell below half of WS_INPUT_WINDOW is sent a
+ * WS_CONTROL_CREDIT record with its new limit, once at least a quarter window
+ * of the RX ring is free to grant. Core 1 only.
+ */
+void websocket_console_grant_input(void)
+{
+    uint32_t room = (uint32_t)websocket_console_input_room();
+    for (uint32_t i = 0; i < WS_MAX_CLIENTS && room >= WS_INPUT_WINDOW / 4; ++i)
     {
+        ws_input_credit_t* credit = &input_credit[i];
+        if (!credit->active)
+        {
+            continue;
+        }
+
+        uint32_t unused = (int32_t)(credit->limit - credit->received) > 0 ? credit->limit - credit->received : 0;
+        if (unused >= WS_INPUT_WINDOW / 2)
+        {
+            continue;
+        }
+        uint32_t grant = WS_INPUT_WINDOW - unused;
+        if (grant > room)
+        {
+            grant = room;
+        }
+
+        uint32_t limit = credit->received + unused + grant;
+        uint8_t record[WS_RECORD_HEADER + WS_CREDIT_RECORD_SIZE];
+        uint8_t* p = record + websocket_console_put_record_header(record, WS_CHANNEL_CONTROL, WS_CREDIT_RECORD_SIZE);
+        *p++ = WS_CONTROL_CREDIT;
+        put32(p, limit);
+        if (ws_send_to_client(i, record, sizeof(record)))
+        {
+            credit->limit = limit;
+            room -= grant;
+        }
     }
 }
 
+/**
+ * @brief Clears both TX and RX queues.
+ *
+ * Runs on core 1, which consumes the TX rings and produces the RX ring,
+ * so all are cleared from that side.
+ */
+static void websocket_console_clear_queues(void)
+{
+    spsc_ring_clear_consumer(&ws_tx_ring);
+    spsc_ring_clear_consumer(&monitor_tx_ring);
+    spsc_ring_clear_producer(&g_ws_rx_ring);
+}
+
 /**
  * @brief Supplies output data to be sent to WebSocket clients.
  *
- * Called by the WebSocket server to retrieve bytes from the TX buffer
- * for transmission to connected clients.
+ * Called by the WebSocket server to build one message for transmission to
+ * connected clients: a front panel record when a batch of samples is ready,
+ * a metrics record and the heatmap when a new window is complete, then monitor and console
+ * records drained from the TX rings. Console output is matched against a
+ * script's wait, and script events follow in a WS_CHANNEL_SCRIPT record so
+ * a match arrives with the output it ends in.
  *
  * @param buffer Destination buffer for output data
  * @param max_len Maximum number of bytes to retrieve
@@ -270,7 +647,101 @@ static void websocket_console_clear_queues(void)
 size_t websocket_console_supply_output(uint8_t* buffer, size_t max_len, void* user_data)
 {
     (void)user_data;
-    return websocket_console_tx_pop(buffer, max_len);
+    if (!buffer)
+    {
+        return 0;
+    }
+
+    size_t len = websocket_console_panel_record(buffer, max_len);
+    size_t metrics_len = websocket_console_metrics_record(buffer + len, max_len - len);
+    len += metrics_len;
+    if (metrics_len != 0)
+    {
+        len += websocket_console_heatmap_record(buffer + len, max_len - len);
+    }
+    size_t text_start = len;
+    len += websocket_console_tx_record(&monitor_tx_ring, WS_CHANNEL_MONITOR, buffer + len, max_len - len);
+    size_t console_room = max_len - len;
+    if (console_script_waiting() && console_room > WS_RECORD_HEADER + CONSOLE_SCRIPT_RECORD_MAX)
+    {
+        console_room -= WS_RECORD_HEADER + CONSOLE_SCRIPT_RECORD_MAX; // Keep room for the match
+    }
+    size_t console_len = websocket_console_tx_record(&ws_tx_ring, WS_CHANNEL_CONSOLE, buffer + len, console_room);
+    if (console_len != 0)
+    {
+        console_script_scan(buffer + len + WS_RECORD_HEADER, console_len - WS_RECORD_HEADER);
+    }
+    len += console_len;
+    if (len > text_start)
+    {
+        wifi_power_traffic(); // Console and monitor text, not the panel and metrics records
+        uint32_t now_us = time_us_32();
+        metrics_ws_frame((uint32_t)len, now_us - tx_pending_since_us);
+        tx_last_flush_us = now_us;
+        tx_pending_since_us = now_us; // What is left arrived while this frame was waiting
+    }
+    if (console_script_pending() && max_len - len > WS_RECORD_HEADER)
+    {
+        size_t events = console_script_take(buffer + len + WS_RECORD_HEADER, max_len - len - WS_RECORD_HEADER);
+        len += websocket_console_put_record_header(buffer + len, WS_CHANNEL_SCRIPT, events) + events;
+    }
+    return len;
+}
+
+/**
+ * @brief Sends console output to telnet only, while no WebSocket client is connected.
+ *
+ * Takes no more than the telnet client has room for, so a full TX ring still
+ * holds back core 0 according to WS_TX_OVERFLOW. Core 1 only.
+ */
+void websocket_console_drain_output(void)
+{
+    static uint8_t buffer[WS_FRAME_PAYLOAD];
+    size_t room = telnet_console_space();
+    websocket_console_supply_output(buffer, room < sizeof(buffer) ? room : sizeof(buffer), NULL);
+}
+
+/**
+ * @brief Decides whether the TX ring should be sent to clients now.
+ *
+ * Output after a quiet period goes out at once so echoed keystrokes are not
+ * held back. Streaming output is coalesced into frames of up to
+ * WS_FRAME_PAYLOAD bytes, and no byte waits longer than WS_FLUSH_COALESCE_US.
+ * Front panel batches and completed metrics windows are sent on their own when
+ * there is no other output. While a script waits for a pattern, output and
+ * script events go out at once. Also samples the front panel while clients are
+ * connected and moves script text into the console input. Core 1 only.
+ *
+ * @param now_us Current time in microseconds
+ * @return true if ws_poll_outgoing should take new output
+ */
+bool websocket_console_output_due(uint32_t now_us)
+{
+    if (ws_has_active_clients())
+    {
+        web_panel_poll(now_us);
+        console_script_poll();
+    }
+
+    uint32_t level = spsc_ring_level(&ws_tx_ring) + spsc_ring_level(&monitor_tx_ring);
+    if (level == 0)
+    {
+        tx_pending = false;
+        return web_panel_ready() || metrics_window() != metrics_sent || console_script_pending();
+    }
+
+    if (!tx_pending)
+    {
+        tx_pending = true;
+        tx_pending_since_us = now_us;
+        if (now_us - tx_last_flush_us >= WS_FLUSH_IDLE_US)
+        {
+            return true;
+        }
+    }
+
+    return level >= WS_FRAME_PAYLOAD || now_us - tx_pending_since_us >= WS_FLUSH_COALESCE_US ||
+           console_script_waiting() || console_script_pending();
 }
 
 #else // No WiFi capability
@@ -295,6 +766,30 @@ void websocket_console_enqueue_output(uint8_t value)
     (void)value;
 }
 
+/**
+ * @brief Stub for enqueuing output when WiFi is not available.
+ *
+ * @param data Unused bytes
+ * @param len Unused length
+ */
+void websocket_console_enqueue_output_bulk(const uint8_t* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+/**
+ * @brief Stub for enqueuing monitor output when WiFi is not available.
+ *
+ * @param data Unused bytes
+ * @param len Unused length
+ */
+void websocket_console_enqueue_monitor_output(const uint8_t* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
 /**
  * @brief Stub for dequeuing input when WiFi is not available.
  *
@@ -4,39 +4,123 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "spsc_ring.h"
+
 // Launch core1 which initializes Wi-Fi, starts the WebSocket server, and runs the poll loop.
 // Call this once from main(); it returns immediately while core1 runs in the background.
 void websocket_console_start(void);
 
-// Enqueue a byte from the emulator (core 0) to be sent to WebSocket clients.
-// 4KB TX queue is large enough for both normal terminal and CPU monitor bulk output.
+// What core 0 does when the TX ring toward core 1 is full
+#define WS_TX_OVERFLOW_BLOCK 0       // Wait for each byte to fit
+#define WS_TX_OVERFLOW_DROP_OLDEST 1 // Never wait, the oldest unsent output is lost
+#define WS_TX_OVERFLOW_THROTTLE 2    // Wait until core 1 has drained the ring to half
+#ifndef WS_TX_OVERFLOW
+#define WS_TX_OVERFLOW WS_TX_OVERFLOW_BLOCK
+#endif
+
+// WebSocket messages in both directions are binary and hold one or more records:
+//   channel (1 byte), payload length (2 bytes little-endian), payload
+#define WS_RECORD_HEADER 3
+#define WS_CHANNEL_CONSOLE 0 // Guest terminal output / keystrokes
+#define WS_CHANNEL_MONITOR 1 // CPU monitor output / command input
+#define WS_CHANNEL_PANEL 2   // Front panel state (device to browser)
+#define WS_CHANNEL_FILE 3    // Reserved for file transfer
+#define WS_CHANNEL_METRICS 4 // Metrics window as little-endian 32-bit values (device to browser)
+#define WS_CHANNEL_CONTROL 5 // WS_CONTROL_* commands (browser to device)
+#define WS_CHANNEL_SCRIPT 6  // WS_SCRIPT_* commands and events for test harnesses (console_script.h)
+#define WS_CHANNEL_HEATMAP 7 // Guest memory activity with each metrics window, ALTAIR_HEATMAP only (device to browser)
+
+// WS_CHANNEL_CONTROL commands. Browser to device: WS_CONTROL_TOGGLE_MONITOR toggles CPU mode.
+// Device to browser: WS_CONTROL_CREDIT followed by a 32-bit little-endian limit, the total number
+// of console payload bytes the client may have sent since it connected. A client holds back
+// keystrokes beyond its limit; nothing is sent until the first credit arrives.
+#define WS_CONTROL_TOGGLE_MONITOR 1
+#define WS_CONTROL_CREDIT 2
+#define WS_CREDIT_RECORD_SIZE 5
+
+// WS_CHANNEL_METRICS payload: instructions/s, T-states/s, core 0 CPU and display permille,
+// core 1 busy permille, TX and RX high water, HTTP bytes/s, dirty disk sectors, then since boot
+// input bytes dropped, output bytes dropped and skipped by lagging clients, ms core 0 stalled,
+// then the CYW43 power save mode (WIFI_POWER_MODE) and its changes since boot
+#define WS_METRICS_RECORD_SIZE (15 * 4)
+
+// WS_CHANNEL_HEATMAP payload: I8080_HEATMAP_LEVELS_SIZE bytes, the reads, writes and executed
+// instructions of each 256-byte page in the window as i8080_heatmap_levels gives them
+
+// Enqueue bytes from the emulator (core 0) to be sent to WebSocket clients.
+// Guest output goes to a 4KB ring (WS_CHANNEL_CONSOLE), CPU monitor output to its own 2KB
+// ring (WS_CHANNEL_MONITOR).
 void websocket_console_enqueue_output(uint8_t value);
+void websocket_console_enqueue_output_bulk(const uint8_t* data, size_t len);
+void websocket_console_enqueue_monitor_output(const uint8_t* data, size_t len);
 
 // Try to dequeue a byte received from WebSocket clients (called from core 0).
 bool websocket_console_try_dequeue_input(uint8_t* value);
 
+// Whether console input may be waiting, one load of the ring head and no call, so the guest's
+// empty console polls skip websocket_console_try_dequeue_input (called from core 0, Wi-Fi only).
+static inline bool websocket_console_input_pending(void)
+{
+    extern spsc_ring_t g_ws_rx_ring;
+    return spsc_ring_readable(&g_ws_rx_ring);
+}
+
 // Try to dequeue a byte received from the CPU monitor input queue (called from core 0).
 bool websocket_console_try_dequeue_monitor_input(uint8_t* value);
 
 // Check if the console is running and Wi-Fi is connected.
 bool websocket_console_is_running(void);
 
+// Output flushing (core 1): output that follows WS_FLUSH_IDLE_US of silence, typically the
+// echo of a keystroke, is sent at once. While output keeps coming it is coalesced until a
+// WS_FRAME_PAYLOAD frame is full or the oldest byte has waited WS_FLUSH_COALESCE_US.
+#ifndef WS_FLUSH_IDLE_US
+#define WS_FLUSH_IDLE_US 10000
+#endif
+#ifndef WS_FLUSH_COALESCE_US
+#define WS_FLUSH_COALESCE_US 20000
+#endif
+
+// True when the TX ring should be sent now (called from core 1 every poll loop)
+bool websocket_console_output_due(uint32_t now_us);
+
+// Send due output to the telnet client alone while no WebSocket client is connected (core 1)
+void websocket_console_drain_output(void);
+
+// Queue keystrokes for the guest, or for the CPU monitor while it is active (core 1)
+void websocket_console_queue_input(const uint8_t* data, size_t len);
+
+// Console bytes that can be queued without dropping any or using WebSocket credit (core 1)
+size_t websocket_console_input_room(void);
+
+// Send WebSocket clients new input credit as the guest consumes input (core 1)
+void websocket_console_grant_input(void);
+
+// Clear the console queues if no WebSocket or telnet client is left (core 1)
+void websocket_console_release_queues(void);
+
 // Forward declarations for internal functions
 void ws_poll_incoming(void);
-void ws_poll_outgoing(void);
+void ws_poll_outgoing(bool take_output);
+bool ws_output_pending(void);
+bool ws_has_active_clients(void);
 
 // Poll the WebSocket server for incoming and outgoing messages (internal use)
-static inline void ws_poll(volatile bool* pending_ws_input, volatile bool* pending_ws_output)
+static inline void ws_poll(uint32_t now_us)
 {
-    if (*pending_ws_input)
+    ws_poll_incoming();
+    websocket_console_grant_input();
+    bool take_output = websocket_console_output_due(now_us);
+    if (!ws_has_active_clients())
     {
-        *pending_ws_input = false;
-        ws_poll_incoming();
+        if (take_output)
+        {
+            websocket_console_drain_output();
+        }
     }
-    if (*pending_ws_output)
+    else if (take_output || ws_output_pending())
     {
-        *pending_ws_output = false;
-        ws_poll_outgoing();
+        ws_poll_outgoing(take_output);
     }
 }
 
@@ -53,7 +137,7 @@ void client_connected_cb(void);
 void process_virtual_input(const char* command, size_t len);
 
 // WebSocket callback functions (internal use)
-bool websocket_console_handle_input(const uint8_t* payload, size_t payload_len, void* user_data);
+bool websocket_console_handle_input(uint32_t client, const uint8_t* payload, size_t payload_len, void* user_data);
 size_t websocket_console_supply_output(uint8_t* buffer, size_t max_len, void* user_data);
-void websocket_console_on_client_connected(void* user_data);
-void websocket_console_on_client_disconnected(void* user_data);
+void websocket_console_on_client_connected(uint32_t client, void* user_data);
+void websocket_console_on_client_disconnected(uint32_t client, void* user_data);
@@ -0,0 +1,119 @@
+#include "wifi_power.h"
+
+#include "pico/stdlib.h" // Must be included before WiFi check to get board definitions
+
+#include "metrics.h"
+
+#if defined(CYW43_WL_GPIO_LED_PIN)
+
+#include "cyw43.h"
+#include "pico/cyw43_arch.h"
+
+#ifdef ALTAIR_WIFI_POWER
+
+// Core 1 only
+static uint8_t current_mode = WIFI_POWER_BALANCED;
+static uint32_t mode_since_us = 0;
+static uint32_t last_traffic_us = 0;
+static bool traffic = false;
+
+static const uint32_t pm_values[WIFI_POWER_MODES] = {CYW43_NO_POWERSAVE_MODE, CYW43_PERFORMANCE_PM,
+                                                     CYW43_AGGRESSIVE_PM};
+
+static void set_mode(uint8_t next, uint32_t now_us)
+{
+    if (cyw43_wifi_pm(&cyw43_state, pm_values[next]) != 0)
+    {
+        return; // Tried again on the next poll
+    }
+    metrics_wifi_pm(next, (now_us - mode_since_us) / 1000);
+    current_mode = next;
+    mode_since_us = now_us;
+}
+
+void wifi_power_init(void)
+{
+    uint32_t now_us = time_us_32();
+    cyw43_wifi_pm(&cyw43_state, pm_values[WIFI_POWER_BALANCED]);
+    current_mode = WIFI_POWER_BALANCED;
+    mode_since_us = now_us;
+    last_traffic_us = now_us;
+}
+
+void wifi_power_traffic(void)
+{
+    traffic = true;
+}
+
+void wifi_power_poll(uint32_t now_us, bool clients)
+{
+    if (traffic)
+    {
+        traffic = false;
+        last_traffic_us = now_us;
+        if (current_mode != WIFI_POWER_INTERACTIVE)
+        {
+            set_mode(WIFI_POWER_INTERACTIVE, now_us);
+        }
+        return;
+    }
+
+    // Down one step at a time, each after its quiet time
+    uint32_t quiet_us = now_us - last_traffic_us;
+    if (current_mode == WIFI_POWER_INTERACTIVE && quiet_us >= WIFI_POWER_INTERACTIVE_MS * 1000u)
+    {
+        set_mode(WIFI_POWER_BALANCED, now_us);
+    }
+    else if (current_mode == WIFI_POWER_BALANCED && !clients && quiet_us >= WIFI_POWER_IDLE_MS * 1000u)
+    {
+        set_mode(WIFI_POWER_IDLE, now_us);
+    }
+    else if (current_mode == WIFI_POWER_IDLE && clients)
+    {
+        set_mode(WIFI_POWER_BALANCED, now_us); // A client connected without sending anything yet
+    }
+}
+
+#else
+
+void wifi_power_init(void)
+{
+    // Short 200 ms sleep retention, a balance of latency and current
+    cyw43_wifi_pm(&cyw43_state, CYW43_PERFORMANCE_PM);
+}
+
+void wifi_power_traffic(void)
+{
+}
+
+void wifi_power_poll(uint32_t now_us, bool clients)
+{
+    (void)now_us;
+    (void)clients;
+}
+
+#endif
+
+#else
+
+void wifi_power_init(void)
+{
+}
+
+void wifi_power_traffic(void)
+{
+}
+
+void wifi_power_poll(uint32_t now_us, bool clients)
+{
+    (void)now_us;
+    (void)clients;
+}
+
+#endif
+
+const char* wifi_power_mode_name(uint8_t mode)
+{
+    static const char* const names[WIFI_POWER_MODES] = {"interactive", "balanced", "idle"};
+    return mode < WIFI_POWER_MODES ? names[mode] : "?";
+}
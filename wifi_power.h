@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// CYW43 power save mode following the console and HTTP traffic, on core 1 (built with
+// ALTAIR_WIFI_POWER, otherwise the radio stays in CYW43_PERFORMANCE_PM). Console input, console
+// and monitor output and HTTP data switch the radio to CYW43_NO_POWERSAVE_MODE at once; after
+// WIFI_POWER_INTERACTIVE_MS without traffic it goes back to CYW43_PERFORMANCE_PM, and after
+// WIFI_POWER_IDLE_MS with no console client connected either to CYW43_AGGRESSIVE_PM. Front panel
+// and metrics frames do not count as traffic, so a browser left open does not keep the radio
+// awake. The mode and the switches are in the metrics.
+typedef enum
+{
+    WIFI_POWER_INTERACTIVE = 0, // CYW43_NO_POWERSAVE_MODE
+    WIFI_POWER_BALANCED,        // CYW43_PERFORMANCE_PM
+    WIFI_POWER_IDLE,            // CYW43_AGGRESSIVE_PM
+    WIFI_POWER_MODES
+} WIFI_POWER_MODE;
+
+// Quiet time before leaving the interactive mode, and before the idle mode
+#define WIFI_POWER_INTERACTIVE_MS 2000
+#define WIFI_POWER_IDLE_MS 60000
+
+/**
+ * Set the balanced mode once the connection is up
+ * Called from Core 1
+ */
+void wifi_power_init(void);
+
+/**
+ * Note console or HTTP traffic
+ * Called from Core 1, in the lwIP callbacks and the poll loop
+ */
+void wifi_power_traffic(void);
+
+/**
+ * Switch the mode the traffic asks for
+ * Called from Core 1's poll loop
+ */
+void wifi_power_poll(uint32_t now_us, bool clients);
+
+/**
+ * Short name of a mode, for STATS
+ */
+const char* wifi_power_mode_name(uint8_t mode);
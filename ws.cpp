@@ -3,6 +3,11 @@
 #include "pico/time.h"
 #include "pico_ws_server/web_socket_server.h"
 
+extern "C"
+{
+#include "metrics.h"
+}
+
 #include <cstdio>
 #include <cstring>
 #include <memory>
@@ -10,15 +15,20 @@
 namespace
 {
 static constexpr uint16_t WS_SERVER_PORT = 8088;
-static constexpr uint32_t WS_MAX_CLIENTS = 2;
+#if PICO_RP2350
+static constexpr uint32_t WS_BROADCAST_RING_SIZE = 16384;
+#else
+static constexpr uint32_t WS_BROADCAST_RING_SIZE = 4096;
+#endif
 // The pico-ws-server `max_connections` limit counts *all* TCP connections (including
 // non-upgraded HTTP connections used to serve the UI). Keep this higher than
 // WS_MAX_CLIENTS to avoid RSTs during the WebSocket handshake when a browser
 // holds an HTTP keep-alive connection open.
 static constexpr uint32_t WS_SERVER_MAX_CONNECTIONS = 8;
-static constexpr size_t WS_FRAME_PAYLOAD = 256;
 static constexpr uint32_t WS_PING_INTERVAL_MS = 10000; // 10s
 static constexpr uint8_t WS_MAX_MISSED_PONGS = 3;      // 30s total timeout
+// A client that holds up new output this long with a full backlog skips to the newest output
+static constexpr uint32_t WS_LAGGARD_TIMEOUT_US = 500000;
 
 struct ws_context_t
 {
@@ -31,6 +41,8 @@ struct ws_connection_state_t
     absolute_time_t next_ping_deadline;
     uint8_t pending_pings;
     uint8_t missed_pongs;
+    uint32_t tx_cursor;      // Start of the next g_ws_tx_ring message this client has not been sent
+    uint32_t tx_progress_us; // When tx_cursor last moved, or the client connected
     bool active;
     bool closing;
 };
@@ -42,6 +54,15 @@ static size_t g_ws_active_clients = 0;
 static std::unique_ptr<WebSocketServer> g_ws_server;
 static ws_connection_state_t g_ws_connections[WS_MAX_CLIENTS] = {};
 
+// Messages taken from on_output, kept until every client has been sent them. Each client
+// drains them from its own cursor; the one furthest ahead paces on_output, and clients more
+// than a ring behind skip whole messages instead of stalling the others. Every message is
+// stored as a 2-byte little-endian length followed by the payload. on_output messages must
+// stay valid when concatenated: a lagging client is sent several of them as one frame.
+static constexpr uint32_t WS_MESSAGE_HEADER = 2;
+static uint8_t g_ws_tx_ring[WS_BROADCAST_RING_SIZE];
+static uint32_t g_ws_tx_head = 0; // Bytes taken since boot, wraps at 2^32
+
 static ws_connection_state_t* find_connection(uint32_t conn_id)
 {
     for (size_t i = 0; i < WS_MAX_CLIENTS; ++i)
@@ -66,12 +87,101 @@ static ws_connection_state_t* allocate_connection(uint32_t conn_id)
             g_ws_connections[i].pending_pings = 0;
             g_ws_connections[i].missed_pongs = 0;
             g_ws_connections[i].next_ping_deadline = make_timeout_time_ms(WS_PING_INTERVAL_MS);
+            g_ws_connections[i].tx_cursor = g_ws_tx_head;
+            g_ws_connections[i].tx_progress_us = time_us_32();
             return &g_ws_connections[i];
         }
     }
     return nullptr;
 }
 
+static bool connection_sendable(const ws_connection_state_t* conn)
+{
+    return conn->active && !conn->closing;
+}
+
+// Copy length bytes of g_ws_tx_ring starting at index into out
+static void tx_ring_read(uint32_t index, uint8_t* out, uint32_t length)
+{
+    uint32_t offset = index % WS_BROADCAST_RING_SIZE;
+    uint32_t first = WS_BROADCAST_RING_SIZE - offset;
+    if (first > length)
+    {
+        first = length;
+    }
+    std::memcpy(out, g_ws_tx_ring + offset, first);
+    std::memcpy(out + first, g_ws_tx_ring, length - first);
+}
+
+static void tx_ring_write(const uint8_t* data, uint32_t length)
+{
+    uint32_t offset = g_ws_tx_head % WS_BROADCAST_RING_SIZE;
+    uint32_t first = WS_BROADCAST_RING_SIZE - offset;
+    if (first > length)
+    {
+        first = length;
+    }
+    std::memcpy(g_ws_tx_ring + offset, data, first);
+    std::memcpy(g_ws_tx_ring, data + first, length - first);
+    g_ws_tx_head += length;
+}
+
+// Payload length of the message starting at index
+static uint32_t tx_message_length(uint32_t index)
+{
+    uint8_t header[WS_MESSAGE_HEADER];
+    tx_ring_read(index, header, WS_MESSAGE_HEADER);
+    return header[0] | ((uint32_t)header[1] << 8);
+}
+
+static void tx_message_write(const uint8_t* payload, uint32_t length)
+{
+    const uint8_t header[WS_MESSAGE_HEADER] = {(uint8_t)length, (uint8_t)(length >> 8)};
+    tx_ring_write(header, WS_MESSAGE_HEADER);
+    tx_ring_write(payload, length);
+}
+
+static uint32_t tx_least_backlog(void)
+{
+    uint32_t least = WS_BROADCAST_RING_SIZE;
+    for (size_t i = 0; i < WS_MAX_CLIENTS; ++i)
+    {
+        const ws_connection_state_t* conn = &g_ws_connections[i];
+        if (connection_sendable(conn) && g_ws_tx_head - conn->tx_cursor < least)
+        {
+            least = g_ws_tx_head - conn->tx_cursor;
+        }
+    }
+    return least;
+}
+
+// Largest payload g_ws_tx_ring has room for: what the client furthest ahead has been sent.
+// When that is less than a frame, clients that have not drained anything for
+// WS_LAGGARD_TIMEOUT_US are resynced to the newest output first.
+static uint32_t tx_ring_space(uint32_t now_us)
+{
+    uint32_t least = tx_least_backlog();
+    if (least + WS_MESSAGE_HEADER + WS_FRAME_PAYLOAD > WS_BROADCAST_RING_SIZE)
+    {
+        for (size_t i = 0; i < WS_MAX_CLIENTS; ++i)
+        {
+            ws_connection_state_t* conn = &g_ws_connections[i];
+            if (connection_sendable(conn) && now_us - conn->tx_progress_us >= WS_LAGGARD_TIMEOUT_US)
+            {
+#ifdef ALTAIR_DEBUG
+                printf("WebSocket client %u stalled, skipping %lu bytes\n", conn->conn_id,
+                       (unsigned long)(g_ws_tx_head - conn->tx_cursor));
+#endif
+                metrics_ws_tx_skipped(g_ws_tx_head - conn->tx_cursor);
+                conn->tx_cursor = g_ws_tx_head;
+                conn->tx_progress_us = now_us;
+            }
+        }
+        least = tx_least_backlog();
+    }
+    return least + WS_MESSAGE_HEADER < WS_BROADCAST_RING_SIZE ? WS_BROADCAST_RING_SIZE - WS_MESSAGE_HEADER - least : 0;
+}
+
 static void send_ping_if_due(void)
 {
     if (!g_ws_running || !g_ws_server || g_ws_active_clients == 0)
@@ -159,7 +269,7 @@ void handle_connect(WebSocketServer& server, uint32_t conn_id)
     ws_context_t* ctx = static_cast<ws_context_t*>(server.getCallbackExtra());
     if (ctx && ctx->callbacks.on_client_connected)
     {
-        ctx->callbacks.on_client_connected(ctx->callbacks.user_data);
+        ctx->callbacks.on_client_connected((uint32_t)(conn - g_ws_connections), ctx->callbacks.user_data);
     }
 }
 
@@ -167,17 +277,18 @@ void handle_close(WebSocketServer& server, uint32_t conn_id)
 {
     (void)server;
 
-    // Only decrement if this connection was tracked as active.
+    // Only decrement if this connection was tracked as active; rejected ones never had a slot.
     ws_connection_state_t* conn = find_connection(conn_id);
-    if (conn)
+    if (!conn)
     {
-        conn->active = false;
-        conn->closing = false;
+        return;
+    }
 
-        if (g_ws_active_clients > 0)
-        {
-            --g_ws_active_clients;
-        }
+    conn->active = false;
+    conn->closing = false;
+    if (g_ws_active_clients > 0)
+    {
+        --g_ws_active_clients;
     }
 
 #ifdef ALTAIR_DEBUG
@@ -187,7 +298,7 @@ void handle_close(WebSocketServer& server, uint32_t conn_id)
     ws_context_t* ctx = static_cast<ws_context_t*>(server.getCallbackExtra());
     if (ctx && ctx->callbacks.on_client_disconnected)
     {
-        ctx->callbacks.on_client_disconnected(ctx->callbacks.user_data);
+        ctx->callbacks.on_client_disconnected((uint32_t)(conn - g_ws_connections), ctx->callbacks.user_data);
     }
 }
 
@@ -199,19 +310,22 @@ void handle_message(WebSocketServer& server, uint32_t conn_id, const void* data,
         return;
     }
 
+    ws_connection_state_t* conn = find_connection(conn_id);
+    if (!conn)
+    {
+        return;
+    }
+
     bool keep_open = true;
     if (ctx->callbacks.on_receive)
     {
-        keep_open = ctx->callbacks.on_receive(static_cast<const uint8_t*>(data), len, ctx->callbacks.user_data);
+        keep_open = ctx->callbacks.on_receive((uint32_t)(conn - g_ws_connections), static_cast<const uint8_t*>(data),
+                                              len, ctx->callbacks.user_data);
     }
 
     if (!keep_open)
     {
-        ws_connection_state_t* conn = find_connection(conn_id);
-        if (conn)
-        {
-            conn->closing = true;
-        }
+        conn->closing = true;
         server.close(conn_id);
     }
 }
@@ -332,7 +446,7 @@ extern "C"
         send_ping_if_due();
     }
 
-    void ws_poll_outgoing(void)
+    void ws_poll_outgoing(bool take_output)
     {
         if (!g_ws_running || !g_ws_server)
         {
@@ -344,35 +458,96 @@ extern "C"
             return;
         }
 
-        uint8_t payload[WS_FRAME_PAYLOAD];
+        static uint8_t payload[WS_FRAME_PAYLOAD];
+        uint32_t now_us = time_us_32();
 
-        size_t payload_len =
-            g_ws_context.callbacks.on_output(payload, sizeof(payload), g_ws_context.callbacks.user_data);
-        if (payload_len == 0)
+        if (take_output)
         {
-            return;
+            uint32_t space = tx_ring_space(now_us);
+            size_t payload_len = g_ws_context.callbacks.on_output(payload, space < sizeof(payload) ? space : sizeof(payload),
+                                                                  g_ws_context.callbacks.user_data);
+
+            // Whoever would end up more than a ring behind loses its oldest messages
+            uint32_t needed = WS_MESSAGE_HEADER + (uint32_t)payload_len;
+            for (size_t i = 0; payload_len > 0 && i < WS_MAX_CLIENTS; ++i)
+            {
+                ws_connection_state_t* conn = &g_ws_connections[i];
+                while (connection_sendable(conn) && g_ws_tx_head - conn->tx_cursor + needed > WS_BROADCAST_RING_SIZE)
+                {
+                    uint32_t skipped = WS_MESSAGE_HEADER + tx_message_length(conn->tx_cursor);
+                    metrics_ws_tx_skipped(skipped);
+                    conn->tx_cursor += skipped;
+                }
+            }
+            if (payload_len > 0)
+            {
+                tx_message_write(payload, (uint32_t)payload_len);
+            }
         }
 
-        // Send to each active client individually (best-effort: don't block on slow clients)
+        // Each client gets its next message (best-effort: a client whose TCP send buffer is full
+        // keeps its backlog and is retried on the next poll)
         for (size_t i = 0; i < WS_MAX_CLIENTS; ++i)
         {
             ws_connection_state_t* conn = &g_ws_connections[i];
-            if (!conn->active || conn->closing)
+            if (!connection_sendable(conn) || conn->tx_cursor == g_ws_tx_head)
             {
                 continue;
             }
+
+            // A client with a backlog gets as many whole messages as fit into one frame
+            uint32_t cursor = conn->tx_cursor;
+            uint32_t payload_len = 0;
+            while (cursor != g_ws_tx_head)
+            {
+                uint32_t length = tx_message_length(cursor);
+                if (payload_len + length > sizeof(payload))
+                {
+                    break;
+                }
+                tx_ring_read(cursor + WS_MESSAGE_HEADER, payload + payload_len, length);
+                payload_len += length;
+                cursor += WS_MESSAGE_HEADER + length;
+            }
 #ifdef ALTAIR_DEBUG
-            printf("WebSocket sending %zu bytes to %u\n", payload_len, conn->conn_id);
+            printf("WebSocket sending %lu bytes to %u\n", (unsigned long)payload_len, conn->conn_id);
 #endif
 
-            if (!g_ws_server->sendMessage(conn->conn_id, payload, payload_len))
+            if (g_ws_server->sendMessage(conn->conn_id, payload, payload_len))
             {
+                conn->tx_cursor = cursor;
+                conn->tx_progress_us = now_us;
+            }
 #ifdef ALTAIR_DEBUG
-                // This specific client's TCP send buffer is full - they miss this frame
-                // (expected under load; real-time data, no backpressure)
-                printf("WebSocket send failed, dropping %zu bytes\n", payload_len);
+            else
+            {
+                printf("WebSocket send to %u deferred, %lu bytes behind\n", conn->conn_id,
+                       (unsigned long)(g_ws_tx_head - conn->tx_cursor));
+            }
 #endif
+        }
+    }
+
+    bool ws_send_to_client(uint32_t client, const uint8_t* payload, size_t payload_len)
+    {
+        if (!g_ws_running || !g_ws_server || client >= WS_MAX_CLIENTS ||
+            !connection_sendable(&g_ws_connections[client]))
+        {
+            return false;
+        }
+        return g_ws_server->sendMessage(g_ws_connections[client].conn_id, payload, payload_len);
+    }
+
+    bool ws_output_pending(void)
+    {
+        for (size_t i = 0; i < WS_MAX_CLIENTS; ++i)
+        {
+            const ws_connection_state_t* conn = &g_ws_connections[i];
+            if (connection_sendable(conn) && conn->tx_cursor != g_ws_tx_head)
+            {
+                return true;
             }
         }
+        return false;
     }
 }
@@ -4,9 +4,22 @@
 #include <stddef.h>
 #include <stdint.h>
 
-typedef bool (*ws_receive_cb_t)(const uint8_t* payload, size_t payload_len, void* user_data);
+// Largest console frame payload, by default one TCP segment (TCP_MSS 1460 less the 4-byte
+// WebSocket header of payloads over 125 bytes)
+#ifndef WS_FRAME_PAYLOAD
+#define WS_FRAME_PAYLOAD 1456
+#endif
+
+// WebSocket clients served at once; callbacks identify a client by its slot, 0..WS_MAX_CLIENTS - 1
+#if PICO_RP2350
+#define WS_MAX_CLIENTS 4
+#else
+#define WS_MAX_CLIENTS 2
+#endif
+
+typedef bool (*ws_receive_cb_t)(uint32_t client, const uint8_t* payload, size_t payload_len, void* user_data);
 typedef size_t (*ws_output_cb_t)(uint8_t* buffer, size_t max_len, void* user_data);
-typedef void (*ws_event_cb_t)(void* user_data);
+typedef void (*ws_event_cb_t)(uint32_t client, void* user_data);
 
 typedef struct
 {
@@ -26,8 +39,13 @@ extern "C"
     bool ws_start(void);
     bool ws_is_running(void);
     void ws_poll_incoming(void);
-    void ws_poll_outgoing(void);
+    // Send each client the next frame of its backlog; take_output first pulls new output
+    void ws_poll_outgoing(bool take_output);
+    // True while some client has not been sent all output yet
+    bool ws_output_pending(void);
     bool ws_has_active_clients(void);
+    // Send one client a message of its own, outside the broadcast output (false if it did not fit)
+    bool ws_send_to_client(uint32_t client, const uint8_t* payload, size_t payload_len);
 
 #ifdef __cplusplus
 }